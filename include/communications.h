@@ -1,22 +1,17 @@
 #ifndef COMMUNICATION_H
 #define COMMUNICATION_H
 
+#ifdef ARDUINO
 #include <Arduino.h>
 #include <SPI.h>
 #include <LoRa.h>
-
-// LoRa Pin Configuration for ESP32
-#define LORA_SS     5
-#define LORA_RST    14
-#define LORA_DIO0   2
-
-// LoRa Communication Settings
-#define LORA_FREQUENCY      433E6
-#define LORA_TX_POWER       20
-#define LORA_BANDWIDTH      125E3
-#define LORA_SPREADING_FACTOR 7
-#define LORA_CODING_RATE    5
-#define LORA_PREAMBLE_LENGTH 8
+#else
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#endif
+#include "config.h"
+#include "utilities/spsc_ring.h"
 
 // Message Types for Drone Swarm
 enum DroneMessageType {
@@ -30,7 +25,12 @@ enum DroneMessageType {
     MSG_TARGET_FOUND = 0x08,
     MSG_EMERGENCY_STOP = 0x09,
     MSG_STATUS_REQUEST = 0x0A,
-    MSG_STATUS_RESPONSE = 0x0B
+    MSG_STATUS_RESPONSE = 0x0B,
+    MSG_BATCH = 0x0C,               // Several logical messages, see communications/message_parser.h
+    MSG_LINK_STATE = 0x0D,          // Adaptive data rate, see communications/lora_interface.h
+    MSG_RELIABLE = 0x0E,            // Acknowledged unicast, see communications/reliable_link.h
+    MSG_FEC = 0x0F,                 // One frame of an erasure-coded group, see communications/message_parser.h
+    MSG_OTA = 0x10                  // Update dissemination, see communications/ota_service.h
 };
 
 // Core Message Structure
@@ -45,7 +45,18 @@ struct DroneMessage {
     uint8_t checksum;
 } __attribute__((packed));
 
-// Heartbeat Data Structure
+// XOR over every byte before the checksum field
+inline uint8_t droneMessageChecksum(const DroneMessage& msg) {
+    const uint8_t* bytes = (const uint8_t*)&msg;
+    uint8_t checksum = 0;
+    for (size_t i = 0; i < sizeof(DroneMessage) - 1; i++) {
+        checksum ^= bytes[i];
+    }
+    return checksum;
+}
+
+// Heartbeat Data Structure; up to LINK_ROW_ENTRIES link row entries may
+// follow it, see communications/link_quality.h
 struct HeartbeatData {
     uint8_t droneId;
     float batteryLevel;
@@ -55,48 +66,132 @@ struct HeartbeatData {
     uint8_t missionState;
 } __attribute__((packed));
 
+// Target Report Data Structure (MSG_TARGET_FOUND)
+struct TargetReportData {
+    uint8_t reporterId;
+    uint16_t targetId;      // Reporter-local id, or fused track id when re-broadcast
+    float latitude;
+    float longitude;
+    uint8_t confidence;     // 0-255 maps to 0.0-1.0
+    uint8_t sensorQuality;  // 0-255 maps to 0.0-1.0
+    uint8_t targetClass;
+} __attribute__((packed));
+
 // Communication Statistics
 struct CommStats {
     uint32_t messagesSent;
     uint32_t messagesReceived;
     uint32_t messagesLost;
+    uint32_t messagesPreempted;     // Aborted on air for an emergency stop
     int lastRSSI;
     float lastSNR;
     uint32_t uptime;
 };
 
-// Communication Interface Class
+class EmergencyStopHandler;
+class SecureLink;
+class ChannelAccess;
+class DutyCycle;
+
+// Communication Interface Class. Every frame goes on air sealed by `link`
+// (see utilities/crypto_utils.h), which also assigns sequence numbers.
 class DroneComm {
 private:
     uint8_t nodeId;
-    uint16_t sequenceCounter;
+    SecureLink* link;
     bool initialized;
     CommStats stats;
+
+    // Emergency fast path: the DIO0 interrupt wakes the emergency task, which
+    // reads the frame out under radioMutex. Stops go straight to the
+    // handler, everything else queues for the main loop
+    EmergencyStopHandler* emergency;
+    struct ReceivedFrame {
+        DroneMessage msg;
+        uint32_t receivedAt;        // When it ended, for schedule sync
+        int rssi;                   // Of this frame, not the newest one
+        float snr;
+    };
+    SpscRing<ReceivedFrame, LORA_RX_QUEUE_SIZE> rxQueue;
+    uint32_t lastReceivedAt;
+    volatile bool txInFlight;
+    // Listen before talk for sendMessage(); emergency frames bypass it
+    ChannelAccess* mac;
+    uint32_t frameAirtimeUs;
+    uint32_t longestAirtimeUs;      // Wake-preamble stop when duty cycling; bounds the TX done wait
+    volatile int8_t cadResult;      // -1 while a CAD is running
+    // Scheduled listening: the radio sleeps between wake windows
+    DutyCycle* schedule;
+    bool radioAsleep;
+#ifdef ARDUINO
+    TaskHandle_t emergencyTask;
+    SemaphoreHandle_t radioMutex;
+    volatile bool radioIrq;         // DIO0 rose; the task has not looked yet
+    static DroneComm* isrInstance;
+
+    static void onDio0Isr();
+    uint8_t readRadioRegister(uint8_t address);
+    void writeRadioRegister(uint8_t address, uint8_t value);
+    void serviceRadio();
+    void receiveFrame();
+    bool senseChannel();
+    bool otherFrameOnAir();
+    static void emergencyTaskLoop(void* param);
+    void sendEmergencyFrame(const DroneMessage& msg, bool wake);
+    void persistEpoch(uint16_t epoch);
+    volatile bool epochDirty;       // seal() wrapped on a send path; store it from serviceEpoch()
+#endif
     
     uint8_t calculateChecksum(const uint8_t* data, size_t length);
     bool validateChecksum(const DroneMessage& msg);
 
 public:
-    DroneComm(uint8_t id);
+    DroneComm(uint8_t id, SecureLink* link);
     
     // Initialization
     bool begin();
     bool isInitialized() const { return initialized; }
+    bool enableEmergencyFastPath(EmergencyStopHandler* handler);
+    // Needs the fast path: CAD completion arrives on the same DIO0 interrupt
+    bool setChannelAccess(ChannelAccess* access);
+    // Also needs the fast path. Stamps the schedule into outgoing link
+    // state, emergency frames get its wake preamble and unicast its polled one
+    bool setDutyCycle(DutyCycle* cycle);
+    void sleepRadio();
+    void wakeRadio();
+    // CAD for a wake preamble; on a hit the radio stays in receive
+    bool sampleChannel();
+    // Energy on the channel while awake: frames that collide still keep a
+    // window open
+    bool channelActive();
+    // How long the CPU may light-sleep before the emergency task has a copy
+    // to send; 0 while a radio event waits for it
+    uint32_t emergencyIdleFor(uint32_t now);
     
     // Message Operations
     bool sendMessage(const DroneMessage& msg);
     bool receiveMessage(DroneMessage& msg);
     bool broadcastMessage(DroneMessageType type, const void* data, uint8_t dataLength);
+    uint16_t triggerEmergencyStop(uint8_t reason);
+    // Main loop: starts and stores the next link epoch before the sequence
+    // wraps, so no send or emergency frame waits on a flash write
+    void serviceEpoch();
     
     // Configuration
     void setTxPower(int power);
+    // False while a frame is on air; try again on the next loop
+    bool setSpreadingFactor(uint8_t sf);
     void setFrequency(long frequency);
     
     // Status & Statistics
+    // Signal of the frame receiveMessage() last returned
     int getRSSI() const;
     float getSNR() const;
     CommStats getStats() const { return stats; }
     uint8_t getNodeId() const { return nodeId; }
+    bool isTransmitting() const { return txInFlight; }
+    // When the frame receiveMessage() last returned ended
+    uint32_t getLastReceivedAt() const { return lastReceivedAt; }
     
     // Utility
     void printStats();
@@ -0,0 +1,163 @@
+#ifndef DUTY_CYCLE_H
+#define DUTY_CYCLE_H
+
+#include "../communications.h"
+#include "../config.h"
+#include "lora_interface.h"
+
+// Scheduled listening. The swarm wakes together once per heartbeat period:
+// a window opens, every node sends its heartbeat and whatever else it has
+// queued, and the window closes once the channel has been quiet for
+// DUTY_IDLE_FRAMES frame times, but not before DUTY_WINDOW_MIN_FRAMES. Both
+// add the MAC jitter, so a neighbour still waiting for its slot is not cut
+// off. In between, the radio and the CPU sleep, except for a CAD every
+// DUTY_SAMPLE_INTERVAL_MS: urgent frames (emergency stops) go out with a
+// preamble longer than that, so a sampling node catches it and stays in
+// receive for the frame, or, should that be lost, for the stop's second
+// copy, which is sent with the plain preamble to such nodes.
+//
+// The samples fall on a grid counted back from the next window, so nodes
+// on one schedule sample together. Unicast does not wait for a window,
+// where a whole period's traffic would meet hidden neighbours at once: it
+// goes out just before a sample with a preamble that spans it, and the
+// receiver stays only until the frame is in. That is the first sample after
+// the span the last window stayed open for, when neighbours' windows may
+// still be sending. Inside a window it takes the plain preamble only during
+// the minimum window, the part every neighbour is sure to listen through.
+//
+// Schedules travel in the link state next to every heartbeat. wakeInMs is
+// stamped just before the frame is sealed and counts from the start of the
+// frame, so a receiver places the sender's next window on its own clock
+// from the frame's arrival less its airtime. A window opening up to half a
+// period before ours pulls ours to it; the earliest schedule in a cluster
+// wins and, once everyone is on it, nobody moves. A node that moves sends
+// one more heartbeat in its old window, so the nodes it leaves behind
+// follow. After boot a node listens for DUTY_SYNC_LISTEN_MS and joins
+// whatever it hears first; once every DUTY_DISCOVERY_PERIODS periods it
+// listens through a whole period to find clusters on other schedules.
+//
+// Like ChannelAccess this only decides; DroneComm sleeps the radio, samples
+// and stamps the link state, and the main loop light-sleeps the CPU.
+// Disabled, it keeps the plain heartbeat timer and never sleeps.
+
+enum DutyAction : uint8_t {
+    DUTY_LISTEN = 0,            // Radio in receive, CPU awake
+    DUTY_SLEEP = 1,             // Both may sleep for nextEventIn()
+    DUTY_SAMPLE = 2             // CAD now, report via onSampled()
+};
+
+struct DutyStats {
+    uint32_t windows;
+    uint32_t awakeMs;           // Listening: windows, sync, discovery and holds
+    uint32_t sleepMs;
+    uint32_t samples;           // CADs between windows
+    uint32_t detections;        // ...that found a preamble
+    uint32_t adoptions;         // Moved to a neighbour's schedule
+    uint32_t inSync;            // Schedules heard within DUTY_SYNC_TOLERANCE_MS
+    uint32_t discoveries;       // Periods listened through
+};
+
+class DutyCycle {
+private:
+    uint8_t nodeId;
+    bool enabled;
+    uint32_t periodMs;
+    uint32_t frameMs;           // One SecureFrame at the current SF
+    uint32_t minWindowMs;
+    uint32_t idleMs;
+    uint32_t sampleUs;          // One CAD
+    uint16_t wakePreamble;      // Symbols, for urgent frames
+    uint32_t holdMs;            // Longest a stop can take to come in once its preamble is sampled
+    uint32_t symbolUs;
+    uint16_t phyPreamble;       // Symbols, in a window
+    uint32_t pollLeadMs;        // Unicast may start this long before a sample: the MAC jitter
+
+    uint32_t nextOpenAt;        // Nominal start of the next window; the guard comes before it
+    uint32_t windowAt;          // ... of the current or last one
+    bool windowOpen;
+    uint32_t busyMs;            // How long the last window stayed open
+    bool heartbeatPending;
+    uint32_t activityAt;
+    uint32_t announceAt;        // One window in the schedule we left
+    bool announcing;
+    uint32_t syncUntil;
+    bool synced;                // Heard or adopted a neighbour's schedule
+    uint32_t discoverUntil;
+    uint16_t periodsToDiscovery;
+    uint32_t holdUntil;         // A preamble was sampled: stay for the frame
+    uint32_t nextSampleAt;
+    uint32_t lastPoll;
+    DutyAction lastAction;
+    DutyStats stats;
+
+    uint32_t opensAt() const;
+    // Every neighbour on our schedule is listening
+    bool inMinWindow(uint32_t now) const;
+    // The sample a unicast frame starting now is aimed at
+    uint32_t pollSample(uint32_t now) const;
+    // Milliseconds until unicast may go, 0 now
+    uint32_t unicastIn(uint32_t now) const;
+    // The first sample on the grid after `after`
+    uint32_t sampleAfter(uint32_t after) const;
+    void advance(uint32_t now);
+    bool listening(uint32_t now) const;
+    void account(uint32_t now, DutyAction action);
+
+public:
+    explicit DutyCycle(uint8_t nodeId);
+
+    // Starts the first window now and, enabled, the sync listen
+    void begin(uint32_t now, bool enable);
+    bool isEnabled() const { return enabled; }
+    // Windows follow the heartbeat period (field tuning can change it)
+    void setPeriod(uint32_t ms);
+    // Window lengths and the urgent preamble follow the spreading factor
+    void setPhy(const LoRaPhyConfig& phy);
+
+    // True once per window, as it opens: send the heartbeat now
+    bool heartbeatDue(uint32_t now);
+    // Regular frames wait for a window; emergency frames never do
+    bool mayTransmit(uint32_t now);
+    // Unicast: in the minimum window, or else once the sample it aims at
+    // is within the MAC jitter, so the frame still starts ahead of it
+    bool mayTransmitUnicast(uint32_t now);
+    // Preamble symbols for a regular frame starting now: the PHY's own in a
+    // window (for unicast, the minimum window), else enough to span the
+    // neighbours' sample it aims at
+    uint16_t preambleFor(uint32_t now, bool unicast) const;
+    DutyAction poll(uint32_t now);
+    // Milliseconds until poll() may answer differently, or with unicast
+    // queued until mayTransmitUnicast() turns true
+    uint32_t nextEventIn(uint32_t now, bool unicastQueued = false) const;
+    void onSampled(bool detected, uint32_t now);
+    // Frames heard or sent, or energy on the channel, keep a window open
+    void onActivity(uint32_t now);
+    // A whole frame came in: as onActivity(), and a sampled preamble has
+    // delivered what it announced
+    void onFrame(uint32_t now);
+
+    // A neighbour's link state; receivedAt is when its frame ended
+    void onSchedule(uint16_t wakeInMs, uint32_t receivedAt, uint32_t now);
+    // Writes wakeInMs into the frame's link state record, if it has one;
+    // call right before sealing
+    void stamp(DroneMessage& frame, uint32_t now) const;
+    // What stamp() writes: until the next window opens, 1..period; 0 disabled
+    uint16_t wakeIn(uint32_t now) const;
+
+    uint16_t getWakePreamble() const { return wakePreamble; }
+    uint32_t getPeriodMs() const { return periodMs; }
+    uint32_t getMinWindowMs() const { return minWindowMs; }
+    uint32_t getIdleMs() const { return idleMs; }
+    uint32_t getSampleUs() const { return sampleUs; }
+    uint32_t getSymbolUs() const { return symbolUs; }
+    uint32_t getPollLeadMs() const { return pollLeadMs; }
+    bool isSynced() const { return synced; }
+
+    // Average supply current over the time accounted so far, radio receive
+    // and CPU; transmissions come on top
+    float estimatedCurrentMa() const;
+    DutyStats getStats() const { return stats; }
+    void resetStats();
+};
+
+#endif // DUTY_CYCLE_H
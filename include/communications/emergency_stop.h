@@ -0,0 +1,147 @@
+#ifndef EMERGENCY_STOP_H
+#define EMERGENCY_STOP_H
+
+#include "../communications.h"
+#include "../config.h"
+#include "../coordination/state_machine.h"
+#include "lora_interface.h"
+
+// Emergency-stop flooding. onFrame() runs in a high-priority radio task
+// that the LoRa DIO0 interrupt wakes: it validates the frame, latches the
+// stop in the mission state machine and schedules a relay. Relays and
+// repeats are handed out by pollTransmit() to the same task, which aborts
+// any in-flight frame to send them. Neighbours that hear the same copy would otherwise
+// relay together and collide, so each relay waits a random number of whole
+// frame slots, and one that finds the channel busy when its slot comes
+// moves back a slot. Stops are deduplicated on (origin, stopId), so the
+// flood dies out on its own.
+//
+// With duty cycling a copy takes the wake preamble, and its slots are that
+// long, except for a node's second copy: it goes with the plain preamble,
+// in plain-frame slots, to the neighbours that sampled the first copy's
+// preamble and are still holding for a frame they lost (DutyCycle).
+//
+// Every copy a neighbour sends is its echo: it has the stop. A node sends
+// EMERGENCY_STOP_REPEATS copies, and keeps repeating (up to
+// EMERGENCY_STOP_MAX_REPEATS) while a neighbour it has heard from recently
+// has not echoed, so a node that lost every copy to collisions is not left
+// waiting for its own heartbeat to be heard. Repeats are skipped once every
+// live neighbour has echoed, or, with no neighbours known yet, once the
+// neighbourhood is already echoing. A stopped node that hears a heartbeat
+// from a neighbour still flying announces the stop once more.
+
+enum EmergencyStopReason : uint8_t {
+    ESTOP_REASON_OPERATOR = 1,
+    ESTOP_REASON_LOW_BATTERY = 2,
+    ESTOP_REASON_GEOFENCE = 3,
+    ESTOP_REASON_LINK_LOST = 4
+};
+
+struct EmergencyStopData {
+    uint8_t originId;
+    uint16_t stopId;            // Per-origin counter
+    uint8_t hopCount;
+    uint8_t reason;
+} __attribute__((packed));
+
+enum EmergencyRxResult : uint8_t {
+    ESTOP_NOT_A_STOP = 0,
+    ESTOP_INVALID = 1,
+    ESTOP_APPLIED = 2,          // First copy: stop latched, relay scheduled
+    ESTOP_DUPLICATE = 3
+};
+
+struct EmergencyStopStats {
+    uint32_t triggered;
+    uint32_t received;
+    uint32_t applied;
+    uint32_t duplicates;
+    uint32_t invalid;
+    uint32_t transmitted;
+    uint32_t suppressed;
+    uint32_t reannounced;
+    uint32_t deferred;          // Slot found busy, moved back one slot
+};
+
+class EmergencyStopHandler {
+private:
+    struct StopEntry {
+        uint8_t originId;
+        uint16_t stopId;
+        uint8_t hopCount;           // As received; relays send hopCount + 1
+        uint8_t reason;
+        uint8_t sent;
+        uint8_t heardSinceSend;
+        uint8_t deferrals;          // For the copy now due
+        uint16_t echoed;            // Bit per neighbours[] slot that has sent this stop
+        uint32_t nextTxAt;
+        bool pending;
+        bool used;
+    };
+
+    struct Neighbour {
+        uint8_t id;
+        uint32_t heardAt;
+        bool used;
+    };
+
+    uint8_t selfId;
+    uint16_t nextStopId;
+    uint16_t sequence;
+    MissionStateMachine* mission;
+    StopEntry entries[EMERGENCY_DEDUP_ENTRIES];
+    Neighbour neighbours[EMERGENCY_NEIGHBOURS];
+    uint8_t nextEntry;
+    int8_t latestEntry;         // Most recent stop latched here, -1 if none
+    uint32_t rngState;
+    uint16_t slotMs;            // One stop frame on air plus guard, wake preamble and all
+    uint16_t plainSlotMs;       // ...with the PHY's own preamble: the second copy
+    EmergencyStopStats stats;
+
+    uint32_t relayDelay(uint16_t slot);
+    StopEntry* find(uint8_t originId, uint16_t stopId);
+    StopEntry* allocate();
+    uint16_t noteNeighbour(uint8_t id, uint32_t now);      // Returns its echo bit
+    uint16_t liveNeighbours(uint32_t now) const;
+
+public:
+    EmergencyStopHandler(uint8_t selfId, MissionStateMachine* mission);
+
+    // Neighbours must not share a slot sequence; seed from esp_random() on device
+    void seed(uint32_t value);
+
+    // Follow PHY changes (spreading factor) so slots stay one frame long.
+    // With duty cycling, copies but the second take the wake preamble
+    void setPhy(const LoRaPhyConfig& phy, uint16_t wakePreamble = 0);
+    uint32_t getRelayWindowMs() const { return (EMERGENCY_RELAY_SLOTS - 1) * slotMs; }
+
+    // Stop ids must keep rising across resets: neighbours that still hold
+    // (origin, stopId) would drop a reused id as a duplicate
+    uint16_t getNextStopId() const { return nextStopId; }
+    void setNextStopId(uint16_t id) { nextStopId = id ? id : 1; }
+
+    // Local stop (operator command, failsafe); first broadcast is due at once
+    uint16_t trigger(uint8_t reason, uint32_t now);
+
+    // ISR-safe: no allocation, no logging
+    EmergencyRxResult onFrame(const uint8_t* raw, size_t length, uint32_t now);
+
+    // ISR-safe: neighbour heartbeat. Returns true when a re-announce was
+    // scheduled for a peer that missed the stop.
+    bool onPeerHeartbeat(uint8_t peerId, uint8_t peerMissionState, uint32_t now);
+
+    // Next relay/repeat due at or before now. channelBusy: someone else's
+    // frame is on air, so a copy sent now would collide with it. wake: this
+    // copy takes the wake preamble
+    bool pollTransmit(uint32_t now, DroneMessage& out, bool channelBusy = false, bool* wake = nullptr);
+    uint32_t nextTransmitIn(uint32_t now);      // UINT32_MAX when idle
+    bool hasPending();
+
+    EmergencyStopStats getStats() const { return stats; }
+
+    static bool isEmergencyFrame(const uint8_t* raw, size_t length) {
+        return length == sizeof(DroneMessage) && raw[0] == MSG_EMERGENCY_STOP;
+    }
+};
+
+#endif // EMERGENCY_STOP_H
@@ -0,0 +1,139 @@
+#ifndef LINK_QUALITY_H
+#define LINK_QUALITY_H
+
+#include "../communications.h"
+#include "../config.h"
+
+// Passive link estimation from the traffic a node overhears anyway, with
+// no probe frames. Every sealed frame carries the sender's next sequence
+// number (SecureLink), so the gaps in the numbers heard from a neighbour
+// count the frames of its that never arrived here, whatever their type
+// or destination. Per neighbour this keeps an EWMA of RSSI and SNR
+// per frame heard, and an EWMA of the packet reception ratio per window of
+// LINK_WINDOW_HEARTBEATS heartbeat intervals. A window with nothing at all
+// from a neighbour counts its heartbeats as lost; when the neighbour is
+// heard again, the gap is credited with what was already counted.
+//
+// That gives the receiving end of each link. The sending end, and links
+// two hops out, come from the neighbours: each heartbeat carries a slice
+// of its sender's row of the link matrix, LINK_ROW_ENTRIES entries of two
+// bytes in rotation, which still fits the heartbeat's batch frame next to
+// the link state. Frames are always a full SecureFrame, so the row costs
+// no airtime. Rows are kept per neighbour and dropped with it.
+//
+// Directions: link(receiver, source) is the share of source's frames that
+// receiver hears. Our own row is link(self, n); a neighbour's row gives
+// link(n, x), including link(n, self), our outbound delivery to it.
+
+// One entry of a shared row: the reporter's link from `id`
+struct LinkRowEntry {
+    uint8_t id;
+    uint8_t quality;            // Reception ratio in the high nibble, SNR in the low
+} __attribute__((packed));
+
+#define LINK_ROW_MAX_BYTES (LINK_ROW_ENTRIES * sizeof(LinkRowEntry))
+
+// Reception ratio in fifteenths, SNR in LINK_ROW_SNR_STEP_DB steps from
+// LINK_ROW_SNR_MIN_DB; both clamp
+uint8_t linkQualityPack(float prr, float snr);
+inline float linkQualityPrr(uint8_t quality) {
+    return (quality >> 4) / 15.0f;
+}
+inline float linkQualitySnr(uint8_t quality) {
+    return LINK_ROW_SNR_MIN_DB + (quality & 0x0F) * LINK_ROW_SNR_STEP_DB;
+}
+
+// What we know about one directed link
+struct LinkView {
+    float prr;
+    float snr;
+    bool measured;              // Our own estimate, rather than a neighbour's report
+    uint32_t updatedAt;
+};
+
+struct LinkNeighbour {
+    uint8_t id;
+    bool prrValid;              // A window has closed with frames expected
+    uint16_t lastSequence;
+    float rssi;                 // EWMAs over the frames heard
+    float snr;
+    float prr;
+    uint16_t windowHeard;
+    uint16_t windowLost;
+    uint16_t creditedLost;      // Counted for silent windows, not yet seen as a gap
+    uint32_t framesHeard;
+    uint32_t framesLost;
+    uint32_t lastHeard;
+    // Its row as reported: how well it hears its own neighbours
+    uint8_t rowCount;
+    LinkRowEntry row[LINK_MAX_NEIGHBOURS];
+    uint32_t rowUpdatedAt[LINK_MAX_NEIGHBOURS];
+};
+
+struct LinkQualityStats {
+    uint32_t framesHeard;
+    uint32_t framesLost;        // Inferred from sequence gaps and silent windows
+    uint32_t restarts;          // Sequence jumps taken as a neighbour restarting
+    uint32_t rowsHeard;
+    uint32_t rowEntriesSent;
+    uint32_t evictions;         // Table full: the stalest neighbour made room
+};
+
+class LinkQualityTable {
+private:
+    struct Slot {
+        bool used;
+        LinkNeighbour n;
+    };
+
+    uint8_t nodeId;
+    Slot slots[LINK_MAX_NEIGHBOURS];
+    uint32_t heartbeatIntervalMs;
+    uint32_t windowStart;
+    uint8_t rowCursor;
+    LinkQualityStats stats;
+
+    LinkNeighbour* findNeighbour(uint8_t id);
+    LinkNeighbour* allocate(uint8_t id, uint32_t now);
+    void closeWindow(LinkNeighbour& n);
+    bool reported(uint8_t receiver, uint8_t source, LinkView& out) const;
+
+public:
+    explicit LinkQualityTable(uint8_t nodeId);
+
+    // Every frame that opened and checked, before dispatch: batch, relayed
+    // and unicast frames for other nodes all count
+    void onFrame(uint8_t sourceId, uint16_t sequence, int16_t rssi, float snr, uint32_t now);
+    // The row tail of a heartbeat from `reporter` (after HeartbeatData)
+    void onRow(uint8_t reporter, const uint8_t* data, uint8_t length, uint32_t now);
+
+    // Call every loop: closes windows and forgets silent neighbours
+    void update(uint32_t now);
+
+    // Next slice of our row for an outgoing heartbeat; returns entries written
+    uint8_t fillRow(LinkRowEntry* out, uint8_t maxEntries);
+
+    // Windows follow the heartbeat period (field tuning can change it)
+    void setHeartbeatInterval(uint32_t ms);
+
+    // link(receiver, source), ours or as a neighbour reported it; false if unknown
+    bool link(uint8_t receiver, uint8_t source, LinkView& out) const;
+    // Expected transmissions for one delivery and its ack between a and b,
+    // 1 / (prr(a->b) * prr(b->a)): the routing metric. INFINITY if a
+    // direction is unknown or dead.
+    float etx(uint8_t a, uint8_t b) const;
+    // Sum of both-way reception over node's links that are known here: the
+    // expected number of neighbours it can exchange frames with. Leader
+    // election ranks candidates on it.
+    float linkScore(uint8_t node) const;
+
+    const LinkNeighbour* find(uint8_t id) const;
+    uint8_t size() const;
+    // Neighbour in `slot` (0..LINK_MAX_NEIGHBOURS-1), nullptr if the slot is free
+    const LinkNeighbour* at(uint8_t slot) const { return slots[slot].used ? &slots[slot].n : nullptr; }
+
+    LinkQualityStats getStats() const { return stats; }
+    void resetStats();
+};
+
+#endif // LINK_QUALITY_H
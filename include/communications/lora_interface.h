@@ -0,0 +1,251 @@
+#ifndef LORA_INTERFACE_H
+#define LORA_INTERFACE_H
+
+#include "../communications.h"
+#include "../config.h"
+
+// LoRa PHY helpers shared by the radio driver and the host simulator
+
+struct LoRaPhyConfig {
+    uint8_t spreadingFactor;    // 6-12
+    uint32_t bandwidthHz;
+    uint8_t codingRate;         // Denominator: 5-8 for 4/5..4/8
+    uint16_t preambleLength;
+    bool explicitHeader;
+    bool crcOn;
+};
+
+// Matches the DroneComm::begin() radio settings
+LoRaPhyConfig loraDefaultPhy();
+
+uint32_t loraSymbolTimeUs(const LoRaPhyConfig& phy);
+
+// Time on air per Semtech AN1200.13
+uint32_t loraAirtimeUs(const LoRaPhyConfig& phy, uint8_t payloadBytes);
+
+// Lowest SNR a spreading factor still demodulates (SX1276 datasheet)
+float loraSnrFloorDb(uint8_t spreadingFactor);
+
+// Thermal noise over the channel plus the receiver noise figure
+float loraNoiseFloorDbm(const LoRaPhyConfig& phy);
+
+// Supply current while transmitting on PA_BOOST at a power setting
+float loraTxCurrentMa(int8_t powerDbm);
+
+// Adaptive data rate (MSG_LINK_STATE). Every node sends this next to its
+// heartbeat, so it normally shares the heartbeat's batch frame.
+struct LinkStateData {
+    int8_t txPowerDbm;          // Power this frame went out at
+    uint8_t requiredSf;         // Slowest SF any link within requiredHops needs
+    uint8_t requiredHops;
+    uint8_t planEpoch;          // Latest swarm-wide SF change the sender knows
+    uint8_t planSf;
+    uint16_t planInMs;          // Until that change; 0 once it has happened
+    uint16_t wakeInMs;          // Until the sender's next wake window, from the start of this frame;
+                                // 0 if it never sleeps (see communications/duty_cycle.h)
+} __attribute__((packed));
+
+struct AdrStats {
+    uint32_t plansProposed;
+    uint32_t plansAdopted;      // Learned from a neighbour
+    uint32_t sfChanges;
+    uint32_t powerChanges;
+    uint32_t scans;             // Went silent and searched the other SFs
+};
+
+// Chooses the spreading factor and TX power from each neighbour's smoothed
+// SNR. Links are assumed reciprocal: a neighbour's SNR at us, less the power
+// it sent at, predicts our SNR at it for any power we pick. The margin is
+// taken from the EWMA minus ADR_DEVIATION_WEIGHT mean deviations, so a
+// fading link keeps more headroom than a steady one.
+//
+// Power is per node: the lowest that leaves every neighbour ADR_MARGIN_DB
+// above the current SF's floor. It rises at once and falls at most
+// ADR_POWER_STEP_DB per heartbeat interval; a neighbour that goes quiet
+// puts us back on full power until it is forgotten, so a cut that loses a
+// link also restores it.
+//
+// Different spreading factors do not hear each other, so the SF is
+// swarm-wide. Each node works out the SF with the least transmit energy per
+// neighbour it reaches; a slower one has to beat the faster by
+// ADR_SLOWER_SF_GAIN, since every node pays its airtime. It advertises that
+// SF and relays the slowest it has heard, with a hop count that bounds how long a
+// stale value circulates. Whoever sees the requirement above the current SF
+// (or below it for ADR_SETTLE_MS) proposes a change ADR_SWITCH_LEAD_MS
+// ahead; proposals flood in the link state and everybody switches at the
+// same moment. Conflicting proposals resolve to the newer epoch, then the
+// slower SF. A node that misses a switch hears nothing afterwards and scans
+// the SFs until it finds the swarm again.
+class AdrController {
+private:
+    struct Neighbour {
+        bool used;
+        uint8_t id;
+        uint8_t samples;
+        float snrEwma;          // Normalised to a 0 dBm transmitter
+        float snrDeviation;
+        uint8_t requiredSf;     // As advertised
+        uint8_t requiredHops;
+        uint32_t lastHeard;
+    };
+
+    uint8_t nodeId;
+    Neighbour neighbours[ADR_MAX_NEIGHBOURS];
+    float noiseFloorDbm;
+    uint32_t airtimeUs[ADR_MAX_SF - ADR_MIN_SF + 1];    // One frame per SF
+
+    uint8_t sf;
+    int8_t powerDbm;
+    int8_t maxPowerDbm;         // ADR_MAX_TX_POWER_DBM unless tuned lower
+    uint8_t requiredSf;
+    uint8_t requiredHops;
+
+    uint8_t epoch;
+    bool planPending;
+    uint8_t planSf;
+    uint32_t switchAt;
+
+    uint32_t lastSwitchAt;
+    uint32_t lastPowerCut;
+    bool belowCurrent;          // Requirement under the current SF...
+    uint32_t belowSince;        // ...continuously since
+    bool heardAny;
+    uint32_t lastHeardAt;
+    bool scanning;
+    uint32_t scanStepAt;
+    bool changed;
+    AdrStats stats;
+
+    Neighbour* find(uint8_t id, uint32_t now);
+    float linkSnr(const Neighbour& n) const;
+    uint8_t cheapestSf(uint32_t now) const;
+    int8_t powerFor(uint8_t spreadingFactor, uint32_t now) const;
+    void computeRequirement(uint32_t now);
+    void propose(uint8_t target, uint32_t now);
+    void setSf(uint8_t next, uint32_t now);
+    void setPower(int8_t next, uint32_t now);
+
+public:
+    explicit AdrController(uint8_t nodeId);
+
+    // A neighbour's link state, with the RSSI/SNR of the frame it came in
+    void onLinkState(uint8_t from, const LinkStateData& state, int16_t rssi, float snr, uint32_t now);
+
+    // Call every loop. Returns true when the SF or power changed; push them
+    // to the radio (DroneComm::setSpreadingFactor, setTxPower).
+    bool update(uint32_t now);
+
+    void fillLinkState(LinkStateData& out, uint32_t now) const;
+
+    // Warm restart: back on the swarm's SF as if a neighbour had just been
+    // heard, so a stale SF ends in a scan. Power starts at full until the
+    // neighbours are measured again.
+    void resume(uint8_t spreadingFactor, uint8_t planEpoch, uint32_t now);
+
+    // Field tuning: a lower power ceiling, e.g. for a local EIRP limit. SF
+    // requirements are worked out against it too.
+    void setMaxTxPower(int8_t dbm, uint32_t now);
+
+    uint8_t getSpreadingFactor() const { return sf; }
+    int8_t getTxPowerDbm() const { return powerDbm; }
+    int8_t getMaxTxPowerDbm() const { return maxPowerDbm; }
+    uint8_t getRequiredSf() const { return requiredSf; }
+    uint8_t getPlanEpoch() const { return epoch; }
+    bool isPlanPending() const { return planPending; }
+    uint8_t getPlannedSf() const { return planPending ? planSf : sf; }
+    bool isScanning() const { return scanning; }
+    uint8_t neighbourCount(uint32_t now) const;
+
+    AdrStats getStats() const { return stats; }
+    void resetStats();
+};
+
+// Listen-before-talk channel access. A frame that is ready first waits a
+// random jitter of 0..MAC_JITTER_SLOTS-1 slots; a slot is one CAD plus the
+// turnaround to transmit. Then the channel is sensed: an RSSI energy check
+// first, since a CAD aborts any reception in progress, then the CAD. A busy
+// channel means a binary exponential backoff and another check; after
+// MAC_MAX_ATTEMPTS the frame is dropped. Before sensing, a token bucket
+// holds the node to MAX_MESSAGE_RATE_PER_SEC frames and its airtime to
+// MAX_BANDWIDTH_USAGE_PERCENT of MAC_DUTY_WINDOW_MS.
+//
+// Like EmergencyStopHandler this only decides; the caller senses, sends and
+// reports back. Emergency stops bypass it. Channel utilisation is measured
+// over MAC_UTILIZATION_WINDOW_MS from our own frames and every frame heard.
+
+enum MacAction : uint8_t {
+    MAC_IDLE = 0,               // Nothing pending (or the frame was dropped)
+    MAC_WAIT = 1,               // Call poll() again after nextActionIn()
+    MAC_SENSE = 2,              // Check the channel, report via onChannelSensed()
+    MAC_TRANSMIT = 3            // Clear: send now, then onTransmitted()
+};
+
+struct MacStats {
+    uint32_t requested;
+    uint32_t sent;
+    uint32_t dropped;           // Channel stayed busy for MAC_MAX_ATTEMPTS checks
+    uint32_t channelChecks;
+    uint32_t channelBusy;
+    uint32_t rateDeferrals;     // Frames held back by MAX_MESSAGE_RATE_PER_SEC
+    uint32_t dutyDeferrals;     // ... by MAX_BANDWIDTH_USAGE_PERCENT
+    uint32_t totalAccessDelayMs;    // Request to transmit, summed over sent frames
+    uint32_t maxAccessDelayMs;
+};
+
+class ChannelAccess {
+private:
+    enum State : uint8_t { IDLE, WAITING, SENSING, CLEAR };
+
+    uint8_t nodeId;
+    State state;
+    uint8_t attempts;
+    uint8_t deferred;           // Current frame already counted: bit 0 rate, bit 1 duty
+    uint32_t requestedAt;
+    uint32_t readyAt;
+    uint16_t slotMs;
+    uint32_t frameAirtimeUs;
+    uint32_t rngState;
+
+    // Token buckets, refilled on every call
+    uint32_t rateTokens;        // Thousandths of a frame
+    uint32_t airtimeTokensUs;
+    uint32_t lastRefill;
+
+    uint32_t windowStart;
+    uint32_t windowBusyUs;
+    uint32_t windowOwnUs;
+    float utilization;          // Last complete window, percent
+    float ownUtilization;
+    MacStats stats;
+
+    uint32_t nextRandom();
+    void refill(uint32_t now);
+    void rollWindow(uint32_t now);
+    void addBusy(uint32_t airtimeUs, bool own, uint32_t now);
+
+public:
+    explicit ChannelAccess(uint8_t nodeId);
+    void seed(uint32_t value);
+    // Slot length and the airtime budgeted per frame
+    void setPhy(const LoRaPhyConfig& phy);
+
+    // One frame at a time; false while the previous one is still pending
+    bool request(uint32_t now);
+    MacAction poll(uint32_t now);
+    MacAction onChannelSensed(bool busy, uint32_t now);
+    void onTransmitted(uint32_t airtimeUs, uint32_t now);
+    // Another node's frame, for utilisation
+    void onFrameHeard(uint32_t airtimeUs, uint32_t now);
+
+    bool pending() const { return state != IDLE; }
+    // Milliseconds until poll() has something new, UINT32_MAX when idle
+    uint32_t nextActionIn(uint32_t now) const;
+    uint16_t getSlotMs() const { return slotMs; }
+
+    float getChannelUtilization() const { return utilization; }
+    float getOwnUtilization() const { return ownUtilization; }
+    MacStats getStats() const { return stats; }
+    void resetStats();
+};
+
+#endif // LORA_INTERFACE_H
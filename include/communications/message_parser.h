@@ -0,0 +1,173 @@
+#ifndef MESSAGE_PARSER_H
+#define MESSAGE_PARSER_H
+
+#include "../communications.h"
+#include "../config.h"
+
+#ifndef ARDUINO
+#define IRAM_ATTR
+#endif
+
+// MSG_BATCH payload: back-to-back records of
+//   type (1 byte) | length (1 byte) | payload (length bytes)
+// All records share the frame's source, destination, timestamp and link
+// sequence number. Emergency stops and batches are never batched, so a
+// record of either type marks the frame malformed.
+
+#define BATCH_RECORD_HEADER 2
+
+// Walks the records of a MSG_BATCH frame in place. Stops at the first
+// malformed record; the ones before it are still returned.
+class BatchReader {
+private:
+    const DroneMessage& frame;
+    uint8_t offset;
+    bool bad;
+
+public:
+    explicit BatchReader(const DroneMessage& frame)
+        : frame(frame), offset(0), bad(frame.messageType != MSG_BATCH || frame.dataLength > sizeof(frame.data)) {}
+
+    // Zero-copy: `payload` points into the frame. ISR-safe.
+    bool next(uint8_t& type, const uint8_t*& payload, uint8_t& length) {
+        if (bad || offset >= frame.dataLength) {
+            return false;
+        }
+        if (frame.dataLength - offset < BATCH_RECORD_HEADER) {
+            bad = true;
+            return false;
+        }
+        type = frame.data[offset];
+        length = frame.data[offset + 1];
+        if (length > frame.dataLength - offset - BATCH_RECORD_HEADER ||
+            type == MSG_BATCH || type == MSG_EMERGENCY_STOP) {
+            bad = true;
+            return false;
+        }
+        payload = &frame.data[offset + BATCH_RECORD_HEADER];
+        offset += BATCH_RECORD_HEADER + length;
+        return true;
+    }
+
+    // The record as a standalone message carrying the frame's header fields
+    bool next(DroneMessage& out);
+
+    bool malformed() const { return bad; }
+};
+
+// ISR-safe: first record of `type` in a batch, e.g. a heartbeat riding
+// with other traffic
+inline bool IRAM_ATTR batchFindRecord(const DroneMessage& frame, uint8_t type,
+                                      const uint8_t*& payload, uint8_t& length) {
+    BatchReader reader(frame);
+    uint8_t recordType;
+    while (reader.next(recordType, payload, length)) {
+        if (recordType == type) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Splits a received frame into logical messages. A plain frame comes back
+// as itself. Returns the number written to `out`.
+uint8_t splitBatch(const DroneMessage& frame, DroneMessage* out, uint8_t maxMessages);
+
+// MSG_FEC payload: FecHeader, then one FEC_SYMBOL_BYTES symbol. A message
+// too long for one frame is cut into `dataFrames` symbols (the last one
+// zero-padded) and sent as that many data frames plus any number of parity
+// frames, all with the same group number. The code is a systematic
+// Reed-Solomon code over GF(2^8) built from a Cauchy matrix, so any
+// `dataFrames` distinct frames of a group rebuild the message, whichever
+// were lost. The first parity frame is the plain XOR of the data frames.
+// Every frame of a group carries the encode time as its timestamp, which
+// keeps groups apart across a sender reboot. Meant for broadcasts, where per-receiver acks do not scale: the sender
+// picks the parity count for the loss it expects (MessageSender::encodeFec).
+
+struct FecHeader {
+    uint8_t type;               // Inner message type
+    uint8_t group;              // Per sender, wraps
+    uint8_t index;              // < dataFrames: data symbol; above: parity row index - dataFrames
+    uint8_t dataFrames;
+    uint16_t length;            // Message bytes
+} __attribute__((packed));
+
+#define FEC_SYMBOL_BYTES ((uint8_t)(sizeof(((DroneMessage*)0)->data) - sizeof(FecHeader)))
+#define FEC_MAX_MESSAGE (FEC_MAX_DATA_FRAMES * FEC_SYMBOL_BYTES)
+
+// GF(2^8) arithmetic, table-driven (log/exp over the 0x11D polynomial)
+uint8_t fecMul(uint8_t a, uint8_t b);
+uint8_t fecInverse(uint8_t a);              // a != 0
+// Coefficient of data symbol `column` in parity row `row`; row 0 is all ones
+uint8_t fecParityCoefficient(uint8_t row, uint8_t column);
+// dst ^= coefficient * src, bytewise. Vectorized on host; the scalar form is
+// the reference.
+void fecMulAdd(uint8_t* dst, const uint8_t* src, uint8_t coefficient, uint16_t length);
+void fecMulAddScalar(uint8_t* dst, const uint8_t* src, uint8_t coefficient, uint16_t length);
+
+// A rebuilt message; `data` stays valid until the decoder's next add()
+struct FecMessage {
+    uint8_t type;
+    uint8_t sourceId;
+    uint8_t destinationId;
+    uint32_t timestamp;         // Of the frame that completed the group
+    uint16_t length;
+    const uint8_t* data;
+};
+
+enum FecRxResult : uint8_t {
+    FEC_IGNORED = 0,            // Not MSG_FEC, or malformed
+    FEC_PENDING = 1,            // Stored; the group needs more frames
+    FEC_COMPLETE = 2,           // `out` holds the message
+    FEC_REDUNDANT = 3           // The group is already complete, or a duplicate
+};
+
+struct FecStats {
+    uint32_t frames;            // MSG_FEC frames accepted
+    uint32_t redundant;
+    uint32_t completed;         // Groups rebuilt
+    uint32_t recovered;         // Data frames that never arrived but were rebuilt
+    uint32_t expired;           // Groups dropped incomplete
+    uint32_t malformed;
+};
+
+// Collects MSG_FEC frames from any number of senders, FEC_DECODE_GROUPS
+// groups at a time; a new group takes the slot of the oldest. A finished
+// group is remembered until it times out so its late parity frames are
+// recognised as redundant.
+class FecDecoder {
+private:
+    struct Group {
+        bool used;
+        bool complete;
+        uint8_t sourceId;
+        uint8_t group;
+        uint32_t timestamp;
+        uint8_t type;
+        uint8_t dataFrames;
+        uint16_t length;
+        uint32_t firstHeardAt;
+        uint16_t haveData;          // Bit i: data symbol i received
+        uint8_t haveParity;         // Bit i: parity row i received
+        uint8_t symbols[FEC_MAX_DATA_FRAMES][FEC_SYMBOL_BYTES];
+        uint8_t parity[FEC_MAX_PARITY_FRAMES][FEC_SYMBOL_BYTES];
+    };
+
+    Group groups[FEC_DECODE_GROUPS];
+    FecStats stats;
+
+    Group* findGroup(uint8_t sourceId, uint8_t group, uint32_t timestamp);
+    void rebuild(Group& group);
+
+public:
+    FecDecoder();
+
+    FecRxResult add(const DroneMessage& frame, uint32_t now, FecMessage& out);
+    // Drops incomplete groups older than FEC_GROUP_TIMEOUT_MS
+    void expire(uint32_t now);
+
+    FecStats getStats() const { return stats; }
+    void resetStats();
+};
+
+#endif // MESSAGE_PARSER_H
@@ -0,0 +1,84 @@
+#ifndef MESSAGE_SENDER_H
+#define MESSAGE_SENDER_H
+
+#include "../communications.h"
+#include "../config.h"
+#include "message_parser.h"
+
+// Outgoing aggregation. Every LoRa frame costs the same airtime whatever
+// its dataLength (preamble, header, the full DroneMessage and the link
+// overhead), so small logical messages to the same destination are held for
+// up to a latency budget (BATCH_MAX_DELAY_MS by default) and packed into
+// one MSG_BATCH frame (see message_parser.h). A batch is due when its
+// oldest message reaches the budget or the next message does not fit. A due
+// batch stays open until it is polled, so a caller that only polls while
+// the radio is free gets larger batches exactly when the channel is busy. A batch that ends up holding a
+// single message is sent as that plain message, so receivers that do not
+// split batches still understand it. Like StatusService this only builds
+// frames; the caller sends them.
+
+struct BatchStats {
+    uint32_t queued;            // Logical messages accepted
+    uint32_t rejected;          // Not batchable: caller sent them directly
+    uint32_t frames;            // Frames built
+    uint32_t batchFrames;       // Of those, MSG_BATCH with 2+ records
+    uint32_t totalDelayMs;      // Queue to frame build, summed over messages
+    uint32_t maxDelayMs;
+    uint32_t fecGroups;         // Messages sent erasure-coded
+    uint32_t fecParityFrames;
+};
+
+class MessageSender {
+private:
+    struct Batch {
+        bool used;
+        bool closed;                // Full: goes out on the next poll
+        uint8_t destination;
+        uint8_t records;
+        uint8_t length;
+        uint32_t firstQueuedAt;
+        uint32_t offsetSumMs;       // Sum of (queuedAt - firstQueuedAt), for delay stats
+        uint8_t data[sizeof(((DroneMessage*)0)->data)];
+    };
+
+    uint8_t nodeId;
+    uint32_t maxDelayMs;
+    uint8_t fecGroup;
+    Batch batches[BATCH_SLOTS];
+    BatchStats stats;
+
+    Batch* openBatch(uint8_t destination);
+    Batch* freeBatch();
+    void build(Batch& batch, uint32_t now, DroneMessage& out);
+
+public:
+    explicit MessageSender(uint8_t nodeId, uint32_t maxDelayMs = BATCH_MAX_DELAY_MS);
+
+    // Queues one logical message. Returns false when it cannot be batched
+    // (too large, an emergency stop, or every slot busy); send it directly.
+    bool queue(uint8_t destination, uint8_t type, const void* payload, uint8_t length, uint32_t now);
+
+    // Writes frames that are due into `out`, oldest first. Call when the
+    // radio can take them.
+    uint8_t poll(uint32_t now, DroneMessage* out, uint8_t maxFrames);
+    // Everything queued, due or not (e.g. before sleeping)
+    uint8_t flush(uint32_t now, DroneMessage* out, uint8_t maxFrames);
+
+    // Optional FEC mode for messages longer than a frame, typically
+    // broadcasts: writes the data frames, then `parityFrames` parity frames,
+    // as one MSG_FEC group (see message_parser.h). Any `parityFrames` of
+    // them may be lost. Returns the frame count, 0 when the message is too
+    // long, the type cannot be coded, or `out` is too small. Not queued: the
+    // caller sends the frames straight away.
+    uint8_t encodeFec(uint8_t destination, uint8_t type, const void* payload, uint16_t length,
+                      uint8_t parityFrames, uint32_t now, DroneMessage* out, uint8_t maxFrames);
+
+    // Milliseconds until poll() has something, UINT32_MAX when idle
+    uint32_t nextDueIn(uint32_t now) const;
+    uint8_t pending() const;
+
+    BatchStats getStats() const { return stats; }
+    void resetStats();
+};
+
+#endif // MESSAGE_SENDER_H
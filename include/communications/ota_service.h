@@ -0,0 +1,253 @@
+#ifndef OTA_SERVICE_H
+#define OTA_SERVICE_H
+
+#include "../communications.h"
+#include "../config.h"
+#include "../utilities/crypto_utils.h"
+#include "../utilities/flight_recorder.h"
+
+#ifndef ARDUINO
+#include <vector>
+#endif
+
+// Over-the-air updates spread drone to drone (MSG_OTA), after Deluge: one
+// node holding an update is enough, every drone that has part of it serves
+// that part to its neighbours, and a drone pulls only the chunks it is
+// missing, from whichever neighbour has them.
+//
+// An update is a delta file (tools/deployment/ota_delta.py): an
+// OtaManifest, then COPY and INSERT ops that rebuild the new image from
+// the running one. The file is cut into OTA_CHUNK_BYTES chunks and
+// OTA_PAGE_CHUNKS-chunk pages, and each drone completes the pages in
+// order:
+//   - Every node advertises (version, delta length, pages complete) on a
+//     Trickle timer: quickly after anything changes, backing off towards
+//     OTA_TRICKLE_MAX_MS while the neighbours agree, and not at all in an
+//     interval in which OTA_TRICKLE_REDUNDANCY neighbours already said the
+//     same thing. A newer version replaces whatever was in progress.
+//   - A node that hears a neighbour with more pages asks it for its next
+//     page, with a bitmap of the chunks still missing. A request overheard
+//     from someone else for the same page holds ours back.
+//   - The neighbour broadcasts the requested chunks; everyone missing them
+//     keeps them, and a server that hears a chunk it was about to send
+//     leaves it out.
+// Complete pages go to the staging partition (OTA_PARTITION_LABEL), where
+// they are served from. After the last page the delta is applied a step at
+// a time from service(): the running image is checked against the
+// manifest's base digest, the new image is written to the inactive OTA
+// partition and its SHA-256 compared with the manifest. Parameter updates
+// (OTA_KIND_CONFIG) carry a config override blob (utilities/config_override.h)
+// instead of an image. A node restarted mid-download starts that update
+// over; one that completed it serves it again after publish().
+//
+// Like ReliableLink this only builds frames; the caller sends them.
+
+#define OTA_MAGIC 0x3144544Fu               // "OTD1"
+#define OTA_KIND_FIRMWARE 1
+#define OTA_KIND_CONFIG 2
+
+// First bytes of every delta file, little-endian
+struct OtaManifest {
+    uint32_t magic;
+    uint8_t kind;
+    uint8_t reserved;
+    uint16_t version;           // Higher replaces lower; 0 is never used
+    uint32_t deltaLength;       // Whole file, manifest included
+    uint32_t baseLength;        // Running image bytes the ops copy from
+    uint32_t targetLength;
+    uint8_t baseDigest[CRYPTO_SHA256_BYTES];
+    uint8_t targetDigest[CRYPTO_SHA256_BYTES];
+} __attribute__((packed));
+
+// Delta ops after the manifest, varints as in utilities/varint.h:
+//   COPY:   (length << 1) | 1, zigzag(base offset - base cursor); the base
+//           cursor then moves past the copied bytes
+//   INSERT: (length << 1), then `length` literal bytes
+
+enum OtaOp : uint8_t {
+    OTA_ADVERT = 1,             // OtaAdvert
+    OTA_REQUEST = 2,            // OtaRequest, destinationId: the node asked
+    OTA_DATA = 3                // OtaDataHeader, then up to OTA_CHUNK_BYTES
+};
+
+struct OtaAdvert {
+    uint8_t op;
+    uint16_t version;
+    uint32_t deltaLength;
+    uint16_t pagesComplete;
+} __attribute__((packed));
+
+struct OtaRequest {
+    uint8_t op;
+    uint16_t version;
+    uint16_t page;
+    uint32_t missing;           // Bit i: chunk i of the page
+} __attribute__((packed));
+
+struct OtaDataHeader {
+    uint8_t op;
+    uint16_t version;
+    uint16_t chunk;             // Within the whole file
+} __attribute__((packed));
+
+#define OTA_CHUNK_BYTES ((uint8_t)(sizeof(((DroneMessage*)0)->data) - sizeof(OtaDataHeader)))
+#define OTA_PAGE_BYTES ((uint32_t)OTA_PAGE_CHUNKS * OTA_CHUNK_BYTES)
+
+static_assert(OTA_PAGE_CHUNKS <= 32, "A request's bitmap is one uint32_t");
+
+enum OtaState : uint8_t {
+    OTA_IDLE = 0,               // No update known
+    OTA_RECEIVING,
+    OTA_APPLYING,               // Delta complete; patching and hashing
+    OTA_READY,                  // Verified; the caller installs it, then markInstalled()
+    OTA_INSTALLED,              // Nothing left to do but serve it
+    OTA_FAILED                  // See getFailure(); still served to others
+};
+
+enum OtaFailure : uint8_t {
+    OTA_FAIL_NONE = 0,
+    OTA_FAIL_MANIFEST,          // Bad magic, kind or lengths
+    OTA_FAIL_BASE,              // Made against another image than the one running
+    OTA_FAIL_DELTA,             // Ops malformed or out of bounds
+    OTA_FAIL_DIGEST,            // New image does not hash to the manifest
+    OTA_FAIL_FLASH
+};
+
+struct OtaStats {
+    uint32_t adverts;           // Sent
+    uint32_t advertsSuppressed;
+    uint32_t requests;
+    uint32_t requestsSuppressed;    // Held back for someone else's
+    uint32_t requestsDropped;   // Asked for a page while serving another
+    uint32_t dataSent;
+    uint32_t dataSkipped;       // Heard from another server first
+    uint32_t chunksReceived;    // New to this node
+    uint32_t chunksDuplicate;
+    uint32_t pagesCompleted;
+};
+
+class OtaService {
+private:
+    uint8_t nodeId;
+    uint32_t rngState;
+    FlightFlash* staging;
+    FlightFlash* base;
+    FlightFlash* target;
+
+    // The update being received or served
+    OtaState state;
+    OtaFailure failure;
+    uint16_t version;
+    uint32_t deltaLength;
+    uint16_t pageCount;
+    uint16_t pagesComplete;
+    uint32_t pageHave;          // Bit i: chunk i of page pagesComplete
+    uint32_t erasedBytes;       // Staging is erased below this
+    uint8_t page[OTA_PAGE_BYTES];
+
+    // Trickle
+    uint32_t interval;
+    uint32_t intervalStart;
+    uint32_t advertAt;
+    uint8_t consistent;
+    bool advertDone;
+
+    // Pulling: the neighbour with the most pages, and when to ask it
+    uint8_t sourceId;
+    uint16_t sourcePages;
+    uint32_t requestAt;
+    uint8_t unanswered;
+
+    // Serving one page at a time
+    uint16_t servePage;
+    uint32_t serveMissing;
+
+    // Applying
+    OtaManifest manifest;
+    Sha256 sha;
+    uint8_t applyPhase;
+    uint32_t applyOffset;       // Base bytes hashed, then delta bytes parsed
+    uint32_t baseCursor;
+    uint32_t written;
+    uint32_t targetErased;
+    uint32_t opRemaining;
+    uint32_t copyFrom;
+    bool opCopy;
+    uint8_t parameters[CONFIG_OVERRIDE_MAX_BYTES];
+
+    OtaStats stats;
+
+    uint32_t nextRandom();
+    uint32_t randomBelow(uint32_t bound);
+    uint8_t chunksIn(uint16_t pageIndex) const;
+    uint32_t fullMask(uint16_t pageIndex) const;
+    void startInterval(uint32_t now);
+    void resetTrickle(uint32_t now);
+    void adopt(uint16_t newVersion, uint32_t newLength, uint32_t now);
+    bool storePage(uint32_t now);
+    void startApply();
+    void fail(OtaFailure reason);
+    bool readDelta(uint32_t offset, void* out, uint32_t length);
+    bool readVarint(uint32_t& value);
+    bool emit(const uint8_t* data, uint32_t length);
+    void applyStep(uint32_t budget);
+    void onAdvert(const DroneMessage& in, const OtaAdvert& advert, uint32_t now);
+    void onRequest(const DroneMessage& in, const OtaRequest& request, uint32_t now);
+    void onData(const DroneMessage& in, const OtaDataHeader& header, uint32_t now);
+    void build(uint8_t destination, const void* payload, uint8_t length, uint32_t now, DroneMessage& out);
+
+public:
+    explicit OtaService(uint8_t nodeId);
+    void seed(uint32_t value);
+
+    // staging: delta file; base: the running image; target: the inactive
+    // OTA partition. Any may be null for a node that only relays (it then
+    // cannot apply firmware updates).
+    void begin(FlightFlash* staging, FlightFlash* base, FlightFlash* target, uint32_t now);
+
+    // Staging already holds a whole delta file: the ground node's, written
+    // with esptool, or one this node completed before a restart. Serves it
+    // as installed. expectVersion 0 takes any version; otherwise a file of
+    // another version (e.g. half received) is left alone.
+    bool publish(uint32_t now, uint16_t expectVersion = 0);
+
+    void onFrame(const DroneMessage& in, uint32_t now);
+    // Adverts, requests and data that are due, at most maxFrames
+    uint8_t poll(uint32_t now, DroneMessage* out, uint8_t maxFrames);
+    // Patching and hashing, OTA_APPLY_STEP_BYTES per call
+    void service();
+    // Milliseconds until poll() has something, UINT32_MAX when idle
+    uint32_t nextDueIn(uint32_t now) const;
+
+    void markInstalled();
+
+    OtaState getState() const { return state; }
+    OtaFailure getFailure() const { return failure; }
+    uint16_t getVersion() const { return version; }
+    uint8_t getKind() const { return manifest.kind; }
+    uint16_t getPagesComplete() const { return pagesComplete; }
+    uint16_t getPageCount() const { return pageCount; }
+    uint32_t getTrickleIntervalMs() const { return interval; }
+    // OTA_KIND_CONFIG once READY: the override blob
+    const uint8_t* getParameters() const { return parameters; }
+    uint32_t getParametersLength() const { return manifest.targetLength; }
+
+    OtaStats getStats() const { return stats; }
+    void resetStats();
+
+    static const char* getStateName(OtaState state);
+    static const char* getFailureName(OtaFailure failure);
+};
+
+#ifdef ARDUINO
+// NVS namespace OTA_NVS_NAMESPACE: the last version installed, 0 for none
+uint16_t loadOtaVersion();
+bool storeOtaVersion(uint16_t version);
+#else
+// Host only, for tests and the simulator; tools/deployment/ota_delta.py
+// writes the same format for real images
+void otaEncodeDelta(uint8_t kind, uint16_t version, const uint8_t* base, uint32_t baseLength,
+                    const uint8_t* target, uint32_t targetLength, std::vector<uint8_t>& out);
+#endif
+
+#endif // OTA_SERVICE_H
@@ -0,0 +1,44 @@
+#ifndef PEER_TABLE_H
+#define PEER_TABLE_H
+
+#include "../communications.h"
+#include "../config.h"
+#include "../utilities/data_structures.h"
+
+// Neighbours heard directly, refreshed from their heartbeats. Entries are
+// dropped HEARTBEAT_TIMEOUT_MS after the last one; when the table is full
+// the stalest entry is reused.
+
+struct PeerEntry {
+    uint8_t id;
+    uint8_t missionState;
+    uint8_t status;             // HeartbeatData status
+    int16_t lastRssi;
+    int8_t lastSnrQ2;           // SNR in quarter dB
+    uint32_t heartbeats;
+    uint32_t lastSeen;
+};
+
+class PeerTable {
+private:
+    ObjectPool<PeerEntry, PEER_TABLE_SIZE> entries;
+
+    PeerEntry* findEntry(uint8_t id);
+
+public:
+    PeerTable();
+
+    const PeerEntry* update(const HeartbeatData& heartbeat, int rssi, float snr, uint32_t now);
+    // Warm restart: put back an entry as it was; false if the id is known
+    // already or the table is full
+    bool restore(const PeerEntry& entry);
+    uint8_t expire(uint32_t now);
+    const PeerEntry* find(uint8_t id) const;
+
+    uint8_t size() const { return entries.size(); }
+    // Entry in `slot` (0..PEER_TABLE_SIZE-1), nullptr if the slot is free
+    const PeerEntry* at(uint8_t slot) const { return entries.at(slot); }
+    void clear() { entries.clear(); }
+};
+
+#endif // PEER_TABLE_H
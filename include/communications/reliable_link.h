@@ -0,0 +1,136 @@
+#ifndef RELIABLE_LINK_H
+#define RELIABLE_LINK_H
+
+#include "../communications.h"
+#include "../config.h"
+
+// Reliable unicast (MSG_RELIABLE). Each message goes out with a per-peer
+// sequence number and waits in a shared pool of RELIABLE_TX_SLOTS until the
+// destination acknowledges it, at most RELIABLE_WINDOW per peer. Every
+// MSG_RELIABLE frame also acknowledges the reverse direction: a cumulative
+// ack plus a bitmap of the frames received beyond it, so only the frames
+// that were actually lost are sent again. A receiver that has nothing to
+// send back answers with an ack-only frame after RELIABLE_ACK_DELAY_MS,
+// or straight away when a duplicate shows its ack was lost.
+//
+// The retransmission timeout follows Jacobson/Karels (RFC 6298): smoothed
+// RTT plus four deviations, sampled only from frames sent once (Karn),
+// starting at ACK_TIMEOUT_MS. Each retransmission of a message doubles
+// its own timeout up to RELIABLE_MAX_BACKOFF_MS, and a fresh RTT sample
+// from the peer resets it; the peer's estimate is left alone. After MAX_RETRIES
+// retransmissions a message is given up; the header's base tells the
+// receiver to stop waiting for it. Messages are delivered exactly once
+// but not necessarily in order. Like MessageSender this only builds frames;
+// the caller sends them.
+
+// Precedes the payload in MSG_RELIABLE data
+struct ReliableHeader {
+    uint8_t type;               // Inner message type, 0 for an ack-only frame
+    uint8_t session;            // Sender's stream, new on every boot
+    uint8_t seq;
+    uint8_t base;               // Oldest sequence the sender still retransmits
+    uint8_t ackSession;         // Stream the acknowledgement below refers to, 0 for none
+    uint8_t ack;                // Every sequence before this was received
+    uint8_t sack;               // Bit i: ack + 1 + i was received too
+} __attribute__((packed));
+
+#define RELIABLE_MAX_PAYLOAD ((uint8_t)(sizeof(((DroneMessage*)0)->data) - sizeof(ReliableHeader)))
+
+enum ReliableRxResult : uint8_t {
+    RELIABLE_IGNORED = 0,       // Not MSG_RELIABLE, or not for this node
+    RELIABLE_ACK_ONLY = 1,
+    RELIABLE_DELIVER = 2,       // `delivered` holds the inner message
+    RELIABLE_DUPLICATE = 3      // Already delivered; acknowledged again
+};
+
+struct ReliableStats {
+    uint32_t sent;              // Messages accepted by send()
+    uint32_t transmissions;     // Data frames built, first copies included
+    uint32_t retransmissions;
+    uint32_t delivered;
+    uint32_t duplicates;        // Received again and suppressed
+    uint32_t ackFrames;         // Ack-only frames built
+    uint32_t failed;            // Given up after MAX_RETRIES
+    uint32_t rttSamples;
+};
+
+class ReliableLink {
+private:
+    struct Peer {
+        uint8_t id;                 // 0xFF: free
+        uint32_t lastActive;
+        // Sending
+        uint8_t nextSeq;
+        uint8_t base;
+        uint32_t srttX8;            // Smoothed RTT, ms x 8; 0 before the first sample
+        uint32_t rttvarX4;          // RTT deviation, ms x 4
+        uint32_t rtoMs;
+        // Receiving
+        uint8_t rxSession;          // 0: nothing heard yet
+        uint8_t expected;
+        uint8_t received;           // Bit i: expected + 1 + i
+        bool ackPending;
+        uint32_t ackDueAt;
+    };
+
+    struct Slot {
+        bool used;
+        bool sent;
+        uint8_t peer;               // Index into peers
+        uint8_t seq;
+        uint8_t type;
+        uint8_t length;
+        uint8_t transmissions;
+        uint8_t backoff;            // Doublings of the peer's RTO
+        uint32_t queuedAt;
+        uint32_t firstSentAt;
+        uint32_t lastSentAt;
+        uint8_t data[RELIABLE_MAX_PAYLOAD];
+    };
+
+    uint8_t nodeId;
+    uint8_t session;
+    uint32_t fixedRtoMs;
+    Peer peers[RELIABLE_MAX_PEERS];
+    Slot slots[RELIABLE_TX_SLOTS];
+    ReliableStats stats;
+
+    Peer* findPeer(uint8_t id);
+    Peer* getPeer(uint8_t id, uint32_t now);
+    void resetPeer(Peer& peer, uint8_t id, uint32_t now);
+    uint8_t inFlight(const Peer& peer) const;
+    void onAck(Peer& peer, const ReliableHeader& header, uint32_t now);
+    void sampleRtt(Peer& peer, uint32_t rttMs);
+    uint32_t timeoutOf(const Slot& slot) const;
+    void advanceBase(Peer& peer);
+    void release(Slot& slot);
+    void build(Peer& peer, const Slot* slot, uint32_t now, DroneMessage& out);
+
+public:
+    // fixedRtoMs > 0 disables the adaptive timeout (for comparison)
+    explicit ReliableLink(uint8_t nodeId, uint32_t fixedRtoMs = 0);
+    // A new session per boot; the peers' receive state for us resets
+    void seed(uint32_t value);
+
+    // Queues one message for `destination`. False when it is too long, a
+    // broadcast, or the peer's window or the slot pool is full.
+    bool send(uint8_t destination, uint8_t type, const void* payload, uint8_t length, uint32_t now);
+
+    // Handles a received frame: acknowledgements first, then the payload
+    ReliableRxResult onFrame(const DroneMessage& in, uint32_t now, DroneMessage& delivered);
+
+    // New messages, retransmissions and acks that are due, oldest first
+    uint8_t poll(uint32_t now, DroneMessage* out, uint8_t maxFrames);
+    // Milliseconds until poll() has something, UINT32_MAX when idle
+    uint32_t nextDueIn(uint32_t now) const;
+
+    uint8_t pending() const;                    // Messages not yet acknowledged
+    uint8_t pendingFor(uint8_t destination);
+    uint32_t getRtoMs(uint8_t peer);            // Before backoff; ACK_TIMEOUT_MS for unknown peers
+    uint32_t getSrttMs(uint8_t peer);           // 0 before the first sample
+
+    ReliableStats getStats() const { return stats; }
+    void resetStats();
+};
+
+#endif // RELIABLE_LINK_H
@@ -0,0 +1,137 @@
+#ifndef STATUS_SERVICE_H
+#define STATUS_SERVICE_H
+
+#include "../communications.h"
+#include "../config.h"
+#include "../utilities/performance_monitor.h"
+#include "peer_table.h"
+
+// Remote telemetry over MSG_STATUS_REQUEST / MSG_STATUS_RESPONSE.
+//
+// The requester names the last snapshot it holds; the drone answers with
+// only what changed since then: comm counters, hot-path histogram buckets
+// and peer-table entries. The change stream is a run of tagged records with
+// varint (zigzag for signed) deltas, cut into fragments that each carry a
+// TelemetryFrameHeader. The drone keeps the snapshot it last sent and the
+// one before it per requester, so a lost response costs a slightly larger
+// delta rather than a full resync; any other base gets absolute values
+// (baseSnapshot 0). Records that do not fit in STATUS_MAX_FRAMES stay
+// pending for the next request.
+
+struct StatusRequestData {
+    uint8_t kind;               // StatusPayloadKind
+    uint16_t baseSnapshot;      // STATUS_TELEMETRY_DELTA: snapshot held, 0 for none
+} __attribute__((packed));
+
+struct TelemetryFrameHeader {
+    uint8_t kind;               // STATUS_TELEMETRY_DELTA
+    uint16_t snapshotId;
+    uint16_t baseSnapshot;      // 0: values are absolute
+    uint8_t fragment;
+    uint8_t fragmentCount;
+} __attribute__((packed));
+
+#define TELEMETRY_FRAGMENT_BYTES (sizeof(((DroneMessage*)0)->data) - sizeof(TelemetryFrameHeader))
+#define TELEMETRY_STREAM_BYTES (STATUS_MAX_FRAMES * TELEMETRY_FRAGMENT_BYTES)
+
+// Wire ids: append only
+enum TelemetryCounter : uint8_t {
+    TEL_UPTIME_MS = 0,
+    TEL_MESSAGES_SENT = 1,
+    TEL_MESSAGES_RECEIVED = 2,
+    TEL_MESSAGES_LOST = 3,
+    TEL_MESSAGES_PREEMPTED = 4,
+    TEL_LAST_RSSI = 5,          // Signed values travel as two's complement
+    TEL_LAST_SNR_Q2 = 6,
+    TEL_FREE_HEAP = 7,
+    TEL_CYCLES_PER_US = 8,      // Scales the histogram buckets
+    TEL_COUNTER_COUNT
+};
+
+enum TelemetryRecord : uint8_t {
+    TEL_RECORD_COUNTERS = 1,    // varint change mask, zigzag delta per set bit
+    TEL_RECORD_HISTOGRAM = 2,   // probe, zigzag max delta, first bucket, n, n x zigzag count delta
+    TEL_RECORD_PEER = 3,        // id, state, zigzag rssi/snr/heartbeats/lastSeen deltas
+    TEL_RECORD_PEER_GONE = 4    // id
+};
+
+// Histograms go out coarser than they are kept on board
+#define TELEMETRY_BUCKETS ((33 - TELEMETRY_HISTOGRAM_SUB_BITS) * (1 << TELEMETRY_HISTOGRAM_SUB_BITS))
+
+struct TelemetryPeer {
+    uint8_t id;
+    uint8_t state;              // missionState << 4 | status
+    int16_t rssi;
+    int8_t snrQ2;
+    uint32_t heartbeats;
+    uint32_t lastSeen;          // Drone clock
+};
+
+struct TelemetrySnapshot {
+    uint32_t counters[TEL_COUNTER_COUNT];
+    uint32_t buckets[PERF_PROBE_COUNT][TELEMETRY_BUCKETS];
+    uint32_t maxCycles[PERF_PROBE_COUNT];
+    TelemetryPeer peers[PEER_TABLE_SIZE];
+    uint8_t peerCount;
+};
+
+// Appends records turning `base` into `current` until `capacity` runs out.
+// Returns bytes written.
+size_t telemetryEncode(const TelemetrySnapshot& base, const TelemetrySnapshot& current,
+                       uint8_t* out, size_t capacity);
+
+// Applies a record stream in place; false on a malformed stream
+bool telemetryApply(TelemetrySnapshot& state, const uint8_t* in, size_t length);
+
+const TelemetryPeer* telemetryFindPeer(const TelemetrySnapshot& state, uint8_t id);
+
+struct StatusServiceStats {
+    uint32_t requests;
+    uint32_t deltas;            // Answered against a held snapshot
+    uint32_t resyncs;           // Answered with absolute values
+    uint32_t truncated;         // Records left for the next request
+    uint32_t framesSent;
+    uint32_t bytesSent;         // Stream bytes, headers excluded
+};
+
+class StatusService {
+private:
+    struct Requester {
+        uint8_t id;
+        bool used;
+        uint32_t lastRequest;
+        uint16_t sentId;        // Last snapshot sent
+        uint16_t previousId;    // The one before, in case the last was lost
+        TelemetrySnapshot sent;
+        TelemetrySnapshot previous;
+    };
+
+    uint8_t selfId;
+    uint16_t sequence;
+    uint16_t nextSnapshotId;
+    const PerfMonitor* perf;
+    const PeerTable* peers;
+    Requester requesters[STATUS_MAX_REQUESTERS];
+    TelemetrySnapshot current;
+    uint8_t stream[TELEMETRY_STREAM_BYTES];
+    StatusServiceStats stats;
+
+    Requester& requesterFor(uint8_t id, uint32_t now);
+    void capture(const CommStats& comm, uint32_t now);
+
+public:
+    StatusService(uint8_t selfId, const PerfMonitor* perf, const PeerTable* peers);
+
+    // Answers one request; returns frames written to `out` (at most
+    // STATUS_MAX_FRAMES), 0 if the message is not a request for us
+    uint8_t handleRequest(const DroneMessage& request, const CommStats& comm, uint32_t now,
+                          DroneMessage* out);
+
+    StatusServiceStats getStats() const { return stats; }
+};
+
+// Request helper shared with the ground station
+void buildStatusRequest(uint8_t selfId, uint8_t destination, uint16_t sequence, uint32_t now,
+                        StatusPayloadKind kind, uint16_t baseSnapshot, DroneMessage& out);
+
+#endif // STATUS_SERVICE_H
@@ -7,69 +7,306 @@
 #define BUILD_DATE __DATE__
 #define BUILD_TIME __TIME__
 
+// Deployment Configuration: data/*.json compiled into constexpr tables by
+// tools/deployment/config_generator.py (pre_build.py runs it). -DDRONE_ID
+// picks this drone's row; the names below are aliases into the tables.
+#include "generated/swarm_config.h"
+#define DRONE_CONFIG DRONE_CONFIGS[DRONE_CONFIG_INDEX]
+
 // Hardware Configuration
-#define MAX_DRONES 5
-#define DEFAULT_NODE_ID 1
+#define MAX_DRONES SWARM_CONFIG.maxDrones
+#define DEFAULT_NODE_ID DRONE_CONFIG.id
 
 // LoRa Communication Parameters
-#define LORA_DEFAULT_FREQUENCY 433E6
-#define LORA_DEFAULT_TX_POWER 20
-#define LORA_DEFAULT_BANDWIDTH 125E3
-#define LORA_DEFAULT_SF 7
+#define LORA_FREQUENCY DRONE_CONFIG.radio.frequencyHz
+#define LORA_TX_POWER DRONE_CONFIG.radio.txPowerDbm
+#define LORA_BANDWIDTH DRONE_CONFIG.radio.bandwidthHz
+#define LORA_SPREADING_FACTOR DRONE_CONFIG.radio.spreadingFactor
+#define LORA_CODING_RATE DRONE_CONFIG.radio.codingRate
+#define LORA_PREAMBLE_LENGTH DRONE_CONFIG.radio.preambleLength
+#define LORA_SYNC_WORD DRONE_CONFIG.radio.syncWord
 #define LORA_MAX_PAYLOAD_SIZE 32
 
 // Timing Configuration
-#define HEARTBEAT_INTERVAL_MS 2000
-#define HEARTBEAT_TIMEOUT_MS 6000    // 3x heartbeat interval
-#define MESSAGE_TIMEOUT_MS 5000
-#define STATS_INTERVAL_MS 10000
+#define HEARTBEAT_INTERVAL_MS SWARM_CONFIG.timing.heartbeatIntervalMs
+#define HEARTBEAT_TIMEOUT_MS SWARM_CONFIG.timing.heartbeatTimeoutMs
+#define MESSAGE_TIMEOUT_MS SWARM_CONFIG.timing.messageTimeoutMs
+#define STATS_INTERVAL_MS SWARM_CONFIG.timing.statsIntervalMs
 
 // Debug Configuration
+#ifdef BENCHMARK_MODE
+#define DEBUG_ENABLED 0                  // Serial output would swamp the timings
+#else
 #define DEBUG_ENABLED 1
+#endif
 #define DEBUG_COMMUNICATION 1
 #define DEBUG_ALGORITHMS 1
 #define DEBUG_PERFORMANCE 1
 
 // Mission Parameters
-#define MISSION_AREA_SIZE_M 1000     // 1km x 1km area
-#define TARGET_DETECTION_RANGE_M 50
-#define FORMATION_SPACING_M 100
+#define MISSION_AREA_SIZE_M SWARM_CONFIG.mission.areaSizeM
+#define TARGET_DETECTION_RANGE_M SWARM_CONFIG.mission.targetDetectionRangeM
+#define FORMATION_SPACING_M SWARM_CONFIG.mission.formationSpacingM
 
-// Network Configuration
-#define MAX_RETRIES 3
-#define ACK_TIMEOUT_MS 1000
-#define MAX_HOPS 5
+// Formation Control
+#define FORMATION_CONTROL_INTERVAL_MS 100
+#define FORMATION_TICK_BUDGET_US 5000
+#define FORMATION_MAX_SPEED_MS 12.0f
+#define DRONE_SAFETY_RADIUS_M 5.0f
+#define ORCA_TIME_HORIZON_S 4.0f
+#define ORCA_NEIGHBOR_DIST_M 150.0f
+#define ORCA_MAX_NEIGHBORS 10
+#define FORMATION_SETTLE_TOLERANCE_M 2.0f
 
-// Performance Limits
-#define MAX_MESSAGE_RATE_PER_SEC 10
-#define MAX_BANDWIDTH_USAGE_PERCENT 80
-#define MIN_BATTERY_LEVEL_PERCENT 20
+#ifndef MAX_FORMATION_MEMBERS
+#ifdef ARDUINO
+#define MAX_FORMATION_MEMBERS 16
+#else
+#define MAX_FORMATION_MEMBERS 64     // Host simulation runs up to 50 drones
+#endif
+#endif
+
+// Target Fusion
+#define MAX_TARGET_TRACKS 64
+#define MAX_TRACK_REPORTERS 8
+#define TARGET_ASSOCIATION_RADIUS_M 15   // Reports closer than this are the same target
+#define TARGET_TRACK_TIMEOUT_MS 30000
+#define TARGET_CONFIDENCE_REPORT_DELTA 0.05f
+
+// On-board Detection
+#define DETECTION_FRAME_SIZE 16          // Square frames, one channel
+#define DETECTION_BATCH_SIZE 8           // Frames run layer-by-layer together
+#define DETECTION_QUEUE_SIZE 16          // Power of two
+#define DETECTION_CONFIDENCE_THRESHOLD 0.6f
+
+// Sensor Pipeline
+#define GPS_BAUD_RATE 9600
+#define GPS_RX_RING_SIZE 512          // Power of two; ~0.5 s of NMEA at 9600 baud
+#define BARO_RING_SIZE 16             // Power of two
+#define BARO_SAMPLE_INTERVAL_MS 40
+#define GPS_FIX_TIMEOUT_MS 3000
+#define BMP280_I2C_ADDRESS 0x76
+#define SEA_LEVEL_PRESSURE_PA 101325
+
+// Emergency Stop
+#define EMERGENCY_STOP_REPEATS 3         // Transmissions per node per stop
+#define EMERGENCY_STOP_MAX_REPEATS 8     // Keeps going while a live neighbour has not echoed the stop
+#define EMERGENCY_STOP_REPEAT_MS 200
+#define EMERGENCY_RELAY_SLOTS 4          // Relays pick a random frame-length slot so neighbours don't collide
+#define EMERGENCY_SLOT_GUARD_MS 4        // A slot is the frame's airtime plus this
+#define EMERGENCY_SUPPRESS_COUNT 3       // Skip a repeat after hearing this many copies
+#define EMERGENCY_NEIGHBOURS 16          // Neighbours tracked for echoes; live for HEARTBEAT_TIMEOUT_MS
+#define EMERGENCY_MAX_HOPS 32           // First copies often take a longer path than the swarm diameter
+#define EMERGENCY_DEDUP_ENTRIES 8
+#define LORA_RX_QUEUE_SIZE 8             // Power of two; radio task -> main loop
+
+// Performance Monitoring
+#ifndef PERF_MONITOR_ENABLED
+#define PERF_MONITOR_ENABLED DEBUG_PERFORMANCE
+#endif
+#define PERF_HISTOGRAM_SUB_BITS 2        // 4 buckets per power of two, <=25% error
+#define PERF_MAX_CORES 2
+
+// Flight Recorder
+#ifndef FLIGHT_RECORDER_ENABLED
+#define FLIGHT_RECORDER_ENABLED 1
+#endif
+#define FLIGHT_PARTITION_LABEL "recorder" // Raw data partition, see partitions.csv
+#define FLIGHT_SECTOR_BYTES 4096         // Flash erase unit
+#define FLIGHT_PAGE_BYTES 256            // Flash program unit; only whole pages go out between flushes
+#define FLIGHT_BUFFER_PAGES 8            // 2 KB of RAM, ~50 frame records between main loop passes
+#define FLIGHT_FLUSH_INTERVAL_MS 1000    // Longest a partial page waits; bounds what a power cut loses
+#ifndef SERIAL_TAP_ENABLED
+#define SERIAL_TAP_ENABLED 0             // Frame records on the USB console too, see utilities/serial_tap.h
+#endif
+
+// Ground Station Daemon (tools/monitoring/ground_station.cpp)
+#define GROUND_SERIAL_BAUD 115200
+#define GROUND_SHM_NAME "/drone_swarm"
+#define SWARM_MAX_STREAMS 256
+#define SWARM_RING_SLOTS 65536           // Events a viewer may fall behind before it loses some
+#define GROUND_READ_BYTES 4096           // Per read() of a ready stream
+#define GROUND_LINE_MAX 256              // Longer text is cut into pieces
+
+// Benchmarks (test_benchmarks, natively and in the performance_test env)
+#define BENCH_MAX_CASES 32
+#define BENCH_SAMPLES 11                 // Timed calls per case; the median is reported
+#define BENCH_SAMPLE_US 2000             // Calibrated length of one call
+#define BENCH_REGRESSION_TOLERANCE 0.25f // Slower than the baseline by more than this is flagged
 
-// Pin Definitions (can be overridden in hardware-specific files)
-#ifndef LORA_SS
-#define LORA_SS 5
+// Warm Restart
+#define WARM_NVS_NAMESPACE "warm"
+#define WARM_SAVE_INTERVAL_MS 1000       // RTC snapshot period: the peer and replay state a reset can lose
+#define WARM_SEQUENCE_LEASE 256          // Link sequences reserved per snapshot, far above a second's frames
+#define WARM_MAX_DOWNTIME_MS 30000       // Longer down: peers and replay windows are stale
+#define WARM_MAX_WARM_BOOTS 3            // Quick resets in a row before the snapshot is distrusted
+#define WARM_STABLE_MS 60000             // Uptime that ends a run of quick resets
+#define WARM_STOP_ID_SKIP 8              // Stop ids jumped after a restore from flash
+
+// Status Telemetry
+#define PEER_TABLE_SIZE 16
+#ifndef STATUS_MAX_REQUESTERS
+#define STATUS_MAX_REQUESTERS 1          // Ground stations; each holds two ~3 KB snapshots
 #endif
+#define STATUS_MAX_FRAMES 8              // Per response; the rest waits for the next poll
+#define TELEMETRY_HISTOGRAM_SUB_BITS 1   // 2 buckets per power of two on the wire
+#define STATUS_POLL_INTERVAL_MS 60000    // Ground station, per drone
+
+// Memory Pools
+#define FRAME_POOL_SIZE 16               // Frames held past the call that received them
+#define TIMEOUT_POOL_SIZE 16             // Per TimeoutManager
+#define TIMEOUT_NAME_LENGTH 16
+#define LOG_POOL_SIZE 16                 // Deferred log lines awaiting debugLogFlush()
+#define LOG_RECORD_TEXT 56
+#define SCRATCH_ARENA_BYTES 512          // Per main loop pass
 
-#ifndef LORA_RST  
-#define LORA_RST 14
+// Link Security
+#define CRYPTO_TAG_BYTES 4               // Truncated CCM tag, as LoRaWAN's MIC: 2^-32 odds per forgery attempt
+#define CRYPTO_REPLAY_WINDOW 32          // Per source; covers frames reordered between seal and air
+#define CRYPTO_REPLAY_SOURCES PEER_TABLE_SIZE
+#define CRYPTO_EPOCH_ROLL_AT 0xFF00      // Main loop starts the next epoch here, before seal() has to wrap
+#ifndef CRYPTO_HW_AES
+#define CRYPTO_HW_AES 1                  // ESP32 AES accelerator via mbedtls
+#endif
+#ifndef SWARM_NETWORK_KEY
+#if defined(UNIT_TEST) || defined(BENCHMARK_MODE)
+// Test key for host tests and benchmarks only; it is public, so it never goes on air
+#define SWARM_NETWORK_KEY {0x5A, 0x17, 0xC3, 0x08, 0x9E, 0x41, 0xD2, 0x6B, \
+                           0x33, 0xF0, 0x7C, 0xA5, 0x12, 0xE8, 0x4D, 0x96}
+#elif defined(ARDUINO)
+#error "Set the deployment key: -DSWARM_NETWORK_KEY='{0x.., ...}' (16 bytes) in build_flags"
 #endif
+#endif
+
+// Message Batching
+#define BATCH_MAX_DELAY_MS 100           // Latency budget per logical message, about one SF7 frame
+#define BATCH_SLOTS 4                    // Batches open or awaiting send (one destination each)
+
+// Forward Error Correction
+#define FEC_MAX_DATA_FRAMES 16           // Per group: up to 416 bytes of payload
+#define FEC_MAX_PARITY_FRAMES 8
+#define FEC_DECODE_GROUPS 2              // Groups being collected at once, ~650 bytes each
+#define FEC_GROUP_TIMEOUT_MS 10000       // An incomplete group is dropped after this
 
-#ifndef LORA_DIO0
-#define LORA_DIO0 2
+// Over-the-air Updates
+#define OTA_PARTITION_LABEL "otadelta"   // Delta staging, see partitions.csv
+#define OTA_NVS_NAMESPACE "ota"
+#define OTA_PAGE_CHUNKS 32               // Chunks per page, ~860 bytes; a request's bitmap is one uint32_t
+#define OTA_TRICKLE_MIN_MS 2000          // Advert interval after a change, ~20 frames' airtime
+#define OTA_TRICKLE_MAX_MS 60000         // Settled swarm: at most one advert per drone a minute
+#define OTA_TRICKLE_REDUNDANCY 1         // Matching adverts heard that make ours redundant
+#define OTA_REQUEST_BACKOFF_MS 500       // Random wait before asking, so one request serves many
+#define OTA_REQUEST_TIMEOUT_MS 3000      // Quiet on our page before asking again; a page is ~32 frames
+#define OTA_MAX_REQUESTS 4               // Unanswered in a row before another neighbour is tried
+#define OTA_APPLY_STEP_BYTES 4096        // Image bytes hashed or patched per main loop pass
+
+// Adaptive Data Rate
+#define ADR_MIN_SF 7
+#define ADR_MAX_SF 9                     // Heartbeats from MAX_DRONES nodes fill ~70% of the channel at SF9
+#define ADR_MIN_TX_POWER_DBM 2           // PA_BOOST range of the SX127x
+#define ADR_MAX_TX_POWER_DBM 20
+#define ADR_MARGIN_DB 3.0f               // Above the SF's demodulation floor, on top of the fading headroom
+#define ADR_HYSTERESIS_DB 1.0f           // Extra margin before stepping to a faster SF
+#define ADR_DEVIATION_WEIGHT 1.0f        // Mean deviations of the SNR held back as fading headroom
+#define ADR_SLOWER_SF_GAIN 3.0f          // A slower SF must cut transmit energy per neighbour reached this much
+#define ADR_SNR_ALPHA 0.25f
+#define ADR_MIN_SAMPLES 3                // Per neighbour before its link is trusted
+#define ADR_MAX_NEIGHBOURS PEER_TABLE_SIZE
+#define ADR_NEIGHBOUR_FORGET_MS 30000    // Silent past HEARTBEAT_TIMEOUT_MS: full power until then
+#define ADR_POWER_STEP_DB 2              // Largest cut per heartbeat interval; raises are immediate
+#define ADR_SWITCH_LEAD_MS 12000         // SF changes are announced ~6 heartbeat hops ahead
+#define ADR_SETTLE_MS 30000              // Minimum time before stepping to a faster SF
+#define ADR_REQUIREMENT_HOPS 8           // A stale requirement dies out after this many relays
+#define ADR_SILENCE_MS 20000             // Nothing heard: assume a missed switch and scan
+#define ADR_SCAN_DWELL_MS 5000           // Per SF while scanning; longer than any heartbeat interval
+#define LORA_NOISE_FIGURE_DB 6.0f
+#define LORA_SNR_SATURATION_DB 8.0f      // Packet SNR stops tracking the signal above this; use RSSI
+
+// Link Quality
+#define LINK_MAX_NEIGHBOURS PEER_TABLE_SIZE
+#define LINK_SIGNAL_ALPHA 0.2f           // RSSI/SNR EWMA, per frame heard
+#define LINK_PRR_ALPHA 0.25f             // Reception ratio EWMA, per window
+#define LINK_WINDOW_HEARTBEATS 2         // Window length; a live neighbour sends at least this many frames
+#define LINK_MAX_SEQUENCE_GAP 512        // A larger jump, or one backwards, is a restart rather than losses
+#define LINK_FORGET_MS 30000             // Silent this long: dropped, and its row with it
+#define LINK_ROW_ENTRIES 2               // Per heartbeat; with the link state it still fills one batch frame
+#define LINK_ROW_SNR_MIN_DB (-20)        // Row SNR nibble: SF12's floor...
+#define LINK_ROW_SNR_STEP_DB 2           // ...up to +10 dB, where packet SNR saturates anyway
+
+// Channel Access
+#define MAC_JITTER_SLOTS 32              // Random start offset, about 1.5 frames; CAD sorts out the rest
+#define MAC_MIN_BACKOFF_EXPONENT 5       // First busy channel: 1-32 slots, about one frame
+#define MAC_MAX_BACKOFF_EXPONENT 8       // Up to 256 slots, ~1 s at SF7
+#define MAC_MAX_ATTEMPTS 8               // Busy channel checks before a frame is dropped
+#define MAC_TURNAROUND_US 1000           // Per slot on top of the CAD itself
+#define MAC_TX_DONE_MARGIN_MS 50         // Past the longest frame's airtime before a lost TX done is assumed
+#define MAC_RSSI_BUSY_DBM (-105)         // Energy detect first: CAD would abort a reception in progress
+#define MAC_DUTY_WINDOW_MS 10000         // Own airtime budget: MAX_BANDWIDTH_USAGE_PERCENT of this
+#define MAC_UTILIZATION_WINDOW_MS 10000
+
+// Duty Cycling (see communications/duty_cycle.h)
+#ifndef DUTY_CYCLE_ENABLED
+#define DUTY_CYCLE_ENABLED 0             // Sleep between wake windows; the whole swarm should agree
 #endif
+#define DUTY_GUARD_MS 10                 // Listen this early: crystal drift and sync error
+#define DUTY_WINDOW_MIN_FRAMES 2         // A window stays open this many frame times plus the MAC jitter...
+#define DUTY_IDLE_FRAMES 2               // ...and then until the channel has been quiet for this many, plus jitter
+#define DUTY_SYNC_TOLERANCE_MS 5         // A neighbour's window this close is our window
+#define DUTY_SYNC_LISTEN_MS HEARTBEAT_TIMEOUT_MS    // After boot: listen for a schedule to join
+#define DUTY_DISCOVERY_PERIODS 30        // One period in this many is listened through, for other schedules
+#define DUTY_SAMPLE_INTERVAL_MS 250      // CAD between windows; urgent frames' preamble spans it
+
+// Power Model (datasheet figures, for energy estimates and the simulator)
+#define POWER_SUPPLY_V 3.3f
+#define POWER_CPU_ACTIVE_MA 40.0f        // ESP32 at 240 MHz, Wi-Fi and BT off, mostly in delay()
+#define POWER_CPU_LIGHT_SLEEP_MA 0.8f
+#define POWER_WAKE_US 1000               // Light sleep exit and back, at the active current
+#define POWER_LORA_RX_MA 11.5f           // SX1276, LNA boost on (the LoRa library's default)
+#define POWER_LORA_SLEEP_MA 0.0002f
+
+// Network Configuration
+#define MAX_RETRIES 3
+#define ACK_TIMEOUT_MS 1000              // Until a peer's RTT has been measured
+#define RELIABLE_WINDOW 8                // Per peer in flight; the ack bitmap covers this many
+#define RELIABLE_TX_SLOTS 16             // Unacknowledged messages, all peers
+#define RELIABLE_MAX_PEERS PEER_TABLE_SIZE
+#define RELIABLE_ACK_DELAY_MS 50         // Wait for a reply to carry the ack
+#define RELIABLE_MIN_RTO_MS 250          // About two SF7 frames plus the ack delay
+#define RELIABLE_MAX_RTO_MS 8000
+#define RELIABLE_MAX_BACKOFF_MS ACK_TIMEOUT_MS // A backed-off retry never waits longer than the fixed timeout would
+#define MAX_HOPS 5
+
+// Performance Limits
+#define MAX_MESSAGE_RATE_PER_SEC SWARM_CONFIG.limits.maxMessageRatePerSec
+#define MAX_BANDWIDTH_USAGE_PERCENT SWARM_CONFIG.limits.maxBandwidthUsagePercent
+#define MIN_BATTERY_LEVEL_PERCENT SWARM_CONFIG.limits.minBatteryLevelPercent
+
+// Field Tuning (see utilities/config_override.h)
+#define CONFIG_NVS_NAMESPACE "config"
+#define CONFIG_OVERRIDE_MAX_BYTES 48     // Header, CRC and a few fields; config_generator.py checks it too
+
+// Pin Definitions (data/hardware_pins.json, by the drone's board)
+#define LORA_SS DRONE_CONFIG.pins.loraSs
+#define LORA_RST DRONE_CONFIG.pins.loraRst
+#define LORA_DIO0 DRONE_CONFIG.pins.loraDio0
 
 // Macros for debugging
-#if DEBUG_ENABLED
+#if DEBUG_ENABLED && defined(ARDUINO)
 #define DEBUG_PRINT(...) Serial.printf(__VA_ARGS__)
 #define DEBUG_PRINTLN(...) Serial.println(__VA_ARGS__)
+#elif DEBUG_ENABLED
+#include <stdio.h>
+#define DEBUG_PRINT(...) printf(__VA_ARGS__)
+#define DEBUG_PRINTLN(...) puts(__VA_ARGS__)
 #else
 #define DEBUG_PRINT(...)
 #define DEBUG_PRINTLN(...)
 #endif
 
-// Status LED (if available)
-#ifndef STATUS_LED_PIN
-#define STATUS_LED_PIN 2
-#endif
+#define GPS_RX_PIN DRONE_CONFIG.pins.gpsRx
+#define GPS_TX_PIN DRONE_CONFIG.pins.gpsTx
+
+// Status LED (-1 if none)
+#define STATUS_LED_PIN DRONE_CONFIG.pins.statusLed
 
 #endif // CONFIG_H
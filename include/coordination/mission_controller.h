@@ -0,0 +1,164 @@
+#ifndef MISSION_CONTROLLER_H
+#define MISSION_CONTROLLER_H
+
+#include "../communications.h"
+#include "../config.h"
+
+// Formation keeping. Drones are assigned to formation slots by minimum total
+// travel (Hungarian algorithm). When a member is lost the assignment is
+// repaired along a single shortest alternating path instead of re-solving.
+// Each control tick steers towards the slot and passes the preferred
+// velocity through an ORCA (reciprocal velocity obstacle) step so drones
+// crossing each other on the way to their slots do not collide.
+
+struct Vec2 {
+    float x, y;
+    Vec2() : x(0), y(0) {}
+    Vec2(float x, float y) : x(x), y(y) {}
+    Vec2 operator+(const Vec2& o) const { return Vec2(x + o.x, y + o.y); }
+    Vec2 operator-(const Vec2& o) const { return Vec2(x - o.x, y - o.y); }
+    Vec2 operator-() const { return Vec2(-x, -y); }
+    Vec2 operator*(float s) const { return Vec2(x * s, y * s); }
+    Vec2 operator/(float s) const { return Vec2(x / s, y / s); }
+    float operator*(const Vec2& o) const { return x * o.x + y * o.y; } // Dot product
+};
+
+// Equirectangular projection around a fixed origin; fine over a mission area
+class LocalTangentPlane {
+private:
+    bool originSet;
+    float originLat, originLon;
+    float metersPerDegLon;
+
+public:
+    LocalTangentPlane() : originSet(false), originLat(0), originLon(0), metersPerDegLon(111320.0f) {}
+    void setOrigin(float latitude, float longitude);
+    bool hasOrigin() const { return originSet; }
+    Vec2 toLocal(float latitude, float longitude);
+    void toGeo(const Vec2& p, float& latitude, float& longitude) const;
+};
+
+// Rectangular assignment (rows = drones <= cols = slots), float costs
+class HungarianSolver {
+private:
+    float cost[MAX_FORMATION_MEMBERS][MAX_FORMATION_MEMBERS];
+    float u[MAX_FORMATION_MEMBERS + 1];
+    float v[MAX_FORMATION_MEMBERS + 1];
+    int8_t rowOfCol[MAX_FORMATION_MEMBERS + 1];   // 1-based, 0 = free
+    uint8_t rows, cols;
+    bool rowActive[MAX_FORMATION_MEMBERS];
+    bool dualsValid;
+    float tolerance;            // Slack allowed when reusing duals on refreshed costs
+    uint32_t fallbacks;
+
+    bool dualsFeasible() const;
+
+public:
+    HungarianSolver();
+
+    void setSize(uint8_t rowCount, uint8_t colCount);
+    void setCost(uint8_t row, uint8_t col, float c) { cost[row][col] = c; }
+    float getCost(uint8_t row, uint8_t col) const { return cost[row][col]; }
+
+    // Full O(n^3) solve over all active rows
+    float solve();
+
+    // Drops a row and repairs optimality in O(n^2); falls back to solve()
+    // if the stored duals cannot be reused
+    float removeRow(uint8_t row);
+
+    int8_t getColumn(uint8_t row) const;
+    float totalCost() const;
+    void setTolerance(float slack) { tolerance = slack; }
+    uint32_t getFallbackCount() const { return fallbacks; }
+    uint8_t getRowCount() const { return rows; }
+    uint8_t getColCount() const { return cols; }
+};
+
+enum FormationShape {
+    FORMATION_LINE = 0,     // Line abreast
+    FORMATION_WEDGE = 1,    // V behind the anchor
+    FORMATION_GRID = 2
+};
+
+struct FormationMember {
+    uint8_t droneId;
+    bool active;
+    Vec2 position;          // Local metres
+    Vec2 velocity;
+    uint32_t lastUpdate;
+    int8_t slot;
+};
+
+struct VelocityCommand {
+    uint8_t droneId;
+    Vec2 velocity;
+    Vec2 target;
+    int8_t slot;
+    bool avoiding;          // ORCA changed the preferred velocity
+};
+
+struct FormationStats {
+    uint32_t fullSolves;
+    uint32_t incrementalRepairs;
+    uint32_t ticks;
+    uint32_t budgetOverruns;
+    uint32_t lastTickUs;
+    uint32_t maxTickUs;
+};
+
+class FormationController {
+private:
+    FormationMember members[MAX_FORMATION_MEMBERS];
+    uint8_t memberCount;
+    Vec2 slotOffsets[MAX_FORMATION_MEMBERS];    // Precomputed per shape/count
+    uint8_t slotCount;
+    FormationShape shape;
+    float spacing;
+    Vec2 anchor;
+    float heading;                              // Radians, CCW from east
+    bool assignmentDirty;
+    bool settledSnapshot;                       // Costs re-solved once in formation
+
+    HungarianSolver solver;
+    LocalTangentPlane plane;
+    FormationStats stats;
+
+    int8_t findMember(uint8_t droneId) const;
+    void computeSlotOffsets();
+    void refreshCosts();
+    void assignSlots();
+    float maxSlotError() const;
+    Vec2 preferredVelocity(const FormationMember& m) const;
+
+public:
+    FormationController(FormationShape shape = FORMATION_WEDGE, float spacingM = FORMATION_SPACING_M);
+
+    void setShape(FormationShape next);
+    void setAnchor(const Vec2& position, float headingRad);
+    LocalTangentPlane& getPlane() { return plane; }
+
+    // Membership and state, from heartbeats or local sensors
+    bool updateMember(uint8_t droneId, const Vec2& position, const Vec2& velocity, uint32_t now);
+    bool updateFromHeartbeat(const HeartbeatData& heartbeat, uint32_t now);
+    bool removeMember(uint8_t droneId);
+    uint8_t expireMembers(uint32_t now, uint32_t timeoutMs = HEARTBEAT_TIMEOUT_MS);
+
+    // One drone's command (flight code) or every drone's (simulation)
+    bool computeCommand(uint8_t droneId, VelocityCommand& command);
+    uint8_t tick(VelocityCommand* commands, uint8_t maxCommands);
+
+    Vec2 getSlotPosition(int8_t slot) const;
+    const FormationMember* getMember(uint8_t droneId) const;
+    uint8_t getMemberCount() const { return memberCount; }
+    float getAssignmentCost() const { return solver.totalCost(); }
+    FormationStats getStats() const { return stats; }
+    void printStatus();
+};
+
+// ORCA velocity selection for one agent (RVO2 formulation)
+Vec2 orcaVelocity(const Vec2& position, const Vec2& velocity, const Vec2& preferred,
+                  const Vec2* neighborPos, const Vec2* neighborVel, uint8_t neighborCount,
+                  float radius, float maxSpeed, float timeHorizon, float timeStep, bool* avoiding = nullptr);
+
+#endif // MISSION_CONTROLLER_H
@@ -0,0 +1,55 @@
+#ifndef STATE_MACHINE_H
+#define STATE_MACHINE_H
+
+#include <atomic>
+#include "../communications.h"
+#include "../config.h"
+
+// Mission state shared by the main loop and the radio task. Normal
+// transitions come from the main loop; emergencyStop() may be called from
+// any context (including an interrupt) and latches until an
+// explicit clearEmergency().
+
+#ifndef ARDUINO
+#define IRAM_ATTR
+#endif
+
+// Values match HeartbeatData.missionState
+enum MissionState : uint8_t {
+    MISSION_IDLE = 0,
+    MISSION_ACTIVE = 1,
+    MISSION_LISTENING = 2,
+    MISSION_RETURNING = 3,
+    MISSION_EMERGENCY_STOP = 4
+};
+
+typedef void (*EmergencyStopHook)(uint8_t reason);
+
+class MissionStateMachine {
+private:
+    std::atomic<uint8_t> state;
+    std::atomic<uint8_t> stopReason;
+    std::atomic<uint32_t> stoppedAt;
+    EmergencyStopHook stopHook;     // Must be ISR-safe (e.g. cut motor PWM)
+
+public:
+    MissionStateMachine();
+
+    MissionState getState() const { return (MissionState)state.load(std::memory_order_acquire); }
+    bool isStopped() const { return getState() == MISSION_EMERGENCY_STOP; }
+    uint8_t getStopReason() const { return stopReason.load(std::memory_order_relaxed); }
+    uint32_t getStoppedAt() const { return stoppedAt.load(std::memory_order_relaxed); }
+
+    // Main loop transitions; rejected while an emergency stop is latched
+    bool transition(MissionState next);
+
+    // ISR-safe; returns false if already stopped
+    bool emergencyStop(uint8_t reason, uint32_t now);
+    bool clearEmergency();
+
+    void setStopHook(EmergencyStopHook hook) { stopHook = hook; }
+
+    static const char* getStateName(MissionState s);
+};
+
+#endif // STATE_MACHINE_H
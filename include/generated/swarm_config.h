@@ -0,0 +1,122 @@
+// Generated by tools/deployment/config_generator.py from data/network_config.json,
+// data/hardware_pins.json, data/algorithm_parameters.json and data/drone_configs/.
+// Do not edit: pre_build.py rewrites it whenever the JSON changes.
+
+#ifndef SWARM_CONFIG_H
+#define SWARM_CONFIG_H
+
+#include <stdint.h>
+
+struct RadioConfig {
+    uint32_t frequencyHz;           // SX127x tuning range
+    uint32_t bandwidthHz;
+    uint8_t spreadingFactor;        // Starting SF; ADR_MIN_SF..ADR_MAX_SF
+    uint8_t codingRate;             // 4/x
+    uint16_t preambleLength;
+    int8_t txPowerDbm;              // PA_BOOST range
+    uint8_t syncWord;               // Swarm-wide: nodes on another word hear nothing
+};
+
+struct TimingConfig {
+    uint32_t heartbeatIntervalMs;
+    uint32_t heartbeatTimeoutMs;
+    uint32_t messageTimeoutMs;
+    uint32_t statsIntervalMs;
+};
+
+struct MissionConfig {
+    uint16_t areaSizeM;             // Square side
+    uint16_t targetDetectionRangeM;
+    uint16_t formationSpacingM;
+};
+
+struct LimitConfig {
+    uint8_t maxMessageRatePerSec;
+    uint8_t maxBandwidthUsagePercent;
+    uint8_t minBatteryLevelPercent;
+};
+
+struct PinConfig {
+    int8_t loraSs;
+    int8_t loraRst;
+    int8_t loraDio0;
+    int8_t gpsRx;
+    int8_t gpsTx;
+    int8_t statusLed;               // -1: none
+};
+
+struct SwarmConfig {
+    uint8_t maxDrones;
+    RadioConfig radio;
+    TimingConfig timing;
+    MissionConfig mission;
+    LimitConfig limits;
+};
+
+struct DroneConfig {
+    uint8_t id;
+    const char* name;
+    RadioConfig radio;                  // The swarm's, with this drone's overrides
+    PinConfig pins;
+};
+
+// Run-time override fields; the ids are on the wire
+enum ConfigField : uint8_t {
+    CONFIG_FIELD_MAX_TX_POWER_DBM = 1,
+    CONFIG_FIELD_HEARTBEAT_INTERVAL_MS = 2,
+};
+
+struct ConfigFieldLimits {
+    uint8_t field;
+    int32_t min;
+    int32_t max;
+};
+
+constexpr uint32_t SWARM_CONFIG_HASH = 0x95BAB6A6u;
+
+constexpr SwarmConfig SWARM_CONFIG = {
+    5,
+    {433000000, 125000, 7, 5, 8, 20, 0x12},
+    {2000, 6000, 5000, 10000},
+    {1000, 50, 100},
+    {10, 80, 20}
+};
+
+#define SWARM_CONFIG_DRONES 5
+constexpr DroneConfig DRONE_CONFIGS[SWARM_CONFIG_DRONES] = {
+    {1, "drone_1", {433000000, 125000, 7, 5, 8, 20, 0x12},
+     {5, 14, 2, 16, 17, 2}},   // esp32dev
+    {2, "drone_2", {433000000, 125000, 7, 5, 8, 20, 0x12},
+     {5, 14, 2, 16, 17, 2}},   // esp32dev
+    {3, "drone_3", {433000000, 125000, 7, 5, 8, 20, 0x12},
+     {5, 14, 2, 16, 17, 2}},   // esp32dev
+    {4, "drone_4", {433000000, 125000, 7, 5, 8, 20, 0x12},
+     {5, 14, 2, 16, 17, 2}},   // esp32dev
+    {5, "drone_5", {433000000, 125000, 7, 5, 8, 20, 0x12},
+     {5, 14, 2, 16, 17, 2}},   // esp32dev
+};
+
+#define CONFIG_FIELD_COUNT 2
+constexpr ConfigFieldLimits CONFIG_FIELD_LIMITS[CONFIG_FIELD_COUNT] = {
+    {CONFIG_FIELD_MAX_TX_POWER_DBM, 2, 20},         // ADR power cap, e.g. a lower EIRP limit
+    {CONFIG_FIELD_HEARTBEAT_INTERVAL_MS, 500, 60000},
+};
+
+// DRONE_ID (-D per env) picks the row; without one, the lowest id
+#if !defined(DRONE_ID)
+#define DRONE_CONFIG_INDEX 0
+#elif DRONE_ID == 1
+#define DRONE_CONFIG_INDEX 0
+#elif DRONE_ID == 2
+#define DRONE_CONFIG_INDEX 1
+#elif DRONE_ID == 3
+#define DRONE_CONFIG_INDEX 2
+#elif DRONE_ID == 4
+#define DRONE_CONFIG_INDEX 3
+#elif DRONE_ID == 5
+#define DRONE_CONFIG_INDEX 4
+#else
+#error "DRONE_ID has no data/drone_configs/drone_<id>_config.json"
+#endif
+
+#endif // SWARM_CONFIG_H
@@ -0,0 +1,88 @@
+#ifndef FLIGHT_REPLAY_H
+#define FLIGHT_REPLAY_H
+
+#ifndef ARDUINO
+
+#include <vector>
+#include "../utilities/flight_recorder.h"
+
+class MessageRegistry;
+
+// Ground-station side of the flight recorder. Maps a dump of the recorder
+// partition (esptool read_flash, or a RamFlash image) read-only, orders its
+// sectors by sequence number and walks their intact records oldest first,
+// rebuilding each record's clock from the sector header and the deltas.
+// replay() feeds the received frames back through a MessageRegistry, so the
+// same handlers that ran in flight can be run against the log.
+
+struct FlightEvent {
+    uint8_t kind;               // FlightRecordKind
+    uint32_t sector;            // Sequence of the sector it was read from
+    uint32_t timeMs;            // Recorder clock: millis() of the boot that wrote it
+    uint8_t length;
+    const uint8_t* body;        // Into the mapped dump
+};
+
+struct FlightReplayStats {
+    uint32_t sectors;
+    uint32_t sequenceGaps;      // Sectors missing between the oldest and newest
+    uint32_t events;
+    uint32_t boots;
+    uint32_t txFrames;
+    uint32_t rxFrames;
+    uint32_t states;
+    uint32_t timers;
+    uint32_t malformed;         // Intact framing, body too short for its kind
+    uint32_t dispatched;        // Received frames a registry handler took
+    uint32_t rejected;
+};
+
+typedef void (*FlightEventHandler)(const FlightEvent& event, void* context);
+
+// FLIGHT_TX and FLIGHT_RX records back to a DroneMessage with its checksum
+// restored; rssi and snr only for FLIGHT_RX. False for any other record.
+bool flightEventFrame(const FlightEvent& event, DroneMessage& msg, int16_t* rssi = nullptr, float* snr = nullptr);
+
+class FlightLog {
+private:
+    struct SectorRef {
+        uint32_t sequence;
+        uint32_t offset;
+    };
+
+    const uint8_t* image;
+    size_t length;
+    void* mapping;
+    size_t mappedLength;
+    std::vector<SectorRef> order;
+
+    void index();
+
+public:
+    FlightLog();
+    ~FlightLog();
+    FlightLog(const FlightLog&) = delete;
+    FlightLog& operator=(const FlightLog&) = delete;
+
+    bool open(const char* path);
+    // A dump already in memory; it must outlive the log
+    void attach(const uint8_t* image, size_t length);
+    void close();
+
+    uint32_t sectorCount() const { return (uint32_t)order.size(); }
+
+    // Every intact record, oldest first
+    FlightReplayStats forEach(FlightEventHandler handler, void* context) const;
+    // Sectors first .. first + count - 1 in sequence order, so a dump can be
+    // read in parallel; a record's clock only depends on its own sector
+    FlightReplayStats forEach(FlightEventHandler handler, void* context, uint32_t first, uint32_t count) const;
+    // Received frames go through `registry` in recorded order; every event,
+    // those included, then goes to `handler` if one is given
+    FlightReplayStats replay(MessageRegistry& registry, FlightEventHandler handler = nullptr, void* context = nullptr) const;
+
+    static const char* getKindName(uint8_t kind);
+};
+
+#endif // ARDUINO
+
+#endif // FLIGHT_REPLAY_H
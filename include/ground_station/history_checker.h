@@ -0,0 +1,160 @@
+#ifndef HISTORY_CHECKER_H
+#define HISTORY_CHECKER_H
+
+#ifndef ARDUINO
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Correctness checks over recorded operation histories, for flights (the
+// ground station's logs) and host simulations alike.
+//
+// Linearizability: every operation must appear to take effect at one
+// instant between its invocation and its response, in an order the object's
+// sequential model accepts. The search is Wing & Gong's with Lowe's
+// memoization, as in Porcupine: walk the call/return entries, linearize a
+// call whenever the model allows it, backtrack on a return whose operation
+// is not yet linearized, and never revisit a (linearized set, state) pair.
+// The set is keyed by its first gap and the words after it, so the cache
+// stays small on long histories with little concurrency. Keys are
+// independent objects, so the history is partitioned by key and the
+// partitions are checked in parallel, largest first.
+//
+// Mutual exclusion: per lock, no two clients' hold intervals (acquire
+// response to release invocation) overlap.
+//
+// Timestamps are hybrid logical clock values, so histories recorded on
+// drones with skewed clocks still order every causally related pair.
+
+typedef uint64_t HybridTime;            // Physical ms << 16 | logical counter
+#define HYBRID_PENDING UINT64_MAX       // Response never seen: may or may not have taken effect
+
+inline HybridTime hybridTime(uint64_t physicalMs, uint16_t logical) {
+    return physicalMs << 16 | logical;
+}
+
+// Kulkarni et al.'s HLC: physical time where it is ahead, a counter where
+// messages arrived from the future
+class HybridClock {
+private:
+    HybridTime last;
+
+public:
+    HybridClock() : last(0) {}
+    // Local event or send
+    HybridTime tick(uint64_t physicalMs) {
+        HybridTime now = hybridTime(physicalMs, 0);
+        last = now > last ? now : last + 1;
+        return last;
+    }
+    // Receipt of a message stamped `remote`
+    HybridTime receive(HybridTime remote, uint64_t physicalMs) {
+        HybridTime now = hybridTime(physicalMs, 0);
+        HybridTime newest = remote > last ? remote : last;
+        last = now > newest ? now : newest + 1;
+        return last;
+    }
+};
+
+enum HistoryOpKind : uint8_t {
+    HISTORY_READ = 1,           // output: the value read
+    HISTORY_WRITE,              // input: the value written
+    HISTORY_CAS,                // input: new value, expected; output: 1 if swapped
+    HISTORY_ACQUIRE,            // Mutex; the response is the grant
+    HISTORY_RELEASE
+};
+
+struct HistoryOp {
+    HybridTime call;
+    HybridTime ret;             // HYBRID_PENDING if no response
+    uint32_t key;               // Register or lock
+    uint16_t client;
+    uint8_t kind;               // HistoryOpKind
+    bool known;                 // Output seen; false for pending operations
+    int64_t input;
+    int64_t expected;
+    int64_t output;
+};
+
+enum HistoryVerdict : uint8_t {
+    HISTORY_OK = 0,
+    HISTORY_VIOLATION,
+    HISTORY_UNDECIDED           // Search budget ran out
+};
+
+struct HistoryKeyResult {
+    uint32_t key;
+    uint8_t verdict;
+    uint32_t operations;
+    uint64_t steps;
+    uint32_t blockingOp;        // Violation: index of the op whose response the deepest search could not pass
+    uint32_t linearized;        // Most operations any partial linearization reached
+};
+
+struct HistoryCheck {
+    uint8_t verdict;            // Worst over the keys
+    uint32_t operations;
+    uint32_t keys;
+    uint32_t violations;
+    uint32_t undecided;
+    uint64_t steps;
+    uint8_t threads;
+    double seconds;
+    std::vector<HistoryKeyResult> failures;     // Keys that are not HISTORY_OK
+};
+
+struct MutexViolation {
+    uint32_t key;
+    uint32_t first;             // Indices of the two acquires
+    uint32_t second;
+    HybridTime from;            // Both held between these
+    HybridTime to;
+};
+
+struct HistoryCheckerOptions {
+    uint8_t threads;            // 0: one per core
+    uint64_t maxStepsPerKey;
+    int64_t initialValue;       // Of every register
+};
+
+HistoryCheckerOptions historyCheckerDefaults();
+
+// Registers (read/write/CAS) and mutexes (acquire/release, state = holder)
+HistoryCheck checkLinearizable(const std::vector<HistoryOp>& history,
+                               const HistoryCheckerOptions& options = historyCheckerDefaults());
+std::vector<MutexViolation> checkMutualExclusion(const std::vector<HistoryOp>& history);
+
+// Records a history as a simulation runs; check it once run() returns
+class HistoryRecorder {
+private:
+    std::vector<HistoryOp> ops;
+
+public:
+    uint32_t invoke(uint16_t client, uint32_t key, uint8_t kind, int64_t input, int64_t expected, HybridTime now);
+    void complete(uint32_t id, int64_t output, HybridTime now);
+    const std::vector<HistoryOp>& history() const { return ops; }
+    void clear() { ops.clear(); }
+};
+
+// Text format, one operation per line, '#' comments:
+//   CALL RETURN CLIENT KEY read OUTPUT
+//   CALL RETURN CLIENT KEY write VALUE
+//   CALL RETURN CLIENT KEY cas VALUE EXPECTED SWAPPED
+//   CALL RETURN CLIENT KEY acquire
+//   CALL RETURN CLIENT KEY release
+// Times are PHYSICAL_MS.LOGICAL or PHYSICAL_MS; RETURN is '-' when no
+// response came and an unseen OUTPUT/SWAPPED is '?'.
+bool loadHistory(const char* path, std::vector<HistoryOp>& out, std::string* error = nullptr);
+bool saveHistory(const char* path, const std::vector<HistoryOp>& history);
+
+// A linearizable register history for tests and throughput runs: `clients`
+// sequential clients on `keys` registers, each operation taking effect at a
+// random instant within its own interval, concurrency from overlapping
+// intervals
+void synthesizeHistory(uint32_t operations, uint16_t clients, uint32_t keys, uint32_t seed,
+                       std::vector<HistoryOp>& out);
+
+#endif // ARDUINO
+
+#endif // HISTORY_CHECKER_H
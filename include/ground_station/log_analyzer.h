@@ -0,0 +1,202 @@
+#ifndef LOG_ANALYZER_H
+#define LOG_ANALYZER_H
+
+#ifndef ARDUINO
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "flight_replay.h"
+
+// Post-flight analysis over many drones' logs at once. Two kinds of file,
+// told apart by their first bytes:
+//   - serial captures of the [COMM]/[TX]/[RX] lines, with or without the
+//     "HH:MM:SS.mmm > " prefix of `pio device monitor --filter time`
+//   - flight recorder dumps (esptool read_flash of the recorder partition)
+// Files are mapped read-only and cut into chunks, text at line starts and
+// dumps at sector boundaries, that a pool of threads parses in parallel.
+// Chunks are parsed a wave at a time and reduced per file, in order, to TX
+// and RX records, so memory follows the frame count rather than the bytes.
+//
+// Frames are then joined across drones, one thread per group of sources:
+// an RX is the TX with the same source, type and sequence number, and
+// sequence wrap and reboots are told apart by the frame timestamp (dumps)
+// or by wall-clock time within LOG_JOIN_WINDOW_MS (timed captures). Each
+// boot of a dump has its own clock; the offset between two of them is
+// estimated from the fastest frame each way, as NTP does, and latencies on
+// a link heard only one way are relative to its fastest frame.
+//
+// Reports: per-drone counters, per-link delivery ratio (frames the sender
+// logged that the receiver logged too) and latency percentiles and
+// histogram, and RSSI by distance from the positions in heartbeats. All
+// are written as CSV.
+
+#define LOG_JOIN_WINDOW_MS 30000        // Timed captures: TX and RX at most this far apart
+#define LOG_POSITION_MAX_AGE_MS 30000   // A peer's heartbeat position is used this long
+#define LOG_LATENCY_BIN_MS 10
+#define LOG_LATENCY_BINS 100            // The last one takes everything slower
+#define LOG_DISTANCE_BIN_M 50
+#define LOG_DISTANCE_BINS 60
+#define LOG_WALL_DOMAIN 0               // Clock of every timed capture
+#define LOG_NO_NODE 0
+
+enum LogEventKind : uint8_t {
+    LOG_BOOT = 1,               // "Node ID" line or FLIGHT_BOOT: node, new clock
+    LOG_TX,
+    LOG_RX,
+    LOG_POSITION,               // The logging drone's own, from its heartbeat
+    LOG_PEER_POSITION,          // From the heartbeat in the RX just before
+    LOG_REJECTED,               // Bad tag, replay or checksum
+    LOG_DROPPED                 // Channel busy or the send failed
+};
+
+#define LOG_FLAG_TIME 0x01              // timeMs is known
+#define LOG_FLAG_FRAME_TIME 0x02        // frameTime is known (dumps)
+#define LOG_FLAG_SIGNAL 0x04            // rssi and snr are known
+
+// One parsed line or record
+struct LogEvent {
+    uint32_t timeMs;            // Wall clock (captures) or recorder clock (dumps)
+    uint32_t frameTime;         // DroneMessage::timestamp
+    int32_t latE7;
+    int32_t lonE7;
+    uint16_t sequence;
+    int16_t rssi;
+    int8_t snrQuarterDb;
+    uint8_t kind;               // LogEventKind
+    uint8_t flags;
+    uint8_t node;               // BOOT: the logging drone; TX/RX: the source, LOG_NO_NODE if unknown
+    uint8_t destination;
+    uint8_t type;
+};
+
+struct LogDroneReport {
+    uint8_t node;
+    uint32_t files;
+    uint32_t boots;
+    uint64_t tx;
+    uint64_t rx;
+    uint64_t rejected;
+    uint64_t dropped;
+};
+
+struct LogLinkReport {
+    uint8_t source;
+    uint8_t receiver;
+    uint64_t sent;              // TX frames the source logged addressed to the receiver or all
+    uint64_t delivered;         // Of those, logged by the receiver
+    float deliveryRatio;
+    uint64_t latencySamples;
+    bool latencyAligned;        // False: relative to the link's fastest frame
+    float latencyP50Ms;
+    float latencyP90Ms;
+    float latencyP99Ms;
+    float latencyMaxMs;
+    uint32_t latencyHistogram[LOG_LATENCY_BINS];
+    uint64_t rssiSamples;       // Every RX from the source, joined or not
+    float meanRssi;
+    float meanSnr;
+};
+
+struct LogDistanceBin {
+    uint32_t fromM;
+    uint64_t frames;
+    float meanRssi;
+    float meanSnr;
+    int16_t minRssi;
+    int16_t maxRssi;
+};
+
+struct LogAnalysis {
+    uint32_t files;
+    uint64_t bytes;
+    uint64_t lines;             // Captures
+    uint64_t records;           // Dumps
+    uint64_t txFrames;
+    uint64_t rxFrames;
+    uint64_t joined;
+    uint64_t unjoined;          // No TX logged for it
+    uint64_t ambiguous;         // Several TX fit and nothing told them apart
+    uint64_t unattributed;      // Capture with no "Node ID" line and no hint
+    uint8_t threads;
+    double parseSeconds;
+    double joinSeconds;
+    std::vector<LogDroneReport> drones;
+    std::vector<LogLinkReport> links;
+    std::vector<LogDistanceBin> rssiByDistance;
+};
+
+struct LogAnalyzerOptions {
+    uint8_t threads;            // 0: one per core
+    uint32_t chunkBytes;        // Text is cut about this often
+    uint32_t sectorsPerChunk;
+    uint32_t chunksPerWave;     // Per thread; bounds the parsed events in memory
+};
+
+LogAnalyzerOptions logAnalyzerDefaults();
+
+class LogAnalyzer {
+private:
+    struct Source {
+        std::string name;
+        const uint8_t* data;
+        size_t length;
+        void* mapping;
+        bool dump;
+        uint8_t nodeHint;
+    };
+
+    LogAnalyzerOptions options;
+    std::vector<Source> sources;
+
+public:
+    explicit LogAnalyzer(const LogAnalyzerOptions& options = logAnalyzerDefaults());
+    ~LogAnalyzer();
+    LogAnalyzer(const LogAnalyzer&) = delete;
+    LogAnalyzer& operator=(const LogAnalyzer&) = delete;
+
+    // nodeHint names the drone of a capture that starts after its "Node
+    // ID" line; LOG_NO_NODE takes it from the log
+    bool addFile(const char* path, uint8_t nodeHint = LOG_NO_NODE);
+    // Already in memory; it must outlive run()
+    void addBuffer(const char* name, const uint8_t* data, size_t length, uint8_t nodeHint = LOG_NO_NODE);
+    uint32_t fileCount() const { return (uint32_t)sources.size(); }
+
+    LogAnalysis run() const;
+
+    // drones.csv, links.csv, latency.csv, rssi_distance.csv
+    static bool writeCsv(const LogAnalysis& analysis, const char* directory);
+};
+
+// Parses one chunk; exposed for tests. `data` .. `end` is the whole file,
+// so a line may look at its neighbours across the chunk edge.
+uint64_t parseLogText(const char* data, const char* end, const char* from, const char* to,
+                      std::vector<LogEvent>& out);
+uint64_t parseLogDump(const FlightLog& log, uint32_t firstSector, uint32_t sectorCount,
+                      std::vector<LogEvent>& out);
+
+// Synthetic log set for tests and throughput runs: drones at fixed random
+// spots, every one broadcasting a heartbeat a second with log-distance
+// RSSI, distance-dependent loss and 92-132 ms latency, each drone's clock
+// from its own boot. Writes drone_<id>.log (captures) or drone_<id>.bin
+// (dumps) into `directory` until about `totalBytes` are written.
+struct LogSynthesisOptions {
+    uint8_t drones;
+    bool dumps;
+    uint64_t totalBytes;
+    uint32_t seed;
+};
+
+struct LogSynthesisTruth {
+    uint64_t bytes;
+    uint32_t seconds;
+    std::vector<uint64_t> sent;         // [source * 256 + receiver]
+    std::vector<uint64_t> delivered;
+};
+
+bool synthesizeLogs(const char* directory, const LogSynthesisOptions& options, LogSynthesisTruth* truth);
+
+#endif // ARDUINO
+
+#endif // LOG_ANALYZER_H
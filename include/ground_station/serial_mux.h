@@ -0,0 +1,138 @@
+#ifndef SERIAL_MUX_H
+#define SERIAL_MUX_H
+
+#ifndef ARDUINO
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "../utilities/serial_tap.h"
+#include "swarm_state.h"
+#include "telemetry_collector.h"
+
+// Ground station multiplexer: many drones' USB serial consoles (or ptys
+// standing in for them) on one epoll loop, decoded as the bytes arrive and
+// published to the shared-memory swarm state (see swarm_state.h).
+//
+// A stream carries log text with serial tap records mixed in (see
+// utilities/serial_tap.h). Each stream has its own StreamDecoder that keeps
+// only the unfinished line or record between reads. Records update the
+// tables: boots name the stream's drone, frames it sent or heard update
+// the link matrix, heartbeats the drone rows, and status telemetry a drone
+// asked for over the air (an RX of MSG_STATUS_RESPONSE addressed to the
+// stream's drone) its peer count and peer links. Text is published as
+// lines; a "[COMM] Node ID:" line names the drone when the tap is off.
+
+typedef void (*StreamLineHandler)(const char* line, size_t length, bool truncated, void* context);
+typedef void (*StreamRecordHandler)(const FlightRecordView& record, void* context);
+
+struct StreamDecoderStats {
+    uint64_t bytes;
+    uint64_t lines;
+    uint64_t records;
+    uint64_t corrupt;           // Sync byte without an intact record after it
+};
+
+class StreamDecoder {
+private:
+    uint8_t buffer[GROUND_LINE_MAX + SERIAL_TAP_MAX_BYTES];
+    size_t used;
+    StreamDecoderStats stats;
+
+    void emitLine(const uint8_t* line, size_t length, bool truncated, StreamLineHandler onLine, void* context);
+
+public:
+    StreamDecoder();
+
+    // Any split of the stream into calls gives the same lines and records.
+    // A line interrupted by a record comes out as two.
+    void feed(const uint8_t* data, size_t length, StreamLineHandler onLine, StreamRecordHandler onRecord,
+              void* context);
+    void reset();
+    StreamDecoderStats getStats() const { return stats; }
+};
+
+struct SerialMuxOptions {
+    const char* shmName;
+    uint32_t ringSlots;
+    uint32_t baud;              // Real serial devices; ptys ignore it
+};
+
+SerialMuxOptions serialMuxDefaults();
+
+struct SerialMuxStats {
+    uint32_t streams;
+    uint32_t openStreams;
+    uint64_t bytes;
+    uint64_t lines;
+    uint64_t frames;
+    uint64_t corrupt;
+    uint64_t wakeups;           // epoll_wait returns with work
+    uint64_t reads;
+    uint64_t events;            // Published to the ring
+};
+
+class SerialMux {
+private:
+    struct Stream {
+        int fd;
+        std::string name;
+        StreamDecoder decoder;
+        SwarmStream published;
+        uint32_t tapClockMs;    // Drone clock from the tap's boot record and deltas
+    };
+
+    SerialMuxOptions options;
+    int epollFd;
+    std::vector<Stream*> streams;
+    SwarmStateWriter writer;
+    SwarmDrone drones[SWARM_NODES];
+    std::vector<SwarmLink> links;        // [receiver * SWARM_NODES + source]
+    std::map<uint8_t, TelemetryCollector*> collectors;  // By requester
+    SerialMuxStats stats;
+    uint64_t nowNs;
+
+    // Decoder callbacks; context is the mux, `current` the stream being fed
+    uint16_t current;
+    static void onLine(const char* line, size_t length, bool truncated, void* context);
+    static void onRecord(const FlightRecordView& record, void* context);
+    void handleLine(Stream& stream, const char* line, size_t length, bool truncated);
+    void handleRecord(Stream& stream, const FlightRecordView& record);
+    void handleFrame(Stream& stream, const DroneMessage& msg, bool transmitted, int16_t rssi, int8_t snrQuarterDb);
+    void handleTelemetry(uint8_t requester, const DroneMessage& msg);
+    void setStreamNode(Stream& stream, uint8_t node);
+    SwarmDrone& drone(uint8_t id);
+    void closeStream(uint16_t index);
+    void readStream(uint16_t index);
+
+public:
+    SerialMux();
+    ~SerialMux();
+    SerialMux(const SerialMux&) = delete;
+    SerialMux& operator=(const SerialMux&) = delete;
+
+    // Creates the shared-memory segment and the epoll set
+    bool begin(const SerialMuxOptions& options = serialMuxDefaults());
+    void end();
+
+    // A serial device, set raw at options.baud; returns the stream index or -1
+    int addDevice(const char* path);
+    // Any readable descriptor (a pty master, a socket); the mux owns it
+    int addDescriptor(int fd, const char* name);
+
+    // Waits up to timeoutMs for input and handles all of it; returns the
+    // streams that had data
+    uint32_t poll(int timeoutMs);
+
+    const SwarmDrone& getDrone(uint8_t id) const { return drones[id]; }
+    const SwarmLink& getLink(uint8_t receiver, uint8_t source) const {
+        return links[receiver * SWARM_NODES + source];
+    }
+    SerialMuxStats getStats() const { return stats; }
+};
+
+#endif // ARDUINO
+
+#endif // SERIAL_MUX_H
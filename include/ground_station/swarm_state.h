@@ -0,0 +1,203 @@
+#ifndef SWARM_STATE_H
+#define SWARM_STATE_H
+
+#ifndef ARDUINO
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "../communications.h"
+#include "../config.h"
+
+// Live swarm state in POSIX shared memory: one writer (the ground station
+// daemon), any number of viewers that map it read-only and never block it.
+//
+//   header | streams[SWARM_MAX_STREAMS] | drones[256] | links[256][256]
+//          | event ring[slots]
+//
+// Tables: a row per serial stream, per drone (position, battery and status
+// from its heartbeats) and per directed link (receiver row, source column:
+// frames heard, last RSSI/SNR). Each entry has its own sequence lock, so a
+// viewer copies out a consistent entry and retries only if the writer was
+// in that same entry meanwhile.
+//
+// Event ring: every frame, boot and log line, in arrival order. The writer
+// overwrites the oldest slot without waiting for anyone; a slot's sequence
+// is odd while it is written and 2 * (index + 1) once event `index` is in
+// it. Viewers read events in place and confirm afterwards that the slot
+// was not reused under them; a viewer that falls more than a ring behind
+// skips ahead and counts what it lost.
+
+#define SWARM_SHM_MAGIC 0x4D525753u      // "SWRM"
+#define SWARM_SHM_VERSION 1
+#define SWARM_NO_STREAM 0xFFFF
+#define SWARM_NODES 256
+
+enum SwarmEventKind : uint8_t {
+    SWARM_EVENT_FRAME = 1,      // A tap record: frame sent by `node`, or heard by it
+    SWARM_EVENT_BOOT,           // `node` (re)started on `stream`
+    SWARM_EVENT_LINE,           // A log line, cut at SWARM_LINE_BYTES
+    SWARM_EVENT_STREAM          // Stream opened (flags SWARM_FLAG_OPEN) or closed
+};
+
+#define SWARM_FLAG_TX 0x01              // FRAME: sent by `node` rather than heard
+#define SWARM_FLAG_TRUNCATED 0x02       // LINE: longer than SWARM_LINE_BYTES
+#define SWARM_FLAG_OPEN 0x04            // STREAM
+
+#define SWARM_LINE_BYTES 48
+
+struct SwarmEvent {
+    uint64_t receivedNs;        // Ground clock, CLOCK_MONOTONIC
+    uint16_t stream;
+    uint8_t kind;               // SwarmEventKind
+    uint8_t node;               // Drone on the stream, 0 until it says
+    int16_t rssi;               // FRAME heard
+    int8_t snrQuarterDb;
+    uint8_t flags;
+    uint8_t lineLength;
+    uint8_t reserved[7];
+    union {
+        DroneMessage frame;     // Checksum recomputed
+        char line[SWARM_LINE_BYTES];
+    };
+};
+
+struct SwarmStream {
+    char name[40];
+    uint8_t node;
+    bool open;
+    uint64_t bytes;
+    uint64_t lines;
+    uint64_t records;
+    uint64_t corrupt;           // Tap records that failed their CRC
+    uint64_t lastNs;
+};
+
+struct SwarmDrone {
+    uint8_t id;
+    bool known;
+    uint8_t status;             // HeartbeatData::status
+    uint8_t missionState;
+    uint16_t stream;            // Wired to, SWARM_NO_STREAM if only heard over the air
+    uint8_t peerCount;          // From its last status telemetry
+    float battery;
+    float latitude;
+    float longitude;
+    uint64_t lastHeardNs;       // Any frame from it, sent or heard
+    uint64_t lastHeartbeatNs;
+    uint32_t framesSent;
+    uint32_t framesHeard;       // By the drones it is wired next to
+    uint32_t uptimeMs;          // Status telemetry
+};
+
+struct SwarmLink {
+    uint32_t frames;            // Heard by the receiver on its tap, 0 for telemetry-only links
+    int16_t rssi;
+    int8_t snrQuarterDb;
+    bool fromTelemetry;         // Last values from the receiver's peer table
+    uint64_t lastNs;
+};
+
+struct SwarmShmHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t maxStreams;
+    uint32_t ringSlots;         // Power of two
+    uint32_t eventBytes;        // sizeof(SwarmEvent), checked on attach
+    uint64_t totalBytes;
+    int32_t writerPid;
+    std::atomic<uint64_t> published;    // Events written so far
+    std::atomic<uint64_t> generation;   // Bumped on every table change
+};
+
+template <typename T>
+struct SwarmSeqEntry {
+    std::atomic<uint32_t> sequence;
+    T value;
+};
+
+struct SwarmEventSlot {
+    std::atomic<uint64_t> sequence;
+    SwarmEvent event;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory needs address-free atomics");
+
+// Creates (or replaces) the segment; the daemon's side
+class SwarmStateWriter {
+private:
+    uint8_t* base;
+    size_t length;
+    char name[64];
+    SwarmShmHeader* header;
+    SwarmSeqEntry<SwarmStream>* streams;
+    SwarmSeqEntry<SwarmDrone>* drones;
+    SwarmSeqEntry<SwarmLink>* links;
+    SwarmEventSlot* ring;
+    uint64_t published;
+
+public:
+    SwarmStateWriter();
+    ~SwarmStateWriter();
+    SwarmStateWriter(const SwarmStateWriter&) = delete;
+    SwarmStateWriter& operator=(const SwarmStateWriter&) = delete;
+
+    // ringSlots is rounded up to a power of two
+    bool create(const char* shmName, uint32_t ringSlots);
+    // Unmaps and unlinks
+    void close();
+    bool isOpen() const { return base != nullptr; }
+
+    void publish(const SwarmEvent& event);
+    void writeStream(uint16_t index, const SwarmStream& value);
+    void writeDrone(uint8_t id, const SwarmDrone& value);
+    void writeLink(uint8_t receiver, uint8_t source, const SwarmLink& value);
+    uint64_t getPublished() const { return published; }
+};
+
+// Attaches read-only; the viewers' side
+class SwarmViewer {
+private:
+    const uint8_t* base;
+    size_t length;
+    const SwarmShmHeader* header;
+    const SwarmSeqEntry<SwarmStream>* streams;
+    const SwarmSeqEntry<SwarmDrone>* drones;
+    const SwarmSeqEntry<SwarmLink>* links;
+    const SwarmEventSlot* ring;
+    uint64_t cursor;
+    uint64_t lost;
+
+public:
+    SwarmViewer();
+    ~SwarmViewer();
+    SwarmViewer(const SwarmViewer&) = delete;
+    SwarmViewer& operator=(const SwarmViewer&) = delete;
+
+    // Starts at the oldest event still in the ring, or at the newest
+    bool attach(const char* shmName, bool fromNewest = false);
+    void detach();
+    bool isAttached() const { return base != nullptr; }
+
+    // Next event, in place; valid until confirm(). False when caught up.
+    bool next(const SwarmEvent*& event);
+    // True if the event just returned by next() was not overwritten while
+    // it was being read; either way the cursor moves past it
+    bool confirm();
+    uint64_t getLost() const { return lost; }
+    uint64_t backlog() const;
+    uint64_t generation() const { return header->generation.load(std::memory_order_acquire); }
+    uint16_t maxStreams() const { return header->maxStreams; }
+
+    // Copies of table entries; false if the writer kept it busy too long
+    bool readStream(uint16_t index, SwarmStream& out) const;
+    bool readDrone(uint8_t id, SwarmDrone& out) const;
+    bool readLink(uint8_t receiver, uint8_t source, SwarmLink& out) const;
+};
+
+// CLOCK_MONOTONIC, as in SwarmEvent::receivedNs
+uint64_t swarmClockNs();
+
+#endif // ARDUINO
+
+#endif // SWARM_STATE_H
@@ -0,0 +1,82 @@
+#ifndef TELEMETRY_COLLECTOR_H
+#define TELEMETRY_COLLECTOR_H
+
+#ifndef ARDUINO
+
+#include <stdio.h>
+#include <map>
+#include <vector>
+#include "../communications/status_service.h"
+
+// Ground-station side of the status service. Polls drones with
+// MSG_STATUS_REQUEST naming the snapshot it holds, reassembles the
+// fragmented replies, applies the deltas and appends one point per
+// completed snapshot to each drone's time series. A reply that is missing
+// fragments is dropped; the next request names the old snapshot again and
+// the drone answers relative to that.
+
+struct TelemetryPoint {
+    uint32_t receivedAt;        // Ground clock
+    uint16_t snapshotId;
+    bool resync;
+    uint8_t frames;
+    uint32_t counters[TEL_COUNTER_COUNT];
+    PerfSummary probes[PERF_PROBE_COUNT];   // Since the previous point; maxNs is since boot
+    uint8_t peerCount;
+};
+
+struct CollectorStats {
+    uint32_t requests;
+    uint32_t framesReceived;
+    uint32_t snapshotsApplied;
+    uint32_t resyncs;
+    uint32_t incomplete;        // Replies abandoned with fragments missing
+    uint32_t baseMismatches;
+    uint32_t malformed;
+};
+
+class TelemetryCollector {
+private:
+    struct DroneTelemetry {
+        uint16_t heldSnapshot;  // 0: nothing yet
+        TelemetrySnapshot state;
+
+        uint16_t pendingId;
+        uint16_t pendingBase;
+        uint8_t pendingCount;
+        uint32_t pendingMask;
+        size_t pendingLength;
+        uint8_t pending[TELEMETRY_STREAM_BYTES];
+
+        std::vector<TelemetryPoint> series;
+    };
+
+    uint8_t selfId;
+    uint16_t sequence;
+    std::map<uint8_t, DroneTelemetry> drones;
+    CollectorStats stats;
+
+    void complete(uint8_t droneId, DroneTelemetry& drone, uint32_t now);
+
+public:
+    explicit TelemetryCollector(uint8_t selfId);
+
+    void buildRequest(uint8_t droneId, uint32_t now, DroneMessage& out);
+
+    // True when the frame completed a snapshot
+    bool onFrame(const DroneMessage& msg, uint32_t now);
+
+    const std::vector<TelemetryPoint>* getSeries(uint8_t droneId) const;
+    const TelemetrySnapshot* getState(uint8_t droneId) const;
+    CollectorStats getStats() const { return stats; }
+
+    // One CSV row per point
+    void writeCsv(uint8_t droneId, FILE* out) const;
+};
+
+// Quantiles over raw telemetry buckets, converted with TEL_CYCLES_PER_US
+PerfSummary telemetrySummarize(const uint32_t* buckets, uint32_t maxCycles, uint32_t cyclesPerUs);
+
+#endif // ARDUINO
+
+#endif // TELEMETRY_COLLECTOR_H
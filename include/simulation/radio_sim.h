@@ -0,0 +1,158 @@
+#ifndef RADIO_SIM_H
+#define RADIO_SIM_H
+
+#ifndef ARDUINO
+
+#include <functional>
+#include <queue>
+#include <random>
+#include <vector>
+#include "../communications/lora_interface.h"
+
+// Discrete-event model of one shared LoRa channel for host-side swarm tests.
+// Nodes hear each other within a fixed range, optionally with random packet
+// loss. A frame is received only if the receiver did not transmit at any
+// point during it and no other audible frame overlapped it. There is no
+// capture effect, so collision results are pessimistic.
+//
+// With a link budget set, range is replaced by log-distance path loss: a
+// frame is heard when its SNR, after per-pair shadowing and per-frame
+// fading, clears the demodulation floor of its spreading factor at the
+// sender's TX power. Frames on different spreading factors neither decode
+// nor collide, and a frame survives an overlap when it is SIM_CAPTURE_DB
+// stronger than every interferer.
+//
+// A radio that is not listening (setListening) misses every frame whose
+// preamble it was not in receive for; detectPreamble() is its CAD.
+
+struct SimLinkBudget {
+    float referenceLossDb;      // Path loss at 1 m
+    float pathLossExponent;
+    float shadowingDb;          // Sigma, fixed per node pair
+    float fadingDb;             // Sigma, drawn per frame and receiver
+};
+
+struct SimFrame {
+    uint32_t id;
+    uint8_t sender;
+    uint64_t startUs;
+    uint64_t endUs;             // Cut short when aborted
+    uint64_t preambleEndUs;
+    bool aborted;
+    uint8_t spreadingFactor;
+    int8_t txPowerDbm;
+    int16_t rssi;               // At the receiver, for receive handlers
+    float snr;
+    std::vector<uint8_t> payload;
+};
+
+struct RadioSimStats {
+    uint32_t framesSent;
+    uint32_t framesAborted;
+    uint32_t deliveries;
+    uint32_t collisions;        // Receiver-side losses to overlapping frames
+    uint32_t halfDuplexLosses;  // Receiver was transmitting itself
+    uint32_t randomLosses;
+    uint32_t fadeLosses;        // Link budget: usually audible, not this time
+    uint32_t asleepLosses;      // Receiver was not listening for the preamble
+};
+
+class RadioSim {
+public:
+    typedef std::function<void(uint8_t node, const SimFrame& frame)> FrameHandler;
+
+private:
+    struct Event {
+        uint64_t at;
+        uint64_t order;         // FIFO among events at the same time
+        std::function<void()> fn;
+        bool operator>(const Event& other) const {
+            return at != other.at ? at > other.at : order > other.order;
+        }
+    };
+
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    uint64_t nowUs;
+    uint64_t eventOrder;
+    uint8_t nodeCount;
+    std::vector<float> posX, posY;
+    std::vector<uint32_t> currentTx;    // Frame id, 0 = idle
+    float range;
+    float packetReception;
+    LoRaPhyConfig phy;
+    bool linkBudget;
+    SimLinkBudget budget;
+    float noiseFloorDbm;
+    std::vector<float> shadowing;       // nodeCount x nodeCount, symmetric
+    std::vector<uint8_t> nodeSf;
+    std::vector<int8_t> txPowerDbm;
+    std::vector<double> txEnergyMj;
+    std::vector<uint64_t> listeningSince;   // UINT64_MAX while not listening
+    std::vector<SimFrame> frames;       // In flight or recently finished
+    uint32_t nextFrameId;
+    std::mt19937 random;
+    FrameHandler rxHandler;
+    FrameHandler txDoneHandler;
+    RadioSimStats stats;
+
+    SimFrame* findFrame(uint32_t id);
+    void finishFrame(uint32_t id);
+    void pruneFrames();
+    void chargeTx(const SimFrame& frame);
+
+public:
+    RadioSim(uint8_t nodes, uint32_t seed);
+
+    // Topology
+    void setPosition(uint8_t node, float x, float y);
+    bool placeRandom(float areaM, int attempts = 100);     // Retries until connected
+    void setRange(float meters) { range = meters; }
+    void setPacketReception(float prr) { packetReception = prr; }
+    bool inRange(uint8_t a, uint8_t b) const;
+    bool isConnected();
+    uint8_t hopsFrom(uint8_t source, std::vector<uint8_t>& hops);    // Returns eccentricity
+    void setLinkBudget(const SimLinkBudget& model);
+    float meanRxDbm(uint8_t from, uint8_t to, int8_t powerDbm) const;
+    float getNoiseFloorDbm() const { return noiseFloorDbm; }
+
+    // Radio
+    void setPhy(const LoRaPhyConfig& config);
+    const LoRaPhyConfig& getPhy() const { return phy; }
+    // Per node; setPhy() resets every node to its spreading factor
+    void setSpreadingFactor(uint8_t node, uint8_t sf) { nodeSf[node] = sf; }
+    uint8_t getSpreadingFactor(uint8_t node) const { return nodeSf[node]; }
+    void setTxPower(uint8_t node, int8_t dbm) { txPowerDbm[node] = dbm; }
+    int8_t getTxPower(uint8_t node) const { return txPowerDbm[node]; }
+    double getTxEnergyMj(uint8_t node) const { return txEnergyMj[node]; }
+    uint32_t airtimeUs(uint8_t bytes) const { return loraAirtimeUs(phy, bytes); }
+    // 0 if busy; preambleSymbols 0 is the PHY's own
+    uint32_t transmit(uint8_t node, const void* data, uint8_t length, uint16_t preambleSymbols = 0);
+    bool abortTransmit(uint8_t node);
+    bool isTransmitting(uint8_t node) const { return currentTx[node] != 0; }
+    bool channelBusy(uint8_t node) const;       // Oracle: any audible frame on air
+    // What the radio can actually tell: CAD sees any same-SF frame it could
+    // decode, the RSSI check any frame at or above rssiBusyDbm whatever its
+    // SF (range mode: SIM_NOMINAL_RSSI_DBM when in range)
+    bool senseChannel(uint8_t node, int16_t rssiBusyDbm) const;
+    // Every node listens from the start; asleep, it hears nothing
+    void setListening(uint8_t node, bool listening);
+    bool isListening(uint8_t node) const { return listeningSince[node] != UINT64_MAX; }
+    // CAD: a same-SF frame it could decode is in its preamble right now
+    bool detectPreamble(uint8_t node) const;
+    void onReceive(FrameHandler handler) { rxHandler = handler; }
+    void onTxDone(FrameHandler handler) { txDoneHandler = handler; }
+
+    // Events
+    uint64_t now() const { return nowUs; }
+    void at(uint64_t timeUs, std::function<void()> fn);
+    void after(uint64_t delayUs, std::function<void()> fn) { at(nowUs + delayUs, fn); }
+    void run(uint64_t untilUs);
+
+    uint8_t getNodeCount() const { return nodeCount; }
+    std::mt19937& rng() { return random; }
+    RadioSimStats getStats() const { return stats; }
+};
+
+#endif // !ARDUINO
+
+#endif // RADIO_SIM_H
@@ -0,0 +1,151 @@
+#ifndef DETECTION_INTERFACE_H
+#define DETECTION_INTERFACE_H
+
+#include "../communications.h"
+#include "../config.h"
+#include "sensor_integration.h"
+
+// On-board target detection from small single-channel sensor frames.
+// Detectors plug in behind TargetDetector; the default one is a tiny int8
+// CNN whose layers all reduce to one int8 dot-product kernel (convolutions
+// go through im2col). Quantization follows the TFLite int8 scheme -
+// symmetric per-tensor weights, int32 bias, Q31 multiplier + shift - so on
+// the ESP32-S3 performance_test build the layers can go straight to esp-nn's
+// vector kernels, and on host the kernel uses GCC vector extensions.
+
+#define DETECTION_FRAME_PIXELS (DETECTION_FRAME_SIZE * DETECTION_FRAME_SIZE)
+#define DETECTION_LAYER_COUNT 4
+
+struct DetectionFrame {
+    uint32_t timestamp;
+    uint16_t frameId;
+    float latitude;             // Where the frame was taken
+    float longitude;
+    uint8_t pixels[DETECTION_FRAME_PIXELS];
+};
+
+struct DetectionResult {
+    uint16_t frameId;
+    uint8_t targetClass;
+    uint8_t confidence;         // 0-255
+    bool detected;
+};
+
+struct LayerProfile {
+    const char* name;
+    uint32_t calls;             // Frames run through the layer
+    uint64_t totalNs;
+    uint32_t macsPerFrame;
+};
+
+class TargetDetector {
+public:
+    virtual ~TargetDetector() {}
+    virtual bool begin() = 0;
+    virtual const char* getName() const = 0;
+    virtual void detectBatch(const DetectionFrame* frames, uint8_t count, DetectionResult* results) = 0;
+};
+
+// Float reference network:
+//   conv 4x4/2 (1->16) ReLU -> conv 3x3/1 (16->16) ReLU -> dense 400->32 ReLU -> dense 32->2
+struct FloatDetectionModel {
+    float conv1W[16][16];   float conv1B[16];
+    float conv2W[16][144];  float conv2B[16];
+    float dense1W[32][400]; float dense1B[32];
+    float dense2W[2][32];   float dense2B[2];
+
+    // Deterministic placeholder weights until a trained export is loaded
+    void initDefault(uint32_t seed);
+    bool load(const float* blob, size_t count);
+
+    // layerMax (optional) receives the largest |activation| of each layer
+    void run(const DetectionFrame& frame, float logits[2], float* layerMax = nullptr) const;
+};
+
+struct QuantizedLayer {
+    const int8_t* weights;      // rows x cols, row-major
+    const int32_t* bias;
+    int32_t multiplier;         // Q31
+    int32_t shift;              // Positive = left shift
+    uint16_t rows;
+    uint16_t cols;
+    bool relu;
+};
+
+// Kernel entry points, exposed for tests and benchmarks
+int32_t dotProductS8(const int8_t* a, const int8_t* b, uint16_t length);
+int32_t dotProductS8Scalar(const int8_t* a, const int8_t* b, uint16_t length);
+int8_t requantizeS8(int32_t accumulator, int32_t multiplier, int32_t shift, bool relu);
+void quantizeMultiplier(double realMultiplier, int32_t& multiplier, int32_t& shift);
+void denseS8(const int8_t* input, const QuantizedLayer& layer, int8_t* output);
+
+class QuantizedCnnDetector : public TargetDetector {
+private:
+    int8_t conv1W[16 * 16];     int32_t conv1B[16];
+    int8_t conv2W[16 * 144];    int32_t conv2B[16];
+    int8_t dense1W[32 * 400];   int32_t dense1B[32];
+    int8_t dense2W[2 * 32];     int32_t dense2B[2];
+
+    QuantizedLayer layers[DETECTION_LAYER_COUNT];
+    LayerProfile profile[DETECTION_LAYER_COUNT];
+    float outputScale;
+    bool ready;
+
+    // Ping-pong activations for a whole batch, plus one im2col scratch
+    int8_t bufferA[DETECTION_BATCH_SIZE][7 * 7 * 16];
+    int8_t bufferB[DETECTION_BATCH_SIZE][7 * 7 * 16];
+    int8_t patches[5 * 5 * 144];
+
+public:
+    QuantizedCnnDetector();
+
+    // Calibrates activation ranges on sample frames, then quantizes weights
+    bool quantize(const FloatDetectionModel& model, const DetectionFrame* calibration, uint16_t count);
+
+    bool begin() override;
+    const char* getName() const override { return "int8-cnn"; }
+    void detectBatch(const DetectionFrame* frames, uint8_t count, DetectionResult* results) override;
+
+    // Dequantized logits of one frame, for golden-output comparison
+    void run(const DetectionFrame& frame, float logits[2]);
+
+    const LayerProfile* getProfile() const { return profile; }
+    void resetProfile();
+    void printProfile();
+};
+
+struct DetectionStats {
+    uint32_t framesQueued;
+    uint32_t framesDropped;
+    uint32_t framesProcessed;
+    uint32_t batches;
+    uint32_t detections;
+};
+
+class DetectionInterface {
+private:
+    TargetDetector* detector;
+    SpscRing<DetectionFrame, DETECTION_QUEUE_SIZE> queue;
+    DetectionStats stats;
+
+public:
+    DetectionInterface();
+
+    void setDetector(TargetDetector* next) { detector = next; }
+    TargetDetector* getDetector() const { return detector; }
+    bool begin();
+
+    // Producer side (camera/sensor task)
+    bool submitFrame(const DetectionFrame& frame);
+
+    // Runs up to DETECTION_BATCH_SIZE queued frames; returns how many
+    uint8_t processPending(DetectionFrame* frames, DetectionResult* results, uint8_t maxFrames);
+
+    DetectionStats getStats() const;
+
+    // MSG_TARGET_FOUND payload for a positive result
+    static bool toTargetReport(const DetectionResult& result, const DetectionFrame& frame,
+                               uint8_t selfId, TargetReportData& report);
+};
+
+#endif // DETECTION_INTERFACE_H
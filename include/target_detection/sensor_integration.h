@@ -0,0 +1,197 @@
+#ifndef SENSOR_INTEGRATION_H
+#define SENSOR_INTEGRATION_H
+
+#include "../communications.h"
+#include "../config.h"
+#include "../utilities/spsc_ring.h"
+
+// GPS (UART NMEA) and BMP280 (I2C) ingestion. Producers - the UART receive
+// callback and the barometer sampling task - only push into SPSC rings.
+// poll() drains the rings, parses NMEA one character at a time, runs the
+// fixed-point filters and publishes the fused state through a seqlock so the
+// comm layer can read it from any task without locking.
+
+// Position in 1e-7 degrees, altitude in centimetres
+struct GpsFix {
+    int32_t latitudeE7;
+    int32_t longitudeE7;
+    int32_t altitudeCm;
+    uint32_t timeOfDayMs;
+    uint16_t hdopX100;
+    uint16_t speedCmS;
+    uint8_t fixQuality;     // GGA quality: 0 = none, 1 = GPS, 2 = DGPS
+    uint8_t satellites;
+    bool valid;
+};
+
+struct BaroSample {
+    uint32_t timestamp;
+    int32_t pressurePa;
+    int16_t temperatureCx100;
+};
+
+struct FusedSensorState {
+    uint32_t timestamp;
+    int32_t latitudeE7;
+    int32_t longitudeE7;
+    int32_t altitudeCm;
+    uint16_t speedCmS;
+    uint8_t satellites;
+    bool hasFix;
+    bool hasBaro;
+};
+
+struct SensorPipelineStats {
+    uint32_t nmeaBytes;
+    uint32_t nmeaSentences;
+    uint32_t nmeaChecksumErrors;
+    uint32_t nmeaIgnored;
+    uint32_t gpsFixes;
+    uint32_t baroSamples;
+    uint32_t nmeaDropped;
+    uint32_t baroDropped;
+    uint32_t published;
+};
+
+// Incremental NMEA 0183 parser for GGA/RMC; no heap, no String
+class NmeaParser {
+private:
+    enum SentenceKind { SENTENCE_UNKNOWN, SENTENCE_GGA, SENTENCE_RMC };
+
+    char field[16];
+    uint8_t fieldLength;
+    uint8_t fieldIndex;
+    uint8_t checksum;
+    uint8_t expectedChecksum;
+    uint8_t checksumDigits;
+    bool inSentence;
+    bool inChecksum;
+    SentenceKind kind;
+    char hemisphere;
+    GpsFix pending;
+    GpsFix current;
+
+    uint32_t sentences;
+    uint32_t checksumErrors;
+    uint32_t ignored;
+
+    void endField();
+    bool endSentence();
+
+public:
+    NmeaParser();
+    void reset();
+
+    // Returns true when a complete, checksum-valid GGA/RMC updated the fix
+    bool feed(char c);
+
+    const GpsFix& getFix() const { return current; }
+    uint32_t getSentenceCount() const { return sentences; }
+    uint32_t getChecksumErrors() const { return checksumErrors; }
+    uint32_t getIgnoredCount() const { return ignored; }
+
+    // Fixed-point helpers, exposed for tests
+    static int32_t parseDecimal(const char* s, uint8_t decimals);
+    static int32_t parseCoordinateE7(const char* s);
+};
+
+// Steady-state Kalman (alpha-beta) filter on one axis, gains in Q16
+class AlphaBetaFilter {
+private:
+    int32_t value;
+    int32_t velocity;       // Units per second
+    uint32_t lastUpdate;
+    uint32_t alphaQ16;
+    uint32_t betaQ16;
+    bool initialized;
+
+public:
+    AlphaBetaFilter(uint32_t alphaQ16, uint32_t betaQ16);
+    void reset() { initialized = false; }
+    int32_t update(int32_t measurement, uint32_t timestampMs);
+    int32_t getValue() const { return value; }
+    int32_t getVelocity() const { return velocity; }
+    bool isInitialized() const { return initialized; }
+};
+
+// Barometric altitude for smoothness, GPS altitude to remove the baro drift
+class AltitudeFilter {
+private:
+    int32_t baroAltitudeCm;
+    int32_t offsetCm;       // GPS minus baro, slowly tracked
+    bool haveBaro;
+    bool haveGps;
+    int32_t gpsAltitudeCm;
+
+public:
+    AltitudeFilter();
+    void addBaro(int32_t pressurePa);
+    void addGps(int32_t altitudeCm);
+    int32_t getAltitudeCm() const;
+    bool hasBaro() const { return haveBaro; }
+
+    static int32_t pressureToAltitudeCm(int32_t pressurePa);
+};
+
+// Lock-free single-writer publication of the latest fused state
+class FusedStatePublisher {
+private:
+    std::atomic<uint32_t> sequence;
+    FusedSensorState state;
+
+public:
+    FusedStatePublisher();
+    void publish(const FusedSensorState& next);
+    bool read(FusedSensorState& out) const;
+};
+
+class SensorPipeline {
+private:
+    NmeaParser parser;
+    AlphaBetaFilter latFilter;
+    AlphaBetaFilter lonFilter;
+    AltitudeFilter altitude;
+    FusedStatePublisher publisher;
+    FusedSensorState working;
+    SensorPipelineStats stats;
+    uint32_t lastFixTime;
+
+public:
+    SpscRing<uint8_t, GPS_RX_RING_SIZE> nmeaRing;
+    SpscRing<BaroSample, BARO_RING_SIZE> baroRing;
+
+    SensorPipeline();
+
+    // Starts the GPS UART, the BMP280 and the sampling task (device only)
+    bool begin();
+
+    // Producer side
+    uint16_t pushNmeaBytes(const uint8_t* data, uint16_t length);
+    bool pushBaroSample(const BaroSample& sample);
+
+    // Consumer side; returns the number of samples consumed
+    uint16_t poll(uint32_t now);
+
+    // Safe from any task or core
+    bool getLatest(FusedSensorState& out) const { return publisher.read(out); }
+
+    SensorPipelineStats getStats() const;
+    void printStats();
+};
+
+#ifndef ARDUINO
+// Replays a recorded log: NMEA sentences verbatim, barometer samples as
+// "BMP,<ms>,<pressure_pa>[,<temp_c>]". Reports throughput and latency.
+struct SensorReplayReport {
+    uint32_t lines;
+    uint32_t samples;
+    double seconds;
+    double samplesPerSec;
+    double meanParseNs;
+    double maxParseNs;
+};
+
+bool replaySensorLog(SensorPipeline& pipeline, const char* path, SensorReplayReport& report);
+#endif
+
+#endif // SENSOR_INTEGRATION_H
@@ -0,0 +1,117 @@
+#ifndef TARGET_VALIDATION_H
+#define TARGET_VALIDATION_H
+
+#include "../communications.h"
+#include "../config.h"
+
+// Fuses duplicate MSG_TARGET_FOUND reports from several drones into one track
+// per physical target. Tracks live in a fixed table and are indexed by a
+// uniform grid (cell size = association radius) so a neighbour lookup only
+// touches the 3x3 cells around the query point.
+
+struct TargetTrack {
+    uint16_t trackId;
+    bool active;
+    bool dirty;                 // Confidence moved enough to be re-broadcast
+    uint8_t targetClass;
+    float x, y;                 // Local metres east/north of the origin
+    float latitude, longitude;
+    float confidence;           // Fused, 0.0-1.0
+    float reportedConfidence;   // Last value handed to collectChangedTracks()
+    uint32_t firstSeen;
+    uint32_t lastUpdate;
+    uint8_t reporterCount;
+
+    // Latest contribution from each reporting drone
+    struct Contribution {
+        uint8_t reporterId;
+        uint16_t sourceTargetId;    // Reporter's own id for the target
+        float x, y;
+        float weight;
+        float logOdds;
+        uint32_t timestamp;
+    } reporters[MAX_TRACK_REPORTERS];
+
+    // Spatial grid links
+    int32_t cell;
+    int16_t gridPrev;
+    int16_t gridNext;
+};
+
+struct TargetFusionStats {
+    uint32_t reportsIngested;
+    uint32_t reportsRejected;
+    uint32_t tracksCreated;
+    uint32_t tracksMerged;
+    uint32_t tracksSplit;
+    uint32_t tracksExpired;
+};
+
+class TargetTrackStore {
+private:
+    TargetTrack* tracks;
+    int16_t* gridHeads;
+    uint16_t capacity;
+    uint16_t gridBuckets;       // Power of two
+    uint16_t activeCount;
+    uint16_t nextTrackId;
+    int16_t freeHead;           // Free slots are chained through gridNext
+    float associationRadius;
+
+    bool originSet;
+    float originLat, originLon;
+    float metersPerDegLon;
+
+    TargetFusionStats stats;
+
+    void toLocal(float lat, float lon, float& x, float& y);
+    int32_t cellOf(float x, float y) const;
+    uint16_t bucketOf(int32_t cell) const;
+    void gridInsert(int16_t index);
+    void gridRemove(int16_t index);
+    void gridMove(int16_t index);
+
+    int16_t allocateTrack();
+    void releaseTrack(int16_t index);
+    void recompute(TargetTrack& track);
+    void removeContribution(TargetTrack& track, uint8_t reporterId);
+    void dropStaleSighting(int16_t keep, const TargetTrack::Contribution& c);
+    void addContribution(TargetTrack& track, const TargetTrack::Contribution& c);
+    void mergeInto(int16_t keep, int16_t drop);
+    void mergeNeighbours(int16_t index);
+
+public:
+    TargetTrackStore(uint16_t maxTracks = MAX_TARGET_TRACKS,
+                     float radiusM = TARGET_ASSOCIATION_RADIUS_M);
+    ~TargetTrackStore();
+
+    // Origin of the local tangent plane; set implicitly by the first report
+    void setOrigin(float latitude, float longitude);
+
+    // Fuse one report; returns the track index it landed in, or -1 if dropped
+    int16_t ingest(const TargetReportData& report, int rssi, float snr, uint32_t now);
+    bool handleMessage(const DroneMessage& msg, int rssi, float snr, uint32_t now);
+
+    // Nearest active track within the association radius, -1 if none
+    int16_t findNearest(float latitude, float longitude);
+    int16_t findNearestLocal(float x, float y) const;
+
+    // Drop tracks that have not been reported for TARGET_TRACK_TIMEOUT_MS
+    uint16_t expireTracks(uint32_t now);
+
+    // Copies out tracks whose fused confidence changed by at least
+    // TARGET_CONFIDENCE_REPORT_DELTA since they were last collected
+    uint16_t collectChangedTracks(TargetReportData* out, uint16_t maxOut, uint8_t selfId);
+
+    const TargetTrack* getTrack(int16_t index) const;
+    uint16_t getActiveCount() const { return activeCount; }
+    uint16_t getCapacity() const { return capacity; }
+    TargetFusionStats getStats() const { return stats; }
+    void clear();
+    void printTracks();
+
+    // Weight given to a report from its link quality and the sensor's own quality
+    static float reportWeight(int rssi, float snr, uint8_t sensorQuality);
+};
+
+#endif // TARGET_VALIDATION_H
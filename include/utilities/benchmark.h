@@ -0,0 +1,68 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stdio.h>
+#include "../communications.h"
+#include "../config.h"
+
+// Benchmark harness shared by the native build and the performance_test
+// device build. A case runs its body `iterations` times per call. The
+// harness doubles that count until one call takes BENCH_SAMPLE_US, then
+// takes BENCH_SAMPLES timed calls and keeps the median, fastest and slowest
+// time per operation. Results go out as JSON, one case per line. A baseline
+// in the same format marks the cases that got more than
+// BENCH_REGRESSION_TOLERANCE slower.
+
+typedef void (*BenchFunction)(uint32_t iterations, void* context);
+
+struct BenchResult {
+    const char* name;
+    uint32_t iterations;        // Per sample
+    float medianNs;             // Per operation
+    float minNs;
+    float maxNs;
+    float baselineNs;           // 0 when the baseline has no such case
+    bool regressed;
+};
+
+class BenchSuite {
+private:
+    struct Case {
+        const char* name;
+        BenchFunction run;
+        void* context;
+    };
+
+    Case cases[BENCH_MAX_CASES];
+    BenchResult results[BENCH_MAX_CASES];
+    uint8_t caseCount;
+    uint8_t resultCount;
+
+    BenchResult measure(const Case& entry);
+
+public:
+    BenchSuite();
+
+    bool add(const char* name, BenchFunction run, void* context = nullptr);
+    // Runs the cases whose name starts with `prefix`, all of them when null
+    uint8_t run(const char* prefix = nullptr);
+
+    uint8_t size() const { return resultCount; }
+    const BenchResult& at(uint8_t index) const { return results[index]; }
+    const BenchResult* find(const char* name) const;
+
+    // Reads median_ns per name from JSON written by writeJson(); returns
+    // the number of cases slower than the baseline by more than `tolerance`
+    uint8_t compare(const char* baselineJson, float tolerance = BENCH_REGRESSION_TOLERANCE);
+    void writeJson(FILE* out, const char* platform) const;
+};
+
+// Keeps a result alive without a store the optimiser can see through
+template <typename T>
+inline void benchKeep(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+uint64_t benchNowNs();
+
+#endif // BENCHMARK_H
@@ -0,0 +1,66 @@
+#ifndef CONFIG_OVERRIDE_H
+#define CONFIG_OVERRIDE_H
+
+#include "../config.h"
+#include <stdint.h>
+#include <stddef.h>
+
+// Field tuning without a rebuild. The compiled-in DRONE_CONFIG stays the
+// baseline; a short blob in NVS may set the fields in CONFIG_FIELD_LIMITS,
+// each within its generated range:
+//   'C' 'F' | version | drone id (0: any) | SWARM_CONFIG_HASH, LE |
+//   (field id, zigzag varint value)... | flightCrc16 over all before, LE
+// The hash ties a blob to the JSON the image was built from, so tuning
+// meant for an older config is dropped after a reflash. Blobs come from
+//   tools/deployment/config_generator.py override --drone N key=value...
+// and reach the drone over the serial console ('T' followed by the hex).
+
+#define CONFIG_OVERRIDE_VERSION 1
+#define CONFIG_OVERRIDE_HEADER_BYTES 8
+
+struct TunableConfig {
+    int8_t maxTxPowerDbm;           // AdrController::setMaxTxPower
+    uint32_t heartbeatIntervalMs;
+};
+
+struct ConfigFieldValue {
+    uint8_t field;                  // ConfigField
+    int32_t value;
+};
+
+enum ConfigOverrideResult : uint8_t {
+    CONFIG_OVERRIDE_OK = 0,
+    CONFIG_OVERRIDE_NONE,           // Nothing stored
+    CONFIG_OVERRIDE_MALFORMED,      // Magic, version, length or CRC
+    CONFIG_OVERRIDE_OTHER_DRONE,
+    CONFIG_OVERRIDE_STALE,          // Made against other JSON
+    CONFIG_OVERRIDE_BAD_FIELD,      // Unknown field or out of range
+    CONFIG_OVERRIDE_NOT_STORED      // NVS write failed
+};
+
+// The compiled-in values
+TunableConfig tunableDefaults();
+
+// All or nothing: config is only written if the whole blob is valid
+ConfigOverrideResult applyConfigOverride(const uint8_t* blob, size_t length, uint8_t droneId, TunableConfig& config);
+
+// The blob config_generator.py would write; 0 if it does not fit
+size_t encodeConfigOverride(uint8_t droneId, uint32_t configHash, const ConfigFieldValue* values, uint8_t count,
+                            uint8_t* out, size_t capacity);
+
+// Console input: hex digits, case-insensitive, spaces ignored. Returns the
+// byte count, 0 on an odd digit count, a bad character or overflow.
+size_t configOverrideFromHex(const char* hex, uint8_t* out, size_t capacity);
+
+const char* getConfigOverrideResultName(ConfigOverrideResult result);
+
+#ifdef ARDUINO
+// NVS namespace CONFIG_NVS_NAMESPACE, key "override"
+ConfigOverrideResult loadConfigOverride(uint8_t droneId, TunableConfig& config);
+
+// Checked with applyConfigOverride() first; only a valid blob is stored
+ConfigOverrideResult storeConfigOverride(const uint8_t* blob, size_t length, uint8_t droneId);
+bool clearConfigOverride();
+#endif
+
+#endif // CONFIG_OVERRIDE_H
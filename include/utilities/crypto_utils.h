@@ -0,0 +1,171 @@
+#ifndef CRYPTO_UTILS_H
+#define CRYPTO_UTILS_H
+
+#include "../communications.h"
+#include "../config.h"
+#include "data_structures.h"
+
+#if defined(ARDUINO) && CRYPTO_HW_AES
+#include "mbedtls/ccm.h"
+#endif
+
+// Per-frame authenticated encryption: AES-128-CCM (RFC 3610) over every
+// DroneMessage. The header fields and checksum are authenticated but sent in
+// clear so frames can still be routed and filtered before opening; the
+// 32-byte payload is encrypted. The nonce is sourceId | epoch | sequence,
+// which never repeats for a key as long as a sender's epoch goes up on every
+// boot and whenever its 16-bit sequence wraps. The CCM tag is truncated to
+// CRYPTO_TAG_BYTES to keep LoRa airtime down.
+//
+// On the ESP32 sealing and opening go through mbedtls, which drives the AES
+// accelerator. Frames are opened in the emergency task, which the DIO0
+// interrupt only wakes, so the accelerator driver's lock is always safe to
+// take. The software AES below computes the S-box with a boolean circuit
+// instead of a lookup table, so its timing does not depend on key or data;
+// the host build, and a device build with CRYPTO_HW_AES off, use it.
+
+#define CRYPTO_KEY_BYTES 16
+#define CRYPTO_NONCE_BYTES 13
+#define CRYPTO_SHA256_BYTES 32
+
+static_assert(CRYPTO_TAG_BYTES >= 4 && CRYPTO_TAG_BYTES <= 16 && CRYPTO_TAG_BYTES % 2 == 0,
+              "CCM tags are 4..16 bytes, even");
+static_assert(CRYPTO_REPLAY_WINDOW >= 1 && CRYPTO_REPLAY_WINDOW <= 32, "Replay window is a 32-bit bitmap");
+
+// What goes on air in place of a bare DroneMessage
+struct SecureFrame {
+    DroneMessage msg;           // data[] holds ciphertext
+    uint16_t epoch;
+    uint8_t tag[CRYPTO_TAG_BYTES];
+} __attribute__((packed));
+
+#define CRYPTO_FRAME_OVERHEAD (sizeof(SecureFrame) - sizeof(DroneMessage))
+
+enum CryptoResult : uint8_t {
+    CRYPTO_OK = 0,
+    CRYPTO_BAD_TAG = 1,         // Wrong key, corrupted or forged
+    CRYPTO_REPLAY = 2,          // Already accepted, or older than the window
+    CRYPTO_STALE_EPOCH = 3      // Sender has since rebooted or wrapped
+};
+
+struct CryptoStats {
+    uint32_t sealed;
+    uint32_t opened;
+    uint32_t badTag;
+    uint32_t replayed;
+    uint32_t staleEpoch;
+    uint32_t evicted;           // Replay state dropped for a quieter source
+};
+
+// One source's replay window, for carrying it across a warm restart
+struct ReplaySnapshot {
+    uint8_t sourceId;
+    uint16_t epoch;
+    uint16_t highest;
+    uint32_t window;
+    uint32_t ageMs;             // Since its last accepted frame
+} __attribute__((packed));
+
+// AES-128 encryption only; CCM never needs the inverse cipher
+class Aes128 {
+private:
+    uint8_t roundKeys[176];
+
+public:
+    void setKey(const uint8_t key[CRYPTO_KEY_BYTES]);
+    void encryptBlock(const uint8_t in[16], uint8_t out[16]) const;
+};
+
+// S-box on 16 bytes at once (exposed for tests)
+void aesSubBytes(uint8_t state[16]);
+
+// SHA-256 (FIPS 180-4), fed incrementally. Used to verify whole firmware
+// images, hashed a step at a time from the main loop, so the software
+// version is fast enough on both targets.
+class Sha256 {
+private:
+    uint32_t state[8];
+    uint64_t total;
+    uint8_t block[64];
+    uint8_t used;
+
+    void compress(const uint8_t* in);
+
+public:
+    Sha256() { begin(); }
+    void begin();
+    void update(const void* data, size_t length);
+    void finish(uint8_t digest[CRYPTO_SHA256_BYTES]);
+};
+
+// CCM with a 13-byte nonce and a 2-byte length field. `in` and `out` may
+// alias. aesCcmOpen() zeroes `out` when the tag does not match.
+void aesCcmSeal(const Aes128& aes, const uint8_t nonce[CRYPTO_NONCE_BYTES], const uint8_t* aad, size_t aadLength,
+                const uint8_t* in, uint8_t* out, size_t length, uint8_t* tag, uint8_t tagLength);
+bool aesCcmOpen(const Aes128& aes, const uint8_t nonce[CRYPTO_NONCE_BYTES], const uint8_t* aad, size_t aadLength,
+                const uint8_t* in, uint8_t* out, size_t length, const uint8_t* tag, uint8_t tagLength);
+
+// One node's end of the link: the transmit epoch and sequence, plus a
+// sliding window per source for replay detection. A source's window only
+// moves on frames whose tag checks out, so forgeries cannot push it forward.
+// A receiver that has no state for a source (first contact, or after its own
+// reboot) accepts that source's current epoch as the starting point, so
+// frames recorded earlier in that epoch can be replayed to it once.
+class SecureLink {
+private:
+    struct ReplayState {
+        uint8_t sourceId;
+        bool used;
+        uint16_t epoch;
+        uint16_t highest;           // Highest sequence accepted in epoch
+        uint32_t window;            // Bit n: highest - n accepted
+        uint32_t lastAccepted;
+    };
+
+    uint8_t nodeId;
+    Aes128 aes;
+#if defined(ARDUINO) && CRYPTO_HW_AES
+    mbedtls_ccm_context hw;
+#endif
+    PoolLock txLock;            // Main loop and emergency task both transmit
+    uint16_t txEpoch;
+    uint16_t txSequence;
+    ReplayState sources[CRYPTO_REPLAY_SOURCES];
+    CryptoStats stats;
+
+    ReplayState* findSource(uint8_t sourceId, uint32_t now);
+    CryptoResult checkReplay(const ReplayState* state, uint8_t sourceId, uint16_t epoch, uint16_t sequence) const;
+    void acceptReplay(ReplayState* state, uint8_t sourceId, uint16_t epoch, uint16_t sequence, uint32_t now);
+
+public:
+    SecureLink(uint8_t nodeId, const uint8_t key[CRYPTO_KEY_BYTES]);
+    ~SecureLink();
+
+    SecureLink(const SecureLink&) = delete;
+    SecureLink& operator=(const SecureLink&) = delete;
+
+    // Fresh nonce space from sequence 0; the caller stores `epoch` first
+    void setEpoch(uint16_t epoch);
+    uint16_t getEpoch() const { return txEpoch; }
+    uint16_t getSequence() const { return txSequence; }
+    // Warm restart: carry on in `epoch` above every sequence it has used
+    void resume(uint16_t epoch, uint16_t sequence);
+
+    // Stamps the next link sequence number and the checksum on `msg`, then
+    // encrypts it into `out`. Returns true when this frame moved the epoch
+    // forward (sequence wrap), so the caller can persist it.
+    bool seal(DroneMessage& msg, SecureFrame& out);
+
+    // Authenticates and decrypts `frame` into `out`
+    CryptoResult open(const SecureFrame& frame, DroneMessage& out, uint32_t now);
+
+    CryptoStats getStats() const { return stats; }
+    void resetReplayState();
+    uint8_t saveReplayState(ReplaySnapshot* out, uint8_t maxSources, uint32_t now) const;
+    // Ages count back from `now`; sources already known here are kept
+    void restoreReplayState(const ReplaySnapshot* in, uint8_t count, uint32_t now);
+
+    static void buildNonce(uint8_t sourceId, uint16_t epoch, uint16_t sequence, uint8_t nonce[CRYPTO_NONCE_BYTES]);
+};
+
+#endif // CRYPTO_UTILS_H
@@ -0,0 +1,224 @@
+#ifndef DATA_STRUCTURES_H
+#define DATA_STRUCTURES_H
+
+#include <new>
+#include <stdarg.h>
+#include <stdio.h>
+#include "../communications.h"
+#include "../config.h"
+
+#ifndef ARDUINO
+#include <atomic>
+#endif
+
+// Fixed-block pools and a bump arena, sized at compile time, so message
+// handling never touches the heap once the node is up. Every pool and arena
+// links itself into a registry when constructed (no allocation involved),
+// which lets printMemoryPools() report occupancy and high-water marks for
+// all of them. Allocation takes a short critical section and is safe from
+// any task; it is not meant for ISRs.
+
+struct PoolStats {
+    const char* name;
+    uint16_t blockSize;         // Bytes per block; 1 for arenas
+    uint16_t capacity;          // Blocks (bytes for arenas)
+    uint16_t inUse;
+    uint16_t highWater;
+    uint32_t allocations;
+    uint32_t failures;          // Pool exhausted or bad release
+};
+
+class PoolLock {
+private:
+#ifdef ARDUINO
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+#else
+    std::atomic_flag flag = ATOMIC_FLAG_INIT;
+#endif
+
+public:
+#ifdef ARDUINO
+    void lock() { portENTER_CRITICAL(&mux); }
+    void unlock() { portEXIT_CRITICAL(&mux); }
+#else
+    void lock() { while (flag.test_and_set(std::memory_order_acquire)) {} }
+    void unlock() { flag.clear(std::memory_order_release); }
+#endif
+};
+
+class MemoryPoolBase {
+private:
+    static MemoryPoolBase* registryHead;
+    MemoryPoolBase* registryNext;
+
+protected:
+    PoolStats stats;
+    mutable PoolLock guard;
+
+    MemoryPoolBase(const char* name, uint16_t blockSize, uint16_t capacity);
+    ~MemoryPoolBase();
+
+    void noteAllocated(uint16_t amount);
+    void noteReleased(uint16_t amount) { stats.inUse -= amount; }
+
+public:
+    MemoryPoolBase(const MemoryPoolBase&) = delete;
+    MemoryPoolBase& operator=(const MemoryPoolBase&) = delete;
+
+    PoolStats getStats() const;
+    void resetHighWater();
+
+    static MemoryPoolBase* first() { return registryHead; }
+    MemoryPoolBase* next() const { return registryNext; }
+};
+
+template <typename T, uint16_t N>
+class ObjectPool : public MemoryPoolBase {
+private:
+    union Block {
+        Block* next;
+        alignas(T) uint8_t storage[sizeof(T)];
+    };
+
+    Block blocks[N];
+    Block* freeHead;
+    uint32_t allocated[(N + 31) / 32];
+
+    bool isAllocated(uint16_t index) const { return allocated[index >> 5] & (1u << (index & 31)); }
+
+public:
+    explicit ObjectPool(const char* name) : MemoryPoolBase(name, sizeof(T), N) { clear(); }
+
+    // Value-initialised object, or nullptr when the pool is exhausted
+    T* allocate() {
+        guard.lock();
+        Block* block = freeHead;
+        if (!block) {
+            stats.failures++;
+            guard.unlock();
+            return nullptr;
+        }
+        freeHead = block->next;
+        uint16_t index = block - blocks;
+        allocated[index >> 5] |= 1u << (index & 31);
+        noteAllocated(1);
+        guard.unlock();
+        return new (block->storage) T();
+    }
+
+    // Ignores (and counts) pointers that are foreign or already free
+    bool release(T* object) {
+        int16_t index = indexOf(object);
+        guard.lock();
+        if (index < 0 || !isAllocated(index)) {
+            stats.failures++;
+            guard.unlock();
+            return false;
+        }
+        object->~T();
+        Block* block = &blocks[index];
+        allocated[index >> 5] &= ~(1u << (index & 31));
+        block->next = freeHead;
+        freeHead = block;
+        noteReleased(1);
+        guard.unlock();
+        return true;
+    }
+
+    int16_t indexOf(const T* object) const {
+        const uint8_t* p = (const uint8_t*)object;
+        const uint8_t* base = (const uint8_t*)blocks;
+        if (p < base || p >= base + sizeof(blocks) || (size_t)(p - base) % sizeof(Block) != 0) {
+            return -1;
+        }
+        return (int16_t)((p - base) / sizeof(Block));
+    }
+
+    // Live object in slot `index`, for iteration; nullptr if the slot is free
+    T* at(uint16_t index) {
+        return index < N && isAllocated(index) ? (T*)blocks[index].storage : nullptr;
+    }
+    const T* at(uint16_t index) const {
+        return index < N && isAllocated(index) ? (const T*)blocks[index].storage : nullptr;
+    }
+
+    static constexpr uint16_t capacity() { return N; }
+    uint16_t size() const { return stats.inUse; }
+
+    // Drops every object without running destructors
+    void clear() {
+        guard.lock();
+        for (uint16_t i = 0; i < N; i++) {
+            blocks[i].next = i + 1 < N ? &blocks[i + 1] : nullptr;
+        }
+        freeHead = N ? &blocks[0] : nullptr;
+        memset(allocated, 0, sizeof(allocated));
+        stats.inUse = 0;
+        guard.unlock();
+    }
+};
+
+// Bump allocator for short-lived scratch (formatted text, per-loop
+// buffers). Nothing is freed individually; reset() drops everything.
+template <uint16_t BYTES>
+class Arena : public MemoryPoolBase {
+private:
+    alignas(8) uint8_t buffer[BYTES];
+
+public:
+    explicit Arena(const char* name) : MemoryPoolBase(name, 1, BYTES) {}
+
+    void* allocate(uint16_t size, uint8_t align = 8) {
+        guard.lock();
+        uint16_t start = (stats.inUse + align - 1) & ~(align - 1);
+        if (start + size > BYTES) {
+            stats.failures++;
+            guard.unlock();
+            return nullptr;
+        }
+        noteAllocated(start + size - stats.inUse);
+        guard.unlock();
+        return buffer + start;
+    }
+
+    // printf into the arena; falls back to "" when full so callers can
+    // print the result unconditionally
+    const char* format(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, fmt);
+        va_list copy;
+        va_copy(copy, args);
+        int length = vsnprintf(nullptr, 0, fmt, copy);
+        va_end(copy);
+        char* out = length >= 0 ? (char*)allocate(length + 1, 1) : nullptr;
+        if (out) {
+            vsnprintf(out, length + 1, fmt, args);
+        }
+        va_end(args);
+        return out ? out : "";
+    }
+
+    void reset() {
+        guard.lock();
+        stats.inUse = 0;
+        guard.unlock();
+    }
+
+    uint16_t used() const { return stats.inUse; }
+};
+
+// Deferred log line; see utilities/debug_utils.h
+struct LogRecord {
+    LogRecord* next;            // Queue link
+    uint32_t timestamp;
+    uint8_t level;
+    char text[LOG_RECORD_TEXT];
+};
+
+extern ObjectPool<DroneMessage, FRAME_POOL_SIZE> framePool;
+extern ObjectPool<LogRecord, LOG_POOL_SIZE> logPool;
+extern Arena<SCRATCH_ARENA_BYTES> scratchArena;     // Reset once per main loop pass
+
+void printMemoryPools();
+
+#endif // DATA_STRUCTURES_H
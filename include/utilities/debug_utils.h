@@ -0,0 +1,25 @@
+#ifndef DEBUG_UTILS_H
+#define DEBUG_UTILS_H
+
+#include "data_structures.h"
+
+// Deferred logging: debugLog() formats into a LogRecord from logPool and
+// queues it without waiting on the UART; the main loop prints the backlog
+// with debugLogFlush(). When the pool is exhausted the line is dropped and
+// counted rather than allocated.
+
+enum LogLevel : uint8_t {
+    LOG_DEBUG = 0,
+    LOG_INFO = 1,
+    LOG_WARN = 2,
+    LOG_ERROR = 3
+};
+
+bool debugLog(LogLevel level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// Prints and releases up to `maxRecords` queued lines, oldest first
+uint8_t debugLogFlush(uint8_t maxRecords = LOG_POOL_SIZE);
+
+uint32_t debugLogDropped();
+
+#endif // DEBUG_UTILS_H
@@ -0,0 +1,259 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include "../communications.h"
+#include "../config.h"
+#include "data_structures.h"
+
+#ifdef ARDUINO
+#include "esp_partition.h"
+#else
+#include <chrono>
+#include <vector>
+#define IRAM_ATTR
+#endif
+
+// Flight recorder: every frame sent and received (with RSSI/SNR), mission
+// state changes and timer expiries, appended to a ring of flash sectors so
+// the minutes before a crash or power loss survive it. The log lives in a
+// raw data partition rather than a file system: erases happen one sector
+// at a time, ahead of the writer, and wear is spread evenly by the ring.
+//
+// Layout, little-endian:
+//   sector: FlightSectorHeader, then records back to back. Erased (0xFF)
+//           space ends it; a record never crosses a sector boundary.
+//   record: kind (1) | length (1) | ms since the previous record (varint)
+//           | body (length) | CRC-16 of everything before it (2)
+// The sector header carries the clock at its first record and a sequence
+// number that only goes up, so a reader finds the oldest sector and walks
+// the ring from there. A torn record fails its CRC and ends its sector.
+//
+// Recording only copies into a RAM ring of FLIGHT_BUFFER_PAGES pages under
+// a spinlock, so it is safe from the radio ISR. service() from the main
+// loop programs full pages, flushes a partial one every
+// FLIGHT_FLUSH_INTERVAL_MS (at once after an emergency stop) and erases the
+// next sector while the current one is half full. When the RAM ring is
+// full the record is dropped and counted.
+
+#define FLIGHT_MAGIC 0x31524C46u            // "FLR1"
+#define FLIGHT_MAX_BODY 64
+#define FLIGHT_RING_BYTES (FLIGHT_BUFFER_PAGES * FLIGHT_PAGE_BYTES)
+#define FLIGHT_FRAME_HEADER_BYTES ((uint8_t)offsetof(DroneMessage, data))
+
+// Wire kinds: append only, old dumps are decoded by number
+enum FlightRecordKind : uint8_t {
+    FLIGHT_BOOT = 1,            // FlightBootRecord; restarts the clock
+    FLIGHT_TX = 2,              // DroneMessage up to its last data byte, as sent
+    FLIGHT_RX = 3,              // FlightRxRecord, then the DroneMessage as for TX
+    FLIGHT_STATE = 4,           // FlightStateRecord
+    FLIGHT_TIMER = 5            // FlightTimerRecord, then the timer's name
+};
+
+struct FlightSectorHeader {
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t baseMs;            // Clock the first record's delta counts from
+    uint16_t reserved;          // 0xFFFF
+    uint16_t crc;               // Over the fields above
+} __attribute__((packed));
+
+struct FlightBootRecord {
+    uint8_t nodeId;
+    uint8_t resetReason;        // esp_reset_reason(); 0 on host
+    uint32_t clockMs;           // The record's own time; its delta is 0
+} __attribute__((packed));
+
+struct FlightRxRecord {
+    int16_t rssi;               // dBm
+    int8_t snrQuarterDb;
+} __attribute__((packed));
+
+struct FlightStateRecord {
+    uint8_t from;               // MissionState
+    uint8_t to;
+    uint8_t reason;             // Emergency stop reason, 0 otherwise
+} __attribute__((packed));
+
+struct FlightTimerRecord {
+    int32_t id;
+} __attribute__((packed));
+
+// CRC-16/CCITT-FALSE without a table, so the ISR path touches no flash-resident data
+inline uint16_t IRAM_ATTR flightCrc16(const uint8_t* data, uint32_t length, uint16_t crc = 0xFFFF) {
+    for (uint32_t i = 0; i < length; i++) {
+        crc = (uint16_t)((crc >> 8) | (crc << 8));
+        crc ^= data[i];
+        crc ^= (crc & 0xFF) >> 4;
+        crc ^= (uint16_t)(crc << 12);
+        crc ^= (uint16_t)((crc & 0xFF) << 5);
+    }
+    return crc;
+}
+
+struct FlightRecordView {
+    uint8_t kind;
+    uint8_t length;
+    uint32_t deltaMs;
+    const uint8_t* body;
+};
+
+// Frames one record into `out` (4 + 5 + FLIGHT_MAX_BODY bytes): head and
+// body back to back as its body. Returns the record's size.
+uint32_t flightEncodeRecord(uint8_t kind, const void* head, uint8_t headLength, const void* body, uint8_t bodyLength,
+                            uint32_t deltaMs, uint8_t* out);
+
+// SNR in the quarter dB of FlightRxRecord, rounded and clamped
+inline int8_t flightSnrQuarters(float snr) {
+    float quarters = snr * 4.0f;
+    return quarters >= 127.0f ? 127 : quarters <= -128.0f ? -128 : (int8_t)(quarters + (quarters < 0 ? -0.5f : 0.5f));
+}
+
+// Bytes consumed; 0 for erased space or a corrupt record; -1 when the record
+// runs past `available` (read more, or treat it as torn at the sector end)
+int flightParseRecord(const uint8_t* in, uint32_t available, FlightRecordView& out);
+bool flightParseSectorHeader(const uint8_t* in, FlightSectorHeader& out);
+
+// Erase-before-write storage: erase() sets a sector to 0xFF, write() can
+// only clear bits
+class FlightFlash {
+public:
+    virtual ~FlightFlash() {}
+    virtual uint32_t size() const = 0;                  // Whole sectors
+    virtual bool erase(uint32_t offset) = 0;            // One FLIGHT_SECTOR_BYTES sector
+    virtual bool write(uint32_t offset, const void* data, uint32_t length) = 0;
+    virtual bool read(uint32_t offset, void* data, uint32_t length) = 0;
+};
+
+#ifdef ARDUINO
+class PartitionFlash : public FlightFlash {
+private:
+    const esp_partition_t* partition;
+
+public:
+    PartitionFlash() : partition(nullptr) {}
+    // Data partition FLIGHT_PARTITION_LABEL from partitions.csv
+    bool begin();
+    // Any other partition, e.g. an OTA slot
+    bool begin(const esp_partition_t* other) {
+        partition = other;
+        return partition != nullptr;
+    }
+
+    uint32_t size() const override { return partition ? partition->size : 0; }
+    bool erase(uint32_t offset) override;
+    bool write(uint32_t offset, const void* data, uint32_t length) override;
+    bool read(uint32_t offset, void* data, uint32_t length) override;
+};
+#else
+// NOR flash in RAM for tests and the simulator. failAfter cuts power
+// partway through a write: that write and every later one stop there.
+class RamFlash : public FlightFlash {
+private:
+    std::vector<uint8_t> bytes;
+    uint32_t budget;
+
+public:
+    uint32_t erases;
+    uint32_t writes;
+    uint32_t bytesWritten;
+
+    explicit RamFlash(uint32_t size);
+
+    void failAfter(uint32_t writtenBytes) { budget = writtenBytes; }
+    const uint8_t* image() const { return bytes.data(); }
+
+    uint32_t size() const override { return (uint32_t)bytes.size(); }
+    bool erase(uint32_t offset) override;
+    bool write(uint32_t offset, const void* data, uint32_t length) override;
+    bool read(uint32_t offset, void* data, uint32_t length) override;
+};
+#endif
+
+struct FlightStats {
+    uint32_t records;
+    uint32_t recordBytes;       // Framing included
+    uint32_t dropped;           // RAM ring full
+    uint32_t flashWrites;
+    uint32_t flashBytes;
+    uint32_t erases;
+    uint32_t flashErrors;
+    uint32_t flashUs;           // Spent in erase and write calls
+    uint32_t sectorsOpened;
+};
+
+class FlightRecorder {
+private:
+    FlightFlash* flash;
+    uint32_t sectorCount;
+
+    // Positions are (sector sequence, offset within the sector); a
+    // sector's flash address is (sequence % sectorCount) * FLIGHT_SECTOR_BYTES
+    uint32_t appendSeq;
+    uint32_t appendOffset;
+    uint32_t flushSeq;
+    uint32_t flushOffset;
+    uint32_t erasedSeq;         // Newest sector erased and ready
+    uint32_t lastMs;
+    uint32_t lastFlushMs;
+    bool urgent;
+
+    uint8_t ring[FLIGHT_RING_BYTES];   // Byte at offset o of any sector lives at o % FLIGHT_RING_BYTES
+    PoolLock guard;
+    FlightStats stats;
+
+    uint32_t buffered() const;
+    void put(const uint8_t* bytes, uint32_t length);      // Null: erased padding
+    void openSector(uint32_t now);
+    bool append(uint8_t kind, const void* head, uint8_t headLength,
+                const void* body, uint8_t bodyLength, uint32_t now, bool restartClock);
+    bool recover(uint32_t& newest, uint32_t& resumeOffset);
+    bool eraseSector(uint32_t seq);
+    bool program(uint32_t seq, uint32_t from, uint32_t to);
+    void drain(uint32_t seq, uint32_t end, bool partial);
+
+public:
+    FlightRecorder();
+
+    // Finds the newest sector and carries on after its last intact record,
+    // or in a fresh sector if it ends torn. Logs a FLIGHT_BOOT record.
+    bool begin(FlightFlash* flash, uint8_t nodeId, uint8_t resetReason, uint32_t now);
+    bool isActive() const { return flash != nullptr; }
+
+    bool recordFrame(bool transmitted, const DroneMessage& msg, int16_t rssi, float snr, uint32_t now);
+    bool recordState(uint8_t from, uint8_t to, uint8_t reason, uint32_t now);
+    bool recordTimer(int32_t id, const char* name, uint32_t now);
+
+    // Main loop only: programs and erases flash
+    void service(uint32_t now);
+    // Everything recorded so far reaches flash, erasing as needed
+    void flush();
+
+    uint32_t getSequence() const { return appendSeq; }
+    FlightStats getStats() const { return stats; }
+    void resetStats();
+};
+
+extern FlightRecorder flightRecorder;
+
+inline uint32_t flightClock() {
+#ifdef ARDUINO
+    return millis();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+#if FLIGHT_RECORDER_ENABLED
+#define FLIGHT_RECORD_TX(msg) flightRecorder.recordFrame(true, msg, 0, 0, flightClock())
+#define FLIGHT_RECORD_RX(msg, rssi, snr) flightRecorder.recordFrame(false, msg, rssi, snr, flightClock())
+#define FLIGHT_RECORD_STATE(from, to, reason) flightRecorder.recordState(from, to, reason, flightClock())
+#define FLIGHT_RECORD_TIMER(id, name) flightRecorder.recordTimer(id, name, flightClock())
+#else
+#define FLIGHT_RECORD_TX(msg)
+#define FLIGHT_RECORD_RX(msg, rssi, snr)
+#define FLIGHT_RECORD_STATE(from, to, reason)
+#define FLIGHT_RECORD_TIMER(id, name)
+#endif
+
+#endif // FLIGHT_RECORDER_H
@@ -0,0 +1,184 @@
+#ifndef PERFORMANCE_MONITOR_H
+#define PERFORMANCE_MONITOR_H
+
+#include <atomic>
+#include "../communications.h"
+#include "../config.h"
+
+#ifndef ARDUINO
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+#endif
+
+// Hot-path instrumentation. PERF_SCOPE(probe) times the enclosing block in
+// CPU cycles (CCOUNT on ESP32, rdtsc or steady_clock on host) and records it
+// in a log-linear (HDR-style) histogram. Every core has its own set of
+// histograms and buckets are relaxed atomics, so recording takes no lock and
+// is safe from interrupts. A scope costs two cycle-counter reads and one
+// atomic add (plus a compare-and-swap on a new maximum), cheap enough to keep
+// on in flight.
+
+// Wire ids: append only, the ground station decodes by number
+enum PerfProbe : uint8_t {
+    PERF_SEND = 0,
+    PERF_RECEIVE = 1,
+    PERF_CHECKSUM = 2,
+    PERF_DISPATCH = 3,
+    PERF_HANDLER_HEARTBEAT = 4,
+    PERF_HANDLER_TARGET = 5,
+    PERF_HANDLER_EMERGENCY = 6,
+    PERF_HANDLER_FORMATION = 7,
+    PERF_HANDLER_GOSSIP = 8,
+    PERF_HANDLER_MUTEX = 9,
+    PERF_HANDLER_RAFT = 10,
+    PERF_CRYPTO = 11,
+    PERF_PROBE_COUNT
+};
+
+#define PERF_SUB_BUCKETS (1 << PERF_HISTOGRAM_SUB_BITS)
+#define PERF_BUCKETS ((33 - PERF_HISTOGRAM_SUB_BITS) * PERF_SUB_BUCKETS)
+
+// Exact below 2 * PERF_SUB_BUCKETS, then PERF_SUB_BUCKETS per power of two
+inline uint8_t perfBucketIndex(uint32_t value, uint8_t subBits) {
+    uint8_t msb = value ? 31 - __builtin_clz(value) : 0;
+    uint8_t shift = msb > subBits ? msb - subBits : 0;
+    return (shift << subBits) + (value >> shift);
+}
+
+inline uint32_t perfBucketLow(uint8_t index, uint8_t subBits) {
+    uint32_t sub = 1u << subBits;
+    if (index < 2 * sub) {
+        return index;
+    }
+    uint8_t shift = (index >> subBits) - 1;
+    return (index - (shift << subBits)) << shift;
+}
+
+inline uint32_t perfCycles() {
+#ifdef ARDUINO
+    return ESP.getCycleCount();
+#elif defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__rdtsc();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+uint8_t perfCoreId();
+
+struct PerfSummary {
+    uint32_t count;
+    uint32_t p50Ns;
+    uint32_t p90Ns;
+    uint32_t p99Ns;
+    uint32_t maxNs;
+};
+
+class PerfHistogram {
+private:
+    std::atomic<uint32_t> buckets[PERF_BUCKETS];     // The count is their sum
+    std::atomic<uint32_t> maxCycles;
+
+public:
+    PerfHistogram() { reset(); }
+
+    void record(uint32_t cycles) {
+        buckets[perfBucketIndex(cycles, PERF_HISTOGRAM_SUB_BITS)].fetch_add(1, std::memory_order_relaxed);
+        uint32_t seen = maxCycles.load(std::memory_order_relaxed);
+        while (cycles > seen && !maxCycles.compare_exchange_weak(seen, cycles, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Adds this histogram's buckets to a plain array (cross-core merge)
+    void accumulate(uint32_t* into, uint32_t& maximum) const;
+    void reset();
+};
+
+// Compact binary MSG_STATUS_RESPONSE payload:
+//   PerfStatusHeader, then recordCount x PerfStatusRecord.
+// Latencies are one byte each: perfEncodeNs() packs nanoseconds with the
+// same log-linear scheme (8 steps per power of two, <=12.5% error, up to
+// ~4.3 s), so three records fit in one 32-byte frame.
+enum StatusPayloadKind : uint8_t {
+    STATUS_PERF_HISTOGRAMS = 1,
+    STATUS_TELEMETRY_DELTA = 2      // See communications/status_service.h
+};
+
+struct PerfStatusHeader {
+    uint8_t kind;               // STATUS_PERF_HISTOGRAMS
+    uint8_t recordCount;
+} __attribute__((packed));
+
+struct PerfStatusRecord {
+    uint8_t probe;
+    uint32_t count;
+    uint8_t p50;
+    uint8_t p90;
+    uint8_t p99;
+    uint8_t max;
+} __attribute__((packed));
+
+#define PERF_WIRE_SUB_BITS 3
+
+inline uint8_t perfEncodeNs(uint32_t ns) { return perfBucketIndex(ns, PERF_WIRE_SUB_BITS); }
+inline uint32_t perfDecodeNs(uint8_t code) { return perfBucketLow(code, PERF_WIRE_SUB_BITS); }
+
+class PerfMonitor {
+private:
+    PerfHistogram histograms[PERF_MAX_CORES][PERF_PROBE_COUNT];
+    float cyclesPerNs;
+
+public:
+    PerfMonitor();
+
+    // Calibrates the cycle counter; call once from setup()
+    void begin();
+
+    void record(PerfProbe probe, uint32_t cycles) {
+        histograms[perfCoreId()][probe].record(cycles);
+    }
+
+    // Merged over cores; quantiles report the bucket's lower bound
+    PerfSummary summarize(PerfProbe probe) const;
+    // Raw merged buckets (PERF_BUCKETS entries) and maximum, in cycles
+    void snapshot(PerfProbe probe, uint32_t* buckets, uint32_t& maxCycles) const;
+    uint32_t cyclesToNs(uint32_t cycles) const { return (uint32_t)(cycles / cyclesPerNs); }
+    float getCyclesPerNs() const { return cyclesPerNs; }
+    void reset();
+
+    // Fills one status payload starting at probe `cursor`, skipping idle
+    // probes. Returns bytes written; cursor is PERF_PROBE_COUNT when done.
+    uint8_t exportStatus(uint8_t* out, uint8_t capacity, uint8_t& cursor) const;
+    bool buildStatusResponse(uint8_t selfId, uint8_t destination, uint16_t sequence,
+                             uint8_t& cursor, DroneMessage& out) const;
+
+    void printReport() const;
+    static const char* getProbeName(PerfProbe probe);
+};
+
+extern PerfMonitor perfMonitor;
+
+class PerfScope {
+private:
+    PerfProbe probe;
+    uint32_t start;
+
+public:
+    explicit PerfScope(PerfProbe probe) : probe(probe), start(perfCycles()) {}
+    ~PerfScope() { perfMonitor.record(probe, perfCycles() - start); }
+};
+
+#define PERF_CONCAT_INNER(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_INNER(a, b)
+
+#if PERF_MONITOR_ENABLED
+#define PERF_SCOPE(probe) PerfScope PERF_CONCAT(perfScope, __LINE__)(probe)
+#else
+#define PERF_SCOPE(probe)
+#endif
+
+#endif // PERFORMANCE_MONITOR_H
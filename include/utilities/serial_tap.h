@@ -0,0 +1,53 @@
+#ifndef SERIAL_TAP_H
+#define SERIAL_TAP_H
+
+#include "flight_recorder.h"
+
+// Serial tap: the flight recorder's frame and boot records, also written
+// to the USB serial console as they happen, so a ground station can follow
+// a drone on the bench or a ground receiver without parsing its log text.
+// Each record goes out as SERIAL_TAP_SYNC followed by the record exactly
+// as the recorder frames it (kind, length, varint ms since the previous
+// tap record, body, CRC-16). The log text never contains the sync byte, so
+// a reader takes everything else as text lines and resynchronizes on the
+// next sync byte when a record fails its CRC.
+//
+// Off by default: the binary records garble `pio device monitor`. Build
+// the drones wired to a ground station with -DSERIAL_TAP_ENABLED=1.
+
+#define SERIAL_TAP_SYNC 0x1E                    // ASCII record separator
+#define SERIAL_TAP_MAX_BYTES (1 + 4 + 5 + FLIGHT_MAX_BODY)
+
+// Writers return bytes written into `out` (SERIAL_TAP_MAX_BYTES)
+uint32_t serialTapEncodeFrame(bool transmitted, const DroneMessage& msg, int16_t rssi, float snr, uint32_t deltaMs,
+                              uint8_t* out);
+uint32_t serialTapEncodeBoot(uint8_t nodeId, uint8_t resetReason, uint32_t clockMs, uint8_t* out);
+
+#ifdef ARDUINO
+#include <esp_system.h>
+
+// Main loop only: Serial is not safe from the radio ISR
+class SerialTap {
+private:
+    uint32_t lastMs;
+
+public:
+    SerialTap() : lastMs(0) {}
+    void boot(uint8_t nodeId, uint8_t resetReason, uint32_t now);
+    void frame(bool transmitted, const DroneMessage& msg, int16_t rssi, float snr, uint32_t now);
+};
+
+extern SerialTap serialTap;
+#endif
+
+#if SERIAL_TAP_ENABLED && defined(ARDUINO)
+#define SERIAL_TAP_BOOT(nodeId) serialTap.boot(nodeId, (uint8_t)esp_reset_reason(), millis())
+#define SERIAL_TAP_TX(msg) serialTap.frame(true, msg, 0, 0, millis())
+#define SERIAL_TAP_RX(msg, rssi, snr) serialTap.frame(false, msg, rssi, snr, millis())
+#else
+#define SERIAL_TAP_BOOT(nodeId)
+#define SERIAL_TAP_TX(msg)
+#define SERIAL_TAP_RX(msg, rssi, snr)
+#endif
+
+#endif // SERIAL_TAP_H
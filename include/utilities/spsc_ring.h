@@ -0,0 +1,48 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <stdint.h>
+
+// Single-producer / single-consumer ring; N must be a power of two
+template <typename T, uint16_t N>
+class SpscRing {
+    static_assert((N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+private:
+    T buffer[N];
+    std::atomic<uint16_t> head; // Written by producer
+    std::atomic<uint16_t> tail; // Written by consumer
+    std::atomic<uint32_t> dropped;
+
+public:
+    SpscRing() : head(0), tail(0), dropped(0) {}
+
+    bool push(const T& item) {
+        uint16_t h = head.load(std::memory_order_relaxed);
+        if ((uint16_t)(h - tail.load(std::memory_order_acquire)) >= N) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        buffer[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        uint16_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = buffer[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint16_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+    uint32_t getDropped() const { return dropped.load(std::memory_order_relaxed); }
+};
+
+#endif // SPSC_RING_H
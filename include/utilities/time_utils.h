@@ -3,41 +3,51 @@
 #ifndef TIME_UTILS_H
 #define TIME_UTILS_H
 
+#ifdef ARDUINO
 #include <Arduino.h>
-#include <bits/stdc++.h>
-#include <map>
-using namespace std;
+#endif
+#include <limits.h>
+#include "../config.h"
+#include "data_structures.h"
 
 unsigned long getCurrentTimestamp();
 bool isTimeout(unsigned long startTime, unsigned long timeoutMs);
 unsigned long getTimeDiff(unsigned long startTime, unsigned long endTime);
 void preciseDelay(unsigned long milliseconds);
 
+// Timers live in a fixed pool (TIMEOUT_POOL_SIZE); ids carry a serial in
+// the upper bits so a stale id never matches a reused slot
 class TimeoutManager
 {
 private:
     struct TimeoutInfo
     {
+        int id;
         unsigned long startTime;
         unsigned long timeoutDuration;
         bool isActive;
-        String name;
+        char name[TIMEOUT_NAME_LENGTH];
     };
-    std::map<int, TimeoutInfo> timeouts;
+    ObjectPool<TimeoutInfo, TIMEOUT_POOL_SIZE> timeouts;
     int nextTimeoutId;
 
+    TimeoutInfo *find(int timeoutId);
+
 public:
     TimeoutManager();
-    int addTimeout(unsigned long timeoutMs, String name = "");
+    // Returns -1 when every slot is taken
+    int addTimeout(unsigned long timeoutMs, const char *name = nullptr);
     bool isTimeoutExpired(int timeoutId);
     void resetTimeout(int timeoutId);
     void removeTimeout(int timeoutId);
-    std::vector<int> getExpiredTimeouts();
-    std::vector<int> checkAllTimeouts();
+    // Fill `ids` with up to `maxIds` expired timeouts; returns how many
+    uint8_t getExpiredTimeouts(int *ids, uint8_t maxIds);
+    uint8_t checkAllTimeouts(int *ids, uint8_t maxIds);
     unsigned long getRemainingTime(int timeoutId);
+    uint8_t getActiveCount() const { return timeouts.size(); }
     void printStatus();
 };
 
 #endif
 
-// Ankit's Part
\ No newline at end of file
+// Ankit's Part
@@ -0,0 +1,52 @@
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// LEB128 varints plus zigzag for signed deltas. Writers return bytes
+// written (0 if it did not fit); readers return bytes consumed (0 on a
+// truncated or over-long value).
+
+inline uint32_t zigzagEncode(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+inline int32_t zigzagDecode(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+inline uint8_t varintSize(uint32_t value) {
+    uint8_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+inline size_t varintWrite(uint8_t* out, size_t capacity, uint32_t value) {
+    if (varintSize(value) > capacity) {
+        return 0;
+    }
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (uint8_t)value;
+    return length;
+}
+
+inline size_t varintRead(const uint8_t* in, size_t available, uint32_t& value) {
+    value = 0;
+    for (size_t i = 0; i < available && i < 5; i++) {
+        value |= (uint32_t)(in[i] & 0x7F) << (7 * i);
+        if (!(in[i] & 0x80)) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+#endif // VARINT_H
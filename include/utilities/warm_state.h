@@ -0,0 +1,180 @@
+#ifndef WARM_STATE_H
+#define WARM_STATE_H
+
+#include "../communications.h"
+#include "../config.h"
+#include "crypto_utils.h"
+#include "../communications/peer_table.h"
+
+#ifndef ARDUINO
+#include <vector>
+#endif
+
+// Warm restart: the state a drone needs to rejoin the swarm at once after a
+// brownout or watchdog reset. It lives in one versioned, CRC-checked block
+// in RTC slow memory, which keeps its contents through every reset except
+// power-on. restore() runs in setup() before the radio comes up:
+//   - link: the epoch and a sequence lease, so sealing carries on above
+//     every nonce already used without a new epoch; plus the per-source
+//     replay windows, which a cold boot would reopen
+//   - mission state, including a latched emergency stop
+//   - the next emergency stop id, so a new stop is not taken for an old one
+//   - the ADR spreading factor and plan epoch, so the node is on the
+//     swarm's SF from its first frame
+//   - the peer table
+// Times are stored as ages at capture and rebased on the RTC clock, which
+// keeps counting through the reset. Past WARM_MAX_DOWNTIME_MS the peers and
+// replay windows are stale, and after WARM_MAX_WARM_BOOTS quick resets in a
+// row the snapshot may be what crashes us; either way only the durable part
+// is used.
+//
+// The durable part (mission stop latch, stop id, SF, plan epoch) is also
+// kept in flash, rewritten only when it changes. After a power-on reset it
+// is all there is; stop ids then skip WARM_STOP_ID_SKIP in case one was
+// used after the last write. The link epoch stays in DroneComm's own NVS
+// key: begin() keeps a resumed epoch only when that key agrees with it.
+
+#define WARM_STATE_MAGIC 0x4D524157u        // "WARM"
+#define WARM_STATE_VERSION 1
+
+struct WarmPeer {
+    uint8_t id;
+    uint8_t missionState;
+    uint8_t status;
+    int16_t lastRssi;
+    int8_t lastSnrQ2;
+    uint32_t heartbeats;
+    uint32_t ageMs;
+} __attribute__((packed));
+
+struct WarmStateBlock {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;            // sizeof(WarmStateBlock): catches layout changes
+    uint16_t warmBoots;         // In a row without WARM_STABLE_MS of uptime
+    uint64_t capturedAtUs;      // RTC clock
+    uint32_t capturedAtMs;      // millis() of the boot that captured it
+
+    uint16_t linkEpoch;
+    uint16_t sequenceLease;     // No frame in linkEpoch used a sequence above this
+    uint8_t replayCount;
+    ReplaySnapshot replay[CRYPTO_REPLAY_SOURCES];
+
+    uint8_t missionState;
+    uint8_t stopReason;
+    uint32_t stoppedAgeMs;
+    uint16_t nextStopId;
+
+    uint8_t spreadingFactor;    // 0: nothing to restore
+    uint8_t adrEpoch;
+
+    uint8_t peerCount;
+    WarmPeer peers[PEER_TABLE_SIZE];
+
+    uint16_t crc;               // Over everything above
+} __attribute__((packed));
+
+enum WarmSource : uint8_t {
+    WARM_COLD = 0,              // Nothing valid: defaults
+    WARM_FROM_FLASH = 1,        // Durable part only
+    WARM_FROM_RTC = 2           // Everything
+};
+
+// Where the durable copy goes
+class WarmBackup {
+public:
+    virtual ~WarmBackup() {}
+    virtual bool load(WarmStateBlock& block) = 0;
+    virtual bool store(const WarmStateBlock& block) = 0;
+};
+
+#ifdef ARDUINO
+// One NVS blob in namespace WARM_NVS_NAMESPACE
+class NvsWarmBackup : public WarmBackup {
+public:
+    bool load(WarmStateBlock& block) override;
+    bool store(const WarmStateBlock& block) override;
+};
+
+// The RTC slow memory copy; left alone by the startup code
+extern WarmStateBlock warmRtcBlock;
+
+// Microseconds on the RTC timer, which runs on through resets
+uint64_t warmClockUs();
+#else
+// NVS in RAM for tests and the simulator
+class RamWarmBackup : public WarmBackup {
+private:
+    std::vector<uint8_t> blob;
+
+public:
+    uint32_t writes;
+
+    RamWarmBackup() : writes(0) {}
+    void wipe() { blob.clear(); }
+
+    bool load(WarmStateBlock& block) override;
+    bool store(const WarmStateBlock& block) override;
+};
+#endif
+
+struct WarmStats {
+    uint32_t captures;
+    uint32_t backups;
+    uint32_t backupErrors;
+};
+
+class MissionStateMachine;
+class EmergencyStopHandler;
+class AdrController;
+
+// Any component may be null; its part is skipped
+struct WarmComponents {
+    SecureLink* link;
+    MissionStateMachine* mission;
+    EmergencyStopHandler* emergency;
+    AdrController* adr;
+    PeerTable* peers;
+};
+
+class WarmStart {
+private:
+    WarmStateBlock* rtc;
+    WarmBackup* backup;
+    WarmComponents parts;
+    WarmSource source;
+    uint32_t downtimeMs;
+    uint16_t warmBoots;
+    uint32_t bootAt;
+    uint32_t lastCaptureAt;
+    bool backedUp;
+    WarmStateBlock durable;     // As last written to the backup
+    WarmStats stats;
+
+    void fill(WarmStateBlock& block, uint32_t now, uint64_t clockUs);
+    bool durableChanged(const WarmStateBlock& block) const;
+    void restoreDurable(const WarmStateBlock& block, bool fromFlash, uint32_t capturedAt, uint32_t now);
+    void restoreVolatile(const WarmStateBlock& block, uint32_t capturedAt);
+
+public:
+    WarmStart(WarmStateBlock* rtc, WarmBackup* backup, const WarmComponents& parts);
+
+    // In setup(), before DroneComm::begin()
+    WarmSource restore(uint32_t now, uint64_t clockUs);
+
+    // Every main loop pass: a new RTC snapshot each WARM_SAVE_INTERVAL_MS,
+    // and at once when the sequence lease runs low or the durable part
+    // changed; the flash copy only in the last case
+    void service(uint32_t now, uint64_t clockUs);
+    void capture(uint32_t now, uint64_t clockUs);
+
+    WarmSource getSource() const { return source; }
+    uint32_t getDowntimeMs() const { return downtimeMs; }
+    uint16_t getWarmBoots() const { return warmBoots; }
+    WarmStats getStats() const { return stats; }
+
+    static bool isValid(const WarmStateBlock& block);
+    static const char* getSourceName(WarmSource source);
+};
+
+#endif // WARM_STATE_H
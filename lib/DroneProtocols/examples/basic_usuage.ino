@@ -0,0 +1,28 @@
+// Decode received frames through the message registry
+#include <Arduino.h>
+#include <DroneProtocols.h>
+
+MessageRegistry registry;
+
+void onHeartbeat(const DroneMessage& msg, PayloadView<HeartbeatData> heartbeat, void* context) {
+    Serial.printf("Heartbeat from %d: battery %.1f%%\n",
+                  heartbeat.get(&HeartbeatData::droneId), heartbeat.get(&HeartbeatData::batteryLevel));
+}
+
+void setup() {
+    Serial.begin(115200);
+    registry.on<MSG_HEARTBEAT, onHeartbeat>();
+
+    HeartbeatData heartbeat = {4, 76.0f, 37.42f, -122.08f, 0, 1};
+    DroneMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.messageType = MSG_HEARTBEAT;
+    msg.dataLength = sizeof(heartbeat);
+    memcpy(msg.data, &heartbeat, sizeof(heartbeat));
+
+    if (registry.dispatch(msg) != DISPATCH_OK) {
+        Serial.printf("%s frame rejected\n", messageTypeName(msg.messageType));
+    }
+}
+
+void loop() {}
@@ -0,0 +1,101 @@
+#ifndef DRONE_PROTOCOLS_COMMON_STRUCTURES_H
+#define DRONE_PROTOCOLS_COMMON_STRUCTURES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Payloads go on air as the packed structs in include/, little-endian.
+// PayloadView reads them in place from a DroneMessage's data[] without
+// casting the buffer to a struct pointer: every field is copied out with
+// memcpy, so reads are alignment-safe. The wire order is the host order on
+// every target this builds for; big-endian hosts are rejected below.
+
+#define DP_MAX_PAYLOAD 32
+
+// Payload of message types that carry no fixed struct
+struct RawPayload {
+    uint8_t bytes[DP_MAX_PAYLOAD];
+} __attribute__((packed));
+
+template <size_t N> struct WireWord;
+template <> struct WireWord<1> { typedef uint8_t Type; };
+template <> struct WireWord<2> { typedef uint16_t Type; };
+template <> struct WireWord<4> { typedef uint32_t Type; };
+template <> struct WireWord<8> { typedef uint64_t Type; };
+
+// Little-endian load/store of any 1/2/4/8-byte scalar (ints, floats, enums).
+// The host is little-endian (checked below), so a byte copy is the wire
+// order; memcpy keeps it alignment-safe and compiles to a single load.
+template <typename F>
+inline F wireLoad(const uint8_t* p) {
+    static_assert(sizeof(typename WireWord<sizeof(F)>::Type) == sizeof(F), "1/2/4/8-byte scalars only");
+    F value;
+    memcpy(&value, p, sizeof(F));
+    return value;
+}
+
+template <typename F>
+inline void wireStore(uint8_t* p, F value) {
+    static_assert(sizeof(typename WireWord<sizeof(F)>::Type) == sizeof(F), "1/2/4/8-byte scalars only");
+    memcpy(p, &value, sizeof(F));
+}
+
+template <typename T>
+class PayloadView {
+private:
+    const uint8_t* bytes;
+    uint8_t length;
+
+    template <typename F>
+    static size_t offsetOf(F T::*member) {
+        static const T probe = T();
+        return (size_t)((const uint8_t*)&(probe.*member) - (const uint8_t*)&probe);
+    }
+
+public:
+    typedef T Payload;
+
+    PayloadView() : bytes(nullptr), length(0) {}
+    PayloadView(const uint8_t* bytes, uint8_t length) : bytes(bytes), length(length) {}
+
+    // view.get(&HeartbeatData::batteryLevel). Fields past the received
+    // length (short variable-size payloads) read as zero.
+    template <typename F>
+    F get(F T::*member) const {
+        size_t offset = offsetOf(member);
+        if (offset + sizeof(F) > length) {
+            return F();
+        }
+        return wireLoad<F>(bytes + offset);
+    }
+
+    // Scalar at a byte offset, for RawPayload and variable-length tails
+    template <typename F>
+    F read(size_t offset) const {
+        if (offset + sizeof(F) > length) {
+            return F();
+        }
+        return wireLoad<F>(bytes + offset);
+    }
+
+    uint8_t at(uint8_t index) const { return index < length ? bytes[index] : 0; }
+
+    // Aligned copy of the whole payload, zero-filled past the received length.
+    // The struct is in host order, so this is for little-endian hosts only.
+    T load() const {
+        T out;
+        memset(&out, 0, sizeof(T));
+        memcpy(&out, bytes, length < sizeof(T) ? length : sizeof(T));
+        return out;
+    }
+
+    const uint8_t* data() const { return bytes; }
+    uint8_t size() const { return length; }
+};
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "PayloadView::load() and the wire structs assume a little-endian host"
+#endif
+
+#endif // DRONE_PROTOCOLS_COMMON_STRUCTURES_H
@@ -0,0 +1,53 @@
+#include "DroneProtocols.h"
+
+template <uint8_t Type> struct MessageRegistry::RejectFor<Type, true> {
+    static constexpr Thunk thunk = &rejectUnhandled<Type>;
+};
+
+template <uint8_t Type> struct MessageRegistry::RejectFor<Type, false> {
+    static constexpr Thunk thunk = &rejectUnknown;
+};
+
+#define DP_REJECT(type) RejectFor<type, kMessageInfo[type].known>::thunk
+
+// Built by the compiler like kMessageInfo; the constructor copies it in
+const MessageRegistry::Thunk MessageRegistry::kRejectTable[DP_MESSAGE_SLOTS] = {
+    DP_REJECT(0),  DP_REJECT(1),  DP_REJECT(2),  DP_REJECT(3),
+    DP_REJECT(4),  DP_REJECT(5),  DP_REJECT(6),  DP_REJECT(7),
+    DP_REJECT(8),  DP_REJECT(9),  DP_REJECT(10), DP_REJECT(11),
+    DP_REJECT(12), DP_REJECT(13), DP_REJECT(14), DP_REJECT(15),
+    DP_REJECT(16), DP_REJECT(17), DP_REJECT(18), DP_REJECT(19),
+    DP_REJECT(20), DP_REJECT(21), DP_REJECT(22), DP_REJECT(23),
+    DP_REJECT(24), DP_REJECT(25), DP_REJECT(26), DP_REJECT(27),
+    DP_REJECT(28), DP_REJECT(29), DP_REJECT(30), DP_REJECT(31)
+};
+
+#undef DP_REJECT
+
+MessageRegistry::MessageRegistry() {
+    for (uint16_t type = 0; type < 256; type++) {
+        table[type].thunk = type < DP_MESSAGE_SLOTS ? kRejectTable[type] : &rejectUnknown;
+        table[type].context = nullptr;
+    }
+    resetStats();
+}
+
+DispatchResult MessageRegistry::rejectUnknown(MessageRegistry& registry, const DroneMessage&, void*) {
+    registry.stats.unknownType++;
+    return DISPATCH_UNKNOWN_TYPE;
+}
+
+void MessageRegistry::remove(uint8_t type) {
+    if (type < DP_MESSAGE_SLOTS) {
+        table[type].thunk = kRejectTable[type];
+        table[type].context = nullptr;
+    }
+}
+
+bool MessageRegistry::handles(uint8_t type) const {
+    return type < DP_MESSAGE_SLOTS && table[type].thunk != kRejectTable[type];
+}
+
+void MessageRegistry::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
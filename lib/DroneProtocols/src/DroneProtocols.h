@@ -0,0 +1,132 @@
+#ifndef DRONE_PROTOCOLS_H
+#define DRONE_PROTOCOLS_H
+
+#include "MessageTypes.h"
+
+// Receive-side dispatch. Handlers are registered per message type and get a
+// typed PayloadView over the frame's own buffer; the registry checks the
+// type and the dataLength bounds from MessageTypes.h before calling them.
+// The jump table has one entry for every possible messageType byte, so
+// dispatch is one indexed load and one indirect call with no range check.
+// Each entry is instantiated for its type, with that type's length bounds
+// compiled in. Unknown and unhandled types point at rejecting stubs from a
+// constant table rather than null.
+//
+//   static void onHeartbeat(const DroneMessage& msg, PayloadView<HeartbeatData> hb, void* ctx) {...}
+//   registry.on<MSG_HEARTBEAT, onHeartbeat>(&peers);
+//   registry.dispatch(msg);
+
+enum DispatchResult : uint8_t {
+    DISPATCH_OK = 0,
+    DISPATCH_UNKNOWN_TYPE = 1,
+    DISPATCH_BAD_LENGTH = 2,
+    DISPATCH_UNHANDLED = 3          // Valid, but nothing registered for it
+};
+
+struct DispatchStats {
+    uint32_t dispatched;
+    uint32_t unknownType;
+    uint32_t badLength;
+    uint32_t unhandled;
+};
+
+// Checked view without going through a registry: false when `msg` is not
+// a `Type` frame or its length is out of bounds
+template <uint8_t Type>
+inline bool payloadView(const DroneMessage& msg, PayloadView<typename MessageTraits<Type>::Payload>& out) {
+    if (msg.messageType != Type ||
+        msg.dataLength < MessageTraits<Type>::minLength || msg.dataLength > MessageTraits<Type>::maxLength) {
+        return false;
+    }
+    out = PayloadView<typename MessageTraits<Type>::Payload>(msg.data, msg.dataLength);
+    return true;
+}
+
+class MessageRegistry {
+private:
+    typedef DispatchResult (*Thunk)(MessageRegistry& registry, const DroneMessage& msg, void* context);
+
+    struct Slot {
+        Thunk thunk;
+        void* context;
+    };
+
+    Slot table[256];                // Indexed by messageType, every byte value
+    DispatchStats stats;
+
+    // Unsigned wrap folds both bounds into one compare; both are constants
+    template <uint8_t Type>
+    static bool lengthOk(uint8_t length) {
+        return (uint8_t)(length - MessageTraits<Type>::minLength) <=
+               (uint8_t)(MessageTraits<Type>::maxLength - MessageTraits<Type>::minLength);
+    }
+
+    // One instantiation per registered handler, so the handler call itself
+    // is direct and can be inlined
+    template <uint8_t Type,
+              void (*Handler)(const DroneMessage&, PayloadView<typename MessageTraits<Type>::Payload>, void*)>
+    static DispatchResult invoke(MessageRegistry& registry, const DroneMessage& msg, void* context) {
+        if (!lengthOk<Type>(msg.dataLength)) {
+            registry.stats.badLength++;
+            return DISPATCH_BAD_LENGTH;
+        }
+        Handler(msg, PayloadView<typename MessageTraits<Type>::Payload>(msg.data, msg.dataLength), context);
+        registry.stats.dispatched++;
+        return DISPATCH_OK;
+    }
+
+    // Known type with nothing registered: a bad length still counts as one
+    template <uint8_t Type>
+    static DispatchResult rejectUnhandled(MessageRegistry& registry, const DroneMessage& msg, void*) {
+        if (!lengthOk<Type>(msg.dataLength)) {
+            registry.stats.badLength++;
+            return DISPATCH_BAD_LENGTH;
+        }
+        registry.stats.unhandled++;
+        return DISPATCH_UNHANDLED;
+    }
+
+    static DispatchResult rejectUnknown(MessageRegistry& registry, const DroneMessage& msg, void* context);
+    template <uint8_t Type, bool Known> struct RejectFor;
+
+    // What each slot below DP_MESSAGE_SLOTS holds while nothing is registered
+    static const Thunk kRejectTable[DP_MESSAGE_SLOTS];
+
+public:
+    MessageRegistry();
+
+    template <uint8_t Type,
+              void (*Handler)(const DroneMessage&, PayloadView<typename MessageTraits<Type>::Payload>, void*)>
+    void on(void* context = nullptr) {
+        table[Type].thunk = &invoke<Type, Handler>;
+        table[Type].context = context;
+    }
+
+    void remove(uint8_t type);
+    bool handles(uint8_t type) const;
+
+    // Forced inline, -Os included: this runs for every received frame
+    __attribute__((always_inline)) inline DispatchResult dispatch(const DroneMessage& msg) {
+        const Slot& slot = table[msg.messageType];
+        return slot.thunk(*this, msg, slot.context);
+    }
+
+    // A run of messages, e.g. unpacked batch records. The next slot is read
+    // before the current handler runs, so a mispredicted call target
+    // resolves without waiting on the type byte load
+    void dispatch(const DroneMessage* msgs, size_t count) {
+        if (count == 0) return;
+        Slot next = table[msgs[0].messageType];
+        for (size_t i = 0; i + 1 < count; i++) {
+            Slot slot = next;
+            next = table[msgs[i + 1].messageType];
+            slot.thunk(*this, msgs[i], slot.context);
+        }
+        next.thunk(*this, msgs[count - 1], next.context);
+    }
+
+    DispatchStats getStats() const { return stats; }
+    void resetStats();
+};
+
+#endif // DRONE_PROTOCOLS_H
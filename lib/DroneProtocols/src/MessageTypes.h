@@ -0,0 +1,91 @@
+#ifndef DRONE_PROTOCOLS_MESSAGE_TYPES_H
+#define DRONE_PROTOCOLS_MESSAGE_TYPES_H
+
+#include "../../../include/communications.h"
+#include "../../../include/communications/emergency_stop.h"
+#include "../../../include/communications/status_service.h"
+#include "../../../include/communications/lora_interface.h"
+#include "../../../include/communications/reliable_link.h"
+#include "../../../include/communications/message_parser.h"
+#include "../../../include/communications/ota_service.h"
+#include "../../../include/communications/link_quality.h"
+#include "CommonStructures.h"
+
+// Every DroneMessageType with its name, payload struct and accepted
+// dataLength range. Types whose payload is not a fixed struct carry a
+// RawPayload. Adding a message type means adding one line here.
+#define DRONE_MESSAGE_TYPES(X) \
+    X(MSG_HEARTBEAT,          "HEARTBEAT",          HeartbeatData,     sizeof(HeartbeatData),     sizeof(HeartbeatData) + LINK_ROW_MAX_BYTES) \
+    X(MSG_GOSSIP,             "GOSSIP",             RawPayload,        0,                         DP_MAX_PAYLOAD) \
+    X(MSG_MUTEX_REQUEST,      "MUTEX_REQUEST",      RawPayload,        0,                         DP_MAX_PAYLOAD) \
+    X(MSG_MUTEX_RESPONSE,     "MUTEX_RESPONSE",     RawPayload,        0,                         DP_MAX_PAYLOAD) \
+    X(MSG_RAFT_VOTE_REQUEST,  "RAFT_VOTE_REQUEST",  RawPayload,        0,                         DP_MAX_PAYLOAD) \
+    X(MSG_RAFT_VOTE_RESPONSE, "RAFT_VOTE_RESPONSE", RawPayload,        0,                         DP_MAX_PAYLOAD) \
+    X(MSG_MISSION_UPDATE,     "MISSION_UPDATE",     RawPayload,        0,                         DP_MAX_PAYLOAD) \
+    X(MSG_TARGET_FOUND,       "TARGET_FOUND",       TargetReportData,  sizeof(TargetReportData),  sizeof(TargetReportData)) \
+    X(MSG_EMERGENCY_STOP,     "EMERGENCY_STOP",     EmergencyStopData, sizeof(EmergencyStopData), sizeof(EmergencyStopData)) \
+    X(MSG_STATUS_REQUEST,     "STATUS_REQUEST",     StatusRequestData, 1,                         DP_MAX_PAYLOAD) \
+    X(MSG_STATUS_RESPONSE,    "STATUS_RESPONSE",    RawPayload,        1,                         DP_MAX_PAYLOAD) \
+    X(MSG_BATCH,              "BATCH",              RawPayload,        4,                         DP_MAX_PAYLOAD) \
+    X(MSG_LINK_STATE,         "LINK_STATE",         LinkStateData,     sizeof(LinkStateData),     sizeof(LinkStateData)) \
+    X(MSG_RELIABLE,           "RELIABLE",           RawPayload,        sizeof(ReliableHeader),    DP_MAX_PAYLOAD) \
+    X(MSG_FEC,                "FEC",                RawPayload,        sizeof(FecHeader) + FEC_SYMBOL_BYTES, DP_MAX_PAYLOAD) \
+    X(MSG_OTA,                "OTA",                RawPayload,        sizeof(OtaAdvert),         DP_MAX_PAYLOAD)
+
+// Dispatch tables are indexed by messageType; every type must fit
+#define DP_MESSAGE_SLOTS 32
+
+struct MessageInfo {
+    const char* name;
+    uint8_t minLength;
+    uint8_t maxLength;
+    bool known;
+};
+
+// Compile-time traits: MessageTraits<MSG_HEARTBEAT>::Payload is HeartbeatData
+template <uint8_t Type> struct MessageTraits;
+
+#define DP_DEFINE_TRAITS(type, label, payload, minLen, maxLen) \
+    template <> struct MessageTraits<type> { \
+        typedef payload Payload; \
+        static const uint8_t minLength = (minLen); \
+        static const uint8_t maxLength = (maxLen); \
+    }; \
+    static_assert((type) < DP_MESSAGE_SLOTS, #type " does not fit the dispatch table"); \
+    static_assert((minLen) <= (maxLen) && (maxLen) <= DP_MAX_PAYLOAD, #type " length bounds"); \
+    static_assert(sizeof(payload) <= DP_MAX_PAYLOAD, #type " payload exceeds DroneMessage::data");
+DRONE_MESSAGE_TYPES(DP_DEFINE_TRAITS)
+#undef DP_DEFINE_TRAITS
+
+#define DP_INFO_CASE(id, label, payload, minLen, maxLen) \
+    type == (id) ? MessageInfo{label, (uint8_t)(minLen), (uint8_t)(maxLen), true} :
+
+constexpr MessageInfo messageInfoFor(uint8_t type) {
+    return DRONE_MESSAGE_TYPES(DP_INFO_CASE) MessageInfo{"UNKNOWN", 0, 0, false};
+}
+#undef DP_INFO_CASE
+
+// The whole table is built by the compiler; lookups are one indexed load
+constexpr MessageInfo kMessageInfo[DP_MESSAGE_SLOTS] = {
+    messageInfoFor(0),  messageInfoFor(1),  messageInfoFor(2),  messageInfoFor(3),
+    messageInfoFor(4),  messageInfoFor(5),  messageInfoFor(6),  messageInfoFor(7),
+    messageInfoFor(8),  messageInfoFor(9),  messageInfoFor(10), messageInfoFor(11),
+    messageInfoFor(12), messageInfoFor(13), messageInfoFor(14), messageInfoFor(15),
+    messageInfoFor(16), messageInfoFor(17), messageInfoFor(18), messageInfoFor(19),
+    messageInfoFor(20), messageInfoFor(21), messageInfoFor(22), messageInfoFor(23),
+    messageInfoFor(24), messageInfoFor(25), messageInfoFor(26), messageInfoFor(27),
+    messageInfoFor(28), messageInfoFor(29), messageInfoFor(30), messageInfoFor(31)
+};
+
+static_assert(kMessageInfo[MSG_HEARTBEAT].minLength == sizeof(HeartbeatData), "Heartbeat slot");
+static_assert(!kMessageInfo[0].known, "Type 0 is not a message");
+
+inline const MessageInfo& messageInfo(uint8_t type) {
+    return kMessageInfo[type < DP_MESSAGE_SLOTS ? type : 0];
+}
+
+inline const char* messageTypeName(uint8_t type) {
+    return messageInfo(type).name;
+}
+
+#endif // DRONE_PROTOCOLS_MESSAGE_TYPES_H
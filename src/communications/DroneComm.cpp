@@ -1,10 +1,43 @@
-#include "../../include/communication.h"
+#include "../../include/communications.h"
+#include "../../include/communications/emergency_stop.h"
+#include "../../include/utilities/performance_monitor.h"
+#include "../../include/utilities/data_structures.h"
+#include "../../include/utilities/crypto_utils.h"
+#include "../../include/communications/message_parser.h"
+#include "../../include/communications/lora_interface.h"
+#include "../../include/communications/duty_cycle.h"
+#include "../../include/utilities/flight_recorder.h"
+#include "../../include/utilities/serial_tap.h"
+#include <Preferences.h>
 
-DroneComm::DroneComm(uint8_t id) : nodeId(id), sequenceCounter(0), initialized(false) {
+// SX127x registers the emergency task reads itself; the LoRa library only
+// services them from its own DIO0 interrupt, which does SPI in the ISR
+#define SX127X_REG_FIFO                 0x00
+#define SX127X_REG_FIFO_ADDR_PTR        0x0D
+#define SX127X_REG_FIFO_RX_CURRENT_ADDR 0x10
+#define SX127X_REG_IRQ_FLAGS            0x12
+#define SX127X_REG_RX_NB_BYTES          0x13
+#define SX127X_REG_DIO_MAPPING_1        0x40
+#define SX127X_IRQ_CAD_DETECTED         0x01
+#define SX127X_IRQ_CAD_DONE             0x04
+#define SX127X_IRQ_TX_DONE              0x08
+#define SX127X_IRQ_CRC_ERROR            0x20
+#define SX127X_IRQ_RX_DONE              0x40
+#define SX127X_DIO0_TX_DONE             0x40    // DIO_MAPPING_1 bits 7-6 = 01
+
+DroneComm* DroneComm::isrInstance = nullptr;
+
+DroneComm::DroneComm(uint8_t id, SecureLink* link)
+    : nodeId(id), link(link), initialized(false), emergency(nullptr), lastReceivedAt(0), txInFlight(false),
+      mac(nullptr), cadResult(0), schedule(nullptr), radioAsleep(false), emergencyTask(nullptr),
+      radioMutex(nullptr), radioIrq(false), epochDirty(false) {
+    frameAirtimeUs = loraAirtimeUs(loraDefaultPhy(), sizeof(SecureFrame));
+    longestAirtimeUs = frameAirtimeUs;
     // Initialize statistics
     stats.messagesSent = 0;
     stats.messagesReceived = 0;
     stats.messagesLost = 0;
+    stats.messagesPreempted = 0;
     stats.lastRSSI = 0;
     stats.lastSNR = 0;
     stats.uptime = 0;
@@ -28,34 +61,485 @@ bool DroneComm::begin() {
     LoRa.setSpreadingFactor(LORA_SPREADING_FACTOR);
     LoRa.setCodingRate4(LORA_CODING_RATE);
     LoRa.setPreambleLength(LORA_PREAMBLE_LENGTH);
+    LoRa.setSyncWord(LORA_SYNC_WORD);
+
+    // A warm restart carries on in the epoch it was using (see
+    // utilities/warm_state.h), provided it is still the latest one stored.
+    // Any other boot starts a fresh nonce space; store the new epoch before
+    // using it.
+    Preferences prefs;
+    prefs.begin("link", false);
+    uint16_t stored = prefs.getUShort("epoch", 0);
+    uint16_t epoch = link->getEpoch();
+    if (epoch == 0 || epoch != stored) {
+        epoch = stored + 1;
+        prefs.putUShort("epoch", epoch);
+        link->setEpoch(epoch);
+    }
+    prefs.end();
     
     initialized = true;
     
     Serial.println("[COMM] LoRa initialized successfully");
-    Serial.printf("[COMM] Node ID: %d\n", nodeId);
+    Serial.printf("[COMM] Node ID: %d (config %s)\n", nodeId, DRONE_CONFIG.name);
     Serial.printf("[COMM] Frequency: %.1f MHz\n", LORA_FREQUENCY/1E6);
     Serial.printf("[COMM] TX Power: %d dBm\n", LORA_TX_POWER);
+    Serial.printf("[COMM] Link epoch: %u from sequence %u, %u bytes per frame\n", epoch, link->getSequence(),
+                  (unsigned)sizeof(SecureFrame));
+    SERIAL_TAP_BOOT(nodeId);
     
     return true;
 }
 
+void DroneComm::persistEpoch(uint16_t epoch) {
+    Preferences prefs;
+    prefs.begin("link", false);
+    prefs.putUShort("epoch", epoch);
+    prefs.end();
+}
+
+void DroneComm::serviceEpoch() {
+    if (!initialized) {
+        return;
+    }
+    // Stored before its first frame, as in begin(). seal() only wraps by
+    // itself if a whole CRYPTO_EPOCH_ROLL_AT margin went out in one pass
+    if (link->getSequence() >= CRYPTO_EPOCH_ROLL_AT) {
+        uint16_t next = link->getEpoch() + 1;
+        persistEpoch(next);
+        link->setEpoch(next);
+        epochDirty = false;
+    } else if (epochDirty) {
+        epochDirty = false;
+        persistEpoch(link->getEpoch());
+    }
+}
+
+bool DroneComm::enableEmergencyFastPath(EmergencyStopHandler* handler) {
+    if (!initialized || isrInstance) {
+        return false;
+    }
+
+    emergency = handler;
+    emergency->seed(esp_random());
+    radioMutex = xSemaphoreCreateMutex();
+    isrInstance = this;
+
+    // Highest priority on the protocol core so relays never wait behind loop()
+    if (xTaskCreatePinnedToCore(emergencyTaskLoop, "estop", 4096, this, configMAX_PRIORITIES - 1,
+                                &emergencyTask, 0) != pdPASS) {
+        Serial.println("[COMM] ERROR: Emergency task creation failed");
+        isrInstance = nullptr;
+        emergency = nullptr;
+        return false;
+    }
+
+    // Our own handler on DIO0 rather than LoRa.onReceive(): it only wakes
+    // the task, which then owns every radio access for the fast path
+    pinMode(LORA_DIO0, INPUT);
+    attachInterrupt(digitalPinToInterrupt(LORA_DIO0), onDio0Isr, RISING);
+    xSemaphoreTake(radioMutex, portMAX_DELAY);
+    LoRa.receive();
+    xSemaphoreGive(radioMutex);
+
+    Serial.println("[COMM] Emergency fast path enabled");
+    return true;
+}
+
+bool DroneComm::setChannelAccess(ChannelAccess* access) {
+    if (!emergency) {
+        return false;
+    }
+    mac = access;
+    mac->seed(esp_random());
+    mac->setPhy(loraDefaultPhy());
+    Serial.printf("[COMM] Listen before talk enabled, %u ms slots\n", mac->getSlotMs());
+    return true;
+}
+
+bool DroneComm::setDutyCycle(DutyCycle* cycle) {
+    if (!emergency) {
+        return false;
+    }
+    schedule = cycle;
+    schedule->setPhy(loraDefaultPhy());
+    // Stops now go out with the wake preamble; relay slots and repeats make room for it
+    LoRaPhyConfig urgent = loraDefaultPhy();
+    urgent.preambleLength = schedule->getWakePreamble();
+    emergency->setPhy(loraDefaultPhy(), urgent.preambleLength);
+    longestAirtimeUs = loraAirtimeUs(urgent, sizeof(SecureFrame));
+
+    // Receivers take the longest preamble they may see; regular frames
+    // switch back to the short one while they transmit
+    xSemaphoreTake(radioMutex, portMAX_DELAY);
+    if (!txInFlight) {
+        LoRa.idle();
+        LoRa.setPreambleLength(schedule->getWakePreamble());
+        LoRa.receive();
+    }
+    xSemaphoreGive(radioMutex);
+    Serial.printf("[COMM] Duty cycling enabled, %u symbol wake preamble\n", schedule->getWakePreamble());
+    return true;
+}
+
+void DroneComm::sleepRadio() {
+    if (!schedule) {
+        return;
+    }
+    xSemaphoreTake(radioMutex, portMAX_DELAY);
+    // A frame on air finishes first; TX done puts the radio back in receive
+    if (!txInFlight && !radioAsleep) {
+        LoRa.sleep();
+        radioAsleep = true;
+    }
+    xSemaphoreGive(radioMutex);
+}
+
+void DroneComm::wakeRadio() {
+    if (!schedule) {
+        return;
+    }
+    xSemaphoreTake(radioMutex, portMAX_DELAY);
+    if (!txInFlight && radioAsleep) {
+        LoRa.receive();
+        radioAsleep = false;
+    }
+    xSemaphoreGive(radioMutex);
+}
+
+bool DroneComm::sampleChannel() {
+    xSemaphoreTake(radioMutex, portMAX_DELAY);
+    if (txInFlight) {
+        xSemaphoreGive(radioMutex);
+        return false;
+    }
+    cadResult = -1;
+    LoRa.idle();
+    LoRa.channelActivityDetection();
+    xSemaphoreGive(radioMutex);
+
+    uint32_t started = millis();
+    uint32_t limitMs = schedule->getSampleUs() / 1000 + 2;
+    while (cadResult < 0 && millis() - started < limitMs) {
+        delay(1);
+    }
+
+    // Found one: stay in receive for the rest of the preamble and the frame
+    xSemaphoreTake(radioMutex, portMAX_DELAY);
+    bool detected = cadResult > 0;
+    if (!txInFlight) {
+        if (detected) {
+            LoRa.receive();
+        } else {
+            LoRa.sleep();
+        }
+        radioAsleep = !detected;
+    }
+    xSemaphoreGive(radioMutex);
+    return detected;
+}
+
+bool DroneComm::channelActive() {
+    if (!schedule) {
+        return false;
+    }
+    xSemaphoreTake(radioMutex, portMAX_DELAY);
+    bool active = !radioAsleep && (txInFlight || LoRa.rssi() > MAC_RSSI_BUSY_DBM);
+    xSemaphoreGive(radioMutex);
+    return active;
+}
+
+void IRAM_ATTR DroneComm::onDio0Isr() {
+    // No SPI here: every bus transaction takes a FreeRTOS lock. The emergency
+    // task reads out whatever DIO0 is signalling
+    DroneComm* self = isrInstance;
+    if (!self) {
+        return;
+    }
+    self->radioIrq = true;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(self->emergencyTask, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+uint8_t DroneComm::readRadioRegister(uint8_t address) {
+    SPI.beginTransaction(SPISettings(LORA_DEFAULT_SPI_FREQUENCY, MSBFIRST, SPI_MODE0));
+    digitalWrite(LORA_SS, LOW);
+    SPI.transfer(address & 0x7F);
+    uint8_t value = SPI.transfer(0x00);
+    digitalWrite(LORA_SS, HIGH);
+    SPI.endTransaction();
+    return value;
+}
+
+void DroneComm::writeRadioRegister(uint8_t address, uint8_t value) {
+    SPI.beginTransaction(SPISettings(LORA_DEFAULT_SPI_FREQUENCY, MSBFIRST, SPI_MODE0));
+    digitalWrite(LORA_SS, LOW);
+    SPI.transfer(address | 0x80);
+    SPI.transfer(value);
+    digitalWrite(LORA_SS, HIGH);
+    SPI.endTransaction();
+}
+
+// Emergency task, radioMutex held. Clearing the IRQ flags drops DIO0 so the
+// next event raises a fresh edge.
+void DroneComm::serviceRadio() {
+    uint8_t irq = readRadioRegister(SX127X_REG_IRQ_FLAGS);
+    writeRadioRegister(SX127X_REG_IRQ_FLAGS, irq);
+
+    if (irq & SX127X_IRQ_CAD_DONE) {
+        cadResult = (irq & SX127X_IRQ_CAD_DETECTED) ? 1 : 0;
+    } else if (irq & SX127X_IRQ_TX_DONE) {
+        txInFlight = false;
+        if (schedule) {
+            LoRa.setPreambleLength(schedule->getWakePreamble());
+        }
+        LoRa.receive();
+    } else if ((irq & SX127X_IRQ_RX_DONE) && !(irq & SX127X_IRQ_CRC_ERROR)) {
+        receiveFrame();
+    }
+}
+
+void DroneComm::receiveFrame() {
+    if (readRadioRegister(SX127X_REG_RX_NB_BYTES) != sizeof(SecureFrame)) {
+        return;
+    }
+    SecureFrame frame;
+    writeRadioRegister(SX127X_REG_FIFO_ADDR_PTR, readRadioRegister(SX127X_REG_FIFO_RX_CURRENT_ADDR));
+    SPI.beginTransaction(SPISettings(LORA_DEFAULT_SPI_FREQUENCY, MSBFIRST, SPI_MODE0));
+    digitalWrite(LORA_SS, LOW);
+    SPI.transfer(SX127X_REG_FIFO);
+    SPI.transfer((uint8_t*)&frame, sizeof(SecureFrame));
+    digitalWrite(LORA_SS, HIGH);
+    SPI.endTransaction();
+
+    // Forged and replayed frames stop here, before they can latch a stop;
+    // SecureLink counts them
+    uint32_t now = millis();
+    DroneMessage msg;
+    if (link->open(frame, msg, now) != CRYPTO_OK) {
+        return;
+    }
+
+    // Relays this arms go out as soon as the task loop polls the handler
+    if (emergency->onFrame((const uint8_t*)&msg, sizeof(msg), now) != ESTOP_NOT_A_STOP) {
+        return;
+    }
+    if (msg.messageType == MSG_HEARTBEAT && msg.dataLength >= sizeof(HeartbeatData)) {
+        emergency->onPeerHeartbeat(msg.sourceId, ((HeartbeatData*)msg.data)->missionState, now);
+    } else if (msg.messageType == MSG_BATCH) {
+        // Heartbeats usually ride in a batch with other traffic
+        const uint8_t* payload;
+        uint8_t length;
+        if (batchFindRecord(msg, MSG_HEARTBEAT, payload, length) && length >= sizeof(HeartbeatData)) {
+            emergency->onPeerHeartbeat(msg.sourceId, payload[offsetof(HeartbeatData, missionState)], now);
+        }
+    }
+    ReceivedFrame received;
+    received.msg = msg;
+    received.receivedAt = now;
+    received.rssi = LoRa.packetRssi();
+    received.snr = LoRa.packetSnr();
+    rxQueue.push(received);
+}
+
+bool DroneComm::senseChannel() {
+    xSemaphoreTake(radioMutex, portMAX_DELAY);
+    // A frame already being received shows up as energy; CAD would only
+    // catch its preamble and switching to CAD would lose it
+    if (txInFlight || LoRa.rssi() > MAC_RSSI_BUSY_DBM) {
+        xSemaphoreGive(radioMutex);
+        return true;
+    }
+    cadResult = -1;
+    LoRa.channelActivityDetection();
+    xSemaphoreGive(radioMutex);
+
+    // About two symbols; the emergency task may take the radio meanwhile
+    uint32_t started = millis();
+    while (cadResult < 0 && millis() - started < mac->getSlotMs()) {
+        delay(1);
+    }
+
+    xSemaphoreTake(radioMutex, portMAX_DELAY);
+    bool busy = cadResult != 0 || txInFlight;
+    if (!txInFlight) {
+        LoRa.receive();
+    }
+    xSemaphoreGive(radioMutex);
+    return busy;
+}
+
+void DroneComm::emergencyTaskLoop(void* param) {
+    DroneComm* self = (DroneComm*)param;
+    for (;;) {
+        uint32_t wait = self->emergency->nextTransmitIn(millis());
+        ulTaskNotifyTake(pdTRUE, wait == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(wait));
+
+        if (self->radioIrq) {
+            self->radioIrq = false;
+            xSemaphoreTake(self->radioMutex, portMAX_DELAY);
+            self->serviceRadio();
+            xSemaphoreGive(self->radioMutex);
+        }
+
+        DroneMessage msg;
+        bool wake;
+        while (self->emergency->pollTransmit(millis(), msg, self->otherFrameOnAir(), &wake)) {
+            self->sendEmergencyFrame(msg, wake);
+        }
+    }
+}
+
+uint32_t DroneComm::emergencyIdleFor(uint32_t now) {
+    if (!emergency) {
+        return UINT32_MAX;
+    }
+    return radioIrq ? 0 : emergency->nextTransmitIn(now);
+}
+
+// Energy from someone else's frame; our own is aborted for a stop anyway
+bool DroneComm::otherFrameOnAir() {
+    xSemaphoreTake(radioMutex, portMAX_DELAY);
+    bool busy = !txInFlight && !radioAsleep && LoRa.rssi() > MAC_RSSI_BUSY_DBM;
+    xSemaphoreGive(radioMutex);
+    return busy;
+}
+
+void DroneComm::sendEmergencyFrame(const DroneMessage& msg, bool wake) {
+    DroneMessage plain = msg;
+    SecureFrame frame;
+    if (link->seal(plain, frame)) {
+        epochDirty = true;
+    }
+
+    xSemaphoreTake(radioMutex, portMAX_DELAY);
+    if (txInFlight) {
+        // Abort whatever is on air; the stop must not wait for it
+        LoRa.idle();
+        stats.messagesPreempted++;
+    }
+    txInFlight = true;
+    LoRa.beginPacket();
+    if (schedule) {
+        // Long enough for a sleeping neighbour's next channel sample; the
+        // second copy is for neighbours still in receive after the first
+        LoRa.setPreambleLength(wake ? schedule->getWakePreamble() : LORA_PREAMBLE_LENGTH);
+        radioAsleep = false;
+    }
+    LoRa.write((uint8_t*)&frame, sizeof(SecureFrame));
+    writeRadioRegister(SX127X_REG_DIO_MAPPING_1, SX127X_DIO0_TX_DONE);
+    LoRa.endPacket(true);
+    stats.messagesSent++;
+    xSemaphoreGive(radioMutex);
+}
+
+uint16_t DroneComm::triggerEmergencyStop(uint8_t reason) {
+    if (!emergency) {
+        return 0;
+    }
+    uint16_t stopId = emergency->trigger(reason, millis());
+    xTaskNotifyGive(emergencyTask);
+    return stopId;
+}
+
 bool DroneComm::sendMessage(const DroneMessage& msg) {
     if (!initialized) {
         Serial.println("[COMM] ERROR: Not initialized!");
         return false;
     }
+    PERF_SCOPE(PERF_SEND);
     
     Serial.printf("[COMM] Sending message type 0x%02X to drone %d\n", 
                   msg.messageType, msg.destinationId);
+
+    if (emergency && emergency->hasPending()) {
+        // The stop flood has the channel until this node's copies are out;
+        // anything sent now only collides with neighbours' relays
+        Serial.println("[COMM] Emergency stop flooding, message not sent");
+        return false;
+    }
+
+    if (mac) {
+        mac->request(millis());
+        MacAction action;
+        while ((action = mac->poll(millis())) != MAC_TRANSMIT) {
+            if (action == MAC_SENSE) {
+                action = mac->onChannelSensed(senseChannel(), millis());
+            }
+            if (action == MAC_IDLE) {
+                stats.messagesLost++;
+                Serial.println("[COMM] ERROR: Channel busy, message dropped");
+                return false;
+            }
+            uint32_t wait = mac->nextActionIn(millis());
+            if (wait > 0 && wait != UINT32_MAX) {
+                delay(wait);
+            }
+        }
+    }
+
+    DroneMessage plain = msg;
+    if (schedule) {
+        // Counts from the start of the frame, so as late as possible
+        schedule->stamp(plain, millis());
+    }
+    SecureFrame frame;
+    if (link->seal(plain, frame)) {
+        epochDirty = true;
+    }
     
-    // Start packet transmission
-    LoRa.beginPacket();
-    LoRa.write((uint8_t*)&msg, sizeof(DroneMessage));
-    bool success = LoRa.endPacket();
+    bool success;
+    if (emergency) {
+        // Non-blocking send; never cut into an emergency frame already on air.
+        // A frame can't outlast its airtime, so a wait past that means the
+        // TX done edge was lost and the flag would otherwise never clear
+        uint32_t waitStarted = millis();
+        uint32_t waitLimitMs = longestAirtimeUs / 1000 + MAC_TX_DONE_MARGIN_MS;
+        for (;;) {
+            xSemaphoreTake(radioMutex, portMAX_DELAY);
+            if (!txInFlight) break;
+            if (millis() - waitStarted > waitLimitMs) {
+                LoRa.idle();
+                txInFlight = false;
+                Serial.println("[COMM] WARNING: TX done never arrived, radio reset");
+                break;
+            }
+            xSemaphoreGive(radioMutex);
+            delay(1);
+        }
+        txInFlight = true;
+        LoRa.beginPacket();
+        uint32_t airtimeUs = frameAirtimeUs;
+        if (schedule) {
+            // Outside a window, unicast spans the neighbours' next sample
+            uint16_t preamble = schedule->preambleFor(millis(), msg.destinationId != 0xFF);
+            LoRa.setPreambleLength(preamble);
+            airtimeUs += (preamble - LORA_PREAMBLE_LENGTH) * schedule->getSymbolUs();
+            radioAsleep = false;
+        }
+        LoRa.write((uint8_t*)&frame, sizeof(SecureFrame));
+        writeRadioRegister(SX127X_REG_DIO_MAPPING_1, SX127X_DIO0_TX_DONE);
+        success = LoRa.endPacket(true);
+        xSemaphoreGive(radioMutex);
+        if (mac) {
+            mac->onTransmitted(airtimeUs, millis());
+        }
+    } else {
+        // Start packet transmission
+        LoRa.beginPacket();
+        LoRa.write((uint8_t*)&frame, sizeof(SecureFrame));
+        success = LoRa.endPacket();
+    }
     
     if (success) {
         stats.messagesSent++;
-        Serial.printf("[COMM] Message sent successfully (seq: %d)\n", msg.sequenceNumber);
+        if (schedule) {
+            schedule->onActivity(millis());
+        }
+        FLIGHT_RECORD_TX(plain);
+        SERIAL_TAP_TX(plain);
+        Serial.printf("[COMM] Message sent successfully (seq: %d)\n", plain.sequenceNumber);
     } else {
         stats.messagesLost++;
         Serial.println("[COMM] ERROR: Failed to send message");
@@ -65,23 +549,61 @@ bool DroneComm::sendMessage(const DroneMessage& msg) {
 }
 
 bool DroneComm::receiveMessage(DroneMessage& msg) {
+    if (emergency) {
+        // Frames were already read out by the emergency task
+        ReceivedFrame received;
+        if (!rxQueue.pop(received)) {
+            return false;
+        }
+        msg = received.msg;
+        lastReceivedAt = received.receivedAt;
+        PERF_SCOPE(PERF_RECEIVE);
+        stats.lastRSSI = received.rssi;
+        stats.lastSNR = received.snr;
+        if (mac) {
+            mac->onFrameHeard(frameAirtimeUs, millis());
+        }
+        if (!validateChecksum(msg)) {
+            Serial.println("[COMM] ERROR: Message checksum validation failed");
+            stats.messagesLost++;
+            return false;
+        }
+        stats.messagesReceived++;
+        if (schedule) {
+            schedule->onFrame(millis());
+        }
+        FLIGHT_RECORD_RX(msg, stats.lastRSSI, stats.lastSNR);
+        SERIAL_TAP_RX(msg, stats.lastRSSI, stats.lastSNR);
+        return true;
+    }
+
     int packetSize = LoRa.parsePacket();
     
     if (packetSize == 0) {
         return false; // No packet available
     }
+    PERF_SCOPE(PERF_RECEIVE);
     
-    if (packetSize != sizeof(DroneMessage)) {
+    if (packetSize != sizeof(SecureFrame)) {
         Serial.printf("[COMM] WARNING: Invalid packet size: %d bytes\n", packetSize);
         return false;
     }
     
     // Read the packet
-    LoRa.readBytes((uint8_t*)&msg, sizeof(DroneMessage));
+    SecureFrame frame;
+    LoRa.readBytes((uint8_t*)&frame, sizeof(SecureFrame));
     
     // Update signal quality stats
+    lastReceivedAt = millis();
     stats.lastRSSI = LoRa.packetRssi();
     stats.lastSNR = LoRa.packetSnr();
+
+    CryptoResult opened = link->open(frame, msg, millis());
+    if (opened != CRYPTO_OK) {
+        Serial.printf("[COMM] WARNING: Rejected frame from drone %d (%s)\n", frame.msg.sourceId,
+                      opened == CRYPTO_BAD_TAG ? "bad tag" : "replay");
+        return false;
+    }
     
     // Validate checksum
     if (!validateChecksum(msg)) {
@@ -91,6 +613,8 @@ bool DroneComm::receiveMessage(DroneMessage& msg) {
     }
     
     stats.messagesReceived++;
+    FLIGHT_RECORD_RX(msg, stats.lastRSSI, stats.lastSNR);
+    SERIAL_TAP_RX(msg, stats.lastRSSI, stats.lastSNR);
     
     Serial.printf("[COMM] Message received from drone %d (type: 0x%02X, seq: %d)\n", 
                   msg.sourceId, msg.messageType, msg.sequenceNumber);
@@ -111,21 +635,20 @@ bool DroneComm::broadcastMessage(DroneMessageType type, const void* data, uint8_
     msg.sourceId = nodeId;
     msg.destinationId = 0xFF; // Broadcast
     msg.timestamp = millis();
-    msg.sequenceNumber = ++sequenceCounter;
     msg.dataLength = dataLength;
     
     // Copy data if provided
+    memset(msg.data, 0, sizeof(msg.data));
     if (data && dataLength > 0) {
         memcpy(msg.data, data, dataLength);
     }
     
-    // Calculate and set checksum
-    msg.checksum = calculateChecksum((uint8_t*)&msg, sizeof(DroneMessage) - 1);
-    
+    // Sequence number and checksum are stamped when the frame is sealed
     return sendMessage(msg);
 }
 
 uint8_t DroneComm::calculateChecksum(const uint8_t* data, size_t length) {
+    PERF_SCOPE(PERF_CHECKSUM);
     uint8_t checksum = 0;
     for (size_t i = 0; i < length; i++) {
         checksum ^= data[i];
@@ -139,12 +662,59 @@ bool DroneComm::validateChecksum(const DroneMessage& msg) {
 }
 
 void DroneComm::setTxPower(int power) {
-    LoRa.setTxPower(power);
+    if (emergency) {
+        xSemaphoreTake(radioMutex, portMAX_DELAY);
+        LoRa.setTxPower(power);
+        xSemaphoreGive(radioMutex);
+    } else {
+        LoRa.setTxPower(power);
+    }
     Serial.printf("[COMM] TX Power set to: %d dBm\n", power);
 }
 
+bool DroneComm::setSpreadingFactor(uint8_t sf) {
+    if (emergency) {
+        // Retuning mid-frame would cut it off. Holding the mutex also keeps
+        // the emergency task from reading out a frame meanwhile
+        xSemaphoreTake(radioMutex, portMAX_DELAY);
+        if (txInFlight) {
+            xSemaphoreGive(radioMutex);
+            return false;
+        }
+        LoRa.idle();
+        LoRa.setSpreadingFactor(sf);
+        LoRa.receive();
+        xSemaphoreGive(radioMutex);
+
+        // Relay slots must still hold one whole frame
+        LoRaPhyConfig phy = loraDefaultPhy();
+        phy.spreadingFactor = sf;
+        LoRaPhyConfig urgent = phy;
+        if (mac) {
+            mac->setPhy(phy);
+        }
+        if (schedule) {
+            schedule->setPhy(phy);
+            urgent.preambleLength = schedule->getWakePreamble();
+        }
+        emergency->setPhy(phy, urgent.preambleLength);
+        frameAirtimeUs = loraAirtimeUs(phy, sizeof(SecureFrame));
+        longestAirtimeUs = loraAirtimeUs(urgent, sizeof(SecureFrame));
+    } else {
+        LoRa.setSpreadingFactor(sf);
+    }
+    Serial.printf("[COMM] Spreading factor set to: SF%d\n", sf);
+    return true;
+}
+
 void DroneComm::setFrequency(long frequency) {
-    LoRa.setFrequency(frequency);
+    if (emergency) {
+        xSemaphoreTake(radioMutex, portMAX_DELAY);
+        LoRa.setFrequency(frequency);
+        xSemaphoreGive(radioMutex);
+    } else {
+        LoRa.setFrequency(frequency);
+    }
     Serial.printf("[COMM] Frequency set to: %.1f MHz\n", frequency/1E6);
 }
 
@@ -164,18 +734,43 @@ void DroneComm::printStats() {
     Serial.printf("Messages Sent: %lu\n", stats.messagesSent);
     Serial.printf("Messages Received: %lu\n", stats.messagesReceived);
     Serial.printf("Messages Lost: %lu\n", stats.messagesLost);
+    Serial.printf("Messages Preempted: %lu\n", stats.messagesPreempted);
     Serial.printf("Success Rate: %.1f%%\n", 
                   100.0 * stats.messagesSent / (stats.messagesSent + stats.messagesLost));
     Serial.printf("Last RSSI: %d dBm\n", stats.lastRSSI);
     Serial.printf("Last SNR: %.1f dB\n", stats.lastSNR);
+    if (mac) {
+        MacStats access = mac->getStats();
+        Serial.printf("Channel: %.1f%% busy (%.1f%% own), %lu busy checks, %lu dropped, %lu/%lu rate/duty deferrals\n",
+                      mac->getChannelUtilization(), mac->getOwnUtilization(), access.channelBusy,
+                      access.dropped, access.rateDeferrals, access.dutyDeferrals);
+        if (access.sent > 0) {
+            Serial.printf("Channel access delay: avg %lu ms, max %lu ms\n",
+                          access.totalAccessDelayMs / access.sent, access.maxAccessDelayMs);
+        }
+    }
+    if (schedule) {
+        DutyStats duty = schedule->getStats();
+        uint32_t total = duty.awakeMs + duty.sleepMs;
+        Serial.printf("Duty cycle: %lu windows, awake %.1f%%, %lu samples (%lu preambles), %lu adoptions, "
+                      "~%.2f mA\n", duty.windows, total ? 100.0 * duty.awakeMs / total : 100.0, duty.samples,
+                      duty.detections, duty.adoptions, schedule->estimatedCurrentMa());
+    }
+    CryptoStats crypto = link->getStats();
+    Serial.printf("Link: epoch %u, %lu sealed, %lu opened, rejected %lu bad tag / %lu replayed / %lu stale\n",
+                  link->getEpoch(), crypto.sealed, crypto.opened, crypto.badTag, crypto.replayed,
+                  crypto.staleEpoch);
     Serial.printf("Uptime: %.1f seconds\n", stats.uptime / 1000.0);
     Serial.printf("Free Heap: %d bytes\n", ESP.getFreeHeap());
     Serial.println("===============================\n");
+    perfMonitor.printReport();
+    printMemoryPools();
 }
 
 void DroneComm::resetStats() {
     stats.messagesSent = 0;
     stats.messagesReceived = 0;
     stats.messagesLost = 0;
+    stats.messagesPreempted = 0;
     Serial.println("[COMM] Statistics reset");
 }
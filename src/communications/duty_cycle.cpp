@@ -0,0 +1,347 @@
+#include "../../include/communications/duty_cycle.h"
+#include "../../include/communications/message_parser.h"
+#include "../../include/utilities/crypto_utils.h"
+#include <stddef.h>
+#include <string.h>
+
+// Wrapping time comparisons: t has come at now
+static inline bool reached(uint32_t now, uint32_t t) {
+    return (int32_t)(now - t) >= 0;
+}
+
+static inline uint32_t until(uint32_t now, uint32_t t) {
+    return reached(now, t) ? 0 : t - now;
+}
+
+DutyCycle::DutyCycle(uint8_t nodeId) : nodeId(nodeId), periodMs(HEARTBEAT_INTERVAL_MS) {
+    setPhy(loraDefaultPhy());
+    begin(0, false);
+    resetStats();
+}
+
+void DutyCycle::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+void DutyCycle::begin(uint32_t now, bool enable) {
+    enabled = enable;
+    nextOpenAt = now;
+    windowAt = now;
+    windowOpen = false;
+    busyMs = 0;
+    heartbeatPending = false;
+    activityAt = now;
+    announceAt = now;
+    announcing = false;
+    syncUntil = now + DUTY_SYNC_LISTEN_MS;
+    synced = false;
+    discoverUntil = now;
+    // Staggered, so a cluster looks for others more often than each member
+    periodsToDiscovery = 1 + nodeId % DUTY_DISCOVERY_PERIODS;
+    holdUntil = now;
+    nextSampleAt = now;
+    lastPoll = now;
+    lastAction = DUTY_LISTEN;
+}
+
+void DutyCycle::setPeriod(uint32_t ms) {
+    // wakeInMs has to hold a whole period
+    periodMs = ms < 1 ? 1 : (ms > 0xFFFF ? 0xFFFF : ms);
+}
+
+void DutyCycle::setPhy(const LoRaPhyConfig& phy) {
+    symbolUs = loraSymbolTimeUs(phy);
+    phyPreamble = phy.preambleLength;
+    frameMs = (loraAirtimeUs(phy, sizeof(SecureFrame)) + 999) / 1000;
+    // The SX127x CAD takes about two symbols; a MAC slot adds the turnaround
+    sampleUs = 2 * symbolUs;
+    uint32_t jitterMs = (MAC_JITTER_SLOTS * (sampleUs + MAC_TURNAROUND_US) + 999) / 1000;
+    minWindowMs = DUTY_WINDOW_MIN_FRAMES * frameMs + jitterMs;
+    idleMs = DUTY_IDLE_FRAMES * frameMs + jitterMs;
+    pollLeadMs = jitterMs + DUTY_GUARD_MS;
+
+    // Long enough that one sample interval and a CAD fit inside it
+    uint32_t symbols = (DUTY_SAMPLE_INTERVAL_MS * 1000 + sampleUs + symbolUs - 1) / symbolUs + phy.preambleLength;
+    wakePreamble = (uint16_t)(symbols > 0xFFFF ? 0xFFFF : symbols);
+    LoRaPhyConfig urgent = phy;
+    urgent.preambleLength = wakePreamble;
+    // A stop's first copy, or, if that was lost, its second: with the plain
+    // preamble once the first is off air, in a random relay slot and held
+    // back a slot per busy check at most (EmergencyStopHandler)
+    uint32_t slotMs = loraAirtimeUs(urgent, sizeof(SecureFrame)) / 1000 + EMERGENCY_SLOT_GUARD_MS;
+    uint32_t gapMs = slotMs > EMERGENCY_STOP_REPEAT_MS ? slotMs : EMERGENCY_STOP_REPEAT_MS;
+    uint32_t slots = (EMERGENCY_RELAY_SLOTS - 1) + EMERGENCY_RELAY_SLOTS;
+    holdMs = gapMs + slots * (frameMs + EMERGENCY_SLOT_GUARD_MS) + frameMs + DUTY_GUARD_MS;
+}
+
+uint32_t DutyCycle::sampleAfter(uint32_t after) const {
+    // advance() keeps nextOpenAt ahead; the grid steps back from it
+    int32_t ahead = (int32_t)(nextOpenAt - after) % (int32_t)DUTY_SAMPLE_INTERVAL_MS;
+    return after + (ahead > 0 ? ahead : ahead + DUTY_SAMPLE_INTERVAL_MS);
+}
+
+uint32_t DutyCycle::opensAt() const {
+    uint32_t next = nextOpenAt - DUTY_GUARD_MS;
+    if (announcing && (int32_t)(announceAt - DUTY_GUARD_MS - next) < 0) {
+        next = announceAt - DUTY_GUARD_MS;
+    }
+    return next;
+}
+
+void DutyCycle::advance(uint32_t now) {
+    if (!enabled) {
+        // Always listening: just the heartbeat timer
+        if (reached(now, nextOpenAt)) {
+            windowAt = now;
+            nextOpenAt = now + periodMs;
+            heartbeatPending = true;
+            stats.windows++;
+        }
+        return;
+    }
+
+    bool opening = false;
+    if (announcing && reached(now, announceAt - DUTY_GUARD_MS)) {
+        // The schedule we left, once more, to take its members along
+        announcing = false;
+        windowAt = announceAt;
+        opening = true;
+    }
+    if (reached(now, nextOpenAt - DUTY_GUARD_MS)) {
+        while (reached(now, nextOpenAt + periodMs - DUTY_GUARD_MS)) {
+            nextOpenAt += periodMs;     // Overslept: only the latest window counts
+        }
+        windowAt = nextOpenAt;
+        nextOpenAt += periodMs;
+        if (--periodsToDiscovery == 0) {
+            periodsToDiscovery = DUTY_DISCOVERY_PERIODS;
+            discoverUntil = windowAt + periodMs;
+            stats.discoveries++;
+        }
+        opening = true;
+    }
+    if (opening) {
+        if (!windowOpen) {
+            stats.windows++;
+        }
+        windowOpen = true;
+        heartbeatPending = true;
+        activityAt = windowAt;
+    }
+
+    if (windowOpen && reached(now, windowAt + minWindowMs) && reached(now, activityAt + idleMs)) {
+        windowOpen = false;
+        busyMs = now - windowAt;
+        nextSampleAt = sampleAfter(now);
+    }
+}
+
+bool DutyCycle::listening(uint32_t now) const {
+    return !enabled || windowOpen || !reached(now, syncUntil) || !reached(now, discoverUntil) ||
+           !reached(now, holdUntil);
+}
+
+void DutyCycle::account(uint32_t now, DutyAction action) {
+    uint32_t elapsed = now - lastPoll;
+    if (lastAction == DUTY_LISTEN) {
+        stats.awakeMs += elapsed;
+    } else {
+        stats.sleepMs += elapsed;   // A sample is counted on its own
+    }
+    lastPoll = now;
+    lastAction = action;
+}
+
+bool DutyCycle::heartbeatDue(uint32_t now) {
+    advance(now);
+    if (heartbeatPending && reached(now, windowAt)) {
+        heartbeatPending = false;
+        return true;
+    }
+    return false;
+}
+
+bool DutyCycle::mayTransmit(uint32_t now) {
+    advance(now);
+    // Not in the guard: the neighbours may not be listening yet
+    return !enabled || (windowOpen && reached(now, windowAt));
+}
+
+bool DutyCycle::inMinWindow(uint32_t now) const {
+    return windowOpen && reached(now, windowAt) && !reached(now, windowAt + minWindowMs);
+}
+
+uint32_t DutyCycle::pollSample(uint32_t now) const {
+    // Neighbours' windows run about as long as ours did, with frames we may
+    // not hear: past that span, unless it runs into the next window
+    uint32_t from = now + DUTY_GUARD_MS - 1;
+    uint32_t quietAt = windowAt + busyMs;
+    if ((int32_t)(quietAt - from) > 0 && (int32_t)(nextOpenAt - DUTY_GUARD_MS - quietAt) > 0) {
+        from = quietAt;
+    }
+    return sampleAfter(from);
+}
+
+uint32_t DutyCycle::unicastIn(uint32_t now) const {
+    if (!enabled || inMinWindow(now) || !synced) {
+        // Not on a schedule yet: the wake preamble reaches whoever samples
+        return 0;
+    }
+    uint32_t sample = until(now, pollSample(now));
+    return sample > pollLeadMs ? sample - pollLeadMs : 0;
+}
+
+bool DutyCycle::mayTransmitUnicast(uint32_t now) {
+    advance(now);
+    return unicastIn(now) == 0;
+}
+
+uint16_t DutyCycle::preambleFor(uint32_t now, bool unicast) const {
+    if (!enabled || (unicast ? inMinWindow(now) : windowOpen)) {
+        return phyPreamble;
+    }
+    if (!synced) {
+        return wakePreamble;
+    }
+    // From now past the polled sample by the guard, and one CAD
+    uint32_t spanUs = (until(now, pollSample(now)) + DUTY_GUARD_MS) * 1000 + sampleUs;
+    uint32_t symbols = (spanUs + symbolUs - 1) / symbolUs + phyPreamble;
+    return (uint16_t)(symbols < wakePreamble ? symbols : wakePreamble);
+}
+
+DutyAction DutyCycle::poll(uint32_t now) {
+    advance(now);
+    DutyAction action;
+    if (listening(now)) {
+        action = DUTY_LISTEN;
+    } else if (reached(now, nextSampleAt)) {
+        action = DUTY_SAMPLE;
+    } else {
+        action = DUTY_SLEEP;
+    }
+    account(now, action);
+    return action;
+}
+
+uint32_t DutyCycle::nextEventIn(uint32_t now, bool unicastQueued) const {
+    if (!enabled) {
+        return until(now, nextOpenAt);
+    }
+    uint32_t soonest = until(now, opensAt());
+    if (heartbeatPending) {
+        soonest = until(now, windowAt) < soonest ? until(now, windowAt) : soonest;
+    }
+    if (windowOpen) {
+        uint32_t closes = (int32_t)(activityAt + idleMs - (windowAt + minWindowMs)) > 0 ? activityAt + idleMs
+                                                                                         : windowAt + minWindowMs;
+        soonest = until(now, closes) < soonest ? until(now, closes) : soonest;
+    } else if (listening(now)) {
+        // Sync, discovery or a hold: whichever ends last
+        uint32_t ends = until(now, syncUntil);
+        ends = until(now, discoverUntil) > ends ? until(now, discoverUntil) : ends;
+        ends = until(now, holdUntil) > ends ? until(now, holdUntil) : ends;
+        soonest = ends < soonest ? ends : soonest;
+    } else {
+        soonest = until(now, nextSampleAt) < soonest ? until(now, nextSampleAt) : soonest;
+    }
+    if (unicastQueued) {
+        soonest = unicastIn(now) < soonest ? unicastIn(now) : soonest;
+    }
+    return soonest;
+}
+
+void DutyCycle::onSampled(bool detected, uint32_t now) {
+    stats.samples++;
+    nextSampleAt = sampleAfter(now);
+    if (detected) {
+        stats.detections++;
+        holdUntil = now + holdMs;
+    }
+}
+
+void DutyCycle::onActivity(uint32_t now) {
+    if (reached(now, activityAt)) {
+        activityAt = now;
+    }
+}
+
+void DutyCycle::onFrame(uint32_t now) {
+    onActivity(now);
+    // Polled unicast is over long before the longest urgent frame would be
+    if (!reached(now, holdUntil)) {
+        holdUntil = now;
+    }
+}
+
+void DutyCycle::onSchedule(uint16_t wakeInMs, uint32_t receivedAt, uint32_t now) {
+    if (!enabled || wakeInMs == 0) {
+        return;
+    }
+    // Both windows modulo the period, the difference in (-period/2, period/2]
+    int32_t period = (int32_t)periodMs;
+    int32_t offset = (int32_t)(receivedAt - frameMs + wakeInMs - nextOpenAt) % period;
+    if (offset > period / 2) {
+        offset -= period;
+    } else if (offset <= -period / 2) {
+        offset += period;
+    }
+    if (offset <= DUTY_SYNC_TOLERANCE_MS && offset >= -DUTY_SYNC_TOLERANCE_MS) {
+        stats.inSync++;
+        synced = true;
+        return;
+    }
+    // Later than ours: it comes to us, unless we are still looking for a swarm to join
+    bool joining = !synced && !reached(now, syncUntil);
+    if (offset > 0 && !joining) {
+        return;
+    }
+    if (synced) {
+        announceAt = nextOpenAt;
+        announcing = true;
+    }
+    nextOpenAt += offset;
+    synced = true;
+    stats.adoptions++;
+    DEBUG_PRINT("[DUTY] Node %d moved its window %ld ms\n", nodeId, (long)offset);
+}
+
+uint16_t DutyCycle::wakeIn(uint32_t now) const {
+    if (!enabled) {
+        return 0;
+    }
+    int32_t period = (int32_t)periodMs;
+    int32_t wait = (int32_t)(nextOpenAt - now) % period;
+    return (uint16_t)(wait <= 0 ? wait + period : wait);
+}
+
+void DutyCycle::stamp(DroneMessage& frame, uint32_t now) const {
+    if (!enabled) {
+        return;
+    }
+    uint16_t value = wakeIn(now);
+    if (frame.messageType == MSG_LINK_STATE && frame.dataLength >= sizeof(LinkStateData)) {
+        memcpy(frame.data + offsetof(LinkStateData, wakeInMs), &value, sizeof(value));
+        return;
+    }
+    BatchReader reader(frame);
+    uint8_t type, length;
+    const uint8_t* payload;
+    while (reader.next(type, payload, length)) {
+        if (type == MSG_LINK_STATE && length >= sizeof(LinkStateData)) {
+            memcpy(frame.data + (payload - frame.data) + offsetof(LinkStateData, wakeInMs), &value, sizeof(value));
+        }
+    }
+}
+
+float DutyCycle::estimatedCurrentMa() const {
+    double awakeMs = stats.awakeMs;
+    double sleepMs = stats.sleepMs;
+    double sampleMs = stats.samples * (POWER_WAKE_US + sampleUs) / 1000.0;
+    double total = awakeMs + sleepMs;
+    if (total <= 0) {
+        return 0.0f;
+    }
+    double active = POWER_CPU_ACTIVE_MA + POWER_LORA_RX_MA;
+    double asleep = POWER_CPU_LIGHT_SLEEP_MA + POWER_LORA_SLEEP_MA;
+    return (float)((awakeMs * active + (sleepMs - sampleMs) * asleep + sampleMs * active) / total);
+}
@@ -0,0 +1,297 @@
+#include "../../include/communications/emergency_stop.h"
+#include "../../include/utilities/performance_monitor.h"
+#include "../../include/utilities/crypto_utils.h"
+
+// onFrame() and pollTransmit() run in the radio task, other calls from
+// loop(), possibly on the other core
+#ifdef ARDUINO
+static portMUX_TYPE emergencyMux = portMUX_INITIALIZER_UNLOCKED;
+#define EMERGENCY_LOCK() portENTER_CRITICAL_SAFE(&emergencyMux)
+#define EMERGENCY_UNLOCK() portEXIT_CRITICAL_SAFE(&emergencyMux)
+#else
+static std::atomic_flag emergencyLock = ATOMIC_FLAG_INIT;
+#define EMERGENCY_LOCK() while (emergencyLock.test_and_set(std::memory_order_acquire)) {}
+#define EMERGENCY_UNLOCK() emergencyLock.clear(std::memory_order_release)
+#endif
+
+static_assert(EMERGENCY_NEIGHBOURS <= 16, "Echo masks are 16 bits");
+static_assert(EMERGENCY_STOP_REPEATS <= EMERGENCY_STOP_MAX_REPEATS, "Repeats are capped by the max");
+
+EmergencyStopHandler::EmergencyStopHandler(uint8_t selfId, MissionStateMachine* mission)
+    : selfId(selfId), nextStopId(1), sequence(0), mission(mission), nextEntry(0), latestEntry(-1),
+      rngState(1) {
+    seed(selfId);
+    memset(entries, 0, sizeof(entries));
+    memset(neighbours, 0, sizeof(neighbours));
+    memset(&stats, 0, sizeof(stats));
+    setPhy(loraDefaultPhy());
+}
+
+void EmergencyStopHandler::setPhy(const LoRaPhyConfig& phy, uint16_t wakePreamble) {
+    plainSlotMs = loraAirtimeUs(phy, sizeof(SecureFrame)) / 1000 + EMERGENCY_SLOT_GUARD_MS;
+    LoRaPhyConfig urgent = phy;
+    urgent.preambleLength = wakePreamble ? wakePreamble : phy.preambleLength;
+    slotMs = loraAirtimeUs(urgent, sizeof(SecureFrame)) / 1000 + EMERGENCY_SLOT_GUARD_MS;
+}
+
+void EmergencyStopHandler::seed(uint32_t value) {
+    // Murmur3 finaliser: nearby ids/seeds must not give correlated sequences
+    value ^= value >> 16;
+    value *= 0x85EBCA6Bu;
+    value ^= value >> 13;
+    value *= 0xC2B2AE35u;
+    value ^= value >> 16;
+    rngState = value ? value : 1;
+}
+
+uint32_t IRAM_ATTR EmergencyStopHandler::relayDelay(uint16_t slot) {
+    // xorshift32; only needs to decorrelate neighbours
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return ((rngState >> 16) % EMERGENCY_RELAY_SLOTS) * slot;
+}
+
+EmergencyStopHandler::StopEntry* IRAM_ATTR EmergencyStopHandler::find(uint8_t originId, uint16_t stopId) {
+    for (uint8_t i = 0; i < EMERGENCY_DEDUP_ENTRIES; i++) {
+        if (entries[i].used && entries[i].originId == originId && entries[i].stopId == stopId) {
+            return &entries[i];
+        }
+    }
+    return nullptr;
+}
+
+// Oldest entry goes first; a stop that old has long finished flooding
+EmergencyStopHandler::StopEntry* IRAM_ATTR EmergencyStopHandler::allocate() {
+    StopEntry* entry = &entries[nextEntry];
+    nextEntry = (nextEntry + 1) % EMERGENCY_DEDUP_ENTRIES;
+    memset(entry, 0, sizeof(StopEntry));
+    entry->used = true;
+    return entry;
+}
+
+// A new neighbour takes the stalest slot; its bit must not carry over the
+// echoes of whoever had the slot before
+uint16_t IRAM_ATTR EmergencyStopHandler::noteNeighbour(uint8_t id, uint32_t now) {
+    uint8_t slot = 0;
+    for (uint8_t i = 0; i < EMERGENCY_NEIGHBOURS; i++) {
+        if (neighbours[i].used && neighbours[i].id == id) {
+            neighbours[i].heardAt = now;
+            return 1u << i;
+        }
+        bool staler = (int32_t)(neighbours[i].heardAt - neighbours[slot].heardAt) < 0;
+        if (!neighbours[i].used || (neighbours[slot].used && staler)) {
+            slot = i;
+        }
+    }
+    neighbours[slot].id = id;
+    neighbours[slot].heardAt = now;
+    neighbours[slot].used = true;
+    for (uint8_t i = 0; i < EMERGENCY_DEDUP_ENTRIES; i++) {
+        entries[i].echoed &= ~(1u << slot);
+    }
+    return 1u << slot;
+}
+
+uint16_t EmergencyStopHandler::liveNeighbours(uint32_t now) const {
+    uint16_t live = 0;
+    for (uint8_t i = 0; i < EMERGENCY_NEIGHBOURS; i++) {
+        if (neighbours[i].used && now - neighbours[i].heardAt < HEARTBEAT_TIMEOUT_MS) {
+            live |= 1u << i;
+        }
+    }
+    return live;
+}
+
+uint16_t EmergencyStopHandler::trigger(uint8_t reason, uint32_t now) {
+    EMERGENCY_LOCK();
+    StopEntry* entry = allocate();
+    entry->originId = selfId;
+    entry->stopId = nextStopId++;
+    entry->hopCount = 0;
+    entry->reason = reason;
+    entry->nextTxAt = now;
+    entry->pending = true;
+    latestEntry = entry - entries;
+    uint16_t stopId = entry->stopId;
+    stats.triggered++;
+    EMERGENCY_UNLOCK();
+
+    if (mission) {
+        mission->emergencyStop(reason, now);
+    }
+    DEBUG_PRINT("[ESTOP] Triggered stop %u (reason %u)\n", stopId, reason);
+    return stopId;
+}
+
+EmergencyRxResult IRAM_ATTR EmergencyStopHandler::onFrame(const uint8_t* raw, size_t length, uint32_t now) {
+    if (!isEmergencyFrame(raw, length)) {
+        return ESTOP_NOT_A_STOP;
+    }
+    PERF_SCOPE(PERF_HANDLER_EMERGENCY);
+
+    const DroneMessage* msg = (const DroneMessage*)raw;
+    if (msg->dataLength != sizeof(EmergencyStopData) || droneMessageChecksum(*msg) != msg->checksum) {
+        stats.invalid++;
+        return ESTOP_INVALID;
+    }
+    EmergencyStopData data;
+    memcpy(&data, msg->data, sizeof(data));
+
+    EMERGENCY_LOCK();
+    stats.received++;
+    uint16_t sender = noteNeighbour(msg->sourceId, now);
+    StopEntry* entry = find(data.originId, data.stopId);
+    if (entry) {
+        if (entry->heardSinceSend < 0xFF) entry->heardSinceSend++;
+        entry->echoed |= sender;
+        stats.duplicates++;
+        EMERGENCY_UNLOCK();
+        return ESTOP_DUPLICATE;
+    }
+
+    entry = allocate();
+    entry->originId = data.originId;
+    entry->stopId = data.stopId;
+    entry->hopCount = data.hopCount;
+    entry->reason = data.reason;
+    entry->echoed = sender;
+    entry->pending = data.hopCount + 1 < EMERGENCY_MAX_HOPS;
+    entry->nextTxAt = now + relayDelay(slotMs);
+    latestEntry = entry - entries;
+    stats.applied++;
+    EMERGENCY_UNLOCK();
+
+    // Latch before anything else happens on this node
+    if (mission) {
+        mission->emergencyStop(data.reason, now);
+    }
+    return ESTOP_APPLIED;
+}
+
+bool IRAM_ATTR EmergencyStopHandler::onPeerHeartbeat(uint8_t peerId, uint8_t peerMissionState, uint32_t now) {
+    EMERGENCY_LOCK();
+    uint16_t peer = noteNeighbour(peerId, now);
+    if (peerMissionState == MISSION_EMERGENCY_STOP) {
+        // Stopped already, whichever copy reached it
+        for (uint8_t i = 0; i < EMERGENCY_DEDUP_ENTRIES; i++) {
+            entries[i].echoed |= peer;
+        }
+        EMERGENCY_UNLOCK();
+        return false;
+    }
+    if (!mission || !mission->isStopped()) {
+        EMERGENCY_UNLOCK();
+        return false;
+    }
+
+    StopEntry* entry = latestEntry >= 0 ? &entries[latestEntry] : nullptr;
+    bool armed = entry && entry->used && !entry->pending;
+    if (armed) {
+        // One more send, in a random slot like any other relay
+        entry->pending = true;
+        entry->sent = EMERGENCY_STOP_MAX_REPEATS - 1;
+        entry->heardSinceSend = 0;
+        entry->nextTxAt = now + relayDelay(slotMs);
+        stats.reannounced++;
+    }
+    EMERGENCY_UNLOCK();
+    return armed;
+}
+
+bool EmergencyStopHandler::pollTransmit(uint32_t now, DroneMessage& out, bool channelBusy, bool* wake) {
+    EMERGENCY_LOCK();
+    StopEntry* due = nullptr;
+    for (uint8_t i = 0; i < EMERGENCY_DEDUP_ENTRIES; i++) {
+        StopEntry& e = entries[i];
+        if (e.pending && (int32_t)(now - e.nextTxAt) >= 0 &&
+            (!due || (int32_t)(e.nextTxAt - due->nextTxAt) < 0)) {
+            due = &e;
+        }
+    }
+
+    if (!due) {
+        EMERGENCY_UNLOCK();
+        return false;
+    }
+
+    // Only the second copy goes with the plain preamble
+    bool wakes = due->sent != 1;
+    uint16_t copySlotMs = wakes ? slotMs : plainSlotMs;
+
+    // A copy started now would collide with the frame on air. Bounded, so a
+    // busy channel holds a copy back EMERGENCY_RELAY_SLOTS slots at most
+    if (channelBusy && due->deferrals < EMERGENCY_RELAY_SLOTS) {
+        due->deferrals++;
+        due->nextTxAt = now + copySlotMs;
+        stats.deferred++;
+        EMERGENCY_UNLOCK();
+        return false;
+    }
+    due->deferrals = 0;
+
+    // Repeats matter while a live neighbour has not echoed the stop, or
+    // if the neighbourhood has gone quiet
+    bool missing = (liveNeighbours(now) & ~due->echoed) != 0;
+    bool send = due->sent == 0 || missing || due->heardSinceSend < EMERGENCY_SUPPRESS_COUNT;
+    if (!send) {
+        stats.suppressed++;
+    }
+    due->sent++;
+    due->heardSinceSend = 0;
+    if (due->sent >= EMERGENCY_STOP_MAX_REPEATS || (due->sent >= EMERGENCY_STOP_REPEATS && !missing)) {
+        due->pending = false;
+    } else {
+        // Not before this copy is off air: slow SFs and wake preambles outlast the repeat period
+        uint32_t gap = copySlotMs > EMERGENCY_STOP_REPEAT_MS ? copySlotMs : EMERGENCY_STOP_REPEAT_MS;
+        // Relay slots as long as the next copy
+        due->nextTxAt = now + gap + relayDelay(due->sent == 1 ? plainSlotMs : slotMs);
+    }
+
+    if (send) {
+        EmergencyStopData data;
+        data.originId = due->originId;
+        data.stopId = due->stopId;
+        data.hopCount = due->originId == selfId ? 0 : due->hopCount + 1;
+        data.reason = due->reason;
+
+        memset(&out, 0, sizeof(out));
+        out.messageType = MSG_EMERGENCY_STOP;
+        out.sourceId = selfId;
+        out.destinationId = 0xFF;
+        out.timestamp = now;
+        out.sequenceNumber = ++sequence;
+        out.dataLength = sizeof(data);
+        memcpy(out.data, &data, sizeof(data));
+        out.checksum = droneMessageChecksum(out);
+        if (wake) {
+            *wake = wakes;
+        }
+        stats.transmitted++;
+    }
+    EMERGENCY_UNLOCK();
+    return send;
+}
+
+uint32_t EmergencyStopHandler::nextTransmitIn(uint32_t now) {
+    uint32_t soonest = UINT32_MAX;
+    EMERGENCY_LOCK();
+    for (uint8_t i = 0; i < EMERGENCY_DEDUP_ENTRIES; i++) {
+        if (!entries[i].pending) continue;
+        int32_t wait = (int32_t)(entries[i].nextTxAt - now);
+        uint32_t w = wait > 0 ? (uint32_t)wait : 0;
+        if (w < soonest) soonest = w;
+    }
+    EMERGENCY_UNLOCK();
+    return soonest;
+}
+
+bool EmergencyStopHandler::hasPending() {
+    bool pending = false;
+    EMERGENCY_LOCK();
+    for (uint8_t i = 0; i < EMERGENCY_DEDUP_ENTRIES; i++) {
+        pending |= entries[i].pending;
+    }
+    EMERGENCY_UNLOCK();
+    return pending;
+}
@@ -0,0 +1,273 @@
+#include "../../include/communications/link_quality.h"
+#include <math.h>
+#include <string.h>
+
+uint8_t linkQualityPack(float prr, float snr) {
+    float p = prr < 0.0f ? 0.0f : (prr > 1.0f ? 1.0f : prr);
+    long s = lroundf((snr - LINK_ROW_SNR_MIN_DB) / LINK_ROW_SNR_STEP_DB);
+    s = s < 0 ? 0 : (s > 15 ? 15 : s);
+    return (uint8_t)((lroundf(p * 15.0f) << 4) | s);
+}
+
+LinkQualityTable::LinkQualityTable(uint8_t nodeId)
+    : nodeId(nodeId), heartbeatIntervalMs(HEARTBEAT_INTERVAL_MS), windowStart(0), rowCursor(0) {
+    memset(slots, 0, sizeof(slots));
+    resetStats();
+}
+
+void LinkQualityTable::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+void LinkQualityTable::setHeartbeatInterval(uint32_t ms) {
+    heartbeatIntervalMs = ms > 0 ? ms : 1;
+}
+
+LinkNeighbour* LinkQualityTable::findNeighbour(uint8_t id) {
+    for (uint8_t i = 0; i < LINK_MAX_NEIGHBOURS; i++) {
+        if (slots[i].used && slots[i].n.id == id) {
+            return &slots[i].n;
+        }
+    }
+    return nullptr;
+}
+
+const LinkNeighbour* LinkQualityTable::find(uint8_t id) const {
+    return const_cast<LinkQualityTable*>(this)->findNeighbour(id);
+}
+
+uint8_t LinkQualityTable::size() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < LINK_MAX_NEIGHBOURS; i++) {
+        count += slots[i].used ? 1 : 0;
+    }
+    return count;
+}
+
+LinkNeighbour* LinkQualityTable::allocate(uint8_t id, uint32_t now) {
+    Slot* slot = nullptr;
+    for (uint8_t i = 0; i < LINK_MAX_NEIGHBOURS && !slot; i++) {
+        if (!slots[i].used) {
+            slot = &slots[i];
+        }
+    }
+    if (!slot) {
+        for (uint8_t i = 0; i < LINK_MAX_NEIGHBOURS; i++) {
+            if (!slot || (int32_t)(slots[i].n.lastHeard - slot->n.lastHeard) < 0) {
+                slot = &slots[i];
+            }
+        }
+        stats.evictions++;
+    }
+    memset(slot, 0, sizeof(*slot));
+    slot->used = true;
+    slot->n.id = id;
+    slot->n.lastHeard = now;
+    DEBUG_PRINT("[LINK] New neighbour %d\n", id);
+    return &slot->n;
+}
+
+void LinkQualityTable::onFrame(uint8_t sourceId, uint16_t sequence, int16_t rssi, float snr, uint32_t now) {
+    if (sourceId == nodeId) {
+        return;
+    }
+    LinkNeighbour* n = findNeighbour(sourceId);
+    if (!n) {
+        n = allocate(sourceId, now);
+        n->rssi = rssi;
+        n->snr = snr;
+    } else {
+        uint16_t gap = (uint16_t)(sequence - n->lastSequence);
+        if (gap == 0) {
+            return;                 // Same frame twice, e.g. from a second radio path
+        }
+        if (gap > LINK_MAX_SEQUENCE_GAP) {
+            // New epoch after a reboot, or a long absence: nothing to count
+            stats.restarts++;
+        } else {
+            // Losses already charged to silent windows are not counted twice;
+            // an overestimate there is left for the EWMA to forget
+            uint16_t missed = gap - 1;
+            uint16_t lost = missed > n->creditedLost ? missed - n->creditedLost : 0;
+            n->windowLost += lost;
+            n->framesLost += lost;
+            stats.framesLost += lost;
+        }
+        n->creditedLost = 0;
+        n->rssi += LINK_SIGNAL_ALPHA * (rssi - n->rssi);
+        n->snr += LINK_SIGNAL_ALPHA * (snr - n->snr);
+    }
+    n->lastSequence = sequence;
+    n->windowHeard++;
+    n->framesHeard++;
+    n->lastHeard = now;
+    stats.framesHeard++;
+}
+
+void LinkQualityTable::closeWindow(LinkNeighbour& n) {
+    if (n.windowHeard == 0 && n.windowLost == 0) {
+        // Not a single frame: at least its heartbeats went missing
+        uint16_t lost = LINK_WINDOW_HEARTBEATS;
+        n.windowLost = lost;
+        n.framesLost += lost;
+        stats.framesLost += lost;
+        if (n.creditedLost < LINK_MAX_SEQUENCE_GAP) {
+            n.creditedLost += lost;
+        }
+    }
+    float sample = (float)n.windowHeard / (n.windowHeard + n.windowLost);
+    n.prr = n.prrValid ? n.prr + LINK_PRR_ALPHA * (sample - n.prr) : sample;
+    n.prrValid = true;
+    n.windowHeard = 0;
+    n.windowLost = 0;
+}
+
+void LinkQualityTable::update(uint32_t now) {
+    bool windowDue = now - windowStart >= LINK_WINDOW_HEARTBEATS * heartbeatIntervalMs;
+    if (windowDue) {
+        windowStart = now;
+    }
+    for (uint8_t i = 0; i < LINK_MAX_NEIGHBOURS; i++) {
+        if (!slots[i].used) {
+            continue;
+        }
+        LinkNeighbour& n = slots[i].n;
+        if (now - n.lastHeard > LINK_FORGET_MS) {
+            DEBUG_PRINT("[LINK] Neighbour %d forgotten\n", n.id);
+            slots[i].used = false;
+            continue;
+        }
+        if (windowDue) {
+            closeWindow(n);
+        }
+        // Reported links it stopped mentioning go stale the same way
+        uint8_t kept = 0;
+        for (uint8_t e = 0; e < n.rowCount; e++) {
+            if (now - n.rowUpdatedAt[e] <= LINK_FORGET_MS) {
+                n.row[kept] = n.row[e];
+                n.rowUpdatedAt[kept] = n.rowUpdatedAt[e];
+                kept++;
+            }
+        }
+        n.rowCount = kept;
+    }
+}
+
+void LinkQualityTable::onRow(uint8_t reporter, const uint8_t* data, uint8_t length, uint32_t now) {
+    LinkNeighbour* n = findNeighbour(reporter);
+    if (!n) {
+        return;
+    }
+    stats.rowsHeard++;
+    for (uint8_t offset = 0; offset + sizeof(LinkRowEntry) <= length; offset += sizeof(LinkRowEntry)) {
+        LinkRowEntry entry;
+        memcpy(&entry, data + offset, sizeof(entry));
+        uint8_t e = 0;
+        while (e < n->rowCount && n->row[e].id != entry.id) {
+            e++;
+        }
+        if (e == n->rowCount) {
+            if (n->rowCount < LINK_MAX_NEIGHBOURS) {
+                n->rowCount++;
+            } else {
+                // Full: the entry heard about longest ago makes room
+                e = 0;
+                for (uint8_t i = 1; i < n->rowCount; i++) {
+                    if ((int32_t)(n->rowUpdatedAt[i] - n->rowUpdatedAt[e]) < 0) {
+                        e = i;
+                    }
+                }
+            }
+        }
+        n->row[e] = entry;
+        n->rowUpdatedAt[e] = now;
+    }
+}
+
+uint8_t LinkQualityTable::fillRow(LinkRowEntry* out, uint8_t maxEntries) {
+    uint8_t count = 0;
+    uint8_t start = rowCursor;
+    for (uint8_t step = 0; step < LINK_MAX_NEIGHBOURS && count < maxEntries; step++) {
+        uint8_t i = (start + step) % LINK_MAX_NEIGHBOURS;
+        const LinkNeighbour& n = slots[i].n;
+        if (!slots[i].used || !n.prrValid) {
+            continue;
+        }
+        out[count].id = n.id;
+        out[count].quality = linkQualityPack(n.prr, n.snr);
+        count++;
+        rowCursor = (i + 1) % LINK_MAX_NEIGHBOURS;
+    }
+    stats.rowEntriesSent += count;
+    return count;
+}
+
+bool LinkQualityTable::reported(uint8_t receiver, uint8_t source, LinkView& out) const {
+    const LinkNeighbour* n = find(receiver);
+    if (!n) {
+        return false;
+    }
+    for (uint8_t e = 0; e < n->rowCount; e++) {
+        if (n->row[e].id == source) {
+            out.prr = linkQualityPrr(n->row[e].quality);
+            out.snr = linkQualitySnr(n->row[e].quality);
+            out.measured = false;
+            out.updatedAt = n->rowUpdatedAt[e];
+            return true;
+        }
+    }
+    return false;
+}
+
+bool LinkQualityTable::link(uint8_t receiver, uint8_t source, LinkView& out) const {
+    if (receiver != nodeId) {
+        return reported(receiver, source, out);
+    }
+    const LinkNeighbour* n = find(source);
+    if (!n || !n->prrValid) {
+        return false;
+    }
+    out.prr = n->prr;
+    out.snr = n->snr;
+    out.measured = true;
+    out.updatedAt = n->lastHeard;
+    return true;
+}
+
+float LinkQualityTable::etx(uint8_t a, uint8_t b) const {
+    LinkView forward, reverse;
+    if (!link(b, a, forward) || !link(a, b, reverse)) {
+        return INFINITY;
+    }
+    float both = forward.prr * reverse.prr;
+    return both > 0.0f ? 1.0f / both : INFINITY;
+}
+
+float LinkQualityTable::linkScore(uint8_t node) const {
+    // Every id this node could have a known link with: us, our neighbours
+    // and whoever their rows mention
+    uint32_t candidates[8] = {0};
+    candidates[nodeId >> 5] |= 1u << (nodeId & 31);
+    for (uint8_t i = 0; i < LINK_MAX_NEIGHBOURS; i++) {
+        if (!slots[i].used) {
+            continue;
+        }
+        const LinkNeighbour& n = slots[i].n;
+        candidates[n.id >> 5] |= 1u << (n.id & 31);
+        for (uint8_t e = 0; e < n.rowCount; e++) {
+            candidates[n.row[e].id >> 5] |= 1u << (n.row[e].id & 31);
+        }
+    }
+
+    float score = 0.0f;
+    for (uint16_t other = 0; other < 256; other++) {
+        if (other == node || !(candidates[other >> 5] & (1u << (other & 31)))) {
+            continue;
+        }
+        LinkView in, out;
+        if (link(node, (uint8_t)other, in) && link((uint8_t)other, node, out)) {
+            score += in.prr * out.prr;
+        }
+    }
+    return score;
+}
@@ -0,0 +1,547 @@
+#include "../../include/communications/lora_interface.h"
+#include "../../include/utilities/crypto_utils.h"
+#include <math.h>
+#include <string.h>
+
+LoRaPhyConfig loraDefaultPhy() {
+    LoRaPhyConfig phy;
+    phy.spreadingFactor = LORA_SPREADING_FACTOR;
+    phy.bandwidthHz = (uint32_t)LORA_BANDWIDTH;
+    phy.codingRate = LORA_CODING_RATE;
+    phy.preambleLength = LORA_PREAMBLE_LENGTH;
+    phy.explicitHeader = true;
+    phy.crcOn = false;          // LoRa library default
+    return phy;
+}
+
+uint32_t loraSymbolTimeUs(const LoRaPhyConfig& phy) {
+    return (uint32_t)(((uint64_t)1000000 << phy.spreadingFactor) / phy.bandwidthHz);
+}
+
+uint32_t loraAirtimeUs(const LoRaPhyConfig& phy, uint8_t payloadBytes) {
+    uint32_t symbolUs = loraSymbolTimeUs(phy);
+    int32_t sf = phy.spreadingFactor;
+    // Low data rate optimisation is mandatory above 16 ms symbols
+    int32_t lowDataRate = symbolUs > 16000 ? 1 : 0;
+
+    int32_t numerator = 8 * payloadBytes - 4 * sf + 28 + (phy.crcOn ? 16 : 0) - (phy.explicitHeader ? 0 : 20);
+    int32_t denominator = 4 * (sf - 2 * lowDataRate);
+    int32_t blocks = numerator > 0 ? (numerator + denominator - 1) / denominator : 0;
+    uint32_t payloadSymbols = 8 + blocks * phy.codingRate;
+
+    // Preamble is (n + 4.25) symbols
+    uint32_t preambleUs = phy.preambleLength * symbolUs + (17 * symbolUs) / 4;
+    return preambleUs + payloadSymbols * symbolUs;
+}
+
+float loraSnrFloorDb(uint8_t spreadingFactor) {
+    // SF7 -7.5 dB, then 2.5 dB per step down to SF12 -20 dB
+    if (spreadingFactor < 7) spreadingFactor = 7;
+    if (spreadingFactor > 12) spreadingFactor = 12;
+    return -7.5f - 2.5f * (spreadingFactor - 7);
+}
+
+float loraNoiseFloorDbm(const LoRaPhyConfig& phy) {
+    return -174.0f + 10.0f * log10f((float)phy.bandwidthHz) + LORA_NOISE_FIGURE_DB;
+}
+
+float loraTxCurrentMa(int8_t powerDbm) {
+    // 17 and 20 dBm from the SX1276 datasheet; below that an estimate, as
+    // the PA_BOOST path never gets down to the RFO's 20 mA
+    static const int8_t levels[] = {2, 7, 13, 17, 20};
+    static const float currents[] = {28.0f, 35.0f, 55.0f, 87.0f, 120.0f};
+    if (powerDbm <= levels[0]) {
+        return currents[0];
+    }
+    for (uint8_t i = 1; i < sizeof(levels); i++) {
+        if (powerDbm <= levels[i]) {
+            float t = (float)(powerDbm - levels[i - 1]) / (levels[i] - levels[i - 1]);
+            return currents[i - 1] + t * (currents[i] - currents[i - 1]);
+        }
+    }
+    return currents[sizeof(levels) - 1];
+}
+
+// Epochs wrap; a plan is newer if it is less than half the space ahead
+static inline bool epochNewer(uint8_t a, uint8_t b) {
+    return (int8_t)(a - b) > 0;
+}
+
+AdrController::AdrController(uint8_t nodeId)
+    : nodeId(nodeId), noiseFloorDbm(loraNoiseFloorDbm(loraDefaultPhy())), sf(LORA_SPREADING_FACTOR),
+      powerDbm(ADR_MAX_TX_POWER_DBM), maxPowerDbm(ADR_MAX_TX_POWER_DBM), requiredSf(LORA_SPREADING_FACTOR),
+      requiredHops(0), epoch(0), planPending(false), planSf(LORA_SPREADING_FACTOR), switchAt(0), lastSwitchAt(0),
+      lastPowerCut(0), belowCurrent(false), belowSince(0), heardAny(false), lastHeardAt(0), scanning(false),
+      scanStepAt(0), changed(false) {
+    memset(neighbours, 0, sizeof(neighbours));
+    LoRaPhyConfig phy = loraDefaultPhy();
+    for (uint8_t s = ADR_MIN_SF; s <= ADR_MAX_SF; s++) {
+        phy.spreadingFactor = s;
+        airtimeUs[s - ADR_MIN_SF] = loraAirtimeUs(phy, sizeof(SecureFrame));
+    }
+    resetStats();
+}
+
+AdrController::Neighbour* AdrController::find(uint8_t id, uint32_t now) {
+    Neighbour* slot = nullptr;
+    for (uint8_t i = 0; i < ADR_MAX_NEIGHBOURS; i++) {
+        Neighbour& n = neighbours[i];
+        if (n.used && n.id == id) {
+            return &n;
+        }
+        // Prefer a free entry, else the longest-silent neighbour makes room
+        if (!slot || (slot->used && (!n.used || now - n.lastHeard > now - slot->lastHeard))) {
+            slot = &n;
+        }
+    }
+    memset(slot, 0, sizeof(*slot));
+    slot->used = true;
+    slot->id = id;
+    return slot;
+}
+
+float AdrController::linkSnr(const Neighbour& n) const {
+    return n.snrEwma - ADR_DEVIATION_WEIGHT * n.snrDeviation;
+}
+
+uint8_t AdrController::cheapestSf(uint32_t now) const {
+    uint8_t best = 0;
+    float bestCost = 0.0f;
+    bool any = false;
+    for (uint8_t s = ADR_MIN_SF; s <= ADR_MAX_SF; s++) {
+        // Going faster than now needs the extra hysteresis margin
+        float margin = ADR_MARGIN_DB + (s < sf ? ADR_HYSTERESIS_DB : 0.0f);
+        float needed = ADR_MIN_TX_POWER_DBM;
+        uint8_t reached = 0;
+        for (uint8_t i = 0; i < ADR_MAX_NEIGHBOURS; i++) {
+            const Neighbour& n = neighbours[i];
+            if (!n.used || n.samples < ADR_MIN_SAMPLES || now - n.lastHeard > HEARTBEAT_TIMEOUT_MS) {
+                continue;
+            }
+            any = true;
+            float link = loraSnrFloorDb(s) + margin - linkSnr(n);
+            if (link <= maxPowerDbm) {
+                reached++;
+                if (link > needed) needed = link;
+            }
+        }
+        if (reached == 0) {
+            continue;
+        }
+        // Transmit energy per neighbour reached. The whole swarm moves to
+        // the SF and pays its airtime, so a slower one has to win clearly
+        float cost = airtimeUs[s - ADR_MIN_SF] * loraTxCurrentMa((int8_t)ceilf(needed)) / reached;
+        if (!best || cost * ADR_SLOWER_SF_GAIN < bestCost) {
+            best = s;
+            bestCost = cost;
+        }
+    }
+    // Trusted links that no SF closes still want the slowest one
+    return best ? best : any ? ADR_MAX_SF : 0;
+}
+
+int8_t AdrController::powerFor(uint8_t spreadingFactor, uint32_t now) const {
+    float needed = ADR_MIN_TX_POWER_DBM;
+    bool any = false;
+    for (uint8_t i = 0; i < ADR_MAX_NEIGHBOURS; i++) {
+        const Neighbour& n = neighbours[i];
+        if (!n.used) {
+            continue;
+        }
+        if (n.samples < ADR_MIN_SAMPLES || now - n.lastHeard > HEARTBEAT_TIMEOUT_MS) {
+            // Unknown or possibly lost to the last cut: make sure it hears us
+            return maxPowerDbm;
+        }
+        float link = loraSnrFloorDb(spreadingFactor) + ADR_MARGIN_DB - linkSnr(n);
+        if (link > needed) needed = link;
+        any = true;
+    }
+    if (!any || needed >= maxPowerDbm) {
+        return maxPowerDbm;
+    }
+    return (int8_t)ceilf(needed);
+}
+
+void AdrController::computeRequirement(uint32_t now) {
+    uint8_t own = cheapestSf(now);
+    // No trusted links yet: nothing to say, hold the current SF
+    requiredSf = own ? own : sf;
+    requiredHops = 0;
+
+    for (uint8_t i = 0; i < ADR_MAX_NEIGHBOURS; i++) {
+        const Neighbour& n = neighbours[i];
+        if (!n.used || now - n.lastHeard > HEARTBEAT_TIMEOUT_MS || n.requiredHops + 1 > ADR_REQUIREMENT_HOPS) {
+            continue;
+        }
+        if (n.requiredSf > requiredSf || (n.requiredSf == requiredSf && n.requiredHops + 1 < requiredHops)) {
+            requiredSf = n.requiredSf;
+            requiredHops = n.requiredHops + 1;
+        }
+    }
+}
+
+void AdrController::propose(uint8_t target, uint32_t now) {
+    epoch++;
+    planPending = true;
+    planSf = target;
+    switchAt = now + ADR_SWITCH_LEAD_MS;
+    stats.plansProposed++;
+    DEBUG_PRINT("[ADR] Node %d proposes SF%d -> SF%d (epoch %d)\n", nodeId, sf, target, epoch);
+}
+
+void AdrController::setSf(uint8_t next, uint32_t now) {
+    lastSwitchAt = now;
+    belowCurrent = false;
+    if (next != sf) {
+        sf = next;
+        changed = true;
+        stats.sfChanges++;
+    }
+}
+
+void AdrController::setPower(int8_t next, uint32_t now) {
+    if (next < powerDbm) {
+        lastPowerCut = now;
+    }
+    if (next != powerDbm) {
+        powerDbm = next;
+        changed = true;
+        stats.powerChanges++;
+    }
+}
+
+void AdrController::onLinkState(uint8_t from, const LinkStateData& state, int16_t rssi, float snr,
+                                uint32_t now) {
+    heardAny = true;
+    lastHeardAt = now;
+    if (scanning) {
+        // Found the swarm; give the SF a full settle period before moving
+        scanning = false;
+        lastSwitchAt = now;
+        DEBUG_PRINT("[ADR] Node %d rejoined on SF%d\n", nodeId, sf);
+    }
+
+    // Strong frames: the SNR estimate saturates but RSSI keeps tracking
+    float measured = snr;
+    if (snr >= LORA_SNR_SATURATION_DB && rssi - noiseFloorDbm > snr) {
+        measured = rssi - noiseFloorDbm;
+    }
+    float normalised = measured - state.txPowerDbm;
+
+    Neighbour* n = find(from, now);
+    if (n->samples == 0) {
+        n->snrEwma = normalised;
+        n->snrDeviation = 0.0f;
+    } else {
+        float error = normalised - n->snrEwma;
+        n->snrEwma += ADR_SNR_ALPHA * error;
+        n->snrDeviation += ADR_SNR_ALPHA * (fabsf(error) - n->snrDeviation);
+    }
+    if (n->samples < 255) n->samples++;
+    n->requiredSf = state.requiredSf;
+    n->requiredHops = state.requiredHops;
+    n->lastHeard = now;
+
+    uint8_t proposed = state.planSf;
+    if (proposed < ADR_MIN_SF) proposed = ADR_MIN_SF;
+    if (proposed > ADR_MAX_SF) proposed = ADR_MAX_SF;
+    if (epochNewer(state.planEpoch, epoch)) {
+        epoch = state.planEpoch;
+        // A plan already carried out: we hear the sender, so we are on its SF
+        planPending = state.planInMs > 0;
+        if (planPending) {
+            planSf = proposed;
+            switchAt = now + state.planInMs;
+            stats.plansAdopted++;
+        }
+    } else if (state.planEpoch == epoch && planPending && state.planInMs > 0) {
+        // Concurrent proposals for the same epoch: slower SF, earlier switch
+        if (proposed > planSf) planSf = proposed;
+        if ((int32_t)(now + state.planInMs - switchAt) < 0) switchAt = now + state.planInMs;
+    }
+}
+
+bool AdrController::update(uint32_t now) {
+    changed = false;
+
+    for (uint8_t i = 0; i < ADR_MAX_NEIGHBOURS; i++) {
+        if (neighbours[i].used && now - neighbours[i].lastHeard > ADR_NEIGHBOUR_FORGET_MS) {
+            neighbours[i].used = false;
+        }
+    }
+
+    if (planPending && (int32_t)(now - switchAt) >= 0) {
+        planPending = false;
+        setSf(planSf, now);
+        DEBUG_PRINT("[ADR] Node %d switched to SF%d\n", nodeId, sf);
+    }
+
+    if (heardAny && now - lastHeardAt >= ADR_SILENCE_MS) {
+        // Probably missed a switch: try each SF in turn at full power
+        if (!scanning) {
+            scanning = true;
+            planPending = false;
+            scanStepAt = now - ADR_SCAN_DWELL_MS;
+            stats.scans++;
+        }
+        if (now - scanStepAt >= ADR_SCAN_DWELL_MS) {
+            scanStepAt = now;
+            setSf(sf >= ADR_MAX_SF ? ADR_MIN_SF : sf + 1, now);
+        }
+        setPower(maxPowerDbm, now);
+        return changed;
+    }
+
+    computeRequirement(now);
+    if (!planPending) {
+        if (requiredSf > sf) {
+            propose(requiredSf, now);
+        } else if (requiredSf < sf) {
+            if (!belowCurrent) {
+                belowCurrent = true;
+                belowSince = now;
+            } else if (now - belowSince >= ADR_SETTLE_MS && now - lastSwitchAt >= ADR_SETTLE_MS) {
+                // One step at a time; the next one waits for fresh measurements
+                propose(sf - 1, now);
+            }
+        } else {
+            belowCurrent = false;
+        }
+    }
+
+    // While a change is pending, cover whichever of the two SFs is faster
+    uint8_t fastest = planPending && planSf < sf ? planSf : sf;
+    int8_t target = powerFor(fastest, now);
+    if (target > powerDbm) {
+        setPower(target, now);
+    } else if (target < powerDbm && now - lastPowerCut >= HEARTBEAT_INTERVAL_MS) {
+        setPower(target < powerDbm - ADR_POWER_STEP_DB ? powerDbm - ADR_POWER_STEP_DB : target, now);
+    }
+    return changed;
+}
+
+void AdrController::fillLinkState(LinkStateData& out, uint32_t now) const {
+    out.txPowerDbm = powerDbm;
+    out.requiredSf = requiredSf;
+    out.requiredHops = requiredHops;
+    out.planEpoch = epoch;
+    out.planSf = planPending ? planSf : sf;
+    uint32_t remaining = planPending && (int32_t)(switchAt - now) > 0 ? switchAt - now : 0;
+    out.planInMs = planPending ? (uint16_t)(remaining > 0xFFFF ? 0xFFFF : (remaining ? remaining : 1)) : 0;
+    out.wakeInMs = 0;           // Stamped on air by DutyCycle when it runs
+}
+
+void AdrController::resume(uint8_t spreadingFactor, uint8_t planEpoch, uint32_t now) {
+    if (spreadingFactor < ADR_MIN_SF || spreadingFactor > ADR_MAX_SF) {
+        return;
+    }
+    setSf(spreadingFactor, now);
+    requiredSf = spreadingFactor;
+    epoch = planEpoch;
+    planPending = false;
+    heardAny = true;
+    lastHeardAt = now;
+    DEBUG_PRINT("[ADR] Node %d resumed on SF%d, epoch %d\n", nodeId, sf, epoch);
+}
+
+void AdrController::setMaxTxPower(int8_t dbm, uint32_t now) {
+    maxPowerDbm = dbm < ADR_MIN_TX_POWER_DBM ? ADR_MIN_TX_POWER_DBM
+                                             : dbm > ADR_MAX_TX_POWER_DBM ? ADR_MAX_TX_POWER_DBM : dbm;
+    if (powerDbm > maxPowerDbm) {
+        setPower(maxPowerDbm, now);
+    }
+}
+
+uint8_t AdrController::neighbourCount(uint32_t now) const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < ADR_MAX_NEIGHBOURS; i++) {
+        if (neighbours[i].used && now - neighbours[i].lastHeard <= HEARTBEAT_TIMEOUT_MS) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void AdrController::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+#define MAC_RATE_TOKENS (MAX_MESSAGE_RATE_PER_SEC * 1000UL)
+#define MAC_AIRTIME_TOKENS_US ((uint32_t)MAC_DUTY_WINDOW_MS * 10UL * MAX_BANDWIDTH_USAGE_PERCENT)
+
+ChannelAccess::ChannelAccess(uint8_t nodeId)
+    : nodeId(nodeId), state(IDLE), attempts(0), deferred(0), requestedAt(0), readyAt(0), slotMs(1),
+      frameAirtimeUs(0), rngState(1), rateTokens(MAC_RATE_TOKENS), airtimeTokensUs(MAC_AIRTIME_TOKENS_US),
+      lastRefill(0), windowStart(0), windowBusyUs(0), windowOwnUs(0), utilization(0.0f), ownUtilization(0.0f) {
+    seed(nodeId);
+    setPhy(loraDefaultPhy());
+    resetStats();
+}
+
+void ChannelAccess::seed(uint32_t value) {
+    // Same finaliser as EmergencyStopHandler::seed(): neighbouring ids must
+    // not draw correlated jitter
+    value ^= value >> 16;
+    value *= 0x85EBCA6Bu;
+    value ^= value >> 13;
+    value *= 0xC2B2AE35u;
+    value ^= value >> 16;
+    rngState = value ? value : 1;
+}
+
+uint32_t ChannelAccess::nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState >> 8;
+}
+
+void ChannelAccess::setPhy(const LoRaPhyConfig& phy) {
+    // The SX127x CAD takes about two symbols
+    slotMs = (uint16_t)((2 * loraSymbolTimeUs(phy) + MAC_TURNAROUND_US + 999) / 1000);
+    frameAirtimeUs = loraAirtimeUs(phy, sizeof(SecureFrame));
+}
+
+void ChannelAccess::refill(uint32_t now) {
+    uint32_t elapsed = now - lastRefill;
+    lastRefill = now;
+    if (elapsed > MAC_DUTY_WINDOW_MS) {
+        elapsed = MAC_DUTY_WINDOW_MS;     // Both buckets are full by then
+    }
+    rateTokens += elapsed * MAX_MESSAGE_RATE_PER_SEC;
+    if (rateTokens > MAC_RATE_TOKENS) rateTokens = MAC_RATE_TOKENS;
+    airtimeTokensUs += elapsed * 10UL * MAX_BANDWIDTH_USAGE_PERCENT;
+    if (airtimeTokensUs > MAC_AIRTIME_TOKENS_US) airtimeTokensUs = MAC_AIRTIME_TOKENS_US;
+    rollWindow(now);
+}
+
+void ChannelAccess::rollWindow(uint32_t now) {
+    if (now - windowStart < MAC_UTILIZATION_WINDOW_MS) {
+        return;
+    }
+    utilization = windowBusyUs / (MAC_UTILIZATION_WINDOW_MS * 10.0f);
+    ownUtilization = windowOwnUs / (MAC_UTILIZATION_WINDOW_MS * 10.0f);
+    windowBusyUs = 0;
+    windowOwnUs = 0;
+    windowStart += MAC_UTILIZATION_WINDOW_MS;
+    if (now - windowStart >= MAC_UTILIZATION_WINDOW_MS) {
+        // Nobody reported anything for a whole window
+        utilization = 0.0f;
+        ownUtilization = 0.0f;
+        windowStart = now;
+    }
+}
+
+void ChannelAccess::addBusy(uint32_t airtimeUs, bool own, uint32_t now) {
+    rollWindow(now);
+    windowBusyUs += airtimeUs;
+    if (own) {
+        windowOwnUs += airtimeUs;
+    }
+}
+
+bool ChannelAccess::request(uint32_t now) {
+    if (state != IDLE) {
+        return false;
+    }
+    stats.requested++;
+    state = WAITING;
+    attempts = 0;
+    deferred = 0;
+    requestedAt = now;
+    readyAt = now + (nextRandom() % MAC_JITTER_SLOTS) * slotMs;
+    return true;
+}
+
+MacAction ChannelAccess::poll(uint32_t now) {
+    refill(now);
+    switch (state) {
+        case IDLE:
+            return MAC_IDLE;
+        case SENSING:
+            return MAC_WAIT;
+        case CLEAR:
+            return MAC_TRANSMIT;
+        case WAITING:
+            break;
+    }
+    if ((int32_t)(now - readyAt) < 0) {
+        return MAC_WAIT;
+    }
+
+    if (rateTokens < 1000) {
+        readyAt = now + (1000 - rateTokens + MAX_MESSAGE_RATE_PER_SEC - 1) / MAX_MESSAGE_RATE_PER_SEC;
+        if (!(deferred & 1)) stats.rateDeferrals++;
+        deferred |= 1;
+        return MAC_WAIT;
+    }
+    if (airtimeTokensUs < frameAirtimeUs) {
+        uint32_t perMs = 10UL * MAX_BANDWIDTH_USAGE_PERCENT;
+        readyAt = now + (frameAirtimeUs - airtimeTokensUs + perMs - 1) / perMs;
+        if (!(deferred & 2)) stats.dutyDeferrals++;
+        deferred |= 2;
+        return MAC_WAIT;
+    }
+
+    state = SENSING;
+    return MAC_SENSE;
+}
+
+MacAction ChannelAccess::onChannelSensed(bool busy, uint32_t now) {
+    if (state != SENSING) {
+        return poll(now);
+    }
+    stats.channelChecks++;
+    if (!busy) {
+        state = CLEAR;
+        return MAC_TRANSMIT;
+    }
+
+    stats.channelBusy++;
+    if (++attempts >= MAC_MAX_ATTEMPTS) {
+        stats.dropped++;
+        state = IDLE;
+        DEBUG_PRINT("[MAC] Node %d dropped a frame: channel busy %d times\n", nodeId, attempts);
+        return MAC_IDLE;
+    }
+    uint8_t exponent = MAC_MIN_BACKOFF_EXPONENT + attempts - 1;
+    if (exponent > MAC_MAX_BACKOFF_EXPONENT) exponent = MAC_MAX_BACKOFF_EXPONENT;
+    readyAt = now + (1 + nextRandom() % (1UL << exponent)) * slotMs;
+    state = WAITING;
+    return MAC_WAIT;
+}
+
+void ChannelAccess::onTransmitted(uint32_t airtimeUs, uint32_t now) {
+    refill(now);
+    rateTokens -= rateTokens < 1000 ? rateTokens : 1000;
+    airtimeTokensUs -= airtimeTokensUs < airtimeUs ? airtimeTokensUs : airtimeUs;
+    addBusy(airtimeUs, true, now);
+    if (state != IDLE) {
+        uint32_t delay = now - requestedAt;
+        stats.sent++;
+        stats.totalAccessDelayMs += delay;
+        if (delay > stats.maxAccessDelayMs) stats.maxAccessDelayMs = delay;
+        state = IDLE;
+    }
+}
+
+void ChannelAccess::onFrameHeard(uint32_t airtimeUs, uint32_t now) {
+    addBusy(airtimeUs, false, now);
+}
+
+uint32_t ChannelAccess::nextActionIn(uint32_t now) const {
+    switch (state) {
+        case IDLE:
+        case SENSING:
+            return UINT32_MAX;
+        case CLEAR:
+            return 0;
+        case WAITING:
+            break;
+    }
+    return (int32_t)(readyAt - now) > 0 ? readyAt - now : 0;
+}
+
+void ChannelAccess::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
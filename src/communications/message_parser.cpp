@@ -0,0 +1,331 @@
+#include "../../include/communications/message_parser.h"
+
+bool BatchReader::next(DroneMessage& out) {
+    uint8_t type;
+    const uint8_t* payload;
+    uint8_t length;
+    if (!next(type, payload, length)) {
+        return false;
+    }
+
+    out.messageType = type;
+    out.sourceId = frame.sourceId;
+    out.destinationId = frame.destinationId;
+    out.timestamp = frame.timestamp;
+    out.sequenceNumber = frame.sequenceNumber;
+    out.dataLength = length;
+    memcpy(out.data, payload, length);
+    memset(out.data + length, 0, sizeof(out.data) - length);
+    out.checksum = droneMessageChecksum(out);
+    return true;
+}
+
+uint8_t splitBatch(const DroneMessage& frame, DroneMessage* out, uint8_t maxMessages) {
+    if (maxMessages == 0) {
+        return 0;
+    }
+    if (frame.messageType != MSG_BATCH) {
+        out[0] = frame;
+        return 1;
+    }
+
+    BatchReader reader(frame);
+    uint8_t count = 0;
+    while (count < maxMessages && reader.next(out[count])) {
+        count++;
+    }
+    if (reader.malformed()) {
+        DEBUG_PRINT("[BATCH] Malformed batch from %d after %d record(s)\n", frame.sourceId, count);
+    }
+    return count;
+}
+
+// ===== Forward error correction =====
+
+static_assert(FEC_MAX_DATA_FRAMES <= 16 && FEC_MAX_PARITY_FRAMES <= 8, "Received-symbol masks are 16 and 8 bits");
+static_assert(FEC_MAX_DATA_FRAMES + FEC_MAX_PARITY_FRAMES <= 255, "Cauchy points must be distinct field elements");
+
+#if !defined(ARDUINO) && defined(__GNUC__)
+#define FEC_USE_VECTOR_EXT 1
+typedef uint8_t v16u8 __attribute__((vector_size(16)));
+#endif
+
+struct GfTables {
+    uint8_t exp[512];           // Doubled so exp[log a + log b] needs no modulo
+    uint8_t log[256];
+
+    GfTables() {
+        uint16_t x = 1;
+        for (uint16_t i = 0; i < 255; i++) {
+            exp[i] = exp[i + 255] = (uint8_t)x;
+            log[x] = (uint8_t)i;
+            x <<= 1;
+            if (x & 0x100) {
+                x ^= 0x11D;
+            }
+        }
+        exp[510] = exp[511] = exp[0];
+        log[0] = 0;                 // Never used: zero is special-cased
+    }
+};
+
+static const GfTables gf;
+
+uint8_t fecMul(uint8_t a, uint8_t b) {
+    return a && b ? gf.exp[gf.log[a] + gf.log[b]] : 0;
+}
+
+uint8_t fecInverse(uint8_t a) {
+    return gf.exp[255 - gf.log[a]];
+}
+
+uint8_t fecParityCoefficient(uint8_t row, uint8_t column) {
+    // Cauchy entry 1 / (x_row + y_column) with x = FEC_MAX_DATA_FRAMES + row
+    // and y = column, each column scaled so row 0 is all ones. Scaling
+    // columns keeps every square submatrix invertible, so the code stays MDS.
+    uint8_t y = column;
+    uint8_t x0 = FEC_MAX_DATA_FRAMES;
+    uint8_t x = (uint8_t)(FEC_MAX_DATA_FRAMES + row);
+    return fecMul(fecInverse((uint8_t)(x ^ y)), (uint8_t)(x0 ^ y));
+}
+
+void fecMulAddScalar(uint8_t* dst, const uint8_t* src, uint8_t coefficient, uint16_t length) {
+    if (coefficient == 0) {
+        return;
+    }
+    uint16_t logC = gf.log[coefficient];
+    for (uint16_t i = 0; i < length; i++) {
+        if (src[i]) {
+            dst[i] ^= gf.exp[logC + gf.log[src[i]]];
+        }
+    }
+}
+
+void fecMulAdd(uint8_t* dst, const uint8_t* src, uint8_t coefficient, uint16_t length) {
+    if (coefficient == 0) {
+        return;
+    }
+    uint16_t i = 0;
+#ifdef FEC_USE_VECTOR_EXT
+    if (coefficient == 1) {
+        for (; i + 16 <= length; i += 16) {
+            v16u8 a, b;
+            memcpy(&a, dst + i, 16);
+            memcpy(&b, src + i, 16);
+            a ^= b;
+            memcpy(dst + i, &a, 16);
+        }
+    } else {
+        // Bit-sliced: c * x is the XOR of c * 2^b over the set bits b of x.
+        // No table lookups, so all 16 lanes go at once.
+        v16u8 partial[8], bits[8];
+        for (uint8_t b = 0; b < 8; b++) {
+            partial[b] = (v16u8){} + fecMul(coefficient, (uint8_t)(1 << b));
+            bits[b] = (v16u8){} + (uint8_t)(1 << b);
+        }
+        for (; i + 16 <= length; i += 16) {
+            v16u8 x, acc;
+            memcpy(&x, src + i, 16);
+            memcpy(&acc, dst + i, 16);
+            for (uint8_t b = 0; b < 8; b++) {
+                acc ^= (v16u8)((x & bits[b]) == bits[b]) & partial[b];
+            }
+            memcpy(dst + i, &acc, 16);
+        }
+    }
+#endif
+    fecMulAddScalar(dst + i, src + i, coefficient, length - i);
+}
+
+static void fecScale(uint8_t* symbol, uint8_t coefficient) {
+    uint8_t scaled[FEC_SYMBOL_BYTES] = {0};
+    fecMulAdd(scaled, symbol, coefficient, FEC_SYMBOL_BYTES);
+    memcpy(symbol, scaled, FEC_SYMBOL_BYTES);
+}
+
+FecDecoder::FecDecoder() {
+    memset(groups, 0, sizeof(groups));
+    resetStats();
+}
+
+FecDecoder::Group* FecDecoder::findGroup(uint8_t sourceId, uint8_t group, uint32_t timestamp) {
+    for (uint8_t i = 0; i < FEC_DECODE_GROUPS; i++) {
+        Group& g = groups[i];
+        if (g.used && g.sourceId == sourceId && g.group == group && g.timestamp == timestamp) {
+            return &g;
+        }
+    }
+    return nullptr;
+}
+
+FecRxResult FecDecoder::add(const DroneMessage& frame, uint32_t now, FecMessage& out) {
+    if (frame.messageType != MSG_FEC) {
+        return FEC_IGNORED;
+    }
+    FecHeader header;
+    memcpy(&header, frame.data, sizeof(header));
+    if (frame.dataLength != sizeof(FecHeader) + FEC_SYMBOL_BYTES || header.dataFrames == 0 ||
+        header.dataFrames > FEC_MAX_DATA_FRAMES || header.index >= header.dataFrames + FEC_MAX_PARITY_FRAMES ||
+        header.length == 0 || (header.length + FEC_SYMBOL_BYTES - 1) / FEC_SYMBOL_BYTES != header.dataFrames ||
+        header.type == MSG_FEC || header.type == MSG_BATCH || header.type == MSG_EMERGENCY_STOP) {
+        stats.malformed++;
+        return FEC_IGNORED;
+    }
+
+    Group* g = findGroup(frame.sourceId, header.group, frame.timestamp);
+    if (g && (g->type != header.type || g->dataFrames != header.dataFrames || g->length != header.length)) {
+        stats.malformed++;
+        return FEC_IGNORED;
+    }
+    if (!g) {
+        // A free slot, else the oldest finished group, else the oldest
+        // unfinished one: new traffic wins over a group that stalled
+        for (uint8_t i = 0; i < FEC_DECODE_GROUPS; i++) {
+            Group& c = groups[i];
+            if (!c.used) {
+                g = &c;
+                break;
+            }
+            if (!g || (c.complete && !g->complete) ||
+                (c.complete == g->complete && (int32_t)(c.firstHeardAt - g->firstHeardAt) < 0)) {
+                g = &c;
+            }
+        }
+        if (g->used && !g->complete) {
+            stats.expired++;
+            DEBUG_PRINT("[FEC] Dropped group %d from %d with %d of %d frames\n", g->group, g->sourceId,
+                        __builtin_popcount(g->haveData) + __builtin_popcount(g->haveParity), g->dataFrames);
+        }
+        g->used = true;
+        g->complete = false;
+        g->sourceId = frame.sourceId;
+        g->group = header.group;
+        g->timestamp = frame.timestamp;
+        g->type = header.type;
+        g->dataFrames = header.dataFrames;
+        g->length = header.length;
+        g->firstHeardAt = now;
+        g->haveData = 0;
+        g->haveParity = 0;
+    }
+
+    bool parity = header.index >= header.dataFrames;
+    uint32_t bit = 1UL << (parity ? header.index - header.dataFrames : header.index);
+    if (g->complete || (parity ? g->haveParity & bit : g->haveData & bit)) {
+        stats.redundant++;
+        return FEC_REDUNDANT;
+    }
+    stats.frames++;
+    const uint8_t* symbol = frame.data + sizeof(FecHeader);
+    if (parity) {
+        memcpy(g->parity[header.index - header.dataFrames], symbol, FEC_SYMBOL_BYTES);
+        g->haveParity |= bit;
+    } else {
+        memcpy(g->symbols[header.index], symbol, FEC_SYMBOL_BYTES);
+        g->haveData |= bit;
+    }
+    if (__builtin_popcount(g->haveData) + __builtin_popcount(g->haveParity) < g->dataFrames) {
+        return FEC_PENDING;
+    }
+
+    rebuild(*g);
+    g->complete = true;
+    stats.completed++;
+    out.type = g->type;
+    out.sourceId = frame.sourceId;
+    out.destinationId = frame.destinationId;
+    out.timestamp = frame.timestamp;
+    out.length = g->length;
+    out.data = &g->symbols[0][0];
+    return FEC_COMPLETE;
+}
+
+// Solves for the missing data symbols from as many parity symbols
+void FecDecoder::rebuild(Group& g) {
+    uint8_t missing[FEC_MAX_PARITY_FRAMES], rows[FEC_MAX_PARITY_FRAMES];
+    uint8_t lost = 0;
+    for (uint8_t j = 0; j < g.dataFrames && lost < FEC_MAX_PARITY_FRAMES; j++) {
+        if (!(g.haveData & (1U << j))) {
+            missing[lost++] = j;
+        }
+    }
+    if (lost == 0) {
+        return;
+    }
+    uint8_t used = 0;
+    for (uint8_t r = 0; r < FEC_MAX_PARITY_FRAMES && used < lost; r++) {
+        if (g.haveParity & (1U << r)) {
+            rows[used++] = r;
+        }
+    }
+
+    // Take the received data out of each parity symbol; what is left is a
+    // lost x lost system in the missing symbols
+    uint8_t matrix[FEC_MAX_PARITY_FRAMES][FEC_MAX_PARITY_FRAMES];
+    uint8_t* rhs[FEC_MAX_PARITY_FRAMES];
+    for (uint8_t i = 0; i < lost; i++) {
+        rhs[i] = g.parity[rows[i]];
+        for (uint8_t j = 0; j < g.dataFrames; j++) {
+            if (g.haveData & (1U << j)) {
+                fecMulAdd(rhs[i], g.symbols[j], fecParityCoefficient(rows[i], j), FEC_SYMBOL_BYTES);
+            }
+        }
+        for (uint8_t j = 0; j < lost; j++) {
+            matrix[i][j] = fecParityCoefficient(rows[i], missing[j]);
+        }
+    }
+
+    // Gauss-Jordan; a Cauchy submatrix is never singular, so a pivot always exists
+    for (uint8_t c = 0; c < lost; c++) {
+        uint8_t pivot = c;
+        while (matrix[pivot][c] == 0) {
+            pivot++;
+        }
+        if (pivot != c) {
+            for (uint8_t j = 0; j < lost; j++) {
+                uint8_t t = matrix[c][j];
+                matrix[c][j] = matrix[pivot][j];
+                matrix[pivot][j] = t;
+            }
+            uint8_t* t = rhs[c];
+            rhs[c] = rhs[pivot];
+            rhs[pivot] = t;
+        }
+        uint8_t inverse = fecInverse(matrix[c][c]);
+        for (uint8_t j = 0; j < lost; j++) {
+            matrix[c][j] = fecMul(matrix[c][j], inverse);
+        }
+        fecScale(rhs[c], inverse);
+        for (uint8_t r = 0; r < lost; r++) {
+            uint8_t factor = matrix[r][c];
+            if (r == c || factor == 0) {
+                continue;
+            }
+            for (uint8_t j = 0; j < lost; j++) {
+                matrix[r][j] ^= fecMul(factor, matrix[c][j]);
+            }
+            fecMulAdd(rhs[r], rhs[c], factor, FEC_SYMBOL_BYTES);
+        }
+    }
+    for (uint8_t i = 0; i < lost; i++) {
+        memcpy(g.symbols[missing[i]], rhs[i], FEC_SYMBOL_BYTES);
+        g.haveData |= 1U << missing[i];
+    }
+    stats.recovered += lost;
+}
+
+void FecDecoder::expire(uint32_t now) {
+    for (uint8_t i = 0; i < FEC_DECODE_GROUPS; i++) {
+        Group& g = groups[i];
+        if (g.used && now - g.firstHeardAt >= FEC_GROUP_TIMEOUT_MS) {
+            if (!g.complete) {
+                stats.expired++;
+            }
+            g.used = false;
+        }
+    }
+}
+
+void FecDecoder::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
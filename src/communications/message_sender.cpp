@@ -0,0 +1,196 @@
+#include "../../include/communications/message_sender.h"
+
+#define BATCH_CAPACITY ((int)sizeof(((DroneMessage*)0)->data))
+
+MessageSender::MessageSender(uint8_t nodeId, uint32_t maxDelayMs) : nodeId(nodeId), maxDelayMs(maxDelayMs), fecGroup(0) {
+    memset(batches, 0, sizeof(batches));
+    resetStats();
+}
+
+MessageSender::Batch* MessageSender::openBatch(uint8_t destination) {
+    for (uint8_t i = 0; i < BATCH_SLOTS; i++) {
+        if (batches[i].used && !batches[i].closed && batches[i].destination == destination) {
+            return &batches[i];
+        }
+    }
+    return nullptr;
+}
+
+MessageSender::Batch* MessageSender::freeBatch() {
+    for (uint8_t i = 0; i < BATCH_SLOTS; i++) {
+        if (!batches[i].used) {
+            return &batches[i];
+        }
+    }
+    return nullptr;
+}
+
+bool MessageSender::queue(uint8_t destination, uint8_t type, const void* payload, uint8_t length, uint32_t now) {
+    if (type == MSG_EMERGENCY_STOP || type == MSG_BATCH || length > BATCH_CAPACITY - BATCH_RECORD_HEADER) {
+        stats.rejected++;
+        return false;
+    }
+
+    Batch* batch = openBatch(destination);
+    if (batch && batch->length + BATCH_RECORD_HEADER + length > BATCH_CAPACITY) {
+        // Seal it; it goes out on the next poll and this message starts a new one
+        batch->closed = true;
+        batch = nullptr;
+    }
+    if (!batch) {
+        batch = freeBatch();
+        if (!batch) {
+            stats.rejected++;
+            return false;
+        }
+        batch->used = true;
+        batch->closed = false;
+        batch->destination = destination;
+        batch->records = 0;
+        batch->length = 0;
+        batch->firstQueuedAt = now;
+        batch->offsetSumMs = 0;
+    }
+
+    batch->data[batch->length] = type;
+    batch->data[batch->length + 1] = length;
+    if (length > 0) {
+        memcpy(&batch->data[batch->length + BATCH_RECORD_HEADER], payload, length);
+    }
+    batch->length += BATCH_RECORD_HEADER + length;
+    batch->records++;
+    batch->offsetSumMs += now - batch->firstQueuedAt;
+    if (batch->length > BATCH_CAPACITY - BATCH_RECORD_HEADER) {
+        batch->closed = true;       // Not even an empty record fits
+    }
+    stats.queued++;
+    return true;
+}
+
+void MessageSender::build(Batch& batch, uint32_t now, DroneMessage& out) {
+    memset(&out, 0, sizeof(out));
+    out.sourceId = nodeId;
+    out.destinationId = batch.destination;
+    // Receivers measuring latency from the timestamp see the batching delay too
+    out.timestamp = batch.firstQueuedAt;
+    if (batch.records == 1) {
+        out.messageType = batch.data[0];
+        out.dataLength = batch.data[1];
+        memcpy(out.data, &batch.data[BATCH_RECORD_HEADER], out.dataLength);
+    } else {
+        out.messageType = MSG_BATCH;
+        out.dataLength = batch.length;
+        memcpy(out.data, batch.data, batch.length);
+        stats.batchFrames++;
+    }
+    // Sequence number and checksum are stamped when the frame is sealed
+
+    uint32_t oldest = now - batch.firstQueuedAt;
+    stats.totalDelayMs += batch.records * oldest - batch.offsetSumMs;
+    if (oldest > stats.maxDelayMs) {
+        stats.maxDelayMs = oldest;
+    }
+    stats.frames++;
+    batch.used = false;
+}
+
+uint8_t MessageSender::poll(uint32_t now, DroneMessage* out, uint8_t maxFrames) {
+    uint8_t count = 0;
+    while (count < maxFrames) {
+        Batch* due = nullptr;
+        for (uint8_t i = 0; i < BATCH_SLOTS; i++) {
+            Batch& b = batches[i];
+            if (!b.used || (!b.closed && now - b.firstQueuedAt < maxDelayMs)) {
+                continue;
+            }
+            if (!due || (int32_t)(b.firstQueuedAt - due->firstQueuedAt) < 0) {
+                due = &b;
+            }
+        }
+        if (!due) {
+            break;
+        }
+        build(*due, now, out[count++]);
+    }
+    return count;
+}
+
+uint8_t MessageSender::flush(uint32_t now, DroneMessage* out, uint8_t maxFrames) {
+    for (uint8_t i = 0; i < BATCH_SLOTS; i++) {
+        batches[i].closed = batches[i].used;
+    }
+    return poll(now, out, maxFrames);
+}
+
+uint8_t MessageSender::encodeFec(uint8_t destination, uint8_t type, const void* payload, uint16_t length,
+                                 uint8_t parityFrames, uint32_t now, DroneMessage* out, uint8_t maxFrames) {
+    uint8_t dataFrames = (uint8_t)((length + FEC_SYMBOL_BYTES - 1) / FEC_SYMBOL_BYTES);
+    if (length == 0 || length > FEC_MAX_MESSAGE || parityFrames > FEC_MAX_PARITY_FRAMES ||
+        dataFrames + parityFrames > maxFrames || type == MSG_EMERGENCY_STOP || type == MSG_BATCH || type == MSG_FEC) {
+        stats.rejected++;
+        return 0;
+    }
+
+    FecHeader header;
+    header.type = type;
+    header.group = fecGroup++;
+    header.dataFrames = dataFrames;
+    header.length = length;
+    const uint8_t* bytes = (const uint8_t*)payload;
+    uint8_t frames = dataFrames + parityFrames;
+    for (uint8_t i = 0; i < frames; i++) {
+        DroneMessage& frame = out[i];
+        memset(&frame, 0, sizeof(frame));
+        frame.messageType = MSG_FEC;
+        frame.sourceId = nodeId;
+        frame.destinationId = destination;
+        frame.timestamp = now;
+        frame.dataLength = sizeof(FecHeader) + FEC_SYMBOL_BYTES;
+        header.index = i;
+        memcpy(frame.data, &header, sizeof(header));
+
+        uint8_t* symbol = frame.data + sizeof(FecHeader);
+        if (i < dataFrames) {
+            uint16_t offset = i * FEC_SYMBOL_BYTES;
+            uint16_t take = length - offset < FEC_SYMBOL_BYTES ? length - offset : FEC_SYMBOL_BYTES;
+            memcpy(symbol, bytes + offset, take);     // The rest stays zero
+        } else {
+            for (uint8_t j = 0; j < dataFrames; j++) {
+                fecMulAdd(symbol, out[j].data + sizeof(FecHeader), fecParityCoefficient(i - dataFrames, j),
+                          FEC_SYMBOL_BYTES);
+            }
+        }
+    }
+    stats.frames += frames;
+    stats.fecGroups++;
+    stats.fecParityFrames += parityFrames;
+    return frames;
+}
+
+uint32_t MessageSender::nextDueIn(uint32_t now) const {
+    uint32_t soonest = UINT32_MAX;
+    for (uint8_t i = 0; i < BATCH_SLOTS; i++) {
+        const Batch& b = batches[i];
+        if (!b.used) {
+            continue;
+        }
+        uint32_t waited = now - b.firstQueuedAt;
+        uint32_t wait = b.closed || waited >= maxDelayMs ? 0 : maxDelayMs - waited;
+        if (wait < soonest) {
+            soonest = wait;
+        }
+    }
+    return soonest;
+}
+
+uint8_t MessageSender::pending() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < BATCH_SLOTS; i++) {
+        count += batches[i].used ? batches[i].records : 0;
+    }
+    return count;
+}
+
+void MessageSender::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
@@ -0,0 +1,707 @@
+#include "../../include/communications/ota_service.h"
+#include "../../include/utilities/varint.h"
+
+#ifdef ARDUINO
+#include <Preferences.h>
+#else
+#include <unordered_map>
+#endif
+
+#define NO_SOURCE 0xFF
+#define OTA_IO_BYTES 256
+
+enum ApplyPhase : uint8_t { APPLY_NONE = 0, APPLY_BASE, APPLY_OPS };
+
+static_assert(sizeof(OtaAdvert) <= sizeof(((DroneMessage*)0)->data) &&
+              sizeof(OtaRequest) <= sizeof(((DroneMessage*)0)->data), "OTA control frames must fit one frame");
+
+// Serial number arithmetic, so versions may wrap
+static inline bool newer(uint16_t a, uint16_t b) {
+    return (int16_t)(a - b) > 0;
+}
+
+OtaService::OtaService(uint8_t nodeId)
+    : nodeId(nodeId), rngState(1), staging(nullptr), base(nullptr), target(nullptr), state(OTA_IDLE),
+      failure(OTA_FAIL_NONE), version(0), deltaLength(0), pageCount(0), pagesComplete(0), pageHave(0),
+      erasedBytes(0), interval(OTA_TRICKLE_MIN_MS), intervalStart(0), advertAt(0), consistent(0),
+      advertDone(true), sourceId(NO_SOURCE), sourcePages(0), requestAt(0), unanswered(0), servePage(0),
+      serveMissing(0), applyPhase(APPLY_NONE), applyOffset(0), baseCursor(0), written(0), targetErased(0),
+      opRemaining(0), copyFrom(0), opCopy(false) {
+    memset(&manifest, 0, sizeof(manifest));
+    seed(nodeId);
+    resetStats();
+}
+
+void OtaService::seed(uint32_t value) {
+    value ^= value >> 16;
+    value *= 0x85EBCA6Bu;
+    value ^= value >> 13;
+    value *= 0xC2B2AE35u;
+    value ^= value >> 16;
+    rngState = value ? value : 1;
+}
+
+uint32_t OtaService::nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState >> 8;
+}
+
+uint32_t OtaService::randomBelow(uint32_t bound) {
+    return bound ? nextRandom() % bound : 0;
+}
+
+void OtaService::begin(FlightFlash* stagingFlash, FlightFlash* baseFlash, FlightFlash* targetFlash, uint32_t now) {
+    staging = stagingFlash;
+    base = baseFlash;
+    target = targetFlash;
+    interval = OTA_TRICKLE_MIN_MS;
+    startInterval(now);
+}
+
+uint8_t OtaService::chunksIn(uint16_t pageIndex) const {
+    uint32_t chunks = (deltaLength + OTA_CHUNK_BYTES - 1) / OTA_CHUNK_BYTES;
+    uint32_t first = (uint32_t)pageIndex * OTA_PAGE_CHUNKS;
+    if (first >= chunks) {
+        return 0;
+    }
+    return chunks - first < OTA_PAGE_CHUNKS ? (uint8_t)(chunks - first) : OTA_PAGE_CHUNKS;
+}
+
+uint32_t OtaService::fullMask(uint16_t pageIndex) const {
+    uint8_t chunks = chunksIn(pageIndex);
+    return chunks >= 32 ? 0xFFFFFFFFu : (1u << chunks) - 1;
+}
+
+// ===== Trickle =====
+
+void OtaService::startInterval(uint32_t now) {
+    intervalStart = now;
+    advertAt = now + interval / 2 + randomBelow(interval / 2);
+    consistent = 0;
+    advertDone = false;
+}
+
+// Something changed or disagrees: tell the neighbours soon
+void OtaService::resetTrickle(uint32_t now) {
+    if (interval > OTA_TRICKLE_MIN_MS) {
+        interval = OTA_TRICKLE_MIN_MS;
+        startInterval(now);
+    }
+}
+
+// ===== Receiving =====
+
+void OtaService::adopt(uint16_t newVersion, uint32_t newLength, uint32_t now) {
+    version = newVersion;
+    deltaLength = newLength;
+    uint32_t chunks = (newLength + OTA_CHUNK_BYTES - 1) / OTA_CHUNK_BYTES;
+    pageCount = (uint16_t)((chunks + OTA_PAGE_CHUNKS - 1) / OTA_PAGE_CHUNKS);
+    pagesComplete = 0;
+    pageHave = 0;
+    erasedBytes = 0;
+    state = OTA_RECEIVING;
+    failure = OTA_FAIL_NONE;
+    sourceId = NO_SOURCE;
+    sourcePages = 0;
+    unanswered = 0;
+    serveMissing = 0;
+    applyPhase = APPLY_NONE;
+    memset(&manifest, 0, sizeof(manifest));
+    if (!staging || newLength < sizeof(OtaManifest) || newLength > staging->size() ||
+        chunks > (uint32_t)UINT16_MAX + 1) {
+        // Known, so it is not adopted again on every advert, but not held
+        fail(OTA_FAIL_MANIFEST);
+    }
+    resetTrickle(now);
+}
+
+bool OtaService::storePage(uint32_t now) {
+    uint32_t offset = (uint32_t)pagesComplete * OTA_PAGE_BYTES;
+    uint32_t length = deltaLength - offset < OTA_PAGE_BYTES ? deltaLength - offset : OTA_PAGE_BYTES;
+    while (erasedBytes < offset + length) {
+        if (!staging->erase(erasedBytes)) {
+            fail(OTA_FAIL_FLASH);
+            return false;
+        }
+        erasedBytes += FLIGHT_SECTOR_BYTES;
+    }
+    if (!staging->write(offset, page, length)) {
+        fail(OTA_FAIL_FLASH);
+        return false;
+    }
+    pagesComplete++;
+    pageHave = 0;
+    stats.pagesCompleted++;
+    if (pagesComplete == 1 || pagesComplete % 16 == 0) {
+        DEBUG_PRINT("[OTA] Update %u: page %u/%u\n", version, pagesComplete, pageCount);
+    }
+    resetTrickle(now);
+    if (pagesComplete == pageCount) {
+        sourceId = NO_SOURCE;
+        startApply();
+    } else if (sourceId != NO_SOURCE && sourcePages > pagesComplete) {
+        requestAt = now + randomBelow(OTA_REQUEST_BACKOFF_MS);
+    } else {
+        sourceId = NO_SOURCE;       // Until someone advertises more
+    }
+    return true;
+}
+
+void OtaService::onAdvert(const DroneMessage& in, const OtaAdvert& advert, uint32_t now) {
+    if (advert.version == 0 && version == 0) {
+        consistent++;
+        return;
+    }
+    if (advert.version != 0 && (version == 0 || newer(advert.version, version))) {
+        adopt(advert.version, advert.deltaLength, now);
+    } else if (advert.version != version) {
+        resetTrickle(now);          // They are behind: our advert brings them up
+        return;
+    }
+
+    if (advert.pagesComplete == pagesComplete) {
+        consistent++;
+        return;
+    }
+    if (advert.pagesComplete < pagesComplete) {
+        resetTrickle(now);
+        return;
+    }
+    if (state != OTA_RECEIVING) {
+        return;
+    }
+    if (sourceId == NO_SOURCE) {
+        requestAt = now + randomBelow(OTA_REQUEST_BACKOFF_MS);
+    }
+    // A pending request keeps its time when the source changes
+    if (sourceId == NO_SOURCE || unanswered > 0 || advert.pagesComplete > sourcePages) {
+        sourceId = in.sourceId;
+        sourcePages = advert.pagesComplete;
+        unanswered = 0;
+    } else if (in.sourceId == sourceId) {
+        sourcePages = advert.pagesComplete;
+    }
+}
+
+void OtaService::onRequest(const DroneMessage& in, const OtaRequest& request, uint32_t now) {
+    if (request.version != version) {
+        return;
+    }
+    if (in.destinationId != nodeId) {
+        // Someone else is asking for our page: its answer serves us too
+        if (state == OTA_RECEIVING && request.page == pagesComplete && sourceId != NO_SOURCE) {
+            uint32_t later = now + OTA_REQUEST_TIMEOUT_MS;
+            if ((int32_t)(later - requestAt) > 0) {
+                requestAt = later;
+            }
+            stats.requestsSuppressed++;
+        }
+        return;
+    }
+    if (request.page >= pagesComplete) {
+        return;
+    }
+    if (serveMissing && servePage != request.page) {
+        stats.requestsDropped++;
+        return;
+    }
+    servePage = request.page;
+    serveMissing |= request.missing & fullMask(request.page);
+}
+
+void OtaService::onData(const DroneMessage& in, const OtaDataHeader& header, uint32_t now) {
+    if (header.version != version || version == 0) {
+        return;
+    }
+    uint16_t pageIndex = header.chunk / OTA_PAGE_CHUNKS;
+    uint8_t index = header.chunk % OTA_PAGE_CHUNKS;
+    uint32_t offset = (uint32_t)header.chunk * OTA_CHUNK_BYTES;
+    if (offset >= deltaLength) {
+        return;
+    }
+    uint32_t length = deltaLength - offset < OTA_CHUNK_BYTES ? deltaLength - offset : OTA_CHUNK_BYTES;
+    if (in.dataLength != sizeof(OtaDataHeader) + length) {
+        return;
+    }
+
+    // Another server got there first
+    if (serveMissing && pageIndex == servePage && (serveMissing & (1u << index))) {
+        serveMissing &= ~(1u << index);
+        stats.dataSkipped++;
+    }
+
+    if (state != OTA_RECEIVING || pageIndex != pagesComplete) {
+        return;
+    }
+    if (pageHave & (1u << index)) {
+        stats.chunksDuplicate++;
+        return;
+    }
+    memcpy(page + (uint32_t)index * OTA_CHUNK_BYTES, in.data + sizeof(OtaDataHeader), length);
+    pageHave |= 1u << index;
+    stats.chunksReceived++;
+    unanswered = 0;
+    requestAt = now + OTA_REQUEST_TIMEOUT_MS;      // The rest of the burst may follow
+    if (pageHave == fullMask(pageIndex)) {
+        storePage(now);
+    }
+}
+
+void OtaService::onFrame(const DroneMessage& in, uint32_t now) {
+    if (in.messageType != MSG_OTA || in.sourceId == nodeId || in.dataLength < 1 ||
+        in.dataLength > sizeof(in.data)) {
+        return;
+    }
+    switch (in.data[0]) {
+        case OTA_ADVERT:
+            if (in.dataLength == sizeof(OtaAdvert)) {
+                OtaAdvert advert;
+                memcpy(&advert, in.data, sizeof(advert));
+                onAdvert(in, advert, now);
+            }
+            break;
+        case OTA_REQUEST:
+            if (in.dataLength == sizeof(OtaRequest)) {
+                OtaRequest request;
+                memcpy(&request, in.data, sizeof(request));
+                onRequest(in, request, now);
+            }
+            break;
+        case OTA_DATA:
+            if (in.dataLength > sizeof(OtaDataHeader)) {
+                OtaDataHeader header;
+                memcpy(&header, in.data, sizeof(header));
+                onData(in, header, now);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+bool OtaService::publish(uint32_t now, uint16_t expectVersion) {
+    OtaManifest stored;
+    if (!staging || !staging->read(0, &stored, sizeof(stored)) || stored.magic != OTA_MAGIC ||
+        stored.version == 0 || (expectVersion && stored.version != expectVersion) ||
+        (stored.kind != OTA_KIND_FIRMWARE && stored.kind != OTA_KIND_CONFIG)) {
+        return false;
+    }
+    adopt(stored.version, stored.deltaLength, now);
+    if (state == OTA_FAILED) {
+        return false;
+    }
+    manifest = stored;
+    pagesComplete = pageCount;
+    erasedBytes = staging->size();
+    state = OTA_INSTALLED;
+    return true;
+}
+
+void OtaService::markInstalled() {
+    if (state == OTA_READY) {
+        state = OTA_INSTALLED;
+    }
+}
+
+// ===== Sending =====
+
+void OtaService::build(uint8_t destination, const void* payload, uint8_t length, uint32_t now, DroneMessage& out) {
+    memset(&out, 0, sizeof(out));
+    out.messageType = MSG_OTA;
+    out.sourceId = nodeId;
+    out.destinationId = destination;
+    out.timestamp = now;
+    // Sequence number and checksum are stamped when the frame is sealed
+    memcpy(out.data, payload, length);
+    out.dataLength = length;
+}
+
+uint8_t OtaService::poll(uint32_t now, DroneMessage* out, uint8_t maxFrames) {
+    uint8_t count = 0;
+
+    // Requested chunks first: neighbours are waiting on them
+    while (serveMissing && count < maxFrames) {
+        uint8_t index = 0;
+        while (!(serveMissing & (1u << index))) {
+            index++;
+        }
+        serveMissing &= ~(1u << index);
+        uint16_t chunk = (uint16_t)(servePage * OTA_PAGE_CHUNKS + index);
+        uint32_t offset = (uint32_t)chunk * OTA_CHUNK_BYTES;
+        uint8_t length = deltaLength - offset < OTA_CHUNK_BYTES ? (uint8_t)(deltaLength - offset) : OTA_CHUNK_BYTES;
+        uint8_t payload[sizeof(((DroneMessage*)0)->data)];
+        OtaDataHeader header = {OTA_DATA, version, chunk};
+        memcpy(payload, &header, sizeof(header));
+        if (!staging->read(offset, payload + sizeof(header), length)) {
+            continue;
+        }
+        build(0xFF, payload, sizeof(header) + length, now, out[count++]);
+        stats.dataSent++;
+    }
+
+    if (state == OTA_RECEIVING && sourceId != NO_SOURCE && (int32_t)(now - requestAt) >= 0 &&
+        count < maxFrames) {
+        if (unanswered >= OTA_MAX_REQUESTS) {
+            // Gone or out of reach: wait for the next advert with more pages
+            sourceId = NO_SOURCE;
+            resetTrickle(now);
+        } else {
+            OtaRequest request = {OTA_REQUEST, version, pagesComplete, fullMask(pagesComplete) & ~pageHave};
+            build(sourceId, &request, sizeof(request), now, out[count++]);
+            unanswered++;
+            requestAt = now + OTA_REQUEST_TIMEOUT_MS;
+            stats.requests++;
+        }
+    }
+
+    if ((int32_t)(now - intervalStart) >= (int32_t)interval) {
+        interval = interval * 2 < OTA_TRICKLE_MAX_MS ? interval * 2 : OTA_TRICKLE_MAX_MS;
+        startInterval(now);
+    }
+    if (!advertDone && (int32_t)(now - advertAt) >= 0 && count < maxFrames) {
+        advertDone = true;
+        // Serving already shows the neighbours where we are
+        if (consistent >= OTA_TRICKLE_REDUNDANCY || serveMissing) {
+            stats.advertsSuppressed++;
+        } else {
+            OtaAdvert advert = {OTA_ADVERT, version, deltaLength, pagesComplete};
+            build(0xFF, &advert, sizeof(advert), now, out[count++]);
+            stats.adverts++;
+        }
+    }
+    return count;
+}
+
+uint32_t OtaService::nextDueIn(uint32_t now) const {
+    if (serveMissing) {
+        return 0;
+    }
+    uint32_t soonest = UINT32_MAX;
+    uint32_t due[3];
+    uint8_t timers = 0;
+    if (state == OTA_RECEIVING && sourceId != NO_SOURCE) {
+        due[timers++] = requestAt;
+    }
+    if (!advertDone) {
+        due[timers++] = advertAt;
+    }
+    due[timers++] = intervalStart + interval;
+    for (uint8_t i = 0; i < timers; i++) {
+        int32_t wait = (int32_t)(due[i] - now);
+        if (wait < 0) wait = 0;
+        if ((uint32_t)wait < soonest) soonest = wait;
+    }
+    return soonest;
+}
+
+// ===== Applying =====
+
+void OtaService::fail(OtaFailure reason) {
+    state = OTA_FAILED;
+    failure = reason;
+    applyPhase = APPLY_NONE;
+    DEBUG_PRINT("[OTA] Update %u failed: %s\n", version, getFailureName(reason));
+}
+
+void OtaService::startApply() {
+    state = OTA_APPLYING;
+    if (!readDelta(0, &manifest, sizeof(manifest)) || manifest.magic != OTA_MAGIC || manifest.version != version ||
+        manifest.deltaLength != deltaLength) {
+        fail(OTA_FAIL_MANIFEST);
+        return;
+    }
+    if (manifest.kind == OTA_KIND_CONFIG) {
+        if (manifest.baseLength != 0 || manifest.targetLength > sizeof(parameters)) {
+            fail(OTA_FAIL_MANIFEST);
+            return;
+        }
+    } else if (manifest.kind == OTA_KIND_FIRMWARE) {
+        if (!base || !target) {
+            fail(OTA_FAIL_FLASH);   // A relay: it serves the update but cannot install it
+            return;
+        }
+        if (manifest.baseLength > base->size() || manifest.targetLength > target->size()) {
+            fail(OTA_FAIL_MANIFEST);
+            return;
+        }
+    } else {
+        fail(OTA_FAIL_MANIFEST);
+        return;
+    }
+    sha.begin();
+    applyPhase = APPLY_BASE;
+    applyOffset = 0;
+    baseCursor = 0;
+    written = 0;
+    targetErased = 0;
+    opRemaining = 0;
+}
+
+bool OtaService::readDelta(uint32_t offset, void* out, uint32_t length) {
+    return staging && offset + length <= deltaLength && staging->read(offset, out, length);
+}
+
+bool OtaService::readVarint(uint32_t& value) {
+    uint8_t bytes[5];
+    uint32_t available = deltaLength - applyOffset < sizeof(bytes) ? deltaLength - applyOffset : sizeof(bytes);
+    size_t used = readDelta(applyOffset, bytes, available) ? varintRead(bytes, available, value) : 0;
+    applyOffset += used;
+    return used != 0;
+}
+
+bool OtaService::emit(const uint8_t* data, uint32_t length) {
+    if (manifest.kind == OTA_KIND_CONFIG) {
+        memcpy(parameters + written, data, length);
+    } else {
+        // Erased just ahead of the writes, like the flight recorder
+        while (targetErased < written + length) {
+            if (!target->erase(targetErased)) {
+                fail(OTA_FAIL_FLASH);
+                return false;
+            }
+            targetErased += FLIGHT_SECTOR_BYTES;
+        }
+        if (!target->write(written, data, length)) {
+            fail(OTA_FAIL_FLASH);
+            return false;
+        }
+    }
+    sha.update(data, length);
+    written += length;
+    return true;
+}
+
+void OtaService::applyStep(uint32_t budget) {
+    uint8_t buffer[OTA_IO_BYTES];
+    while (budget > 0 && state == OTA_APPLYING) {
+        if (applyPhase == APPLY_BASE) {
+            if (applyOffset == manifest.baseLength) {
+                uint8_t digest[CRYPTO_SHA256_BYTES];
+                sha.finish(digest);
+                if (memcmp(digest, manifest.baseDigest, sizeof(digest)) != 0) {
+                    fail(OTA_FAIL_BASE);
+                    return;
+                }
+                sha.begin();
+                applyPhase = APPLY_OPS;
+                applyOffset = sizeof(OtaManifest);
+                continue;
+            }
+            uint32_t n = manifest.baseLength - applyOffset;
+            if (n > sizeof(buffer)) n = sizeof(buffer);
+            if (n > budget) n = budget;
+            if (!base->read(applyOffset, buffer, n)) {
+                fail(OTA_FAIL_FLASH);
+                return;
+            }
+            sha.update(buffer, n);
+            applyOffset += n;
+            budget -= n;
+            continue;
+        }
+
+        if (opRemaining == 0) {
+            if (applyOffset == deltaLength) {
+                uint8_t digest[CRYPTO_SHA256_BYTES];
+                sha.finish(digest);
+                if (written != manifest.targetLength) {
+                    fail(OTA_FAIL_DELTA);
+                } else if (memcmp(digest, manifest.targetDigest, sizeof(digest)) != 0) {
+                    fail(OTA_FAIL_DIGEST);
+                } else {
+                    state = OTA_READY;
+                    applyPhase = APPLY_NONE;
+                    DEBUG_PRINT("[OTA] Update %u verified: %lu bytes\n", version, (unsigned long)written);
+                }
+                return;
+            }
+            uint32_t op;
+            if (!readVarint(op) || (op >> 1) == 0 || (op >> 1) > manifest.targetLength - written) {
+                fail(OTA_FAIL_DELTA);
+                return;
+            }
+            opCopy = op & 1;
+            opRemaining = op >> 1;
+            if (opCopy) {
+                uint32_t encoded;
+                if (!readVarint(encoded)) {
+                    fail(OTA_FAIL_DELTA);
+                    return;
+                }
+                int64_t from = (int64_t)baseCursor + zigzagDecode(encoded);
+                if (from < 0 || from + opRemaining > manifest.baseLength) {
+                    fail(OTA_FAIL_DELTA);
+                    return;
+                }
+                copyFrom = (uint32_t)from;
+                baseCursor = copyFrom + opRemaining;
+            } else if (opRemaining > deltaLength - applyOffset) {
+                fail(OTA_FAIL_DELTA);
+                return;
+            }
+            continue;
+        }
+
+        uint32_t n = opRemaining;
+        if (n > sizeof(buffer)) n = sizeof(buffer);
+        if (n > budget) n = budget;
+        bool ok = opCopy ? base->read(copyFrom, buffer, n) : readDelta(applyOffset, buffer, n);
+        if (!ok) {
+            fail(OTA_FAIL_FLASH);
+            return;
+        }
+        if (opCopy) {
+            copyFrom += n;
+        } else {
+            applyOffset += n;
+        }
+        if (!emit(buffer, n)) {
+            return;
+        }
+        opRemaining -= n;
+        budget -= n;
+    }
+}
+
+void OtaService::service() {
+    if (state == OTA_APPLYING) {
+        applyStep(OTA_APPLY_STEP_BYTES);
+    }
+}
+
+void OtaService::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+const char* OtaService::getStateName(OtaState state) {
+    switch (state) {
+        case OTA_IDLE: return "Idle";
+        case OTA_RECEIVING: return "Receiving";
+        case OTA_APPLYING: return "Applying";
+        case OTA_READY: return "Ready";
+        case OTA_INSTALLED: return "Installed";
+        case OTA_FAILED: return "Failed";
+        default: return "Unknown";
+    }
+}
+
+const char* OtaService::getFailureName(OtaFailure failure) {
+    switch (failure) {
+        case OTA_FAIL_NONE: return "None";
+        case OTA_FAIL_MANIFEST: return "Bad manifest";
+        case OTA_FAIL_BASE: return "Base image mismatch";
+        case OTA_FAIL_DELTA: return "Bad delta";
+        case OTA_FAIL_DIGEST: return "Digest mismatch";
+        case OTA_FAIL_FLASH: return "Flash error";
+        default: return "Unknown";
+    }
+}
+
+#ifdef ARDUINO
+uint16_t loadOtaVersion() {
+    Preferences prefs;
+    if (!prefs.begin(OTA_NVS_NAMESPACE, true)) {
+        return 0;
+    }
+    uint16_t stored = prefs.getUShort("version", 0);
+    prefs.end();
+    return stored;
+}
+
+bool storeOtaVersion(uint16_t version) {
+    Preferences prefs;
+    if (!prefs.begin(OTA_NVS_NAMESPACE, false)) {
+        return false;
+    }
+    bool stored = prefs.putUShort("version", version) == sizeof(version);
+    prefs.end();
+    return stored;
+}
+#else
+#define OTA_MIN_MATCH 12            // A COPY op costs 2-6 bytes
+#define OTA_INDEX_STRIDE 4          // Base blocks indexed; matches are extended backwards
+
+static uint64_t blockKey(const uint8_t* bytes) {
+    uint64_t key;
+    memcpy(&key, bytes, sizeof(key));
+    return key;
+}
+
+static void putVarint(std::vector<uint8_t>& out, uint32_t value) {
+    uint8_t bytes[5];
+    size_t used = varintWrite(bytes, sizeof(bytes), value);
+    out.insert(out.end(), bytes, bytes + used);
+}
+
+void otaEncodeDelta(uint8_t kind, uint16_t version, const uint8_t* base, uint32_t baseLength,
+                    const uint8_t* target, uint32_t targetLength, std::vector<uint8_t>& out) {
+    OtaManifest manifest;
+    memset(&manifest, 0, sizeof(manifest));
+    manifest.magic = OTA_MAGIC;
+    manifest.kind = kind;
+    manifest.version = version;
+    manifest.baseLength = baseLength;
+    manifest.targetLength = targetLength;
+    Sha256 sha;
+    sha.update(base, baseLength);
+    sha.finish(manifest.baseDigest);
+    sha.begin();
+    sha.update(target, targetLength);
+    sha.finish(manifest.targetDigest);
+    out.assign(sizeof(manifest), 0);
+
+    std::unordered_map<uint64_t, uint32_t> index;
+    for (uint32_t p = 0; p + 8 <= baseLength; p += OTA_INDEX_STRIDE) {
+        index.emplace(blockKey(base + p), p);
+    }
+    auto matchLength = [&](uint32_t from, uint32_t at) {
+        uint32_t n = 0;
+        while (from + n < baseLength && at + n < targetLength && base[from + n] == target[at + n]) n++;
+        return n;
+    };
+    auto putInsert = [&](uint32_t from, uint32_t to) {
+        if (to > from) {
+            putVarint(out, (to - from) << 1);
+            out.insert(out.end(), target + from, target + to);
+        }
+    };
+
+    uint32_t cursor = 0, at = 0, literalStart = 0;
+    while (at < targetLength) {
+        // Same place in the base, as if the literal bytes replaced as many
+        uint32_t bestFrom = cursor + (at - literalStart);
+        uint32_t bestLength = bestFrom < baseLength ? matchLength(bestFrom, at) : 0;
+        if (bestLength < OTA_MIN_MATCH && at + 8 <= targetLength) {
+            auto found = index.find(blockKey(target + at));
+            if (found != index.end()) {
+                uint32_t n = matchLength(found->second, at);
+                if (n > bestLength) {
+                    bestFrom = found->second;
+                    bestLength = n;
+                }
+            }
+        }
+        if (bestLength < OTA_MIN_MATCH) {
+            at++;
+            continue;
+        }
+        while (at > literalStart && bestFrom > 0 && base[bestFrom - 1] == target[at - 1]) {
+            at--;
+            bestFrom--;
+            bestLength++;
+        }
+        putInsert(literalStart, at);
+        putVarint(out, bestLength << 1 | 1);
+        putVarint(out, zigzagEncode((int32_t)(bestFrom - cursor)));
+        cursor = bestFrom + bestLength;
+        at += bestLength;
+        literalStart = at;
+    }
+    putInsert(literalStart, targetLength);
+
+    manifest.deltaLength = (uint32_t)out.size();
+    memcpy(out.data(), &manifest, sizeof(manifest));
+}
+#endif
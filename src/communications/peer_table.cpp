@@ -0,0 +1,72 @@
+#include "../../include/communications/peer_table.h"
+
+PeerTable::PeerTable() : entries("peers") {
+}
+
+PeerEntry* PeerTable::findEntry(uint8_t id) {
+    for (uint8_t i = 0; i < PEER_TABLE_SIZE; i++) {
+        PeerEntry* e = entries.at(i);
+        if (e && e->id == id) {
+            return e;
+        }
+    }
+    return nullptr;
+}
+
+const PeerEntry* PeerTable::find(uint8_t id) const {
+    return const_cast<PeerTable*>(this)->findEntry(id);
+}
+
+const PeerEntry* PeerTable::update(const HeartbeatData& heartbeat, int rssi, float snr, uint32_t now) {
+    PeerEntry* slot = findEntry(heartbeat.droneId);
+    if (!slot) {
+        slot = entries.allocate();
+        if (!slot) {
+            PeerEntry* stalest = nullptr;
+            for (uint8_t i = 0; i < PEER_TABLE_SIZE; i++) {
+                PeerEntry* e = entries.at(i);
+                if (e && (!stalest || (int32_t)(e->lastSeen - stalest->lastSeen) < 0)) {
+                    stalest = e;
+                }
+            }
+            slot = stalest;
+            memset(slot, 0, sizeof(*slot));
+        }
+        slot->id = heartbeat.droneId;
+        DEBUG_PRINT("[PEERS] New neighbour %d\n", heartbeat.droneId);
+    }
+
+    slot->missionState = heartbeat.missionState;
+    slot->status = heartbeat.status;
+    slot->lastRssi = (int16_t)rssi;
+    float snrQ2 = snr * 4.0f;
+    slot->lastSnrQ2 = (int8_t)(snrQ2 > 127.0f ? 127 : (snrQ2 < -128.0f ? -128 : snrQ2));
+    slot->heartbeats++;
+    slot->lastSeen = now;
+    return slot;
+}
+
+bool PeerTable::restore(const PeerEntry& entry) {
+    if (findEntry(entry.id)) {
+        return false;
+    }
+    PeerEntry* slot = entries.allocate();
+    if (!slot) {
+        return false;
+    }
+    *slot = entry;
+    return true;
+}
+
+uint8_t PeerTable::expire(uint32_t now) {
+    uint8_t removed = 0;
+    for (uint8_t i = 0; i < PEER_TABLE_SIZE; i++) {
+        PeerEntry* e = entries.at(i);
+        if (e && now - e->lastSeen > HEARTBEAT_TIMEOUT_MS) {
+            DEBUG_PRINT("[PEERS] Neighbour %d timed out\n", e->id);
+            entries.release(e);
+            removed++;
+        }
+    }
+    return removed;
+}
@@ -0,0 +1,405 @@
+#include "../../include/communications/reliable_link.h"
+
+#define NO_PEER 0xFF
+
+ReliableLink::ReliableLink(uint8_t nodeId, uint32_t fixedRtoMs) : nodeId(nodeId), session(1), fixedRtoMs(fixedRtoMs) {
+    for (uint8_t i = 0; i < RELIABLE_MAX_PEERS; i++) {
+        peers[i].id = NO_PEER;
+    }
+    memset(slots, 0, sizeof(slots));
+    seed(nodeId);
+    resetStats();
+}
+
+void ReliableLink::seed(uint32_t value) {
+    value ^= value >> 16;
+    value *= 0x85EBCA6Bu;
+    value ^= value >> 13;
+    value *= 0xC2B2AE35u;
+    value ^= value >> 16;
+    session = (uint8_t)(value ^ (value >> 8) ^ (value >> 16) ^ (value >> 24));
+    if (session == 0) {
+        session = 1;                // 0 means "no session" in ackSession
+    }
+}
+
+void ReliableLink::resetPeer(Peer& peer, uint8_t id, uint32_t now) {
+    peer.id = id;
+    peer.lastActive = now;
+    peer.nextSeq = 0;
+    peer.base = 0;
+    peer.srttX8 = 0;
+    peer.rttvarX4 = 0;
+    peer.rtoMs = fixedRtoMs ? fixedRtoMs : ACK_TIMEOUT_MS;
+    peer.rxSession = 0;
+    peer.expected = 0;
+    peer.received = 0;
+    peer.ackPending = false;
+    peer.ackDueAt = 0;
+}
+
+ReliableLink::Peer* ReliableLink::findPeer(uint8_t id) {
+    for (uint8_t i = 0; i < RELIABLE_MAX_PEERS; i++) {
+        if (peers[i].id == id) {
+            return &peers[i];
+        }
+    }
+    return nullptr;
+}
+
+ReliableLink::Peer* ReliableLink::getPeer(uint8_t id, uint32_t now) {
+    Peer* peer = findPeer(id);
+    if (peer) {
+        return peer;
+    }
+    // A free entry, else the longest idle peer with nothing in flight
+    Peer* victim = nullptr;
+    for (uint8_t i = 0; i < RELIABLE_MAX_PEERS; i++) {
+        Peer& p = peers[i];
+        if (p.id == NO_PEER) {
+            victim = &p;
+            break;
+        }
+        if (inFlight(p) == 0 && (!victim || (int32_t)(p.lastActive - victim->lastActive) < 0)) {
+            victim = &p;
+        }
+    }
+    if (victim) {
+        resetPeer(*victim, id, now);
+    }
+    return victim;
+}
+
+uint8_t ReliableLink::inFlight(const Peer& peer) const {
+    uint8_t index = (uint8_t)(&peer - peers);
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < RELIABLE_TX_SLOTS; i++) {
+        count += slots[i].used && slots[i].peer == index;
+    }
+    return count;
+}
+
+void ReliableLink::advanceBase(Peer& peer) {
+    uint8_t index = (uint8_t)(&peer - peers);
+    peer.base = peer.nextSeq;
+    for (uint8_t i = 0; i < RELIABLE_TX_SLOTS; i++) {
+        const Slot& s = slots[i];
+        if (s.used && s.peer == index && (uint8_t)(peer.nextSeq - s.seq) > (uint8_t)(peer.nextSeq - peer.base)) {
+            peer.base = s.seq;
+        }
+    }
+}
+
+void ReliableLink::release(Slot& slot) {
+    slot.used = false;
+    advanceBase(peers[slot.peer]);
+}
+
+bool ReliableLink::send(uint8_t destination, uint8_t type, const void* payload, uint8_t length, uint32_t now) {
+    if (destination == 0xFF || destination == nodeId || type == 0 || length > RELIABLE_MAX_PAYLOAD) {
+        return false;
+    }
+    Peer* peer = getPeer(destination, now);
+    if (!peer || inFlight(*peer) >= RELIABLE_WINDOW) {
+        return false;
+    }
+    Slot* slot = nullptr;
+    for (uint8_t i = 0; i < RELIABLE_TX_SLOTS && !slot; i++) {
+        if (!slots[i].used) slot = &slots[i];
+    }
+    if (!slot) {
+        return false;
+    }
+
+    slot->used = true;
+    slot->sent = false;
+    slot->peer = (uint8_t)(peer - peers);
+    slot->seq = peer->nextSeq++;
+    slot->type = type;
+    slot->length = length;
+    slot->transmissions = 0;
+    slot->backoff = 0;
+    slot->queuedAt = now;
+    if (length > 0) {
+        memcpy(slot->data, payload, length);
+    }
+    if (inFlight(*peer) == 1) {
+        peer->base = slot->seq;
+    }
+    peer->lastActive = now;
+    stats.sent++;
+    return true;
+}
+
+void ReliableLink::sampleRtt(Peer& peer, uint32_t rttMs) {
+    stats.rttSamples++;
+    if (fixedRtoMs) {
+        return;
+    }
+    if (rttMs == 0) {
+        rttMs = 1;
+    }
+    // RFC 6298 in the classic scaled-integer form: alpha 1/8, beta 1/4
+    if (peer.srttX8 == 0) {
+        peer.srttX8 = rttMs << 3;
+        peer.rttvarX4 = rttMs << 1;
+    } else {
+        int32_t error = (int32_t)rttMs - (int32_t)(peer.srttX8 >> 3);
+        peer.srttX8 += error;
+        if (error < 0) error = -error;
+        peer.rttvarX4 += error - (peer.rttvarX4 >> 2);
+    }
+    uint32_t rto = (peer.srttX8 >> 3) + (peer.rttvarX4 > 1 ? peer.rttvarX4 : 1);
+    if (rto < RELIABLE_MIN_RTO_MS) rto = RELIABLE_MIN_RTO_MS;
+    if (rto > RELIABLE_MAX_RTO_MS) rto = RELIABLE_MAX_RTO_MS;
+    peer.rtoMs = rto;
+
+    // The peer is answering again: the other messages' losses were
+    // isolated, so their timers go back to the fresh estimate
+    uint8_t index = (uint8_t)(&peer - peers);
+    for (uint8_t i = 0; i < RELIABLE_TX_SLOTS; i++) {
+        if (slots[i].used && slots[i].peer == index) {
+            slots[i].backoff = 0;
+        }
+    }
+}
+
+void ReliableLink::onAck(Peer& peer, const ReliableHeader& header, uint32_t now) {
+    if (header.ackSession != session) {
+        return;                     // About a stream from before our reboot
+    }
+    uint8_t index = (uint8_t)(&peer - peers);
+    for (uint8_t i = 0; i < RELIABLE_TX_SLOTS; i++) {
+        Slot& s = slots[i];
+        if (!s.used || !s.sent || s.peer != index) {
+            continue;
+        }
+        uint8_t behind = (uint8_t)(header.ack - s.seq);
+        uint8_t beyond = (uint8_t)(s.seq - header.ack - 1);
+        bool acked = (behind >= 1 && behind < 128) || (beyond < 8 && (header.sack >> beyond) & 1);
+        if (!acked) {
+            continue;
+        }
+        // Karn: a retransmitted frame's ack could belong to either copy
+        if (s.transmissions == 1) {
+            sampleRtt(peer, now - s.firstSentAt);
+        }
+        release(s);
+    }
+}
+
+// Moves `expected` on by one; true when the new expected was already received
+static bool stepExpected(uint8_t& expected, uint8_t& received) {
+    bool got = received & 1;
+    received >>= 1;
+    expected++;
+    return got;
+}
+
+ReliableRxResult ReliableLink::onFrame(const DroneMessage& in, uint32_t now, DroneMessage& delivered) {
+    if (in.messageType != MSG_RELIABLE || in.destinationId != nodeId || in.dataLength < sizeof(ReliableHeader) ||
+        in.dataLength > sizeof(in.data)) {
+        return RELIABLE_IGNORED;
+    }
+    ReliableHeader header;
+    memcpy(&header, in.data, sizeof(header));
+    Peer* peer = getPeer(in.sourceId, now);
+    if (!peer) {
+        return RELIABLE_IGNORED;
+    }
+    peer->lastActive = now;
+    onAck(*peer, header, now);
+    if (header.type == 0) {
+        return RELIABLE_ACK_ONLY;
+    }
+
+    if (header.session != peer->rxSession) {
+        // First frame of this stream, or the sender rebooted
+        peer->rxSession = header.session;
+        peer->expected = header.base;
+        peer->received = 0;
+    }
+    // The sender gave up on everything before its base
+    bool got = false;
+    while ((uint8_t)(header.base - peer->expected) - 1u < 127u) {
+        got = stepExpected(peer->expected, peer->received);
+    }
+    while (got) {
+        got = stepExpected(peer->expected, peer->received);
+    }
+
+    uint8_t ahead = (uint8_t)(header.seq - peer->expected);
+    bool fresh = false;
+    if (ahead == 0) {
+        while (stepExpected(peer->expected, peer->received)) {
+        }
+        fresh = true;
+    } else if (ahead <= 8 && !(peer->received & (1 << (ahead - 1)))) {
+        peer->received |= 1 << (ahead - 1);
+        fresh = true;
+    }
+
+    if (!fresh) {
+        // Our ack was lost; send another now rather than wait for a timeout
+        stats.duplicates++;
+        peer->ackPending = true;
+        peer->ackDueAt = now;
+        return RELIABLE_DUPLICATE;
+    }
+    if (!peer->ackPending) {
+        peer->ackPending = true;
+        peer->ackDueAt = now + RELIABLE_ACK_DELAY_MS;
+    }
+
+    memset(&delivered, 0, sizeof(delivered));
+    delivered.messageType = header.type;
+    delivered.sourceId = in.sourceId;
+    delivered.destinationId = in.destinationId;
+    delivered.timestamp = in.timestamp;
+    delivered.sequenceNumber = in.sequenceNumber;
+    delivered.dataLength = in.dataLength - sizeof(ReliableHeader);
+    memcpy(delivered.data, in.data + sizeof(ReliableHeader), delivered.dataLength);
+    delivered.checksum = droneMessageChecksum(delivered);
+    stats.delivered++;
+    return RELIABLE_DELIVER;
+}
+
+void ReliableLink::build(Peer& peer, const Slot* slot, uint32_t now, DroneMessage& out) {
+    memset(&out, 0, sizeof(out));
+    out.messageType = MSG_RELIABLE;
+    out.sourceId = nodeId;
+    out.destinationId = peer.id;
+    out.timestamp = slot ? slot->queuedAt : now;
+    // Sequence number and checksum are stamped when the frame is sealed
+
+    ReliableHeader header;
+    header.type = slot ? slot->type : 0;
+    header.session = session;
+    header.seq = slot ? slot->seq : peer.nextSeq;
+    header.base = peer.base;
+    header.ackSession = peer.rxSession;
+    header.ack = peer.expected;
+    header.sack = peer.received;
+    memcpy(out.data, &header, sizeof(header));
+    out.dataLength = sizeof(header);
+    if (slot && slot->length > 0) {
+        memcpy(out.data + sizeof(header), slot->data, slot->length);
+        out.dataLength += slot->length;
+    }
+
+    // Every frame to this peer carries the acknowledgement
+    peer.ackPending = false;
+}
+
+uint32_t ReliableLink::timeoutOf(const Slot& slot) const {
+    uint32_t rto = peers[slot.peer].rtoMs;
+    if (fixedRtoMs) {
+        return rto;
+    }
+    // Doubled per retransmission of this message only: a run of losses
+    // must not leave the next message waiting out the backed-off timer.
+    // Past RELIABLE_MAX_BACKOFF_MS doubling only stretches the tail
+    uint32_t cap = rto > RELIABLE_MAX_BACKOFF_MS ? rto : RELIABLE_MAX_BACKOFF_MS;
+    for (uint8_t i = 0; i < slot.backoff && rto < cap; i++) {
+        rto <<= 1;
+    }
+    return rto < cap ? rto : cap;
+}
+
+uint8_t ReliableLink::poll(uint32_t now, DroneMessage* out, uint8_t maxFrames) {
+    uint8_t count = 0;
+    while (count < maxFrames) {
+        Slot* due = nullptr;
+        for (uint8_t i = 0; i < RELIABLE_TX_SLOTS; i++) {
+            Slot& s = slots[i];
+            if (!s.used || (s.sent && now - s.lastSentAt < timeoutOf(s))) {
+                continue;
+            }
+            if (!due || (int32_t)(s.queuedAt - due->queuedAt) < 0) {
+                due = &s;
+            }
+        }
+        if (!due) {
+            break;
+        }
+
+        Peer& peer = peers[due->peer];
+        if (due->sent) {
+            if (due->transmissions > MAX_RETRIES) {
+                stats.failed++;
+                DEBUG_PRINT("[RELIABLE] Gave up on seq %d to drone %d after %d tries\n", due->seq, peer.id,
+                            due->transmissions);
+                release(*due);
+                continue;
+            }
+            stats.retransmissions++;
+            due->backoff++;
+        } else {
+            due->sent = true;
+            due->firstSentAt = now;
+        }
+        due->transmissions++;
+        due->lastSentAt = now;
+        stats.transmissions++;
+        build(peer, due, now, out[count++]);
+    }
+
+    for (uint8_t i = 0; i < RELIABLE_MAX_PEERS && count < maxFrames; i++) {
+        Peer& peer = peers[i];
+        if (peer.id != NO_PEER && peer.ackPending && (int32_t)(now - peer.ackDueAt) >= 0) {
+            build(peer, nullptr, now, out[count++]);
+            stats.ackFrames++;
+        }
+    }
+    return count;
+}
+
+uint32_t ReliableLink::nextDueIn(uint32_t now) const {
+    uint32_t soonest = UINT32_MAX;
+    for (uint8_t i = 0; i < RELIABLE_TX_SLOTS; i++) {
+        const Slot& s = slots[i];
+        if (!s.used) {
+            continue;
+        }
+        uint32_t waited = now - s.lastSentAt;
+        uint32_t rto = timeoutOf(s);
+        uint32_t wait = !s.sent || waited >= rto ? 0 : rto - waited;
+        if (wait < soonest) soonest = wait;
+    }
+    for (uint8_t i = 0; i < RELIABLE_MAX_PEERS; i++) {
+        const Peer& p = peers[i];
+        if (p.id != NO_PEER && p.ackPending) {
+            int32_t wait = (int32_t)(p.ackDueAt - now);
+            if (wait < 0) wait = 0;
+            if ((uint32_t)wait < soonest) soonest = wait;
+        }
+    }
+    return soonest;
+}
+
+uint8_t ReliableLink::pending() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < RELIABLE_TX_SLOTS; i++) {
+        count += slots[i].used;
+    }
+    return count;
+}
+
+uint8_t ReliableLink::pendingFor(uint8_t destination) {
+    Peer* peer = findPeer(destination);
+    return peer ? inFlight(*peer) : 0;
+}
+
+uint32_t ReliableLink::getRtoMs(uint8_t peer) {
+    Peer* p = findPeer(peer);
+    return p ? p->rtoMs : (fixedRtoMs ? fixedRtoMs : ACK_TIMEOUT_MS);
+}
+
+uint32_t ReliableLink::getSrttMs(uint8_t peer) {
+    Peer* p = findPeer(peer);
+    return p ? p->srttX8 >> 3 : 0;
+}
+
+void ReliableLink::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
@@ -0,0 +1,398 @@
+#include "../../include/communications/status_service.h"
+#include "../../include/utilities/varint.h"
+
+static_assert(TELEMETRY_HISTOGRAM_SUB_BITS <= PERF_HISTOGRAM_SUB_BITS, "Telemetry histograms must not be finer than the monitor's");
+static_assert(STATUS_MAX_FRAMES <= 32, "Fragment masks are 32 bits");
+
+namespace {
+
+// Records are all-or-nothing: a writer that overflows rolls back to the
+// start of the record and refuses everything after it
+struct StreamWriter {
+    uint8_t* out;
+    size_t capacity;
+    size_t length;
+    size_t mark;
+    bool overflow;
+
+    void begin(uint8_t tag) {
+        mark = length;
+        byte(tag);
+    }
+
+    void byte(uint8_t value) {
+        if (!overflow && length < capacity) {
+            out[length++] = value;
+        } else {
+            overflow = true;
+        }
+    }
+
+    void varint(uint32_t value) {
+        size_t n = overflow ? 0 : varintWrite(out + length, capacity - length, value);
+        if (n) {
+            length += n;
+        } else {
+            overflow = true;
+        }
+    }
+
+    void delta(uint32_t from, uint32_t to) { varint(zigzagEncode((int32_t)(to - from))); }
+
+    bool commit() {
+        if (overflow) {
+            length = mark;
+            return false;
+        }
+        return true;
+    }
+};
+
+struct StreamReader {
+    const uint8_t* in;
+    size_t length;
+    size_t pos;
+
+    bool byte(uint8_t& value) {
+        if (pos >= length) return false;
+        value = in[pos++];
+        return true;
+    }
+
+    bool varint(uint32_t& value) {
+        size_t n = varintRead(in + pos, length - pos, value);
+        pos += n;
+        return n > 0;
+    }
+
+    bool delta(uint32_t& value) {
+        uint32_t raw;
+        if (!varint(raw)) return false;
+        value += (uint32_t)zigzagDecode(raw);
+        return true;
+    }
+};
+
+bool peerChanged(const TelemetryPeer& a, const TelemetryPeer& b) {
+    return a.state != b.state || a.rssi != b.rssi || a.snrQ2 != b.snrQ2 ||
+           a.heartbeats != b.heartbeats || a.lastSeen != b.lastSeen;
+}
+
+TelemetryPeer* findPeer(TelemetrySnapshot& state, uint8_t id) {
+    for (uint8_t i = 0; i < state.peerCount; i++) {
+        if (state.peers[i].id == id) return &state.peers[i];
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+const TelemetryPeer* telemetryFindPeer(const TelemetrySnapshot& state, uint8_t id) {
+    return findPeer(const_cast<TelemetrySnapshot&>(state), id);
+}
+
+size_t telemetryEncode(const TelemetrySnapshot& base, const TelemetrySnapshot& current,
+                       uint8_t* out, size_t capacity) {
+    StreamWriter w = {out, capacity, 0, 0, false};
+
+    uint32_t mask = 0;
+    for (uint8_t i = 0; i < TEL_COUNTER_COUNT; i++) {
+        if (current.counters[i] != base.counters[i]) mask |= 1u << i;
+    }
+    if (mask) {
+        w.begin(TEL_RECORD_COUNTERS);
+        w.varint(mask);
+        for (uint8_t i = 0; i < TEL_COUNTER_COUNT; i++) {
+            if (mask & (1u << i)) w.delta(base.counters[i], current.counters[i]);
+        }
+        w.commit();
+    }
+
+    // Departures first so the receiver's table never overfills
+    for (uint8_t i = 0; i < base.peerCount && !w.overflow; i++) {
+        if (!telemetryFindPeer(current, base.peers[i].id)) {
+            w.begin(TEL_RECORD_PEER_GONE);
+            w.byte(base.peers[i].id);
+            w.commit();
+        }
+    }
+
+    static const TelemetryPeer none = {0, 0, 0, 0, 0, 0};
+    for (uint8_t i = 0; i < current.peerCount && !w.overflow; i++) {
+        const TelemetryPeer& peer = current.peers[i];
+        const TelemetryPeer* was = telemetryFindPeer(base, peer.id);
+        if (was && !peerChanged(*was, peer)) continue;
+        if (!was) was = &none;
+
+        w.begin(TEL_RECORD_PEER);
+        w.byte(peer.id);
+        w.byte(peer.state);
+        w.delta((uint32_t)(int32_t)was->rssi, (uint32_t)(int32_t)peer.rssi);
+        w.delta((uint32_t)(int32_t)was->snrQ2, (uint32_t)(int32_t)peer.snrQ2);
+        w.delta(was->heartbeats, peer.heartbeats);
+        w.delta(was->lastSeen, peer.lastSeen);
+        w.commit();
+    }
+
+    // Latencies cluster, so the changed buckets go out as one run with
+    // unchanged ones inside it costing a single zero byte
+    for (uint8_t p = 0; p < PERF_PROBE_COUNT && !w.overflow; p++) {
+        int16_t first = -1, last = -1;
+        for (uint16_t b = 0; b < TELEMETRY_BUCKETS; b++) {
+            if (current.buckets[p][b] != base.buckets[p][b]) {
+                if (first < 0) first = b;
+                last = b;
+            }
+        }
+        if (first < 0 && current.maxCycles[p] == base.maxCycles[p]) continue;
+
+        w.begin(TEL_RECORD_HISTOGRAM);
+        w.byte(p);
+        w.delta(base.maxCycles[p], current.maxCycles[p]);
+        if (first < 0) {
+            w.varint(0);
+            w.varint(0);
+        } else {
+            w.varint(first);
+            w.varint(last - first + 1);
+            for (int16_t b = first; b <= last; b++) {
+                w.delta(base.buckets[p][b], current.buckets[p][b]);
+            }
+        }
+        w.commit();
+    }
+    return w.length;
+}
+
+bool telemetryApply(TelemetrySnapshot& state, const uint8_t* in, size_t length) {
+    StreamReader r = {in, length, 0};
+    while (r.pos < r.length) {
+        uint8_t tag;
+        r.byte(tag);
+        switch (tag) {
+            case TEL_RECORD_COUNTERS: {
+                uint32_t mask;
+                if (!r.varint(mask) || mask >> TEL_COUNTER_COUNT) return false;
+                for (uint8_t i = 0; i < TEL_COUNTER_COUNT; i++) {
+                    if ((mask & (1u << i)) && !r.delta(state.counters[i])) return false;
+                }
+                break;
+            }
+            case TEL_RECORD_PEER_GONE: {
+                uint8_t id;
+                if (!r.byte(id)) return false;
+                TelemetryPeer* peer = findPeer(state, id);
+                if (peer) {
+                    *peer = state.peers[--state.peerCount];
+                }
+                break;
+            }
+            case TEL_RECORD_PEER: {
+                uint8_t id, peerState;
+                if (!r.byte(id) || !r.byte(peerState)) return false;
+                TelemetryPeer* peer = findPeer(state, id);
+                if (!peer) {
+                    if (state.peerCount >= PEER_TABLE_SIZE) return false;
+                    peer = &state.peers[state.peerCount++];
+                    memset(peer, 0, sizeof(*peer));
+                    peer->id = id;
+                }
+                uint32_t rssi = (uint32_t)(int32_t)peer->rssi;
+                uint32_t snr = (uint32_t)(int32_t)peer->snrQ2;
+                if (!r.delta(rssi) || !r.delta(snr) || !r.delta(peer->heartbeats) || !r.delta(peer->lastSeen)) {
+                    return false;
+                }
+                peer->state = peerState;
+                peer->rssi = (int16_t)rssi;
+                peer->snrQ2 = (int8_t)snr;
+                break;
+            }
+            case TEL_RECORD_HISTOGRAM: {
+                uint8_t probe;
+                uint32_t first, count;
+                if (!r.byte(probe) || probe >= PERF_PROBE_COUNT) return false;
+                if (!r.delta(state.maxCycles[probe]) || !r.varint(first) || !r.varint(count)) return false;
+                if (first + count > TELEMETRY_BUCKETS) return false;
+                for (uint32_t b = first; b < first + count; b++) {
+                    if (!r.delta(state.buckets[probe][b])) return false;
+                }
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+void buildStatusRequest(uint8_t selfId, uint8_t destination, uint16_t sequence, uint32_t now,
+                        StatusPayloadKind kind, uint16_t baseSnapshot, DroneMessage& out) {
+    memset(&out, 0, sizeof(out));
+    out.messageType = MSG_STATUS_REQUEST;
+    out.sourceId = selfId;
+    out.destinationId = destination;
+    out.timestamp = now;
+    out.sequenceNumber = sequence;
+    StatusRequestData request = {kind, baseSnapshot};
+    memcpy(out.data, &request, sizeof(request));
+    out.dataLength = sizeof(request);
+    out.checksum = droneMessageChecksum(out);
+}
+
+StatusService::StatusService(uint8_t selfId, const PerfMonitor* perf, const PeerTable* peers)
+    : selfId(selfId), sequence(0), nextSnapshotId(1), perf(perf), peers(peers) {
+    memset(requesters, 0, sizeof(requesters));
+    memset(&current, 0, sizeof(current));
+    memset(&stats, 0, sizeof(stats));
+}
+
+// Known requester, else a free slot, else the one quiet the longest
+StatusService::Requester& StatusService::requesterFor(uint8_t id, uint32_t now) {
+    Requester* slot = &requesters[0];
+    for (uint8_t i = 0; i < STATUS_MAX_REQUESTERS; i++) {
+        Requester& r = requesters[i];
+        if (r.used && r.id == id) {
+            r.lastRequest = now;
+            return r;
+        }
+        if (slot->used && (!r.used || now - r.lastRequest > now - slot->lastRequest)) {
+            slot = &r;
+        }
+    }
+    slot->used = true;
+    slot->id = id;
+    slot->sentId = 0;
+    slot->previousId = 0;
+    slot->lastRequest = now;
+    return *slot;
+}
+
+void StatusService::capture(const CommStats& comm, uint32_t now) {
+    current.counters[TEL_UPTIME_MS] = now;
+    current.counters[TEL_MESSAGES_SENT] = comm.messagesSent;
+    current.counters[TEL_MESSAGES_RECEIVED] = comm.messagesReceived;
+    current.counters[TEL_MESSAGES_LOST] = comm.messagesLost;
+    current.counters[TEL_MESSAGES_PREEMPTED] = comm.messagesPreempted;
+    current.counters[TEL_LAST_RSSI] = (uint32_t)comm.lastRSSI;
+    current.counters[TEL_LAST_SNR_Q2] = (uint32_t)(int32_t)(comm.lastSNR * 4.0f);
+#ifdef ARDUINO
+    current.counters[TEL_FREE_HEAP] = ESP.getFreeHeap();
+#else
+    current.counters[TEL_FREE_HEAP] = 0;
+#endif
+    current.counters[TEL_CYCLES_PER_US] = perf ? (uint32_t)(perf->getCyclesPerNs() * 1000.0f + 0.5f) : 0;
+
+    memset(current.buckets, 0, sizeof(current.buckets));
+    memset(current.maxCycles, 0, sizeof(current.maxCycles));
+    if (perf) {
+        uint32_t raw[PERF_BUCKETS];
+        for (uint8_t p = 0; p < PERF_PROBE_COUNT; p++) {
+            perf->snapshot((PerfProbe)p, raw, current.maxCycles[p]);
+            for (uint16_t b = 0; b < PERF_BUCKETS; b++) {
+                if (!raw[b]) continue;
+                uint32_t low = perfBucketLow(b, PERF_HISTOGRAM_SUB_BITS);
+                current.buckets[p][perfBucketIndex(low, TELEMETRY_HISTOGRAM_SUB_BITS)] += raw[b];
+            }
+        }
+    }
+
+    current.peerCount = 0;
+    if (peers) {
+        for (uint8_t i = 0; i < PEER_TABLE_SIZE; i++) {
+            const PeerEntry* e = peers->at(i);
+            if (!e) continue;
+            TelemetryPeer& peer = current.peers[current.peerCount++];
+            peer.id = e->id;
+            peer.state = (uint8_t)(e->missionState << 4 | (e->status & 0x0F));
+            peer.rssi = e->lastRssi;
+            peer.snrQ2 = e->lastSnrQ2;
+            peer.heartbeats = e->heartbeats;
+            peer.lastSeen = e->lastSeen;
+        }
+    }
+}
+
+uint8_t StatusService::handleRequest(const DroneMessage& request, const CommStats& comm, uint32_t now,
+                                     DroneMessage* out) {
+    // Unicast only: a broadcast request would have the whole swarm answer at once
+    if (request.messageType != MSG_STATUS_REQUEST || request.destinationId != selfId ||
+        request.dataLength < 1) {
+        return 0;
+    }
+    stats.requests++;
+
+    if (request.data[0] == STATUS_PERF_HISTOGRAMS) {
+        uint8_t cursor = 0, frames = 0;
+        while (frames < STATUS_MAX_FRAMES &&
+               perf && perf->buildStatusResponse(selfId, request.sourceId, ++sequence, cursor, out[frames])) {
+            out[frames].timestamp = now;
+            out[frames].checksum = droneMessageChecksum(out[frames]);
+            frames++;
+        }
+        stats.framesSent += frames;
+        return frames;
+    }
+
+    if (request.data[0] != STATUS_TELEMETRY_DELTA || request.dataLength < sizeof(StatusRequestData)) {
+        return 0;
+    }
+    StatusRequestData data;
+    memcpy(&data, request.data, sizeof(data));
+
+    Requester& r = requesterFor(request.sourceId, now);
+    uint16_t baseId = data.baseSnapshot;
+    if (baseId != 0 && baseId == r.sentId) {
+        // Last response arrived: it becomes the fallback base
+        r.previous = r.sent;
+        r.previousId = r.sentId;
+        stats.deltas++;
+    } else if (baseId != 0 && baseId == r.previousId) {
+        DEBUG_PRINT("[STATUS] Snapshot %u lost on the way to %d, resending from %u\n", r.sentId, r.id, baseId);
+        stats.deltas++;
+    } else {
+        memset(&r.previous, 0, sizeof(r.previous));
+        r.previousId = 0;
+        baseId = 0;
+        stats.resyncs++;
+    }
+
+    capture(comm, now);
+    size_t length = telemetryEncode(r.previous, current, stream, sizeof(stream));
+
+    // What the requester will hold once every fragment lands
+    r.sent = r.previous;
+    telemetryApply(r.sent, stream, length);
+    r.sentId = nextSnapshotId++;
+    if (nextSnapshotId == 0) nextSnapshotId = 1;
+    if (memcmp(r.sent.counters, current.counters, sizeof(current.counters)) != 0 ||
+        r.sent.peerCount != current.peerCount ||
+        memcmp(r.sent.buckets, current.buckets, sizeof(current.buckets)) != 0) {
+        stats.truncated++;
+    }
+
+    uint8_t count = length ? (uint8_t)((length + TELEMETRY_FRAGMENT_BYTES - 1) / TELEMETRY_FRAGMENT_BYTES) : 1;
+    for (uint8_t f = 0; f < count; f++) {
+        DroneMessage& msg = out[f];
+        memset(&msg, 0, sizeof(msg));
+        msg.messageType = MSG_STATUS_RESPONSE;
+        msg.sourceId = selfId;
+        msg.destinationId = request.sourceId;
+        msg.timestamp = now;
+        msg.sequenceNumber = ++sequence;
+
+        TelemetryFrameHeader header = {STATUS_TELEMETRY_DELTA, r.sentId, baseId, f, count};
+        size_t offset = f * TELEMETRY_FRAGMENT_BYTES;
+        size_t chunk = length - offset < TELEMETRY_FRAGMENT_BYTES ? length - offset : TELEMETRY_FRAGMENT_BYTES;
+        if (!length) chunk = 0;
+        memcpy(msg.data, &header, sizeof(header));
+        memcpy(msg.data + sizeof(header), stream + offset, chunk);
+        msg.dataLength = (uint8_t)(sizeof(header) + chunk);
+        msg.checksum = droneMessageChecksum(msg);
+    }
+
+    stats.framesSent += count;
+    stats.bytesSent += length;
+    DEBUG_PRINT("[STATUS] Snapshot %u for %d: %u bytes in %u frame(s)%s\n", r.sentId, r.id,
+                (unsigned)length, count, baseId ? "" : " (resync)");
+    return count;
+}
@@ -0,0 +1,725 @@
+#include "../../include/coordination/mission_controller.h"
+#include "../../include/utilities/performance_monitor.h"
+#include <math.h>
+
+#ifdef ARDUINO
+#include <esp_timer.h>
+#else
+#include <chrono>
+#endif
+
+#define METERS_PER_DEG_LAT 111320.0f
+#define ASSIGN_INF 1e30f
+#define ORCA_EPSILON 0.00001f
+#define ARRIVAL_GAIN 0.5f            // 1/s, slows down on the final approach
+
+static uint32_t controlNowUs() {
+#ifdef ARDUINO
+    return (uint32_t)esp_timer_get_time();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static float lengthSq(const Vec2& a) { return a * a; }
+static float length(const Vec2& a) { return sqrtf(a * a); }
+static float det(const Vec2& a, const Vec2& b) { return a.x * b.y - a.y * b.x; }
+static Vec2 normalize(const Vec2& a) {
+    float l = length(a);
+    return l > 0 ? a / l : a;
+}
+
+// ===== LocalTangentPlane =====
+
+void LocalTangentPlane::setOrigin(float latitude, float longitude) {
+    originLat = latitude;
+    originLon = longitude;
+    metersPerDegLon = METERS_PER_DEG_LAT * cosf(latitude * (float)M_PI / 180.0f);
+    originSet = true;
+}
+
+Vec2 LocalTangentPlane::toLocal(float latitude, float longitude) {
+    if (!originSet) {
+        setOrigin(latitude, longitude);
+    }
+    return Vec2((longitude - originLon) * metersPerDegLon, (latitude - originLat) * METERS_PER_DEG_LAT);
+}
+
+void LocalTangentPlane::toGeo(const Vec2& p, float& latitude, float& longitude) const {
+    latitude = originLat + p.y / METERS_PER_DEG_LAT;
+    longitude = originLon + p.x / metersPerDegLon;
+}
+
+// ===== HungarianSolver =====
+
+HungarianSolver::HungarianSolver() : rows(0), cols(0), dualsValid(false), tolerance(0.001f), fallbacks(0) {
+    setSize(0, 0);
+}
+
+void HungarianSolver::setSize(uint8_t rowCount, uint8_t colCount) {
+    rows = rowCount > MAX_FORMATION_MEMBERS ? MAX_FORMATION_MEMBERS : rowCount;
+    cols = colCount > MAX_FORMATION_MEMBERS ? MAX_FORMATION_MEMBERS : colCount;
+    for (uint8_t r = 0; r < MAX_FORMATION_MEMBERS; r++) {
+        rowActive[r] = r < rows;
+    }
+    for (uint8_t j = 0; j <= MAX_FORMATION_MEMBERS; j++) {
+        rowOfCol[j] = 0;
+        u[j] = 0;
+        v[j] = 0;
+    }
+    dualsValid = false;
+}
+
+// Classic potentials + shortest augmenting path formulation, one row at a time
+float HungarianSolver::solve() {
+    float minv[MAX_FORMATION_MEMBERS + 1];
+    int8_t way[MAX_FORMATION_MEMBERS + 1];
+    bool used[MAX_FORMATION_MEMBERS + 1];
+
+    for (uint8_t j = 0; j <= MAX_FORMATION_MEMBERS; j++) {
+        rowOfCol[j] = 0;
+        u[j] = 0;
+        v[j] = 0;
+    }
+
+    uint8_t assigned = 0;
+    for (uint8_t r = 0; r < rows; r++) {
+        if (!rowActive[r]) continue;
+        if (assigned == cols) {
+            rowActive[r] = false;   // More drones than slots: leave the rest out
+            continue;
+        }
+        assigned++;
+
+        rowOfCol[0] = r + 1;
+        uint8_t j0 = 0;
+        for (uint8_t j = 0; j <= cols; j++) {
+            minv[j] = ASSIGN_INF;
+            used[j] = false;
+        }
+
+        do {
+            used[j0] = true;
+            uint8_t i0 = rowOfCol[j0];
+            float delta = ASSIGN_INF;
+            uint8_t j1 = 0;
+            for (uint8_t j = 1; j <= cols; j++) {
+                if (used[j]) continue;
+                float cur = cost[i0 - 1][j - 1] - u[i0] - v[j];
+                if (cur < minv[j]) {
+                    minv[j] = cur;
+                    way[j] = j0;
+                }
+                if (minv[j] < delta) {
+                    delta = minv[j];
+                    j1 = j;
+                }
+            }
+            for (uint8_t j = 0; j <= cols; j++) {
+                if (used[j]) {
+                    u[rowOfCol[j]] += delta;
+                    v[j] -= delta;
+                } else {
+                    minv[j] -= delta;
+                }
+            }
+            j0 = j1;
+        } while (rowOfCol[j0] != 0);
+
+        do {
+            uint8_t j1 = way[j0];
+            rowOfCol[j0] = rowOfCol[j1];
+            j0 = j1;
+        } while (j0);
+    }
+
+    rowOfCol[0] = 0;
+    dualsValid = true;
+    return totalCost();
+}
+
+// Column potentials v are reusable if every row's current column is still
+// (within tolerance) its cheapest option after reduction by v
+bool HungarianSolver::dualsFeasible() const {
+    for (uint8_t c = 1; c <= cols; c++) {
+        if (!rowOfCol[c]) continue;
+        uint8_t r = rowOfCol[c] - 1;
+        float base = cost[r][c - 1] - v[c];
+        for (uint8_t a = 1; a <= cols; a++) {
+            if (cost[r][a - 1] - v[a] < base - tolerance) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Removing one row changes the optimum by at most one alternating path that
+// starts at the freed column: each row on it shifts one column towards the
+// hole. Dijkstra over columns with the solve() potentials finds the cheapest
+// such path in O(n^2).
+float HungarianSolver::removeRow(uint8_t row) {
+    if (row >= rows || !rowActive[row]) {
+        return totalCost();
+    }
+    rowActive[row] = false;
+
+    uint8_t freed = 0;
+    for (uint8_t j = 1; j <= cols; j++) {
+        if (rowOfCol[j] == row + 1) {
+            freed = j;
+            break;
+        }
+    }
+    if (!freed) {
+        return totalCost();
+    }
+    rowOfCol[freed] = 0;
+
+    if (!dualsValid || !dualsFeasible()) {
+        fallbacks++;
+        return solve();
+    }
+
+    // Edge a -> b: the row in column b moves to a, freeing b
+    float dist[MAX_FORMATION_MEMBERS + 1];
+    int8_t prev[MAX_FORMATION_MEMBERS + 1];
+    bool done[MAX_FORMATION_MEMBERS + 1];
+    for (uint8_t j = 0; j <= cols; j++) {
+        dist[j] = ASSIGN_INF;
+        prev[j] = 0;
+        done[j] = false;
+    }
+    dist[freed] = 0;
+
+    uint8_t best = freed;
+    float bestCost = 0;
+    while (true) {
+        uint8_t a = 0;
+        float nearest = ASSIGN_INF;
+        for (uint8_t j = 1; j <= cols; j++) {
+            if (!done[j] && dist[j] < nearest) {
+                nearest = dist[j];
+                a = j;
+            }
+        }
+        if (!a) break;
+        done[a] = true;
+
+        // Real cost of ending the path here (column a becomes the hole)
+        float pathCost = dist[a] + v[freed] - v[a];
+        if (pathCost < bestCost) {
+            bestCost = pathCost;
+            best = a;
+        }
+
+        for (uint8_t b = 1; b <= cols; b++) {
+            if (done[b] || !rowOfCol[b]) continue;
+            uint8_t rb = rowOfCol[b] - 1;
+            float w = cost[rb][a - 1] - cost[rb][b - 1] - v[a] + v[b];
+            if (w < 0) w = 0;   // Within tolerance
+            if (dist[a] + w < dist[b]) {
+                dist[b] = dist[a] + w;
+                prev[b] = a;
+            }
+        }
+    }
+
+    // Keep potentials consistent for the next removal
+    float cap = dist[best];
+    for (uint8_t j = 1; j <= cols; j++) {
+        v[j] -= dist[j] < cap ? dist[j] : cap;
+    }
+
+    // Shift rows along the path; best ends up empty
+    uint8_t b = best;
+    int8_t moving = rowOfCol[b];
+    rowOfCol[b] = 0;
+    while (b != freed) {
+        uint8_t a = prev[b];
+        int8_t displaced = rowOfCol[a];
+        rowOfCol[a] = moving;
+        moving = displaced;
+        b = a;
+    }
+    return totalCost();
+}
+
+int8_t HungarianSolver::getColumn(uint8_t row) const {
+    for (uint8_t j = 1; j <= cols; j++) {
+        if (rowOfCol[j] == row + 1) {
+            return j - 1;
+        }
+    }
+    return -1;
+}
+
+float HungarianSolver::totalCost() const {
+    float total = 0;
+    for (uint8_t j = 1; j <= cols; j++) {
+        if (rowOfCol[j]) {
+            total += cost[rowOfCol[j] - 1][j - 1];
+        }
+    }
+    return total;
+}
+
+// ===== ORCA =====
+
+struct OrcaLine {
+    Vec2 point;
+    Vec2 direction;
+};
+
+static bool linearProgram1(const OrcaLine* lines, uint8_t lineNo, float radius, const Vec2& optVelocity,
+                           bool directionOpt, Vec2& result) {
+    float dotProduct = lines[lineNo].point * lines[lineNo].direction;
+    float discriminant = dotProduct * dotProduct + radius * radius - lengthSq(lines[lineNo].point);
+    if (discriminant < 0) {
+        return false;   // Max speed circle fully invalidates this line
+    }
+
+    float sqrtDiscriminant = sqrtf(discriminant);
+    float tLeft = -dotProduct - sqrtDiscriminant;
+    float tRight = -dotProduct + sqrtDiscriminant;
+
+    for (uint8_t i = 0; i < lineNo; i++) {
+        float denominator = det(lines[lineNo].direction, lines[i].direction);
+        float numerator = det(lines[i].direction, lines[lineNo].point - lines[i].point);
+        if (fabsf(denominator) <= ORCA_EPSILON) {
+            if (numerator < 0) return false;
+            continue;
+        }
+        float t = numerator / denominator;
+        if (denominator >= 0) {
+            tRight = fminf(tRight, t);
+        } else {
+            tLeft = fmaxf(tLeft, t);
+        }
+        if (tLeft > tRight) return false;
+    }
+
+    const OrcaLine& line = lines[lineNo];
+    if (directionOpt) {
+        result = line.point + line.direction * (optVelocity * line.direction > 0 ? tRight : tLeft);
+    } else {
+        float t = line.direction * (optVelocity - line.point);
+        if (t < tLeft) t = tLeft;
+        if (t > tRight) t = tRight;
+        result = line.point + line.direction * t;
+    }
+    return true;
+}
+
+static uint8_t linearProgram2(const OrcaLine* lines, uint8_t count, float radius, const Vec2& optVelocity,
+                              bool directionOpt, Vec2& result) {
+    if (directionOpt) {
+        result = optVelocity * radius;
+    } else if (lengthSq(optVelocity) > radius * radius) {
+        result = normalize(optVelocity) * radius;
+    } else {
+        result = optVelocity;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (det(lines[i].direction, lines[i].point - result) > 0) {
+            Vec2 previous = result;
+            if (!linearProgram1(lines, i, radius, optVelocity, directionOpt, result)) {
+                result = previous;
+                return i;
+            }
+        }
+    }
+    return count;
+}
+
+// Infeasible: minimise the maximum penetration into the constraints
+static void linearProgram3(const OrcaLine* lines, uint8_t count, uint8_t beginLine, float radius, Vec2& result) {
+    OrcaLine projected[ORCA_MAX_NEIGHBORS];
+    float distance = 0;
+
+    for (uint8_t i = beginLine; i < count; i++) {
+        if (det(lines[i].direction, lines[i].point - result) <= distance) continue;
+
+        uint8_t projectedCount = 0;
+        for (uint8_t j = 0; j < i; j++) {
+            OrcaLine line;
+            float determinant = det(lines[i].direction, lines[j].direction);
+            if (fabsf(determinant) <= ORCA_EPSILON) {
+                if (lines[i].direction * lines[j].direction > 0) continue;
+                line.point = (lines[i].point + lines[j].point) * 0.5f;
+            } else {
+                line.point = lines[i].point + lines[i].direction *
+                             (det(lines[j].direction, lines[i].point - lines[j].point) / determinant);
+            }
+            line.direction = normalize(lines[j].direction - lines[i].direction);
+            projected[projectedCount++] = line;
+        }
+
+        Vec2 previous = result;
+        Vec2 inward(-lines[i].direction.y, lines[i].direction.x);
+        if (linearProgram2(projected, projectedCount, radius, inward, true, result) < projectedCount) {
+            result = previous;  // Only float rounding gets here
+        }
+        distance = det(lines[i].direction, lines[i].point - result);
+    }
+}
+
+Vec2 orcaVelocity(const Vec2& position, const Vec2& velocity, const Vec2& preferred,
+                  const Vec2* neighborPos, const Vec2* neighborVel, uint8_t neighborCount,
+                  float radius, float maxSpeed, float timeHorizon, float timeStep, bool* avoiding) {
+    OrcaLine lines[ORCA_MAX_NEIGHBORS];
+    uint8_t count = 0;
+    float invTimeHorizon = 1.0f / timeHorizon;
+    float combinedRadius = 2.0f * radius;
+    float combinedRadiusSq = combinedRadius * combinedRadius;
+
+    for (uint8_t n = 0; n < neighborCount && count < ORCA_MAX_NEIGHBORS; n++) {
+        Vec2 relativePosition = neighborPos[n] - position;
+        Vec2 relativeVelocity = velocity - neighborVel[n];
+        float distSq = lengthSq(relativePosition);
+        OrcaLine line;
+        Vec2 u;
+
+        if (distSq > combinedRadiusSq) {
+            // Vector from the cut-off circle centre to the relative velocity
+            Vec2 w = relativeVelocity - relativePosition * invTimeHorizon;
+            float wLengthSq = lengthSq(w);
+            float dotProduct = w * relativePosition;
+
+            if (dotProduct < 0 && dotProduct * dotProduct > combinedRadiusSq * wLengthSq) {
+                // Closest boundary point is on the cut-off circle
+                float wLength = sqrtf(wLengthSq);
+                Vec2 unitW = w / wLength;
+                line.direction = Vec2(unitW.y, -unitW.x);
+                u = unitW * (combinedRadius * invTimeHorizon - wLength);
+            } else {
+                // Closest boundary point is on one of the legs
+                float leg = sqrtf(distSq - combinedRadiusSq);
+                if (det(relativePosition, w) > 0) {
+                    line.direction = Vec2(relativePosition.x * leg - relativePosition.y * combinedRadius,
+                                          relativePosition.x * combinedRadius + relativePosition.y * leg) / distSq;
+                } else {
+                    line.direction = -Vec2(relativePosition.x * leg + relativePosition.y * combinedRadius,
+                                           -relativePosition.x * combinedRadius + relativePosition.y * leg) / distSq;
+                }
+                u = line.direction * (relativeVelocity * line.direction) - relativeVelocity;
+            }
+        } else {
+            // Already overlapping: separate within one time step
+            Vec2 w = relativeVelocity - relativePosition / timeStep;
+            float wLength = length(w);
+            Vec2 unitW = wLength > 0 ? w / wLength : Vec2(1, 0);
+            line.direction = Vec2(unitW.y, -unitW.x);
+            u = unitW * (combinedRadius / timeStep - wLength);
+        }
+
+        // Reciprocal: each side takes half of the avoidance
+        line.point = velocity + u * 0.5f;
+        lines[count++] = line;
+    }
+
+    Vec2 result;
+    uint8_t failed = linearProgram2(lines, count, maxSpeed, preferred, false, result);
+    if (failed < count) {
+        linearProgram3(lines, count, failed, maxSpeed, result);
+    }
+
+    if (avoiding) {
+        *avoiding = lengthSq(result - preferred) > 0.01f;
+    }
+    return result;
+}
+
+// ===== FormationController =====
+
+FormationController::FormationController(FormationShape shape, float spacingM)
+    : memberCount(0), slotCount(0), shape(shape), spacing(spacingM), heading(0),
+      assignmentDirty(false), settledSnapshot(false) {
+    for (uint8_t i = 0; i < MAX_FORMATION_MEMBERS; i++) {
+        members[i] = FormationMember();
+    }
+    memset(&stats, 0, sizeof(stats));
+    // Settled formations jitter around their slots; allow that much slack
+    solver.setTolerance(FORMATION_SETTLE_TOLERANCE_M);
+}
+
+void FormationController::setShape(FormationShape next) {
+    shape = next;
+    assignmentDirty = true;
+}
+
+void FormationController::setAnchor(const Vec2& position, float headingRad) {
+    anchor = position;
+    heading = headingRad;
+    settledSnapshot = false;
+}
+
+int8_t FormationController::findMember(uint8_t droneId) const {
+    for (uint8_t i = 0; i < memberCount; i++) {
+        if (members[i].active && members[i].droneId == droneId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const FormationMember* FormationController::getMember(uint8_t droneId) const {
+    int8_t index = findMember(droneId);
+    return index >= 0 ? &members[index] : nullptr;
+}
+
+// Offsets in the formation frame: x forward, y to the right
+void FormationController::computeSlotOffsets() {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < memberCount; i++) {
+        if (members[i].active) count++;
+    }
+    slotCount = count;
+
+    uint8_t gridCols = 1;
+    while (gridCols * gridCols < count) gridCols++;
+
+    for (uint8_t i = 0; i < count; i++) {
+        switch (shape) {
+            case FORMATION_LINE:
+                slotOffsets[i] = Vec2(0, (i - (count - 1) * 0.5f) * spacing);
+                break;
+            case FORMATION_WEDGE: {
+                // Apex at the anchor, then alternating left/right down the arms
+                uint8_t rank = (i + 1) / 2;
+                float side = (i % 2) ? -1.0f : 1.0f;
+                slotOffsets[i] = Vec2(-rank * spacing * 0.866f, side * rank * spacing * 0.5f);
+                break;
+            }
+            case FORMATION_GRID:
+            default:
+                slotOffsets[i] = Vec2(-(i / gridCols) * spacing, ((i % gridCols) - (gridCols - 1) * 0.5f) * spacing);
+                break;
+        }
+    }
+}
+
+Vec2 FormationController::getSlotPosition(int8_t slot) const {
+    if (slot < 0 || slot >= slotCount) {
+        return anchor;
+    }
+    Vec2 forward(cosf(heading), sinf(heading));
+    Vec2 right(sinf(heading), -cosf(heading));
+    return anchor + forward * slotOffsets[slot].x + right * slotOffsets[slot].y;
+}
+
+void FormationController::refreshCosts() {
+    for (uint8_t r = 0; r < memberCount; r++) {
+        for (uint8_t s = 0; s < slotCount; s++) {
+            solver.setCost(r, s, members[r].active ? length(getSlotPosition(s) - members[r].position) : 0);
+        }
+    }
+}
+
+void FormationController::assignSlots() {
+    // Members are never compacted, so solver rows line up with member indices
+    computeSlotOffsets();
+    solver.setSize(memberCount, slotCount);
+    for (uint8_t r = 0; r < memberCount; r++) {
+        if (!members[r].active) solver.removeRow(r);
+    }
+    refreshCosts();
+    solver.solve();
+    for (uint8_t r = 0; r < memberCount; r++) {
+        members[r].slot = members[r].active ? solver.getColumn(r) : -1;
+    }
+    stats.fullSolves++;
+    assignmentDirty = false;
+    settledSnapshot = false;
+}
+
+float FormationController::maxSlotError() const {
+    float worst = 0;
+    for (uint8_t i = 0; i < memberCount; i++) {
+        if (!members[i].active) continue;
+        worst = fmaxf(worst, length(getSlotPosition(members[i].slot) - members[i].position));
+    }
+    return worst;
+}
+
+bool FormationController::updateMember(uint8_t droneId, const Vec2& position, const Vec2& velocity, uint32_t now) {
+    int8_t index = findMember(droneId);
+    if (index < 0) {
+        // New member: reuse a lost member's row, otherwise append
+        for (uint8_t i = 0; i < memberCount; i++) {
+            if (!members[i].active) {
+                index = i;
+                break;
+            }
+        }
+        if (index < 0) {
+            if (memberCount >= MAX_FORMATION_MEMBERS) {
+                return false;
+            }
+            index = memberCount++;
+        }
+        members[index].droneId = droneId;
+        members[index].active = true;
+        members[index].slot = -1;
+        assignmentDirty = true;
+        DEBUG_PRINT("[FORMATION] Drone %d joined\n", droneId);
+    }
+
+    members[index].position = position;
+    members[index].velocity = velocity;
+    members[index].lastUpdate = now;
+    return true;
+}
+
+bool FormationController::updateFromHeartbeat(const HeartbeatData& heartbeat, uint32_t now) {
+    PERF_SCOPE(PERF_HANDLER_HEARTBEAT);
+    Vec2 position = plane.toLocal(heartbeat.latitude, heartbeat.longitude);
+
+    // Heartbeats carry no velocity; estimate it from consecutive positions
+    Vec2 velocity;
+    int8_t index = findMember(heartbeat.droneId);
+    if (index >= 0 && now > members[index].lastUpdate) {
+        float dt = (now - members[index].lastUpdate) / 1000.0f;
+        Vec2 measured = (position - members[index].position) / dt;
+        velocity = members[index].velocity * 0.5f + measured * 0.5f;
+    }
+    return updateMember(heartbeat.droneId, position, velocity, now);
+}
+
+bool FormationController::removeMember(uint8_t droneId) {
+    int8_t index = findMember(droneId);
+    if (index < 0) {
+        return false;
+    }
+    members[index].active = false;
+    members[index].slot = -1;
+    DEBUG_PRINT("[FORMATION] Drone %d lost\n", droneId);
+
+    if (assignmentDirty) {
+        return true;    // Full solve is pending anyway
+    }
+
+    // Slots stay put; the repair picks which one becomes the gap
+    refreshCosts();
+    uint32_t fallbacksBefore = solver.getFallbackCount();
+    solver.removeRow(index);
+    if (solver.getFallbackCount() == fallbacksBefore) {
+        stats.incrementalRepairs++;
+    } else {
+        stats.fullSolves++;
+    }
+    for (uint8_t r = 0; r < memberCount; r++) {
+        members[r].slot = members[r].active ? solver.getColumn(r) : -1;
+    }
+    return true;
+}
+
+uint8_t FormationController::expireMembers(uint32_t now, uint32_t timeoutMs) {
+    uint8_t expired = 0;
+    for (uint8_t i = 0; i < memberCount; i++) {
+        if (members[i].active && now - members[i].lastUpdate > timeoutMs) {
+            removeMember(members[i].droneId);
+            expired++;
+        }
+    }
+    return expired;
+}
+
+Vec2 FormationController::preferredVelocity(const FormationMember& m) const {
+    Vec2 toSlot = getSlotPosition(m.slot) - m.position;
+    float distance = length(toSlot);
+    if (distance < 0.01f) {
+        return Vec2();
+    }
+    float speed = fminf(FORMATION_MAX_SPEED_MS, distance * ARRIVAL_GAIN);
+    return toSlot * (speed / distance);
+}
+
+bool FormationController::computeCommand(uint8_t droneId, VelocityCommand& command) {
+    if (assignmentDirty) {
+        assignSlots();
+    }
+    int8_t self = findMember(droneId);
+    if (self < 0 || members[self].slot < 0) {
+        return false;
+    }
+    const FormationMember& me = members[self];
+
+    // Closest neighbours first, capped so the LP stays bounded
+    Vec2 neighborPos[ORCA_MAX_NEIGHBORS];
+    Vec2 neighborVel[ORCA_MAX_NEIGHBORS];
+    float neighborDist[ORCA_MAX_NEIGHBORS];
+    uint8_t neighbors = 0;
+    const float rangeSq = ORCA_NEIGHBOR_DIST_M * ORCA_NEIGHBOR_DIST_M;
+
+    for (uint8_t i = 0; i < memberCount; i++) {
+        if (i == self || !members[i].active) continue;
+        float d = lengthSq(members[i].position - me.position);
+        if (d > rangeSq) continue;
+        if (neighbors == ORCA_MAX_NEIGHBORS && d >= neighborDist[neighbors - 1]) continue;
+
+        uint8_t at = neighbors < ORCA_MAX_NEIGHBORS ? neighbors++ : neighbors - 1;
+        while (at > 0 && neighborDist[at - 1] > d) {
+            neighborDist[at] = neighborDist[at - 1];
+            neighborPos[at] = neighborPos[at - 1];
+            neighborVel[at] = neighborVel[at - 1];
+            at--;
+        }
+        neighborDist[at] = d;
+        neighborPos[at] = members[i].position;
+        neighborVel[at] = members[i].velocity;
+    }
+
+    command.droneId = droneId;
+    command.slot = me.slot;
+    command.target = getSlotPosition(me.slot);
+    command.velocity = orcaVelocity(me.position, me.velocity, preferredVelocity(me), neighborPos, neighborVel,
+                                    neighbors, DRONE_SAFETY_RADIUS_M, FORMATION_MAX_SPEED_MS, ORCA_TIME_HORIZON_S,
+                                    FORMATION_CONTROL_INTERVAL_MS / 1000.0f, &command.avoiding);
+    return true;
+}
+
+uint8_t FormationController::tick(VelocityCommand* commands, uint8_t maxCommands) {
+    PERF_SCOPE(PERF_HANDLER_FORMATION);
+    uint32_t start = controlNowUs();
+
+    if (assignmentDirty) {
+        assignSlots();
+    } else if (!settledSnapshot && maxSlotError() < FORMATION_SETTLE_TOLERANCE_M) {
+        // Once in formation, re-solve on current positions so a later loss
+        // can be repaired incrementally from fresh duals
+        assignSlots();
+        settledSnapshot = true;
+    }
+
+    uint8_t produced = 0;
+    for (uint8_t i = 0; i < memberCount && produced < maxCommands; i++) {
+        if (members[i].active && computeCommand(members[i].droneId, commands[produced])) {
+            produced++;
+        }
+    }
+
+    uint32_t elapsed = controlNowUs() - start;
+    stats.ticks++;
+    stats.lastTickUs = elapsed;
+    if (elapsed > stats.maxTickUs) stats.maxTickUs = elapsed;
+    if (elapsed > FORMATION_TICK_BUDGET_US) stats.budgetOverruns++;
+    return produced;
+}
+
+void FormationController::printStatus() {
+    DEBUG_PRINT("\n=== FORMATION (%d members, %d slots) ===\n", memberCount, slotCount);
+    for (uint8_t i = 0; i < memberCount; i++) {
+        if (!members[i].active) continue;
+        Vec2 slot = getSlotPosition(members[i].slot);
+        DEBUG_PRINT("Drone %d -> slot %d, %.1f m away\n", members[i].droneId, members[i].slot,
+                    length(slot - members[i].position));
+    }
+    DEBUG_PRINT("Assignment cost: %.1f m, solves %lu, repairs %lu\n", solver.totalCost(),
+                (unsigned long)stats.fullSolves, (unsigned long)stats.incrementalRepairs);
+    DEBUG_PRINT("Tick: last %lu us, max %lu us, %lu over budget\n", (unsigned long)stats.lastTickUs,
+                (unsigned long)stats.maxTickUs, (unsigned long)stats.budgetOverruns);
+    DEBUG_PRINT("================================\n\n");
+}
@@ -0,0 +1,57 @@
+#include "../../include/coordination/state_machine.h"
+#include "../../include/utilities/flight_recorder.h"
+
+MissionStateMachine::MissionStateMachine()
+    : state(MISSION_IDLE), stopReason(0), stoppedAt(0), stopHook(nullptr) {}
+
+bool MissionStateMachine::transition(MissionState next) {
+    if (next == MISSION_EMERGENCY_STOP) {
+        return emergencyStop(0, 0);
+    }
+
+    uint8_t current = state.load(std::memory_order_acquire);
+    while (current != MISSION_EMERGENCY_STOP) {
+        // CAS so a stop landing from the radio task mid-transition is never overwritten
+        if (state.compare_exchange_weak(current, next, std::memory_order_acq_rel)) {
+            DEBUG_PRINT("[MISSION] %s -> %s\n", getStateName((MissionState)current), getStateName(next));
+            FLIGHT_RECORD_STATE(current, next, 0);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool IRAM_ATTR MissionStateMachine::emergencyStop(uint8_t reason, uint32_t now) {
+    uint8_t previous = state.exchange(MISSION_EMERGENCY_STOP, std::memory_order_acq_rel);
+    if (previous == MISSION_EMERGENCY_STOP) {
+        return false;
+    }
+    stopReason.store(reason, std::memory_order_relaxed);
+    stoppedAt.store(now, std::memory_order_relaxed);
+    FLIGHT_RECORD_STATE(previous, MISSION_EMERGENCY_STOP, reason);
+    if (stopHook) {
+        stopHook(reason);
+    }
+    return true;
+}
+
+bool MissionStateMachine::clearEmergency() {
+    uint8_t expected = MISSION_EMERGENCY_STOP;
+    if (!state.compare_exchange_strong(expected, MISSION_IDLE, std::memory_order_acq_rel)) {
+        return false;
+    }
+    DEBUG_PRINT("[MISSION] Emergency stop cleared\n");
+    FLIGHT_RECORD_STATE(MISSION_EMERGENCY_STOP, MISSION_IDLE, 0);
+    return true;
+}
+
+const char* MissionStateMachine::getStateName(MissionState s) {
+    switch (s) {
+        case MISSION_IDLE: return "IDLE";
+        case MISSION_ACTIVE: return "ACTIVE";
+        case MISSION_LISTENING: return "LISTENING";
+        case MISSION_RETURNING: return "RETURNING";
+        case MISSION_EMERGENCY_STOP: return "EMERGENCY_STOP";
+        default: return "UNKNOWN";
+    }
+}
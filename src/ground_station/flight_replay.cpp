@@ -0,0 +1,210 @@
+#ifndef ARDUINO
+
+#include "../../include/ground_station/flight_replay.h"
+#include <DroneProtocols.h>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool flightEventFrame(const FlightEvent& event, DroneMessage& msg, int16_t* rssi, float* snr) {
+    uint8_t skip;
+    if (event.kind == FLIGHT_TX) {
+        skip = 0;
+    } else if (event.kind == FLIGHT_RX) {
+        skip = sizeof(FlightRxRecord);
+    } else {
+        return false;
+    }
+    if (event.length < skip + FLIGHT_FRAME_HEADER_BYTES) {
+        return false;
+    }
+    uint8_t frameBytes = event.length - skip;
+    memset(&msg, 0, sizeof(msg));
+    memcpy(&msg, event.body + skip, frameBytes);
+    if (msg.dataLength != frameBytes - FLIGHT_FRAME_HEADER_BYTES) {
+        return false;
+    }
+    msg.checksum = droneMessageChecksum(msg);
+    if (skip) {
+        FlightRxRecord rx;
+        memcpy(&rx, event.body, sizeof(rx));
+        if (rssi) {
+            *rssi = rx.rssi;
+        }
+        if (snr) {
+            *snr = rx.snrQuarterDb / 4.0f;
+        }
+    }
+    return true;
+}
+
+FlightLog::FlightLog() : image(nullptr), length(0), mapping(nullptr), mappedLength(0) {}
+
+FlightLog::~FlightLog() {
+    close();
+}
+
+bool FlightLog::open(const char* path) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)FLIGHT_SECTOR_BYTES) {
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    // One pass front to back per sector
+    madvise(mapped, (size_t)info.st_size, MADV_SEQUENTIAL);
+    mapping = mapped;
+    mappedLength = (size_t)info.st_size;
+    image = (const uint8_t*)mapped;
+    length = mappedLength;
+    index();
+    return true;
+}
+
+void FlightLog::attach(const uint8_t* dump, size_t dumpLength) {
+    close();
+    image = dump;
+    length = dumpLength;
+    index();
+}
+
+void FlightLog::close() {
+    if (mapping) {
+        munmap(mapping, mappedLength);
+    }
+    mapping = nullptr;
+    mappedLength = 0;
+    image = nullptr;
+    length = 0;
+    order.clear();
+}
+
+void FlightLog::index() {
+    order.clear();
+    uint32_t sectors = (uint32_t)(length / FLIGHT_SECTOR_BYTES);
+    for (uint32_t i = 0; i < sectors; i++) {
+        FlightSectorHeader header;
+        if (flightParseSectorHeader(image + (size_t)i * FLIGHT_SECTOR_BYTES, header) &&
+            header.sequence % sectors == i) {
+            order.push_back({header.sequence, i * FLIGHT_SECTOR_BYTES});
+        }
+    }
+    std::sort(order.begin(), order.end(), [](const SectorRef& a, const SectorRef& b) {
+        return a.sequence < b.sequence;
+    });
+}
+
+FlightReplayStats FlightLog::forEach(FlightEventHandler handler, void* context) const {
+    return forEach(handler, context, 0, (uint32_t)order.size());
+}
+
+FlightReplayStats FlightLog::forEach(FlightEventHandler handler, void* context, uint32_t first, uint32_t count) const {
+    FlightReplayStats stats;
+    memset(&stats, 0, sizeof(stats));
+    size_t last = std::min<size_t>(order.size(), (size_t)first + count);
+    stats.sectors = last > first ? (uint32_t)(last - first) : 0;
+
+    for (size_t s = first; s < last; s++) {
+        if (s > first) {
+            stats.sequenceGaps += order[s].sequence - order[s - 1].sequence - 1;
+        }
+        const uint8_t* sector = image + order[s].offset;
+        FlightSectorHeader header;
+        flightParseSectorHeader(sector, header);
+
+        FlightEvent event;
+        event.sector = header.sequence;
+        event.timeMs = header.baseMs;
+        uint32_t at = sizeof(FlightSectorHeader);
+        FlightRecordView view;
+        int used;
+        while ((used = flightParseRecord(sector + at, FLIGHT_SECTOR_BYTES - at, view)) > 0) {
+            at += used;
+            event.kind = view.kind;
+            event.length = view.length;
+            event.body = view.body;
+            event.timeMs += view.deltaMs;
+            switch (view.kind) {
+                case FLIGHT_BOOT:
+                    if (view.length < sizeof(FlightBootRecord)) {
+                        stats.malformed++;
+                        continue;
+                    }
+                    FlightBootRecord boot;
+                    memcpy(&boot, view.body, sizeof(boot));
+                    event.timeMs = boot.clockMs;
+                    stats.boots++;
+                    break;
+                case FLIGHT_TX: stats.txFrames++; break;
+                case FLIGHT_RX: stats.rxFrames++; break;
+                case FLIGHT_STATE: stats.states++; break;
+                case FLIGHT_TIMER: stats.timers++; break;
+                default: break;
+            }
+            stats.events++;
+            if (handler) {
+                handler(event, context);
+            }
+        }
+    }
+    return stats;
+}
+
+struct ReplayContext {
+    MessageRegistry* registry;
+    FlightEventHandler handler;
+    void* context;
+    uint32_t dispatched;
+    uint32_t rejected;
+    uint32_t malformed;
+};
+
+static void replayEvent(const FlightEvent& event, void* raw) {
+    ReplayContext* replay = (ReplayContext*)raw;
+    if (event.kind == FLIGHT_RX) {
+        DroneMessage msg;
+        if (!flightEventFrame(event, msg)) {
+            replay->malformed++;
+        } else if (replay->registry->dispatch(msg) == DISPATCH_OK) {
+            replay->dispatched++;
+        } else {
+            replay->rejected++;
+        }
+    }
+    if (replay->handler) {
+        replay->handler(event, replay->context);
+    }
+}
+
+FlightReplayStats FlightLog::replay(MessageRegistry& registry, FlightEventHandler handler, void* context) const {
+    ReplayContext replay = {&registry, handler, context, 0, 0, 0};
+    FlightReplayStats stats = forEach(replayEvent, &replay);
+    stats.dispatched = replay.dispatched;
+    stats.rejected = replay.rejected;
+    stats.malformed += replay.malformed;
+    return stats;
+}
+
+const char* FlightLog::getKindName(uint8_t kind) {
+    switch (kind) {
+        case FLIGHT_BOOT: return "BOOT";
+        case FLIGHT_TX: return "TX";
+        case FLIGHT_RX: return "RX";
+        case FLIGHT_STATE: return "STATE";
+        case FLIGHT_TIMER: return "TIMER";
+        default: return "UNKNOWN";
+    }
+}
+
+#endif // ARDUINO
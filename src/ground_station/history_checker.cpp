@@ -0,0 +1,598 @@
+#ifndef ARDUINO
+
+#include "../../include/ground_station/history_checker.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+HistoryCheckerOptions historyCheckerDefaults() {
+    HistoryCheckerOptions options;
+    options.threads = 0;
+    options.maxStepsPerKey = 200000000ull;
+    options.initialValue = 0;
+    return options;
+}
+
+// ===== Sequential models =====
+
+static bool step(int64_t state, const HistoryOp& op, int64_t& next) {
+    switch (op.kind) {
+        case HISTORY_READ:
+            next = state;
+            return !op.known || op.output == state;
+        case HISTORY_WRITE:
+            next = op.input;
+            return true;
+        case HISTORY_CAS: {
+            bool swap = state == op.expected;
+            if (op.known && (op.output != 0) != swap) {
+                return false;
+            }
+            next = swap ? op.input : state;
+            return true;
+        }
+        case HISTORY_ACQUIRE:
+            // State is the holder + 1, 0 when free
+            next = (int64_t)op.client + 1;
+            return state == 0;
+        case HISTORY_RELEASE:
+            next = 0;
+            return state == (int64_t)op.client + 1;
+        default:
+            return false;
+    }
+}
+
+// ===== Memo of visited (linearized set, state) =====
+
+// Keys live back to back in one arena; open addressing over their offsets
+class VisitedSet {
+private:
+    struct Slot {
+        uint32_t offset;        // Into arena, + 1; 0 = empty
+        uint32_t tag;           // High half of the hash
+    };
+    std::vector<uint64_t> arena;        // Per key: length, then the words
+    std::vector<Slot> slots;
+    size_t count;
+
+    static uint64_t hashOf(const uint64_t* words, uint32_t length) {
+        uint64_t h = 0x9E3779B97F4A7C15ull ^ length;
+        for (uint32_t i = 0; i < length; i++) {
+            h = (h ^ words[i]) * 0xFF51AFD7ED558CCDull;
+            h ^= h >> 32;
+        }
+        return h;
+    }
+
+    void grow() {
+        std::vector<Slot> old;
+        old.swap(slots);
+        slots.assign(old.empty() ? 1024 : old.size() * 2, Slot());
+        size_t mask = slots.size() - 1;
+        for (const Slot& slot : old) {
+            if (!slot.offset) continue;
+            const uint64_t* key = &arena[slot.offset - 1];
+            uint64_t h = hashOf(key + 1, (uint32_t)key[0]);
+            size_t i = (size_t)h & mask;
+            while (slots[i].offset) i = (i + 1) & mask;
+            slots[i] = slot;
+        }
+    }
+
+public:
+    VisitedSet() : count(0) { grow(); }
+
+    // False if it was already there
+    bool insert(const uint64_t* words, uint32_t length) {
+        if ((count + 1) * 2 > slots.size()) {
+            grow();
+        }
+        uint64_t h = hashOf(words, length);
+        uint32_t tag = (uint32_t)(h >> 32);
+        size_t mask = slots.size() - 1;
+        for (size_t i = (size_t)h & mask;; i = (i + 1) & mask) {
+            Slot& slot = slots[i];
+            if (!slot.offset) {
+                slot.offset = (uint32_t)arena.size() + 1;
+                slot.tag = tag;
+                arena.push_back(length);
+                arena.insert(arena.end(), words, words + length);
+                count++;
+                return true;
+            }
+            const uint64_t* key = &arena[slot.offset - 1];
+            if (slot.tag == tag && key[0] == length && memcmp(key + 1, words, length * sizeof(uint64_t)) == 0) {
+                return false;
+            }
+        }
+    }
+};
+
+// ===== Wing-Gong-Lowe search over one key =====
+
+struct Partition {
+    uint32_t key;
+    std::vector<uint32_t> ops;          // Into the history, by call time
+};
+
+static HistoryKeyResult checkPartition(const std::vector<HistoryOp>& history, const Partition& part,
+                                       const HistoryCheckerOptions& options) {
+    HistoryKeyResult result;
+    memset(&result, 0, sizeof(result));
+    result.key = part.key;
+    result.verdict = HISTORY_OK;
+    uint32_t n = (uint32_t)part.ops.size();
+    result.operations = n;
+
+    // Entry 2i calls op i, 2i + 1 is its response; calls first on equal
+    // times, so touching intervals count as concurrent
+    std::vector<uint32_t> order(2 * n);
+    for (uint32_t e = 0; e < 2 * n; e++) {
+        order[e] = e;
+    }
+    auto timeOf = [&](uint32_t e) {
+        const HistoryOp& op = history[part.ops[e >> 1]];
+        return e & 1 ? op.ret : op.call;
+    };
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        HybridTime ta = timeOf(a), tb = timeOf(b);
+        if (ta != tb) return ta < tb;
+        if ((a & 1) != (b & 1)) return (a & 1) < (b & 1);
+        return a < b;
+    });
+    const uint32_t head = 2 * n, tail = 2 * n + 1;
+    std::vector<uint32_t> next(2 * n + 2), prev(2 * n + 2);
+    uint32_t last = head;
+    for (uint32_t e : order) {
+        next[last] = e;
+        prev[e] = last;
+        last = e;
+    }
+    next[last] = tail;
+    prev[tail] = last;
+
+    auto lift = [&](uint32_t call) {
+        next[prev[call]] = next[call];
+        prev[next[call]] = prev[call];
+        uint32_t ret = call + 1;
+        next[prev[ret]] = next[ret];
+        prev[next[ret]] = prev[ret];
+    };
+    auto unlift = [&](uint32_t call) {
+        uint32_t ret = call + 1;
+        next[prev[ret]] = ret;
+        prev[next[ret]] = ret;
+        next[prev[call]] = call;
+        prev[next[call]] = call;
+    };
+
+    // Operations without a response may stay out of the linearization
+    uint32_t remaining = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        remaining += history[part.ops[i]].ret != HYBRID_PENDING;
+    }
+
+    struct Frame {
+        uint32_t entry;
+        uint32_t high;
+        uint32_t first;
+        int64_t state;
+    };
+    std::vector<Frame> stack;
+    std::vector<uint64_t> linearized((n + 63) / 64 + 1, 0);
+    std::vector<uint64_t> key;
+    VisitedSet visited;
+    int64_t state = options.initialValue;
+    uint32_t first = 0;         // Lowest op not linearized
+    uint32_t high = 0;          // Highest linearized, when any is
+    uint32_t entry = next[head];
+
+    while (remaining > 0) {
+        if (++result.steps > options.maxStepsPerKey) {
+            result.verdict = HISTORY_UNDECIDED;
+            break;
+        }
+        uint32_t op = entry >> 1;
+        const HistoryOp& operation = history[part.ops[op]];
+        if (!(entry & 1)) {
+            int64_t nextState;
+            if (step(state, operation, nextState)) {
+                linearized[op >> 6] |= 1ull << (op & 63);
+                uint32_t oldFirst = first;
+                while (first < n && (linearized[first >> 6] >> (first & 63) & 1)) {
+                    first++;
+                }
+                uint32_t newHigh = stack.empty() ? op : std::max(high, op);
+                // Everything below `first` is linearized: only the words from there on tell sets apart
+                key.clear();
+                key.push_back((uint64_t)nextState);
+                key.push_back(first);
+                for (uint32_t w = first >> 6; first <= newHigh && w <= newHigh >> 6; w++) {
+                    key.push_back(linearized[w]);
+                }
+                if (visited.insert(key.data(), (uint32_t)key.size())) {
+                    stack.push_back({entry, high, oldFirst, state});
+                    state = nextState;
+                    high = newHigh;
+                    lift(entry);
+                    remaining -= operation.ret != HYBRID_PENDING;
+                    entry = next[head];
+                    continue;
+                }
+                linearized[op >> 6] &= ~(1ull << (op & 63));
+                first = oldFirst;
+            }
+            entry = next[entry];
+        } else {
+            // A response whose operation is not linearized yet: undo the last choice
+            if (stack.size() >= result.linearized) {
+                result.linearized = (uint32_t)stack.size();
+                result.blockingOp = part.ops[op];
+            }
+            if (stack.empty()) {
+                result.verdict = HISTORY_VIOLATION;
+                break;
+            }
+            Frame frame = stack.back();
+            stack.pop_back();
+            uint32_t undone = frame.entry >> 1;
+            linearized[undone >> 6] &= ~(1ull << (undone & 63));
+            state = frame.state;
+            high = frame.high;
+            first = frame.first;
+            unlift(frame.entry);
+            remaining += history[part.ops[undone]].ret != HYBRID_PENDING;
+            entry = next[frame.entry];
+        }
+    }
+    if (result.verdict == HISTORY_OK) {
+        result.linearized = (uint32_t)stack.size();
+    }
+    return result;
+}
+
+HistoryCheck checkLinearizable(const std::vector<HistoryOp>& history, const HistoryCheckerOptions& options) {
+    auto started = std::chrono::steady_clock::now();
+    HistoryCheck check;
+    check.verdict = HISTORY_OK;
+    check.operations = (uint32_t)history.size();
+    check.violations = check.undecided = 0;
+    check.steps = 0;
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    check.threads = (uint8_t)std::min(255u, threads);
+
+    // Independent keys, each by call time
+    std::vector<uint32_t> byKey(history.size());
+    for (uint32_t i = 0; i < byKey.size(); i++) {
+        byKey[i] = i;
+    }
+    std::sort(byKey.begin(), byKey.end(), [&](uint32_t a, uint32_t b) {
+        const HistoryOp& x = history[a];
+        const HistoryOp& y = history[b];
+        if (x.key != y.key) return x.key < y.key;
+        if (x.call != y.call) return x.call < y.call;
+        return a < b;
+    });
+    std::vector<Partition> partitions;
+    for (uint32_t i = 0; i < byKey.size(); i++) {
+        uint32_t key = history[byKey[i]].key;
+        if (partitions.empty() || partitions.back().key != key) {
+            partitions.push_back({key, {}});
+        }
+        partitions.back().ops.push_back(byKey[i]);
+    }
+    check.keys = (uint32_t)partitions.size();
+    // Largest first, so one long key does not start last
+    std::vector<uint32_t> schedule(partitions.size());
+    for (uint32_t i = 0; i < schedule.size(); i++) {
+        schedule[i] = i;
+    }
+    std::stable_sort(schedule.begin(), schedule.end(), [&](uint32_t a, uint32_t b) {
+        return partitions[a].ops.size() > partitions[b].ops.size();
+    });
+
+    std::vector<HistoryKeyResult> results(partitions.size());
+    std::atomic<size_t> nextPartition(0);
+    auto worker = [&]() {
+        for (size_t i; (i = nextPartition.fetch_add(1)) < schedule.size();) {
+            results[schedule[i]] = checkPartition(history, partitions[schedule[i]], options);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads && t < schedule.size(); t++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+
+    for (const HistoryKeyResult& result : results) {
+        check.steps += result.steps;
+        if (result.verdict == HISTORY_OK) continue;
+        check.failures.push_back(result);
+        if (result.verdict == HISTORY_VIOLATION) {
+            check.violations++;
+            check.verdict = HISTORY_VIOLATION;
+        } else {
+            check.undecided++;
+            if (check.verdict == HISTORY_OK) check.verdict = HISTORY_UNDECIDED;
+        }
+    }
+    check.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return check;
+}
+
+// ===== Mutual exclusion =====
+
+std::vector<MutexViolation> checkMutualExclusion(const std::vector<HistoryOp>& history) {
+    std::vector<uint32_t> lockOps;
+    for (uint32_t i = 0; i < history.size(); i++) {
+        if (history[i].kind == HISTORY_ACQUIRE || history[i].kind == HISTORY_RELEASE) {
+            lockOps.push_back(i);
+        }
+    }
+    std::sort(lockOps.begin(), lockOps.end(), [&](uint32_t a, uint32_t b) {
+        const HistoryOp& x = history[a];
+        const HistoryOp& y = history[b];
+        if (x.key != y.key) return x.key < y.key;
+        if (x.client != y.client) return x.client < y.client;
+        if (x.call != y.call) return x.call < y.call;
+        return a < b;
+    });
+
+    // Granted acquire to the client's next release call; never released: to the end
+    struct Hold {
+        uint32_t key;
+        uint32_t acquire;
+        HybridTime from;
+        HybridTime to;
+    };
+    std::vector<Hold> holds;
+    for (size_t i = 0; i < lockOps.size(); i++) {
+        const HistoryOp& op = history[lockOps[i]];
+        if (op.kind != HISTORY_ACQUIRE || op.ret == HYBRID_PENDING) {
+            continue;
+        }
+        HybridTime to = HYBRID_PENDING;
+        for (size_t j = i + 1; j < lockOps.size(); j++) {
+            const HistoryOp& other = history[lockOps[j]];
+            if (other.key != op.key || other.client != op.client) break;
+            if (other.kind == HISTORY_RELEASE) {
+                to = other.call;
+                break;
+            }
+        }
+        holds.push_back({op.key, lockOps[i], op.ret, to});
+    }
+    std::sort(holds.begin(), holds.end(), [](const Hold& a, const Hold& b) {
+        return a.key != b.key ? a.key < b.key : a.from < b.from;
+    });
+
+    std::vector<MutexViolation> violations;
+    for (size_t i = 0; i < holds.size();) {
+        size_t open = i;
+        for (size_t j = i + 1; j < holds.size() && holds[j].key == holds[i].key; j++) {
+            const Hold& a = holds[open];
+            const Hold& b = holds[j];
+            if (b.from < a.to && history[a.acquire].client != history[b.acquire].client) {
+                violations.push_back({a.key, a.acquire, b.acquire, b.from, std::min(a.to, b.to)});
+            }
+            if (b.to > a.to) {
+                open = j;
+            }
+        }
+        uint32_t key = holds[i].key;
+        while (i < holds.size() && holds[i].key == key) {
+            i++;
+        }
+    }
+    return violations;
+}
+
+// ===== Recording =====
+
+uint32_t HistoryRecorder::invoke(uint16_t client, uint32_t key, uint8_t kind, int64_t input, int64_t expected,
+                                 HybridTime now) {
+    HistoryOp op;
+    memset(&op, 0, sizeof(op));
+    op.call = now;
+    op.ret = HYBRID_PENDING;
+    op.key = key;
+    op.client = client;
+    op.kind = kind;
+    op.known = false;
+    op.input = input;
+    op.expected = expected;
+    ops.push_back(op);
+    return (uint32_t)ops.size() - 1;
+}
+
+void HistoryRecorder::complete(uint32_t id, int64_t output, HybridTime now) {
+    if (id >= ops.size()) {
+        return;
+    }
+    ops[id].ret = now;
+    ops[id].output = output;
+    ops[id].known = true;
+}
+
+// ===== Text files =====
+
+static const char* const KIND_NAMES[] = {"", "read", "write", "cas", "acquire", "release"};
+
+static bool parseTime(const char* text, HybridTime& time) {
+    if (strcmp(text, "-") == 0) {
+        time = HYBRID_PENDING;
+        return true;
+    }
+    char* end;
+    uint64_t physical = strtoull(text, &end, 10);
+    uint64_t logical = 0;
+    if (*end == '.') {
+        logical = strtoull(end + 1, &end, 10);
+    }
+    time = hybridTime(physical, (uint16_t)logical);
+    return *end == '\0' && end != text && logical <= 0xFFFF;
+}
+
+static bool parseValue(const char* text, int64_t& value, bool* known) {
+    if (known && strcmp(text, "?") == 0) {
+        *known = false;
+        return true;
+    }
+    char* end;
+    value = strtoll(text, &end, 10);
+    return *end == '\0' && end != text;
+}
+
+bool loadHistory(const char* path, std::vector<HistoryOp>& out, std::string* error) {
+    FILE* in = fopen(path, "r");
+    if (!in) {
+        if (error) *error = std::string("cannot open ") + path;
+        return false;
+    }
+    char line[256];
+    uint32_t number = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), in)) {
+        number++;
+        char* fields[9];
+        int count = 0;
+        for (char* token = strtok(line, " \t\r\n"); token && count < 9; token = strtok(nullptr, " \t\r\n")) {
+            if (token[0] == '#') break;
+            fields[count++] = token;
+        }
+        if (count == 0) continue;
+
+        HistoryOp op;
+        memset(&op, 0, sizeof(op));
+        op.known = true;
+        uint8_t kind = 0;
+        for (uint8_t k = HISTORY_READ; k <= HISTORY_RELEASE && count >= 5; k++) {
+            if (strcmp(fields[4], KIND_NAMES[k]) == 0) kind = k;
+        }
+        static const int FIELDS[] = {0, 6, 6, 8, 5, 5};
+        ok = kind && count == FIELDS[kind] && parseTime(fields[0], op.call) && parseTime(fields[1], op.ret) &&
+             op.call != HYBRID_PENDING;
+        if (ok) {
+            op.kind = kind;
+            op.client = (uint16_t)strtoul(fields[2], nullptr, 10);
+            op.key = (uint32_t)strtoul(fields[3], nullptr, 10);
+            if (kind == HISTORY_READ) {
+                ok = parseValue(fields[5], op.output, &op.known);
+            } else if (kind == HISTORY_WRITE) {
+                ok = parseValue(fields[5], op.input, nullptr);
+            } else if (kind == HISTORY_CAS) {
+                ok = parseValue(fields[5], op.input, nullptr) && parseValue(fields[6], op.expected, nullptr) &&
+                     parseValue(fields[7], op.output, &op.known);
+            }
+            op.known = op.known && op.ret != HYBRID_PENDING;
+        }
+        if (ok) {
+            out.push_back(op);
+        } else if (error) {
+            *error = std::string(path) + ":" + std::to_string(number) + ": malformed operation";
+        }
+    }
+    fclose(in);
+    return ok;
+}
+
+static void printTime(FILE* out, HybridTime time) {
+    if (time == HYBRID_PENDING) {
+        fputs("-", out);
+    } else {
+        fprintf(out, "%llu.%u", (unsigned long long)(time >> 16), (unsigned)(time & 0xFFFF));
+    }
+}
+
+bool saveHistory(const char* path, const std::vector<HistoryOp>& history) {
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        return false;
+    }
+    fputs("# call return client key op args\n", out);
+    for (const HistoryOp& op : history) {
+        printTime(out, op.call);
+        fputc(' ', out);
+        printTime(out, op.ret);
+        fprintf(out, " %u %u %s", op.client, op.key, op.kind <= HISTORY_RELEASE ? KIND_NAMES[op.kind] : "?");
+        if (op.kind == HISTORY_READ) {
+            op.known ? fprintf(out, " %lld", (long long)op.output) : fputs(" ?", out);
+        } else if (op.kind == HISTORY_WRITE) {
+            fprintf(out, " %lld", (long long)op.input);
+        } else if (op.kind == HISTORY_CAS) {
+            fprintf(out, " %lld %lld", (long long)op.input, (long long)op.expected);
+            op.known ? fprintf(out, " %d", op.output ? 1 : 0) : fputs(" ?", out);
+        }
+        fputc('\n', out);
+    }
+    return fclose(out) == 0;
+}
+
+// ===== Synthetic histories =====
+
+void synthesizeHistory(uint32_t operations, uint16_t clients, uint32_t keys, uint32_t seed,
+                       std::vector<HistoryOp>& out) {
+    std::mt19937 rng(seed);
+    clients = std::max<uint16_t>(1, clients);
+    keys = std::max<uint32_t>(1, keys);
+    std::vector<uint64_t> clientTime(clients);
+    for (uint64_t& t : clientTime) {
+        t = rng() % 100;
+    }
+    std::vector<uint64_t> effectAt(operations);
+    size_t base = out.size();
+    for (uint32_t i = 0; i < operations; i++) {
+        uint16_t client = (uint16_t)(i % clients);
+        HistoryOp op;
+        memset(&op, 0, sizeof(op));
+        uint64_t call = clientTime[client] + rng() % 50;
+        uint64_t duration = 1 + rng() % 100;
+        op.call = hybridTime(call, 0);
+        op.ret = hybridTime(call + duration, 0);
+        clientTime[client] = call + duration;
+        effectAt[i] = call + rng() % (duration + 1);
+        op.client = client;
+        op.key = rng() % keys;
+        uint32_t pick = rng() % 10;
+        op.kind = pick < 5 ? HISTORY_READ : pick < 9 ? HISTORY_WRITE : HISTORY_CAS;
+        op.known = true;
+        out.push_back(op);
+    }
+
+    // Outputs from applying them in effect order
+    std::vector<uint32_t> order(operations);
+    for (uint32_t i = 0; i < operations; i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return effectAt[a] != effectAt[b] ? effectAt[a] < effectAt[b] : a < b;
+    });
+    std::vector<int64_t> value(keys, 0);
+    int64_t nextValue = 1;
+    for (uint32_t i : order) {
+        HistoryOp& op = out[base + i];
+        int64_t& current = value[op.key];
+        if (op.kind == HISTORY_READ) {
+            op.output = current;
+        } else if (op.kind == HISTORY_WRITE) {
+            op.input = nextValue++;
+            current = op.input;
+        } else {
+            op.input = nextValue++;
+            op.expected = rng() % 2 ? current : current + 1000000007;
+            op.output = op.expected == current;
+            if (op.output) current = op.input;
+        }
+    }
+}
+
+#endif // ARDUINO
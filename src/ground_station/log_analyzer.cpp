@@ -0,0 +1,1254 @@
+#ifndef ARDUINO
+
+#include "../../include/ground_station/log_analyzer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOG_DAY_MS 86400000u
+#define LOG_METERS_PER_DEGREE 111320.0
+#define LOG_LOOKAROUND_LINES 4      // Other output may land between a frame's two lines
+
+LogAnalyzerOptions logAnalyzerDefaults() {
+    LogAnalyzerOptions options;
+    options.threads = 0;
+    options.chunkBytes = 4u << 20;
+    options.sectorsPerChunk = 256;
+    options.chunksPerWave = 8;
+    return options;
+}
+
+// job(i) for every i below count, spread over `threads` threads
+template <typename Job>
+static void parallelFor(uint8_t threads, size_t count, const Job& job) {
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i; (i = next.fetch_add(1)) < count;) {
+            job(i);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads && t < count; t++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// ===== Capture lines =====
+
+// The literal at p, or null
+template <size_t N>
+static inline const char* expect(const char* p, const char* end, const char (&literal)[N]) {
+    return p && end - p >= (ptrdiff_t)(N - 1) && memcmp(p, literal, N - 1) == 0 ? p + N - 1 : nullptr;
+}
+
+static inline const char* parseUnsigned(const char* p, const char* end, uint32_t& value) {
+    if (!p || p >= end || *p < '0' || *p > '9') {
+        return nullptr;
+    }
+    value = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = value * 10 + (uint32_t)(*p++ - '0');
+    }
+    return p;
+}
+
+static inline const char* parseSigned(const char* p, const char* end, int32_t& value) {
+    bool negative = p && p < end && *p == '-';
+    uint32_t magnitude;
+    p = parseUnsigned(negative ? p + 1 : p, end, magnitude);
+    value = negative ? -(int32_t)magnitude : (int32_t)magnitude;
+    return p;
+}
+
+static inline const char* parseHexByte(const char* p, const char* end, uint8_t& value) {
+    value = 0;
+    const char* start = p;
+    while (p && p < end && p - start < 2) {
+        char c = *p;
+        uint8_t digit = c >= '0' && c <= '9' ? c - '0' : c >= 'A' && c <= 'F' ? c - 'A' + 10 :
+                        c >= 'a' && c <= 'f' ? c - 'a' + 10 : 0xFF;
+        if (digit == 0xFF) {
+            break;
+        }
+        value = (uint8_t)(value << 4 | digit);
+        p++;
+    }
+    return p && p > start ? p : nullptr;
+}
+
+// "-12.345678" as value * 10^digits, extra digits dropped, no locale
+static const char* parseFixed(const char* p, const char* end, uint8_t digits, int32_t& value) {
+    bool negative = p && p < end && *p == '-';
+    uint32_t whole;
+    p = parseUnsigned(negative ? p + 1 : p, end, whole);
+    if (!p) {
+        return nullptr;
+    }
+    int64_t fixed = whole;
+    uint8_t used = 0;
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (used < digits) {
+                fixed = fixed * 10 + (*p - '0');
+                used++;
+            }
+            p++;
+        }
+    }
+    for (; used < digits; used++) {
+        fixed *= 10;
+    }
+    value = (int32_t)(negative ? -fixed : fixed);
+    return p;
+}
+
+static inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// "HH:MM:SS.mmm > " from pio device monitor --filter time
+static const char* parseClock(const char* p, const char* end, uint32_t& ms) {
+    if (end - p < 15 || p[2] != ':' || p[5] != ':' || p[8] != '.' || p[12] != ' ' || p[13] != '>' ||
+        p[14] != ' ') {
+        return nullptr;
+    }
+    static const uint8_t digitAt[] = {0, 1, 3, 4, 6, 7, 9, 10, 11};
+    for (uint8_t i : digitAt) {
+        if (!isDigit(p[i])) {
+            return nullptr;
+        }
+    }
+    uint32_t hours = (p[0] - '0') * 10 + (p[1] - '0');
+    uint32_t minutes = (p[3] - '0') * 10 + (p[4] - '0');
+    uint32_t seconds = (p[6] - '0') * 10 + (p[7] - '0');
+    uint32_t millis = (p[9] - '0') * 100 + (p[10] - '0') * 10 + (p[11] - '0');
+    ms = ((hours * 60 + minutes) * 60 + seconds) * 1000 + millis;
+    return p + 15;
+}
+
+static inline const char* lineEnd(const char* line, const char* end) {
+    const char* eol = (const char*)memchr(line, '\n', end - line);
+    return eol ? eol : end;
+}
+
+static inline const char* previousLine(const char* data, const char* line) {
+    if (line <= data) {
+        return nullptr;
+    }
+    const char* eol = line - 1;
+    const char* start = eol > data ? (const char*)memrchr(data, '\n', eol - data) : nullptr;
+    return start ? start + 1 : data;
+}
+
+// The text after the time prefix, if any
+static inline const char* lineBody(const char* line, const char* eol) {
+    uint32_t ms;
+    const char* body = parseClock(line, eol, ms);
+    return body ? body : line;
+}
+
+static void parseLine(const char* data, const char* end, const char* line, const char* eol,
+                      std::vector<LogEvent>& out) {
+    LogEvent event;
+    memset(&event, 0, sizeof(event));
+    const char* p = parseClock(line, eol, event.timeMs);
+    if (p) {
+        event.flags |= LOG_FLAG_TIME;
+    } else {
+        p = line;
+    }
+    if (eol - p < 6 || *p != '[') {
+        return;
+    }
+
+    const char* q;
+    if ((q = expect(p, eol, "[COMM] "))) {
+        const char* r;
+        uint32_t value;
+        if ((r = expect(q, eol, "Message received from drone "))) {
+            uint32_t source;
+            r = parseUnsigned(r, eol, source);
+            r = parseHexByte(expect(r, eol, " (type: 0x"), eol, event.type);
+            r = parseUnsigned(expect(r, eol, ", seq: "), eol, value);
+            if (!r) {
+                return;
+            }
+            event.kind = LOG_RX;
+            event.node = (uint8_t)source;
+            event.sequence = (uint16_t)value;
+            const char* next = eol;
+            for (uint8_t i = 0; i < LOG_LOOKAROUND_LINES && next < end; i++) {
+                const char* nextEol = lineEnd(next + 1, end);
+                const char* s = expect(lineBody(next + 1, nextEol), nextEol, "[COMM] Signal: RSSI=");
+                int32_t rssi, snrTenths;
+                if (s && (s = parseSigned(s, nextEol, rssi)) &&
+                    (s = parseFixed(expect(s, nextEol, " dBm, SNR="), nextEol, 1, snrTenths))) {
+                    event.rssi = (int16_t)rssi;
+                    event.snrQuarterDb = (int8_t)lroundf(snrTenths * 0.4f);
+                    event.flags |= LOG_FLAG_SIGNAL;
+                    break;
+                }
+                next = nextEol;
+            }
+        } else if ((r = expect(q, eol, "Message sent successfully (seq: ")) && parseUnsigned(r, eol, value)) {
+            // Type and destination are on the "Sending" line before it
+            const char* before = line;
+            for (uint8_t i = 0; i < LOG_LOOKAROUND_LINES && (before = previousLine(data, before)); i++) {
+                const char* beforeEol = lineEnd(before, end);
+                uint32_t destination;
+                const char* s = parseHexByte(expect(lineBody(before, beforeEol), beforeEol,
+                                                    "[COMM] Sending message type 0x"), beforeEol, event.type);
+                if (s && parseUnsigned(expect(s, beforeEol, " to drone "), beforeEol, destination)) {
+                    event.kind = LOG_TX;
+                    event.destination = (uint8_t)destination;
+                    event.sequence = (uint16_t)value;
+                    break;
+                }
+            }
+            if (event.kind != LOG_TX) {
+                return;
+            }
+        } else if ((r = expect(q, eol, "Node ID: ")) && parseUnsigned(r, eol, value)) {
+            event.kind = LOG_BOOT;
+            event.node = (uint8_t)value;
+        } else if (expect(q, eol, "WARNING: Rejected frame") || expect(q, eol, "ERROR: Message checksum")) {
+            event.kind = LOG_REJECTED;
+        } else if (expect(q, eol, "ERROR: Channel busy") || expect(q, eol, "ERROR: Failed to send")) {
+            event.kind = LOG_DROPPED;
+        } else {
+            return;
+        }
+    } else if ((q = expect(p, eol, "[TX]")) || (q = expect(p, eol, "[RX]"))) {
+        bool own = p[1] == 'T';
+        while (q < eol && *q == ' ') {
+            q++;
+        }
+        const char* r = parseFixed(expect(q, eol, "Location: ("), eol, 7, event.latE7);
+        if (!parseFixed(expect(r, eol, ", "), eol, 7, event.lonE7)) {
+            return;
+        }
+        event.kind = own ? LOG_POSITION : LOG_PEER_POSITION;
+    } else {
+        return;
+    }
+    out.push_back(event);
+}
+
+uint64_t parseLogText(const char* data, const char* end, const char* from, const char* to,
+                      std::vector<LogEvent>& out) {
+    uint64_t lines = 0;
+    for (const char* line = from; line < to;) {
+        const char* eol = lineEnd(line, end);
+        lines++;
+        // Cheap reject: every line of interest has a tag in its first 16 bytes
+        const char* tag = (const char*)memchr(line, '[', std::min<ptrdiff_t>(eol - line, 16));
+        if (tag) {
+            parseLine(data, end, line, eol, out);
+        }
+        line = eol + 1;
+    }
+    return lines;
+}
+
+// ===== Recorder dumps =====
+
+static void collectDumpEvent(const FlightEvent& record, void* context) {
+    std::vector<LogEvent>& out = *(std::vector<LogEvent>*)context;
+    LogEvent event;
+    memset(&event, 0, sizeof(event));
+    event.timeMs = record.timeMs;
+    event.flags = LOG_FLAG_TIME;
+    if (record.kind == FLIGHT_BOOT) {
+        FlightBootRecord boot;
+        memcpy(&boot, record.body, sizeof(boot));
+        event.kind = LOG_BOOT;
+        event.node = boot.nodeId;
+        out.push_back(event);
+        return;
+    }
+    DroneMessage msg;
+    int16_t rssi = 0;
+    float snr = 0;
+    if (!flightEventFrame(record, msg, &rssi, &snr)) {
+        return;
+    }
+    bool transmitted = record.kind == FLIGHT_TX;
+    event.kind = transmitted ? LOG_TX : LOG_RX;
+    event.flags |= LOG_FLAG_FRAME_TIME | (transmitted ? 0 : LOG_FLAG_SIGNAL);
+    event.frameTime = msg.timestamp;
+    event.node = msg.sourceId;
+    event.destination = msg.destinationId;
+    event.type = msg.messageType;
+    event.sequence = msg.sequenceNumber;
+    event.rssi = rssi;
+    event.snrQuarterDb = (int8_t)lroundf(snr * 4);
+    out.push_back(event);
+
+    if (msg.messageType == MSG_HEARTBEAT && msg.dataLength >= sizeof(HeartbeatData)) {
+        HeartbeatData heartbeat;
+        memcpy(&heartbeat, msg.data, sizeof(heartbeat));
+        LogEvent position = event;
+        position.kind = transmitted ? LOG_POSITION : LOG_PEER_POSITION;
+        position.latE7 = (int32_t)lround(heartbeat.latitude * 1e7);
+        position.lonE7 = (int32_t)lround(heartbeat.longitude * 1e7);
+        out.push_back(position);
+    }
+}
+
+uint64_t parseLogDump(const FlightLog& log, uint32_t firstSector, uint32_t sectorCount, std::vector<LogEvent>& out) {
+    return log.forEach(collectDumpEvent, &out, firstSector, sectorCount).events;
+}
+
+// ===== Files =====
+
+LogAnalyzer::LogAnalyzer(const LogAnalyzerOptions& analyzerOptions) : options(analyzerOptions) {
+    if (options.threads == 0) {
+        unsigned cores = std::thread::hardware_concurrency();
+        options.threads = (uint8_t)std::min(255u, std::max(1u, cores));
+    }
+}
+
+LogAnalyzer::~LogAnalyzer() {
+    for (Source& source : sources) {
+        if (source.mapping) {
+            munmap(source.mapping, source.length);
+        }
+    }
+}
+
+// A dump starts with a sector header or erased flash; a capture with text
+static bool looksLikeDump(const uint8_t* data, size_t length) {
+    if (length < FLIGHT_SECTOR_BYTES || length % FLIGHT_SECTOR_BYTES) {
+        return false;
+    }
+    uint32_t magic;
+    memcpy(&magic, data, sizeof(magic));
+    return magic == FLIGHT_MAGIC || magic == 0xFFFFFFFFu;
+}
+
+bool LogAnalyzer::addFile(const char* path, uint8_t nodeHint) {
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    // Each chunk is read front to back once
+    madvise(mapped, (size_t)info.st_size, MADV_SEQUENTIAL);
+    addBuffer(path, (const uint8_t*)mapped, (size_t)info.st_size, nodeHint);
+    sources.back().mapping = mapped;
+    return true;
+}
+
+void LogAnalyzer::addBuffer(const char* name, const uint8_t* data, size_t length, uint8_t nodeHint) {
+    Source source;
+    source.name = name;
+    source.data = data;
+    source.length = length;
+    source.mapping = nullptr;
+    source.dump = looksLikeDump(data, length);
+    source.nodeHint = nodeHint;
+    sources.push_back(source);
+}
+
+// ===== Per-file reduction =====
+
+struct TxRecord {
+    uint32_t domain;
+    uint32_t timeMs;
+    uint32_t frameTime;
+    uint16_t sequence;
+    uint8_t source;
+    uint8_t destination;
+    uint8_t type;
+    uint8_t flags;
+};
+
+struct RxRecord {
+    uint32_t domain;
+    uint32_t timeMs;
+    uint32_t frameTime;
+    float distanceM;            // Negative: a position was missing
+    uint16_t sequence;
+    int16_t rssi;
+    uint8_t source;
+    uint8_t receiver;
+    uint8_t type;
+    uint8_t flags;
+    int8_t snrQuarterDb;
+};
+
+struct DroneCounters {
+    uint32_t files;
+    uint32_t boots;
+    uint64_t tx;
+    uint64_t rx;
+    uint64_t rejected;
+    uint64_t dropped;
+};
+
+struct Position {
+    uint32_t timeMs;
+    int32_t latE7;
+    int32_t lonE7;
+    bool known;
+};
+
+struct FileReduction {
+    uint8_t node;
+    uint32_t fileDomain;        // Dumps: (file + 1) << 16; captures: LOG_WALL_DOMAIN
+    uint32_t boots;
+    uint32_t lastTime;
+    uint32_t dayOffset;
+    Position own;
+    std::vector<Position> peers;
+    int64_t lastRx;             // Index in rx of the newest RX, -1 for none
+    std::vector<TxRecord> tx;
+    std::vector<RxRecord> rx;
+    std::vector<DroneCounters> counters;
+    uint64_t unattributed;
+};
+
+static float distanceM(int32_t latA, int32_t lonA, int32_t latB, int32_t lonB) {
+    double latitude = (latA + latB) * 0.5e-7 * M_PI / 180.0;
+    double dx = (lonB - lonA) * 1e-7 * cos(latitude) * LOG_METERS_PER_DEGREE;
+    double dy = (latB - latA) * 1e-7 * LOG_METERS_PER_DEGREE;
+    return (float)sqrt(dx * dx + dy * dy);
+}
+
+static bool fresh(const Position& position, uint32_t now, bool timed) {
+    return position.known && (!timed || now - position.timeMs <= LOG_POSITION_MAX_AGE_MS);
+}
+
+static void reduce(const std::vector<LogEvent>& events, bool dump, FileReduction& file) {
+    for (const LogEvent& event : events) {
+        bool timed = event.flags & LOG_FLAG_TIME;
+        uint32_t time = event.timeMs;
+        if (timed && !dump) {
+            // Captures carry the time of day only
+            if (time + LOG_DAY_MS / 2 < file.lastTime) {
+                file.dayOffset += LOG_DAY_MS;
+            }
+            file.lastTime = time;
+            time += file.dayOffset;
+        }
+        uint32_t domain = dump ? file.fileDomain | (file.boots & 0xFFFF) : LOG_WALL_DOMAIN;
+
+        switch (event.kind) {
+            case LOG_BOOT:
+                file.node = event.node;
+                file.boots++;
+                file.counters[file.node].boots++;
+                file.own.known = false;
+                break;
+            case LOG_TX: {
+                uint8_t source = dump ? event.node : file.node;
+                if (source == LOG_NO_NODE) {
+                    file.unattributed++;
+                    break;
+                }
+                TxRecord tx = {domain, time, event.frameTime, event.sequence, source, event.destination,
+                               event.type, event.flags};
+                file.tx.push_back(tx);
+                file.counters[source].tx++;
+                break;
+            }
+            case LOG_RX: {
+                if (file.node == LOG_NO_NODE) {
+                    file.unattributed++;
+                    break;
+                }
+                RxRecord rx = {domain, time, event.frameTime, -1.0f, event.sequence, event.rssi, event.node,
+                               file.node, event.type, event.flags, event.snrQuarterDb};
+                const Position& peer = file.peers[event.node];
+                if (fresh(file.own, time, timed) && fresh(peer, time, timed)) {
+                    rx.distanceM = distanceM(file.own.latE7, file.own.lonE7, peer.latE7, peer.lonE7);
+                }
+                file.lastRx = (int64_t)file.rx.size();
+                file.rx.push_back(rx);
+                file.counters[file.node].rx++;
+                break;
+            }
+            case LOG_POSITION:
+                file.own = {time, event.latE7, event.lonE7, true};
+                break;
+            case LOG_PEER_POSITION:
+                // Belongs to the heartbeat just received, whose distance it completes
+                if (file.lastRx >= 0) {
+                    RxRecord& rx = file.rx[file.lastRx];
+                    file.peers[rx.source] = {time, event.latE7, event.lonE7, true};
+                    if (rx.distanceM < 0 && fresh(file.own, time, timed)) {
+                        rx.distanceM = distanceM(file.own.latE7, file.own.lonE7, event.latE7, event.lonE7);
+                    }
+                }
+                break;
+            case LOG_REJECTED:
+                file.counters[file.node].rejected++;
+                break;
+            case LOG_DROPPED:
+                file.counters[file.node].dropped++;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// ===== Join =====
+
+struct LinkAccumulator {
+    uint64_t delivered;
+    uint64_t rssiSamples;
+    int64_t rssiSum;
+    int64_t snrQuarterSum;
+    bool unaligned;
+    std::vector<int32_t> latencies;
+};
+
+struct DistanceAccumulator {
+    uint64_t frames;
+    int64_t rssiSum;
+    int64_t snrQuarterSum;
+    int16_t minRssi;
+    int16_t maxRssi;
+};
+
+// A joined pair whose clocks still need aligning
+struct Match {
+    uint32_t txDomain;
+    uint32_t rxDomain;
+    int64_t delta;              // RX time minus TX time, each on its own clock
+    uint8_t receiver;
+};
+
+struct SourceJoin {
+    std::vector<TxRecord> tx;
+    std::vector<RxRecord> rx;
+    LinkAccumulator links[256];
+    std::vector<Match> matches;
+    std::vector<DistanceAccumulator> distance;
+    uint64_t joined;
+    uint64_t unjoined;
+    uint64_t ambiguous;
+    uint64_t broadcasts;
+    uint64_t unicasts[256];
+};
+
+static bool txKeyLess(const TxRecord& a, const TxRecord& b) {
+    if (a.type != b.type) return a.type < b.type;
+    if (a.sequence != b.sequence) return a.sequence < b.sequence;
+    return a.frameTime < b.frameTime;
+}
+
+static uint64_t domainPair(uint32_t tx, uint32_t rx) {
+    return (uint64_t)tx << 32 | rx;
+}
+
+static void joinSource(SourceJoin& join) {
+    std::sort(join.tx.begin(), join.tx.end(), txKeyLess);
+    join.distance.assign(LOG_DISTANCE_BINS, DistanceAccumulator());
+    for (DistanceAccumulator& bin : join.distance) {
+        bin.minRssi = INT16_MAX;
+        bin.maxRssi = INT16_MIN;
+    }
+    for (const TxRecord& tx : join.tx) {
+        if (tx.destination == 0xFF) {
+            join.broadcasts++;
+        } else {
+            join.unicasts[tx.destination]++;
+        }
+    }
+
+    // (TX index, receiver), to count a frame heard twice once
+    std::vector<std::pair<uint32_t, uint8_t>> heard;
+    heard.reserve(join.rx.size());
+    for (const RxRecord& rx : join.rx) {
+        LinkAccumulator& link = join.links[rx.receiver];
+        if (rx.flags & LOG_FLAG_SIGNAL) {
+            link.rssiSamples++;
+            link.rssiSum += rx.rssi;
+            link.snrQuarterSum += rx.snrQuarterDb;
+            if (rx.distanceM >= 0) {
+                uint32_t bin = std::min<uint32_t>((uint32_t)(rx.distanceM / LOG_DISTANCE_BIN_M), LOG_DISTANCE_BINS - 1);
+                DistanceAccumulator& d = join.distance[bin];
+                d.frames++;
+                d.rssiSum += rx.rssi;
+                d.snrQuarterSum += rx.snrQuarterDb;
+                d.minRssi = std::min(d.minRssi, rx.rssi);
+                d.maxRssi = std::max(d.maxRssi, rx.rssi);
+            }
+        }
+
+        TxRecord key;
+        memset(&key, 0, sizeof(key));
+        key.type = rx.type;
+        key.sequence = rx.sequence;
+        auto first = std::lower_bound(join.tx.begin(), join.tx.end(), key, [](const TxRecord& a, const TxRecord& b) {
+            return a.type != b.type ? a.type < b.type : a.sequence < b.sequence;
+        });
+        // Best candidate: same frame timestamp, else nearest wall-clock time
+        // within the window, else the only TX with this key
+        int64_t best = -1;
+        uint64_t bestCost = UINT64_MAX;
+        uint32_t candidates = 0;
+        bool tie = false;
+        for (auto it = first; it != join.tx.end() && it->type == rx.type && it->sequence == rx.sequence; ++it) {
+            candidates++;
+            uint64_t cost;
+            if ((rx.flags & LOG_FLAG_FRAME_TIME) && (it->flags & LOG_FLAG_FRAME_TIME)) {
+                if (it->frameTime != rx.frameTime) {
+                    continue;
+                }
+                cost = 0;
+            } else if ((rx.flags & it->flags & LOG_FLAG_TIME) && rx.domain == LOG_WALL_DOMAIN &&
+                       it->domain == LOG_WALL_DOMAIN) {
+                int64_t gap = (int64_t)rx.timeMs - it->timeMs;
+                uint64_t distance = (uint64_t)(gap < 0 ? -gap : gap);
+                if (distance > LOG_JOIN_WINDOW_MS) {
+                    continue;
+                }
+                cost = 1 + distance;
+            } else {
+                cost = UINT64_MAX - 1;
+            }
+            if (cost < bestCost) {
+                best = it - join.tx.begin();
+                bestCost = cost;
+                tie = false;
+            } else if (cost == bestCost) {
+                tie = true;
+            }
+        }
+        if (best < 0) {
+            join.unjoined++;
+            continue;
+        }
+        if (tie || (bestCost == UINT64_MAX - 1 && candidates > 1)) {
+            join.ambiguous++;
+            continue;
+        }
+        join.joined++;
+        heard.push_back(std::make_pair((uint32_t)best, rx.receiver));
+
+        const TxRecord& tx = join.tx[best];
+        if (rx.flags & tx.flags & LOG_FLAG_TIME) {
+            Match match = {tx.domain, rx.domain, (int64_t)rx.timeMs - tx.timeMs, rx.receiver};
+            join.matches.push_back(match);
+        }
+    }
+    std::sort(heard.begin(), heard.end());
+    heard.erase(std::unique(heard.begin(), heard.end()), heard.end());
+    for (const auto& pair : heard) {
+        join.links[pair.second].delivered++;
+    }
+}
+
+static float percentile(std::vector<int32_t>& values, float fraction) {
+    size_t at = std::min(values.size() - 1, (size_t)(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + at, values.end());
+    return (float)values[at];
+}
+
+LogAnalysis LogAnalyzer::run() const {
+    LogAnalysis analysis;
+    analysis.files = (uint32_t)sources.size();
+    analysis.bytes = analysis.lines = analysis.records = 0;
+    analysis.txFrames = analysis.rxFrames = 0;
+    analysis.joined = analysis.unjoined = analysis.ambiguous = analysis.unattributed = 0;
+    analysis.threads = options.threads;
+    auto started = std::chrono::steady_clock::now();
+
+    // Chunks in file order; each file's are reduced in order, a wave at a time
+    struct Chunk {
+        uint32_t file;
+        size_t from;
+        size_t to;              // Bytes for captures, sectors for dumps
+        std::vector<LogEvent> events;
+        uint64_t units;
+    };
+    std::vector<FlightLog> logs(sources.size());
+    std::vector<Chunk> chunks;
+    std::vector<FileReduction> files(sources.size());
+    for (uint32_t f = 0; f < sources.size(); f++) {
+        const Source& source = sources[f];
+        analysis.bytes += source.length;
+        FileReduction& file = files[f];
+        file.node = source.nodeHint;
+        file.fileDomain = source.dump ? (f + 1) << 16 : LOG_WALL_DOMAIN;
+        file.boots = 0;
+        file.lastTime = file.dayOffset = 0;
+        file.own.known = false;
+        file.peers.assign(256, Position());
+        file.lastRx = -1;
+        file.counters.assign(256, DroneCounters());
+        file.unattributed = 0;
+
+        if (source.dump) {
+            logs[f].attach(source.data, source.length);
+            for (uint32_t s = 0; s < logs[f].sectorCount(); s += options.sectorsPerChunk) {
+                chunks.push_back({f, s, std::min(logs[f].sectorCount(), s + options.sectorsPerChunk), {}, 0});
+            }
+            // Records before the oldest surviving boot record: any frame it sent names it
+            std::vector<LogEvent> head;
+            for (uint32_t s = 0; s < logs[f].sectorCount() && file.node == LOG_NO_NODE && s < 64; s++) {
+                head.clear();
+                parseLogDump(logs[f], s, 1, head);
+                for (const LogEvent& event : head) {
+                    if (event.kind == LOG_BOOT || event.kind == LOG_TX) {
+                        file.node = event.node;
+                        break;
+                    }
+                }
+            }
+        } else {
+            const char* text = (const char*)source.data;
+            for (size_t from = 0; from < source.length;) {
+                size_t to = std::min(source.length, from + options.chunkBytes);
+                if (to < source.length) {
+                    to = lineEnd(text + to, text + source.length) - text + 1;
+                }
+                chunks.push_back({f, from, std::min(to, source.length), {}, 0});
+                from = to;
+            }
+        }
+    }
+
+    size_t wave = (size_t)options.threads * options.chunksPerWave;
+    for (size_t first = 0; first < chunks.size(); first += wave) {
+        size_t last = std::min(chunks.size(), first + wave);
+        parallelFor(options.threads, last - first, [&](size_t i) {
+            Chunk& chunk = chunks[first + i];
+            const Source& source = sources[chunk.file];
+            if (source.dump) {
+                chunk.units = parseLogDump(logs[chunk.file], (uint32_t)chunk.from, (uint32_t)(chunk.to - chunk.from),
+                                           chunk.events);
+            } else {
+                const char* text = (const char*)source.data;
+                chunk.units = parseLogText(text, text + source.length, text + chunk.from, text + chunk.to,
+                                           chunk.events);
+            }
+        });
+        // Files in parallel, each one's chunks in order
+        std::vector<uint32_t> waveFiles;
+        for (size_t c = first; c < last; c++) {
+            if (waveFiles.empty() || waveFiles.back() != chunks[c].file) {
+                waveFiles.push_back(chunks[c].file);
+            }
+        }
+        parallelFor(options.threads, waveFiles.size(), [&](size_t i) {
+            uint32_t f = waveFiles[i];
+            for (size_t c = first; c < last; c++) {
+                if (chunks[c].file == f) {
+                    reduce(chunks[c].events, sources[f].dump, files[f]);
+                    std::vector<LogEvent>().swap(chunks[c].events);
+                }
+            }
+        });
+        for (size_t c = first; c < last; c++) {
+            (sources[chunks[c].file].dump ? analysis.records : analysis.lines) += chunks[c].units;
+        }
+    }
+    analysis.parseSeconds = secondsSince(started);
+    started = std::chrono::steady_clock::now();
+
+    // Per-drone counters, and which drones have a log at all
+    std::vector<DroneCounters> drones(256, DroneCounters());
+    bool present[256] = {false};
+    for (uint32_t f = 0; f < files.size(); f++) {
+        const FileReduction& file = files[f];
+        analysis.unattributed += file.unattributed;
+        for (uint16_t n = 0; n < 256; n++) {
+            const DroneCounters& c = file.counters[n];
+            if (c.tx || c.rx || c.boots || c.rejected || c.dropped) {
+                drones[n].boots += c.boots;
+                drones[n].tx += c.tx;
+                drones[n].rx += c.rx;
+                drones[n].rejected += c.rejected;
+                drones[n].dropped += c.dropped;
+            }
+        }
+        if (file.node != LOG_NO_NODE) {
+            drones[file.node].files++;
+            present[file.node] = true;
+        }
+    }
+
+    // Records by source; each source joins on its own
+    std::vector<SourceJoin> joins(256);
+    for (FileReduction& file : files) {
+        for (const TxRecord& tx : file.tx) {
+            joins[tx.source].tx.push_back(tx);
+        }
+        for (const RxRecord& rx : file.rx) {
+            joins[rx.source].rx.push_back(rx);
+        }
+        std::vector<TxRecord>().swap(file.tx);
+        std::vector<RxRecord>().swap(file.rx);
+    }
+    std::vector<uint8_t> active;
+    for (uint16_t s = 0; s < 256; s++) {
+        analysis.txFrames += joins[s].tx.size();
+        analysis.rxFrames += joins[s].rx.size();
+        SourceJoin& join = joins[s];
+        join.joined = join.unjoined = join.ambiguous = join.broadcasts = 0;
+        memset(join.unicasts, 0, sizeof(join.unicasts));
+        for (LinkAccumulator& link : join.links) {
+            link.delivered = link.rssiSamples = 0;
+            link.rssiSum = link.snrQuarterSum = 0;
+            link.unaligned = false;
+        }
+        if (!join.tx.empty() || !join.rx.empty()) {
+            active.push_back((uint8_t)s);
+        }
+    }
+    parallelFor(options.threads, active.size(), [&](size_t i) { joinSource(joins[active[i]]); });
+
+    // Clock offsets between recorder boots: the fastest frame each way
+    std::unordered_map<uint64_t, int64_t> fastest;
+    for (uint8_t s : active) {
+        for (const Match& match : joins[s].matches) {
+            if (match.txDomain == LOG_WALL_DOMAIN && match.rxDomain == LOG_WALL_DOMAIN) {
+                continue;
+            }
+            auto found = fastest.emplace(domainPair(match.txDomain, match.rxDomain), match.delta);
+            if (!found.second && match.delta < found.first->second) {
+                found.first->second = match.delta;
+            }
+        }
+    }
+    parallelFor(options.threads, active.size(), [&](size_t i) {
+        SourceJoin& join = joins[active[i]];
+        for (const Match& match : join.matches) {
+            LinkAccumulator& link = join.links[match.receiver];
+            int64_t latency = match.delta;
+            if (match.txDomain != LOG_WALL_DOMAIN || match.rxDomain != LOG_WALL_DOMAIN) {
+                int64_t forward = fastest[domainPair(match.txDomain, match.rxDomain)];
+                auto back = fastest.find(domainPair(match.rxDomain, match.txDomain));
+                if (back != fastest.end()) {
+                    latency -= (forward - back->second) / 2;
+                } else {
+                    latency -= forward;
+                    link.unaligned = true;
+                }
+            }
+            link.latencies.push_back((int32_t)latency);
+        }
+        std::vector<Match>().swap(join.matches);
+    });
+
+    std::vector<DistanceAccumulator> distance(LOG_DISTANCE_BINS, DistanceAccumulator());
+    for (DistanceAccumulator& bin : distance) {
+        bin.minRssi = INT16_MAX;
+        bin.maxRssi = INT16_MIN;
+    }
+    for (uint8_t s : active) {
+        SourceJoin& join = joins[s];
+        analysis.joined += join.joined;
+        analysis.unjoined += join.unjoined;
+        analysis.ambiguous += join.ambiguous;
+        for (uint16_t r = 0; r < 256; r++) {
+            LinkAccumulator& link = join.links[r];
+            uint64_t sent = present[r] && r != s ? join.broadcasts + join.unicasts[r] : 0;
+            if (!sent && !link.delivered && !link.rssiSamples) {
+                continue;
+            }
+            LogLinkReport report;
+            memset(&report, 0, sizeof(report));
+            report.source = s;
+            report.receiver = (uint8_t)r;
+            report.sent = sent;
+            report.delivered = link.delivered;
+            report.deliveryRatio = sent ? (float)link.delivered / sent : 0;
+            report.latencySamples = link.latencies.size();
+            report.latencyAligned = !link.unaligned;
+            if (!link.latencies.empty()) {
+                for (int32_t latency : link.latencies) {
+                    int32_t bin = latency / LOG_LATENCY_BIN_MS;
+                    report.latencyHistogram[std::max(0, std::min(bin, LOG_LATENCY_BINS - 1))]++;
+                }
+                report.latencyMaxMs = (float)*std::max_element(link.latencies.begin(), link.latencies.end());
+                report.latencyP99Ms = percentile(link.latencies, 0.99f);
+                report.latencyP90Ms = percentile(link.latencies, 0.90f);
+                report.latencyP50Ms = percentile(link.latencies, 0.50f);
+            }
+            report.rssiSamples = link.rssiSamples;
+            if (link.rssiSamples) {
+                report.meanRssi = (float)link.rssiSum / link.rssiSamples;
+                report.meanSnr = (float)link.snrQuarterSum / link.rssiSamples / 4;
+            }
+            analysis.links.push_back(report);
+        }
+        for (uint32_t b = 0; b < LOG_DISTANCE_BINS; b++) {
+            const DistanceAccumulator& from = join.distance[b];
+            DistanceAccumulator& to = distance[b];
+            to.frames += from.frames;
+            to.rssiSum += from.rssiSum;
+            to.snrQuarterSum += from.snrQuarterSum;
+            to.minRssi = std::min(to.minRssi, from.minRssi);
+            to.maxRssi = std::max(to.maxRssi, from.maxRssi);
+        }
+    }
+    for (uint32_t b = 0; b < LOG_DISTANCE_BINS; b++) {
+        const DistanceAccumulator& bin = distance[b];
+        if (bin.frames) {
+            LogDistanceBin report = {b * LOG_DISTANCE_BIN_M, bin.frames, (float)bin.rssiSum / bin.frames,
+                                     (float)bin.snrQuarterSum / bin.frames / 4, bin.minRssi, bin.maxRssi};
+            analysis.rssiByDistance.push_back(report);
+        }
+    }
+    for (uint16_t n = 1; n < 256; n++) {
+        const DroneCounters& c = drones[n];
+        if (c.files || c.tx || c.rx) {
+            LogDroneReport report = {(uint8_t)n, c.files, c.boots, c.tx, c.rx, c.rejected, c.dropped};
+            analysis.drones.push_back(report);
+        }
+    }
+    analysis.joinSeconds = secondsSince(started);
+    return analysis;
+}
+
+// ===== CSV =====
+
+static FILE* openCsv(const char* directory, const char* name, const char* header) {
+    std::string path = std::string(directory) + "/" + name;
+    FILE* out = fopen(path.c_str(), "w");
+    if (out) {
+        fputs(header, out);
+    }
+    return out;
+}
+
+bool LogAnalyzer::writeCsv(const LogAnalysis& analysis, const char* directory) {
+    FILE* drones = openCsv(directory, "drones.csv", "node,files,boots,tx,rx,rejected,dropped\n");
+    FILE* links = openCsv(directory, "links.csv",
+                          "source,receiver,sent,delivered,delivery_ratio,latency_samples,latency_aligned,"
+                          "latency_p50_ms,latency_p90_ms,latency_p99_ms,latency_max_ms,rssi_samples,"
+                          "mean_rssi_dbm,mean_snr_db\n");
+    FILE* latency = openCsv(directory, "latency.csv", "source,receiver,from_ms,frames\n");
+    FILE* rssi = openCsv(directory, "rssi_distance.csv",
+                         "from_m,frames,mean_rssi_dbm,mean_snr_db,min_rssi_dbm,max_rssi_dbm\n");
+    bool ok = drones && links && latency && rssi;
+    if (ok) {
+        for (const LogDroneReport& d : analysis.drones) {
+            fprintf(drones, "%u,%u,%u,%llu,%llu,%llu,%llu\n", d.node, d.files, d.boots, (unsigned long long)d.tx,
+                    (unsigned long long)d.rx, (unsigned long long)d.rejected, (unsigned long long)d.dropped);
+        }
+        for (const LogLinkReport& l : analysis.links) {
+            fprintf(links, "%u,%u,%llu,%llu,%.4f,%llu,%u,%.0f,%.0f,%.0f,%.0f,%llu,%.1f,%.2f\n", l.source, l.receiver,
+                    (unsigned long long)l.sent, (unsigned long long)l.delivered, l.deliveryRatio,
+                    (unsigned long long)l.latencySamples, l.latencyAligned ? 1 : 0, l.latencyP50Ms, l.latencyP90Ms,
+                    l.latencyP99Ms, l.latencyMaxMs, (unsigned long long)l.rssiSamples, l.meanRssi, l.meanSnr);
+            for (uint32_t b = 0; b < LOG_LATENCY_BINS; b++) {
+                if (l.latencyHistogram[b]) {
+                    fprintf(latency, "%u,%u,%u,%u\n", l.source, l.receiver, b * LOG_LATENCY_BIN_MS,
+                            l.latencyHistogram[b]);
+                }
+            }
+        }
+        for (const LogDistanceBin& b : analysis.rssiByDistance) {
+            fprintf(rssi, "%u,%llu,%.1f,%.2f,%d,%d\n", b.fromM, (unsigned long long)b.frames, b.meanRssi, b.meanSnr,
+                    b.minRssi, b.maxRssi);
+        }
+    }
+    for (FILE* out : {drones, links, latency, rssi}) {
+        if (out && fclose(out) != 0) {
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// ===== Synthetic logs =====
+
+// A recorder partition backed by a file, erased on demand
+class FileFlash : public FlightFlash {
+private:
+    int fd;
+    uint32_t bytes;
+
+public:
+    FileFlash(int fd, uint32_t size) : fd(fd), bytes(size) {}
+    uint32_t size() const override { return bytes; }
+    bool erase(uint32_t offset) override {
+        uint8_t erased[FLIGHT_SECTOR_BYTES];
+        memset(erased, 0xFF, sizeof(erased));
+        return pwrite(fd, erased, sizeof(erased), offset) == (ssize_t)sizeof(erased);
+    }
+    bool write(uint32_t offset, const void* data, uint32_t length) override {
+        // NOR semantics: bits only clear, so re-flushing a page keeps it
+        uint8_t current[FLIGHT_PAGE_BYTES];
+        const uint8_t* in = (const uint8_t*)data;
+        while (length) {
+            uint32_t n = std::min<uint32_t>(length, sizeof(current));
+            if (pread(fd, current, n, offset) != (ssize_t)n) {
+                return false;
+            }
+            for (uint32_t i = 0; i < n; i++) {
+                current[i] &= in[i];
+            }
+            if (pwrite(fd, current, n, offset) != (ssize_t)n) {
+                return false;
+            }
+            offset += n;
+            in += n;
+            length -= n;
+        }
+        return true;
+    }
+    bool read(uint32_t offset, void* data, uint32_t length) override {
+        return pread(fd, data, length, offset) == (ssize_t)length;
+    }
+};
+
+struct SynthFrame {
+    uint32_t timeMs;            // Since the start, wall clock
+    bool transmitted;
+    uint8_t source;
+    uint16_t sequence;
+    uint32_t frameTime;
+    int16_t rssi;
+    int8_t snrQuarterDb;
+};
+
+struct SynthDrone {
+    uint8_t id;
+    double latitude;
+    double longitude;
+    uint32_t bootMs;            // Its millis() at the start
+    uint16_t sequence;
+    uint32_t heartbeats;
+    FILE* text;
+    int fd;
+    FileFlash* flash;
+    FlightRecorder* recorder;
+    std::vector<SynthFrame> round;
+};
+
+static int clockText(char* out, uint32_t ms) {
+    ms %= LOG_DAY_MS;
+    // Captures start at noon
+    ms = (ms + 12 * 3600000u) % LOG_DAY_MS;
+    return sprintf(out, "%02u:%02u:%02u.%03u > ", ms / 3600000, ms / 60000 % 60, ms / 1000 % 60, ms % 1000);
+}
+
+static void writeSynthText(SynthDrone& drone, const SynthDrone* all, const SynthFrame& frame) {
+    char clock[32];
+    clockText(clock, frame.timeMs);
+    FILE* out = drone.text;
+    if (frame.transmitted) {
+        fprintf(out, "%s[TX] 📡 Sending heartbeat #%u\n", clock, drone.heartbeats);
+        fprintf(out, "%s[TX]    Battery: %.1f%%\n", clock, 80 + drone.heartbeats % 100 / 10.0);
+        fprintf(out, "%s[TX]    Location: (%.6f, %.6f)\n", clock, drone.latitude, drone.longitude);
+        fprintf(out, "%s[COMM] Sending message type 0x%02X to drone %d\n", clock, MSG_HEARTBEAT, 0xFF);
+        fprintf(out, "%s[COMM] Message sent successfully (seq: %d)\n", clock, frame.sequence);
+    } else {
+        const SynthDrone& source = all[frame.source - 1];
+        fprintf(out, "%s[COMM] Message received from drone %d (type: 0x%02X, seq: %d)\n", clock, frame.source,
+                MSG_HEARTBEAT, frame.sequence);
+        fprintf(out, "%s[COMM] Signal: RSSI=%d dBm, SNR=%.1f dB\n", clock, frame.rssi, frame.snrQuarterDb / 4.0f);
+        fprintf(out, "%s\n", clock);
+        fprintf(out, "%s[RX] 📩 Message received from Drone %d\n", clock, frame.source);
+        fprintf(out, "%s[RX]       Location: (%.6f, %.6f)\n", clock, source.latitude, source.longitude);
+    }
+}
+
+static void writeSynthRecord(SynthDrone& drone, const SynthDrone* all, const SynthFrame& frame) {
+    const SynthDrone& source = all[frame.source - 1];
+    HeartbeatData heartbeat;
+    memset(&heartbeat, 0, sizeof(heartbeat));
+    heartbeat.droneId = frame.source;
+    heartbeat.batteryLevel = 80;
+    heartbeat.latitude = (float)source.latitude;
+    heartbeat.longitude = (float)source.longitude;
+    DroneMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.messageType = MSG_HEARTBEAT;
+    msg.sourceId = frame.source;
+    msg.destinationId = 0xFF;
+    msg.timestamp = frame.frameTime;
+    msg.sequenceNumber = frame.sequence;
+    msg.dataLength = sizeof(heartbeat);
+    memcpy(msg.data, &heartbeat, sizeof(heartbeat));
+    uint32_t now = drone.bootMs + frame.timeMs;
+    drone.recorder->recordFrame(frame.transmitted, msg, frame.rssi, frame.snrQuarterDb / 4.0f, now);
+}
+
+bool synthesizeLogs(const char* directory, const LogSynthesisOptions& options, LogSynthesisTruth* truth) {
+    std::mt19937 rng(options.seed);
+    std::uniform_real_distribution<double> unit(0, 1);
+    std::normal_distribution<double> shadow(0, 3);
+    const double baseLat = 28.7041, baseLon = 77.1025;
+    const double areaM = 1500;
+    const uint8_t count = options.drones;
+    if (count == 0 || count > 250) {
+        return false;
+    }
+    if (truth) {
+        truth->sent.assign(256 * 256, 0);
+        truth->delivered.assign(256 * 256, 0);
+        truth->bytes = 0;
+        truth->seconds = 0;
+    }
+
+    // Each dump sized for its share, so the ring never wraps
+    uint64_t share = options.totalBytes / count;
+    uint32_t sectors = (uint32_t)std::max<uint64_t>(16, share / FLIGHT_SECTOR_BYTES);
+    std::vector<SynthDrone> drones(count);
+    bool ok = true;
+    for (uint8_t i = 0; i < count; i++) {
+        SynthDrone& d = drones[i];
+        d.id = i + 1;
+        d.latitude = baseLat + (unit(rng) - 0.5) * areaM / LOG_METERS_PER_DEGREE;
+        d.longitude = baseLon + (unit(rng) - 0.5) * areaM / (LOG_METERS_PER_DEGREE * cos(baseLat * M_PI / 180));
+        d.bootMs = 5000 + (uint32_t)(unit(rng) * 60000);
+        d.sequence = (uint16_t)rng();
+        d.heartbeats = 0;
+        d.text = nullptr;
+        d.fd = -1;
+        d.flash = nullptr;
+        d.recorder = nullptr;
+        char path[512];
+        snprintf(path, sizeof(path), "%s/drone_%u.%s", directory, d.id, options.dumps ? "bin" : "log");
+        if (options.dumps) {
+            d.fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+            ok = ok && d.fd >= 0 && ftruncate(d.fd, (off_t)sectors * FLIGHT_SECTOR_BYTES) == 0;
+            if (ok) {
+                d.flash = new FileFlash(d.fd, sectors * FLIGHT_SECTOR_BYTES);
+                for (uint32_t s = 0; s < sectors && ok; s++) {
+                    ok = d.flash->erase(s * FLIGHT_SECTOR_BYTES);
+                }
+                d.recorder = new FlightRecorder();
+                ok = d.recorder->begin(d.flash, d.id, 1, d.bootMs);
+            }
+        } else {
+            d.text = fopen(path, "w");
+            ok = ok && d.text;
+            if (ok) {
+                setvbuf(d.text, nullptr, _IOFBF, 1 << 20);
+                char clock[32];
+                clockText(clock, 0);
+                fprintf(d.text, "%s[COMM] LoRa initialized successfully\n", clock);
+                fprintf(d.text, "%s[COMM] Node ID: %d (config drone_%d)\n", clock, d.id, d.id);
+            }
+        }
+    }
+
+    // Log-distance RSSI, loss rising past ~900 m, one second per round
+    uint64_t written = 0;
+    uint32_t second = 0;
+    while (ok && written < options.totalBytes) {
+        for (SynthDrone& d : drones) {
+            d.round.clear();
+        }
+        for (SynthDrone& sender : drones) {
+            uint32_t txTime = second * 1000 + 200 + (uint32_t)(unit(rng) * 600);
+            SynthFrame tx = {txTime, true, sender.id, ++sender.sequence, sender.bootMs + txTime, 0, 0};
+            sender.heartbeats++;
+            sender.round.push_back(tx);
+            for (SynthDrone& receiver : drones) {
+                if (receiver.id == sender.id) {
+                    continue;
+                }
+                float d = distanceM((int32_t)lround(sender.latitude * 1e7), (int32_t)lround(sender.longitude * 1e7),
+                                    (int32_t)lround(receiver.latitude * 1e7),
+                                    (int32_t)lround(receiver.longitude * 1e7));
+                double reception = 1.0 / (1.0 + exp((d - 900.0) / 120.0));
+                if (truth) {
+                    truth->sent[sender.id * 256 + receiver.id]++;
+                }
+                if (unit(rng) >= reception) {
+                    continue;
+                }
+                if (truth) {
+                    truth->delivered[sender.id * 256 + receiver.id]++;
+                }
+                double rssi = -30 - 28 * log10(std::max(1.0f, d)) + shadow(rng);
+                double snr = std::max(-20.0, std::min(12.0, rssi + 117));
+                SynthFrame rx = {txTime + 92 + (uint32_t)(unit(rng) * 41), false, sender.id, tx.sequence,
+                                 tx.frameTime, (int16_t)lround(rssi), (int8_t)lround(snr * 4)};
+                receiver.round.push_back(rx);
+            }
+        }
+        for (SynthDrone& d : drones) {
+            std::sort(d.round.begin(), d.round.end(), [](const SynthFrame& a, const SynthFrame& b) {
+                return a.timeMs < b.timeMs;
+            });
+            for (size_t f = 0; f < d.round.size(); f++) {
+                const SynthFrame& frame = d.round[f];
+                if (options.dumps) {
+                    writeSynthRecord(d, drones.data(), frame);
+                    // Keep the RAM ring from filling up in busy rounds
+                    if (f % 16 == 15) {
+                        d.recorder->service(d.bootMs + frame.timeMs);
+                    }
+                } else {
+                    writeSynthText(d, drones.data(), frame);
+                }
+            }
+            if (options.dumps) {
+                d.recorder->service(d.bootMs + second * 1000 + 999);
+                // Stop before any ring wraps
+
+                if (d.recorder->getSequence() + 2 >= sectors) {
+                    written = options.totalBytes;
+                }
+            }
+        }
+        second++;
+        if (!options.dumps && second % 16 == 0) {
+            written = 0;
+            for (SynthDrone& d : drones) {
+                written += (uint64_t)ftell(d.text);
+            }
+        }
+    }
+
+    uint64_t bytes = 0;
+    for (SynthDrone& d : drones) {
+        if (d.recorder) {
+            d.recorder->flush();
+            delete d.recorder;
+        }
+        delete d.flash;
+        if (d.fd >= 0) {
+            bytes += (uint64_t)sectors * FLIGHT_SECTOR_BYTES;
+            ok = ::close(d.fd) == 0 && ok;
+        }
+        if (d.text) {
+            bytes += (uint64_t)ftell(d.text);
+            ok = fclose(d.text) == 0 && ok;
+        }
+    }
+    if (truth) {
+        truth->bytes = bytes;
+        truth->seconds = second;
+    }
+    return ok;
+}
+
+#endif // ARDUINO
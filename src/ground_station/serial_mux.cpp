@@ -0,0 +1,466 @@
+#ifndef ARDUINO
+
+#include "../../include/ground_station/serial_mux.h"
+#include "../../include/ground_station/flight_replay.h"
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <algorithm>
+
+#define MUX_EPOLL_BATCH 64
+
+// ===== Stream decoding =====
+
+StreamDecoder::StreamDecoder() {
+    reset();
+}
+
+void StreamDecoder::reset() {
+    used = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+void StreamDecoder::emitLine(const uint8_t* line, size_t length, bool truncated, StreamLineHandler onLine,
+                             void* context) {
+    if (length && line[length - 1] == '\r') {
+        length--;
+    }
+    stats.lines++;
+    onLine((const char*)line, length, truncated, context);
+}
+
+void StreamDecoder::feed(const uint8_t* data, size_t length, StreamLineHandler onLine, StreamRecordHandler onRecord,
+                         void* context) {
+    stats.bytes += length;
+    while (length > 0) {
+        size_t take = std::min(length, sizeof(buffer) - used);
+        memcpy(buffer + used, data, take);
+        used += take;
+        data += take;
+        length -= take;
+
+        size_t at = 0;
+        while (at < used) {
+            if (buffer[at] == SERIAL_TAP_SYNC) {
+                FlightRecordView record;
+                int consumed = flightParseRecord(buffer + at + 1, (uint32_t)(used - at - 1), record);
+                if (consumed > 0) {
+                    stats.records++;
+                    onRecord(record, context);
+                    at += 1 + consumed;
+                    continue;
+                }
+                if (consumed < 0 && used - at < SERIAL_TAP_MAX_BYTES) {
+                    break;      // The rest of the record is still on its way
+                }
+                // Not a record after all: the sync byte is dropped, the rest read as text
+                stats.corrupt++;
+                at++;
+                continue;
+            }
+
+            // Text up to a newline or the next record, whichever comes first
+            size_t end = at;
+            size_t limit = std::min(used, at + GROUND_LINE_MAX);
+            while (end < limit && buffer[end] != '\n' && buffer[end] != SERIAL_TAP_SYNC) {
+                end++;
+            }
+            if (end < limit) {
+                if (end > at || buffer[end] == '\n') {
+                    emitLine(buffer + at, end - at, false, onLine, context);
+                }
+                at = buffer[end] == '\n' ? end + 1 : end;
+            } else if (end - at == GROUND_LINE_MAX) {
+                emitLine(buffer + at, GROUND_LINE_MAX, true, onLine, context);
+                at = end;
+            } else {
+                break;          // Unfinished line
+            }
+        }
+        memmove(buffer, buffer + at, used - at);
+        used -= at;
+    }
+}
+
+// ===== Multiplexer =====
+
+SerialMuxOptions serialMuxDefaults() {
+    SerialMuxOptions options;
+    options.shmName = GROUND_SHM_NAME;
+    options.ringSlots = SWARM_RING_SLOTS;
+    options.baud = GROUND_SERIAL_BAUD;
+    return options;
+}
+
+static speed_t baudConstant(uint32_t baud) {
+    switch (baud) {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        default: return B115200;
+    }
+}
+
+SerialMux::SerialMux() : epollFd(-1), links(SWARM_NODES * SWARM_NODES), nowNs(0), current(0) {
+    options = serialMuxDefaults();
+    memset(drones, 0, sizeof(drones));
+    memset(links.data(), 0, links.size() * sizeof(SwarmLink));
+    memset(&stats, 0, sizeof(stats));
+}
+
+SerialMux::~SerialMux() {
+    end();
+}
+
+bool SerialMux::begin(const SerialMuxOptions& muxOptions) {
+    end();
+    options = muxOptions;
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        return false;
+    }
+    if (!writer.create(options.shmName, options.ringSlots)) {
+        DEBUG_PRINT("[GROUND] Cannot create shared memory %s: %s\n", options.shmName, strerror(errno));
+        ::close(epollFd);
+        epollFd = -1;
+        return false;
+    }
+    for (uint16_t i = 0; i < SWARM_NODES; i++) {
+        drones[i].id = (uint8_t)i;
+        drones[i].stream = SWARM_NO_STREAM;
+    }
+    return true;
+}
+
+void SerialMux::end() {
+    for (uint16_t i = 0; i < streams.size(); i++) {
+        if (streams[i]->fd >= 0) {
+            ::close(streams[i]->fd);
+        }
+        delete streams[i];
+    }
+    streams.clear();
+    for (auto& entry : collectors) {
+        delete entry.second;
+    }
+    collectors.clear();
+    if (epollFd >= 0) {
+        ::close(epollFd);
+        epollFd = -1;
+    }
+    writer.close();
+}
+
+int SerialMux::addDevice(const char* path) {
+    int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        DEBUG_PRINT("[GROUND] Cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    struct termios tty;
+    if (tcgetattr(fd, &tty) == 0) {
+        cfmakeraw(&tty);
+        cfsetispeed(&tty, baudConstant(options.baud));
+        cfsetospeed(&tty, baudConstant(options.baud));
+        tty.c_cflag |= CLOCAL | CREAD;
+        tcsetattr(fd, TCSANOW, &tty);
+    }
+    return addDescriptor(fd, path);
+}
+
+int SerialMux::addDescriptor(int fd, const char* name) {
+    if (epollFd < 0 || streams.size() >= SWARM_MAX_STREAMS) {
+        ::close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    uint16_t index = (uint16_t)streams.size();
+    struct epoll_event interest;
+    memset(&interest, 0, sizeof(interest));
+    interest.events = EPOLLIN | EPOLLRDHUP;
+    interest.data.u32 = index;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &interest) != 0) {
+        ::close(fd);
+        return -1;
+    }
+
+    Stream* stream = new Stream;
+    stream->fd = fd;
+    stream->name = name;
+    memset(&stream->published, 0, sizeof(stream->published));
+    strncpy(stream->published.name, name, sizeof(stream->published.name) - 1);
+    stream->published.open = true;
+    stream->tapClockMs = 0;
+    streams.push_back(stream);
+    stats.streams++;
+    stats.openStreams++;
+    writer.writeStream(index, stream->published);
+
+    SwarmEvent event;
+    memset(&event, 0, sizeof(event));
+    event.receivedNs = swarmClockNs();
+    event.stream = index;
+    event.kind = SWARM_EVENT_STREAM;
+    event.flags = SWARM_FLAG_OPEN;
+    writer.publish(event);
+    stats.events++;
+    return index;
+}
+
+void SerialMux::closeStream(uint16_t index) {
+    Stream& stream = *streams[index];
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, stream.fd, nullptr);
+    ::close(stream.fd);
+    stream.fd = -1;
+    stream.published.open = false;
+    writer.writeStream(index, stream.published);
+    stats.openStreams--;
+
+    SwarmEvent event;
+    memset(&event, 0, sizeof(event));
+    event.receivedNs = swarmClockNs();
+    event.stream = index;
+    event.kind = SWARM_EVENT_STREAM;
+    event.node = stream.published.node;
+    writer.publish(event);
+    stats.events++;
+    DEBUG_PRINT("[GROUND] %s closed\n", stream.name.c_str());
+}
+
+uint32_t SerialMux::poll(int timeoutMs) {
+    struct epoll_event ready[MUX_EPOLL_BATCH];
+    int count = epoll_wait(epollFd, ready, MUX_EPOLL_BATCH, timeoutMs);
+    if (count <= 0) {
+        return 0;
+    }
+    stats.wakeups++;
+    nowNs = swarmClockNs();
+    for (int i = 0; i < count; i++) {
+        uint16_t index = (uint16_t)ready[i].data.u32;
+        if (index < streams.size() && streams[index]->fd >= 0) {
+            readStream(index);
+        }
+    }
+    return (uint32_t)count;
+}
+
+void SerialMux::readStream(uint16_t index) {
+    Stream& stream = *streams[index];
+    uint8_t chunk[GROUND_READ_BYTES];
+    current = index;
+    uint64_t bytesBefore = stream.decoder.getStats().bytes;
+    for (;;) {
+        ssize_t got = read(stream.fd, chunk, sizeof(chunk));
+        if (got > 0) {
+            stats.reads++;
+            stream.decoder.feed(chunk, (size_t)got, onLine, onRecord, this);
+            if ((size_t)got < sizeof(chunk)) {
+                break;          // Drained; epoll is level-triggered, a partial read costs no wakeup
+            }
+            continue;
+        }
+        if (got < 0 && (errno == EAGAIN || errno == EINTR)) {
+            break;
+        }
+        // End of file, or EIO once a pty's other side or a USB device goes away
+        closeStream(index);
+        break;
+    }
+
+    StreamDecoderStats decoded = stream.decoder.getStats();
+    stats.bytes += decoded.bytes - bytesBefore;
+    stream.published.bytes = decoded.bytes;
+    stream.published.lines = decoded.lines;
+    stream.published.records = decoded.records;
+    stats.corrupt += decoded.corrupt - stream.published.corrupt;
+    stream.published.corrupt = decoded.corrupt;
+    stream.published.lastNs = nowNs;
+    writer.writeStream(index, stream.published);
+}
+
+void SerialMux::onLine(const char* line, size_t length, bool truncated, void* context) {
+    SerialMux* mux = (SerialMux*)context;
+    mux->handleLine(*mux->streams[mux->current], line, length, truncated);
+}
+
+void SerialMux::onRecord(const FlightRecordView& record, void* context) {
+    SerialMux* mux = (SerialMux*)context;
+    mux->handleRecord(*mux->streams[mux->current], record);
+}
+
+SwarmDrone& SerialMux::drone(uint8_t id) {
+    SwarmDrone& entry = drones[id];
+    entry.known = true;
+    return entry;
+}
+
+void SerialMux::setStreamNode(Stream& stream, uint8_t node) {
+    if (stream.published.node == node) {
+        return;
+    }
+    stream.published.node = node;
+    SwarmDrone& wired = drone(node);
+    wired.stream = current;
+    writer.writeDrone(node, wired);
+}
+
+void SerialMux::handleLine(Stream& stream, const char* line, size_t length, bool truncated) {
+    stats.lines++;
+    static const char nodeLine[] = "[COMM] Node ID: ";
+    const char* tag = (const char*)memchr(line, '[', std::min<size_t>(length, 16));
+    if (tag && (size_t)(line + length - tag) > sizeof(nodeLine) - 1 &&
+        memcmp(tag, nodeLine, sizeof(nodeLine) - 1) == 0) {
+        int node = atoi(tag + sizeof(nodeLine) - 1);
+        if (node > 0 && node < SWARM_NODES) {
+            setStreamNode(stream, (uint8_t)node);
+        }
+    }
+
+    SwarmEvent event;
+    memset(&event, 0, sizeof(event));
+    event.receivedNs = nowNs;
+    event.stream = current;
+    event.kind = SWARM_EVENT_LINE;
+    event.node = stream.published.node;
+    event.lineLength = (uint8_t)std::min<size_t>(length, SWARM_LINE_BYTES);
+    event.flags = truncated || length > SWARM_LINE_BYTES ? SWARM_FLAG_TRUNCATED : 0;
+    memcpy(event.line, line, event.lineLength);
+    writer.publish(event);
+    stats.events++;
+}
+
+void SerialMux::handleRecord(Stream& stream, const FlightRecordView& record) {
+    stream.tapClockMs += record.deltaMs;
+    FlightEvent flight;
+    flight.kind = record.kind;
+    flight.sector = 0;
+    flight.timeMs = stream.tapClockMs;
+    flight.length = record.length;
+    flight.body = record.body;
+
+    if (record.kind == FLIGHT_BOOT) {
+        if (record.length < sizeof(FlightBootRecord)) {
+            return;
+        }
+        FlightBootRecord boot;
+        memcpy(&boot, record.body, sizeof(boot));
+        stream.tapClockMs = boot.clockMs;
+        setStreamNode(stream, boot.nodeId);
+
+        SwarmEvent event;
+        memset(&event, 0, sizeof(event));
+        event.receivedNs = nowNs;
+        event.stream = current;
+        event.kind = SWARM_EVENT_BOOT;
+        event.node = boot.nodeId;
+        writer.publish(event);
+        stats.events++;
+        return;
+    }
+
+    DroneMessage msg;
+    int16_t rssi = 0;
+    float snr = 0;
+    if (!flightEventFrame(flight, msg, &rssi, &snr)) {
+        return;
+    }
+    bool transmitted = record.kind == FLIGHT_TX;
+    int8_t snrQuarterDb = (int8_t)lroundf(snr * 4.0f);
+    if (transmitted && stream.published.node == 0 && msg.sourceId != 0) {
+        // Tap started after the boot record: what it sends names it
+        setStreamNode(stream, msg.sourceId);
+    }
+    handleFrame(stream, msg, transmitted, rssi, snrQuarterDb);
+}
+
+void SerialMux::handleFrame(Stream& stream, const DroneMessage& msg, bool transmitted, int16_t rssi,
+                            int8_t snrQuarterDb) {
+    stats.frames++;
+    uint8_t node = stream.published.node;
+
+    SwarmDrone& source = drone(msg.sourceId);
+    source.lastHeardNs = nowNs;
+    if (transmitted) {
+        source.framesSent++;
+    } else {
+        source.framesHeard++;
+    }
+    if (msg.messageType == MSG_HEARTBEAT && msg.dataLength >= sizeof(HeartbeatData)) {
+        HeartbeatData heartbeat;
+        memcpy(&heartbeat, msg.data, sizeof(heartbeat));
+        source.battery = heartbeat.batteryLevel;
+        source.latitude = heartbeat.latitude;
+        source.longitude = heartbeat.longitude;
+        source.status = heartbeat.status;
+        source.missionState = heartbeat.missionState;
+        source.lastHeartbeatNs = nowNs;
+    }
+    writer.writeDrone(msg.sourceId, source);
+
+    if (!transmitted && node != 0 && node != msg.sourceId) {
+        SwarmLink& link = links[node * SWARM_NODES + msg.sourceId];
+        link.frames++;
+        link.rssi = rssi;
+        link.snrQuarterDb = snrQuarterDb;
+        link.fromTelemetry = false;
+        link.lastNs = nowNs;
+        writer.writeLink(node, msg.sourceId, link);
+        if (msg.messageType == MSG_STATUS_RESPONSE && msg.destinationId == node) {
+            handleTelemetry(node, msg);
+        }
+    }
+
+    SwarmEvent event;
+    memset(&event, 0, sizeof(event));
+    event.receivedNs = nowNs;
+    event.stream = current;
+    event.kind = SWARM_EVENT_FRAME;
+    event.node = node;
+    event.rssi = rssi;
+    event.snrQuarterDb = snrQuarterDb;
+    event.flags = transmitted ? SWARM_FLAG_TX : 0;
+    event.frame = msg;
+    writer.publish(event);
+    stats.events++;
+}
+
+void SerialMux::handleTelemetry(uint8_t requester, const DroneMessage& msg) {
+    TelemetryCollector*& collector = collectors[requester];
+    if (!collector) {
+        collector = new TelemetryCollector(requester);
+    }
+    if (!collector->onFrame(msg, (uint32_t)(nowNs / 1000000))) {
+        return;
+    }
+    const TelemetrySnapshot* state = collector->getState(msg.sourceId);
+    if (!state) {
+        return;
+    }
+    SwarmDrone& reporter = drone(msg.sourceId);
+    reporter.peerCount = state->peerCount;
+    reporter.uptimeMs = state->counters[TEL_UPTIME_MS];
+    writer.writeDrone(msg.sourceId, reporter);
+    for (uint8_t i = 0; i < state->peerCount && i < PEER_TABLE_SIZE; i++) {
+        const TelemetryPeer& peer = state->peers[i];
+        SwarmLink& link = links[msg.sourceId * SWARM_NODES + peer.id];
+        if (!link.fromTelemetry && link.lastNs != 0) {
+            continue;           // Its own tap is fresher than its peer table
+        }
+        link.rssi = peer.rssi;
+        link.snrQuarterDb = peer.snrQ2;
+        link.fromTelemetry = true;
+        link.lastNs = nowNs;
+        writer.writeLink(msg.sourceId, peer.id, link);
+    }
+}
+
+#endif // ARDUINO
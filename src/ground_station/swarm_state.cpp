@@ -0,0 +1,280 @@
+#ifndef ARDUINO
+
+#include "../../include/ground_station/swarm_state.h"
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SWARM_READ_ATTEMPTS 64
+
+uint64_t swarmClockNs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+struct SwarmLayout {
+    size_t streams;
+    size_t drones;
+    size_t links;
+    size_t ring;
+    size_t total;
+};
+
+static size_t alignUp(size_t offset) {
+    return (offset + 63) & ~(size_t)63;
+}
+
+static SwarmLayout swarmLayout(uint32_t ringSlots) {
+    SwarmLayout layout;
+    layout.streams = alignUp(sizeof(SwarmShmHeader));
+    layout.drones = alignUp(layout.streams + SWARM_MAX_STREAMS * sizeof(SwarmSeqEntry<SwarmStream>));
+    layout.links = alignUp(layout.drones + SWARM_NODES * sizeof(SwarmSeqEntry<SwarmDrone>));
+    layout.ring = alignUp(layout.links + SWARM_NODES * SWARM_NODES * sizeof(SwarmSeqEntry<SwarmLink>));
+    layout.total = layout.ring + (size_t)ringSlots * sizeof(SwarmEventSlot);
+    return layout;
+}
+
+// Writer side of an entry's sequence lock
+template <typename T>
+static void seqWrite(SwarmSeqEntry<T>& entry, const T& value) {
+    uint32_t sequence = entry.sequence.load(std::memory_order_relaxed);
+    entry.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&entry.value, &value, sizeof(T));
+    entry.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+template <typename T>
+static bool seqRead(const SwarmSeqEntry<T>& entry, T& out) {
+    for (uint32_t attempt = 0; attempt < SWARM_READ_ATTEMPTS; attempt++) {
+        uint32_t before = entry.sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        memcpy(&out, &entry.value, sizeof(T));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entry.sequence.load(std::memory_order_relaxed) == before) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ===== Writer =====
+
+SwarmStateWriter::SwarmStateWriter()
+    : base(nullptr), length(0), header(nullptr), streams(nullptr), drones(nullptr), links(nullptr), ring(nullptr),
+      published(0) {
+    name[0] = '\0';
+}
+
+SwarmStateWriter::~SwarmStateWriter() {
+    close();
+}
+
+bool SwarmStateWriter::create(const char* shmName, uint32_t ringSlots) {
+    close();
+    uint32_t slots = 1;
+    while (slots < ringSlots) {
+        slots <<= 1;
+    }
+    SwarmLayout layout = swarmLayout(slots);
+
+    // A segment left by a daemon that died is replaced, not reused: its
+    // viewers would see our sequences restart under them
+    shm_unlink(shmName);
+    int fd = shm_open(shmName, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    if (ftruncate(fd, (off_t)layout.total) != 0) {
+        ::close(fd);
+        shm_unlink(shmName);
+        return false;
+    }
+    void* mapped = mmap(nullptr, layout.total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        shm_unlink(shmName);
+        return false;
+    }
+
+    // ftruncate zero-fills: every sequence starts at 0, every entry unknown
+    base = (uint8_t*)mapped;
+    length = layout.total;
+    strncpy(name, shmName, sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    streams = (SwarmSeqEntry<SwarmStream>*)(base + layout.streams);
+    drones = (SwarmSeqEntry<SwarmDrone>*)(base + layout.drones);
+    links = (SwarmSeqEntry<SwarmLink>*)(base + layout.links);
+    ring = (SwarmEventSlot*)(base + layout.ring);
+    published = 0;
+
+    header = (SwarmShmHeader*)base;
+    header->version = SWARM_SHM_VERSION;
+    header->maxStreams = SWARM_MAX_STREAMS;
+    header->ringSlots = slots;
+    header->eventBytes = sizeof(SwarmEvent);
+    header->totalBytes = layout.total;
+    header->writerPid = (int32_t)getpid();
+    // Viewers check the magic last
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = SWARM_SHM_MAGIC;
+    return true;
+}
+
+void SwarmStateWriter::close() {
+    if (!base) {
+        return;
+    }
+    munmap(base, length);
+    shm_unlink(name);
+    base = nullptr;
+    header = nullptr;
+}
+
+void SwarmStateWriter::publish(const SwarmEvent& event) {
+    SwarmEventSlot& slot = ring[published & (header->ringSlots - 1)];
+    slot.sequence.store(2 * published + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&slot.event, &event, sizeof(event));
+    published++;
+    slot.sequence.store(2 * published, std::memory_order_release);
+    header->published.store(published, std::memory_order_release);
+}
+
+void SwarmStateWriter::writeStream(uint16_t index, const SwarmStream& value) {
+    if (index >= SWARM_MAX_STREAMS) {
+        return;
+    }
+    seqWrite(streams[index], value);
+    header->generation.fetch_add(1, std::memory_order_release);
+}
+
+void SwarmStateWriter::writeDrone(uint8_t id, const SwarmDrone& value) {
+    seqWrite(drones[id], value);
+    header->generation.fetch_add(1, std::memory_order_release);
+}
+
+void SwarmStateWriter::writeLink(uint8_t receiver, uint8_t source, const SwarmLink& value) {
+    seqWrite(links[receiver * SWARM_NODES + source], value);
+    header->generation.fetch_add(1, std::memory_order_release);
+}
+
+// ===== Viewer =====
+
+SwarmViewer::SwarmViewer()
+    : base(nullptr), length(0), header(nullptr), streams(nullptr), drones(nullptr), links(nullptr), ring(nullptr),
+      cursor(0), lost(0) {}
+
+SwarmViewer::~SwarmViewer() {
+    detach();
+}
+
+bool SwarmViewer::attach(const char* shmName, bool fromNewest) {
+    detach();
+    int fd = shm_open(shmName, O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(SwarmShmHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    const SwarmShmHeader* candidate = (const SwarmShmHeader*)mapped;
+    bool valid = candidate->magic == SWARM_SHM_MAGIC;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    valid = valid && candidate->version == SWARM_SHM_VERSION && candidate->eventBytes == sizeof(SwarmEvent) &&
+            candidate->maxStreams == SWARM_MAX_STREAMS &&
+            swarmLayout(candidate->ringSlots).total == (size_t)info.st_size;
+    if (!valid) {
+        munmap(mapped, (size_t)info.st_size);
+        return false;
+    }
+
+    SwarmLayout layout = swarmLayout(candidate->ringSlots);
+    base = (const uint8_t*)mapped;
+    length = (size_t)info.st_size;
+    header = candidate;
+    streams = (const SwarmSeqEntry<SwarmStream>*)(base + layout.streams);
+    drones = (const SwarmSeqEntry<SwarmDrone>*)(base + layout.drones);
+    links = (const SwarmSeqEntry<SwarmLink>*)(base + layout.links);
+    ring = (const SwarmEventSlot*)(base + layout.ring);
+    uint64_t published = header->published.load(std::memory_order_acquire);
+    if (fromNewest) {
+        cursor = published;
+    } else {
+        cursor = published > header->ringSlots ? published - header->ringSlots : 0;
+    }
+    lost = 0;
+    return true;
+}
+
+void SwarmViewer::detach() {
+    if (!base) {
+        return;
+    }
+    munmap((void*)base, length);
+    base = nullptr;
+    header = nullptr;
+}
+
+uint64_t SwarmViewer::backlog() const {
+    return header->published.load(std::memory_order_acquire) - cursor;
+}
+
+bool SwarmViewer::next(const SwarmEvent*& event) {
+    for (;;) {
+        uint64_t published = header->published.load(std::memory_order_acquire);
+        if (cursor >= published) {
+            return false;
+        }
+        if (published - cursor > header->ringSlots) {
+            lost += published - cursor - header->ringSlots;
+            cursor = published - header->ringSlots;
+        }
+        const SwarmEventSlot& slot = ring[cursor & (header->ringSlots - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) == 2 * (cursor + 1)) {
+            event = &slot.event;
+            return true;
+        }
+        // Being overwritten by a later lap
+        lost++;
+        cursor++;
+    }
+}
+
+bool SwarmViewer::confirm() {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const SwarmEventSlot& slot = ring[cursor & (header->ringSlots - 1)];
+    bool intact = slot.sequence.load(std::memory_order_relaxed) == 2 * (cursor + 1);
+    if (!intact) {
+        lost++;
+    }
+    cursor++;
+    return intact;
+}
+
+bool SwarmViewer::readStream(uint16_t index, SwarmStream& out) const {
+    return index < header->maxStreams && seqRead(streams[index], out);
+}
+
+bool SwarmViewer::readDrone(uint8_t id, SwarmDrone& out) const {
+    return seqRead(drones[id], out);
+}
+
+bool SwarmViewer::readLink(uint8_t receiver, uint8_t source, SwarmLink& out) const {
+    return seqRead(links[receiver * SWARM_NODES + source], out);
+}
+
+#endif // ARDUINO
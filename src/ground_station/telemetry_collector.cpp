@@ -0,0 +1,173 @@
+#ifndef ARDUINO
+
+#include "../../include/ground_station/telemetry_collector.h"
+
+static uint32_t cyclesToNs(uint32_t cycles, uint32_t cyclesPerUs) {
+    return cyclesPerUs ? (uint32_t)((uint64_t)cycles * 1000 / cyclesPerUs) : cycles;
+}
+
+PerfSummary telemetrySummarize(const uint32_t* buckets, uint32_t maxCycles, uint32_t cyclesPerUs) {
+    uint32_t total = 0;
+    for (uint16_t i = 0; i < TELEMETRY_BUCKETS; i++) {
+        total += buckets[i];
+    }
+
+    PerfSummary summary = {total, 0, 0, 0, cyclesToNs(maxCycles, cyclesPerUs)};
+    if (total == 0) {
+        return summary;
+    }
+
+    uint32_t ranks[3] = {(total + 1) / 2, (uint32_t)(total * 0.9f + 0.5f), (uint32_t)(total * 0.99f + 0.5f)};
+    uint32_t* outputs[3] = {&summary.p50Ns, &summary.p90Ns, &summary.p99Ns};
+    uint32_t cumulative = 0;
+    uint8_t next = 0;
+    for (uint16_t i = 0; i < TELEMETRY_BUCKETS && next < 3; i++) {
+        cumulative += buckets[i];
+        while (next < 3 && cumulative >= ranks[next] && ranks[next] > 0) {
+            *outputs[next++] = cyclesToNs(perfBucketLow(i, TELEMETRY_HISTOGRAM_SUB_BITS), cyclesPerUs);
+        }
+    }
+    return summary;
+}
+
+TelemetryCollector::TelemetryCollector(uint8_t selfId) : selfId(selfId), sequence(0) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+void TelemetryCollector::buildRequest(uint8_t droneId, uint32_t now, DroneMessage& out) {
+    auto it = drones.find(droneId);
+    uint16_t held = it == drones.end() ? 0 : it->second.heldSnapshot;
+    buildStatusRequest(selfId, droneId, ++sequence, now, STATUS_TELEMETRY_DELTA, held, out);
+    stats.requests++;
+}
+
+bool TelemetryCollector::onFrame(const DroneMessage& msg, uint32_t now) {
+    if (msg.messageType != MSG_STATUS_RESPONSE || msg.destinationId != selfId ||
+        msg.dataLength < sizeof(TelemetryFrameHeader) || msg.dataLength > sizeof(msg.data) ||
+        msg.data[0] != STATUS_TELEMETRY_DELTA) {
+        return false;
+    }
+    TelemetryFrameHeader header;
+    memcpy(&header, msg.data, sizeof(header));
+    if (header.fragmentCount == 0 || header.fragmentCount > 32 || header.fragment >= header.fragmentCount ||
+        header.fragmentCount * TELEMETRY_FRAGMENT_BYTES > TELEMETRY_STREAM_BYTES) {
+        stats.malformed++;
+        return false;
+    }
+    stats.framesReceived++;
+
+    DroneTelemetry& drone = drones[msg.sourceId];
+    if (drone.pendingMask && (header.snapshotId != drone.pendingId || header.baseSnapshot != drone.pendingBase)) {
+        stats.incomplete++;
+        drone.pendingMask = 0;
+    }
+    if (!drone.pendingMask) {
+        drone.pendingId = header.snapshotId;
+        drone.pendingBase = header.baseSnapshot;
+        drone.pendingCount = header.fragmentCount;
+        drone.pendingLength = 0;
+    }
+
+    size_t chunk = msg.dataLength - sizeof(header);
+    size_t offset = header.fragment * TELEMETRY_FRAGMENT_BYTES;
+    memcpy(drone.pending + offset, msg.data + sizeof(header), chunk);
+    if (offset + chunk > drone.pendingLength) {
+        drone.pendingLength = offset + chunk;
+    }
+    drone.pendingMask |= 1u << header.fragment;
+
+    uint32_t all = header.fragmentCount == 32 ? 0xFFFFFFFFu : (1u << header.fragmentCount) - 1;
+    if (drone.pendingMask != all) {
+        return false;
+    }
+    drone.pendingMask = 0;
+    complete(msg.sourceId, drone, now);
+    return true;
+}
+
+void TelemetryCollector::complete(uint8_t droneId, DroneTelemetry& drone, uint32_t now) {
+    if (drone.pendingBase != 0 && drone.pendingBase != drone.heldSnapshot) {
+        // Answer to an older request; our held snapshot is still valid
+        stats.baseMismatches++;
+        return;
+    }
+
+    TelemetrySnapshot before = drone.state;
+    bool hadState = drone.heldSnapshot != 0;
+    if (drone.pendingBase == 0) {
+        memset(&drone.state, 0, sizeof(drone.state));
+        stats.resyncs++;
+    }
+    if (!telemetryApply(drone.state, drone.pending, drone.pendingLength)) {
+        DEBUG_PRINT("[GROUND] Malformed telemetry from drone %d, resyncing\n", droneId);
+        stats.malformed++;
+        drone.heldSnapshot = 0;
+        return;
+    }
+    drone.heldSnapshot = drone.pendingId;
+    stats.snapshotsApplied++;
+
+    TelemetryPoint point;
+    memset(&point, 0, sizeof(point));
+    point.receivedAt = now;
+    point.snapshotId = drone.pendingId;
+    point.resync = drone.pendingBase == 0;
+    point.frames = drone.pendingCount;
+    memcpy(point.counters, drone.state.counters, sizeof(point.counters));
+    point.peerCount = drone.state.peerCount;
+
+    // Interval histograms; a drone reboot shows up as shrinking counts
+    uint32_t cyclesPerUs = drone.state.counters[TEL_CYCLES_PER_US];
+    for (uint8_t p = 0; p < PERF_PROBE_COUNT; p++) {
+        uint32_t interval[TELEMETRY_BUCKETS];
+        bool restarted = !hadState;
+        for (uint16_t b = 0; b < TELEMETRY_BUCKETS && !restarted; b++) {
+            restarted = drone.state.buckets[p][b] < before.buckets[p][b];
+        }
+        for (uint16_t b = 0; b < TELEMETRY_BUCKETS; b++) {
+            interval[b] = drone.state.buckets[p][b] - (restarted ? 0 : before.buckets[p][b]);
+        }
+        point.probes[p] = telemetrySummarize(interval, drone.state.maxCycles[p], cyclesPerUs);
+    }
+    drone.series.push_back(point);
+}
+
+const std::vector<TelemetryPoint>* TelemetryCollector::getSeries(uint8_t droneId) const {
+    auto it = drones.find(droneId);
+    return it == drones.end() ? nullptr : &it->second.series;
+}
+
+const TelemetrySnapshot* TelemetryCollector::getState(uint8_t droneId) const {
+    auto it = drones.find(droneId);
+    return it == drones.end() || it->second.heldSnapshot == 0 ? nullptr : &it->second.state;
+}
+
+void TelemetryCollector::writeCsv(uint8_t droneId, FILE* out) const {
+    const std::vector<TelemetryPoint>* series = getSeries(droneId);
+    if (!series) return;
+
+    fprintf(out, "received_ms,snapshot,resync,frames,uptime_ms,sent,received,lost,preempted,rssi,snr,free_heap,peers");
+    for (uint8_t p = 0; p < PERF_PROBE_COUNT; p++) {
+        const char* name = PerfMonitor::getProbeName((PerfProbe)p);
+        fprintf(out, ",%s_count,%s_p50_ns,%s_p99_ns,%s_max_ns", name, name, name, name);
+    }
+    fprintf(out, "\n");
+
+    for (const TelemetryPoint& point : *series) {
+        const uint32_t* c = point.counters;
+        fprintf(out, "%lu,%u,%d,%u,%lu,%lu,%lu,%lu,%lu,%ld,%.2f,%lu,%u", (unsigned long)point.receivedAt,
+                point.snapshotId, point.resync ? 1 : 0, point.frames, (unsigned long)c[TEL_UPTIME_MS],
+                (unsigned long)c[TEL_MESSAGES_SENT], (unsigned long)c[TEL_MESSAGES_RECEIVED],
+                (unsigned long)c[TEL_MESSAGES_LOST], (unsigned long)c[TEL_MESSAGES_PREEMPTED],
+                (long)(int32_t)c[TEL_LAST_RSSI], (int32_t)c[TEL_LAST_SNR_Q2] / 4.0, (unsigned long)c[TEL_FREE_HEAP],
+                point.peerCount);
+        for (uint8_t p = 0; p < PERF_PROBE_COUNT; p++) {
+            const PerfSummary& s = point.probes[p];
+            fprintf(out, ",%lu,%lu,%lu,%lu", (unsigned long)s.count, (unsigned long)s.p50Ns,
+                    (unsigned long)s.p99Ns, (unsigned long)s.maxNs);
+        }
+        fprintf(out, "\n");
+    }
+}
+
+#endif // ARDUINO
@@ -2,18 +2,59 @@
 // Copy this to src/main.cpp for the second ESP32
 
 #include <Arduino.h>
-#include "../include/communication.h"
-
-// Configuration
-#define NODE_ID 2
-#define HEARTBEAT_INTERVAL 3000 // 3 seconds (different from sender)
-#define STATS_INTERVAL 15000    // 15 seconds
+#include "../include/communications.h"
+#include "../include/target_detection/sensor_integration.h"
+#include "../include/communications/emergency_stop.h"
+#include "../include/utilities/performance_monitor.h"
+#include "../include/communications/status_service.h"
+#include "../include/utilities/debug_utils.h"
+#include "../include/utilities/crypto_utils.h"
+#include "../include/communications/message_sender.h"
+#include "../include/communications/reliable_link.h"
+#include "../include/utilities/flight_recorder.h"
+#include "../include/utilities/warm_state.h"
+#include "../include/utilities/config_override.h"
+#include "../include/communications/ota_service.h"
+#include "../include/communications/link_quality.h"
+#include "../include/communications/duty_cycle.h"
+#include <esp_ota_ops.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include <DroneProtocols.h>
 
 // Global Objects
-DroneComm comm(NODE_ID);
+static const uint8_t networkKey[CRYPTO_KEY_BYTES] = SWARM_NETWORK_KEY;
+SecureLink secureLink(DRONE_CONFIG.id, networkKey);
+DroneComm comm(DRONE_CONFIG.id, &secureLink);
+SensorPipeline sensors;
+MissionStateMachine mission;
+EmergencyStopHandler emergency(DRONE_CONFIG.id, &mission);
+PeerTable peers;
+StatusService statusService(DRONE_CONFIG.id, &perfMonitor, &peers);
+DroneMessage statusFrames[STATUS_MAX_FRAMES];
+MessageRegistry registry;
+MessageSender sender(DRONE_CONFIG.id);
+DroneMessage batchFrames[BATCH_SLOTS];
+AdrController adr(DRONE_CONFIG.id);
+LinkQualityTable linkQuality(DRONE_CONFIG.id);
+DutyCycle dutyCycle(DRONE_CONFIG.id);
+ChannelAccess mac(DRONE_CONFIG.id);
+ReliableLink reliable(DRONE_CONFIG.id);
+DroneMessage reliableFrames[4];
+FecDecoder fecDecoder;
+OtaService ota(DRONE_CONFIG.id);
+PartitionFlash otaStaging;
+PartitionFlash otaRunning;
+PartitionFlash otaNext;
+DroneMessage otaFrames[2];
+PartitionFlash recorderFlash;
+NvsWarmBackup warmBackup;
+WarmStart warmStart(&warmRtcBlock, &warmBackup, {&secureLink, &mission, &emergency, &adr, &peers});
+uint8_t radioSf = LORA_SPREADING_FACTOR;
+int8_t radioPowerDbm = LORA_TX_POWER;
+TunableConfig tuning;
 
 // Timing Variables
-unsigned long lastHeartbeat = 0;
 unsigned long lastStats = 0;
 uint32_t messageCount = 0;
 uint32_t messagesReceived = 0;
@@ -23,21 +64,57 @@ void sendHeartbeat();
 void handleReceivedMessage(const DroneMessage& msg);
 void printSystemInfo();
 void printRangeTestResults();
-String getMessageTypeName(uint8_t type);
-String getStatusName(uint8_t status);
-String formatUptime(unsigned long ms);
+void onHeartbeat(const DroneMessage& msg, PayloadView<HeartbeatData> heartbeat, void* context);
+void onStatusRequest(const DroneMessage& msg, PayloadView<StatusRequestData> request, void* context);
+void onBatch(const DroneMessage& msg, PayloadView<RawPayload> batch, void* context);
+void sendDueBatches(uint32_t now);
+void onReliable(const DroneMessage& msg, PayloadView<RawPayload> frame, void* context);
+void sendDueReliable(uint32_t now);
+void onFec(const DroneMessage& msg, PayloadView<RawPayload> frame, void* context);
+void onLinkState(const DroneMessage& msg, PayloadView<LinkStateData> state, void* context);
+void onOta(const DroneMessage& msg, PayloadView<RawPayload> frame, void* context);
+void beginOta();
+void sendDueOta(uint32_t now);
+void installOta();
+void applyLinkSettings();
+void waitForNextPass(uint32_t listenMs);
+const char* getStatusName(uint8_t status);
+void printRule(char c, uint8_t width);
+const char* formatUptime(unsigned long ms);
 
 void setup() {
     Serial.begin(115200);
     delay(2000); // Wait for serial monitor
     
-    Serial.println("\n" + String("=").repeat(50));
+    Serial.println();
+    printRule('=', 50);
     Serial.println("🚁 DRONE SWARM PROJECT - DAY 1 TESTING");
     Serial.println("    NODE: RECEIVER (ESP32 #2)");
     Serial.println("    ROLE: Communication Testing & Analysis");
-    Serial.println(String("=").repeat(50));
+    printRule('=', 50);
     
     printSystemInfo();
+    perfMonitor.begin();
+    
+    // Before the radio, so the first frames are on record
+    if (!recorderFlash.begin() || !flightRecorder.begin(&recorderFlash, DRONE_CONFIG.id, esp_reset_reason(), millis())) {
+        Serial.println("[INIT] WARNING: Flight recorder unavailable");
+    }
+    
+    // Also before the radio: link epoch and sequence, SF, stop latch, peers
+    WarmSource warm = warmStart.restore(millis(), warmClockUs());
+    Serial.printf("[INIT] %s start, down %lu ms\n", WarmStart::getSourceName(warm),
+                  (unsigned long)warmStart.getDowntimeMs());
+    
+    // Field tuning stored in NVS, on top of the compiled-in config
+    tuning = tunableDefaults();
+    ConfigOverrideResult tuned = loadConfigOverride(DRONE_CONFIG.id, tuning);
+    if (tuned != CONFIG_OVERRIDE_NONE) {
+        Serial.printf("[INIT] Config override: %s\n", getConfigOverrideResultName(tuned));
+    }
+    adr.setMaxTxPower(tuning.maxTxPowerDbm, millis());
+    linkQuality.setHeartbeatInterval(tuning.heartbeatIntervalMs);
+    dutyCycle.setPeriod(tuning.heartbeatIntervalMs);
     
     // Initialize communication
     Serial.println("\n[INIT] Initializing communication system...");
@@ -49,6 +126,34 @@ void setup() {
             Serial.print(".");
         }
     }
+    applyLinkSettings();    // A restored SF takes effect before the first frame
+    
+    sensors.begin();
+    
+    // Stops are handled in the radio task from here on
+    if (!comm.enableEmergencyFastPath(&emergency)) {
+        Serial.println("[INIT] WARNING: Emergency fast path unavailable");
+    } else if (!comm.setChannelAccess(&mac)) {
+        Serial.println("[INIT] WARNING: Listen before talk unavailable");
+    }
+    // Windows start now; duty cycling sleeps between them once the sync listen is over
+    bool dutyCycling = DUTY_CYCLE_ENABLED && comm.setDutyCycle(&dutyCycle);
+    if (DUTY_CYCLE_ENABLED && !dutyCycling) {
+        Serial.println("[INIT] WARNING: Duty cycling unavailable");
+    }
+    dutyCycle.begin(millis(), dutyCycling);
+    registry.on<MSG_HEARTBEAT, onHeartbeat>();
+    registry.on<MSG_STATUS_REQUEST, onStatusRequest>();
+    registry.on<MSG_BATCH, onBatch>();
+    registry.on<MSG_LINK_STATE, onLinkState>();
+    registry.on<MSG_RELIABLE, onReliable>();
+    registry.on<MSG_FEC, onFec>();
+    registry.on<MSG_OTA, onOta>();
+    reliable.seed(esp_random());
+    beginOta();
+    if (mission.getState() == MISSION_IDLE) {
+        mission.transition(MISSION_LISTENING);
+    }
     
     Serial.println("[INIT] ✅ System ready - Starting communication test...");
     Serial.println("[INIT] Sending heartbeat every 3 seconds");
@@ -58,13 +163,49 @@ void setup() {
 
 void loop() {
     unsigned long currentTime = millis();
+    scratchArena.reset();
     
-    // Send heartbeat messages (less frequent than sender)
-    if (currentTime - lastHeartbeat >= HEARTBEAT_INTERVAL) {
+    // Drain GPS/baro rings and publish the fused position
+    sensors.poll(currentTime);
+    
+    // Send heartbeat messages (less frequent than sender, unless duty
+    // cycling: then as each wake window opens)
+    if (dutyCycle.heartbeatDue(currentTime)) {
         sendHeartbeat();
-        lastHeartbeat = currentTime;
+        peers.expire(currentTime);
+        fecDecoder.expire(currentTime);
     }
     
+    // Reception windows close; silent neighbours are forgotten
+    linkQuality.update(currentTime);
+    
+    // Spreading factor and power follow the neighbours' link margins
+    adr.update(currentTime);
+    applyLinkSettings();
+    
+    // Small messages wait up to BATCH_MAX_DELAY_MS to share a frame
+    sendDueBatches(currentTime);
+    
+    // Acknowledged unicast: retransmissions and acks that are due
+    sendDueReliable(currentTime);
+    
+    // Update adverts, requests and chunks; a complete delta is applied in steps
+    ota.service();
+    installOta();
+    sendDueOta(currentTime);
+    
+    // Print queued log lines outside the message path
+    debugLogFlush(4);
+    
+    // Recorded events reach flash a page at a time
+    flightRecorder.service(currentTime);
+    
+    // Link epoch roll and its NVS write, kept off the send paths
+    comm.serviceEpoch();
+    
+    // RTC snapshot for a warm restart; flash only when the durable part changed
+    warmStart.service(currentTime, warmClockUs());
+    
     // Check for incoming messages (primary function)
     DroneMessage receivedMsg;
     if (comm.receiveMessage(receivedMsg)) {
@@ -73,45 +214,157 @@ void loop() {
     }
     
     // Print comprehensive statistics
-    if (currentTime - lastStats >= STATS_INTERVAL) {
+    if (currentTime - lastStats >= STATS_INTERVAL_MS) {
         printDetailedStats();
         lastStats = currentTime;
     }
     
-    delay(50); // Faster polling for better reception
+    waitForNextPass(50); // Faster polling for better reception
 }
 
 void sendHeartbeat() {
     HeartbeatData heartbeat;
-    heartbeat.droneId = NODE_ID;
+    heartbeat.droneId = DRONE_CONFIG.id;
     heartbeat.batteryLevel = 92.3 + (random(-30, 30) / 10.0); // Simulated battery
-    heartbeat.latitude = 28.7041 + (random(-200, 200) / 10000.0); // Delhi + offset
-    heartbeat.longitude = 77.1025 + (random(-200, 200) / 10000.0);
+    
+    FusedSensorState position;
+    if (sensors.getLatest(position) && position.hasFix) {
+        heartbeat.latitude = position.latitudeE7 / 1e7;
+        heartbeat.longitude = position.longitudeE7 / 1e7;
+    } else {
+        // No GPS fix yet - keep the simulated position
+        heartbeat.latitude = 28.7041 + (random(-200, 200) / 10000.0); // Delhi + offset
+        heartbeat.longitude = 77.1025 + (random(-200, 200) / 10000.0);
+    }
     heartbeat.status = 0; // OK status
-    heartbeat.missionState = 2; // Listening mode
+    heartbeat.missionState = mission.getState();
     
     messageCount++;
     
     Serial.printf("\n[TX] 📡 Sending response heartbeat #%lu\n", messageCount);
     Serial.printf("[TX]    Battery: %.1f%%\n", heartbeat.batteryLevel);
     
-    if (comm.broadcastMessage(MSG_HEARTBEAT, &heartbeat, sizeof(heartbeat))) {
+    // A slice of our link row rides along in the same frame
+    uint8_t payload[sizeof(HeartbeatData) + LINK_ROW_MAX_BYTES];
+    memcpy(payload, &heartbeat, sizeof(heartbeat));
+    uint8_t rowEntries = linkQuality.fillRow((LinkRowEntry*)(payload + sizeof(heartbeat)), LINK_ROW_ENTRIES);
+    uint8_t length = sizeof(heartbeat) + rowEntries * sizeof(LinkRowEntry);
+    
+    if (sender.queue(0xFF, MSG_HEARTBEAT, payload, length, millis())) {
+        Serial.println("[TX] ✅ Response heartbeat queued");
+    } else if (comm.broadcastMessage(MSG_HEARTBEAT, payload, length)) {
         Serial.println("[TX] ✅ Response heartbeat sent");
     } else {
         Serial.println("[TX] ❌ Failed to send response heartbeat");
     }
+    
+    // Rides in the same batch frame as the heartbeat
+    LinkStateData linkState;
+    adr.fillLinkState(linkState, millis());
+    if (!sender.queue(0xFF, MSG_LINK_STATE, &linkState, sizeof(linkState), millis())) {
+        comm.broadcastMessage(MSG_LINK_STATE, &linkState, sizeof(linkState));
+    }
+}
+
+// Only while the radio is free: batches keep filling while a frame is on air.
+// Duty cycling holds them, and update frames, for a wake window; reliable
+// unicast goes when DutyCycle polls for it.
+void sendDueBatches(uint32_t now) {
+    if (comm.isTransmitting() || !dutyCycle.mayTransmit(now)) {
+        return;
+    }
+    uint8_t frames = sender.poll(now, batchFrames, BATCH_SLOTS);
+    for (uint8_t i = 0; i < frames; i++) {
+        comm.sendMessage(batchFrames[i]);
+    }
+}
+
+void sendDueReliable(uint32_t now) {
+    if (comm.isTransmitting() || !dutyCycle.mayTransmitUnicast(now)) {
+        return;
+    }
+    uint8_t frames = reliable.poll(now, reliableFrames, sizeof(reliableFrames) / sizeof(reliableFrames[0]));
+    for (uint8_t i = 0; i < frames; i++) {
+        comm.sendMessage(reliableFrames[i]);
+    }
+}
+
+void sendDueOta(uint32_t now) {
+    if (comm.isTransmitting() || !dutyCycle.mayTransmit(now)) {
+        return;
+    }
+    uint8_t frames = ota.poll(now, otaFrames, sizeof(otaFrames) / sizeof(otaFrames[0]));
+    for (uint8_t i = 0; i < frames; i++) {
+        comm.sendMessage(otaFrames[i]);
+    }
+}
+
+// Staging delta, running image, other app slot. An update completed before
+// a restart is served again; a half-received one is fetched anew.
+void beginOta() {
+    bool staged = otaStaging.begin(esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                            OTA_PARTITION_LABEL));
+    bool slots = otaRunning.begin(esp_ota_get_running_partition()) &&
+                 otaNext.begin(esp_ota_get_next_update_partition(nullptr));
+    if (!staged) {
+        Serial.println("[INIT] WARNING: No OTA staging partition, updates are not relayed");
+    }
+    ota.seed(esp_random());
+    ota.begin(staged ? &otaStaging : nullptr, slots ? &otaRunning : nullptr, slots ? &otaNext : nullptr, millis());
+    uint16_t installed = loadOtaVersion();
+    if (installed && ota.publish(millis(), installed)) {
+        Serial.printf("[INIT] Serving update %u\n", installed);
+    }
+}
+
+// A verified update: firmware boots from the other slot after the next
+// restart, parameters are stored and take effect at once
+void installOta() {
+    if (ota.getState() != OTA_READY) {
+        return;
+    }
+    if (ota.getKind() == OTA_KIND_FIRMWARE) {
+        esp_err_t result = esp_ota_set_boot_partition(esp_ota_get_next_update_partition(nullptr));
+        Serial.printf("[OTA] Update %u %s\n", ota.getVersion(),
+                      result == ESP_OK ? "installed, active after the next restart" : "not bootable");
+    } else {
+        TunableConfig next = tunableDefaults();
+        ConfigOverrideResult result = storeConfigOverride(ota.getParameters(), ota.getParametersLength(), DRONE_CONFIG.id);
+        if (result == CONFIG_OVERRIDE_OK &&
+            applyConfigOverride(ota.getParameters(), ota.getParametersLength(), DRONE_CONFIG.id, next) == CONFIG_OVERRIDE_OK) {
+            tuning = next;
+            adr.setMaxTxPower(tuning.maxTxPowerDbm, millis());
+            linkQuality.setHeartbeatInterval(tuning.heartbeatIntervalMs);
+            dutyCycle.setPeriod(tuning.heartbeatIntervalMs);
+        }
+        Serial.printf("[OTA] Parameters %u: %s\n", ota.getVersion(), getConfigOverrideResultName(result));
+    }
+    storeOtaVersion(ota.getVersion());
+    ota.markInstalled();
+}
+
+// Pushes the ADR choice to the radio; an SF change waits for the channel
+void applyLinkSettings() {
+    if (adr.getSpreadingFactor() != radioSf && comm.setSpreadingFactor(adr.getSpreadingFactor())) {
+        radioSf = adr.getSpreadingFactor();
+    }
+    if (adr.getTxPowerDbm() != radioPowerDbm) {
+        radioPowerDbm = adr.getTxPowerDbm();
+        comm.setTxPower(radioPowerDbm);
+    }
 }
 
 void handleReceivedMessage(const DroneMessage& msg) {
+    PERF_SCOPE(PERF_DISPATCH);
     Serial.printf("\n🎯 [RX #%lu] Message from Drone %d\n", messagesReceived, msg.sourceId);
-    Serial.println(String("-").repeat(40));
+    printRule('-', 40);
     
     // Message details
     Serial.printf("📋 Message Info:\n");
     Serial.printf("   Type: %s (0x%02X)\n", 
-                  getMessageTypeName(msg.messageType).c_str(), msg.messageType);
+                  messageTypeName(msg.messageType), msg.messageType);
     Serial.printf("   Sequence: %d\n", msg.sequenceNumber);
-    Serial.printf("   Timestamp: %s\n", formatUptime(msg.timestamp).c_str());
+    Serial.printf("   Timestamp: %s\n", formatUptime(msg.timestamp));
     Serial.printf("   Data Size: %d bytes\n", msg.dataLength);
     Serial.printf("   Checksum: 0x%02X\n", msg.checksum);
     
@@ -138,32 +391,132 @@ void handleReceivedMessage(const DroneMessage& msg) {
     float estimatedDistance = pow(10, (rssi + 30) / -20.0);
     Serial.printf("\n   Est. Distance: %.0f meters\n", estimatedDistance);
     
-    // Parse message content
-    if (msg.messageType == MSG_HEARTBEAT && msg.dataLength == sizeof(HeartbeatData)) {
-        HeartbeatData* heartbeat = (HeartbeatData*)msg.data;
-        Serial.printf("\n💓 Heartbeat Details:\n");
-        Serial.printf("   Drone ID: %d\n", heartbeat->droneId);
-        Serial.printf("   Battery: %.1f%%\n", heartbeat->batteryLevel);
-        Serial.printf("   GPS: (%.6f, %.6f)\n", 
-                      heartbeat->latitude, heartbeat->longitude);
-        Serial.printf("   Status: %s\n", getStatusName(heartbeat->status).c_str());
-        Serial.printf("   Mission: State %d\n", heartbeat->missionState);
-        
-        // Calculate time since message was sent
-        unsigned long latency = millis() - msg.timestamp;
-        Serial.printf("   Latency: %lu ms\n", latency);
-    }
-    
-    Serial.println(String("-").repeat(40));
+    // Every frame heard feeds the link estimate, whoever it was for
+    linkQuality.onFrame(msg.sourceId, msg.sequenceNumber, comm.getRSSI(), comm.getSNR(), millis());
+    
+    // Payload decoding and length checks live in the registry handlers
+    registry.dispatch(msg);
+    
+    printRule('-', 40);
     Serial.println("✅ Message processed successfully\n");
 }
 
+void onHeartbeat(const DroneMessage& msg, PayloadView<HeartbeatData> heartbeat, void* context) {
+    Serial.printf("\n💓 Heartbeat Details:\n");
+    Serial.printf("   Drone ID: %d\n", heartbeat.get(&HeartbeatData::droneId));
+    Serial.printf("   Battery: %.1f%%\n", heartbeat.get(&HeartbeatData::batteryLevel));
+    Serial.printf("   GPS: (%.6f, %.6f)\n", 
+                  heartbeat.get(&HeartbeatData::latitude), heartbeat.get(&HeartbeatData::longitude));
+    Serial.printf("   Status: %s\n", getStatusName(heartbeat.get(&HeartbeatData::status)));
+    Serial.printf("   Mission: State %d\n", heartbeat.get(&HeartbeatData::missionState));
+    peers.update(heartbeat.load(), comm.getRSSI(), comm.getSNR(), millis());
+    linkQuality.onRow(msg.sourceId, heartbeat.data() + sizeof(HeartbeatData), heartbeat.size() - sizeof(HeartbeatData),
+                      millis());
+    
+    // Calculate time since message was sent
+    unsigned long latency = millis() - msg.timestamp;
+    Serial.printf("   Latency: %lu ms\n", latency);
+}
+
+// Telemetry pull from the ground station
+void onStatusRequest(const DroneMessage& msg, PayloadView<StatusRequestData> request, void* context) {
+    uint8_t frames = statusService.handleRequest(msg, comm.getStats(), millis(), statusFrames);
+    for (uint8_t i = 0; i < frames; i++) {
+        comm.sendMessage(statusFrames[i]);
+    }
+    Serial.printf("\n📤 Status reply: %d frame(s)\n", frames);
+}
+
+void onLinkState(const DroneMessage& msg, PayloadView<LinkStateData> state, void* context) {
+    LinkStateData link = state.load();
+    // The signal this link state arrived with, not that of a frame queued behind it
+    adr.onLinkState(msg.sourceId, link, comm.getRSSI(), comm.getSNR(), millis());
+    dutyCycle.onSchedule(link.wakeInMs, comm.getLastReceivedAt(), millis());
+}
+
+// Listening: a short delay between passes. Duty cycling: the radio sleeps,
+// or samples for a wake preamble, and the CPU light-sleeps until the next
+// window, sample or unicast poll; console input waits in the UART FIFO.
+// Light sleep stops every task, so it ends for the emergency task's next
+// copy too, and DIO0 (TX done) wakes the CPU for it.
+void waitForNextPass(uint32_t listenMs) {
+    uint32_t now = millis();
+    if (comm.channelActive()) {
+        dutyCycle.onActivity(now);
+    }
+    DutyAction action = dutyCycle.poll(now);
+    if (action == DUTY_SAMPLE) {
+        dutyCycle.onSampled(comm.sampleChannel(), millis());
+        now = millis();
+        action = dutyCycle.poll(now);
+    }
+    uint32_t wait = dutyCycle.nextEventIn(now, reliable.nextDueIn(now) == 0);
+    uint32_t stopIn = comm.emergencyIdleFor(now);
+    wait = stopIn < wait ? stopIn : wait;
+    if (action == DUTY_LISTEN || wait * 1000 <= POWER_WAKE_US) {
+        comm.wakeRadio();
+        delay(wait < listenMs ? wait : listenMs);
+        return;
+    }
+    comm.sleepRadio();
+    Serial.flush();
+    esp_sleep_enable_timer_wakeup((uint64_t)wait * 1000);
+    gpio_wakeup_enable((gpio_num_t)LORA_DIO0, GPIO_INTR_HIGH_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+    esp_light_sleep_start();
+}
+
+// Several logical messages in one frame: each goes through the registry
+void onBatch(const DroneMessage& msg, PayloadView<RawPayload> batch, void* context) {
+    BatchReader reader(msg);
+    DroneMessage records[8];
+    size_t count = 0;
+    while (reader.next(records[count])) {
+        if (++count == sizeof(records) / sizeof(records[0])) {
+            registry.dispatch(records, count);
+            count = 0;
+        }
+    }
+    registry.dispatch(records, count);
+}
+
+// Acks are handled inside; a new message goes through the registry once
+void onReliable(const DroneMessage& msg, PayloadView<RawPayload> frame, void* context) {
+    DroneMessage inner;
+    if (reliable.onFrame(msg, millis(), inner) == RELIABLE_DELIVER) {
+        registry.dispatch(inner);
+    }
+}
+
+void onOta(const DroneMessage& msg, PayloadView<RawPayload> frame, void* context) {
+    ota.onFrame(msg, millis());
+}
+
+// Coded multi-frame broadcasts; a message that fits one frame is dispatched
+void onFec(const DroneMessage& msg, PayloadView<RawPayload> frame, void* context) {
+    FecMessage rebuilt;
+    if (fecDecoder.add(msg, millis(), rebuilt) != FEC_COMPLETE) {
+        return;
+    }
+    Serial.printf("[RX]    🧩 %s rebuilt: %u bytes\n", messageTypeName(rebuilt.type), rebuilt.length);
+    if (rebuilt.length <= DP_MAX_PAYLOAD) {
+        DroneMessage inner = msg;
+        inner.messageType = rebuilt.type;
+        inner.dataLength = (uint8_t)rebuilt.length;
+        memset(inner.data, 0, sizeof(inner.data));
+        memcpy(inner.data, rebuilt.data, rebuilt.length);
+        inner.checksum = droneMessageChecksum(inner);
+        registry.dispatch(inner);
+    }
+}
+
 void printDetailedStats() {
     CommStats stats = comm.getStats();
     
-    Serial.println("\n" + String("=").repeat(60));
+    Serial.println();
+    printRule('=', 60);
     Serial.println("📊 DETAILED COMMUNICATION ANALYSIS");
-    Serial.println(String("=").repeat(60));
+    printRule('=', 60);
     
     // Basic statistics
     Serial.printf("🔢 Message Statistics:\n");
@@ -183,11 +536,14 @@ void printDetailedStats() {
     
     // System status
     Serial.printf("\n💻 System Status:\n");
-    Serial.printf("   Uptime: %s\n", formatUptime(millis()).c_str());
+    Serial.printf("   Uptime: %s\n", formatUptime(millis()));
     Serial.printf("   Free Heap: %d bytes\n", ESP.getFreeHeap());
     Serial.printf("   Node ID: %d\n", comm.getNodeId());
     
-    Serial.println(String("=").repeat(60) + "\n");
+    printRule('=', 60);
+    Serial.println();
+    perfMonitor.printReport();
+    printMemoryPools();
 }
 
 void printSystemInfo() {
@@ -199,24 +555,7 @@ void printSystemInfo() {
     Serial.printf("   SDK: %s\n", ESP.getSdkVersion());
 }
 
-String getMessageTypeName(uint8_t type) {
-    switch (type) {
-        case MSG_HEARTBEAT: return "HEARTBEAT";
-        case MSG_GOSSIP: return "GOSSIP";
-        case MSG_MUTEX_REQUEST: return "MUTEX_REQUEST";
-        case MSG_MUTEX_RESPONSE: return "MUTEX_RESPONSE";
-        case MSG_RAFT_VOTE_REQUEST: return "RAFT_VOTE_REQUEST";
-        case MSG_RAFT_VOTE_RESPONSE: return "RAFT_VOTE_RESPONSE";
-        case MSG_MISSION_UPDATE: return "MISSION_UPDATE";
-        case MSG_TARGET_FOUND: return "TARGET_FOUND";
-        case MSG_EMERGENCY_STOP: return "EMERGENCY_STOP";
-        case MSG_STATUS_REQUEST: return "STATUS_REQUEST";
-        case MSG_STATUS_RESPONSE: return "STATUS_RESPONSE";
-        default: return "UNKNOWN";
-    }
-}
-
-String getStatusName(uint8_t status) {
+const char* getStatusName(uint8_t status) {
     switch (status) {
         case 0: return "OK";
         case 1: return "WARNING";
@@ -225,7 +564,7 @@ String getStatusName(uint8_t status) {
     }
 }
 
-String formatUptime(unsigned long ms) {
+const char* formatUptime(unsigned long ms) {
     unsigned long seconds = ms / 1000;
     unsigned long minutes = seconds / 60;
     unsigned long hours = minutes / 60;
@@ -233,5 +572,12 @@ String formatUptime(unsigned long ms) {
     seconds %= 60;
     minutes %= 60;
     
-    return String(hours) + "h " + String(minutes) + "m " + String(seconds) + "s";
+    return scratchArena.format("%luh %lum %lus", hours, minutes, seconds);
+}
+
+void printRule(char c, uint8_t width) {
+    for (uint8_t i = 0; i < width; i++) {
+        Serial.write(c);
+    }
+    Serial.println();
 }
@@ -1,16 +1,57 @@
 #include <Arduino.h>
-#include "../include/communication.h"
-
-// Configuration
-#define NODE_ID 1
-#define HEARTBEAT_INTERVAL 2000 // 2 seconds
-#define STATS_INTERVAL 10000    // 10 seconds
+#include "../include/communications.h"
+#include "../include/target_detection/sensor_integration.h"
+#include "../include/communications/emergency_stop.h"
+#include "../include/utilities/performance_monitor.h"
+#include "../include/communications/status_service.h"
+#include "../include/utilities/debug_utils.h"
+#include "../include/utilities/crypto_utils.h"
+#include "../include/communications/message_sender.h"
+#include "../include/communications/reliable_link.h"
+#include "../include/utilities/flight_recorder.h"
+#include "../include/utilities/warm_state.h"
+#include "../include/utilities/config_override.h"
+#include "../include/communications/ota_service.h"
+#include "../include/communications/link_quality.h"
+#include "../include/communications/duty_cycle.h"
+#include <esp_ota_ops.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include <DroneProtocols.h>
 
 // Global Objects
-DroneComm comm(NODE_ID);
+static const uint8_t networkKey[CRYPTO_KEY_BYTES] = SWARM_NETWORK_KEY;
+SecureLink secureLink(DRONE_CONFIG.id, networkKey);
+DroneComm comm(DRONE_CONFIG.id, &secureLink);
+SensorPipeline sensors;
+MissionStateMachine mission;
+EmergencyStopHandler emergency(DRONE_CONFIG.id, &mission);
+PeerTable peers;
+StatusService statusService(DRONE_CONFIG.id, &perfMonitor, &peers);
+DroneMessage statusFrames[STATUS_MAX_FRAMES];
+MessageRegistry registry;
+MessageSender sender(DRONE_CONFIG.id);
+DroneMessage batchFrames[BATCH_SLOTS];
+AdrController adr(DRONE_CONFIG.id);
+LinkQualityTable linkQuality(DRONE_CONFIG.id);
+DutyCycle dutyCycle(DRONE_CONFIG.id);
+ChannelAccess mac(DRONE_CONFIG.id);
+ReliableLink reliable(DRONE_CONFIG.id);
+DroneMessage reliableFrames[4];
+FecDecoder fecDecoder;
+OtaService ota(DRONE_CONFIG.id);
+PartitionFlash otaStaging;
+PartitionFlash otaRunning;
+PartitionFlash otaNext;
+DroneMessage otaFrames[2];
+PartitionFlash recorderFlash;
+NvsWarmBackup warmBackup;
+WarmStart warmStart(&warmRtcBlock, &warmBackup, {&secureLink, &mission, &emergency, &adr, &peers});
+uint8_t radioSf = LORA_SPREADING_FACTOR;
+int8_t radioPowerDbm = LORA_TX_POWER;
+TunableConfig tuning;
 
 // Timing Variables
-unsigned long lastHeartbeat = 0;
 unsigned long lastStats = 0;
 uint32_t messageCount = 0;
 
@@ -18,20 +59,57 @@ uint32_t messageCount = 0;
 void sendHeartbeat();
 void handleReceivedMessage(const DroneMessage& msg);
 void printSystemInfo();
-String getMessageTypeName(uint8_t type);
-String getStatusName(uint8_t status);
+void onHeartbeat(const DroneMessage& msg, PayloadView<HeartbeatData> heartbeat, void* context);
+void onStatusRequest(const DroneMessage& msg, PayloadView<StatusRequestData> request, void* context);
+void onBatch(const DroneMessage& msg, PayloadView<RawPayload> batch, void* context);
+void sendDueBatches(uint32_t now);
+void onReliable(const DroneMessage& msg, PayloadView<RawPayload> frame, void* context);
+void sendDueReliable(uint32_t now);
+void onFec(const DroneMessage& msg, PayloadView<RawPayload> frame, void* context);
+void onLinkState(const DroneMessage& msg, PayloadView<LinkStateData> state, void* context);
+void onOta(const DroneMessage& msg, PayloadView<RawPayload> frame, void* context);
+void beginOta();
+void sendDueOta(uint32_t now);
+void installOta();
+void applyLinkSettings();
+void waitForNextPass(uint32_t listenMs);
+void applyTuning(const char* hex);
+const char* getStatusName(uint8_t status);
+void printRule(char c, uint8_t width);
 
 void setup() {
     Serial.begin(115200);
     delay(2000); // Wait for serial monitor
     
-    Serial.println("\n" + String("=").repeat(50));
+    Serial.println();
+    printRule('=', 50);
     Serial.println("🚁 DRONE SWARM PROJECT - DAY 1 TESTING");
     Serial.println("    NODE: SENDER (ESP32 #1)");
     Serial.println("    ROLE: Communication & Infrastructure");
-    Serial.println(String("=").repeat(50));
+    printRule('=', 50);
     
     printSystemInfo();
+    perfMonitor.begin();
+    
+    // Before the radio, so the first frames are on record
+    if (!recorderFlash.begin() || !flightRecorder.begin(&recorderFlash, DRONE_CONFIG.id, esp_reset_reason(), millis())) {
+        Serial.println("[INIT] WARNING: Flight recorder unavailable");
+    }
+    
+    // Also before the radio: link epoch and sequence, SF, stop latch, peers
+    WarmSource warm = warmStart.restore(millis(), warmClockUs());
+    Serial.printf("[INIT] %s start, down %lu ms\n", WarmStart::getSourceName(warm),
+                  (unsigned long)warmStart.getDowntimeMs());
+    
+    // Field tuning stored in NVS, on top of the compiled-in config
+    tuning = tunableDefaults();
+    ConfigOverrideResult tuned = loadConfigOverride(DRONE_CONFIG.id, tuning);
+    if (tuned != CONFIG_OVERRIDE_NONE) {
+        Serial.printf("[INIT] Config override: %s\n", getConfigOverrideResultName(tuned));
+    }
+    adr.setMaxTxPower(tuning.maxTxPowerDbm, millis());
+    linkQuality.setHeartbeatInterval(tuning.heartbeatIntervalMs);
+    dutyCycle.setPeriod(tuning.heartbeatIntervalMs);
     
     // Initialize communication
     Serial.println("\n[INIT] Initializing communication system...");
@@ -43,6 +121,34 @@ void setup() {
             Serial.print(".");
         }
     }
+    applyLinkSettings();    // A restored SF takes effect before the first frame
+    
+    sensors.begin();
+    
+    // Stops are handled in the radio task from here on
+    if (!comm.enableEmergencyFastPath(&emergency)) {
+        Serial.println("[INIT] WARNING: Emergency fast path unavailable");
+    } else if (!comm.setChannelAccess(&mac)) {
+        Serial.println("[INIT] WARNING: Listen before talk unavailable");
+    }
+    // Windows start now; duty cycling sleeps between them once the sync listen is over
+    bool dutyCycling = DUTY_CYCLE_ENABLED && comm.setDutyCycle(&dutyCycle);
+    if (DUTY_CYCLE_ENABLED && !dutyCycling) {
+        Serial.println("[INIT] WARNING: Duty cycling unavailable");
+    }
+    dutyCycle.begin(millis(), dutyCycling);
+    registry.on<MSG_HEARTBEAT, onHeartbeat>();
+    registry.on<MSG_STATUS_REQUEST, onStatusRequest>();
+    registry.on<MSG_BATCH, onBatch>();
+    registry.on<MSG_LINK_STATE, onLinkState>();
+    registry.on<MSG_RELIABLE, onReliable>();
+    registry.on<MSG_FEC, onFec>();
+    registry.on<MSG_OTA, onOta>();
+    reliable.seed(esp_random());
+    beginOta();
+    if (mission.getState() == MISSION_IDLE) {
+        mission.transition(MISSION_ACTIVE);
+    }
     
     Serial.println("[INIT] ✅ System ready - Starting communication test...");
     Serial.println("[INIT] Sending heartbeat every 2 seconds");
@@ -51,11 +157,69 @@ void setup() {
 
 void loop() {
     unsigned long currentTime = millis();
+    scratchArena.reset();
+    
+    // Drain GPS/baro rings and publish the fused position
+    sensors.poll(currentTime);
     
-    // Send heartbeat messages
-    if (currentTime - lastHeartbeat >= HEARTBEAT_INTERVAL) {
+    // Send heartbeat messages; duty cycling sends them as each wake window opens
+    if (dutyCycle.heartbeatDue(currentTime)) {
         sendHeartbeat();
-        lastHeartbeat = currentTime;
+        peers.expire(currentTime);
+        fecDecoder.expire(currentTime);
+    }
+    
+    // Reception windows close; silent neighbours are forgotten
+    linkQuality.update(currentTime);
+    
+    // Spreading factor and power follow the neighbours' link margins
+    adr.update(currentTime);
+    applyLinkSettings();
+    
+    // Small messages wait up to BATCH_MAX_DELAY_MS to share a frame
+    sendDueBatches(currentTime);
+    
+    // Acknowledged unicast: retransmissions and acks that are due
+    sendDueReliable(currentTime);
+    
+    // Update adverts, requests and chunks; a complete delta is applied in steps
+    ota.service();
+    installOta();
+    sendDueOta(currentTime);
+    
+    // Print queued log lines outside the message path
+    debugLogFlush(4);
+    
+    // Recorded events reach flash a page at a time
+    flightRecorder.service(currentTime);
+    
+    // Link epoch roll and its NVS write, kept off the send paths
+    comm.serviceEpoch();
+    
+    // RTC snapshot for a warm restart; flash only when the durable part changed
+    warmStart.service(currentTime, warmClockUs());
+    
+    // Operator console: 'S' stops the whole swarm; 'T' and a blob from
+    // config_generator.py override stores field tuning, 'T' alone clears it;
+    // 'U' serves the update written to the staging partition by ota_delta.py
+    if (Serial.available()) {
+        int command = Serial.read();
+        if (command == 'S') {
+            Serial.println("[TX] 🛑 Emergency stop requested");
+            comm.triggerEmergencyStop(ESTOP_REASON_OPERATOR);
+        } else if (command == 'T') {
+            // Fixed buffer: no String allocation on the flight loop
+            char hex[CONFIG_OVERRIDE_MAX_BYTES * 2 + 4];
+            size_t length = Serial.readBytesUntil('\n', hex, sizeof(hex) - 1);
+            hex[length] = '\0';
+            applyTuning(hex);
+        } else if (command == 'U') {
+            if (ota.publish(millis())) {
+                Serial.printf("[TX] Serving update %u: %u pages\n", ota.getVersion(), ota.getPageCount());
+            } else {
+                Serial.println("[TX] No valid update in the staging partition");
+            }
+        }
     }
     
     // Check for incoming messages
@@ -65,56 +229,187 @@ void loop() {
     }
     
     // Print statistics periodically
-    if (currentTime - lastStats >= STATS_INTERVAL) {
+    if (currentTime - lastStats >= STATS_INTERVAL_MS) {
         comm.printStats();
         lastStats = currentTime;
     }
     
-    delay(100); // Small delay to prevent overwhelming the system
+    waitForNextPass(100); // Small delay to prevent overwhelming the system
 }
 
 void sendHeartbeat() {
     HeartbeatData heartbeat;
-    heartbeat.droneId = NODE_ID;
+    heartbeat.droneId = DRONE_CONFIG.id;
     heartbeat.batteryLevel = 85.5 + (random(-50, 50) / 10.0); // Simulated battery
-    heartbeat.latitude = 28.7041 + (random(-100, 100) / 10000.0); // Delhi + offset
-    heartbeat.longitude = 77.1025 + (random(-100, 100) / 10000.0);
+    
+    FusedSensorState position;
+    if (sensors.getLatest(position) && position.hasFix) {
+        heartbeat.latitude = position.latitudeE7 / 1e7;
+        heartbeat.longitude = position.longitudeE7 / 1e7;
+    } else {
+        // No GPS fix yet - keep the simulated position
+        heartbeat.latitude = 28.7041 + (random(-100, 100) / 10000.0); // Delhi + offset
+        heartbeat.longitude = 77.1025 + (random(-100, 100) / 10000.0);
+    }
     heartbeat.status = 0; // OK status
-    heartbeat.missionState = 1; // Active
+    heartbeat.missionState = mission.getState();
     
     messageCount++;
     
     Serial.printf("\n[TX] 📡 Sending heartbeat #%lu\n", messageCount);
     Serial.printf("[TX]    Battery: %.1f%%\n", heartbeat.batteryLevel);
     Serial.printf("[TX]    Location: (%.6f, %.6f)\n", heartbeat.latitude, heartbeat.longitude);
-    Serial.printf("[TX]    Status: %s\n", getStatusName(heartbeat.status).c_str());
+    Serial.printf("[TX]    Status: %s\n", getStatusName(heartbeat.status));
     
-    if (comm.broadcastMessage(MSG_HEARTBEAT, &heartbeat, sizeof(heartbeat))) {
+    // A slice of our link row rides along in the same frame
+    uint8_t payload[sizeof(HeartbeatData) + LINK_ROW_MAX_BYTES];
+    memcpy(payload, &heartbeat, sizeof(heartbeat));
+    uint8_t rowEntries = linkQuality.fillRow((LinkRowEntry*)(payload + sizeof(heartbeat)), LINK_ROW_ENTRIES);
+    uint8_t length = sizeof(heartbeat) + rowEntries * sizeof(LinkRowEntry);
+    
+    if (sender.queue(0xFF, MSG_HEARTBEAT, payload, length, millis())) {
+        Serial.println("[TX] ✅ Heartbeat queued");
+    } else if (comm.broadcastMessage(MSG_HEARTBEAT, payload, length)) {
         Serial.println("[TX] ✅ Heartbeat sent successfully");
     } else {
         Serial.println("[TX] ❌ Failed to send heartbeat");
     }
+    
+    // Rides in the same batch frame as the heartbeat
+    LinkStateData linkState;
+    adr.fillLinkState(linkState, millis());
+    if (!sender.queue(0xFF, MSG_LINK_STATE, &linkState, sizeof(linkState), millis())) {
+        comm.broadcastMessage(MSG_LINK_STATE, &linkState, sizeof(linkState));
+    }
+}
+
+// Only while the radio is free: batches keep filling while a frame is on air.
+// Duty cycling holds them, and update frames, for a wake window; reliable
+// unicast goes when DutyCycle polls for it.
+void sendDueBatches(uint32_t now) {
+    if (comm.isTransmitting() || !dutyCycle.mayTransmit(now)) {
+        return;
+    }
+    uint8_t frames = sender.poll(now, batchFrames, BATCH_SLOTS);
+    for (uint8_t i = 0; i < frames; i++) {
+        comm.sendMessage(batchFrames[i]);
+    }
+}
+
+void sendDueReliable(uint32_t now) {
+    if (comm.isTransmitting() || !dutyCycle.mayTransmitUnicast(now)) {
+        return;
+    }
+    uint8_t frames = reliable.poll(now, reliableFrames, sizeof(reliableFrames) / sizeof(reliableFrames[0]));
+    for (uint8_t i = 0; i < frames; i++) {
+        comm.sendMessage(reliableFrames[i]);
+    }
+}
+
+void sendDueOta(uint32_t now) {
+    if (comm.isTransmitting() || !dutyCycle.mayTransmit(now)) {
+        return;
+    }
+    uint8_t frames = ota.poll(now, otaFrames, sizeof(otaFrames) / sizeof(otaFrames[0]));
+    for (uint8_t i = 0; i < frames; i++) {
+        comm.sendMessage(otaFrames[i]);
+    }
+}
+
+// Staging delta, running image, other app slot. An update completed before
+// a restart is served again; a half-received one is fetched anew.
+void beginOta() {
+    bool staged = otaStaging.begin(esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                            OTA_PARTITION_LABEL));
+    bool slots = otaRunning.begin(esp_ota_get_running_partition()) &&
+                 otaNext.begin(esp_ota_get_next_update_partition(nullptr));
+    if (!staged) {
+        Serial.println("[INIT] WARNING: No OTA staging partition, updates are not relayed");
+    }
+    ota.seed(esp_random());
+    ota.begin(staged ? &otaStaging : nullptr, slots ? &otaRunning : nullptr, slots ? &otaNext : nullptr, millis());
+    uint16_t installed = loadOtaVersion();
+    if (installed && ota.publish(millis(), installed)) {
+        Serial.printf("[INIT] Serving update %u\n", installed);
+    }
+}
+
+// A verified update: firmware boots from the other slot after the next
+// restart, parameters go through the same path as 'T'
+void installOta() {
+    if (ota.getState() != OTA_READY) {
+        return;
+    }
+    if (ota.getKind() == OTA_KIND_FIRMWARE) {
+        esp_err_t result = esp_ota_set_boot_partition(esp_ota_get_next_update_partition(nullptr));
+        Serial.printf("[OTA] Update %u %s\n", ota.getVersion(),
+                      result == ESP_OK ? "installed, active after the next restart" : "not bootable");
+    } else {
+        TunableConfig next = tunableDefaults();
+        ConfigOverrideResult result = storeConfigOverride(ota.getParameters(), ota.getParametersLength(), DRONE_CONFIG.id);
+        if (result == CONFIG_OVERRIDE_OK &&
+            applyConfigOverride(ota.getParameters(), ota.getParametersLength(), DRONE_CONFIG.id, next) == CONFIG_OVERRIDE_OK) {
+            tuning = next;
+            adr.setMaxTxPower(tuning.maxTxPowerDbm, millis());
+            linkQuality.setHeartbeatInterval(tuning.heartbeatIntervalMs);
+            dutyCycle.setPeriod(tuning.heartbeatIntervalMs);
+        }
+        Serial.printf("[OTA] Parameters %u: %s\n", ota.getVersion(), getConfigOverrideResultName(result));
+    }
+    storeOtaVersion(ota.getVersion());
+    ota.markInstalled();
+}
+
+// Stored first, then in effect at once
+void applyTuning(const char* hex) {
+    while (*hex == ' ' || *hex == '\r') {
+        hex++;
+    }
+    TunableConfig next = tunableDefaults();
+    if (*hex == '\0') {
+        clearConfigOverride();
+        Serial.println("[TX] Config override cleared");
+    } else {
+        uint8_t blob[CONFIG_OVERRIDE_MAX_BYTES];
+        size_t length = configOverrideFromHex(hex, blob, sizeof(blob));
+        ConfigOverrideResult result = length ? storeConfigOverride(blob, length, DRONE_CONFIG.id) : CONFIG_OVERRIDE_MALFORMED;
+        Serial.printf("[TX] Config override: %s\n", getConfigOverrideResultName(result));
+        if (result != CONFIG_OVERRIDE_OK) {
+            return;
+        }
+        applyConfigOverride(blob, length, DRONE_CONFIG.id, next);
+    }
+    tuning = next;
+    adr.setMaxTxPower(tuning.maxTxPowerDbm, millis());
+    linkQuality.setHeartbeatInterval(tuning.heartbeatIntervalMs);
+    dutyCycle.setPeriod(tuning.heartbeatIntervalMs);
+}
+
+// Pushes the ADR choice to the radio; an SF change waits for the channel
+void applyLinkSettings() {
+    if (adr.getSpreadingFactor() != radioSf && comm.setSpreadingFactor(adr.getSpreadingFactor())) {
+        radioSf = adr.getSpreadingFactor();
+    }
+    if (adr.getTxPowerDbm() != radioPowerDbm) {
+        radioPowerDbm = adr.getTxPowerDbm();
+        comm.setTxPower(radioPowerDbm);
+    }
 }
 
 void handleReceivedMessage(const DroneMessage& msg) {
+    PERF_SCOPE(PERF_DISPATCH);
     Serial.printf("\n[RX] 📩 Message received from Drone %d\n", msg.sourceId);
     Serial.printf("[RX]    Type: %s (0x%02X)\n", 
-                  getMessageTypeName(msg.messageType).c_str(), msg.messageType);
+                  messageTypeName(msg.messageType), msg.messageType);
     Serial.printf("[RX]    Sequence: %d\n", msg.sequenceNumber);
     Serial.printf("[RX]    Timestamp: %lu ms\n", msg.timestamp);
     Serial.printf("[RX]    Data Length: %d bytes\n", msg.dataLength);
     
-    // Handle specific message types
-    if (msg.messageType == MSG_HEARTBEAT && msg.dataLength == sizeof(HeartbeatData)) {
-        HeartbeatData* heartbeat = (HeartbeatData*)msg.data;
-        Serial.printf("[RX]    📊 Heartbeat Data:\n");
-        Serial.printf("[RX]       Drone ID: %d\n", heartbeat->droneId);
-        Serial.printf("[RX]       Battery: %.1f%%\n", heartbeat->batteryLevel);
-        Serial.printf("[RX]       Location: (%.6f, %.6f)\n", 
-                      heartbeat->latitude, heartbeat->longitude);
-        Serial.printf("[RX]       Status: %s\n", getStatusName(heartbeat->status).c_str());
-        Serial.printf("[RX]       Mission State: %d\n", heartbeat->missionState);
-    }
+    // Every frame heard feeds the link estimate, whoever it was for
+    linkQuality.onFrame(msg.sourceId, msg.sequenceNumber, comm.getRSSI(), comm.getSNR(), millis());
+    
+    // Payload decoding and length checks live in the registry handlers
+    registry.dispatch(msg);
     
     // Signal quality information
     Serial.printf("[RX]    📶 Signal Quality:\n");
@@ -123,16 +418,121 @@ void handleReceivedMessage(const DroneMessage& msg) {
     
     // Signal quality assessment
     int rssi = comm.getRSSI();
-    String quality;
+    const char* quality;
     if (rssi > -70) quality = "Excellent";
     else if (rssi > -80) quality = "Good";
     else if (rssi > -90) quality = "Fair";
     else quality = "Poor";
     
-    Serial.printf("[RX]       Quality: %s\n", quality.c_str());
+    Serial.printf("[RX]       Quality: %s\n", quality);
     Serial.println("[RX] ✅ Message processed successfully\n");
 }
 
+void onHeartbeat(const DroneMessage& msg, PayloadView<HeartbeatData> heartbeat, void* context) {
+    Serial.printf("[RX]    📊 Heartbeat Data:\n");
+    Serial.printf("[RX]       Drone ID: %d\n", heartbeat.get(&HeartbeatData::droneId));
+    Serial.printf("[RX]       Battery: %.1f%%\n", heartbeat.get(&HeartbeatData::batteryLevel));
+    Serial.printf("[RX]       Location: (%.6f, %.6f)\n", 
+                  heartbeat.get(&HeartbeatData::latitude), heartbeat.get(&HeartbeatData::longitude));
+    Serial.printf("[RX]       Status: %s\n", getStatusName(heartbeat.get(&HeartbeatData::status)));
+    Serial.printf("[RX]       Mission State: %d\n", heartbeat.get(&HeartbeatData::missionState));
+    peers.update(heartbeat.load(), comm.getRSSI(), comm.getSNR(), millis());
+    linkQuality.onRow(msg.sourceId, heartbeat.data() + sizeof(HeartbeatData), heartbeat.size() - sizeof(HeartbeatData),
+                      millis());
+}
+
+// Telemetry pull from the ground station
+void onStatusRequest(const DroneMessage& msg, PayloadView<StatusRequestData> request, void* context) {
+    uint8_t frames = statusService.handleRequest(msg, comm.getStats(), millis(), statusFrames);
+    for (uint8_t i = 0; i < frames; i++) {
+        comm.sendMessage(statusFrames[i]);
+    }
+    Serial.printf("[RX]    📤 Status reply: %d frame(s)\n", frames);
+}
+
+void onLinkState(const DroneMessage& msg, PayloadView<LinkStateData> state, void* context) {
+    LinkStateData link = state.load();
+    // The signal this link state arrived with, not that of a frame queued behind it
+    adr.onLinkState(msg.sourceId, link, comm.getRSSI(), comm.getSNR(), millis());
+    dutyCycle.onSchedule(link.wakeInMs, comm.getLastReceivedAt(), millis());
+}
+
+// Listening: a short delay between passes. Duty cycling: the radio sleeps,
+// or samples for a wake preamble, and the CPU light-sleeps until the next
+// window, sample or unicast poll; console input waits in the UART FIFO.
+// Light sleep stops every task, so it ends for the emergency task's next
+// copy too, and DIO0 (TX done) wakes the CPU for it.
+void waitForNextPass(uint32_t listenMs) {
+    uint32_t now = millis();
+    if (comm.channelActive()) {
+        dutyCycle.onActivity(now);
+    }
+    DutyAction action = dutyCycle.poll(now);
+    if (action == DUTY_SAMPLE) {
+        dutyCycle.onSampled(comm.sampleChannel(), millis());
+        now = millis();
+        action = dutyCycle.poll(now);
+    }
+    uint32_t wait = dutyCycle.nextEventIn(now, reliable.nextDueIn(now) == 0);
+    uint32_t stopIn = comm.emergencyIdleFor(now);
+    wait = stopIn < wait ? stopIn : wait;
+    if (action == DUTY_LISTEN || wait * 1000 <= POWER_WAKE_US) {
+        comm.wakeRadio();
+        delay(wait < listenMs ? wait : listenMs);
+        return;
+    }
+    comm.sleepRadio();
+    Serial.flush();
+    esp_sleep_enable_timer_wakeup((uint64_t)wait * 1000);
+    gpio_wakeup_enable((gpio_num_t)LORA_DIO0, GPIO_INTR_HIGH_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+    esp_light_sleep_start();
+}
+
+// Several logical messages in one frame: each goes through the registry
+void onBatch(const DroneMessage& msg, PayloadView<RawPayload> batch, void* context) {
+    BatchReader reader(msg);
+    DroneMessage records[8];
+    size_t count = 0;
+    while (reader.next(records[count])) {
+        if (++count == sizeof(records) / sizeof(records[0])) {
+            registry.dispatch(records, count);
+            count = 0;
+        }
+    }
+    registry.dispatch(records, count);
+}
+
+// Acks are handled inside; a new message goes through the registry once
+void onReliable(const DroneMessage& msg, PayloadView<RawPayload> frame, void* context) {
+    DroneMessage inner;
+    if (reliable.onFrame(msg, millis(), inner) == RELIABLE_DELIVER) {
+        registry.dispatch(inner);
+    }
+}
+
+void onOta(const DroneMessage& msg, PayloadView<RawPayload> frame, void* context) {
+    ota.onFrame(msg, millis());
+}
+
+// Coded multi-frame broadcasts; a message that fits one frame is dispatched
+void onFec(const DroneMessage& msg, PayloadView<RawPayload> frame, void* context) {
+    FecMessage rebuilt;
+    if (fecDecoder.add(msg, millis(), rebuilt) != FEC_COMPLETE) {
+        return;
+    }
+    Serial.printf("[RX]    🧩 %s rebuilt: %u bytes\n", messageTypeName(rebuilt.type), rebuilt.length);
+    if (rebuilt.length <= DP_MAX_PAYLOAD) {
+        DroneMessage inner = msg;
+        inner.messageType = rebuilt.type;
+        inner.dataLength = (uint8_t)rebuilt.length;
+        memset(inner.data, 0, sizeof(inner.data));
+        memcpy(inner.data, rebuilt.data, rebuilt.length);
+        inner.checksum = droneMessageChecksum(inner);
+        registry.dispatch(inner);
+    }
+}
+
 void printSystemInfo() {
     Serial.println("\n[INFO] 💻 System Information:");
     Serial.printf("[INFO]    Chip Model: %s\n", ESP.getChipModel());
@@ -143,24 +543,7 @@ void printSystemInfo() {
     Serial.printf("[INFO]    SDK Version: %s\n", ESP.getSdkVersion());
 }
 
-String getMessageTypeName(uint8_t type) {
-    switch (type) {
-        case MSG_HEARTBEAT: return "HEARTBEAT";
-        case MSG_GOSSIP: return "GOSSIP";
-        case MSG_MUTEX_REQUEST: return "MUTEX_REQUEST";
-        case MSG_MUTEX_RESPONSE: return "MUTEX_RESPONSE";
-        case MSG_RAFT_VOTE_REQUEST: return "RAFT_VOTE_REQUEST";
-        case MSG_RAFT_VOTE_RESPONSE: return "RAFT_VOTE_RESPONSE";
-        case MSG_MISSION_UPDATE: return "MISSION_UPDATE";
-        case MSG_TARGET_FOUND: return "TARGET_FOUND";
-        case MSG_EMERGENCY_STOP: return "EMERGENCY_STOP";
-        case MSG_STATUS_REQUEST: return "STATUS_REQUEST";
-        case MSG_STATUS_RESPONSE: return "STATUS_RESPONSE";
-        default: return "UNKNOWN";
-    }
-}
-
-String getStatusName(uint8_t status) {
+const char* getStatusName(uint8_t status) {
     switch (status) {
         case 0: return "OK";
         case 1: return "WARNING";
@@ -168,3 +551,10 @@ String getStatusName(uint8_t status) {
         default: return "UNKNOWN";
     }
 }
+
+void printRule(char c, uint8_t width) {
+    for (uint8_t i = 0; i < width; i++) {
+        Serial.write(c);
+    }
+    Serial.println();
+}
@@ -0,0 +1,315 @@
+#ifndef ARDUINO
+
+#include "../../include/simulation/radio_sim.h"
+#include <math.h>
+#include <string.h>
+
+#define FRAME_HISTORY_US 10000000ULL    // Longer than any SF12 frame
+#define SIM_CAPTURE_DB 6.0f             // Co-SF capture threshold of the SX127x
+#define SIM_SNR_CEILING_DB 10.0f        // Highest packet SNR the radio reports
+#define SIM_NOMINAL_RSSI_DBM (-60)      // Reported in range mode
+#define SIM_PREAMBLE_LOCK_SYMBOLS 5     // Of the preamble a receiver needs to lock on
+
+RadioSim::RadioSim(uint8_t nodes, uint32_t seed)
+    : nowUs(0), eventOrder(0), nodeCount(nodes), posX(nodes, 0), posY(nodes, 0), currentTx(nodes, 0),
+      range(1000.0f), packetReception(1.0f), phy(loraDefaultPhy()), linkBudget(false),
+      noiseFloorDbm(loraNoiseFloorDbm(phy)), nodeSf(nodes, phy.spreadingFactor), txPowerDbm(nodes, LORA_TX_POWER),
+      txEnergyMj(nodes, 0.0), listeningSince(nodes, 0), nextFrameId(1), random(seed) {
+    memset(&budget, 0, sizeof(budget));
+    memset(&stats, 0, sizeof(stats));
+}
+
+void RadioSim::setPhy(const LoRaPhyConfig& config) {
+    phy = config;
+    noiseFloorDbm = loraNoiseFloorDbm(phy);
+    nodeSf.assign(nodeCount, phy.spreadingFactor);
+}
+
+void RadioSim::setLinkBudget(const SimLinkBudget& model) {
+    linkBudget = true;
+    budget = model;
+    shadowing.assign(nodeCount * nodeCount, 0.0f);
+    std::normal_distribution<float> shadow(0.0f, model.shadowingDb > 0 ? model.shadowingDb : 1e-6f);
+    for (uint8_t a = 0; a < nodeCount; a++) {
+        for (uint8_t b = a + 1; b < nodeCount; b++) {
+            float s = model.shadowingDb > 0 ? shadow(random) : 0.0f;
+            shadowing[a * nodeCount + b] = s;
+            shadowing[b * nodeCount + a] = s;
+        }
+    }
+}
+
+float RadioSim::meanRxDbm(uint8_t from, uint8_t to, int8_t powerDbm) const {
+    float dx = posX[from] - posX[to];
+    float dy = posY[from] - posY[to];
+    float distance = sqrtf(dx * dx + dy * dy);
+    if (distance < 1.0f) distance = 1.0f;
+    float loss = budget.referenceLossDb + 10.0f * budget.pathLossExponent * log10f(distance);
+    return powerDbm - loss - shadowing[from * nodeCount + to];
+}
+
+void RadioSim::setPosition(uint8_t node, float x, float y) {
+    posX[node] = x;
+    posY[node] = y;
+}
+
+bool RadioSim::placeRandom(float areaM, int attempts) {
+    std::uniform_real_distribution<float> coordinate(0.0f, areaM);
+    for (int attempt = 0; attempt < attempts; attempt++) {
+        for (uint8_t i = 0; i < nodeCount; i++) {
+            setPosition(i, coordinate(random), coordinate(random));
+        }
+        if (isConnected()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RadioSim::inRange(uint8_t a, uint8_t b) const {
+    if (linkBudget) {
+        return meanRxDbm(a, b, txPowerDbm[a]) - noiseFloorDbm >= loraSnrFloorDb(nodeSf[a]);
+    }
+    float dx = posX[a] - posX[b];
+    float dy = posY[a] - posY[b];
+    return dx * dx + dy * dy <= range * range;
+}
+
+uint8_t RadioSim::hopsFrom(uint8_t source, std::vector<uint8_t>& hops) {
+    hops.assign(nodeCount, 0xFF);
+    std::vector<uint8_t> queue(1, source);
+    hops[source] = 0;
+    uint8_t furthest = 0;
+    for (size_t head = 0; head < queue.size(); head++) {
+        uint8_t a = queue[head];
+        for (uint8_t b = 0; b < nodeCount; b++) {
+            if (hops[b] == 0xFF && inRange(a, b)) {
+                hops[b] = hops[a] + 1;
+                if (hops[b] > furthest) furthest = hops[b];
+                queue.push_back(b);
+            }
+        }
+    }
+    return furthest;
+}
+
+bool RadioSim::isConnected() {
+    std::vector<uint8_t> hops;
+    hopsFrom(0, hops);
+    for (uint8_t h : hops) {
+        if (h == 0xFF) return false;
+    }
+    return true;
+}
+
+SimFrame* RadioSim::findFrame(uint32_t id) {
+    for (size_t i = frames.size(); i-- > 0;) {
+        if (frames[i].id == id) return &frames[i];
+    }
+    return nullptr;
+}
+
+void RadioSim::pruneFrames() {
+    size_t keep = 0;
+    for (size_t i = 0; i < frames.size(); i++) {
+        if (frames[i].endUs + FRAME_HISTORY_US >= nowUs) {
+            frames[keep++] = frames[i];
+        }
+    }
+    frames.resize(keep);
+}
+
+uint32_t RadioSim::transmit(uint8_t node, const void* data, uint8_t length, uint16_t preambleSymbols) {
+    if (currentTx[node]) {
+        return 0;
+    }
+    if (frames.size() > 256) {
+        pruneFrames();
+    }
+
+    SimFrame frame;
+    frame.id = nextFrameId++;
+    frame.sender = node;
+    LoRaPhyConfig nodePhy = phy;
+    nodePhy.spreadingFactor = nodeSf[node];
+    if (preambleSymbols > 0) {
+        nodePhy.preambleLength = preambleSymbols;
+    }
+    frame.startUs = nowUs;
+    frame.endUs = nowUs + loraAirtimeUs(nodePhy, length);
+    frame.preambleEndUs = nowUs + (uint64_t)nodePhy.preambleLength * loraSymbolTimeUs(nodePhy);
+    frame.aborted = false;
+    frame.spreadingFactor = nodeSf[node];
+    frame.txPowerDbm = txPowerDbm[node];
+    frame.rssi = 0;
+    frame.snr = 0.0f;
+    frame.payload.assign((const uint8_t*)data, (const uint8_t*)data + length);
+    frames.push_back(frame);
+
+    currentTx[node] = frame.id;
+    stats.framesSent++;
+    uint32_t id = frame.id;
+    at(frame.endUs, [this, id]() { finishFrame(id); });
+    return id;
+}
+
+bool RadioSim::abortTransmit(uint8_t node) {
+    SimFrame* frame = currentTx[node] ? findFrame(currentTx[node]) : nullptr;
+    if (!frame) {
+        return false;
+    }
+    // Energy already on air still interferes up to this point
+    frame->aborted = true;
+    frame->endUs = nowUs;
+    chargeTx(*frame);
+    currentTx[node] = 0;
+    stats.framesAborted++;
+    return true;
+}
+
+void RadioSim::chargeTx(const SimFrame& frame) {
+    // us x mA x V = nJ
+    txEnergyMj[frame.sender] += (double)(frame.endUs - frame.startUs) * loraTxCurrentMa(frame.txPowerDbm) *
+                                POWER_SUPPLY_V * 1e-6;
+}
+
+bool RadioSim::channelBusy(uint8_t node) const {
+    for (const SimFrame& f : frames) {
+        if (f.sender != node && f.startUs <= nowUs && f.endUs > nowUs && f.spreadingFactor == nodeSf[node] &&
+            inRange(f.sender, node)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RadioSim::senseChannel(uint8_t node, int16_t rssiBusyDbm) const {
+    for (const SimFrame& f : frames) {
+        if (f.sender == node || f.startUs > nowUs || f.endUs <= nowUs) continue;
+        if (f.spreadingFactor == nodeSf[node] && inRange(f.sender, node)) {
+            return true;
+        }
+        float rxDbm = linkBudget ? meanRxDbm(f.sender, node, f.txPowerDbm)
+                                 : (inRange(f.sender, node) ? SIM_NOMINAL_RSSI_DBM : -1000.0f);
+        if (rxDbm >= rssiBusyDbm) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RadioSim::setListening(uint8_t node, bool listening) {
+    if (!listening) {
+        listeningSince[node] = UINT64_MAX;
+    } else if (listeningSince[node] == UINT64_MAX) {
+        listeningSince[node] = nowUs;
+    }
+}
+
+bool RadioSim::detectPreamble(uint8_t node) const {
+    for (const SimFrame& f : frames) {
+        if (f.sender == node || f.startUs > nowUs || f.preambleEndUs <= nowUs || f.aborted ||
+            f.spreadingFactor != nodeSf[node]) {
+            continue;
+        }
+        if (linkBudget ? meanRxDbm(f.sender, node, f.txPowerDbm) - noiseFloorDbm >= loraSnrFloorDb(f.spreadingFactor)
+                       : inRange(f.sender, node)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RadioSim::finishFrame(uint32_t id) {
+    SimFrame* found = findFrame(id);
+    if (!found || found->aborted) {
+        return;
+    }
+    SimFrame frame = *found;    // Handlers may transmit and grow the history
+    currentTx[frame.sender] = 0;
+    chargeTx(frame);
+
+    std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+    std::normal_distribution<float> fading(0.0f, budget.fadingDb > 0 ? budget.fadingDb : 1e-6f);
+    for (uint8_t r = 0; r < nodeCount; r++) {
+        if (r == frame.sender || nodeSf[r] != frame.spreadingFactor) continue;
+
+        float rxDbm = 0.0f, snr = SIM_SNR_CEILING_DB;
+        if (linkBudget) {
+            rxDbm = meanRxDbm(frame.sender, r, frame.txPowerDbm);
+            if (budget.fadingDb > 0) rxDbm += fading(random);
+            snr = rxDbm - noiseFloorDbm;
+            if (snr < loraSnrFloorDb(frame.spreadingFactor)) {
+                if (inRange(frame.sender, r)) stats.fadeLosses++;
+                continue;
+            }
+        } else if (!inRange(frame.sender, r)) {
+            continue;
+        }
+
+        bool selfTx = false, collided = false;
+        for (const SimFrame& other : frames) {
+            if (other.id == frame.id || other.startUs >= frame.endUs || other.endUs <= frame.startUs) continue;
+            if (other.sender == r) {
+                selfTx = true;
+            } else if (other.spreadingFactor != frame.spreadingFactor) {
+                continue;
+            } else if (!linkBudget) {
+                collided = collided || inRange(other.sender, r);
+            } else {
+                // Interferers below the floor are noise; the rest need capture
+                float interferer = meanRxDbm(other.sender, r, other.txPowerDbm);
+                if (interferer - noiseFloorDbm >= loraSnrFloorDb(other.spreadingFactor) &&
+                    rxDbm < interferer + SIM_CAPTURE_DB) {
+                    collided = true;
+                }
+            }
+        }
+
+        LoRaPhyConfig nodePhy = phy;
+        nodePhy.spreadingFactor = frame.spreadingFactor;
+        uint64_t lockUs = SIM_PREAMBLE_LOCK_SYMBOLS * (uint64_t)loraSymbolTimeUs(nodePhy);
+        bool asleep = listeningSince[r] == UINT64_MAX || listeningSince[r] + lockUs > frame.preambleEndUs;
+
+        if (asleep) {
+            stats.asleepLosses++;
+        } else if (selfTx) {
+            stats.halfDuplexLosses++;
+        } else if (collided) {
+            stats.collisions++;
+        } else if (packetReception < 1.0f && chance(random) > packetReception) {
+            stats.randomLosses++;
+        } else {
+            stats.deliveries++;
+            frame.rssi = linkBudget ? (int16_t)lroundf(rxDbm) : SIM_NOMINAL_RSSI_DBM;
+            frame.snr = snr < SIM_SNR_CEILING_DB ? snr : SIM_SNR_CEILING_DB;
+            if (rxHandler) rxHandler(r, frame);
+        }
+    }
+
+    if (txDoneHandler) {
+        txDoneHandler(frame.sender, frame);
+    }
+}
+
+void RadioSim::at(uint64_t timeUs, std::function<void()> fn) {
+    Event e;
+    e.at = timeUs < nowUs ? nowUs : timeUs;
+    e.order = eventOrder++;
+    e.fn = fn;
+    events.push(e);
+}
+
+void RadioSim::run(uint64_t untilUs) {
+    while (!events.empty() && events.top().at <= untilUs) {
+        Event e = events.top();
+        events.pop();
+        nowUs = e.at;
+        e.fn();
+    }
+    if (untilUs > nowUs) {
+        nowUs = untilUs;
+    }
+}
+
+#endif // !ARDUINO
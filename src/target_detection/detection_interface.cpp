@@ -0,0 +1,477 @@
+#include "../../include/target_detection/detection_interface.h"
+#include <math.h>
+
+#ifdef ARDUINO
+#include <esp_timer.h>
+#if defined(CONFIG_IDF_TARGET_ESP32S3) && defined(PERFORMANCE_TEST) && __has_include(<esp_nn.h>)
+#include <esp_nn.h>
+#define DETECTION_USE_ESP_NN 1
+#endif
+#else
+#include <chrono>
+#endif
+
+#if !defined(ARDUINO) && defined(__GNUC__)
+#define DETECTION_USE_VECTOR_EXT 1
+typedef int8_t v16s8 __attribute__((vector_size(16)));
+typedef int16_t v16s16 __attribute__((vector_size(32)));
+typedef int32_t v16s32 __attribute__((vector_size(64)));
+#endif
+
+static uint64_t profileNowNs() {
+#ifdef ARDUINO
+    return (uint64_t)esp_timer_get_time() * 1000ULL;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// ===== Kernels =====
+
+int32_t dotProductS8Scalar(const int8_t* a, const int8_t* b, uint16_t length) {
+    int32_t sum = 0;
+    for (uint16_t i = 0; i < length; i++) {
+        sum += (int32_t)a[i] * b[i];
+    }
+    return sum;
+}
+
+int32_t dotProductS8(const int8_t* a, const int8_t* b, uint16_t length) {
+#ifdef DETECTION_USE_VECTOR_EXT
+    v16s32 acc = {0};
+    uint16_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        v16s8 va, vb;
+        memcpy(&va, a + i, 16); // Unaligned-safe loads
+        memcpy(&vb, b + i, 16);
+        // int8 x int8 fits in int16 (16-bit multiplies), widen only to accumulate
+        v16s16 product = __builtin_convertvector(va, v16s16) * __builtin_convertvector(vb, v16s16);
+        acc += __builtin_convertvector(product, v16s32);
+    }
+    int32_t sum = 0;
+    for (int lane = 0; lane < 16; lane++) {
+        sum += acc[lane];
+    }
+    for (; i < length; i++) {
+        sum += (int32_t)a[i] * b[i];
+    }
+    return sum;
+#else
+    return dotProductS8Scalar(a, b, length);
+#endif
+}
+
+// TFLite-compatible fixed-point requantization
+static int32_t roundingDoublingHighMul(int32_t a, int32_t b) {
+    if (a == b && a == INT32_MIN) {
+        return INT32_MAX;
+    }
+    int64_t ab = (int64_t)a * b;
+    int32_t nudge = ab >= 0 ? (1 << 30) : (1 - (1 << 30));
+    return (int32_t)((ab + nudge) / (1LL << 31));
+}
+
+static int32_t roundingDivideByPot(int32_t x, int32_t exponent) {
+    int32_t mask = (int32_t)((1LL << exponent) - 1);
+    int32_t remainder = x & mask;
+    int32_t threshold = (mask >> 1) + (x < 0 ? 1 : 0);
+    return (x >> exponent) + (remainder > threshold ? 1 : 0);
+}
+
+int8_t requantizeS8(int32_t accumulator, int32_t multiplier, int32_t shift, bool relu) {
+    int32_t left = shift > 0 ? shift : 0;
+    int32_t right = shift > 0 ? 0 : -shift;
+    int32_t v = roundingDivideByPot(roundingDoublingHighMul(accumulator * (1 << left), multiplier), right);
+    int32_t low = relu ? 0 : -128;
+    return (int8_t)(v < low ? low : (v > 127 ? 127 : v));
+}
+
+void quantizeMultiplier(double realMultiplier, int32_t& multiplier, int32_t& shift) {
+    if (realMultiplier <= 0) {
+        multiplier = 0;
+        shift = 0;
+        return;
+    }
+    int exponent;
+    double fraction = frexp(realMultiplier, &exponent);
+    int64_t q = (int64_t)llround(fraction * (1LL << 31));
+    if (q == (1LL << 31)) {
+        q /= 2;
+        exponent++;
+    }
+    multiplier = (int32_t)q;
+    shift = exponent;
+}
+
+void denseS8(const int8_t* input, const QuantizedLayer& layer, int8_t* output) {
+#ifdef DETECTION_USE_ESP_NN
+    esp_nn_fully_connected_s8(input, 0, layer.cols, layer.weights, 0, layer.bias, output,
+                              layer.rows, 0, layer.shift, layer.multiplier,
+                              layer.relu ? 0 : -128, 127);
+#else
+    const int8_t* row = layer.weights;
+    for (uint16_t r = 0; r < layer.rows; r++, row += layer.cols) {
+        int32_t acc = layer.bias[r] + dotProductS8(input, row, layer.cols);
+        output[r] = requantizeS8(acc, layer.multiplier, layer.shift, layer.relu);
+    }
+#endif
+}
+
+// Gathers (kernel x kernel x channels) patches, HWC layout, no padding
+template <typename T>
+static void im2col(const T* input, int inWidth, int channels, int kernel, int stride, int outWidth, T* out) {
+    for (int oy = 0; oy < outWidth; oy++) {
+        for (int ox = 0; ox < outWidth; ox++) {
+            for (int ky = 0; ky < kernel; ky++) {
+                const T* src = input + ((oy * stride + ky) * inWidth + ox * stride) * channels;
+                memcpy(out, src, sizeof(T) * kernel * channels);
+                out += kernel * channels;
+            }
+        }
+    }
+}
+
+// ===== Float reference model =====
+
+static float denseFloat(const float* in, const float* w, float b, int n) {
+    float sum = b;
+    for (int i = 0; i < n; i++) {
+        sum += in[i] * w[i];
+    }
+    return sum;
+}
+
+static float pixelToFloat(uint8_t p) {
+    return p / 255.0f;
+}
+
+static int8_t pixelToS8(uint8_t p) {
+    return (int8_t)((p * 127 + 127) / 255); // Scale 1/127 in the float domain
+}
+
+void FloatDetectionModel::initDefault(uint32_t seed) {
+    uint32_t state = seed ? seed : 1;
+    auto uniform = [&state](float limit) {
+        state = state * 1664525u + 1013904223u;
+        return ((state >> 8) / 16777216.0f * 2.0f - 1.0f) * limit;
+    };
+
+    // He-uniform init, small biases
+    for (auto& row : conv1W) for (float& w : row) w = uniform(sqrtf(6.0f / 16));
+    for (auto& row : conv2W) for (float& w : row) w = uniform(sqrtf(6.0f / 144));
+    for (auto& row : dense1W) for (float& w : row) w = uniform(sqrtf(6.0f / 400));
+    for (auto& row : dense2W) for (float& w : row) w = uniform(sqrtf(6.0f / 32));
+    for (float& b : conv1B) b = uniform(0.05f);
+    for (float& b : conv2B) b = uniform(0.05f);
+    for (float& b : dense1B) b = uniform(0.05f);
+    for (float& b : dense2B) b = uniform(0.05f);
+}
+
+bool FloatDetectionModel::load(const float* blob, size_t count) {
+    if (count != sizeof(FloatDetectionModel) / sizeof(float)) {
+        return false;
+    }
+    memcpy(this, blob, sizeof(FloatDetectionModel));
+    return true;
+}
+
+void FloatDetectionModel::run(const DetectionFrame& frame, float logits[2], float* layerMax) const {
+    float input[DETECTION_FRAME_PIXELS];
+    float patchBuffer[5 * 5 * 144];
+    float act1[7 * 7 * 16];
+    float act2[5 * 5 * 16];
+    float act3[32];
+    float peak[DETECTION_LAYER_COUNT] = {0};
+
+    for (int i = 0; i < DETECTION_FRAME_PIXELS; i++) {
+        input[i] = pixelToFloat(frame.pixels[i]);
+    }
+
+    im2col(input, DETECTION_FRAME_SIZE, 1, 4, 2, 7, patchBuffer);
+    for (int p = 0; p < 49; p++) {
+        for (int c = 0; c < 16; c++) {
+            float v = fmaxf(0.0f, denseFloat(patchBuffer + p * 16, conv1W[c], conv1B[c], 16));
+            act1[p * 16 + c] = v;
+            peak[0] = fmaxf(peak[0], v);
+        }
+    }
+
+    im2col(act1, 7, 16, 3, 1, 5, patchBuffer);
+    for (int p = 0; p < 25; p++) {
+        for (int c = 0; c < 16; c++) {
+            float v = fmaxf(0.0f, denseFloat(patchBuffer + p * 144, conv2W[c], conv2B[c], 144));
+            act2[p * 16 + c] = v;
+            peak[1] = fmaxf(peak[1], v);
+        }
+    }
+
+    for (int o = 0; o < 32; o++) {
+        act3[o] = fmaxf(0.0f, denseFloat(act2, dense1W[o], dense1B[o], 400));
+        peak[2] = fmaxf(peak[2], act3[o]);
+    }
+
+    for (int o = 0; o < 2; o++) {
+        logits[o] = denseFloat(act3, dense2W[o], dense2B[o], 32);
+        peak[3] = fmaxf(peak[3], fabsf(logits[o]));
+    }
+
+    if (layerMax) {
+        for (int i = 0; i < DETECTION_LAYER_COUNT; i++) {
+            layerMax[i] = fmaxf(layerMax[i], peak[i]);
+        }
+    }
+}
+
+// ===== Quantized detector =====
+
+QuantizedCnnDetector::QuantizedCnnDetector() : outputScale(1.0f), ready(false) {
+    static const char* names[DETECTION_LAYER_COUNT] = {"conv1", "conv2", "dense1", "dense2"};
+    static const uint32_t macs[DETECTION_LAYER_COUNT] = {49 * 16 * 16, 25 * 16 * 144, 32 * 400, 2 * 32};
+    for (int i = 0; i < DETECTION_LAYER_COUNT; i++) {
+        profile[i].name = names[i];
+        profile[i].macsPerFrame = macs[i];
+    }
+    resetProfile();
+}
+
+static void quantizeWeights(const float* w, int count, float& scale, int8_t* out) {
+    float peak = 0;
+    for (int i = 0; i < count; i++) {
+        peak = fmaxf(peak, fabsf(w[i]));
+    }
+    scale = peak > 0 ? peak / 127.0f : 1.0f;
+    for (int i = 0; i < count; i++) {
+        long q = lroundf(w[i] / scale);
+        out[i] = (int8_t)(q > 127 ? 127 : (q < -127 ? -127 : q));
+    }
+}
+
+bool QuantizedCnnDetector::quantize(const FloatDetectionModel& model, const DetectionFrame* calibration, uint16_t count) {
+    if (count == 0) {
+        return false;
+    }
+
+    float layerMax[DETECTION_LAYER_COUNT] = {0};
+    float logits[2];
+    for (uint16_t i = 0; i < count; i++) {
+        model.run(calibration[i], logits, layerMax);
+    }
+
+    const float* floatWeights[DETECTION_LAYER_COUNT] = {
+        &model.conv1W[0][0], &model.conv2W[0][0], &model.dense1W[0][0], &model.dense2W[0][0]};
+    const float* floatBias[DETECTION_LAYER_COUNT] = {
+        model.conv1B, model.conv2B, model.dense1B, model.dense2B};
+    int8_t* weights[DETECTION_LAYER_COUNT] = {conv1W, conv2W, dense1W, dense2W};
+    int32_t* bias[DETECTION_LAYER_COUNT] = {conv1B, conv2B, dense1B, dense2B};
+    const uint16_t rows[DETECTION_LAYER_COUNT] = {16, 16, 32, 2};
+    const uint16_t cols[DETECTION_LAYER_COUNT] = {16, 144, 400, 32};
+
+    float inputScale = 1.0f / 127.0f;
+    for (int l = 0; l < DETECTION_LAYER_COUNT; l++) {
+        float weightScale;
+        quantizeWeights(floatWeights[l], rows[l] * cols[l], weightScale, weights[l]);
+
+        float outScale = layerMax[l] > 0 ? layerMax[l] / 127.0f : 1.0f;
+        float accScale = inputScale * weightScale;
+        for (uint16_t r = 0; r < rows[l]; r++) {
+            bias[l][r] = (int32_t)lroundf(floatBias[l][r] / accScale);
+        }
+
+        QuantizedLayer& layer = layers[l];
+        layer.weights = weights[l];
+        layer.bias = bias[l];
+        layer.rows = rows[l];
+        layer.cols = cols[l];
+        layer.relu = (l < DETECTION_LAYER_COUNT - 1);
+        quantizeMultiplier((double)accScale / outScale, layer.multiplier, layer.shift);
+
+        inputScale = outScale;
+    }
+    outputScale = inputScale;
+    ready = true;
+    return true;
+}
+
+bool QuantizedCnnDetector::begin() {
+    if (ready) {
+        return true;
+    }
+
+    // No trained export on board yet: build the placeholder model and
+    // calibrate it on synthetic frames (noise with and without a hot spot)
+    FloatDetectionModel* model = new FloatDetectionModel();
+    DetectionFrame* calibration = new DetectionFrame[16];
+    model->initDefault(0xD20E);
+    uint32_t state = 7;
+    for (int f = 0; f < 16; f++) {
+        for (int i = 0; i < DETECTION_FRAME_PIXELS; i++) {
+            state = state * 1664525u + 1013904223u;
+            calibration[f].pixels[i] = (uint8_t)((state >> 24) & 0x3F);
+        }
+        if (f & 1) {
+            int cx = 3 + f % 10, cy = 3 + (f * 7) % 10;
+            for (int y = cy - 2; y <= cy + 2; y++)
+                for (int x = cx - 2; x <= cx + 2; x++)
+                    calibration[f].pixels[y * DETECTION_FRAME_SIZE + x] = 230;
+        }
+    }
+    bool ok = quantize(*model, calibration, 16);
+    delete model;
+    delete[] calibration;
+
+    DEBUG_PRINT("[DETECT] %s detector ready (%s kernel)\n", getName(),
+#ifdef DETECTION_USE_ESP_NN
+                "esp-nn"
+#elif defined(DETECTION_USE_VECTOR_EXT)
+                "vector"
+#else
+                "scalar"
+#endif
+    );
+    return ok;
+}
+
+void QuantizedCnnDetector::detectBatch(const DetectionFrame* frames, uint8_t count, DetectionResult* results) {
+    if (count > DETECTION_BATCH_SIZE) {
+        count = DETECTION_BATCH_SIZE;
+    }
+
+    for (uint8_t b = 0; b < count; b++) {
+        for (int i = 0; i < DETECTION_FRAME_PIXELS; i++) {
+            bufferA[b][i] = pixelToS8(frames[b].pixels[i]);
+        }
+    }
+
+    // Layer-major over the batch so each layer's weights stay hot in cache
+    uint64_t t0 = profileNowNs();
+    for (uint8_t b = 0; b < count; b++) {
+        im2col(bufferA[b], DETECTION_FRAME_SIZE, 1, 4, 2, 7, patches);
+        for (int p = 0; p < 49; p++) {
+            denseS8(patches + p * 16, layers[0], bufferB[b] + p * 16);
+        }
+    }
+    uint64_t t1 = profileNowNs();
+    for (uint8_t b = 0; b < count; b++) {
+        im2col(bufferB[b], 7, 16, 3, 1, 5, patches);
+        for (int p = 0; p < 25; p++) {
+            denseS8(patches + p * 144, layers[1], bufferA[b] + p * 16);
+        }
+    }
+    uint64_t t2 = profileNowNs();
+    for (uint8_t b = 0; b < count; b++) {
+        denseS8(bufferA[b], layers[2], bufferB[b]);
+    }
+    uint64_t t3 = profileNowNs();
+    for (uint8_t b = 0; b < count; b++) {
+        denseS8(bufferB[b], layers[3], bufferA[b]);
+    }
+    uint64_t t4 = profileNowNs();
+
+    uint64_t stamps[DETECTION_LAYER_COUNT + 1] = {t0, t1, t2, t3, t4};
+    for (int l = 0; l < DETECTION_LAYER_COUNT; l++) {
+        profile[l].calls += count;
+        profile[l].totalNs += stamps[l + 1] - stamps[l];
+    }
+
+    for (uint8_t b = 0; b < count; b++) {
+        float margin = (bufferA[b][1] - bufferA[b][0]) * outputScale;
+        float confidence = 1.0f / (1.0f + expf(-margin));
+        results[b].frameId = frames[b].frameId;
+        results[b].targetClass = 1;
+        results[b].confidence = (uint8_t)(confidence * 255.0f + 0.5f);
+        results[b].detected = confidence >= DETECTION_CONFIDENCE_THRESHOLD;
+    }
+}
+
+void QuantizedCnnDetector::run(const DetectionFrame& frame, float logits[2]) {
+    DetectionResult result;
+    detectBatch(&frame, 1, &result);
+    logits[0] = bufferA[0][0] * outputScale;
+    logits[1] = bufferA[0][1] * outputScale;
+}
+
+void QuantizedCnnDetector::resetProfile() {
+    for (int i = 0; i < DETECTION_LAYER_COUNT; i++) {
+        profile[i].calls = 0;
+        profile[i].totalNs = 0;
+    }
+}
+
+void QuantizedCnnDetector::printProfile() {
+    DEBUG_PRINT("[DETECT] Per-layer timing:\n");
+    for (int i = 0; i < DETECTION_LAYER_COUNT; i++) {
+        const LayerProfile& p = profile[i];
+        double nsPerFrame = p.calls ? (double)p.totalNs / p.calls : 0;
+        DEBUG_PRINT("[DETECT]    %-7s %8.0f ns/frame  %6lu MACs  %.2f GMAC/s\n", p.name, nsPerFrame,
+                    (unsigned long)p.macsPerFrame, nsPerFrame > 0 ? p.macsPerFrame / nsPerFrame : 0.0);
+    }
+}
+
+// ===== Frame queue and dispatch =====
+
+DetectionInterface::DetectionInterface() : detector(nullptr) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool DetectionInterface::begin() {
+    if (!detector) {
+        DEBUG_PRINTLN("[DETECT] ERROR: No detector installed");
+        return false;
+    }
+    return detector->begin();
+}
+
+bool DetectionInterface::submitFrame(const DetectionFrame& frame) {
+    if (!queue.push(frame)) {
+        return false;
+    }
+    stats.framesQueued++;
+    return true;
+}
+
+uint8_t DetectionInterface::processPending(DetectionFrame* frames, DetectionResult* results, uint8_t maxFrames) {
+    if (!detector) {
+        return 0;
+    }
+    if (maxFrames > DETECTION_BATCH_SIZE) {
+        maxFrames = DETECTION_BATCH_SIZE;
+    }
+
+    uint8_t count = 0;
+    while (count < maxFrames && queue.pop(frames[count])) {
+        count++;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    detector->detectBatch(frames, count, results);
+    stats.batches++;
+    stats.framesProcessed += count;
+    for (uint8_t i = 0; i < count; i++) {
+        if (results[i].detected) stats.detections++;
+    }
+    return count;
+}
+
+DetectionStats DetectionInterface::getStats() const {
+    DetectionStats s = stats;
+    s.framesDropped = queue.getDropped();
+    return s;
+}
+
+bool DetectionInterface::toTargetReport(const DetectionResult& result, const DetectionFrame& frame,
+                                        uint8_t selfId, TargetReportData& report) {
+    if (!result.detected) {
+        return false;
+    }
+    report.reporterId = selfId;
+    report.targetId = result.frameId;
+    report.latitude = frame.latitude;
+    report.longitude = frame.longitude;
+    report.confidence = result.confidence;
+    report.sensorQuality = 200; // Fixed until per-sensor calibration exists
+    report.targetClass = result.targetClass;
+    return true;
+}
@@ -0,0 +1,535 @@
+#include "../../include/target_detection/sensor_integration.h"
+#include <math.h>
+#include <stdlib.h>
+
+#ifdef ARDUINO
+#include <Wire.h>
+#include <Adafruit_BMP280.h>
+#else
+#include <stdio.h>
+#include <chrono>
+#endif
+
+// Filter gains (Q16). GPS at 1-10 Hz with ~2.5 m CEP.
+#define POSITION_ALPHA_Q16 32768   // 0.50
+#define POSITION_BETA_Q16 6554     // 0.10
+#define BARO_LOWPASS_Q16 16384     // 0.25 per sample
+#define GPS_ALTITUDE_GAIN_Q16 1311 // 0.02 per fix - removes baro drift slowly
+#define FILTER_STALE_MS 5000       // Restart a filter after a gap this long
+
+// Pressure-to-altitude table, 30-110 kPa
+#define PRESSURE_TABLE_MIN_PA 30000
+#define PRESSURE_TABLE_STEP_PA 1250
+#define PRESSURE_TABLE_SIZE 65
+
+// ===== NMEA parser =====
+
+NmeaParser::NmeaParser() {
+    memset(&current, 0, sizeof(current));
+    reset();
+}
+
+void NmeaParser::reset() {
+    fieldLength = 0;
+    fieldIndex = 0;
+    checksum = 0;
+    expectedChecksum = 0;
+    checksumDigits = 0;
+    inSentence = false;
+    inChecksum = false;
+    kind = SENTENCE_UNKNOWN;
+    hemisphere = 0;
+    sentences = 0;
+    checksumErrors = 0;
+    ignored = 0;
+}
+
+int32_t NmeaParser::parseDecimal(const char* s, uint8_t decimals) {
+    bool negative = false;
+    if (*s == '-') {
+        negative = true;
+        s++;
+    }
+
+    int32_t value = 0;
+    while (*s >= '0' && *s <= '9') {
+        value = value * 10 + (*s++ - '0');
+    }
+
+    uint8_t fraction = 0;
+    if (*s == '.') {
+        s++;
+        while (*s >= '0' && *s <= '9' && fraction < decimals) {
+            value = value * 10 + (*s++ - '0');
+            fraction++;
+        }
+    }
+    while (fraction++ < decimals) {
+        value *= 10;
+    }
+    return negative ? -value : value;
+}
+
+int32_t NmeaParser::parseCoordinateE7(const char* s) {
+    // (d)ddmm.mmmmm - the last two digits before the point are minutes
+    const char* dot = strchr(s, '.');
+    int length = dot ? (int)(dot - s) : (int)strlen(s);
+    if (length < 3) {
+        return 0;
+    }
+
+    int32_t degrees = 0;
+    for (int i = 0; i < length - 2; i++) {
+        degrees = degrees * 10 + (s[i] - '0');
+    }
+    int64_t minutesE5 = parseDecimal(s + length - 2, 5);
+    return degrees * 10000000 + (int32_t)((minutesE5 * 100 + 30) / 60);
+}
+
+void NmeaParser::endField() {
+    field[fieldLength] = '\0';
+
+    if (fieldIndex == 0) {
+        kind = SENTENCE_UNKNOWN;
+        if (fieldLength >= 5) {
+            const char* type = field + fieldLength - 3;
+            if (strcmp(type, "GGA") == 0) kind = SENTENCE_GGA;
+            else if (strcmp(type, "RMC") == 0) kind = SENTENCE_RMC;
+        }
+    } else if (kind != SENTENCE_UNKNOWN && fieldLength > 0) {
+        // GGA: time,lat,N/S,lon,E/W,quality,sats,hdop,alt
+        // RMC: time,status,lat,N/S,lon,E/W,speed
+        uint8_t f = fieldIndex;
+        if (kind == SENTENCE_RMC && f >= 2) {
+            f = (f == 2) ? 0xFF : f - 1; // Align lat/lon with GGA numbering
+        }
+
+        switch (f) {
+            case 1: {
+                int32_t t = parseDecimal(field, 3); // hhmmssmmm
+                pending.timeOfDayMs = (t / 10000000) * 3600000UL +
+                                      ((t / 100000) % 100) * 60000UL + (t % 100000);
+                break;
+            }
+            case 2: pending.latitudeE7 = parseCoordinateE7(field); break;
+            case 3: if (field[0] == 'S') pending.latitudeE7 = -pending.latitudeE7; break;
+            case 4: pending.longitudeE7 = parseCoordinateE7(field); break;
+            case 5: if (field[0] == 'W') pending.longitudeE7 = -pending.longitudeE7; break;
+            case 6:
+                if (kind == SENTENCE_GGA) {
+                    pending.fixQuality = (uint8_t)parseDecimal(field, 0);
+                } else {
+                    // Knots x100 to cm/s
+                    pending.speedCmS = (uint16_t)((int64_t)parseDecimal(field, 2) * 5144 / 10000);
+                }
+                break;
+            case 7: if (kind == SENTENCE_GGA) pending.satellites = (uint8_t)parseDecimal(field, 0); break;
+            case 8: if (kind == SENTENCE_GGA) pending.hdopX100 = (uint16_t)parseDecimal(field, 2); break;
+            case 9: if (kind == SENTENCE_GGA) pending.altitudeCm = parseDecimal(field, 2); break;
+            case 0xFF: hemisphere = field[0]; break; // RMC status: A = valid
+            default: break;
+        }
+    }
+
+    fieldIndex++;
+    fieldLength = 0;
+}
+
+bool NmeaParser::endSentence() {
+    sentences++;
+    if (checksum != expectedChecksum) {
+        checksumErrors++;
+        return false;
+    }
+    if (kind == SENTENCE_UNKNOWN) {
+        ignored++;
+        return false;
+    }
+
+    if (kind == SENTENCE_GGA) {
+        pending.valid = pending.fixQuality > 0;
+    } else {
+        pending.valid = (hemisphere == 'A');
+    }
+    current = pending;
+    return true;
+}
+
+bool NmeaParser::feed(char c) {
+    if (c == '$') {
+        inSentence = true;
+        inChecksum = false;
+        checksum = 0;
+        fieldIndex = 0;
+        fieldLength = 0;
+        hemisphere = 0;
+        kind = SENTENCE_UNKNOWN;
+        pending = current; // RMC carries no altitude, GGA no speed
+        return false;
+    }
+    if (!inSentence) {
+        return false;
+    }
+
+    if (inChecksum) {
+        uint8_t nibble;
+        if (c >= '0' && c <= '9') nibble = c - '0';
+        else if (c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+        else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+        else {
+            inSentence = false;
+            checksumErrors++;
+            return false;
+        }
+        expectedChecksum = (expectedChecksum << 4) | nibble;
+        if (++checksumDigits == 2) {
+            inSentence = false;
+            return endSentence();
+        }
+        return false;
+    }
+
+    if (c == '*') {
+        endField();
+        inChecksum = true;
+        expectedChecksum = 0;
+        checksumDigits = 0;
+        return false;
+    }
+    if (c == '\r' || c == '\n') {
+        inSentence = false; // Sentences without a checksum are not trusted
+        ignored++;
+        return false;
+    }
+
+    checksum ^= (uint8_t)c;
+    if (c == ',') {
+        endField();
+    } else if (fieldLength < sizeof(field) - 1) {
+        field[fieldLength++] = c;
+    } else {
+        inSentence = false; // Oversized field - resync on next '$'
+        ignored++;
+    }
+    return false;
+}
+
+// ===== Filters =====
+
+AlphaBetaFilter::AlphaBetaFilter(uint32_t alphaQ16, uint32_t betaQ16)
+    : value(0), velocity(0), lastUpdate(0), alphaQ16(alphaQ16), betaQ16(betaQ16), initialized(false) {
+}
+
+int32_t AlphaBetaFilter::update(int32_t measurement, uint32_t timestampMs) {
+    uint32_t dt = timestampMs - lastUpdate;
+    if (!initialized || dt > FILTER_STALE_MS) {
+        value = measurement;
+        velocity = 0;
+        lastUpdate = timestampMs;
+        initialized = true;
+        return value;
+    }
+    if (dt == 0) {
+        dt = 1;
+    }
+    lastUpdate = timestampMs;
+
+    int64_t predicted = value + (int64_t)velocity * dt / 1000;
+    int64_t residual = measurement - predicted;
+    value = (int32_t)(predicted + (((int64_t)alphaQ16 * residual) >> 16));
+    velocity += (int32_t)((((int64_t)betaQ16 * residual) >> 16) * 1000 / dt);
+    return value;
+}
+
+AltitudeFilter::AltitudeFilter()
+    : baroAltitudeCm(0), offsetCm(0), haveBaro(false), haveGps(false), gpsAltitudeCm(0) {
+}
+
+int32_t AltitudeFilter::pressureToAltitudeCm(int32_t pressurePa) {
+    static int32_t table[PRESSURE_TABLE_SIZE];
+    static bool built = false;
+
+    // Built once with the barometric formula, then integer lookups only
+    if (!built) {
+        for (int i = 0; i < PRESSURE_TABLE_SIZE; i++) {
+            float p = PRESSURE_TABLE_MIN_PA + i * PRESSURE_TABLE_STEP_PA;
+            table[i] = (int32_t)(4433000.0f * (1.0f - powf(p / SEA_LEVEL_PRESSURE_PA, 0.1903f)));
+        }
+        built = true;
+    }
+
+    int32_t offset = pressurePa - PRESSURE_TABLE_MIN_PA;
+    if (offset <= 0) {
+        return table[0];
+    }
+    int32_t index = offset / PRESSURE_TABLE_STEP_PA;
+    if (index >= PRESSURE_TABLE_SIZE - 1) {
+        return table[PRESSURE_TABLE_SIZE - 1];
+    }
+    int32_t fraction = offset % PRESSURE_TABLE_STEP_PA;
+    return table[index] + (table[index + 1] - table[index]) * fraction / PRESSURE_TABLE_STEP_PA;
+}
+
+void AltitudeFilter::addBaro(int32_t pressurePa) {
+    int32_t altitude = pressureToAltitudeCm(pressurePa);
+    if (!haveBaro) {
+        baroAltitudeCm = altitude;
+        haveBaro = true;
+    } else {
+        baroAltitudeCm += (int32_t)(((int64_t)(altitude - baroAltitudeCm) * BARO_LOWPASS_Q16) >> 16);
+    }
+}
+
+void AltitudeFilter::addGps(int32_t altitudeCm) {
+    gpsAltitudeCm = altitudeCm;
+    if (haveBaro) {
+        int32_t target = altitudeCm - baroAltitudeCm;
+        if (!haveGps) {
+            offsetCm = target;
+        } else {
+            offsetCm += (int32_t)(((int64_t)(target - offsetCm) * GPS_ALTITUDE_GAIN_Q16) >> 16);
+        }
+    }
+    haveGps = true;
+}
+
+int32_t AltitudeFilter::getAltitudeCm() const {
+    if (haveBaro) {
+        return baroAltitudeCm + (haveGps ? offsetCm : 0);
+    }
+    return gpsAltitudeCm;
+}
+
+// ===== Seqlock publisher =====
+
+FusedStatePublisher::FusedStatePublisher() : sequence(0) {
+    memset(&state, 0, sizeof(state));
+}
+
+void FusedStatePublisher::publish(const FusedSensorState& next) {
+    uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed); // Odd: write in progress
+    std::atomic_thread_fence(std::memory_order_release);
+    state = next;
+    sequence.store(seq + 2, std::memory_order_release);
+}
+
+bool FusedStatePublisher::read(FusedSensorState& out) const {
+    for (int attempt = 0; attempt < 8; attempt++) {
+        uint32_t before = sequence.load(std::memory_order_acquire);
+        if (before == 0) {
+            return false; // Nothing published yet
+        }
+        if (before & 1) {
+            continue;
+        }
+        out = state;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ===== Device producers =====
+
+#ifdef ARDUINO
+static HardwareSerial gpsSerial(2);
+static Adafruit_BMP280 bmp;
+static SensorPipeline* activePipeline = nullptr;
+
+// Runs in the UART driver's event task as soon as the RX FIFO/DMA delivers
+static void onGpsReceive() {
+    uint8_t chunk[64];
+    while (gpsSerial.available() > 0) {
+        size_t n = gpsSerial.read(chunk, sizeof(chunk));
+        if (n == 0) break;
+        activePipeline->pushNmeaBytes(chunk, n);
+    }
+}
+
+static void baroTask(void* arg) {
+    TickType_t lastWake = xTaskGetTickCount();
+    for (;;) {
+        BaroSample sample;
+        sample.timestamp = millis();
+        sample.pressurePa = (int32_t)bmp.readPressure();
+        sample.temperatureCx100 = (int16_t)(bmp.readTemperature() * 100);
+        activePipeline->pushBaroSample(sample);
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(BARO_SAMPLE_INTERVAL_MS));
+    }
+}
+#endif
+
+// ===== Pipeline =====
+
+SensorPipeline::SensorPipeline()
+    : latFilter(POSITION_ALPHA_Q16, POSITION_BETA_Q16),
+      lonFilter(POSITION_ALPHA_Q16, POSITION_BETA_Q16),
+      lastFixTime(0) {
+    memset(&working, 0, sizeof(working));
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool SensorPipeline::begin() {
+#ifdef ARDUINO
+    activePipeline = this;
+
+    gpsSerial.begin(GPS_BAUD_RATE, SERIAL_8N1, GPS_RX_PIN, GPS_TX_PIN);
+    gpsSerial.onReceive(onGpsReceive);
+    Serial.printf("[SENSOR] GPS on UART2 (RX=%d, TX=%d) at %d baud\n", GPS_RX_PIN, GPS_TX_PIN, GPS_BAUD_RATE);
+
+    if (bmp.begin(BMP280_I2C_ADDRESS)) {
+        // Oversampling only - filtering is done in fixed point here
+        bmp.setSampling(Adafruit_BMP280::MODE_NORMAL,
+                        Adafruit_BMP280::SAMPLING_X2,
+                        Adafruit_BMP280::SAMPLING_X16,
+                        Adafruit_BMP280::FILTER_OFF,
+                        Adafruit_BMP280::STANDBY_MS_1);
+        xTaskCreatePinnedToCore(baroTask, "baro", 2048, nullptr, 2, nullptr, 0);
+        Serial.printf("[SENSOR] BMP280 sampling every %d ms\n", BARO_SAMPLE_INTERVAL_MS);
+    } else {
+        Serial.println("[SENSOR] WARNING: BMP280 not found, altitude from GPS only");
+    }
+#endif
+    return true;
+}
+
+uint16_t SensorPipeline::pushNmeaBytes(const uint8_t* data, uint16_t length) {
+    uint16_t pushed = 0;
+    while (pushed < length && nmeaRing.push(data[pushed])) {
+        pushed++;
+    }
+    return pushed;
+}
+
+bool SensorPipeline::pushBaroSample(const BaroSample& sample) {
+    return baroRing.push(sample);
+}
+
+uint16_t SensorPipeline::poll(uint32_t now) {
+    uint16_t consumed = 0;
+    bool updated = false;
+
+    uint8_t byte;
+    while (nmeaRing.pop(byte)) {
+        stats.nmeaBytes++;
+        if (!parser.feed((char)byte)) continue;
+
+        const GpsFix& fix = parser.getFix();
+        consumed++;
+        if (!fix.valid) continue;
+
+        working.latitudeE7 = latFilter.update(fix.latitudeE7, fix.timeOfDayMs);
+        working.longitudeE7 = lonFilter.update(fix.longitudeE7, fix.timeOfDayMs);
+        working.speedCmS = fix.speedCmS;
+        working.satellites = fix.satellites;
+        working.hasFix = true;
+        altitude.addGps(fix.altitudeCm);
+        lastFixTime = now;
+        stats.gpsFixes++;
+        updated = true;
+    }
+
+    BaroSample sample;
+    while (baroRing.pop(sample)) {
+        altitude.addBaro(sample.pressurePa);
+        stats.baroSamples++;
+        consumed++;
+        updated = true;
+    }
+
+    if (working.hasFix && now - lastFixTime > GPS_FIX_TIMEOUT_MS) {
+        working.hasFix = false;
+        updated = true;
+    }
+
+    if (updated) {
+        working.timestamp = now;
+        working.altitudeCm = altitude.getAltitudeCm();
+        working.hasBaro = altitude.hasBaro();
+        publisher.publish(working);
+        stats.published++;
+    }
+    return consumed;
+}
+
+SensorPipelineStats SensorPipeline::getStats() const {
+    SensorPipelineStats s = stats;
+    s.nmeaSentences = parser.getSentenceCount();
+    s.nmeaChecksumErrors = parser.getChecksumErrors();
+    s.nmeaIgnored = parser.getIgnoredCount();
+    s.nmeaDropped = nmeaRing.getDropped();
+    s.baroDropped = baroRing.getDropped();
+    return s;
+}
+
+void SensorPipeline::printStats() {
+    SensorPipelineStats s = getStats();
+    FusedSensorState state;
+    bool have = getLatest(state);
+
+    DEBUG_PRINT("[SENSOR] NMEA: %lu bytes, %lu sentences, %lu checksum errors, %lu dropped\n",
+                (unsigned long)s.nmeaBytes, (unsigned long)s.nmeaSentences,
+                (unsigned long)s.nmeaChecksumErrors, (unsigned long)s.nmeaDropped);
+    DEBUG_PRINT("[SENSOR] Fixes: %lu, Baro samples: %lu (%lu dropped)\n",
+                (unsigned long)s.gpsFixes, (unsigned long)s.baroSamples, (unsigned long)s.baroDropped);
+    if (have) {
+        DEBUG_PRINT("[SENSOR] Fused: (%.7f, %.7f) alt %.2f m, fix=%d, sats=%d\n",
+                    state.latitudeE7 / 1e7, state.longitudeE7 / 1e7, state.altitudeCm / 100.0,
+                    state.hasFix, state.satellites);
+    }
+}
+
+// ===== Host replay =====
+
+#ifndef ARDUINO
+bool replaySensorLog(SensorPipeline& pipeline, const char* path, SensorReplayReport& report) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    memset(&report, 0, sizeof(report));
+    char line[128];
+    uint32_t now = 0;
+    double totalNs = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    while (fgets(line, sizeof(line), file)) {
+        report.lines++;
+        auto t0 = std::chrono::steady_clock::now();
+        uint16_t consumed;
+
+        if (line[0] == '$') {
+            pipeline.pushNmeaBytes((const uint8_t*)line, (uint16_t)strlen(line));
+            consumed = pipeline.poll(now);
+        } else if (strncmp(line, "BMP,", 4) == 0) {
+            char* cursor = line + 4;
+            BaroSample sample;
+            sample.timestamp = (uint32_t)strtoul(cursor, &cursor, 10);
+            sample.pressurePa = (int32_t)strtol(cursor + 1, &cursor, 10);
+            sample.temperatureCx100 = (*cursor == ',') ? (int16_t)(strtof(cursor + 1, nullptr) * 100) : 0;
+            now = sample.timestamp;
+            pipeline.pushBaroSample(sample);
+            consumed = pipeline.poll(now);
+        } else {
+            continue;
+        }
+
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+        totalNs += ns;
+        if (ns > report.maxParseNs) {
+            report.maxParseNs = ns;
+        }
+        report.samples += consumed;
+    }
+    fclose(file);
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report.samplesPerSec = report.seconds > 0 ? report.samples / report.seconds : 0;
+    report.meanParseNs = report.samples > 0 ? totalNs / report.samples : 0;
+    return true;
+}
+#endif
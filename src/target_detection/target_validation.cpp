@@ -0,0 +1,494 @@
+#include "../../include/target_detection/target_validation.h"
+#include "../../include/utilities/performance_monitor.h"
+#include <math.h>
+
+#define METERS_PER_DEG_LAT 111320.0f
+#define MIN_REPORT_CONFIDENCE 0.01f
+#define MAX_REPORT_CONFIDENCE 0.99f
+#define MAX_TRACK_LOG_ODDS 8.0f
+
+static float clampf(float v, float lo, float hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+TargetTrackStore::TargetTrackStore(uint16_t maxTracks, float radiusM)
+    : capacity(maxTracks), activeCount(0), nextTrackId(1), freeHead(-1),
+      associationRadius(radiusM), originSet(false), originLat(0), originLon(0),
+      metersPerDegLon(METERS_PER_DEG_LAT) {
+    if (capacity > 0x7FFF) {
+        capacity = 0x7FFF;
+    }
+
+    // Roughly two buckets per track keeps chains short
+    gridBuckets = 1;
+    while (gridBuckets < capacity * 2 && gridBuckets < 0x8000) {
+        gridBuckets <<= 1;
+    }
+
+    tracks = new TargetTrack[capacity];
+    gridHeads = new int16_t[gridBuckets];
+    clear();
+}
+
+TargetTrackStore::~TargetTrackStore() {
+    delete[] tracks;
+    delete[] gridHeads;
+}
+
+void TargetTrackStore::clear() {
+    for (uint16_t i = 0; i < gridBuckets; i++) {
+        gridHeads[i] = -1;
+    }
+
+    // Chain every slot onto the free list
+    for (uint16_t i = 0; i < capacity; i++) {
+        tracks[i].active = false;
+        tracks[i].gridPrev = -1;
+        tracks[i].gridNext = (i + 1 < capacity) ? (int16_t)(i + 1) : -1;
+    }
+    freeHead = capacity > 0 ? 0 : -1;
+    activeCount = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+void TargetTrackStore::setOrigin(float latitude, float longitude) {
+    originLat = latitude;
+    originLon = longitude;
+    metersPerDegLon = METERS_PER_DEG_LAT * cosf(latitude * (float)M_PI / 180.0f);
+    originSet = true;
+}
+
+void TargetTrackStore::toLocal(float lat, float lon, float& x, float& y) {
+    if (!originSet) {
+        setOrigin(lat, lon);
+    }
+    x = (lon - originLon) * metersPerDegLon;
+    y = (lat - originLat) * METERS_PER_DEG_LAT;
+}
+
+int32_t TargetTrackStore::cellOf(float x, float y) const {
+    int32_t cx = (int32_t)floorf(x / associationRadius);
+    int32_t cy = (int32_t)floorf(y / associationRadius);
+    return (int32_t)(((uint32_t)(cx & 0xFFFF) << 16) | (uint32_t)(cy & 0xFFFF));
+}
+
+uint16_t TargetTrackStore::bucketOf(int32_t cell) const {
+    uint32_t h = (uint32_t)cell * 2654435761u;
+    h ^= h >> 16;
+    return (uint16_t)(h & (gridBuckets - 1));
+}
+
+void TargetTrackStore::gridInsert(int16_t index) {
+    TargetTrack& t = tracks[index];
+    t.cell = cellOf(t.x, t.y);
+    uint16_t bucket = bucketOf(t.cell);
+    t.gridPrev = -1;
+    t.gridNext = gridHeads[bucket];
+    if (t.gridNext >= 0) {
+        tracks[t.gridNext].gridPrev = index;
+    }
+    gridHeads[bucket] = index;
+}
+
+void TargetTrackStore::gridRemove(int16_t index) {
+    TargetTrack& t = tracks[index];
+    if (t.gridPrev >= 0) {
+        tracks[t.gridPrev].gridNext = t.gridNext;
+    } else {
+        gridHeads[bucketOf(t.cell)] = t.gridNext;
+    }
+    if (t.gridNext >= 0) {
+        tracks[t.gridNext].gridPrev = t.gridPrev;
+    }
+    t.gridPrev = -1;
+    t.gridNext = -1;
+}
+
+void TargetTrackStore::gridMove(int16_t index) {
+    if (cellOf(tracks[index].x, tracks[index].y) != tracks[index].cell) {
+        gridRemove(index);
+        gridInsert(index);
+    }
+}
+
+int16_t TargetTrackStore::allocateTrack() {
+    if (freeHead < 0) {
+        return -1;
+    }
+
+    int16_t index = freeHead;
+    freeHead = tracks[index].gridNext;
+
+    TargetTrack& t = tracks[index];
+    memset(&t, 0, sizeof(TargetTrack));
+    t.trackId = nextTrackId++;
+    if (nextTrackId == 0) {
+        nextTrackId = 1; // 0 is never a valid track id
+    }
+    t.active = true;
+    t.gridPrev = -1;
+    t.gridNext = -1;
+    activeCount++;
+    return index;
+}
+
+void TargetTrackStore::releaseTrack(int16_t index) {
+    gridRemove(index);
+    tracks[index].active = false;
+    tracks[index].gridNext = freeHead;
+    freeHead = index;
+    activeCount--;
+}
+
+float TargetTrackStore::reportWeight(int rssi, float snr, uint8_t sensorQuality) {
+    // LoRa demodulates down to about -20 dB SNR at SF7-SF12
+    float snrWeight = clampf((snr + 20.0f) / 30.0f, 0.05f, 1.0f);
+    float rssiWeight = clampf((rssi + 130.0f) / 70.0f, 0.05f, 1.0f);
+    float quality = (sensorQuality > 0 ? sensorQuality : 1) / 255.0f;
+    return quality * (0.7f * snrWeight + 0.3f * rssiWeight);
+}
+
+void TargetTrackStore::recompute(TargetTrack& track) {
+    float sumW = 0, sumX = 0, sumY = 0, logOdds = 0;
+    for (uint8_t i = 0; i < track.reporterCount; i++) {
+        const TargetTrack::Contribution& c = track.reporters[i];
+        sumW += c.weight;
+        sumX += c.weight * c.x;
+        sumY += c.weight * c.y;
+        logOdds += c.logOdds;
+    }
+    if (sumW <= 0) {
+        return;
+    }
+
+    track.x = sumX / sumW;
+    track.y = sumY / sumW;
+    track.latitude = originLat + track.y / METERS_PER_DEG_LAT;
+    track.longitude = originLon + track.x / metersPerDegLon;
+
+    logOdds = clampf(logOdds, -MAX_TRACK_LOG_ODDS, MAX_TRACK_LOG_ODDS);
+    track.confidence = 1.0f / (1.0f + expf(-logOdds));
+    if (fabsf(track.confidence - track.reportedConfidence) >= TARGET_CONFIDENCE_REPORT_DELTA) {
+        track.dirty = true;
+    }
+}
+
+void TargetTrackStore::removeContribution(TargetTrack& track, uint8_t reporterId) {
+    for (uint8_t i = 0; i < track.reporterCount; i++) {
+        if (track.reporters[i].reporterId == reporterId) {
+            track.reporters[i] = track.reporters[--track.reporterCount];
+            return;
+        }
+    }
+}
+
+void TargetTrackStore::addContribution(TargetTrack& track, const TargetTrack::Contribution& c) {
+    // One contribution per drone - a repeated report replaces the older one
+    for (uint8_t i = 0; i < track.reporterCount; i++) {
+        if (track.reporters[i].reporterId == c.reporterId) {
+            if (c.timestamp >= track.reporters[i].timestamp) {
+                track.reporters[i] = c;
+            }
+            return;
+        }
+    }
+
+    if (track.reporterCount < MAX_TRACK_REPORTERS) {
+        track.reporters[track.reporterCount++] = c;
+        return;
+    }
+
+    // Table full: replace the weakest contribution if the new one is stronger
+    uint8_t weakest = 0;
+    for (uint8_t i = 1; i < track.reporterCount; i++) {
+        if (track.reporters[i].weight < track.reporters[weakest].weight) {
+            weakest = i;
+        }
+    }
+    if (c.weight > track.reporters[weakest].weight) {
+        track.reporters[weakest] = c;
+    }
+}
+
+void TargetTrackStore::dropStaleSighting(int16_t keep, const TargetTrack::Contribution& c) {
+    // The same sighting re-reported further away leaves its old track
+    int32_t cx = (int32_t)floorf(c.x / associationRadius);
+    int32_t cy = (int32_t)floorf(c.y / associationRadius);
+
+    for (int dx = -1; dx <= 1; dx++) {
+        for (int dy = -1; dy <= 1; dy++) {
+            int32_t cell = (int32_t)(((uint32_t)((cx + dx) & 0xFFFF) << 16) |
+                                     (uint32_t)((cy + dy) & 0xFFFF));
+            int16_t j = gridHeads[bucketOf(cell)];
+            while (j >= 0) {
+                int16_t next = tracks[j].gridNext;
+                TargetTrack& t = tracks[j];
+                if (j != keep && t.cell == cell) {
+                    for (uint8_t r = 0; r < t.reporterCount; r++) {
+                        if (t.reporters[r].reporterId == c.reporterId &&
+                            t.reporters[r].sourceTargetId == c.sourceTargetId) {
+                            removeContribution(t, c.reporterId);
+                            if (t.reporterCount == 0) {
+                                releaseTrack(j);
+                            } else {
+                                recompute(t);
+                                gridMove(j);
+                            }
+                            stats.tracksSplit++;
+                            break;
+                        }
+                    }
+                }
+                j = next;
+            }
+        }
+    }
+}
+
+void TargetTrackStore::mergeInto(int16_t keep, int16_t drop) {
+    TargetTrack& k = tracks[keep];
+    TargetTrack& d = tracks[drop];
+
+    for (uint8_t i = 0; i < d.reporterCount; i++) {
+        addContribution(k, d.reporters[i]);
+    }
+    if (d.lastUpdate > k.lastUpdate) {
+        k.lastUpdate = d.lastUpdate;
+    }
+
+    releaseTrack(drop);
+    recompute(k);
+    gridMove(keep);
+    stats.tracksMerged++;
+}
+
+void TargetTrackStore::mergeNeighbours(int16_t index) {
+    float mergeRadius = associationRadius * 0.5f;
+    float limit = mergeRadius * mergeRadius;
+
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        TargetTrack& t = tracks[index];
+        int32_t cx = (int32_t)floorf(t.x / associationRadius);
+        int32_t cy = (int32_t)floorf(t.y / associationRadius);
+
+        for (int dx = -1; dx <= 1 && !merged; dx++) {
+            for (int dy = -1; dy <= 1 && !merged; dy++) {
+                int32_t cell = (int32_t)(((uint32_t)((cx + dx) & 0xFFFF) << 16) |
+                                         (uint32_t)((cy + dy) & 0xFFFF));
+                for (int16_t j = gridHeads[bucketOf(cell)]; j >= 0; j = tracks[j].gridNext) {
+                    if (j == index || tracks[j].cell != cell) continue;
+                    float ex = tracks[j].x - t.x;
+                    float ey = tracks[j].y - t.y;
+                    if (ex * ex + ey * ey > limit) continue;
+
+                    // The older track keeps its id so peers see a stable identity
+                    if (tracks[j].firstSeen < t.firstSeen) {
+                        mergeInto(j, index);
+                        index = j;
+                    } else {
+                        mergeInto(index, j);
+                    }
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+int16_t TargetTrackStore::findNearestLocal(float x, float y) const {
+    int32_t cx = (int32_t)floorf(x / associationRadius);
+    int32_t cy = (int32_t)floorf(y / associationRadius);
+    float best = associationRadius * associationRadius;
+    int16_t bestIndex = -1;
+
+    for (int dx = -1; dx <= 1; dx++) {
+        for (int dy = -1; dy <= 1; dy++) {
+            int32_t cell = (int32_t)(((uint32_t)((cx + dx) & 0xFFFF) << 16) |
+                                     (uint32_t)((cy + dy) & 0xFFFF));
+            for (int16_t j = gridHeads[bucketOf(cell)]; j >= 0; j = tracks[j].gridNext) {
+                if (tracks[j].cell != cell) continue; // Hash collision
+                float ex = tracks[j].x - x;
+                float ey = tracks[j].y - y;
+                float d2 = ex * ex + ey * ey;
+                if (d2 <= best) {
+                    best = d2;
+                    bestIndex = j;
+                }
+            }
+        }
+    }
+    return bestIndex;
+}
+
+int16_t TargetTrackStore::findNearest(float latitude, float longitude) {
+    if (!originSet) {
+        return -1;
+    }
+    float x, y;
+    toLocal(latitude, longitude, x, y);
+    return findNearestLocal(x, y);
+}
+
+int16_t TargetTrackStore::ingest(const TargetReportData& report, int rssi, float snr, uint32_t now) {
+    PERF_SCOPE(PERF_HANDLER_TARGET);
+    if (!isfinite(report.latitude) || !isfinite(report.longitude) ||
+        fabsf(report.latitude) > 90.0f || fabsf(report.longitude) > 180.0f) {
+        stats.reportsRejected++;
+        return -1;
+    }
+
+    TargetTrack::Contribution c;
+    c.reporterId = report.reporterId;
+    c.sourceTargetId = report.targetId;
+    toLocal(report.latitude, report.longitude, c.x, c.y);
+    c.weight = reportWeight(rssi, snr, report.sensorQuality);
+    float p = clampf(report.confidence / 255.0f, MIN_REPORT_CONFIDENCE, MAX_REPORT_CONFIDENCE);
+    c.logOdds = c.weight * logf(p / (1.0f - p));
+    c.timestamp = now;
+
+    int16_t index = findNearestLocal(c.x, c.y);
+    if (index < 0) {
+        index = allocateTrack();
+        if (index < 0) {
+            stats.reportsRejected++;
+            return -1;
+        }
+        TargetTrack& t = tracks[index];
+        t.targetClass = report.targetClass;
+        t.firstSeen = now;
+        t.x = c.x;
+        t.y = c.y;
+        t.reportedConfidence = 0;
+        gridInsert(index);
+        stats.tracksCreated++;
+    }
+
+    dropStaleSighting(index, c);
+    TargetTrack& track = tracks[index];
+    addContribution(track, c);
+    track.lastUpdate = now;
+    recompute(track);
+
+    // Split: a contribution that drifted out of the gate becomes its own track
+    while (track.reporterCount > 1) {
+        uint8_t far = 0;
+        float farD2 = 0;
+        for (uint8_t i = 0; i < track.reporterCount; i++) {
+            float ex = track.reporters[i].x - track.x;
+            float ey = track.reporters[i].y - track.y;
+            float d2 = ex * ex + ey * ey;
+            if (d2 > farD2) {
+                farD2 = d2;
+                far = i;
+            }
+        }
+        if (farD2 <= associationRadius * associationRadius) break;
+
+        int16_t split = allocateTrack();
+        if (split < 0) break;
+
+        TargetTrack& s = tracks[split];
+        s.reporters[0] = track.reporters[far];
+        s.reporterCount = 1;
+        s.targetClass = track.targetClass;
+        s.firstSeen = now;
+        s.lastUpdate = now;
+        removeContribution(track, s.reporters[0].reporterId);
+        recompute(s);
+        recompute(track);
+        gridInsert(split);
+        stats.tracksSplit++;
+    }
+
+    gridMove(index);
+    mergeNeighbours(index);
+    stats.reportsIngested++;
+
+    // Merging may have moved the report into an older track
+    int16_t landed = findNearestLocal(c.x, c.y);
+    return landed >= 0 ? landed : index;
+}
+
+bool TargetTrackStore::handleMessage(const DroneMessage& msg, int rssi, float snr, uint32_t now) {
+    if (msg.messageType != MSG_TARGET_FOUND || msg.dataLength != sizeof(TargetReportData)) {
+        return false;
+    }
+
+    TargetReportData report;
+    memcpy(&report, msg.data, sizeof(report));
+    return ingest(report, rssi, snr, now) >= 0;
+}
+
+uint16_t TargetTrackStore::expireTracks(uint32_t now) {
+    uint16_t expired = 0;
+    for (uint16_t i = 0; i < capacity; i++) {
+        TargetTrack& t = tracks[i];
+        if (!t.active) continue;
+
+        for (uint8_t r = 0; r < t.reporterCount;) {
+            if (now - t.reporters[r].timestamp >= TARGET_TRACK_TIMEOUT_MS) {
+                t.reporters[r] = t.reporters[--t.reporterCount];
+            } else {
+                r++;
+            }
+        }
+
+        if (t.reporterCount == 0) {
+            releaseTrack(i);
+            stats.tracksExpired++;
+            expired++;
+        } else {
+            recompute(t);
+            gridMove(i);
+        }
+    }
+    return expired;
+}
+
+uint16_t TargetTrackStore::collectChangedTracks(TargetReportData* out, uint16_t maxOut, uint8_t selfId) {
+    uint16_t count = 0;
+    for (uint16_t i = 0; i < capacity && count < maxOut; i++) {
+        TargetTrack& t = tracks[i];
+        if (!t.active || !t.dirty) continue;
+
+        float weight = 0;
+        for (uint8_t r = 0; r < t.reporterCount; r++) {
+            weight += t.reporters[r].weight;
+        }
+
+        TargetReportData& d = out[count++];
+        d.reporterId = selfId;
+        d.targetId = t.trackId;
+        d.latitude = t.latitude;
+        d.longitude = t.longitude;
+        d.confidence = (uint8_t)(clampf(t.confidence, 0.0f, 1.0f) * 255.0f + 0.5f);
+        d.sensorQuality = (uint8_t)(clampf(weight, 0.0f, 1.0f) * 255.0f + 0.5f);
+        d.targetClass = t.targetClass;
+
+        t.reportedConfidence = t.confidence;
+        t.dirty = false;
+    }
+    return count;
+}
+
+const TargetTrack* TargetTrackStore::getTrack(int16_t index) const {
+    if (index < 0 || index >= capacity || !tracks[index].active) {
+        return nullptr;
+    }
+    return &tracks[index];
+}
+
+void TargetTrackStore::printTracks() {
+    DEBUG_PRINT("[TARGET] %u active tracks (created %lu, merged %lu, split %lu, expired %lu)\n",
+                activeCount, (unsigned long)stats.tracksCreated, (unsigned long)stats.tracksMerged,
+                (unsigned long)stats.tracksSplit, (unsigned long)stats.tracksExpired);
+    for (uint16_t i = 0; i < capacity; i++) {
+        const TargetTrack& t = tracks[i];
+        if (!t.active) continue;
+        DEBUG_PRINT("[TARGET]    #%u (%.6f, %.6f) conf=%.2f reporters=%u\n",
+                    t.trackId, t.latitude, t.longitude, t.confidence, t.reporterCount);
+    }
+}
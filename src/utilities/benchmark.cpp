@@ -0,0 +1,140 @@
+#include "../../include/utilities/benchmark.h"
+#include <stdlib.h>
+
+#ifdef ARDUINO
+#include "esp_timer.h"
+#else
+#include <chrono>
+#endif
+
+uint64_t benchNowNs() {
+#ifdef ARDUINO
+    return (uint64_t)esp_timer_get_time() * 1000;
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+BenchSuite::BenchSuite() : caseCount(0), resultCount(0) {}
+
+bool BenchSuite::add(const char* name, BenchFunction run, void* context) {
+    if (caseCount >= BENCH_MAX_CASES) {
+        return false;
+    }
+    cases[caseCount].name = name;
+    cases[caseCount].run = run;
+    cases[caseCount].context = context;
+    caseCount++;
+    return true;
+}
+
+BenchResult BenchSuite::measure(const Case& entry) {
+    // Calibrate: double until one call is long enough to time reliably
+    uint32_t iterations = 1;
+    for (;;) {
+        uint64_t start = benchNowNs();
+        entry.run(iterations, entry.context);
+        uint64_t elapsed = benchNowNs() - start;
+        if (elapsed >= (uint64_t)BENCH_SAMPLE_US * 1000 || iterations >= (1u << 30)) {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    float samples[BENCH_SAMPLES];
+    for (uint8_t i = 0; i < BENCH_SAMPLES; i++) {
+        uint64_t start = benchNowNs();
+        entry.run(iterations, entry.context);
+        samples[i] = (float)(benchNowNs() - start) / iterations;
+    }
+    // Insertion sort; BENCH_SAMPLES is small
+    for (uint8_t i = 1; i < BENCH_SAMPLES; i++) {
+        float value = samples[i];
+        uint8_t j = i;
+        while (j > 0 && samples[j - 1] > value) {
+            samples[j] = samples[j - 1];
+            j--;
+        }
+        samples[j] = value;
+    }
+
+    BenchResult result;
+    result.name = entry.name;
+    result.iterations = iterations;
+    result.medianNs = samples[BENCH_SAMPLES / 2];
+    result.minNs = samples[0];
+    result.maxNs = samples[BENCH_SAMPLES - 1];
+    result.baselineNs = 0;
+    result.regressed = false;
+    return result;
+}
+
+uint8_t BenchSuite::run(const char* prefix) {
+    resultCount = 0;
+    for (uint8_t i = 0; i < caseCount; i++) {
+        if (prefix && strncmp(cases[i].name, prefix, strlen(prefix)) != 0) {
+            continue;
+        }
+        results[resultCount] = measure(cases[i]);
+        DEBUG_PRINT("[BENCH] %-24s %10.1f ns/op\n", cases[i].name, results[resultCount].medianNs);
+        resultCount++;
+    }
+    return resultCount;
+}
+
+const BenchResult* BenchSuite::find(const char* name) const {
+    for (uint8_t i = 0; i < resultCount; i++) {
+        if (strcmp(results[i].name, name) == 0) {
+            return &results[i];
+        }
+    }
+    return nullptr;
+}
+
+// Not a general JSON parser: it relies on writeJson()'s layout, where every
+// case object carries "name" before "median_ns"
+uint8_t BenchSuite::compare(const char* baselineJson, float tolerance) {
+    uint8_t regressions = 0;
+    for (uint8_t i = 0; i < resultCount; i++) {
+        results[i].baselineNs = 0;
+        results[i].regressed = false;
+    }
+    const char* cursor = baselineJson;
+    while (cursor && (cursor = strstr(cursor, "\"name\": \"")) != nullptr) {
+        cursor += 9;
+        const char* end = strchr(cursor, '"');
+        const char* median = strstr(cursor, "\"median_ns\": ");
+        const char* close = strchr(cursor, '}');
+        if (!end || !median || (close && median > close)) {
+            break;
+        }
+        for (uint8_t i = 0; i < resultCount; i++) {
+            BenchResult& result = results[i];
+            if (strlen(result.name) == (size_t)(end - cursor) && strncmp(result.name, cursor, end - cursor) == 0) {
+                result.baselineNs = strtof(median + 13, nullptr);
+                result.regressed = result.baselineNs > 0 && result.medianNs > result.baselineNs * (1.0f + tolerance);
+                if (result.regressed) {
+                    regressions++;
+                }
+            }
+        }
+        cursor = end;
+    }
+    return regressions;
+}
+
+void BenchSuite::writeJson(FILE* out, const char* platform) const {
+    fprintf(out, "{\n  \"platform\": \"%s\",\n  \"samples\": %d,\n  \"cases\": [\n", platform, BENCH_SAMPLES);
+    for (uint8_t i = 0; i < resultCount; i++) {
+        const BenchResult& result = results[i];
+        fprintf(out, "    {\"name\": \"%s\", \"iterations\": %lu, \"median_ns\": %.2f, \"min_ns\": %.2f, \"max_ns\": %.2f",
+                result.name, (unsigned long)result.iterations, result.medianNs, result.minNs, result.maxNs);
+        if (result.baselineNs > 0) {
+            fprintf(out, ", \"baseline_ns\": %.2f, \"ratio\": %.3f, \"regressed\": %s", result.baselineNs,
+                    result.medianNs / result.baselineNs, result.regressed ? "true" : "false");
+        }
+        fprintf(out, "}%s\n", i + 1 < resultCount ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
@@ -0,0 +1,190 @@
+#include "../../include/utilities/config_override.h"
+#include "../../include/utilities/flight_recorder.h"
+#include "../../include/utilities/varint.h"
+
+#ifdef ARDUINO
+#include <Preferences.h>
+#endif
+
+static const uint8_t kMagic[2] = {'C', 'F'};
+
+TunableConfig tunableDefaults() {
+    TunableConfig config;
+    config.maxTxPowerDbm = LORA_TX_POWER;
+    config.heartbeatIntervalMs = HEARTBEAT_INTERVAL_MS;
+    return config;
+}
+
+static const ConfigFieldLimits* findLimits(uint8_t field) {
+    for (uint8_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        if (CONFIG_FIELD_LIMITS[i].field == field) {
+            return &CONFIG_FIELD_LIMITS[i];
+        }
+    }
+    return nullptr;
+}
+
+static void setField(TunableConfig& config, uint8_t field, int32_t value) {
+    switch (field) {
+        case CONFIG_FIELD_MAX_TX_POWER_DBM: config.maxTxPowerDbm = (int8_t)value; break;
+        case CONFIG_FIELD_HEARTBEAT_INTERVAL_MS: config.heartbeatIntervalMs = (uint32_t)value; break;
+        default: break;
+    }
+}
+
+static uint32_t readHash(const uint8_t* bytes) {
+    return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+ConfigOverrideResult applyConfigOverride(const uint8_t* blob, size_t length, uint8_t droneId, TunableConfig& config) {
+    if (length < CONFIG_OVERRIDE_HEADER_BYTES + 2 || length > CONFIG_OVERRIDE_MAX_BYTES ||
+        blob[0] != kMagic[0] || blob[1] != kMagic[1] || blob[2] != CONFIG_OVERRIDE_VERSION) {
+        return CONFIG_OVERRIDE_MALFORMED;
+    }
+    size_t end = length - 2;
+    if (flightCrc16(blob, end) != (uint16_t)(blob[end] | blob[end + 1] << 8)) {
+        return CONFIG_OVERRIDE_MALFORMED;
+    }
+    if (blob[3] != 0 && blob[3] != droneId) {
+        return CONFIG_OVERRIDE_OTHER_DRONE;
+    }
+    if (readHash(blob + 4) != SWARM_CONFIG_HASH) {
+        return CONFIG_OVERRIDE_STALE;
+    }
+
+    // Into a copy, so a bad field late in the blob leaves config untouched
+    TunableConfig next = config;
+    size_t offset = CONFIG_OVERRIDE_HEADER_BYTES;
+    while (offset < end) {
+        uint8_t field = blob[offset++];
+        uint32_t encoded;
+        size_t used = varintRead(blob + offset, end - offset, encoded);
+        if (!used) {
+            return CONFIG_OVERRIDE_MALFORMED;
+        }
+        offset += used;
+        int32_t value = zigzagDecode(encoded);
+        const ConfigFieldLimits* limits = findLimits(field);
+        if (!limits || value < limits->min || value > limits->max) {
+            return CONFIG_OVERRIDE_BAD_FIELD;
+        }
+        setField(next, field, value);
+    }
+    config = next;
+    return CONFIG_OVERRIDE_OK;
+}
+
+size_t encodeConfigOverride(uint8_t droneId, uint32_t configHash, const ConfigFieldValue* values, uint8_t count,
+                            uint8_t* out, size_t capacity) {
+    if (capacity < CONFIG_OVERRIDE_HEADER_BYTES + 2) {
+        return 0;
+    }
+    out[0] = kMagic[0];
+    out[1] = kMagic[1];
+    out[2] = CONFIG_OVERRIDE_VERSION;
+    out[3] = droneId;
+    for (uint8_t i = 0; i < 4; i++) {
+        out[4 + i] = (uint8_t)(configHash >> (8 * i));
+    }
+    size_t length = CONFIG_OVERRIDE_HEADER_BYTES;
+    for (uint8_t i = 0; i < count; i++) {
+        if (length + 1 + 2 > capacity) {
+            return 0;
+        }
+        out[length++] = values[i].field;
+        size_t used = varintWrite(out + length, capacity - 2 - length, zigzagEncode(values[i].value));
+        if (!used) {
+            return 0;
+        }
+        length += used;
+    }
+    uint16_t crc = flightCrc16(out, length);
+    out[length++] = (uint8_t)crc;
+    out[length++] = (uint8_t)(crc >> 8);
+    return length;
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+size_t configOverrideFromHex(const char* hex, uint8_t* out, size_t capacity) {
+    size_t length = 0;
+    int high = -1;
+    for (; *hex; hex++) {
+        if (*hex == ' ' || *hex == '\r' || *hex == '\n') {
+            continue;
+        }
+        int digit = hexDigit(*hex);
+        if (digit < 0) {
+            return 0;
+        }
+        if (high < 0) {
+            high = digit;
+            continue;
+        }
+        if (length >= capacity) {
+            return 0;
+        }
+        out[length++] = (uint8_t)(high << 4 | digit);
+        high = -1;
+    }
+    return high < 0 ? length : 0;
+}
+
+const char* getConfigOverrideResultName(ConfigOverrideResult result) {
+    switch (result) {
+        case CONFIG_OVERRIDE_OK: return "OK";
+        case CONFIG_OVERRIDE_NONE: return "None";
+        case CONFIG_OVERRIDE_MALFORMED: return "Malformed";
+        case CONFIG_OVERRIDE_OTHER_DRONE: return "Other drone";
+        case CONFIG_OVERRIDE_STALE: return "Stale";
+        case CONFIG_OVERRIDE_BAD_FIELD: return "Bad field";
+        case CONFIG_OVERRIDE_NOT_STORED: return "Not stored";
+        default: return "Unknown";
+    }
+}
+
+#ifdef ARDUINO
+ConfigOverrideResult loadConfigOverride(uint8_t droneId, TunableConfig& config) {
+    Preferences prefs;
+    if (!prefs.begin(CONFIG_NVS_NAMESPACE, true)) {
+        return CONFIG_OVERRIDE_NONE;
+    }
+    uint8_t blob[CONFIG_OVERRIDE_MAX_BYTES];
+    size_t length = prefs.isKey("override") ? prefs.getBytes("override", blob, sizeof(blob)) : 0;
+    prefs.end();
+    if (!length) {
+        return CONFIG_OVERRIDE_NONE;
+    }
+    return applyConfigOverride(blob, length, droneId, config);
+}
+
+ConfigOverrideResult storeConfigOverride(const uint8_t* blob, size_t length, uint8_t droneId) {
+    TunableConfig scratch = tunableDefaults();
+    ConfigOverrideResult result = applyConfigOverride(blob, length, droneId, scratch);
+    if (result != CONFIG_OVERRIDE_OK) {
+        return result;
+    }
+    Preferences prefs;
+    if (!prefs.begin(CONFIG_NVS_NAMESPACE, false)) {
+        return CONFIG_OVERRIDE_NOT_STORED;
+    }
+    size_t put = prefs.putBytes("override", blob, length);
+    prefs.end();
+    return put == length ? CONFIG_OVERRIDE_OK : CONFIG_OVERRIDE_NOT_STORED;
+}
+
+bool clearConfigOverride() {
+    Preferences prefs;
+    if (!prefs.begin(CONFIG_NVS_NAMESPACE, false)) {
+        return false;
+    }
+    bool removed = !prefs.isKey("override") || prefs.remove("override");
+    prefs.end();
+    return removed;
+}
+#endif
@@ -0,0 +1,563 @@
+#include "../../include/utilities/crypto_utils.h"
+#include "../../include/utilities/performance_monitor.h"
+
+// ===== AES-128 =====
+
+// Boyar-Peralta S-box circuit (113 gates) on bit planes: planes[0] holds the
+// most significant bit of all 16 bytes, planes[7] the least.
+static void sboxPlanes(uint16_t planes[8]) {
+    uint16_t U0 = planes[0], U1 = planes[1], U2 = planes[2], U3 = planes[3];
+    uint16_t U4 = planes[4], U5 = planes[5], U6 = planes[6], U7 = planes[7];
+
+    // Top linear transform
+    uint16_t T1 = U0 ^ U3, T2 = U0 ^ U5, T3 = U0 ^ U6, T4 = U3 ^ U5, T5 = U4 ^ U6;
+    uint16_t T6 = T1 ^ T5, T7 = U1 ^ U2, T8 = U7 ^ T6, T9 = U7 ^ T7, T10 = T6 ^ T7;
+    uint16_t T11 = U1 ^ U5, T12 = U2 ^ U5, T13 = T3 ^ T4, T14 = T6 ^ T11, T15 = T5 ^ T11;
+    uint16_t T16 = T5 ^ T12, T17 = T9 ^ T16, T18 = U3 ^ U7, T19 = T7 ^ T18, T20 = T1 ^ T19;
+    uint16_t T21 = U6 ^ U7, T22 = T7 ^ T21, T23 = T2 ^ T22, T24 = T2 ^ T10, T25 = T20 ^ T17;
+    uint16_t T26 = T3 ^ T16, T27 = T1 ^ T12;
+
+    // Shared non-linear middle (GF(2^8) inversion)
+    uint16_t M1 = T13 & T6, M2 = T23 & T8, M3 = T14 ^ M1, M4 = T19 & U7, M5 = M4 ^ M1;
+    uint16_t M6 = T3 & T16, M7 = T22 & T9, M8 = T26 ^ M6, M9 = T20 & T17, M10 = M9 ^ M6;
+    uint16_t M11 = T1 & T15, M12 = T4 & T27, M13 = M12 ^ M11, M14 = T2 & T10, M15 = M14 ^ M11;
+    uint16_t M16 = M3 ^ M2, M17 = M5 ^ T24, M18 = M8 ^ M7, M19 = M10 ^ M15, M20 = M16 ^ M13;
+    uint16_t M21 = M17 ^ M15, M22 = M18 ^ M13, M23 = M19 ^ T25, M24 = M22 ^ M23, M25 = M22 & M20;
+    uint16_t M26 = M21 ^ M25, M27 = M20 ^ M21, M28 = M23 ^ M25, M29 = M28 & M27, M30 = M26 & M24;
+    uint16_t M31 = M20 & M23, M32 = M27 & M31, M33 = M27 ^ M25, M34 = M21 & M22, M35 = M24 & M34;
+    uint16_t M36 = M24 ^ M25, M37 = M21 ^ M29, M38 = M32 ^ M33, M39 = M23 ^ M30, M40 = M35 ^ M36;
+    uint16_t M41 = M38 ^ M40, M42 = M37 ^ M39, M43 = M37 ^ M38, M44 = M39 ^ M40, M45 = M42 ^ M41;
+    uint16_t M46 = M44 & T6, M47 = M40 & T8, M48 = M39 & U7, M49 = M43 & T16, M50 = M38 & T9;
+    uint16_t M51 = M37 & T17, M52 = M42 & T15, M53 = M45 & T27, M54 = M41 & T10, M55 = M44 & T13;
+    uint16_t M56 = M40 & T23, M57 = M39 & T19, M58 = M43 & T3, M59 = M38 & T22, M60 = M37 & T20;
+    uint16_t M61 = M42 & T1, M62 = M45 & T4, M63 = M41 & T2;
+
+    // Bottom linear transform
+    uint16_t L0 = M61 ^ M62, L1 = M50 ^ M56, L2 = M46 ^ M48, L3 = M47 ^ M55, L4 = M54 ^ M58;
+    uint16_t L5 = M49 ^ M61, L6 = M62 ^ L5, L7 = M46 ^ L3, L8 = M51 ^ M59, L9 = M52 ^ M53;
+    uint16_t L10 = M53 ^ L4, L11 = M60 ^ L2, L12 = M48 ^ M51, L13 = M50 ^ L0, L14 = M52 ^ M61;
+    uint16_t L15 = M55 ^ L1, L16 = M56 ^ L0, L17 = M57 ^ L1, L18 = M58 ^ L8, L19 = M63 ^ L4;
+    uint16_t L20 = L0 ^ L1, L21 = L1 ^ L7, L22 = L3 ^ L12, L23 = L18 ^ L2, L24 = L15 ^ L9;
+    uint16_t L25 = L6 ^ L10, L26 = L7 ^ L9, L27 = L8 ^ L10, L28 = L11 ^ L14, L29 = L11 ^ L17;
+
+    planes[0] = L6 ^ L24;
+    planes[1] = ~(L16 ^ L26);
+    planes[2] = ~(L19 ^ L28);
+    planes[3] = L6 ^ L21;
+    planes[4] = L20 ^ L22;
+    planes[5] = L25 ^ L29;
+    planes[6] = ~(L13 ^ L27);
+    planes[7] = ~(L6 ^ L23);
+}
+
+// 8x8 bit matrix transpose: bit j of byte i <-> bit i of byte j. Its own
+// inverse, so it moves bytes into planes and back.
+static inline uint64_t transpose8(uint64_t x) {
+    uint64_t t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAull;
+    x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCull;
+    x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ull;
+    x ^= t ^ (t << 28);
+    return x;
+}
+
+void aesSubBytes(uint8_t state[16]) {
+    uint64_t low, high;
+    memcpy(&low, state, 8);
+    memcpy(&high, state + 8, 8);
+    low = transpose8(low);
+    high = transpose8(high);
+
+    // Byte 7 - b of each half now holds bit 7 - b of its eight bytes
+    uint16_t planes[8];
+    for (uint8_t b = 0; b < 8; b++) {
+        uint8_t shift = 8 * (7 - b);
+        planes[b] = (uint16_t)((low >> shift) & 0xFF) | (uint16_t)(((high >> shift) & 0xFF) << 8);
+    }
+    sboxPlanes(planes);
+    low = 0;
+    high = 0;
+    for (uint8_t b = 0; b < 8; b++) {
+        uint8_t shift = 8 * (7 - b);
+        low |= (uint64_t)(planes[b] & 0xFF) << shift;
+        high |= (uint64_t)(planes[b] >> 8) << shift;
+    }
+    low = transpose8(low);
+    high = transpose8(high);
+    memcpy(state, &low, 8);
+    memcpy(state + 8, &high, 8);
+}
+
+static inline uint8_t xtime(uint8_t x) {
+    return (x << 1) ^ (0x1B & -(x >> 7));
+}
+
+void Aes128::setKey(const uint8_t key[CRYPTO_KEY_BYTES]) {
+    memcpy(roundKeys, key, CRYPTO_KEY_BYTES);
+    uint8_t rcon = 0x01;
+    for (uint8_t i = 16; i < 176; i += 4) {
+        uint8_t word[16] = {0};
+        memcpy(word, &roundKeys[i - 4], 4);
+        if (i % 16 == 0) {
+            // RotWord, SubWord, Rcon
+            uint8_t first = word[0];
+            word[0] = word[1];
+            word[1] = word[2];
+            word[2] = word[3];
+            word[3] = first;
+            aesSubBytes(word);
+            word[0] ^= rcon;
+            rcon = xtime(rcon);
+        }
+        for (uint8_t j = 0; j < 4; j++) {
+            roundKeys[i + j] = roundKeys[i - 16 + j] ^ word[j];
+        }
+    }
+}
+
+void Aes128::encryptBlock(const uint8_t in[16], uint8_t out[16]) const {
+    uint8_t s[16];
+    for (uint8_t i = 0; i < 16; i++) {
+        s[i] = in[i] ^ roundKeys[i];
+    }
+
+    for (uint8_t round = 1; round <= 10; round++) {
+        aesSubBytes(s);
+
+        // ShiftRows; the state is column-major, byte r + 4c is row r
+        uint8_t t = s[1];
+        s[1] = s[5]; s[5] = s[9]; s[9] = s[13]; s[13] = t;
+        t = s[2]; s[2] = s[10]; s[10] = t;
+        t = s[6]; s[6] = s[14]; s[14] = t;
+        t = s[15]; s[15] = s[11]; s[11] = s[7]; s[7] = s[3]; s[3] = t;
+
+        if (round < 10) {
+            for (uint8_t c = 0; c < 16; c += 4) {
+                uint8_t a0 = s[c], a1 = s[c + 1], a2 = s[c + 2], a3 = s[c + 3];
+                uint8_t all = a0 ^ a1 ^ a2 ^ a3;
+                s[c] = a0 ^ all ^ xtime(a0 ^ a1);
+                s[c + 1] = a1 ^ all ^ xtime(a1 ^ a2);
+                s[c + 2] = a2 ^ all ^ xtime(a2 ^ a3);
+                s[c + 3] = a3 ^ all ^ xtime(a3 ^ a0);
+            }
+        }
+
+        const uint8_t* roundKey = &roundKeys[round * 16];
+        for (uint8_t i = 0; i < 16; i++) {
+            s[i] ^= roundKey[i];
+        }
+    }
+    memcpy(out, s, 16);
+}
+
+// ===== SHA-256 =====
+
+static const uint32_t kSha256K[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+static inline uint32_t rotr(uint32_t x, uint8_t n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+void Sha256::begin() {
+    static const uint32_t initial[8] = {
+        0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+    };
+    memcpy(state, initial, sizeof(state));
+    total = 0;
+    used = 0;
+}
+
+void Sha256::compress(const uint8_t* in) {
+    uint32_t w[64];
+    for (uint8_t i = 0; i < 16; i++) {
+        w[i] = (uint32_t)in[4 * i] << 24 | (uint32_t)in[4 * i + 1] << 16 | (uint32_t)in[4 * i + 2] << 8 | in[4 * i + 3];
+    }
+    for (uint8_t i = 16; i < 64; i++) {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (uint8_t i = 0; i < 64; i++) {
+        uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + kSha256K[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void Sha256::update(const void* data, size_t length) {
+    const uint8_t* in = (const uint8_t*)data;
+    total += length;
+    if (used) {
+        size_t take = length < (size_t)(64 - used) ? length : 64 - used;
+        memcpy(block + used, in, take);
+        used += take;
+        in += take;
+        length -= take;
+        if (used < 64) {
+            return;
+        }
+        compress(block);
+        used = 0;
+    }
+    for (; length >= 64; in += 64, length -= 64) {
+        compress(in);
+    }
+    memcpy(block, in, length);
+    used = (uint8_t)length;
+}
+
+void Sha256::finish(uint8_t digest[CRYPTO_SHA256_BYTES]) {
+    uint64_t bits = total * 8;
+    uint8_t pad[72] = {0x80};
+    size_t padLength = (used < 56 ? 56 : 120) - used;
+    for (uint8_t i = 0; i < 8; i++) {
+        pad[padLength + i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+    update(pad, padLength + 8);
+    for (uint8_t i = 0; i < 8; i++) {
+        digest[4 * i] = (uint8_t)(state[i] >> 24);
+        digest[4 * i + 1] = (uint8_t)(state[i] >> 16);
+        digest[4 * i + 2] = (uint8_t)(state[i] >> 8);
+        digest[4 * i + 3] = (uint8_t)state[i];
+    }
+}
+
+// ===== CCM =====
+
+#define CCM_LENGTH_BYTES 2      // L; nonce is 15 - L bytes
+
+static void ccmCounterBlock(const uint8_t nonce[CRYPTO_NONCE_BYTES], uint16_t counter, uint8_t block[16]) {
+    block[0] = CCM_LENGTH_BYTES - 1;
+    memcpy(&block[1], nonce, CRYPTO_NONCE_BYTES);
+    block[14] = counter >> 8;
+    block[15] = counter & 0xFF;
+}
+
+// CBC-MAC over B0 | encoded AAD | plaintext, each zero-padded to blocks
+static void ccmMac(const Aes128& aes, const uint8_t nonce[CRYPTO_NONCE_BYTES], const uint8_t* aad,
+                             size_t aadLength, const uint8_t* plain, size_t length, uint8_t tagLength,
+                             uint8_t mac[16]) {
+    uint8_t block[16];
+    block[0] = (aadLength ? 0x40 : 0) | (((tagLength - 2) / 2) << 3) | (CCM_LENGTH_BYTES - 1);
+    memcpy(&block[1], nonce, CRYPTO_NONCE_BYTES);
+    block[14] = length >> 8;
+    block[15] = length & 0xFF;
+    aes.encryptBlock(block, mac);
+
+    if (aadLength) {
+        // Two-byte length prefix; AAD here is always far below 0xFF00
+        uint8_t fill = 2;
+        mac[0] ^= aadLength >> 8;
+        mac[1] ^= aadLength & 0xFF;
+        for (size_t i = 0; i < aadLength; i++) {
+            mac[fill++] ^= aad[i];
+            if (fill == 16) {
+                aes.encryptBlock(mac, mac);
+                fill = 0;
+            }
+        }
+        if (fill) {
+            aes.encryptBlock(mac, mac);
+        }
+    }
+
+    for (size_t i = 0; i < length; i += 16) {
+        size_t chunk = length - i < 16 ? length - i : 16;
+        for (size_t j = 0; j < chunk; j++) {
+            mac[j] ^= plain[i + j];
+        }
+        aes.encryptBlock(mac, mac);
+    }
+}
+
+static void ccmCtr(const Aes128& aes, const uint8_t nonce[CRYPTO_NONCE_BYTES], const uint8_t* in,
+                             uint8_t* out, size_t length) {
+    uint8_t counter[16];
+    uint8_t stream[16];
+    for (size_t i = 0; i < length; i += 16) {
+        ccmCounterBlock(nonce, 1 + i / 16, counter);
+        aes.encryptBlock(counter, stream);
+        size_t chunk = length - i < 16 ? length - i : 16;
+        for (size_t j = 0; j < chunk; j++) {
+            out[i + j] = in[i + j] ^ stream[j];
+        }
+    }
+}
+
+void aesCcmSeal(const Aes128& aes, const uint8_t nonce[CRYPTO_NONCE_BYTES], const uint8_t* aad, size_t aadLength,
+                const uint8_t* in, uint8_t* out, size_t length, uint8_t* tag, uint8_t tagLength) {
+    uint8_t mac[16];
+    uint8_t s0[16];
+    ccmMac(aes, nonce, aad, aadLength, in, length, tagLength, mac);
+    ccmCounterBlock(nonce, 0, s0);
+    aes.encryptBlock(s0, s0);
+    for (uint8_t i = 0; i < tagLength; i++) {
+        tag[i] = mac[i] ^ s0[i];
+    }
+    ccmCtr(aes, nonce, in, out, length);
+}
+
+bool aesCcmOpen(const Aes128& aes, const uint8_t nonce[CRYPTO_NONCE_BYTES], const uint8_t* aad,
+                          size_t aadLength, const uint8_t* in, uint8_t* out, size_t length, const uint8_t* tag,
+                          uint8_t tagLength) {
+    uint8_t mac[16];
+    uint8_t s0[16];
+    ccmCtr(aes, nonce, in, out, length);
+    ccmMac(aes, nonce, aad, aadLength, out, length, tagLength, mac);
+    ccmCounterBlock(nonce, 0, s0);
+    aes.encryptBlock(s0, s0);
+
+    // Constant-time compare
+    uint8_t diff = 0;
+    for (uint8_t i = 0; i < tagLength; i++) {
+        diff |= tag[i] ^ mac[i] ^ s0[i];
+    }
+    if (diff) {
+        memset(out, 0, length);
+        return false;
+    }
+    return true;
+}
+
+// ===== SecureLink =====
+
+// Authenticated header: everything before data[], plus the checksum
+#define FRAME_HEADER_BYTES offsetof(DroneMessage, data)
+#define FRAME_AAD_BYTES (FRAME_HEADER_BYTES + 1)
+
+static void frameAad(const DroneMessage& msg, uint8_t aad[FRAME_AAD_BYTES]) {
+    memcpy(aad, &msg, FRAME_HEADER_BYTES);
+    aad[FRAME_HEADER_BYTES] = msg.checksum;
+}
+
+SecureLink::SecureLink(uint8_t nodeId, const uint8_t key[CRYPTO_KEY_BYTES])
+    : nodeId(nodeId), txEpoch(0), txSequence(0) {
+    aes.setKey(key);
+#if defined(ARDUINO) && CRYPTO_HW_AES
+    mbedtls_ccm_init(&hw);
+    mbedtls_ccm_setkey(&hw, MBEDTLS_CIPHER_ID_AES, key, CRYPTO_KEY_BYTES * 8);
+#endif
+    memset(&stats, 0, sizeof(stats));
+    resetReplayState();
+}
+
+SecureLink::~SecureLink() {
+#if defined(ARDUINO) && CRYPTO_HW_AES
+    mbedtls_ccm_free(&hw);
+#endif
+}
+
+void SecureLink::setEpoch(uint16_t epoch) {
+    txLock.lock();
+    txEpoch = epoch;
+    txSequence = 0;
+    txLock.unlock();
+}
+
+void SecureLink::resume(uint16_t epoch, uint16_t sequence) {
+    txLock.lock();
+    txEpoch = epoch;
+    txSequence = sequence;
+    txLock.unlock();
+}
+
+void SecureLink::resetReplayState() {
+    memset(sources, 0, sizeof(sources));
+}
+
+uint8_t SecureLink::saveReplayState(ReplaySnapshot* out, uint8_t maxSources, uint32_t now) const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < CRYPTO_REPLAY_SOURCES && count < maxSources; i++) {
+        const ReplayState& s = sources[i];
+        if (!s.used) {
+            continue;
+        }
+        ReplaySnapshot& snapshot = out[count++];
+        snapshot.sourceId = s.sourceId;
+        snapshot.epoch = s.epoch;
+        snapshot.highest = s.highest;
+        snapshot.window = s.window;
+        snapshot.ageMs = now - s.lastAccepted;
+    }
+    return count;
+}
+
+void SecureLink::restoreReplayState(const ReplaySnapshot* in, uint8_t count, uint32_t now) {
+    for (uint8_t i = 0; i < count; i++) {
+        ReplayState* state = findSource(in[i].sourceId, now);
+        if (state->used) {
+            continue;               // Known already, or no free slot left
+        }
+        state->used = true;
+        state->sourceId = in[i].sourceId;
+        state->epoch = in[i].epoch;
+        state->highest = in[i].highest;
+        state->window = in[i].window;
+        state->lastAccepted = now - in[i].ageMs;
+    }
+}
+
+void SecureLink::buildNonce(uint8_t sourceId, uint16_t epoch, uint16_t sequence,
+                                      uint8_t nonce[CRYPTO_NONCE_BYTES]) {
+    memset(nonce, 0, CRYPTO_NONCE_BYTES);
+    nonce[0] = sourceId;
+    nonce[1] = epoch >> 8;
+    nonce[2] = epoch & 0xFF;
+    nonce[3] = sequence >> 8;
+    nonce[4] = sequence & 0xFF;
+}
+
+bool SecureLink::seal(DroneMessage& msg, SecureFrame& out) {
+    PERF_SCOPE(PERF_CRYPTO);
+    txLock.lock();
+    bool epochAdvanced = false;
+    if (++txSequence == 0) {
+        // Sequence wrapped: move to a fresh nonce space
+        txEpoch++;
+        epochAdvanced = true;
+    }
+    uint16_t epoch = txEpoch;
+    msg.sequenceNumber = txSequence;
+    stats.sealed++;
+    txLock.unlock();
+
+    msg.sourceId = nodeId;
+    msg.checksum = droneMessageChecksum(msg);
+
+    uint8_t nonce[CRYPTO_NONCE_BYTES];
+    uint8_t aad[FRAME_AAD_BYTES];
+    buildNonce(nodeId, epoch, msg.sequenceNumber, nonce);
+    frameAad(msg, aad);
+    out.msg = msg;
+    out.epoch = epoch;
+#if defined(ARDUINO) && CRYPTO_HW_AES
+    mbedtls_ccm_encrypt_and_tag(&hw, sizeof(msg.data), nonce, CRYPTO_NONCE_BYTES, aad, FRAME_AAD_BYTES, msg.data,
+                                out.msg.data, out.tag, CRYPTO_TAG_BYTES);
+#else
+    aesCcmSeal(aes, nonce, aad, FRAME_AAD_BYTES, msg.data, out.msg.data, sizeof(msg.data), out.tag,
+               CRYPTO_TAG_BYTES);
+#endif
+    return epochAdvanced;
+}
+
+CryptoResult SecureLink::open(const SecureFrame& frame, DroneMessage& out, uint32_t now) {
+    PERF_SCOPE(PERF_CRYPTO);
+    const DroneMessage& wire = frame.msg;
+    uint16_t epoch = frame.epoch;
+
+    // Cheap replay check first; the window itself only moves after the tag verifies
+    ReplayState* state = findSource(wire.sourceId, now);
+    CryptoResult result = checkReplay(state, wire.sourceId, epoch, wire.sequenceNumber);
+    if (result != CRYPTO_OK) {
+        if (result == CRYPTO_REPLAY) {
+            stats.replayed++;
+        } else {
+            stats.staleEpoch++;
+        }
+        return result;
+    }
+
+    uint8_t nonce[CRYPTO_NONCE_BYTES];
+    uint8_t aad[FRAME_AAD_BYTES];
+    buildNonce(wire.sourceId, epoch, wire.sequenceNumber, nonce);
+    frameAad(wire, aad);
+    out = wire;
+#if defined(ARDUINO) && CRYPTO_HW_AES
+    bool valid = mbedtls_ccm_auth_decrypt(&hw, sizeof(wire.data), nonce, CRYPTO_NONCE_BYTES, aad, FRAME_AAD_BYTES,
+                                          wire.data, out.data, frame.tag, CRYPTO_TAG_BYTES) == 0;
+#else
+    bool valid = aesCcmOpen(aes, nonce, aad, FRAME_AAD_BYTES, wire.data, out.data, sizeof(wire.data), frame.tag,
+                            CRYPTO_TAG_BYTES);
+#endif
+    if (!valid) {
+        stats.badTag++;
+        return CRYPTO_BAD_TAG;
+    }
+
+    acceptReplay(state, wire.sourceId, epoch, wire.sequenceNumber, now);
+    stats.opened++;
+    return CRYPTO_OK;
+}
+
+// Existing state for `sourceId`, else a free slot, else the quietest
+// source's slot. A slot is only (re)claimed in acceptReplay().
+SecureLink::ReplayState* SecureLink::findSource(uint8_t sourceId, uint32_t now) {
+    ReplayState* free = nullptr;
+    ReplayState* quietest = nullptr;
+    for (uint8_t i = 0; i < CRYPTO_REPLAY_SOURCES; i++) {
+        ReplayState* s = &sources[i];
+        if (!s->used) {
+            if (!free) free = s;
+            continue;
+        }
+        if (s->sourceId == sourceId) {
+            return s;
+        }
+        if (!quietest || now - s->lastAccepted > now - quietest->lastAccepted) {
+            quietest = s;
+        }
+    }
+    return free ? free : quietest;
+}
+
+CryptoResult SecureLink::checkReplay(const ReplayState* state, uint8_t sourceId, uint16_t epoch,
+                                               uint16_t sequence) const {
+    if (!state->used || state->sourceId != sourceId) {
+        return CRYPTO_OK;           // First contact: whatever epoch it is on
+    }
+    // Epochs never wrap in practice (65535 reboots); sequences never wrap
+    // within one, so plain comparisons are enough
+    if (epoch != state->epoch) {
+        return epoch > state->epoch ? CRYPTO_OK : CRYPTO_STALE_EPOCH;
+    }
+    if (sequence > state->highest) {
+        return CRYPTO_OK;
+    }
+    uint16_t age = state->highest - sequence;
+    if (age >= CRYPTO_REPLAY_WINDOW || (state->window >> age) & 1) {
+        return CRYPTO_REPLAY;
+    }
+    return CRYPTO_OK;
+}
+
+void SecureLink::acceptReplay(ReplayState* state, uint8_t sourceId, uint16_t epoch, uint16_t sequence,
+                                        uint32_t now) {
+    if (state->used && state->sourceId != sourceId) {
+        stats.evicted++;
+    }
+    if (!state->used || state->sourceId != sourceId || epoch != state->epoch) {
+        state->used = true;
+        state->sourceId = sourceId;
+        state->epoch = epoch;
+        state->highest = sequence;
+        state->window = 1;
+    } else if (sequence > state->highest) {
+        uint16_t shift = sequence - state->highest;
+        state->window = shift < 32 ? (state->window << shift) | 1 : 1;
+        state->highest = sequence;
+    } else {
+        state->window |= 1u << (state->highest - sequence);
+    }
+    state->lastAccepted = now;
+}
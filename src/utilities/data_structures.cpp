@@ -0,0 +1,59 @@
+#include "../../include/utilities/data_structures.h"
+
+// Constant-initialised, so it is valid before any pool's constructor runs
+MemoryPoolBase* MemoryPoolBase::registryHead = nullptr;
+
+ObjectPool<DroneMessage, FRAME_POOL_SIZE> framePool("frames");
+ObjectPool<LogRecord, LOG_POOL_SIZE> logPool("log");
+Arena<SCRATCH_ARENA_BYTES> scratchArena("scratch");
+
+MemoryPoolBase::MemoryPoolBase(const char* name, uint16_t blockSize, uint16_t capacity) {
+    memset(&stats, 0, sizeof(stats));
+    stats.name = name;
+    stats.blockSize = blockSize;
+    stats.capacity = capacity;
+    registryNext = registryHead;
+    registryHead = this;
+}
+
+MemoryPoolBase::~MemoryPoolBase() {
+    MemoryPoolBase** link = &registryHead;
+    while (*link && *link != this) {
+        link = &(*link)->registryNext;
+    }
+    if (*link) {
+        *link = registryNext;
+    }
+}
+
+void MemoryPoolBase::noteAllocated(uint16_t amount) {
+    stats.inUse += amount;
+    stats.allocations++;
+    if (stats.inUse > stats.highWater) {
+        stats.highWater = stats.inUse;
+    }
+}
+
+PoolStats MemoryPoolBase::getStats() const {
+    guard.lock();
+    PoolStats copy = stats;
+    guard.unlock();
+    return copy;
+}
+
+void MemoryPoolBase::resetHighWater() {
+    guard.lock();
+    stats.highWater = stats.inUse;
+    guard.unlock();
+}
+
+void printMemoryPools() {
+    DEBUG_PRINT("\n=== MEMORY POOLS ===\n");
+    DEBUG_PRINT("%-10s %6s %6s %6s %6s %10s %6s\n", "pool", "block", "cap", "used", "peak", "allocs", "fails");
+    for (MemoryPoolBase* pool = MemoryPoolBase::first(); pool; pool = pool->next()) {
+        PoolStats s = pool->getStats();
+        DEBUG_PRINT("%-10s %6u %6u %6u %6u %10lu %6lu\n", s.name, s.blockSize, s.capacity, s.inUse, s.highWater,
+                    (unsigned long)s.allocations, (unsigned long)s.failures);
+    }
+    DEBUG_PRINT("====================\n");
+}
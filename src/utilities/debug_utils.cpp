@@ -0,0 +1,68 @@
+#include "../../include/utilities/debug_utils.h"
+#include "../../include/utilities/time_utils.h"
+
+static PoolLock logQueueLock;
+static LogRecord* logHead = nullptr;
+static LogRecord* logTail = nullptr;
+static uint32_t logDropped = 0;
+
+static const char* levelName(uint8_t level) {
+    switch (level) {
+        case LOG_DEBUG: return "DEBUG";
+        case LOG_INFO: return "INFO";
+        case LOG_WARN: return "WARN";
+        case LOG_ERROR: return "ERROR";
+        default: return "?";
+    }
+}
+
+bool debugLog(LogLevel level, const char* fmt, ...) {
+    LogRecord* record = logPool.allocate();
+    if (!record) {
+        logQueueLock.lock();
+        logDropped++;
+        logQueueLock.unlock();
+        return false;
+    }
+
+    record->timestamp = getCurrentTimestamp();
+    record->level = level;
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(record->text, sizeof(record->text), fmt, args);
+    va_end(args);
+
+    logQueueLock.lock();
+    record->next = nullptr;
+    if (logTail) {
+        logTail->next = record;
+    } else {
+        logHead = record;
+    }
+    logTail = record;
+    logQueueLock.unlock();
+    return true;
+}
+
+uint8_t debugLogFlush(uint8_t maxRecords) {
+    uint8_t printed = 0;
+    while (printed < maxRecords) {
+        logQueueLock.lock();
+        LogRecord* record = logHead;
+        if (record) {
+            logHead = record->next;
+            if (!logHead) logTail = nullptr;
+        }
+        logQueueLock.unlock();
+        if (!record) break;
+
+        DEBUG_PRINT("[%lu] %-5s %s\n", (unsigned long)record->timestamp, levelName(record->level), record->text);
+        logPool.release(record);
+        printed++;
+    }
+    return printed;
+}
+
+uint32_t debugLogDropped() {
+    return logDropped;
+}
@@ -0,0 +1,444 @@
+#include "../../include/utilities/flight_recorder.h"
+#include "../../include/utilities/varint.h"
+#include "../../include/coordination/state_machine.h"
+
+static_assert(FLIGHT_SECTOR_BYTES % FLIGHT_RING_BYTES == 0, "The RAM ring must tile a sector");
+static_assert(FLIGHT_RING_BYTES >= 2 * (4 + 5 + FLIGHT_MAX_BODY) + sizeof(FlightSectorHeader),
+              "A record and a sector header must fit the RAM ring");
+static_assert(FLIGHT_FRAME_HEADER_BYTES + sizeof(((DroneMessage*)0)->data) + sizeof(FlightRxRecord) <= FLIGHT_MAX_BODY,
+              "Frame records must fit FLIGHT_MAX_BODY");
+
+FlightRecorder flightRecorder;
+
+static uint32_t flightMicros() {
+#ifdef ARDUINO
+    return micros();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+uint32_t IRAM_ATTR flightEncodeRecord(uint8_t kind, const void* head, uint8_t headLength, const void* body,
+                                      uint8_t bodyLength, uint32_t deltaMs, uint8_t* out) {
+    uint8_t length = headLength + bodyLength;
+    out[0] = kind;
+    out[1] = length;
+    uint32_t at = 2 + varintWrite(out + 2, 5, deltaMs);
+    if (headLength) {
+        memcpy(out + at, head, headLength);
+    }
+    if (bodyLength) {
+        memcpy(out + at + headLength, body, bodyLength);
+    }
+    at += length;
+    uint16_t crc = flightCrc16(out, at);
+    out[at] = (uint8_t)crc;
+    out[at + 1] = (uint8_t)(crc >> 8);
+    return at + 2;
+}
+
+int flightParseRecord(const uint8_t* in, uint32_t available, FlightRecordView& out) {
+    if (available == 0) {
+        return -1;
+    }
+    if (in[0] == 0xFF) {
+        return 0;
+    }
+    if (available < 3) {
+        return -1;
+    }
+    uint32_t delta;
+    size_t deltaBytes = varintRead(in + 2, available - 2, delta);
+    if (deltaBytes == 0) {
+        return available - 2 < 5 ? -1 : 0;
+    }
+    uint32_t crcAt = 2 + deltaBytes + in[1];
+    if (crcAt + 2 > available) {
+        return -1;
+    }
+    if (flightCrc16(in, crcAt) != (uint16_t)(in[crcAt] | (in[crcAt + 1] << 8))) {
+        return 0;
+    }
+    out.kind = in[0];
+    out.length = in[1];
+    out.deltaMs = delta;
+    out.body = in + 2 + deltaBytes;
+    return (int)(crcAt + 2);
+}
+
+bool flightParseSectorHeader(const uint8_t* in, FlightSectorHeader& out) {
+    memcpy(&out, in, sizeof(out));
+    return out.magic == FLIGHT_MAGIC && out.crc == flightCrc16(in, offsetof(FlightSectorHeader, crc));
+}
+
+#ifdef ARDUINO
+bool PartitionFlash::begin() {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, FLIGHT_PARTITION_LABEL);
+    return partition != nullptr;
+}
+
+bool PartitionFlash::erase(uint32_t offset) {
+    return esp_partition_erase_range(partition, offset, FLIGHT_SECTOR_BYTES) == ESP_OK;
+}
+
+bool PartitionFlash::write(uint32_t offset, const void* data, uint32_t length) {
+    return esp_partition_write(partition, offset, data, length) == ESP_OK;
+}
+
+bool PartitionFlash::read(uint32_t offset, void* data, uint32_t length) {
+    return esp_partition_read(partition, offset, data, length) == ESP_OK;
+}
+#else
+RamFlash::RamFlash(uint32_t size)
+    : bytes(size - size % FLIGHT_SECTOR_BYTES, 0xFF), budget(UINT32_MAX), erases(0), writes(0), bytesWritten(0) {}
+
+bool RamFlash::erase(uint32_t offset) {
+    if (budget == 0 || offset % FLIGHT_SECTOR_BYTES || offset + FLIGHT_SECTOR_BYTES > bytes.size()) {
+        return false;
+    }
+    memset(&bytes[offset], 0xFF, FLIGHT_SECTOR_BYTES);
+    erases++;
+    return true;
+}
+
+bool RamFlash::write(uint32_t offset, const void* data, uint32_t length) {
+    if (offset + length > bytes.size()) {
+        return false;
+    }
+    uint32_t allowed = length < budget ? length : budget;
+    const uint8_t* in = (const uint8_t*)data;
+    for (uint32_t i = 0; i < allowed; i++) {
+        bytes[offset + i] &= in[i];
+    }
+    if (budget != UINT32_MAX) {
+        budget -= allowed;
+    }
+    writes++;
+    bytesWritten += allowed;
+    return allowed == length;
+}
+
+bool RamFlash::read(uint32_t offset, void* data, uint32_t length) {
+    if (offset + length > bytes.size()) {
+        return false;
+    }
+    memcpy(data, &bytes[offset], length);
+    return true;
+}
+#endif
+
+FlightRecorder::FlightRecorder()
+    : flash(nullptr), sectorCount(0), appendSeq(0), appendOffset(0), flushSeq(0), flushOffset(0),
+      erasedSeq(0), lastMs(0), lastFlushMs(0), urgent(false) {
+    resetStats();
+}
+
+uint32_t IRAM_ATTR FlightRecorder::buffered() const {
+    return (appendSeq - flushSeq) * FLIGHT_SECTOR_BYTES + appendOffset - flushOffset;
+}
+
+void IRAM_ATTR FlightRecorder::put(const uint8_t* bytes, uint32_t length) {
+    uint32_t at = appendOffset % FLIGHT_RING_BYTES;
+    uint32_t first = length < FLIGHT_RING_BYTES - at ? length : FLIGHT_RING_BYTES - at;
+    if (bytes) {
+        memcpy(ring + at, bytes, first);
+        memcpy(ring, bytes + first, length - first);
+    } else {
+        memset(ring + at, 0xFF, first);
+        memset(ring, 0xFF, length - first);
+    }
+    appendOffset += length;
+}
+
+void IRAM_ATTR FlightRecorder::openSector(uint32_t now) {
+    put(nullptr, FLIGHT_SECTOR_BYTES - appendOffset);
+    appendSeq++;
+    appendOffset = 0;
+    FlightSectorHeader header;
+    header.magic = FLIGHT_MAGIC;
+    header.sequence = appendSeq;
+    header.baseMs = now;
+    header.reserved = 0xFFFF;
+    header.crc = flightCrc16((const uint8_t*)&header, offsetof(FlightSectorHeader, crc));
+    put((const uint8_t*)&header, sizeof(header));
+    stats.sectorsOpened++;
+}
+
+bool IRAM_ATTR FlightRecorder::append(uint8_t kind, const void* head, uint8_t headLength,
+                                      const void* body, uint8_t bodyLength, uint32_t now, bool restartClock) {
+    if (!flash) {
+        return false;
+    }
+    uint8_t length = headLength + bodyLength;
+    uint8_t record[4 + 5 + FLIGHT_MAX_BODY];
+
+    guard.lock();
+    uint32_t delta = restartClock || (int32_t)(now - lastMs) < 0 ? 0 : now - lastMs;
+    uint32_t size = 4 + varintSize(delta) + length;
+    uint32_t needed = size;
+    bool opens = appendOffset + size > FLIGHT_SECTOR_BYTES;
+    if (opens) {
+        // The new sector's header restarts the clock
+        delta = 0;
+        size = 5 + length;
+        needed = FLIGHT_SECTOR_BYTES - appendOffset + sizeof(FlightSectorHeader) + size;
+    }
+    if (buffered() + needed > FLIGHT_RING_BYTES) {
+        stats.dropped++;
+        guard.unlock();
+        return false;
+    }
+    if (opens) {
+        openSector(now);
+    }
+
+    flightEncodeRecord(kind, head, headLength, body, bodyLength, delta, record);
+    put(record, size);
+
+    lastMs = now;
+    stats.records++;
+    stats.recordBytes += size;
+    guard.unlock();
+    return true;
+}
+
+bool FlightRecorder::recordFrame(bool transmitted, const DroneMessage& msg, int16_t rssi, float snr, uint32_t now) {
+    uint8_t dataLength = msg.dataLength < sizeof(msg.data) ? msg.dataLength : sizeof(msg.data);
+    uint8_t frameBytes = FLIGHT_FRAME_HEADER_BYTES + dataLength;
+    if (transmitted) {
+        return append(FLIGHT_TX, nullptr, 0, &msg, frameBytes, now, false);
+    }
+    FlightRxRecord rx;
+    rx.rssi = rssi;
+    rx.snrQuarterDb = flightSnrQuarters(snr);
+    return append(FLIGHT_RX, &rx, sizeof(rx), &msg, frameBytes, now, false);
+}
+
+// From the radio task too, via MissionStateMachine::emergencyStop()
+bool IRAM_ATTR FlightRecorder::recordState(uint8_t from, uint8_t to, uint8_t reason, uint32_t now) {
+    FlightStateRecord state;
+    state.from = from;
+    state.to = to;
+    state.reason = reason;
+    if (to == MISSION_EMERGENCY_STOP) {
+        guard.lock();
+        urgent = true;
+        guard.unlock();
+    }
+    return append(FLIGHT_STATE, nullptr, 0, &state, sizeof(state), now, false);
+}
+
+bool FlightRecorder::recordTimer(int32_t id, const char* name, uint32_t now) {
+    FlightTimerRecord timer;
+    timer.id = id;
+    uint8_t nameLength = 0;
+    while (name && nameLength < TIMEOUT_NAME_LENGTH && name[nameLength]) {
+        nameLength++;
+    }
+    return append(FLIGHT_TIMER, &timer, sizeof(timer), name, nameLength, now, false);
+}
+
+// Newest sector with a valid header, and where its intact records end: 0
+// when the bytes after them are not erased (a torn write)
+bool FlightRecorder::recover(uint32_t& newest, uint32_t& resumeOffset) {
+    bool found = false;
+    uint32_t newestIndex = 0;
+    for (uint32_t i = 0; i < sectorCount; i++) {
+        uint8_t raw[sizeof(FlightSectorHeader)];
+        FlightSectorHeader header;
+        if (!flash->read(i * FLIGHT_SECTOR_BYTES, raw, sizeof(raw)) || !flightParseSectorHeader(raw, header) ||
+            header.sequence % sectorCount != i) {
+            continue;
+        }
+        if (!found || header.sequence > newest) {
+            found = true;
+            newest = header.sequence;
+            newestIndex = i;
+        }
+    }
+    if (!found) {
+        return false;
+    }
+
+    // The RAM ring doubles as the read window; it always holds a whole record
+    uint32_t base = newestIndex * FLIGHT_SECTOR_BYTES;
+    uint32_t offset = sizeof(FlightSectorHeader);
+    for (;;) {
+        uint32_t window = FLIGHT_SECTOR_BYTES - offset < FLIGHT_RING_BYTES ? FLIGHT_SECTOR_BYTES - offset : FLIGHT_RING_BYTES;
+        if (window == 0 || !flash->read(base + offset, ring, window)) {
+            break;
+        }
+        uint32_t at = 0;
+        int used;
+        FlightRecordView view;
+        while ((used = flightParseRecord(ring + at, window - at, view)) > 0) {
+            at += used;
+        }
+        offset += at;
+        if (used == 0 || offset + (window - at) == FLIGHT_SECTOR_BYTES) {
+            break;
+        }
+    }
+
+    resumeOffset = offset;
+    for (uint32_t at = offset; at < FLIGHT_SECTOR_BYTES; at += FLIGHT_RING_BYTES) {
+        uint32_t chunk = FLIGHT_SECTOR_BYTES - at < FLIGHT_RING_BYTES ? FLIGHT_SECTOR_BYTES - at : FLIGHT_RING_BYTES;
+        if (!flash->read(base + at, ring, chunk)) {
+            resumeOffset = 0;
+            break;
+        }
+        for (uint32_t i = 0; i < chunk && resumeOffset; i++) {
+            if (ring[i] != 0xFF) {
+                resumeOffset = 0;
+            }
+        }
+    }
+    return true;
+}
+
+bool FlightRecorder::begin(FlightFlash* storage, uint8_t id, uint8_t resetReason, uint32_t now) {
+    flash = nullptr;
+    if (!storage || storage->size() < 2 * FLIGHT_SECTOR_BYTES) {
+        DEBUG_PRINT("[RECORDER] ERROR: No flash region for the log\n");
+        return false;
+    }
+    sectorCount = storage->size() / FLIGHT_SECTOR_BYTES;
+
+    // recover() and eraseSector() go through `flash`
+    flash = storage;
+    uint32_t newest = 0;
+    uint32_t resumeOffset = 0;
+    bool found = recover(newest, resumeOffset);
+    if (found && resumeOffset) {
+        appendSeq = flushSeq = erasedSeq = newest;
+        appendOffset = flushOffset = resumeOffset;
+        DEBUG_PRINT("[RECORDER] Resuming sector %lu at byte %lu\n", (unsigned long)newest, (unsigned long)resumeOffset);
+    } else {
+        // Fresh log, or the newest sector ends in a torn write: start the next one
+        uint32_t seq = found ? newest + 1 : 0;
+        if (!eraseSector(seq)) {
+            flash = nullptr;
+            DEBUG_PRINT("[RECORDER] ERROR: Erase failed\n");
+            return false;
+        }
+        // openSector() steps on from the end of the previous sector
+        appendSeq = seq - 1;
+        appendOffset = FLIGHT_SECTOR_BYTES;
+        openSector(now);
+        flushSeq = seq;
+        flushOffset = 0;
+        DEBUG_PRINT("[RECORDER] %s log, sector %lu\n", found ? "Torn" : "New", (unsigned long)seq);
+    }
+    lastMs = now;
+    lastFlushMs = now;
+    urgent = false;
+
+    FlightBootRecord boot;
+    boot.nodeId = id;
+    boot.resetReason = resetReason;
+    boot.clockMs = now;
+    return append(FLIGHT_BOOT, nullptr, 0, &boot, sizeof(boot), now, true);
+}
+
+bool FlightRecorder::eraseSector(uint32_t seq) {
+    uint32_t start = flightMicros();
+    bool ok = flash->erase((seq % sectorCount) * FLIGHT_SECTOR_BYTES);
+    stats.flashUs += flightMicros() - start;
+    if (!ok) {
+        stats.flashErrors++;
+        return false;
+    }
+    stats.erases++;
+    erasedSeq = seq;
+    return true;
+}
+
+bool FlightRecorder::program(uint32_t seq, uint32_t from, uint32_t to) {
+    const uint8_t* bytes = ring + from % FLIGHT_RING_BYTES;
+    uint32_t length = to - from;
+    // Padding at a sector's end is already erased
+    uint32_t i = 0;
+    while (i < length && bytes[i] == 0xFF) {
+        i++;
+    }
+    if (i == length) {
+        return true;
+    }
+    uint32_t start = flightMicros();
+    bool ok = flash->write((seq % sectorCount) * FLIGHT_SECTOR_BYTES + from, bytes, length);
+    stats.flashUs += flightMicros() - start;
+    stats.flashWrites++;
+    stats.flashBytes += length;
+    if (!ok) {
+        stats.flashErrors++;
+    }
+    return ok;
+}
+
+// Programs up to (seq, end): whole pages only unless `partial`. Records are
+// appended concurrently past `end`, never over the bytes being programmed.
+void FlightRecorder::drain(uint32_t seq, uint32_t end, bool partial) {
+    // A record can end exactly at its sector's end, leaving flushSeq past seq
+    while ((int32_t)(seq - flushSeq) >= 0) {
+        uint32_t limit = flushSeq == seq ? end : FLIGHT_SECTOR_BYTES;
+        uint32_t pageEnd = (flushOffset / FLIGHT_PAGE_BYTES + 1) * FLIGHT_PAGE_BYTES;
+        uint32_t to;
+        if (limit >= pageEnd) {
+            to = pageEnd;
+        } else if (partial && limit > flushOffset) {
+            to = limit;
+        } else {
+            break;
+        }
+        if ((int32_t)(flushSeq - erasedSeq) > 0 && !eraseSector(flushSeq)) {
+            break;
+        }
+        // A failed write is counted and skipped; retrying would stall the log
+        program(flushSeq, flushOffset, to);
+
+        guard.lock();
+        flushOffset = to;
+        if (flushOffset == FLIGHT_SECTOR_BYTES) {
+            flushSeq++;
+            flushOffset = 0;
+        }
+        guard.unlock();
+    }
+}
+
+void FlightRecorder::service(uint32_t now) {
+    if (!flash) {
+        return;
+    }
+    guard.lock();
+    uint32_t seq = appendSeq;
+    uint32_t end = appendOffset;
+    bool partial = urgent || now - lastFlushMs >= FLIGHT_FLUSH_INTERVAL_MS;
+    urgent = false;
+    guard.unlock();
+
+    drain(seq, end, partial);
+    if (partial) {
+        lastFlushMs = now;
+    }
+    // Erase the next sector early so filling this one never waits on it
+    if (erasedSeq == flushSeq && flushOffset >= FLIGHT_SECTOR_BYTES / 2) {
+        eraseSector(flushSeq + 1);
+    }
+}
+
+void FlightRecorder::flush() {
+    if (!flash) {
+        return;
+    }
+    guard.lock();
+    uint32_t seq = appendSeq;
+    uint32_t end = appendOffset;
+    guard.unlock();
+    drain(seq, end, true);
+}
+
+void FlightRecorder::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
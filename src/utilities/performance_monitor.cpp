@@ -0,0 +1,171 @@
+#include "../../include/utilities/performance_monitor.h"
+
+#ifndef ARDUINO
+#include <chrono>
+#include <thread>
+#endif
+
+PerfMonitor perfMonitor;
+
+#ifdef ARDUINO
+uint8_t IRAM_ATTR perfCoreId() {
+    return xPortGetCoreID();
+}
+#else
+// Host threads stand in for cores, assigned round-robin on first use
+uint8_t perfCoreId() {
+    static std::atomic<uint8_t> nextCore(0);
+    thread_local uint8_t core = nextCore.fetch_add(1, std::memory_order_relaxed) % PERF_MAX_CORES;
+    return core;
+}
+#endif
+
+void PerfHistogram::accumulate(uint32_t* into, uint32_t& maximum) const {
+    for (uint16_t i = 0; i < PERF_BUCKETS; i++) {
+        into[i] += buckets[i].load(std::memory_order_relaxed);
+    }
+    uint32_t m = maxCycles.load(std::memory_order_relaxed);
+    if (m > maximum) maximum = m;
+}
+
+void PerfHistogram::reset() {
+    for (uint16_t i = 0; i < PERF_BUCKETS; i++) {
+        buckets[i].store(0, std::memory_order_relaxed);
+    }
+    maxCycles.store(0, std::memory_order_relaxed);
+}
+
+PerfMonitor::PerfMonitor() : cyclesPerNs(1.0f) {
+}
+
+void PerfMonitor::begin() {
+#ifdef ARDUINO
+    cyclesPerNs = ESP.getCpuFreqMHz() / 1000.0f;
+#elif defined(__x86_64__) || defined(__i386__)
+    // TSC rate against steady_clock over a short window
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t c0 = __rdtsc();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint64_t c1 = __rdtsc();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    cyclesPerNs = (float)((c1 - c0) / ns);
+#else
+    cyclesPerNs = 1.0f;         // perfCycles() already counts nanoseconds
+#endif
+    DEBUG_PRINT("[PERF] Cycle counter at %.2f cycles/ns\n", cyclesPerNs);
+}
+
+void PerfMonitor::snapshot(PerfProbe probe, uint32_t* buckets, uint32_t& maxCycles) const {
+    memset(buckets, 0, PERF_BUCKETS * sizeof(uint32_t));
+    maxCycles = 0;
+    for (uint8_t core = 0; core < PERF_MAX_CORES; core++) {
+        histograms[core][probe].accumulate(buckets, maxCycles);
+    }
+}
+
+PerfSummary PerfMonitor::summarize(PerfProbe probe) const {
+    uint32_t merged[PERF_BUCKETS];
+    uint32_t maximum;
+    snapshot(probe, merged, maximum);
+    uint32_t total = 0;
+    for (uint16_t i = 0; i < PERF_BUCKETS; i++) {
+        total += merged[i];
+    }
+
+    PerfSummary summary = {total, 0, 0, 0, cyclesToNs(maximum)};
+    if (total == 0) {
+        return summary;
+    }
+
+    uint32_t ranks[3] = {(total + 1) / 2, (uint32_t)(total * 0.9f + 0.5f), (uint32_t)(total * 0.99f + 0.5f)};
+    uint32_t* outputs[3] = {&summary.p50Ns, &summary.p90Ns, &summary.p99Ns};
+    uint32_t cumulative = 0;
+    uint8_t next = 0;
+    for (uint16_t i = 0; i < PERF_BUCKETS && next < 3; i++) {
+        cumulative += merged[i];
+        while (next < 3 && cumulative >= ranks[next] && ranks[next] > 0) {
+            *outputs[next++] = cyclesToNs(perfBucketLow(i, PERF_HISTOGRAM_SUB_BITS));
+        }
+    }
+    return summary;
+}
+
+void PerfMonitor::reset() {
+    for (uint8_t core = 0; core < PERF_MAX_CORES; core++) {
+        for (uint8_t p = 0; p < PERF_PROBE_COUNT; p++) {
+            histograms[core][p].reset();
+        }
+    }
+}
+
+uint8_t PerfMonitor::exportStatus(uint8_t* out, uint8_t capacity, uint8_t& cursor) const {
+    if (capacity < sizeof(PerfStatusHeader) + sizeof(PerfStatusRecord)) {
+        return 0;
+    }
+
+    PerfStatusHeader header = {STATUS_PERF_HISTOGRAMS, 0};
+    uint8_t length = sizeof(header);
+    while (cursor < PERF_PROBE_COUNT && length + sizeof(PerfStatusRecord) <= capacity) {
+        PerfSummary s = summarize((PerfProbe)cursor);
+        if (s.count > 0) {
+            PerfStatusRecord record;
+            record.probe = cursor;
+            record.count = s.count;
+            record.p50 = perfEncodeNs(s.p50Ns);
+            record.p90 = perfEncodeNs(s.p90Ns);
+            record.p99 = perfEncodeNs(s.p99Ns);
+            record.max = perfEncodeNs(s.maxNs);
+            memcpy(out + length, &record, sizeof(record));
+            length += sizeof(record);
+            header.recordCount++;
+        }
+        cursor++;
+    }
+    memcpy(out, &header, sizeof(header));
+    return length;
+}
+
+bool PerfMonitor::buildStatusResponse(uint8_t selfId, uint8_t destination, uint16_t sequence,
+                                      uint8_t& cursor, DroneMessage& out) const {
+    if (cursor >= PERF_PROBE_COUNT) {
+        return false;
+    }
+    memset(&out, 0, sizeof(out));
+    out.messageType = MSG_STATUS_RESPONSE;
+    out.sourceId = selfId;
+    out.destinationId = destination;
+    out.sequenceNumber = sequence;
+    out.dataLength = exportStatus(out.data, sizeof(out.data), cursor);
+    out.checksum = droneMessageChecksum(out);
+    return true;
+}
+
+void PerfMonitor::printReport() const {
+    DEBUG_PRINT("\n=== HOT PATH LATENCY (ns) ===\n");
+    DEBUG_PRINT("%-18s %10s %9s %9s %9s %10s\n", "probe", "count", "p50", "p90", "p99", "max");
+    for (uint8_t p = 0; p < PERF_PROBE_COUNT; p++) {
+        PerfSummary s = summarize((PerfProbe)p);
+        if (s.count == 0) continue;
+        DEBUG_PRINT("%-18s %10lu %9lu %9lu %9lu %10lu\n", getProbeName((PerfProbe)p), (unsigned long)s.count,
+                    (unsigned long)s.p50Ns, (unsigned long)s.p90Ns, (unsigned long)s.p99Ns, (unsigned long)s.maxNs);
+    }
+    DEBUG_PRINT("=============================\n");
+}
+
+const char* PerfMonitor::getProbeName(PerfProbe probe) {
+    switch (probe) {
+        case PERF_SEND: return "SEND";
+        case PERF_RECEIVE: return "RECEIVE";
+        case PERF_CHECKSUM: return "CHECKSUM";
+        case PERF_DISPATCH: return "DISPATCH";
+        case PERF_HANDLER_HEARTBEAT: return "HEARTBEAT";
+        case PERF_HANDLER_TARGET: return "TARGET";
+        case PERF_HANDLER_EMERGENCY: return "EMERGENCY";
+        case PERF_HANDLER_FORMATION: return "FORMATION";
+        case PERF_HANDLER_GOSSIP: return "GOSSIP";
+        case PERF_HANDLER_MUTEX: return "MUTEX";
+        case PERF_HANDLER_RAFT: return "RAFT";
+        case PERF_CRYPTO: return "CRYPTO";
+        default: return "UNKNOWN";
+    }
+}
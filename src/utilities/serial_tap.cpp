@@ -0,0 +1,45 @@
+#include "../../include/utilities/serial_tap.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+SerialTap serialTap;
+#endif
+
+uint32_t serialTapEncodeFrame(bool transmitted, const DroneMessage& msg, int16_t rssi, float snr, uint32_t deltaMs,
+                              uint8_t* out) {
+    uint8_t dataLength = msg.dataLength < sizeof(msg.data) ? msg.dataLength : sizeof(msg.data);
+    uint8_t frameBytes = FLIGHT_FRAME_HEADER_BYTES + dataLength;
+    out[0] = SERIAL_TAP_SYNC;
+    if (transmitted) {
+        return 1 + flightEncodeRecord(FLIGHT_TX, nullptr, 0, &msg, frameBytes, deltaMs, out + 1);
+    }
+    FlightRxRecord rx;
+    rx.rssi = rssi;
+    rx.snrQuarterDb = flightSnrQuarters(snr);
+    return 1 + flightEncodeRecord(FLIGHT_RX, &rx, sizeof(rx), &msg, frameBytes, deltaMs, out + 1);
+}
+
+uint32_t serialTapEncodeBoot(uint8_t nodeId, uint8_t resetReason, uint32_t clockMs, uint8_t* out) {
+    FlightBootRecord boot;
+    boot.nodeId = nodeId;
+    boot.resetReason = resetReason;
+    boot.clockMs = clockMs;
+    out[0] = SERIAL_TAP_SYNC;
+    return 1 + flightEncodeRecord(FLIGHT_BOOT, nullptr, 0, &boot, sizeof(boot), 0, out + 1);
+}
+
+#ifdef ARDUINO
+void SerialTap::boot(uint8_t nodeId, uint8_t resetReason, uint32_t now) {
+    uint8_t record[SERIAL_TAP_MAX_BYTES];
+    Serial.write(record, serialTapEncodeBoot(nodeId, resetReason, now, record));
+    lastMs = now;
+}
+
+void SerialTap::frame(bool transmitted, const DroneMessage& msg, int16_t rssi, float snr, uint32_t now) {
+    uint8_t record[SERIAL_TAP_MAX_BYTES];
+    uint32_t delta = (int32_t)(now - lastMs) < 0 ? 0 : now - lastMs;
+    Serial.write(record, serialTapEncodeFrame(transmitted, msg, rssi, snr, delta, record));
+    lastMs = now;
+}
+#endif
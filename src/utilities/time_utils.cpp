@@ -1,8 +1,20 @@
-#include "../include/utilities/time_utils.h"
+#include "../../include/utilities/time_utils.h"
+#include "../../include/utilities/debug_utils.h"
+#include "../../include/utilities/flight_recorder.h"
+
+#ifndef ARDUINO
+#include <chrono>
+#include <thread>
+#endif
 
 unsigned long getCurrentTimestamp()
 {
+#ifdef ARDUINO
     return millis();
+#else
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
 }
 
 bool isTimeout(unsigned long startTime, unsigned long timeoutMs)
@@ -26,96 +38,144 @@ void preciseDelay(unsigned long millisecond)
     unsigned long startTime = getCurrentTimestamp();
     while (!isTimeout(startTime, millisecond))
     {
+#ifdef ARDUINO
         yield();
+#else
+        std::this_thread::yield();
+#endif
     }
 }
-TimeoutManager::TimeoutManager()
+static_assert(TIMEOUT_POOL_SIZE <= 256, "Timeout ids keep the slot in the low byte");
+
+TimeoutManager::TimeoutManager() : timeouts("timers")
 {
     nextTimeoutId = 1;
 }
 
-int TimeoutManager::addTimeout(unsigned long timeoutMs, String name)
+TimeoutManager::TimeoutInfo *TimeoutManager::find(int timeoutId)
 {
-    TimeoutInfo info;
-    info.startTime = getCurrentTimestamp();
-    info.timeoutDuration = timeoutMs;
-    info.isActive = true;
-    info.name = name.length() > 0 ? name : "Timeout_" + String(nextTimeoutId);
-    timeouts[nextTimeoutId] = info;
-    Serial.println("Added timeout ID " + String(nextTimeoutId) + " (" + info.name + ") for " + String(timeoutMs) + "ms");
-    return nextTimeoutId++;
+    if (timeoutId <= 0)
+    {
+        return nullptr;
+    }
+    TimeoutInfo *info = timeouts.at(timeoutId & 0xFF);
+    return info && info->id == timeoutId ? info : nullptr;
 }
-bool TimeoutManager::isTimeoutExpired(int timeoutId)
+
+int TimeoutManager::addTimeout(unsigned long timeoutMs, const char *name)
 {
-    if (timeouts.find(timeoutId) == timeouts.end())
+    TimeoutInfo *info = timeouts.allocate();
+    if (!info)
     {
-        return false;
+        debugLog(LOG_WARN, "No free timeout slot for %s", name ? name : "unnamed");
+        return -1;
     }
-    TimeoutInfo &info = timeouts[timeoutId];
-    if (!info.isActive)
+    int serial = nextTimeoutId++ & 0x7FFFFF;
+    if (nextTimeoutId > 0x7FFFFF)
+    {
+        nextTimeoutId = 1;
+    }
+    info->id = (serial << 8) | timeouts.indexOf(info);
+    info->startTime = getCurrentTimestamp();
+    info->timeoutDuration = timeoutMs;
+    info->isActive = true;
+    if (name && name[0])
+    {
+        snprintf(info->name, sizeof(info->name), "%s", name);
+    }
+    else
+    {
+        snprintf(info->name, sizeof(info->name), "Timeout_%d", serial);
+    }
+    debugLog(LOG_DEBUG, "Added timeout ID %d (%s) for %lums", info->id, info->name, timeoutMs);
+    return info->id;
+}
+bool TimeoutManager::isTimeoutExpired(int timeoutId)
+{
+    TimeoutInfo *info = find(timeoutId);
+    if (!info || !info->isActive)
     {
         return false;
     }
-    return isTimeout(info.startTime, info.timeoutDuration);
+    return isTimeout(info->startTime, info->timeoutDuration);
 }
 
 void TimeoutManager::resetTimeout(int timeoutId)
 {
-    if (timeouts.find(timeoutId) != timeouts.end())
+    TimeoutInfo *info = find(timeoutId);
+    if (info)
     {
-        timeouts[timeoutId].startTime = getCurrentTimestamp();
-        timeouts[timeoutId].isActive = true;
-        Serial.println("Reset timeout ID " + String(timeoutId) + " (" + timeouts[timeoutId].name + ")");
+        info->startTime = getCurrentTimestamp();
+        info->isActive = true;
+        debugLog(LOG_DEBUG, "Reset timeout ID %d (%s)", timeoutId, info->name);
     }
 }
 
 void TimeoutManager::removeTimeout(int timeoutId)
 {
-    if (timeouts.find(timeoutId) != timeouts.end())
+    TimeoutInfo *info = find(timeoutId);
+    if (info)
     {
-        Serial.println("Removed timeout ID " + String(timeoutId) + " (" + timeouts[timeoutId].name + ")");
-        timeouts.erase(timeoutId);
+        debugLog(LOG_DEBUG, "Removed timeout ID %d (%s)", timeoutId, info->name);
+        timeouts.release(info);
     }
 }
-std::vector<int> TimeoutManager::checkAllTimeouts()
+
+uint8_t TimeoutManager::getExpiredTimeouts(int *ids, uint8_t maxIds)
 {
-    std::vector<int> expiredIds = getExpiredTimeouts();
-    for (int id : expiredIds)
+    uint8_t count = 0;
+    for (uint16_t i = 0; i < TIMEOUT_POOL_SIZE && count < maxIds; i++)
     {
-        timeouts[id].isActive = false;
-        Serial.println("TIMEOUT EXPIRED: ID " + String(id) + " (" + timeouts[id].name + ")");
+        TimeoutInfo *info = timeouts.at(i);
+        if (info && info->isActive && isTimeout(info->startTime, info->timeoutDuration))
+        {
+            ids[count++] = info->id;
+        }
     }
-    return expiredIds;
+    return count;
 }
 
-unsigned long TimeoutManager::getRemainingTime(int timeoutId)
+uint8_t TimeoutManager::checkAllTimeouts(int *ids, uint8_t maxIds)
 {
-    if (timeouts.find(timeoutId) == timeouts.end())
+    uint8_t count = getExpiredTimeouts(ids, maxIds);
+    for (uint8_t i = 0; i < count; i++)
     {
-        return 0;
+        TimeoutInfo *info = find(ids[i]);
+        info->isActive = false;
+        debugLog(LOG_INFO, "TIMEOUT EXPIRED: ID %d (%s)", ids[i], info->name);
+        FLIGHT_RECORD_TIMER(ids[i], info->name);
     }
-    TimeoutInfo &info = timeouts[timeoutId];
-    if (!info.isActive)
+    return count;
+}
+
+unsigned long TimeoutManager::getRemainingTime(int timeoutId)
+{
+    TimeoutInfo *info = find(timeoutId);
+    if (!info || !info->isActive)
     {
         return 0;
     }
-    unsigned long elapsed = getTimeDiff(info.startTime, getCurrentTimestamp());
-    if (elapsed >= info.timeoutDuration)
+    unsigned long elapsed = getTimeDiff(info->startTime, getCurrentTimestamp());
+    if (elapsed >= info->timeoutDuration)
     {
         return 0;
     }
-    return info.timeoutDuration - elapsed;
+    return info->timeoutDuration - elapsed;
 }
 
 void TimeoutManager::printStatus()
 {
-    Serial.println("::: TimeoutManager Status :::");
-    Serial.println("Active timeouts: " + String(timeouts.size()));
-    for (auto &pair : timeouts)
+    DEBUG_PRINT("::: TimeoutManager Status :::\n");
+    DEBUG_PRINT("Active timeouts: %u\n", timeouts.size());
+    for (uint16_t i = 0; i < TIMEOUT_POOL_SIZE; i++)
     {
-        TimeoutInfo &info = pair.second;
-        unsigned long remaining = getRemainingTime(pair.first);
-        Serial.println("ID " + String(pair.first) + " (" + info.name + "): " + (info.isActive ? "Active" : "Expired") + ", Remaining: " + String(remaining) + "ms");
+        TimeoutInfo *info = timeouts.at(i);
+        if (!info)
+        {
+            continue;
+        }
+        DEBUG_PRINT("ID %d (%s): %s, Remaining: %lums\n", info->id, info->name,
+                    info->isActive ? "Active" : "Expired", getRemainingTime(info->id));
     }
-    Serial.println("::::::::::::::::::::::");
-}
\ No newline at end of file
+    DEBUG_PRINT("::::::::::::::::::::::\n");
+}
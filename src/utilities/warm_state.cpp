@@ -0,0 +1,246 @@
+#include "../../include/utilities/warm_state.h"
+#include "../../include/utilities/flight_recorder.h"
+#include "../../include/coordination/state_machine.h"
+#include "../../include/communications/emergency_stop.h"
+#include "../../include/communications/lora_interface.h"
+
+#ifdef ARDUINO
+#include <Preferences.h>
+#include <sys/time.h>
+
+RTC_NOINIT_ATTR WarmStateBlock warmRtcBlock;
+
+// The system time is kept on the RTC timer across every reset but power-on
+uint64_t warmClockUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (uint64_t)tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+bool NvsWarmBackup::load(WarmStateBlock& block) {
+    Preferences prefs;
+    if (!prefs.begin(WARM_NVS_NAMESPACE, true)) {
+        return false;
+    }
+    size_t got = prefs.getBytes("state", &block, sizeof(block));
+    prefs.end();
+    return got == sizeof(block);
+}
+
+bool NvsWarmBackup::store(const WarmStateBlock& block) {
+    Preferences prefs;
+    if (!prefs.begin(WARM_NVS_NAMESPACE, false)) {
+        return false;
+    }
+    size_t put = prefs.putBytes("state", &block, sizeof(block));
+    prefs.end();
+    return put == sizeof(block);
+}
+#else
+bool RamWarmBackup::load(WarmStateBlock& block) {
+    if (blob.size() != sizeof(block)) {
+        return false;
+    }
+    memcpy(&block, blob.data(), sizeof(block));
+    return true;
+}
+
+bool RamWarmBackup::store(const WarmStateBlock& block) {
+    const uint8_t* bytes = (const uint8_t*)&block;
+    blob.assign(bytes, bytes + sizeof(block));
+    writes++;
+    return true;
+}
+#endif
+
+WarmStart::WarmStart(WarmStateBlock* rtc, WarmBackup* backup, const WarmComponents& parts)
+    : rtc(rtc), backup(backup), parts(parts), source(WARM_COLD), downtimeMs(0), warmBoots(0), bootAt(0),
+      lastCaptureAt(0), backedUp(false) {
+    memset(&durable, 0, sizeof(durable));
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool WarmStart::isValid(const WarmStateBlock& block) {
+    // Same CRC as the flight recorder's records
+    return block.magic == WARM_STATE_MAGIC && block.version == WARM_STATE_VERSION &&
+           block.length == sizeof(WarmStateBlock) &&
+           block.crc == flightCrc16((const uint8_t*)&block, offsetof(WarmStateBlock, crc));
+}
+
+WarmSource WarmStart::restore(uint32_t now, uint64_t clockUs) {
+    source = WARM_COLD;
+    downtimeMs = 0;
+    warmBoots = 0;
+    bootAt = now;
+
+    WarmStateBlock block;
+    memcpy(&block, rtc, sizeof(block));
+    if (isValid(block) && clockUs >= block.capturedAtUs) {
+        uint64_t down = (clockUs - block.capturedAtUs) / 1000;
+        downtimeMs = down > UINT32_MAX ? UINT32_MAX : (uint32_t)down;
+        if (downtimeMs <= WARM_MAX_DOWNTIME_MS && block.warmBoots < WARM_MAX_WARM_BOOTS) {
+            source = WARM_FROM_RTC;
+            warmBoots = block.warmBoots + 1;
+            uint32_t capturedAt = now - downtimeMs;
+            restoreDurable(block, false, capturedAt, now);
+            restoreVolatile(block, capturedAt);
+        }
+    }
+    if (source == WARM_COLD && backup && backup->load(block) && isValid(block)) {
+        source = WARM_FROM_FLASH;
+        restoreDurable(block, true, now, now);
+        durable = block;
+        backedUp = true;
+    }
+    DEBUG_PRINT("[WARM] %s start, down %lu ms, warm boots %d\n", getSourceName(source),
+                (unsigned long)downtimeMs, warmBoots);
+
+    // Straight away: the next reset must not find the lease this boot is using
+    capture(now, clockUs);
+    return source;
+}
+
+void WarmStart::restoreDurable(const WarmStateBlock& block, bool fromFlash, uint32_t capturedAt, uint32_t now) {
+    if (parts.mission && block.missionState == MISSION_EMERGENCY_STOP) {
+        // Outlives any reset until an explicit clear
+        parts.mission->emergencyStop(block.stopReason, fromFlash ? now : capturedAt - block.stoppedAgeMs);
+    }
+    if (parts.emergency) {
+        parts.emergency->setNextStopId(block.nextStopId + (fromFlash ? WARM_STOP_ID_SKIP : 0));
+    }
+    if (parts.adr && block.spreadingFactor) {
+        parts.adr->resume(block.spreadingFactor, block.adrEpoch, now);
+    }
+}
+
+void WarmStart::restoreVolatile(const WarmStateBlock& block, uint32_t capturedAt) {
+    // A lease at the top of the sequence space means a wrap was close: let
+    // DroneComm::begin() start the next epoch instead
+    if (parts.link && block.linkEpoch && block.sequenceLease < 0xFFFF) {
+        parts.link->resume(block.linkEpoch, block.sequenceLease);
+    }
+    if (parts.link) {
+        uint8_t count = block.replayCount < CRYPTO_REPLAY_SOURCES ? block.replayCount : CRYPTO_REPLAY_SOURCES;
+        parts.link->restoreReplayState(block.replay, count, capturedAt);
+    }
+    if (parts.mission && block.missionState != MISSION_IDLE && block.missionState < MISSION_EMERGENCY_STOP) {
+        parts.mission->transition((MissionState)block.missionState);
+    }
+    if (parts.peers) {
+        uint8_t count = block.peerCount < PEER_TABLE_SIZE ? block.peerCount : PEER_TABLE_SIZE;
+        for (uint8_t i = 0; i < count; i++) {
+            const WarmPeer& saved = block.peers[i];
+            PeerEntry entry;
+            entry.id = saved.id;
+            entry.missionState = saved.missionState;
+            entry.status = saved.status;
+            entry.lastRssi = saved.lastRssi;
+            entry.lastSnrQ2 = saved.lastSnrQ2;
+            entry.heartbeats = saved.heartbeats;
+            entry.lastSeen = capturedAt - saved.ageMs;
+            parts.peers->restore(entry);
+        }
+    }
+}
+
+void WarmStart::fill(WarmStateBlock& block, uint32_t now, uint64_t clockUs) {
+    memset(&block, 0, sizeof(block));
+    block.magic = WARM_STATE_MAGIC;
+    block.version = WARM_STATE_VERSION;
+    block.length = sizeof(WarmStateBlock);
+    block.warmBoots = now - bootAt >= WARM_STABLE_MS ? 0 : warmBoots;
+    block.capturedAtUs = clockUs;
+    block.capturedAtMs = now;
+
+    if (parts.link) {
+        block.linkEpoch = parts.link->getEpoch();
+        uint32_t lease = (uint32_t)parts.link->getSequence() + WARM_SEQUENCE_LEASE;
+        block.sequenceLease = lease > 0xFFFF ? 0xFFFF : (uint16_t)lease;
+        block.replayCount = parts.link->saveReplayState(block.replay, CRYPTO_REPLAY_SOURCES, now);
+    }
+    if (parts.mission) {
+        block.missionState = parts.mission->getState();
+        block.stopReason = parts.mission->getStopReason();
+        block.stoppedAgeMs = now - parts.mission->getStoppedAt();
+    }
+    if (parts.emergency) {
+        block.nextStopId = parts.emergency->getNextStopId();
+    }
+    if (parts.adr) {
+        block.spreadingFactor = parts.adr->getSpreadingFactor();
+        block.adrEpoch = parts.adr->getPlanEpoch();
+    }
+    if (parts.peers) {
+        for (uint8_t slot = 0; slot < PEER_TABLE_SIZE; slot++) {
+            const PeerEntry* entry = parts.peers->at(slot);
+            if (!entry) {
+                continue;
+            }
+            WarmPeer& saved = block.peers[block.peerCount++];
+            saved.id = entry->id;
+            saved.missionState = entry->missionState;
+            saved.status = entry->status;
+            saved.lastRssi = entry->lastRssi;
+            saved.lastSnrQ2 = entry->lastSnrQ2;
+            saved.heartbeats = entry->heartbeats;
+            saved.ageMs = now - entry->lastSeen;
+        }
+    }
+    block.crc = flightCrc16((const uint8_t*)&block, offsetof(WarmStateBlock, crc));
+}
+
+bool WarmStart::durableChanged(const WarmStateBlock& block) const {
+    bool stopped = block.missionState == MISSION_EMERGENCY_STOP;
+    return !backedUp || stopped != (durable.missionState == MISSION_EMERGENCY_STOP) ||
+           (stopped && block.stopReason != durable.stopReason) || block.nextStopId != durable.nextStopId ||
+           block.spreadingFactor != durable.spreadingFactor || block.adrEpoch != durable.adrEpoch;
+}
+
+void WarmStart::capture(uint32_t now, uint64_t clockUs) {
+    WarmStateBlock block;
+    fill(block, now, clockUs);
+    memcpy(rtc, &block, sizeof(block));
+    lastCaptureAt = now;
+    stats.captures++;
+
+    if (backup && durableChanged(block)) {
+        if (backup->store(block)) {
+            durable = block;
+            backedUp = true;
+            stats.backups++;
+        } else {
+            stats.backupErrors++;
+        }
+    }
+}
+
+void WarmStart::service(uint32_t now, uint64_t clockUs) {
+    // Cheap checks against the last snapshot; a full capture only when due
+    bool due = now - lastCaptureAt >= WARM_SAVE_INTERVAL_MS;
+    if (parts.link) {
+        due = due || rtc->linkEpoch != parts.link->getEpoch() ||
+              (uint32_t)parts.link->getSequence() + WARM_SEQUENCE_LEASE / 2 >= rtc->sequenceLease;
+    }
+    if (parts.mission) {
+        due = due || parts.mission->isStopped() != (rtc->missionState == MISSION_EMERGENCY_STOP);
+    }
+    if (parts.emergency) {
+        due = due || parts.emergency->getNextStopId() != rtc->nextStopId;
+    }
+    if (parts.adr) {
+        due = due || parts.adr->getSpreadingFactor() != rtc->spreadingFactor ||
+              parts.adr->getPlanEpoch() != rtc->adrEpoch;
+    }
+    if (due) {
+        capture(now, clockUs);
+    }
+}
+
+const char* WarmStart::getSourceName(WarmSource source) {
+    switch (source) {
+        case WARM_COLD: return "Cold";
+        case WARM_FROM_FLASH: return "Flash";
+        case WARM_FROM_RTC: return "Warm";
+        default: return "Unknown";
+    }
+}
@@ -0,0 +1,444 @@
+// Adaptive data rate tests: PHY helpers, power control, coordinated SF
+// changes, rejoining after a missed switch, and a simulated swarm comparing
+// ADR with the fixed SF7 / 20 dBm settings
+// Run with: pio test -e native -f test_adr
+
+#include <unity.h>
+#include <algorithm>
+#include <memory>
+#include <math.h>
+#include "../../include/communications/lora_interface.h"
+#include "../../include/simulation/radio_sim.h"
+#include "../../include/utilities/crypto_utils.h"
+
+void setUp() {}
+void tearDown() {}
+
+static LinkStateData linkState(int8_t powerDbm, uint8_t requiredSf = 7, uint8_t hops = 0) {
+    LinkStateData state;
+    memset(&state, 0, sizeof(state));
+    state.txPowerDbm = powerDbm;
+    state.requiredSf = requiredSf;
+    state.requiredHops = hops;
+    state.planSf = 7;
+    return state;
+}
+
+void test_phy_helpers() {
+    TEST_ASSERT_EQUAL_FLOAT(-7.5f, loraSnrFloorDb(7));
+    TEST_ASSERT_EQUAL_FLOAT(-12.5f, loraSnrFloorDb(9));
+    TEST_ASSERT_EQUAL_FLOAT(-20.0f, loraSnrFloorDb(12));
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, -117.0f, loraNoiseFloorDbm(loraDefaultPhy()));
+
+    TEST_ASSERT_EQUAL_FLOAT(120.0f, loraTxCurrentMa(20));
+    TEST_ASSERT_EQUAL_FLOAT(87.0f, loraTxCurrentMa(17));
+    for (int8_t dbm = ADR_MIN_TX_POWER_DBM; dbm < ADR_MAX_TX_POWER_DBM; dbm++) {
+        TEST_ASSERT_TRUE(loraTxCurrentMa(dbm) < loraTxCurrentMa(dbm + 1));
+    }
+
+    // Each SF step roughly doubles the airtime
+    LoRaPhyConfig phy = loraDefaultPhy();
+    uint32_t sf7 = loraAirtimeUs(phy, sizeof(SecureFrame));
+    phy.spreadingFactor = 9;
+    uint32_t sf9 = loraAirtimeUs(phy, sizeof(SecureFrame));
+    TEST_ASSERT_TRUE(sf9 > 3 * sf7 && sf9 < 4 * sf7);
+}
+
+void test_power_follows_weakest_neighbour() {
+    AdrController adr(1);
+    uint32_t now = 0;
+    TEST_ASSERT_EQUAL(ADR_MAX_TX_POWER_DBM, adr.getTxPowerDbm());
+
+    // SNR 5 dB from a 20 dBm sender: SF7 needs floor + margin - (5 - 20) dBm,
+    // reached in steps of at most ADR_POWER_STEP_DB
+    int8_t expected = (int8_t)ceilf(loraSnrFloorDb(7) + ADR_MARGIN_DB - (5.0f - 20));
+    for (int i = 0; i < 12; i++, now += HEARTBEAT_INTERVAL_MS) {
+        int8_t before = adr.getTxPowerDbm();
+        adr.onLinkState(2, linkState(20), -112, 5.0f, now);
+        adr.update(now);
+        TEST_ASSERT_TRUE(adr.getTxPowerDbm() >= before - ADR_POWER_STEP_DB);
+    }
+    TEST_ASSERT_EQUAL(expected, adr.getTxPowerDbm());
+    TEST_ASSERT_EQUAL(7, adr.getSpreadingFactor());
+
+    // A saturated SNR reading falls back to RSSI: -80 dBm is 37 dB over noise
+    for (int i = 0; i < 8; i++, now += HEARTBEAT_INTERVAL_MS) {
+        adr.onLinkState(2, linkState(20), -80, 10.0f, now);
+        adr.onLinkState(3, linkState(10), -90, 9.0f, now);
+        adr.update(now);
+    }
+    TEST_ASSERT_TRUE(adr.getTxPowerDbm() < expected);
+    TEST_ASSERT_EQUAL(2, adr.neighbourCount(now));
+
+    // A new neighbour is not measured yet: full power until it is
+    adr.onLinkState(4, linkState(20), -100, 8.0f, now);
+    adr.update(now);
+    TEST_ASSERT_EQUAL(ADR_MAX_TX_POWER_DBM, adr.getTxPowerDbm());
+    for (int i = 0; i < 8; i++, now += HEARTBEAT_INTERVAL_MS) {
+        adr.onLinkState(2, linkState(20), -80, 10.0f, now);
+        adr.onLinkState(3, linkState(10), -90, 9.0f, now);
+        adr.onLinkState(4, linkState(20), -100, 8.0f, now);
+        adr.update(now);
+    }
+    int8_t settled = adr.getTxPowerDbm();
+    TEST_ASSERT_TRUE(settled < ADR_MAX_TX_POWER_DBM);
+
+    // Neighbour 4 goes quiet, maybe because of our cut: back to full power
+    now += HEARTBEAT_TIMEOUT_MS;
+    adr.onLinkState(2, linkState(20), -80, 10.0f, now);
+    adr.onLinkState(3, linkState(10), -90, 9.0f, now);
+    adr.update(now);
+    TEST_ASSERT_EQUAL(ADR_MAX_TX_POWER_DBM, adr.getTxPowerDbm());
+
+    // Forgotten after ADR_NEIGHBOUR_FORGET_MS; the others set the power again
+    for (uint32_t end = now + ADR_NEIGHBOUR_FORGET_MS + 10000; now < end; now += HEARTBEAT_INTERVAL_MS) {
+        adr.onLinkState(2, linkState(20), -80, 10.0f, now);
+        adr.onLinkState(3, linkState(10), -90, 9.0f, now);
+        adr.update(now);
+    }
+    TEST_ASSERT_EQUAL(2, adr.neighbourCount(now));
+    TEST_ASSERT_TRUE(adr.getTxPowerDbm() < settled);
+}
+
+void test_sf_change_is_coordinated() {
+    AdrController a(1), b(2), c(3);
+    uint32_t now = 0;
+
+    // a's link to 9 is at -9 dB on full power: SF9 is the first with the margin to spare
+    for (int i = 0; i < ADR_MIN_SAMPLES; i++, now += HEARTBEAT_INTERVAL_MS) {
+        a.onLinkState(9, linkState(20), -126, -9.0f, now);
+        a.update(now);
+    }
+    TEST_ASSERT_EQUAL(9, a.getRequiredSf());
+    TEST_ASSERT_TRUE(a.isPlanPending());
+    TEST_ASSERT_EQUAL(9, a.getPlannedSf());
+    TEST_ASSERT_EQUAL(7, a.getSpreadingFactor());
+    TEST_ASSERT_EQUAL(1, a.getStats().plansProposed);
+
+    // b learns the plan from a's link state; the switch time travels with it
+    LinkStateData fromA;
+    a.fillLinkState(fromA, now);
+    TEST_ASSERT_EQUAL(1, fromA.planEpoch);
+    TEST_ASSERT_EQUAL(9, fromA.planSf);
+    TEST_ASSERT_TRUE(fromA.planInMs > 0 && fromA.planInMs <= ADR_SWITCH_LEAD_MS);
+    b.onLinkState(1, fromA, -90, 9.0f, now + 100);
+    TEST_ASSERT_TRUE(b.isPlanPending());
+    TEST_ASSERT_EQUAL(1, b.getStats().plansAdopted);
+
+    // c proposed SF8 for the same epoch concurrently: the slower SF wins
+    for (int i = 0; i < ADR_MIN_SAMPLES; i++) {
+        c.onLinkState(8, linkState(20), -123, -6.0f, i * HEARTBEAT_INTERVAL_MS);
+        c.update(i * HEARTBEAT_INTERVAL_MS);
+    }
+    TEST_ASSERT_EQUAL(8, c.getPlannedSf());
+    c.onLinkState(1, fromA, -90, 9.0f, now + 100);
+    TEST_ASSERT_EQUAL(9, c.getPlannedSf());
+
+    // Everyone switches together, within one frame's travel of each other
+    uint32_t due = now + fromA.planInMs;
+    a.update(due - 1);
+    b.update(due - 1);
+    TEST_ASSERT_EQUAL(7, a.getSpreadingFactor());
+    TEST_ASSERT_EQUAL(7, b.getSpreadingFactor());
+    TEST_ASSERT_TRUE(a.update(due));
+    b.update(due + 100);
+    c.update(due + 100);
+    TEST_ASSERT_EQUAL(9, a.getSpreadingFactor());
+    TEST_ASSERT_EQUAL(9, b.getSpreadingFactor());
+    TEST_ASSERT_EQUAL(9, c.getSpreadingFactor());
+    TEST_ASSERT_FALSE(b.isPlanPending());
+
+    // An applied plan is not re-adopted
+    LinkStateData after;
+    a.fillLinkState(after, due + 200);
+    TEST_ASSERT_EQUAL(0, after.planInMs);
+    b.onLinkState(1, after, -90, 9.0f, due + 200);
+    TEST_ASSERT_FALSE(b.isPlanPending());
+}
+
+void test_requirement_relay_and_step_down() {
+    AdrController adr(1);
+    uint32_t now = 0;
+
+    // Strong link of our own, but a neighbour relays a far link needing SF9
+    for (int i = 0; i < 4; i++, now += HEARTBEAT_INTERVAL_MS) {
+        adr.onLinkState(2, linkState(20, 9, 3), -70, 10.0f, now);
+        adr.update(now);
+    }
+    TEST_ASSERT_EQUAL(9, adr.getRequiredSf());
+    LinkStateData out;
+    adr.fillLinkState(out, now);
+    TEST_ASSERT_EQUAL(4, out.requiredHops);
+    uint32_t due = now + ADR_SWITCH_LEAD_MS;
+    for (; now <= due; now += HEARTBEAT_INTERVAL_MS) {
+        adr.onLinkState(2, linkState(20, 9, 3), -70, 10.0f, now);
+        adr.update(now);
+    }
+    TEST_ASSERT_EQUAL(9, adr.getSpreadingFactor());
+
+    // A relay that has already come the maximum distance is ignored
+    uint32_t stepAt = 0;
+    for (uint32_t end = now + 3 * ADR_SETTLE_MS; now < end; now += HEARTBEAT_INTERVAL_MS) {
+        adr.onLinkState(2, linkState(20, 9, ADR_REQUIREMENT_HOPS), -70, 10.0f, now);
+        adr.update(now);
+        if (!stepAt && adr.getPlannedSf() == 8) stepAt = now;
+    }
+    // One step at a time, each after ADR_SETTLE_MS on the previous SF
+    TEST_ASSERT_TRUE(stepAt >= due + ADR_SETTLE_MS);
+    TEST_ASSERT_EQUAL(7, adr.getRequiredSf());
+    TEST_ASSERT_TRUE(adr.getSpreadingFactor() <= 8);
+    TEST_ASSERT_EQUAL(2, adr.getStats().plansProposed - (adr.getSpreadingFactor() == 7 ? 1 : 0));
+}
+
+void test_missed_switch_scans_back() {
+    AdrController adr(1);
+    adr.onLinkState(2, linkState(10), -90, 9.0f, 0);
+    adr.update(1000);
+    TEST_ASSERT_FALSE(adr.isScanning());
+
+    // The swarm moved to SF9 while we were deaf; silence starts a scan
+    adr.update(ADR_SILENCE_MS);
+    TEST_ASSERT_TRUE(adr.isScanning());
+    TEST_ASSERT_EQUAL(8, adr.getSpreadingFactor());
+    TEST_ASSERT_EQUAL(ADR_MAX_TX_POWER_DBM, adr.getTxPowerDbm());
+    adr.update(ADR_SILENCE_MS + ADR_SCAN_DWELL_MS - 1);
+    TEST_ASSERT_EQUAL(8, adr.getSpreadingFactor());
+    adr.update(ADR_SILENCE_MS + ADR_SCAN_DWELL_MS);
+    TEST_ASSERT_EQUAL(9, adr.getSpreadingFactor());
+
+    // Heard the swarm: stay here
+    uint32_t now = ADR_SILENCE_MS + ADR_SCAN_DWELL_MS + 500;
+    LinkStateData state = linkState(10, 9);
+    state.planEpoch = 3;
+    state.planSf = 9;
+    adr.onLinkState(2, state, -90, 9.0f, now);
+    TEST_ASSERT_FALSE(adr.isScanning());
+    adr.update(now + 3 * ADR_SCAN_DWELL_MS);
+    TEST_ASSERT_EQUAL(9, adr.getSpreadingFactor());
+    TEST_ASSERT_FALSE(adr.isPlanPending());
+    TEST_ASSERT_EQUAL(1, adr.getStats().scans);
+}
+
+// ---------------------------------------------------------------------------
+// Swarm simulation: log-distance path loss at 433 MHz with per-pair
+// shadowing and per-frame fading. Every drone sends a heartbeat frame every
+// HEARTBEAT_INTERVAL_MS with carrier sense; with ADR the link state rides in
+// the same frame (frames are always a full SecureFrame, so it costs no
+// airtime). Goodput counts heartbeat payload bytes delivered to neighbours;
+// energy is the radio's transmit energy only, receive current is the same
+// either way.
+
+#define SIM_DRONES 5
+#define SIM_UPDATE_US 100000ULL         // Main loop period for ADR
+#define SIM_MOVE_US 1000000ULL
+
+static const SimLinkBudget kBudget = {32.0f, 3.0f, 4.0f, 2.0f};
+
+struct AdrScenario {
+    const char* name;
+    float startAreaM;
+    float endAreaM;                     // Spread linearly over spreadSeconds
+    uint32_t spreadSeconds;
+    uint32_t seconds;
+};
+
+struct AdrResult {
+    double goodputBps;
+    double energyUjPerByte;
+    double meanPowerDbm;                // Per heartbeat sent
+    double sfShare[3];                  // Node time on SF7/8/9
+    double splitShare;                  // Time with the swarm on mixed SFs
+    uint32_t collisions;
+};
+
+class AdrSimulation {
+private:
+    RadioSim sim;
+    const AdrScenario& scenario;
+    bool adaptive;
+    std::vector<std::unique_ptr<AdrController>> adr;
+    std::vector<float> baseX, baseY;
+    uint64_t deliveredBytes;
+    uint32_t heartbeatsSent;
+    double powerSum;
+    uint64_t sfTimeUs[3];
+    uint64_t splitUs;
+    uint64_t lastSampleUs;
+
+    uint32_t nowMs() { return (uint32_t)(sim.now() / 1000); }
+
+    void heartbeat(uint8_t node) {
+        if (sim.isTransmitting(node) || sim.channelBusy(node)) {
+            std::uniform_int_distribution<uint32_t> backoff(5000, 60000);
+            sim.after(backoff(sim.rng()), [this, node]() { heartbeat(node); });
+            return;
+        }
+        SecureFrame frame;
+        memset(&frame, 0, sizeof(frame));
+        frame.msg.messageType = MSG_HEARTBEAT;
+        frame.msg.sourceId = node;
+        frame.msg.dataLength = sizeof(HeartbeatData);
+        if (adaptive) {
+            LinkStateData state;
+            adr[node]->fillLinkState(state, nowMs());
+            memcpy(frame.msg.data + sizeof(HeartbeatData), &state, sizeof(state));
+        }
+        sim.transmit(node, &frame, sizeof(frame));
+        heartbeatsSent++;
+        powerSum += sim.getTxPower(node);
+
+        std::uniform_int_distribution<uint32_t> jitter(0, 200000);
+        sim.after(HEARTBEAT_INTERVAL_MS * 1000ULL + jitter(sim.rng()), [this, node]() { heartbeat(node); });
+    }
+
+    void loopPass(uint8_t node) {
+        adr[node]->update(nowMs());
+        // As applyLinkSettings(): never retune under a frame on air
+        if (!sim.isTransmitting(node)) {
+            sim.setSpreadingFactor(node, adr[node]->getSpreadingFactor());
+        }
+        sim.setTxPower(node, adr[node]->getTxPowerDbm());
+        sim.after(SIM_UPDATE_US, [this, node]() { loopPass(node); });
+    }
+
+    void move() {
+        sample();
+        double t = sim.now() / 1e6 / scenario.spreadSeconds;
+        float area = scenario.startAreaM + (float)(t < 1 ? t : 1) * (scenario.endAreaM - scenario.startAreaM);
+        float scale = area / scenario.startAreaM;
+        float centre = scenario.startAreaM / 2;
+        for (uint8_t i = 0; i < SIM_DRONES; i++) {
+            sim.setPosition(i, centre + (baseX[i] - centre) * scale, centre + (baseY[i] - centre) * scale);
+        }
+        sim.after(SIM_MOVE_US, [this]() { move(); });
+    }
+
+    void sample() {
+        uint64_t elapsed = sim.now() - lastSampleUs;
+        lastSampleUs = sim.now();
+        bool mixed = false;
+        for (uint8_t i = 0; i < SIM_DRONES; i++) {
+            sfTimeUs[std::min(2, sim.getSpreadingFactor(i) - 7)] += elapsed;
+            mixed = mixed || sim.getSpreadingFactor(i) != sim.getSpreadingFactor(0);
+        }
+        if (mixed) splitUs += elapsed;
+    }
+
+public:
+    AdrSimulation(const AdrScenario& scenario, bool adaptive, uint32_t seed)
+        : sim(SIM_DRONES, seed), scenario(scenario), adaptive(adaptive), baseX(SIM_DRONES), baseY(SIM_DRONES),
+          deliveredBytes(0), heartbeatsSent(0), powerSum(0), splitUs(0), lastSampleUs(0) {
+        memset(sfTimeUs, 0, sizeof(sfTimeUs));
+        sim.setLinkBudget(kBudget);
+        // Same seed, same draws: both modes start from the same connected layout
+        std::uniform_real_distribution<float> coordinate(0.0f, scenario.startAreaM);
+        do {
+            for (uint8_t i = 0; i < SIM_DRONES; i++) {
+                baseX[i] = coordinate(sim.rng());
+                baseY[i] = coordinate(sim.rng());
+                sim.setPosition(i, baseX[i], baseY[i]);
+            }
+        } while (!sim.isConnected());
+        for (uint8_t i = 0; i < SIM_DRONES; i++) {
+            adr.emplace_back(new AdrController(i));
+        }
+
+        sim.onReceive([this](uint8_t node, const SimFrame& frame) {
+            const SecureFrame* secure = (const SecureFrame*)frame.payload.data();
+            deliveredBytes += sizeof(HeartbeatData);
+            if (this->adaptive) {
+                LinkStateData state;
+                memcpy(&state, secure->msg.data + sizeof(HeartbeatData), sizeof(state));
+                adr[node]->onLinkState(secure->msg.sourceId, state, frame.rssi, frame.snr, nowMs());
+            }
+        });
+
+        std::uniform_int_distribution<uint32_t> phase(0, HEARTBEAT_INTERVAL_MS * 1000);
+        for (uint8_t i = 0; i < SIM_DRONES; i++) {
+            sim.at(phase(sim.rng()), [this, i]() { heartbeat(i); });
+            if (adaptive) {
+                sim.at(phase(sim.rng()) % SIM_UPDATE_US, [this, i]() { loopPass(i); });
+            }
+        }
+        sim.at(0, [this]() { move(); });
+    }
+
+    AdrResult run() {
+        sim.run(scenario.seconds * 1000000ULL);
+        sample();
+        AdrResult r;
+        double energyMj = 0;
+        for (uint8_t i = 0; i < SIM_DRONES; i++) {
+            energyMj += sim.getTxEnergyMj(i);
+        }
+        r.goodputBps = deliveredBytes / (double)scenario.seconds;
+        r.energyUjPerByte = deliveredBytes ? energyMj * 1000.0 / deliveredBytes : 0;
+        r.meanPowerDbm = heartbeatsSent ? powerSum / heartbeatsSent : 0;
+        uint64_t total = sfTimeUs[0] + sfTimeUs[1] + sfTimeUs[2];
+        for (int i = 0; i < 3; i++) {
+            r.sfShare[i] = total ? sfTimeUs[i] / (double)total : 0;
+        }
+        r.splitShare = splitUs / (scenario.seconds * 1e6);
+        r.collisions = sim.getStats().collisions;
+        return r;
+    }
+};
+
+static void printResult(const char* scenario, const char* mode, const AdrResult& r) {
+    printf("[SIM]   %-9s  %-5s  %7.1f  %7.2f  %6.1f  %3.0f/%3.0f/%3.0f%%  %5.1f%%  %10u\n", scenario, mode, r.goodputBps,
+           r.energyUjPerByte, r.meanPowerDbm, r.sfShare[0] * 100, r.sfShare[1] * 100, r.sfShare[2] * 100,
+           r.splitShare * 100, (unsigned)r.collisions);
+}
+
+void test_simulated_adr_vs_fixed_sf7() {
+    static const AdrScenario scenarios[] = {
+        {"compact", MISSION_AREA_SIZE_M, MISSION_AREA_SIZE_M, 1, 600},
+        {"spreading", MISSION_AREA_SIZE_M, 6.0f * MISSION_AREA_SIZE_M, 600, 900},
+    };
+    printf("[SIM] ADR vs fixed SF7/20 dBm, %d drones, heartbeat every %d ms, path loss %.0f dB + %.0f dB/decade, "
+           "%.0f dB shadowing, %.0f dB fading:\n",
+           SIM_DRONES, HEARTBEAT_INTERVAL_MS, kBudget.referenceLossDb, kBudget.pathLossExponent * 10,
+           kBudget.shadowingDb, kBudget.fadingDb);
+    printf("[SIM]   scenario   mode   goodput  uJ/byte  mean dBm  SF7/8/9  mixed SF  collisions\n");
+    for (const AdrScenario& scenario : scenarios) {
+        double fixedGoodput = 0, adrGoodput = 0, fixedEnergy = 0, adrEnergy = 0, split = 0;
+        const int seeds = 3;
+        for (int seed = 0; seed < seeds; seed++) {
+            AdrResult fixed = AdrSimulation(scenario, false, 40 + seed).run();
+            AdrResult adaptive = AdrSimulation(scenario, true, 40 + seed).run();
+            printResult(scenario.name, "SF7", fixed);
+            printResult(scenario.name, "ADR", adaptive);
+            fixedGoodput += fixed.goodputBps;
+            adrGoodput += adaptive.goodputBps;
+            fixedEnergy += fixed.energyUjPerByte;
+            adrEnergy += adaptive.energyUjPerByte;
+            split = std::max(split, adaptive.splitShare);
+        }
+        printf("[SIM]   %-9s  mean: goodput %.2fx, energy per byte %.2fx of fixed SF7\n", scenario.name,
+               adrGoodput / fixedGoodput, adrEnergy / fixedEnergy);
+
+        // Coordinated switches: the swarm is almost never split across SFs
+        TEST_ASSERT_TRUE(split < 0.05);
+        // A slower SF only where it buys enough links to pay for its airtime
+        TEST_ASSERT_TRUE(adrEnergy <= fixedEnergy);
+        if (scenario.startAreaM == scenario.endAreaM) {
+            // Nothing to gain in rate, a lot in power
+            TEST_ASSERT_TRUE(adrGoodput >= 0.95 * fixedGoodput);
+            TEST_ASSERT_TRUE(adrEnergy < 0.6 * fixedEnergy);
+        } else {
+            // The links SF7 loses as the swarm spreads out are kept where it pays
+            TEST_ASSERT_TRUE(adrGoodput >= fixedGoodput);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_phy_helpers);
+    RUN_TEST(test_power_follows_weakest_neighbour);
+    RUN_TEST(test_sf_change_is_coordinated);
+    RUN_TEST(test_requirement_relay_and_step_down);
+    RUN_TEST(test_missed_switch_scans_back);
+    RUN_TEST(test_simulated_adr_vs_fixed_sf7);
+    return UNITY_END();
+}
@@ -0,0 +1,322 @@
+// Message batching tests: packing and splitting, limits, malformed batches,
+// and a simulated swarm comparing one-frame-per-message with batching
+// Run with: pio test -e native -f test_batching
+
+#include <unity.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <deque>
+#include "../../include/communications/message_sender.h"
+#include "../../include/communications/message_parser.h"
+#include "../../include/communications/emergency_stop.h"
+#include "../../include/simulation/radio_sim.h"
+#include "../../include/utilities/crypto_utils.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void fill(uint8_t* bytes, uint8_t length, uint8_t seed) {
+    for (uint8_t i = 0; i < length; i++) {
+        bytes[i] = (uint8_t)(seed + i * 7);
+    }
+}
+
+void test_packs_same_destination_and_splits() {
+    MessageSender sender(4);
+    uint8_t heartbeat[sizeof(HeartbeatData)], gossip[8], ack[4];
+    fill(heartbeat, sizeof(heartbeat), 1);
+    fill(gossip, sizeof(gossip), 50);
+    fill(ack, sizeof(ack), 90);
+
+    TEST_ASSERT_TRUE(sender.queue(0xFF, MSG_HEARTBEAT, heartbeat, sizeof(heartbeat), 1000));
+    TEST_ASSERT_TRUE(sender.queue(0xFF, MSG_GOSSIP, gossip, sizeof(gossip), 1020));
+    TEST_ASSERT_EQUAL(2, sender.pending());
+
+    DroneMessage out[BATCH_SLOTS];
+    TEST_ASSERT_EQUAL(0, sender.poll(1099, out, BATCH_SLOTS));
+    TEST_ASSERT_EQUAL(1, sender.nextDueIn(1099));
+    TEST_ASSERT_EQUAL(1, sender.poll(1100, out, BATCH_SLOTS));
+    TEST_ASSERT_EQUAL(MSG_BATCH, out[0].messageType);
+    TEST_ASSERT_EQUAL(4, out[0].sourceId);
+    TEST_ASSERT_EQUAL(0xFF, out[0].destinationId);
+    TEST_ASSERT_EQUAL(1000, out[0].timestamp);
+    TEST_ASSERT_EQUAL(2 * BATCH_RECORD_HEADER + sizeof(heartbeat) + sizeof(gossip), out[0].dataLength);
+
+    out[0].sequenceNumber = 77;
+    DroneMessage split[4];
+    TEST_ASSERT_EQUAL(2, splitBatch(out[0], split, 4));
+    TEST_ASSERT_EQUAL(MSG_HEARTBEAT, split[0].messageType);
+    TEST_ASSERT_EQUAL(sizeof(heartbeat), split[0].dataLength);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(heartbeat, split[0].data, sizeof(heartbeat));
+    TEST_ASSERT_EQUAL(MSG_GOSSIP, split[1].messageType);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(gossip, split[1].data, sizeof(gossip));
+    TEST_ASSERT_EQUAL(4, split[1].sourceId);
+    TEST_ASSERT_EQUAL(77, split[1].sequenceNumber);
+    TEST_ASSERT_EQUAL(droneMessageChecksum(split[1]), split[1].checksum);
+
+    // Zero-copy walk finds the heartbeat the way the receive ISR does
+    const uint8_t* payload;
+    uint8_t length;
+    TEST_ASSERT_TRUE(batchFindRecord(out[0], MSG_HEARTBEAT, payload, length));
+    TEST_ASSERT_EQUAL(sizeof(heartbeat), length);
+    TEST_ASSERT_EQUAL_HEX8(heartbeat[0], payload[0]);
+    TEST_ASSERT_FALSE(batchFindRecord(out[0], MSG_TARGET_FOUND, payload, length));
+
+    // Full batch closes early; a lone message goes out as itself
+    TEST_ASSERT_TRUE(sender.queue(0xFF, MSG_HEARTBEAT, heartbeat, sizeof(heartbeat), 2000));
+    TEST_ASSERT_TRUE(sender.queue(0xFF, MSG_GOSSIP, gossip, sizeof(gossip), 2000));
+    TEST_ASSERT_TRUE(sender.queue(0xFF, MSG_RAFT_VOTE_RESPONSE, ack, sizeof(ack), 2010));
+    TEST_ASSERT_TRUE(sender.queue(7, MSG_MUTEX_RESPONSE, ack, 3, 2010));
+    TEST_ASSERT_EQUAL(1, sender.poll(2010, out, BATCH_SLOTS));
+    TEST_ASSERT_EQUAL(MSG_BATCH, out[0].messageType);
+    TEST_ASSERT_EQUAL(2, sender.poll(2110, out, BATCH_SLOTS));
+    TEST_ASSERT_EQUAL(MSG_RAFT_VOTE_RESPONSE, out[0].messageType);
+    TEST_ASSERT_EQUAL(0xFF, out[0].destinationId);
+    TEST_ASSERT_EQUAL(MSG_MUTEX_RESPONSE, out[1].messageType);
+    TEST_ASSERT_EQUAL(7, out[1].destinationId);
+    TEST_ASSERT_EQUAL(3, out[1].dataLength);
+    TEST_ASSERT_EQUAL(1, splitBatch(out[1], split, 4));
+    TEST_ASSERT_EQUAL(MSG_MUTEX_RESPONSE, split[0].messageType);
+
+    BatchStats stats = sender.getStats();
+    TEST_ASSERT_EQUAL(6, stats.queued);
+    TEST_ASSERT_EQUAL(4, stats.frames);
+    TEST_ASSERT_EQUAL(2, stats.batchFrames);
+    TEST_ASSERT_EQUAL(100, stats.maxDelayMs);
+    // (100 + 80) + (10 + 10) + 100 + 100
+    TEST_ASSERT_EQUAL(400, stats.totalDelayMs);
+    TEST_ASSERT_EQUAL(UINT32_MAX, sender.nextDueIn(3000));
+}
+
+void test_rejects_what_cannot_be_batched() {
+    MessageSender sender(1);
+    uint8_t payload[32] = {0};
+    TEST_ASSERT_FALSE(sender.queue(0xFF, MSG_EMERGENCY_STOP, payload, sizeof(EmergencyStopData), 0));
+    TEST_ASSERT_FALSE(sender.queue(0xFF, MSG_STATUS_RESPONSE, payload, 31, 0));
+    TEST_ASSERT_TRUE(sender.queue(0xFF, MSG_STATUS_RESPONSE, payload, 30, 0));
+
+    // Every slot busy with another destination
+    for (uint8_t d = 1; d < BATCH_SLOTS; d++) {
+        TEST_ASSERT_TRUE(sender.queue(d, MSG_MUTEX_RESPONSE, payload, 3, 0));
+    }
+    TEST_ASSERT_FALSE(sender.queue(BATCH_SLOTS, MSG_MUTEX_RESPONSE, payload, 3, 0));
+    TEST_ASSERT_EQUAL(3, sender.getStats().rejected);
+
+    DroneMessage out[BATCH_SLOTS];
+    TEST_ASSERT_EQUAL(0, sender.nextDueIn(5));      // Full batch is already due
+    TEST_ASSERT_EQUAL(BATCH_SLOTS, sender.flush(5, out, BATCH_SLOTS));
+    TEST_ASSERT_EQUAL(0, sender.pending());
+}
+
+void test_parser_stops_at_malformed_record() {
+    DroneMessage frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.messageType = MSG_BATCH;
+    uint8_t records[] = {MSG_GOSSIP, 2, 0xAA, 0xBB, MSG_MUTEX_REQUEST, 9, 1, 2};
+    memcpy(frame.data, records, sizeof(records));
+    frame.dataLength = sizeof(records);
+
+    DroneMessage out[4];
+    TEST_ASSERT_EQUAL(1, splitBatch(frame, out, 4));     // Second record overruns
+    TEST_ASSERT_EQUAL(2, out[0].dataLength);
+
+    frame.data[4] = MSG_EMERGENCY_STOP;
+    frame.data[5] = 2;
+    TEST_ASSERT_EQUAL(1, splitBatch(frame, out, 4));     // Stops are never batched
+    frame.data[4] = MSG_BATCH;
+    TEST_ASSERT_EQUAL(1, splitBatch(frame, out, 4));     // No nesting
+    frame.data[4] = MSG_MUTEX_REQUEST;
+    TEST_ASSERT_EQUAL(2, splitBatch(frame, out, 4));
+
+    frame.dataLength = 5;                                // Header cut in half
+    BatchReader reader(frame);
+    TEST_ASSERT_TRUE(reader.next(out[0]));
+    TEST_ASSERT_FALSE(reader.next(out[1]));
+    TEST_ASSERT_TRUE(reader.malformed());
+
+    frame.dataLength = 40;
+    TEST_ASSERT_EQUAL(0, splitBatch(frame, out, 4));
+}
+
+// ---------------------------------------------------------------------------
+// Swarm simulation: one LoRa cell, each drone generating heartbeats, gossip
+// digests, Raft acks to the leader and mutex replies. Frames go out with
+// plain carrier sense; with batching the loop only polls the sender while
+// its radio is idle. Every logical payload starts with a 32-bit id so the
+// receivers can match it to when it was queued.
+
+#define SIM_SECONDS 120
+#define SIM_LOOP_US 10000ULL            // Main loop period
+
+struct TrafficClass {
+    uint8_t type;
+    uint8_t length;
+    float perSecond;
+    bool toLeader;                      // Unicast to drone 0, else broadcast
+};
+
+static const TrafficClass traffic[] = {
+    {MSG_HEARTBEAT, sizeof(HeartbeatData), 0.5f, false},
+    {MSG_GOSSIP, 10, 0.5f, false},
+    {MSG_RAFT_VOTE_RESPONSE, 4, 0.5f, true},
+    {MSG_MUTEX_RESPONSE, 4, 0.2f, false},
+};
+
+struct BatchingResult {
+    double logicalPerSecond;
+    double framesPerSecond;
+    double deliveryRatio;
+    double meanLatencyMs;               // Queued -> received
+    uint32_t maxHoldMs;                 // Queued -> frame built
+};
+
+class BatchingSimulation {
+private:
+    RadioSim sim;
+    bool batching;
+    std::vector<std::unique_ptr<MessageSender>> senders;
+    std::vector<std::deque<DroneMessage>> txQueues;
+    std::map<uint32_t, uint64_t> queuedAt;
+    uint32_t nextId;
+    uint32_t expected;
+    uint32_t delivered;
+    double latencySumMs;
+
+    void tryTransmit(uint8_t node) {
+        if (txQueues[node].empty() || sim.isTransmitting(node)) return;
+        if (sim.channelBusy(node)) {
+            std::uniform_int_distribution<uint32_t> backoff(1000, 50000);
+            sim.after(backoff(sim.rng()), [this, node]() { tryTransmit(node); });
+            return;
+        }
+        SecureFrame frame;
+        memset(&frame, 0, sizeof(frame));
+        frame.msg = txQueues[node].front();
+        txQueues[node].pop_front();
+        sim.transmit(node, &frame, sizeof(frame));
+    }
+
+    void generate(uint8_t node, uint8_t cls) {
+        const TrafficClass& t = traffic[cls];
+        uint8_t destination = t.toLeader ? 0 : 0xFF;
+        if (!(t.toLeader && node == 0)) {
+            uint8_t payload[32];
+            memset(payload, 0, sizeof(payload));
+            uint32_t id = nextId++;
+            memcpy(payload, &id, sizeof(id));
+            queuedAt[id] = sim.now();
+            expected += destination == 0xFF ? sim.getNodeCount() - 1 : 1;
+
+            uint32_t nowMs = (uint32_t)(sim.now() / 1000);
+            if (!batching || !senders[node]->queue(destination, t.type, payload, t.length, nowMs)) {
+                DroneMessage msg;
+                memset(&msg, 0, sizeof(msg));
+                msg.messageType = t.type;
+                msg.sourceId = node;
+                msg.destinationId = destination;
+                msg.timestamp = nowMs;
+                msg.dataLength = t.length;
+                memcpy(msg.data, payload, t.length);
+                txQueues[node].push_back(msg);
+                tryTransmit(node);
+            }
+        }
+        std::exponential_distribution<double> gap(t.perSecond);
+        sim.after((uint64_t)(gap(sim.rng()) * 1e6) + 1, [this, node, cls]() { generate(node, cls); });
+    }
+
+    void loopPass(uint8_t node) {
+        if (!sim.isTransmitting(node) && txQueues[node].empty()) {
+            DroneMessage frames[BATCH_SLOTS];
+            uint8_t count = senders[node]->poll((uint32_t)(sim.now() / 1000), frames, BATCH_SLOTS);
+            txQueues[node].insert(txQueues[node].end(), frames, frames + count);
+            tryTransmit(node);
+        }
+        sim.after(SIM_LOOP_US, [this, node]() { loopPass(node); });
+    }
+
+public:
+    // budgetMs 0: every logical message is its own frame
+    BatchingSimulation(uint8_t count, uint32_t budgetMs, uint32_t seed)
+        : sim(count, seed), batching(budgetMs > 0), txQueues(count), nextId(1), expected(0), delivered(0),
+          latencySumMs(0) {
+        sim.setRange(1000.0f);
+        for (uint8_t i = 0; i < count; i++) {
+            sim.setPosition(i, (float)(i * 10), 0.0f);
+            senders.emplace_back(new MessageSender(i, budgetMs));
+        }
+        sim.onReceive([this](uint8_t node, const SimFrame& frame) {
+            const SecureFrame* secure = (const SecureFrame*)frame.payload.data();
+            DroneMessage split[16];
+            uint8_t count = splitBatch(secure->msg, split, 16);
+            for (uint8_t i = 0; i < count; i++) {
+                if (split[i].destinationId != 0xFF && split[i].destinationId != node) continue;
+                uint32_t id;
+                memcpy(&id, split[i].data, sizeof(id));
+                delivered++;
+                latencySumMs += (sim.now() - queuedAt[id]) / 1000.0;
+            }
+        });
+        sim.onTxDone([this](uint8_t node, const SimFrame&) { tryTransmit(node); });
+
+        std::uniform_int_distribution<uint32_t> phase(0, 1000000);
+        for (uint8_t i = 0; i < count; i++) {
+            for (uint8_t c = 0; c < sizeof(traffic) / sizeof(traffic[0]); c++) {
+                sim.at(phase(sim.rng()), [this, i, c]() { generate(i, c); });
+            }
+            if (batching) {
+                sim.at(phase(sim.rng()) % SIM_LOOP_US, [this, i]() { loopPass(i); });
+            }
+        }
+    }
+
+    BatchingResult run() {
+        sim.run(SIM_SECONDS * 1000000ULL);
+        BatchingResult r;
+        r.logicalPerSecond = (nextId - 1) / (double)SIM_SECONDS;
+        r.framesPerSecond = sim.getStats().framesSent / (double)SIM_SECONDS;
+        r.deliveryRatio = expected ? delivered / (double)expected : 0;
+        r.meanLatencyMs = delivered ? latencySumMs / delivered : 0;
+        r.maxHoldMs = 0;
+        for (auto& s : senders) {
+            r.maxHoldMs = std::max(r.maxHoldMs, s->getStats().maxDelayMs);
+        }
+        return r;
+    }
+};
+
+void test_simulated_frames_saved() {
+    uint32_t airtimeMs = loraAirtimeUs(loraDefaultPhy(), sizeof(SecureFrame)) / 1000;
+    printf("[SIM] batching, one cell, %u ms frames, %d s per run (8 drones saturate the channel unbatched):\n",
+           (unsigned)airtimeMs, SIM_SECONDS);
+    printf("[SIM]   drones  msgs/s  budget ms  frames/s  msgs/frame  saved  delivery  latency ms  max hold ms\n");
+    for (uint8_t count : {3, 5, 8}) {
+        BatchingResult single = BatchingSimulation(count, 0, 100 + count).run();
+        printf("[SIM]   %6u  %6.1f          -  %8.2f        1.00      -  %7.1f%%  %10.0f            -\n", count,
+               single.logicalPerSecond, single.framesPerSecond, single.deliveryRatio * 100, single.meanLatencyMs);
+        double previousFrames = single.framesPerSecond;
+        for (uint32_t budget : {(uint32_t)BATCH_MAX_DELAY_MS, 250u, 500u}) {
+            BatchingResult batched = BatchingSimulation(count, budget, 100 + count).run();
+            double saved = 1.0 - batched.framesPerSecond / single.framesPerSecond;
+            printf("[SIM]   %6u  %6.1f  %9u  %8.2f  %10.2f  %4.0f%%  %7.1f%%  %10.0f  %11u\n", count,
+                   batched.logicalPerSecond, (unsigned)budget, batched.framesPerSecond,
+                   batched.logicalPerSecond / batched.framesPerSecond, saved * 100, batched.deliveryRatio * 100,
+                   batched.meanLatencyMs, (unsigned)batched.maxHoldMs);
+
+            // Fewer frames for every budget, more so as it grows
+            TEST_ASSERT_TRUE(batched.framesPerSecond < previousFrames);
+            TEST_ASSERT_TRUE(batched.deliveryRatio >= single.deliveryRatio - 0.01);
+            previousFrames = batched.framesPerSecond;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_packs_same_destination_and_splits);
+    RUN_TEST(test_rejects_what_cannot_be_batched);
+    RUN_TEST(test_parser_stops_at_malformed_record);
+    RUN_TEST(test_simulated_frames_saved);
+    return UNITY_END();
+}
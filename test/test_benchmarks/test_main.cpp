@@ -0,0 +1,453 @@
+// Benchmark suite: frame build and validation, TimeoutManager, dispatch,
+// and the per-message cost of each protocol service, as JSON compared
+// against baseline_native.json. Runs on the host and on the board.
+// Run with: pio test -e native -f test_benchmarks
+//      or:  pio test -e performance_test (JSON on the serial port)
+// BENCH_UPDATE_BASELINE=1 rewrites the baseline from this run (host only).
+
+#include <unity.h>
+#include <DroneProtocols.h>
+#include "../../include/utilities/benchmark.h"
+#include "../../include/utilities/crypto_utils.h"
+#include "../../include/utilities/time_utils.h"
+#include "../../include/utilities/flight_recorder.h"
+#include "../../include/communications/peer_table.h"
+#include "../../include/communications/message_sender.h"
+#include "../../include/communications/reliable_link.h"
+#include "../../include/target_detection/target_validation.h"
+
+#ifndef ARDUINO
+#include <stdlib.h>
+#include <string>
+#endif
+
+// Only gross slowdowns fail the run: the baseline comes from one machine
+#define BENCH_FAIL_RATIO 2.0f
+
+static const uint8_t networkKey[CRYPTO_KEY_BYTES] = SWARM_NETWORK_KEY;
+
+void setUp() {}
+void tearDown() {}
+
+static DroneMessage makeFrame(uint8_t type, uint8_t source, const void* payload, uint8_t length) {
+    DroneMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.messageType = type;
+    msg.sourceId = source;
+    msg.destinationId = 0xFF;
+    msg.dataLength = length;
+    memcpy(msg.data, payload, length);
+    msg.checksum = droneMessageChecksum(msg);
+    return msg;
+}
+
+static HeartbeatData heartbeatOf(uint8_t drone) {
+    HeartbeatData heartbeat = {drone, 87.5f, 52.52f + drone * 1e-4f, 13.40f, 0, 1};
+    return heartbeat;
+}
+
+// --- Frames, as DroneComm builds and checks them ---
+
+// broadcastMessage(): header, zeroed payload, copy, checksum
+static void benchFrameBuild(uint32_t iterations, void* context) {
+    HeartbeatData heartbeat = heartbeatOf(2);
+    for (uint32_t i = 0; i < iterations; i++) {
+        DroneMessage msg;
+        msg.messageType = MSG_HEARTBEAT;
+        msg.sourceId = 2;
+        msg.destinationId = 0xFF;
+        msg.timestamp = i;
+        msg.dataLength = sizeof(heartbeat);
+        memset(msg.data, 0, sizeof(msg.data));
+        memcpy(msg.data, &heartbeat, sizeof(heartbeat));
+        msg.sequenceNumber = (uint16_t)i;
+        msg.checksum = droneMessageChecksum(msg);
+        benchKeep(msg);
+    }
+}
+
+static void benchFrameValidate(uint32_t iterations, void* context) {
+    DroneMessage* frames = (DroneMessage*)context;
+    uint32_t valid = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        const DroneMessage& msg = frames[i & 15];
+        valid += droneMessageChecksum(msg) == msg.checksum;
+    }
+    benchKeep(valid);
+}
+
+static void benchFrameSeal(uint32_t iterations, void* context) {
+    SecureLink* link = (SecureLink*)context;
+    DroneMessage msg = makeFrame(MSG_HEARTBEAT, 1, "0123456789abcdef0123", 20);
+    SecureFrame frame;
+    for (uint32_t i = 0; i < iterations; i++) {
+        msg.timestamp = i;
+        link->seal(msg, frame);
+        benchKeep(frame);
+    }
+}
+
+// Seal on one node, open and check on another: open = this minus frame.seal
+struct LinkPair {
+    SecureLink* sender;
+    SecureLink* receiver;
+    uint32_t now;
+};
+
+static void benchFrameRoundTrip(uint32_t iterations, void* context) {
+    LinkPair* pair = (LinkPair*)context;
+    DroneMessage msg = makeFrame(MSG_HEARTBEAT, 1, "0123456789abcdef0123", 20);
+    SecureFrame frame;
+    DroneMessage out;
+    uint32_t accepted = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        pair->sender->seal(msg, frame);
+        accepted += pair->receiver->open(frame, out, pair->now) == CRYPTO_OK &&
+                    droneMessageChecksum(out) == out.checksum;
+    }
+    TEST_ASSERT_EQUAL(iterations, accepted);
+}
+
+// --- TimeoutManager ---
+
+static void benchTimeoutAddRemove(uint32_t iterations, void* context) {
+    TimeoutManager* timeouts = (TimeoutManager*)context;
+    for (uint32_t i = 0; i < iterations; i++) {
+        int id = timeouts->addTimeout(60000, "bench");
+        timeouts->removeTimeout(id);
+    }
+}
+
+// A full pool of running timers, none due
+static void benchTimeoutCheck(uint32_t iterations, void* context) {
+    TimeoutManager* timeouts = (TimeoutManager*)context;
+    int ids[TIMEOUT_POOL_SIZE];
+    uint32_t expired = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        expired += timeouts->checkAllTimeouts(ids, TIMEOUT_POOL_SIZE);
+    }
+    TEST_ASSERT_EQUAL(0, expired);
+}
+
+// --- Dispatch ---
+
+struct DispatchBench {
+    MessageRegistry registry;
+    DroneMessage frames[16];
+    uint32_t handled;
+};
+
+static void onBenchHeartbeat(const DroneMessage& msg, PayloadView<HeartbeatData> heartbeat, void* context) {
+    ((DispatchBench*)context)->handled += heartbeat.get(&HeartbeatData::droneId);
+}
+
+static void onBenchTarget(const DroneMessage& msg, PayloadView<TargetReportData> report, void* context) {
+    ((DispatchBench*)context)->handled += report.get(&TargetReportData::confidence);
+}
+
+static void benchDispatch(uint32_t iterations, void* context) {
+    DispatchBench* bench = (DispatchBench*)context;
+    for (uint32_t i = 0; i < iterations; i++) {
+        bench->registry.dispatch(bench->frames[i & 15]);
+    }
+    benchKeep(bench->handled);
+}
+
+// --- Per-message cost of each protocol service ---
+
+static void benchPeerHeartbeat(uint32_t iterations, void* context) {
+    PeerTable* peers = (PeerTable*)context;
+    for (uint32_t i = 0; i < iterations; i++) {
+        HeartbeatData heartbeat = heartbeatOf((uint8_t)(1 + (i & 7)));
+        benchKeep(peers->update(heartbeat, -90, 6.0f, i));
+    }
+}
+
+// Every copy after the first of a stop takes this path
+static void benchEmergencyDuplicate(uint32_t iterations, void* context) {
+    EmergencyStopHandler* handler = (EmergencyStopHandler*)context;
+    EmergencyStopData data = {1, 7, 0, ESTOP_REASON_OPERATOR};
+    DroneMessage msg = makeFrame(MSG_EMERGENCY_STOP, 1, &data, sizeof(data));
+    for (uint32_t i = 0; i < iterations; i++) {
+        benchKeep(handler->onFrame((uint8_t*)&msg, sizeof(msg), 100));
+    }
+}
+
+// One acknowledged message: send, frame, deliver, ack frame, ack handled
+static void benchReliableMessage(uint32_t iterations, void* context) {
+    ReliableLink* links = (ReliableLink*)context;
+    ReliableLink& a = links[0];
+    ReliableLink& b = links[1];
+    DroneMessage frames[4];
+    DroneMessage delivered;
+    uint8_t payload[20] = {0};
+    uint32_t now = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        now += 10;
+        a.send(2, MSG_MISSION_UPDATE, payload, sizeof(payload), now);
+        uint8_t sent = a.poll(now, frames, 4);
+        for (uint8_t f = 0; f < sent; f++) {
+            b.onFrame(frames[f], now + 5, delivered);
+        }
+        uint8_t acks = b.poll(now + 5 + RELIABLE_ACK_DELAY_MS, frames, 4);
+        for (uint8_t f = 0; f < acks; f++) {
+            a.onFrame(frames[f], now + 10 + RELIABLE_ACK_DELAY_MS, delivered);
+        }
+    }
+    TEST_ASSERT_EQUAL(0, a.pending());
+}
+
+// Three small messages per frame, as a heartbeat tick queues them
+static void benchBatchMessage(uint32_t iterations, void* context) {
+    MessageSender* sender = (MessageSender*)context;
+    DroneMessage frames[BATCH_SLOTS];
+    uint8_t payload[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    for (uint32_t i = 0; i < iterations; i++) {
+        sender->queue(0xFF, MSG_GOSSIP, payload, sizeof(payload), i);
+        if (i % 3 == 2) {
+            benchKeep(sender->poll(i + BATCH_MAX_DELAY_MS, frames, BATCH_SLOTS));
+        }
+    }
+    sender->poll(iterations + BATCH_MAX_DELAY_MS, frames, BATCH_SLOTS);
+}
+
+// Per frame of a 12 + 4 group; decoding loses 4 of the data frames
+struct FecBench {
+    MessageSender sender;
+    FecDecoder decoder;
+    DroneMessage frames[16];
+    uint8_t update[12 * FEC_SYMBOL_BYTES];
+    uint32_t groupTime;         // Keeps every decoded group new
+    FecBench() : sender(1), groupTime(0) {}
+};
+
+static void benchFecEncode(uint32_t iterations, void* context) {
+    FecBench* bench = (FecBench*)context;
+    for (uint32_t i = 0; i < iterations; i += 16) {
+        bench->update[0] = (uint8_t)i;
+        uint8_t frames = bench->sender.encodeFec(0xFF, MSG_MISSION_UPDATE, bench->update, sizeof(bench->update), 4, i,
+                                                 bench->frames, 16);
+        TEST_ASSERT_EQUAL(16, frames);
+        benchKeep(bench->frames);
+    }
+}
+
+static void benchFecDecode(uint32_t iterations, void* context) {
+    FecBench* bench = (FecBench*)context;
+    FecMessage out;
+    uint32_t complete = 0;
+    for (uint32_t i = 0; i < iterations; i += 16) {
+        bench->groupTime++;
+        for (uint8_t f = 0; f < 16; f++) {
+            bench->frames[f].timestamp = bench->groupTime;
+            if (f % 3 == 1 && f < 12) continue;
+            complete += bench->decoder.add(bench->frames[f], bench->groupTime, out) == FEC_COMPLETE;
+        }
+    }
+    TEST_ASSERT_EQUAL((iterations + 15) / 16, complete);
+}
+
+static void benchFusionReport(uint32_t iterations, void* context) {
+    TargetTrackStore* store = (TargetTrackStore*)context;
+    for (uint32_t i = 0; i < iterations; i++) {
+        TargetReportData report = {(uint8_t)(1 + (i & 3)), (uint16_t)(i & 31), 52.52f + (i & 31) * 2e-3f,
+                                   13.40f, 200, 180, 1};
+        benchKeep(store->ingest(report, -85, 5.0f, 1000));
+    }
+}
+
+static void benchAdrLinkState(uint32_t iterations, void* context) {
+    AdrController* adr = (AdrController*)context;
+    LinkStateData state = {14, 7, 0, 0, 7, 0, 0};
+    for (uint32_t i = 0; i < iterations; i++) {
+        adr->onLinkState((uint8_t)(2 + (i & 7)), state, -95, 4.0f, i);
+    }
+}
+
+// request() to MAC_TRANSMIT on a clear channel
+static void benchMacFrame(uint32_t iterations, void* context) {
+    ChannelAccess* mac = (ChannelAccess*)context;
+    uint32_t now = 0;
+    uint32_t sent = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        mac->request(now);
+        for (;;) {
+            MacAction action = mac->poll(now);
+            if (action == MAC_SENSE) {
+                action = mac->onChannelSensed(false, now);
+            }
+            if (action == MAC_TRANSMIT) {
+                mac->onTransmitted(2000, now);
+                sent++;
+                break;
+            }
+            if (action == MAC_IDLE) {
+                break;
+            }
+            now += mac->nextActionIn(now);
+        }
+        now += 1000;
+    }
+    TEST_ASSERT_EQUAL(iterations, sent);
+}
+
+static void benchRecorderFrame(uint32_t iterations, void* context) {
+    FlightRecorder* recorder = (FlightRecorder*)context;
+    HeartbeatData heartbeat = heartbeatOf(3);
+    DroneMessage msg = makeFrame(MSG_HEARTBEAT, 3, &heartbeat, sizeof(heartbeat));
+    for (uint32_t i = 0; i < iterations; i++) {
+        recorder->recordFrame(false, msg, -88, 6.5f, i);
+        if ((i & 15) == 15) {
+            recorder->service(i);
+        }
+    }
+}
+
+#ifndef ARDUINO
+static std::string baselinePath() {
+    std::string path = __FILE__;
+    return path.substr(0, path.find_last_of('/') + 1) + "baseline_native.json";
+}
+
+static std::string readFile(const std::string& path) {
+    std::string text;
+    FILE* in = fopen(path.c_str(), "r");
+    if (!in) {
+        return text;
+    }
+    char chunk[1024];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+        text.append(chunk, got);
+    }
+    fclose(in);
+    return text;
+}
+#endif
+
+void run_benchmarks() {
+    static SecureLink sealer(1, networkKey);
+    static SecureLink pairSender(2, networkKey);
+    static SecureLink pairReceiver(3, networkKey);
+    static LinkPair pair = {&pairSender, &pairReceiver, 0};
+    static DroneMessage validateFrames[16];
+    static TimeoutManager churn;
+    static TimeoutManager running;
+    static DispatchBench dispatch;
+    static PeerTable peers;
+    static MissionStateMachine mission;
+    static EmergencyStopHandler emergency(3, &mission);
+    static ReliableLink reliable[2] = {ReliableLink(1), ReliableLink(2)};
+    static MessageSender batcher(1);
+    static FecBench fec;
+    static TargetTrackStore fusion;
+    static AdrController adr(1);
+    static ChannelAccess mac(1);
+    static FlightRecorder recorder;
+#ifdef ARDUINO
+    static PartitionFlash recorderFlash;
+    bool haveFlash = recorderFlash.begin() && recorder.begin(&recorderFlash, 1, 0, 0);
+#else
+    static RamFlash recorderFlash(64 * FLIGHT_SECTOR_BYTES);
+    bool haveFlash = recorder.begin(&recorderFlash, 1, 0, 0);
+#endif
+
+    for (uint8_t i = 0; i < 16; i++) {
+        HeartbeatData heartbeat = heartbeatOf(i);
+        validateFrames[i] = makeFrame(MSG_HEARTBEAT, i, &heartbeat, sizeof(heartbeat));
+    }
+    for (uint8_t i = 0; i < TIMEOUT_POOL_SIZE; i++) {
+        running.addTimeout(3600000, "running");
+    }
+
+    // Traffic mix: mostly heartbeats, some target reports, one unhandled type
+    dispatch.handled = 0;
+    dispatch.registry.on<MSG_HEARTBEAT, onBenchHeartbeat>(&dispatch);
+    dispatch.registry.on<MSG_TARGET_FOUND, onBenchTarget>(&dispatch);
+    for (uint8_t i = 0; i < 16; i++) {
+        HeartbeatData heartbeat = heartbeatOf(i);
+        TargetReportData report = {i, i, 52.5f, 13.4f, 200, 180, 1};
+        uint8_t raw[4] = {1, 2, 3, 4};
+        dispatch.frames[i] = i % 8 == 7 ? makeFrame(MSG_GOSSIP, i, raw, sizeof(raw))
+                           : i % 4 == 3 ? makeFrame(MSG_TARGET_FOUND, i, &report, sizeof(report))
+                                        : makeFrame(MSG_HEARTBEAT, i, &heartbeat, sizeof(heartbeat));
+    }
+
+    EmergencyStopData stop = {1, 7, 0, ESTOP_REASON_OPERATOR};
+    DroneMessage stopMsg = makeFrame(MSG_EMERGENCY_STOP, 1, &stop, sizeof(stop));
+    emergency.onFrame((uint8_t*)&stopMsg, sizeof(stopMsg), 100);
+    fusion.setOrigin(52.52f, 13.40f);
+    for (uint16_t i = 0; i < sizeof(fec.update); i++) {
+        fec.update[i] = (uint8_t)(i * 31);
+    }
+
+    BenchSuite suite;
+    suite.add("frame.build", benchFrameBuild);
+    suite.add("frame.validate", benchFrameValidate, validateFrames);
+    suite.add("frame.seal", benchFrameSeal, &sealer);
+    suite.add("frame.seal_open", benchFrameRoundTrip, &pair);
+    suite.add("timeout.add_remove", benchTimeoutAddRemove, &churn);
+    suite.add("timeout.check_full", benchTimeoutCheck, &running);
+    suite.add("dispatch.registry", benchDispatch, &dispatch);
+    suite.add("service.peer_heartbeat", benchPeerHeartbeat, &peers);
+    suite.add("service.estop_duplicate", benchEmergencyDuplicate, &emergency);
+    suite.add("service.reliable_message", benchReliableMessage, reliable);
+    suite.add("service.batch_message", benchBatchMessage, &batcher);
+    suite.add("service.fec_encode_frame", benchFecEncode, &fec);
+    suite.add("service.fec_decode_frame", benchFecDecode, &fec);
+    suite.add("service.fusion_report", benchFusionReport, &fusion);
+    suite.add("service.adr_link_state", benchAdrLinkState, &adr);
+    suite.add("service.mac_frame", benchMacFrame, &mac);
+    if (haveFlash) {
+        suite.add("service.recorder_frame", benchRecorderFrame, &recorder);
+    }
+    TEST_ASSERT_TRUE(suite.run() >= 16);
+
+#ifdef ARDUINO
+    printf("BENCH_JSON_BEGIN\n");
+    suite.writeJson(stdout, "esp32");
+    printf("BENCH_JSON_END\n");
+#else
+    std::string baseline = readFile(baselinePath());
+    uint8_t regressions = baseline.empty() ? 0 : suite.compare(baseline.c_str());
+    suite.writeJson(stdout, "native");
+    printf("[BENCH] %u cases, %u slower than baseline by more than %.0f%%\n", suite.size(), regressions,
+           BENCH_REGRESSION_TOLERANCE * 100);
+
+    const char* update = getenv("BENCH_UPDATE_BASELINE");
+    if (update && update[0] == '1') {
+        FILE* out = fopen(baselinePath().c_str(), "w");
+        TEST_ASSERT_NOT_NULL(out);
+        suite.compare("");          // The baseline holds plain results
+        suite.writeJson(out, "native");
+        fclose(out);
+        printf("[BENCH] Baseline written to %s\n", baselinePath().c_str());
+        return;
+    }
+    for (uint8_t i = 0; i < suite.size(); i++) {
+        const BenchResult& result = suite.at(i);
+        if (result.baselineNs > 0 && result.medianNs > result.baselineNs * BENCH_FAIL_RATIO) {
+            printf("[BENCH] %s: %.1f ns against %.1f ns in the baseline\n", result.name, result.medianNs,
+                   result.baselineNs);
+            TEST_FAIL_MESSAGE("Benchmark regressed past BENCH_FAIL_RATIO");
+        }
+    }
+#endif
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000);            // Let the serial monitor attach
+    UNITY_BEGIN();
+    RUN_TEST(run_benchmarks);
+    UNITY_END();
+}
+
+void loop() {}
+#else
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(run_benchmarks);
+    return UNITY_END();
+}
+#endif
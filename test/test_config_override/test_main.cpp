@@ -0,0 +1,187 @@
+// Generated config tables and the field override blob: the compile-time
+// aliases, the blob round trip, every way a blob is refused, console hex
+// and the ADR power ceiling an override sets
+// Run with: pio test -e native -f test_config_override
+
+#include <unity.h>
+#include "../../include/utilities/config_override.h"
+#include "../../include/communications/lora_interface.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Usable wherever a constant is: array bounds, static_assert, templates
+static_assert(LORA_SPREADING_FACTOR >= ADR_MIN_SF && LORA_SPREADING_FACTOR <= ADR_MAX_SF,
+              "Starting SF outside the ADR range");
+static_assert(HEARTBEAT_TIMEOUT_MS >= 2 * HEARTBEAT_INTERVAL_MS, "Timeout shorter than two heartbeats");
+static_assert(SWARM_CONFIG_DRONES <= SWARM_CONFIG.maxDrones, "More drones than MAX_DRONES");
+static uint8_t perDrone[MAX_DRONES];
+
+void test_generated_tables() {
+    // No DRONE_ID in the native env: the lowest id
+    TEST_ASSERT_EQUAL(DRONE_CONFIGS[0].id, DRONE_CONFIG.id);
+    TEST_ASSERT_EQUAL(1, DEFAULT_NODE_ID);
+    TEST_ASSERT_EQUAL_STRING("drone_1", DRONE_CONFIG.name);
+    TEST_ASSERT_EQUAL(MAX_DRONES, sizeof(perDrone));
+    for (uint8_t i = 1; i < SWARM_CONFIG_DRONES; i++) {
+        TEST_ASSERT_TRUE(DRONE_CONFIGS[i].id > DRONE_CONFIGS[i - 1].id);
+    }
+
+    // Only the power may differ per drone; the rest keeps the swarm on one channel
+    for (uint8_t i = 0; i < SWARM_CONFIG_DRONES; i++) {
+        const RadioConfig& radio = DRONE_CONFIGS[i].radio;
+        TEST_ASSERT_EQUAL(SWARM_CONFIG.radio.frequencyHz, radio.frequencyHz);
+        TEST_ASSERT_EQUAL(SWARM_CONFIG.radio.bandwidthHz, radio.bandwidthHz);
+        TEST_ASSERT_EQUAL(SWARM_CONFIG.radio.spreadingFactor, radio.spreadingFactor);
+        TEST_ASSERT_EQUAL(SWARM_CONFIG.radio.syncWord, radio.syncWord);
+    }
+    TEST_ASSERT_EQUAL(433000000, LORA_FREQUENCY);
+    TEST_ASSERT_EQUAL(125000, LORA_BANDWIDTH);
+    TEST_ASSERT_EQUAL(0x12, LORA_SYNC_WORD);
+    TEST_ASSERT_EQUAL(5, LORA_SS);
+    TEST_ASSERT_EQUAL(16, GPS_RX_PIN);
+
+    // The PHY the airtime and noise models use
+    LoRaPhyConfig phy = loraDefaultPhy();
+    TEST_ASSERT_EQUAL(LORA_SPREADING_FACTOR, phy.spreadingFactor);
+    TEST_ASSERT_EQUAL(LORA_BANDWIDTH, phy.bandwidthHz);
+    TEST_ASSERT_EQUAL(LORA_PREAMBLE_LENGTH, phy.preambleLength);
+}
+
+void test_round_trip() {
+    const ConfigFieldValue values[] = {
+        {CONFIG_FIELD_MAX_TX_POWER_DBM, 14},
+        {CONFIG_FIELD_HEARTBEAT_INTERVAL_MS, 3000},
+    };
+    uint8_t blob[CONFIG_OVERRIDE_MAX_BYTES];
+    size_t length = encodeConfigOverride(3, SWARM_CONFIG_HASH, values, 2, blob, sizeof(blob));
+    TEST_ASSERT_EQUAL(CONFIG_OVERRIDE_HEADER_BYTES + 2 + 3 + 2, length);
+
+    TunableConfig config = tunableDefaults();
+    TEST_ASSERT_EQUAL(LORA_TX_POWER, config.maxTxPowerDbm);
+    TEST_ASSERT_EQUAL(HEARTBEAT_INTERVAL_MS, config.heartbeatIntervalMs);
+    TEST_ASSERT_EQUAL(CONFIG_OVERRIDE_OK, applyConfigOverride(blob, length, 3, config));
+    TEST_ASSERT_EQUAL(14, config.maxTxPowerDbm);
+    TEST_ASSERT_EQUAL(3000, config.heartbeatIntervalMs);
+
+    // Fields not in the blob keep what the caller had
+    config = tunableDefaults();
+    config.heartbeatIntervalMs = 7000;
+    length = encodeConfigOverride(0, SWARM_CONFIG_HASH, values, 1, blob, sizeof(blob));
+    TEST_ASSERT_EQUAL(CONFIG_OVERRIDE_OK, applyConfigOverride(blob, length, 5, config));
+    TEST_ASSERT_EQUAL(14, config.maxTxPowerDbm);
+    TEST_ASSERT_EQUAL(7000, config.heartbeatIntervalMs);
+
+    // An empty override is valid and changes nothing
+    length = encodeConfigOverride(0, SWARM_CONFIG_HASH, values, 0, blob, sizeof(blob));
+    TEST_ASSERT_EQUAL(CONFIG_OVERRIDE_HEADER_BYTES + 2, length);
+    TEST_ASSERT_EQUAL(CONFIG_OVERRIDE_OK, applyConfigOverride(blob, length, 1, config));
+    TEST_ASSERT_EQUAL(7000, config.heartbeatIntervalMs);
+}
+
+void test_refused_blobs_change_nothing() {
+    uint8_t blob[CONFIG_OVERRIDE_MAX_BYTES];
+    TunableConfig config = tunableDefaults();
+    const TunableConfig before = config;
+    const ConfigFieldValue good[] = {{CONFIG_FIELD_HEARTBEAT_INTERVAL_MS, 2500}, {CONFIG_FIELD_MAX_TX_POWER_DBM, 10}};
+
+    // Another drone's, and one made against other JSON
+    size_t length = encodeConfigOverride(2, SWARM_CONFIG_HASH, good, 2, blob, sizeof(blob));
+    TEST_ASSERT_EQUAL(CONFIG_OVERRIDE_OTHER_DRONE, applyConfigOverride(blob, length, 1, config));
+    length = encodeConfigOverride(1, SWARM_CONFIG_HASH ^ 1, good, 2, blob, sizeof(blob));
+    TEST_ASSERT_EQUAL(CONFIG_OVERRIDE_STALE, applyConfigOverride(blob, length, 1, config));
+
+    // Any single corrupted byte, or a short read
+    length = encodeConfigOverride(1, SWARM_CONFIG_HASH, good, 2, blob, sizeof(blob));
+    for (size_t i = 0; i < length; i++) {
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            blob[i] ^= 1 << bit;
+            TEST_ASSERT_EQUAL(CONFIG_OVERRIDE_MALFORMED, applyConfigOverride(blob, length, 1, config));
+            blob[i] ^= 1 << bit;
+        }
+    }
+    for (size_t cut = 0; cut < length; cut++) {
+        TEST_ASSERT_EQUAL(CONFIG_OVERRIDE_MALFORMED, applyConfigOverride(blob, cut, 1, config));
+    }
+
+    // Out of range, or unknown, after a good field: all or nothing
+    const ConfigFieldValue high[] = {{CONFIG_FIELD_HEARTBEAT_INTERVAL_MS, 2500}, {CONFIG_FIELD_MAX_TX_POWER_DBM, 21}};
+    const ConfigFieldValue low[] = {{CONFIG_FIELD_HEARTBEAT_INTERVAL_MS, 2500}, {CONFIG_FIELD_MAX_TX_POWER_DBM, -3}};
+    const ConfigFieldValue unknown[] = {{CONFIG_FIELD_HEARTBEAT_INTERVAL_MS, 2500}, {0x7F, 1}};
+    const ConfigFieldValue* bad[] = {high, low, unknown};
+    for (uint8_t i = 0; i < 3; i++) {
+        length = encodeConfigOverride(1, SWARM_CONFIG_HASH, bad[i], 2, blob, sizeof(blob));
+        TEST_ASSERT_EQUAL(CONFIG_OVERRIDE_BAD_FIELD, applyConfigOverride(blob, length, 1, config));
+    }
+    TEST_ASSERT_EQUAL_MEMORY(&before, &config, sizeof(config));
+
+    // Longer than the NVS slot
+    uint8_t big[2 * CONFIG_OVERRIDE_MAX_BYTES];
+    ConfigFieldValue many[16];
+    for (uint8_t i = 0; i < 16; i++) {
+        many[i].field = CONFIG_FIELD_HEARTBEAT_INTERVAL_MS;
+        many[i].value = 60000;
+    }
+    TEST_ASSERT_EQUAL(0, encodeConfigOverride(1, SWARM_CONFIG_HASH, many, 16, blob, sizeof(blob)));
+    length = encodeConfigOverride(1, SWARM_CONFIG_HASH, many, 16, big, sizeof(big));
+    TEST_ASSERT_TRUE(length > CONFIG_OVERRIDE_MAX_BYTES);
+    TEST_ASSERT_EQUAL(CONFIG_OVERRIDE_MALFORMED, applyConfigOverride(big, length, 1, config));
+}
+
+void test_console_hex() {
+    uint8_t blob[CONFIG_OVERRIDE_MAX_BYTES];
+    const ConfigFieldValue values[] = {{CONFIG_FIELD_MAX_TX_POWER_DBM, 8}};
+    uint8_t expected[CONFIG_OVERRIDE_MAX_BYTES];
+    size_t length = encodeConfigOverride(1, SWARM_CONFIG_HASH, values, 1, expected, sizeof(expected));
+
+    // As config_generator.py prints it, and as a terminal might send it
+    char hex[2 * CONFIG_OVERRIDE_MAX_BYTES + 8];
+    char* cursor = hex;
+    for (size_t i = 0; i < length; i++) {
+        cursor += sprintf(cursor, i % 4 == 3 ? "%02x " : "%02X", expected[i]);
+    }
+    strcpy(cursor, "\r\n");
+    TEST_ASSERT_EQUAL(length, configOverrideFromHex(hex, blob, sizeof(blob)));
+    TEST_ASSERT_EQUAL_MEMORY(expected, blob, length);
+
+    TEST_ASSERT_EQUAL(0, configOverrideFromHex("4346G1", blob, sizeof(blob)));
+    TEST_ASSERT_EQUAL(0, configOverrideFromHex("43460", blob, sizeof(blob)));
+    TEST_ASSERT_EQUAL(0, configOverrideFromHex("434601", blob, 2));
+    TEST_ASSERT_EQUAL(0, configOverrideFromHex("", blob, sizeof(blob)));
+}
+
+void test_power_ceiling() {
+    AdrController adr(1);
+    TEST_ASSERT_EQUAL(ADR_MAX_TX_POWER_DBM, adr.getTxPowerDbm());
+    adr.setMaxTxPower(10, 0);
+    TEST_ASSERT_EQUAL(10, adr.getMaxTxPowerDbm());
+    TEST_ASSERT_EQUAL(10, adr.getTxPowerDbm());
+
+    // Unmeasured neighbours and scans ask for full power: the ceiling holds
+    LinkStateData state;
+    memset(&state, 0, sizeof(state));
+    state.txPowerDbm = 20;
+    state.requiredSf = LORA_SPREADING_FACTOR;
+    adr.onLinkState(2, state, -100, -2.0f, 100);
+    for (uint32_t now = 100; now < 120000; now += 100) {
+        adr.update(now);
+        TEST_ASSERT_TRUE(adr.getTxPowerDbm() <= 10);
+    }
+
+    // Clamped to what the radio can do; raising it lets ADR climb again
+    adr.setMaxTxPower(40, 0);
+    TEST_ASSERT_EQUAL(ADR_MAX_TX_POWER_DBM, adr.getMaxTxPowerDbm());
+    adr.setMaxTxPower(-5, 0);
+    TEST_ASSERT_EQUAL(ADR_MIN_TX_POWER_DBM, adr.getMaxTxPowerDbm());
+    TEST_ASSERT_EQUAL(ADR_MIN_TX_POWER_DBM, adr.getTxPowerDbm());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_generated_tables);
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_refused_blobs_change_nothing);
+    RUN_TEST(test_console_hex);
+    RUN_TEST(test_power_ceiling);
+    return UNITY_END();
+}
@@ -0,0 +1,293 @@
+// Frame authentication tests: AES, CCM and SHA-256 against published
+// vectors, tamper and replay rejection, and the per-frame cost of
+// sealing/opening
+// Run with: pio test -e native -f test_crypto
+
+#include <unity.h>
+#include <chrono>
+#include "../../include/utilities/crypto_utils.h"
+#include "../../include/communications/lora_interface.h"
+
+static const uint8_t networkKey[CRYPTO_KEY_BYTES] = SWARM_NETWORK_KEY;
+
+void setUp() {}
+void tearDown() {}
+
+static uint8_t gfMultiply(uint8_t a, uint8_t b) {
+    uint8_t product = 0;
+    while (b) {
+        if (b & 1) product ^= a;
+        a = (a << 1) ^ ((a & 0x80) ? 0x1B : 0);
+        b >>= 1;
+    }
+    return product;
+}
+
+// FIPS-197 definition: multiplicative inverse, then the affine transform
+static uint8_t referenceSbox(uint8_t x) {
+    uint8_t inverse = 0;
+    for (int c = 1; c < 256 && x; c++) {
+        if (gfMultiply(x, (uint8_t)c) == 1) {
+            inverse = (uint8_t)c;
+            break;
+        }
+    }
+    uint8_t s = inverse;
+    for (int i = 1; i <= 4; i++) {
+        s ^= (uint8_t)((inverse << i) | (inverse >> (8 - i)));
+    }
+    return s ^ 0x63;
+}
+
+static DroneMessage makeMessage(uint8_t type, uint8_t fill) {
+    DroneMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.messageType = type;
+    msg.destinationId = 0xFF;
+    msg.timestamp = 123456;
+    msg.dataLength = 20;
+    for (uint8_t i = 0; i < msg.dataLength; i++) {
+        msg.data[i] = fill + i;
+    }
+    return msg;
+}
+
+void test_sbox_circuit_matches_definition() {
+    uint8_t state[16];
+    for (int base = 0; base < 256; base += 16) {
+        for (int i = 0; i < 16; i++) state[i] = (uint8_t)(base + i);
+        aesSubBytes(state);
+        for (int i = 0; i < 16; i++) {
+            TEST_ASSERT_EQUAL_HEX8(referenceSbox((uint8_t)(base + i)), state[i]);
+        }
+    }
+}
+
+void test_aes_and_ccm_published_vectors() {
+    // FIPS-197 appendix C.1
+    uint8_t key[16], plain[16], out[16];
+    for (int i = 0; i < 16; i++) {
+        key[i] = (uint8_t)i;
+        plain[i] = (uint8_t)(i * 0x11);
+    }
+    const uint8_t expected[16] = {0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30,
+                                  0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A};
+    Aes128 aes;
+    aes.setKey(key);
+    aes.encryptBlock(plain, out);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, out, 16);
+
+    // RFC 3610 packet vector #1: 8-byte tag, 8 bytes AAD, 23 bytes payload
+    for (int i = 0; i < 16; i++) key[i] = (uint8_t)(0xC0 + i);
+    const uint8_t nonce[13] = {0x00, 0x00, 0x00, 0x03, 0x02, 0x01, 0x00, 0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5};
+    uint8_t packet[31];
+    for (int i = 0; i < 31; i++) packet[i] = (uint8_t)i;
+    const uint8_t cipher[23] = {0x58, 0x8C, 0x97, 0x9A, 0x61, 0xC6, 0x63, 0xD2, 0xF0, 0x66, 0xD0, 0xC2,
+                                0xC0, 0xF9, 0x89, 0x80, 0x6D, 0x5F, 0x6B, 0x61, 0xDA, 0xC3, 0x84};
+    const uint8_t tag[8] = {0x17, 0xE8, 0xD1, 0x2C, 0xFD, 0xF9, 0x26, 0xE0};
+    uint8_t sealed[23], sealedTag[8], opened[23];
+    aes.setKey(key);
+    aesCcmSeal(aes, nonce, packet, 8, packet + 8, sealed, 23, sealedTag, 8);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(cipher, sealed, 23);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(tag, sealedTag, 8);
+    TEST_ASSERT_TRUE(aesCcmOpen(aes, nonce, packet, 8, sealed, opened, 23, sealedTag, 8));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(packet + 8, opened, 23);
+}
+
+void test_sha256_published_vectors() {
+    // FIPS 180-4 examples: empty, one block, two blocks, a million 'a's
+    static const char* messages[] = {"", "abc", "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"};
+    static const uint8_t expected[4][CRYPTO_SHA256_BYTES] = {
+        {0xE3, 0xB0, 0xC4, 0x42, 0x98, 0xFC, 0x1C, 0x14, 0x9A, 0xFB, 0xF4, 0xC8, 0x99, 0x6F, 0xB9, 0x24,
+         0x27, 0xAE, 0x41, 0xE4, 0x64, 0x9B, 0x93, 0x4C, 0xA4, 0x95, 0x99, 0x1B, 0x78, 0x52, 0xB8, 0x55},
+        {0xBA, 0x78, 0x16, 0xBF, 0x8F, 0x01, 0xCF, 0xEA, 0x41, 0x41, 0x40, 0xDE, 0x5D, 0xAE, 0x22, 0x23,
+         0xB0, 0x03, 0x61, 0xA3, 0x96, 0x17, 0x7A, 0x9C, 0xB4, 0x10, 0xFF, 0x61, 0xF2, 0x00, 0x15, 0xAD},
+        {0x24, 0x8D, 0x6A, 0x61, 0xD2, 0x06, 0x38, 0xB8, 0xE5, 0xC0, 0x26, 0x93, 0x0C, 0x3E, 0x60, 0x39,
+         0xA3, 0x3C, 0xE4, 0x59, 0x64, 0xFF, 0x21, 0x67, 0xF6, 0xEC, 0xED, 0xD4, 0x19, 0xDB, 0x06, 0xC1},
+        {0xCD, 0xC7, 0x6E, 0x5C, 0x99, 0x14, 0xFB, 0x92, 0x81, 0xA1, 0xC7, 0xE2, 0x84, 0xD7, 0x3E, 0x67,
+         0xF1, 0x80, 0x9A, 0x48, 0xA4, 0x97, 0x20, 0x0E, 0x04, 0x6D, 0x39, 0xCC, 0xC7, 0x11, 0x2C, 0xD0}
+    };
+    uint8_t digest[CRYPTO_SHA256_BYTES];
+    Sha256 sha;
+    for (int i = 0; i < 3; i++) {
+        sha.begin();
+        sha.update(messages[i], strlen(messages[i]));
+        sha.finish(digest);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expected[i], digest, CRYPTO_SHA256_BYTES);
+    }
+
+    // Fed in uneven pieces, as flash reads arrive
+    uint8_t a[1000];
+    memset(a, 'a', sizeof(a));
+    sha.begin();
+    for (size_t total = 0, piece = 1; total < 1000000; piece = piece * 7 % 997 + 1) {
+        size_t take = piece < 1000000 - total ? piece : 1000000 - total;
+        sha.update(a, take);
+        total += take;
+    }
+    sha.finish(digest);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected[3], digest, CRYPTO_SHA256_BYTES);
+}
+
+void test_round_trip_and_tampering() {
+    SecureLink alice(1, networkKey);
+    SecureLink bob(2, networkKey);
+    alice.setEpoch(7);
+
+    DroneMessage msg = makeMessage(MSG_HEARTBEAT, 0x40);
+    SecureFrame frame;
+    alice.seal(msg, frame);
+    TEST_ASSERT_EQUAL(1, frame.msg.sourceId);
+    TEST_ASSERT_EQUAL(7, frame.epoch);
+    TEST_ASSERT_EQUAL(1, frame.msg.sequenceNumber);
+    TEST_ASSERT_TRUE(memcmp(msg.data, frame.msg.data, sizeof(msg.data)) != 0);
+
+    DroneMessage out;
+    TEST_ASSERT_EQUAL(CRYPTO_OK, bob.open(frame, out, 0));
+    TEST_ASSERT_EQUAL_MEMORY(&msg, &out, sizeof(msg));
+    TEST_ASSERT_EQUAL(droneMessageChecksum(out), out.checksum);
+
+    // Flipping any bit anywhere on air must fail authentication
+    uint8_t* raw = (uint8_t*)&frame;
+    for (size_t i = 0; i < sizeof(SecureFrame); i++) {
+        SecureLink receiver(3, networkKey);
+        raw[i] ^= 0x04;
+        TEST_ASSERT_NOT_EQUAL(CRYPTO_OK, receiver.open(frame, out, 0));
+        raw[i] ^= 0x04;
+    }
+
+    // Same frame under another key
+    const uint8_t otherKey[CRYPTO_KEY_BYTES] = {1};
+    SecureLink outsider(3, otherKey);
+    TEST_ASSERT_EQUAL(CRYPTO_BAD_TAG, outsider.open(frame, out, 0));
+
+    // A forged emergency stop has to guess the tag
+    SecureFrame forged = frame;
+    forged.msg.messageType = MSG_EMERGENCY_STOP;
+    forged.msg.sequenceNumber = 900;
+    TEST_ASSERT_EQUAL(CRYPTO_BAD_TAG, bob.open(forged, out, 0));
+    TEST_ASSERT_EQUAL(1, bob.getStats().badTag);
+}
+
+void test_replay_window() {
+    SecureLink sender(4, networkKey);
+    SecureLink receiver(5, networkKey);
+    sender.setEpoch(1);
+
+    SecureFrame frames[40];
+    for (int i = 0; i < 40; i++) {
+        DroneMessage msg = makeMessage(MSG_GOSSIP, (uint8_t)i);
+        sender.seal(msg, frames[i]);
+    }
+
+    DroneMessage out;
+    TEST_ASSERT_EQUAL(CRYPTO_OK, receiver.open(frames[0], out, 0));
+    TEST_ASSERT_EQUAL(CRYPTO_REPLAY, receiver.open(frames[0], out, 0));
+
+    // Out of order inside the window is fine, once
+    TEST_ASSERT_EQUAL(CRYPTO_OK, receiver.open(frames[10], out, 0));
+    TEST_ASSERT_EQUAL(CRYPTO_OK, receiver.open(frames[5], out, 0));
+    TEST_ASSERT_EQUAL(CRYPTO_REPLAY, receiver.open(frames[5], out, 0));
+    TEST_ASSERT_EQUAL(CRYPTO_REPLAY, receiver.open(frames[10], out, 0));
+
+    // Older than the window
+    TEST_ASSERT_EQUAL(CRYPTO_OK, receiver.open(frames[39], out, 0));
+    TEST_ASSERT_EQUAL(CRYPTO_OK, receiver.open(frames[39 - CRYPTO_REPLAY_WINDOW + 1], out, 0));
+    TEST_ASSERT_EQUAL(CRYPTO_REPLAY, receiver.open(frames[39 - CRYPTO_REPLAY_WINDOW], out, 0));
+
+    // A forgery with a future sequence must not advance the window
+    SecureFrame forged = frames[20];
+    forged.msg.sequenceNumber = 60000;
+    TEST_ASSERT_EQUAL(CRYPTO_BAD_TAG, receiver.open(forged, out, 0));
+    DroneMessage next = makeMessage(MSG_GOSSIP, 99);
+    SecureFrame fresh;
+    sender.seal(next, fresh);
+    TEST_ASSERT_EQUAL(CRYPTO_OK, receiver.open(fresh, out, 0));
+
+    // Sender reboots into a new epoch: old frames are stale, new ones pass
+    sender.setEpoch(2);
+    sender.seal(next, fresh);
+    TEST_ASSERT_EQUAL(1, fresh.msg.sequenceNumber);
+    TEST_ASSERT_EQUAL(CRYPTO_OK, receiver.open(fresh, out, 0));
+    TEST_ASSERT_EQUAL(CRYPTO_STALE_EPOCH, receiver.open(frames[30], out, 0));
+
+    // Sequence wrap moves the epoch forward instead of reusing a nonce
+    SecureFrame last;
+    bool advanced = false;
+    for (int i = 1; i < 65536 && !advanced; i++) {
+        advanced = sender.seal(next, last);
+    }
+    TEST_ASSERT_TRUE(advanced);
+    TEST_ASSERT_EQUAL(3, last.epoch);
+    TEST_ASSERT_EQUAL(0, last.msg.sequenceNumber);
+    TEST_ASSERT_EQUAL(CRYPTO_OK, receiver.open(last, out, 0));
+
+    CryptoStats stats = receiver.getStats();
+    TEST_ASSERT_EQUAL(4, stats.replayed);
+    TEST_ASSERT_EQUAL(1, stats.staleEpoch);
+    TEST_ASSERT_EQUAL(1, stats.badTag);
+}
+
+void test_replay_state_eviction() {
+    SecureLink receiver(1, networkKey);
+    DroneMessage out;
+    SecureFrame first;
+    for (int id = 0; id <= CRYPTO_REPLAY_SOURCES; id++) {
+        SecureLink sender(10 + id, networkKey);
+        DroneMessage msg = makeMessage(MSG_HEARTBEAT, (uint8_t)id);
+        SecureFrame frame;
+        sender.seal(msg, frame);
+        if (id == 0) first = frame;
+        TEST_ASSERT_EQUAL(CRYPTO_OK, receiver.open(frame, out, 1000 + id));
+    }
+    // The quietest source lost its state; the newest still has it
+    TEST_ASSERT_EQUAL(1, receiver.getStats().evicted);
+    TEST_ASSERT_EQUAL(CRYPTO_OK, receiver.open(first, out, 2000));
+    TEST_ASSERT_EQUAL(CRYPTO_REPLAY, receiver.open(first, out, 2001));
+}
+
+void test_frame_cost() {
+    SecureLink sender(1, networkKey);
+    SecureLink receiver(2, networkKey);
+    DroneMessage msg = makeMessage(MSG_TARGET_FOUND, 3);
+    DroneMessage out;
+    SecureFrame frame;
+
+    const int iterations = 20000;
+    uint32_t opened = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        sender.seal(msg, frame);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        frame.msg.sequenceNumber = (uint16_t)(i + 1);
+        opened += receiver.open(frame, out, 0) == CRYPTO_BAD_TAG;
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    TEST_ASSERT_EQUAL(iterations - 1, opened);      // Only the last sealed sequence is genuine
+
+    double sealUs = std::chrono::duration<double, std::micro>(t1 - t0).count() / iterations;
+    double openUs = std::chrono::duration<double, std::micro>(t2 - t1).count() / iterations;
+    LoRaPhyConfig phy = loraDefaultPhy();
+    uint32_t plainUs = loraAirtimeUs(phy, sizeof(DroneMessage));
+    uint32_t securedUs = loraAirtimeUs(phy, sizeof(SecureFrame));
+    printf("[BENCH] seal %.2f us/frame, open %.2f us/frame (software AES, 7 blocks)\n", sealUs, openUs);
+    printf("[BENCH] overhead %u bytes/frame (%u B epoch + %u B tag): %lu -> %lu us on air at SF%u\n",
+           (unsigned)CRYPTO_FRAME_OVERHEAD, 2u, (unsigned)CRYPTO_TAG_BYTES, (unsigned long)plainUs,
+           (unsigned long)securedUs, phy.spreadingFactor);
+    TEST_ASSERT_EQUAL(2 + CRYPTO_TAG_BYTES, CRYPTO_FRAME_OVERHEAD);
+    TEST_ASSERT_TRUE(openUs < 100.0);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sbox_circuit_matches_definition);
+    RUN_TEST(test_aes_and_ccm_published_vectors);
+    RUN_TEST(test_sha256_published_vectors);
+    RUN_TEST(test_round_trip_and_tampering);
+    RUN_TEST(test_replay_window);
+    RUN_TEST(test_replay_state_eviction);
+    RUN_TEST(test_frame_cost);
+    return UNITY_END();
+}
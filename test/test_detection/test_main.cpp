@@ -0,0 +1,188 @@
+// Detection kernel tests, golden-output check and host benchmark
+// Run with: pio test -e native -f test_detection
+
+#include <unity.h>
+#include <chrono>
+#include <random>
+#include "../../include/target_detection/detection_interface.h"
+
+static FloatDetectionModel model;
+static QuantizedCnnDetector detector;
+
+static void makeFrame(DetectionFrame& frame, std::mt19937& rng, bool withTarget) {
+    std::uniform_int_distribution<int> noise(0, 70);
+    std::uniform_int_distribution<int> position(2, DETECTION_FRAME_SIZE - 3);
+    for (int i = 0; i < DETECTION_FRAME_PIXELS; i++) {
+        frame.pixels[i] = (uint8_t)noise(rng);
+    }
+    if (withTarget) {
+        int cx = position(rng), cy = position(rng);
+        for (int y = cy - 2; y <= cy + 2; y++)
+            for (int x = cx - 2; x <= cx + 2; x++)
+                frame.pixels[y * DETECTION_FRAME_SIZE + x] = 220;
+    }
+    frame.timestamp = 0;
+    frame.latitude = 28.7041f;
+    frame.longitude = 77.1025f;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_simd_dot_product_matches_scalar() {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> value(-128, 127);
+    int8_t a[415], b[415];
+    for (int i = 0; i < 415; i++) {
+        a[i] = (int8_t)value(rng);
+        b[i] = (int8_t)value(rng);
+    }
+    // Includes odd lengths and unaligned starts
+    for (int length : {0, 1, 15, 16, 17, 144, 400, 414}) {
+        TEST_ASSERT_EQUAL(dotProductS8Scalar(a + 1, b, length), dotProductS8(a + 1, b, length));
+    }
+}
+
+void test_requantize_matches_real_multiplier() {
+    for (double real : {0.0007, 0.013, 0.25, 0.9, 1.7}) {
+        int32_t multiplier, shift;
+        quantizeMultiplier(real, multiplier, shift);
+        for (int32_t acc : {-20000, -301, -1, 0, 1, 77, 1234, 90000}) {
+            double expected = acc * real;
+            expected = expected > 127 ? 127 : (expected < -128 ? -128 : expected);
+            // Same double rounding as TFLite: within one LSB
+            TEST_ASSERT_FLOAT_WITHIN(1.0, expected, requantizeS8(acc, multiplier, shift, false));
+        }
+    }
+    int32_t multiplier, shift;
+    quantizeMultiplier(0.5, multiplier, shift);
+    TEST_ASSERT_EQUAL(0, requantizeS8(-100, multiplier, shift, true));
+}
+
+void test_quantized_model_matches_float_reference() {
+    std::mt19937 rng(99);
+    const int count = 200;
+    int agree = 0;
+    float worst = 0, range = 0;
+
+    for (int i = 0; i < count; i++) {
+        DetectionFrame frame;
+        makeFrame(frame, rng, i % 2);
+        float expected[2], actual[2];
+        model.run(frame, expected);
+        detector.run(frame, actual);
+
+        for (int o = 0; o < 2; o++) {
+            worst = fmaxf(worst, fabsf(expected[o] - actual[o]));
+            range = fmaxf(range, fabsf(expected[o]));
+        }
+        float expectedMargin = expected[1] - expected[0];
+        float actualMargin = actual[1] - actual[0];
+        if ((expectedMargin >= 0) == (actualMargin >= 0) || fabsf(expectedMargin) < 0.05f * range) {
+            agree++;
+        }
+    }
+
+    printf("[GOLDEN] max |logit error| %.4f over logit range %.4f (%.1f%%), decision agreement %d/%d\n",
+           worst, range, 100.0f * worst / range, agree, count);
+    TEST_ASSERT_LESS_THAN(0.15f * range, worst);
+    TEST_ASSERT_GREATER_OR_EQUAL(count * 97 / 100, agree);
+}
+
+void test_queue_batches_and_reports() {
+    DetectionInterface detection;
+    detection.setDetector(&detector);
+    TEST_ASSERT_TRUE(detection.begin());
+
+    std::mt19937 rng(5);
+    for (int i = 0; i < DETECTION_QUEUE_SIZE + 3; i++) {
+        DetectionFrame frame;
+        makeFrame(frame, rng, true);
+        frame.frameId = i;
+        detection.submitFrame(frame);
+    }
+
+    DetectionFrame frames[DETECTION_BATCH_SIZE];
+    DetectionResult results[DETECTION_BATCH_SIZE];
+    uint32_t total = 0;
+    uint8_t n;
+    while ((n = detection.processPending(frames, results, DETECTION_BATCH_SIZE)) > 0) {
+        TEST_ASSERT_LESS_OR_EQUAL(DETECTION_BATCH_SIZE, n);
+        for (uint8_t i = 0; i < n; i++) {
+            TEST_ASSERT_EQUAL(frames[i].frameId, results[i].frameId);
+        }
+        total += n;
+    }
+
+    DetectionStats stats = detection.getStats();
+    TEST_ASSERT_EQUAL(DETECTION_QUEUE_SIZE, total);
+    TEST_ASSERT_EQUAL(3, stats.framesDropped);
+    TEST_ASSERT_EQUAL(2, stats.batches);
+
+    DetectionResult positive = {7, 1, 240, true};
+    TargetReportData report;
+    TEST_ASSERT_TRUE(DetectionInterface::toTargetReport(positive, frames[0], 3, report));
+    TEST_ASSERT_EQUAL(3, report.reporterId);
+    positive.detected = false;
+    TEST_ASSERT_FALSE(DetectionInterface::toTargetReport(positive, frames[0], 3, report));
+}
+
+static double runBatches(int batchSize, int frames, DetectionFrame* pool, DetectionResult* results) {
+    auto start = std::chrono::steady_clock::now();
+    for (int done = 0; done < frames; done += batchSize) {
+        detector.detectBatch(pool + (done % 64), batchSize, results);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void benchmark_inference() {
+    std::mt19937 rng(3);
+    DetectionFrame pool[64 + DETECTION_BATCH_SIZE];
+    DetectionResult results[DETECTION_BATCH_SIZE];
+    for (auto& frame : pool) makeFrame(frame, rng, rng() & 1);
+
+    const int frames = 20000;
+    double single = runBatches(1, frames, pool, results);
+    detector.resetProfile();
+    double batched = runBatches(DETECTION_BATCH_SIZE, frames, pool, results);
+
+    printf("[BENCH] int8 CNN inference (%d frames):\n", frames);
+    printf("[BENCH]    batch 1: %.0f inferences/sec\n", frames / single);
+    printf("[BENCH]    batch %d: %.0f inferences/sec\n", DETECTION_BATCH_SIZE, frames / batched);
+    detector.printProfile();
+
+    // Kernel-level comparison
+    int8_t a[400], b[400];
+    for (int i = 0; i < 400; i++) {
+        a[i] = (int8_t)(rng() & 0xFF);
+        b[i] = (int8_t)(rng() & 0xFF);
+    }
+    volatile int32_t sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < 200000; i++) sink += dotProductS8Scalar(a, b, 400 - (i & 1));
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < 200000; i++) sink += dotProductS8(a, b, 400 - (i & 1));
+    auto t2 = std::chrono::steady_clock::now();
+    double scalarNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / 200000;
+    double simdNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / 200000;
+    printf("[BENCH]    dot400: scalar %.1f ns, vector %.1f ns (%.1fx)\n", scalarNs, simdNs, scalarNs / simdNs);
+
+    TEST_ASSERT_GREATER_THAN(0, frames / batched);
+}
+
+int main(int argc, char** argv) {
+    // Reference model and its quantized twin, calibrated on sample frames
+    std::mt19937 rng(11);
+    static DetectionFrame calibration[64];
+    for (int i = 0; i < 64; i++) makeFrame(calibration[i], rng, i % 2);
+    model.initDefault(0xD20E);
+    detector.quantize(model, calibration, 64);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_simd_dot_product_matches_scalar);
+    RUN_TEST(test_requantize_matches_real_multiplier);
+    RUN_TEST(test_quantized_model_matches_float_reference);
+    RUN_TEST(test_queue_batches_and_reports);
+    RUN_TEST(benchmark_inference);
+    return UNITY_END();
+}
@@ -0,0 +1,445 @@
+// Emergency-stop handler tests and swarm-wide stop latency simulation
+// Run with: pio test -e native -f test_emergency_stop
+
+#include <unity.h>
+#include <algorithm>
+#include <memory>
+#include "../../include/communications/emergency_stop.h"
+#include "../../include/simulation/radio_sim.h"
+#include "../../include/utilities/crypto_utils.h"
+
+static const uint8_t networkKey[CRYPTO_KEY_BYTES] = SWARM_NETWORK_KEY;
+
+void setUp() {}
+void tearDown() {}
+
+static DroneMessage stopFrame(uint8_t sender, uint8_t origin, uint16_t stopId, uint8_t hops) {
+    EmergencyStopData data = {origin, stopId, hops, ESTOP_REASON_OPERATOR};
+    DroneMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.messageType = MSG_EMERGENCY_STOP;
+    msg.sourceId = sender;
+    msg.destinationId = 0xFF;
+    msg.dataLength = sizeof(data);
+    memcpy(msg.data, &data, sizeof(data));
+    msg.checksum = droneMessageChecksum(msg);
+    return msg;
+}
+
+void test_state_machine_latches_stop() {
+    MissionStateMachine mission;
+    TEST_ASSERT_TRUE(mission.transition(MISSION_ACTIVE));
+    TEST_ASSERT_TRUE(mission.emergencyStop(ESTOP_REASON_GEOFENCE, 1234));
+    TEST_ASSERT_FALSE(mission.emergencyStop(ESTOP_REASON_OPERATOR, 2000));
+    TEST_ASSERT_EQUAL(ESTOP_REASON_GEOFENCE, mission.getStopReason());
+    TEST_ASSERT_EQUAL(1234, mission.getStoppedAt());
+
+    // Normal transitions cannot clear a stop
+    TEST_ASSERT_FALSE(mission.transition(MISSION_ACTIVE));
+    TEST_ASSERT_TRUE(mission.isStopped());
+    TEST_ASSERT_TRUE(mission.clearEmergency());
+    TEST_ASSERT_EQUAL(MISSION_IDLE, mission.getState());
+}
+
+void test_first_copy_applies_and_relays_once_per_repeat() {
+    MissionStateMachine mission;
+    EmergencyStopHandler handler(3, &mission);
+    DroneMessage msg = stopFrame(1, 1, 7, 0);
+
+    TEST_ASSERT_EQUAL(ESTOP_APPLIED, handler.onFrame((uint8_t*)&msg, sizeof(msg), 100));
+    TEST_ASSERT_TRUE(mission.isStopped());
+    TEST_ASSERT_EQUAL(ESTOP_DUPLICATE, handler.onFrame((uint8_t*)&msg, sizeof(msg), 101));
+
+    // Relay waits a random slot but never beyond the window
+    uint32_t window = handler.getRelayWindowMs();
+    TEST_ASSERT_LESS_OR_EQUAL(window, handler.nextTransmitIn(100));
+    DroneMessage out;
+    TEST_ASSERT_TRUE(handler.pollTransmit(100 + window, out));
+    EmergencyStopData relayed;
+    memcpy(&relayed, out.data, sizeof(relayed));
+    TEST_ASSERT_EQUAL(3, out.sourceId);
+    TEST_ASSERT_EQUAL(1, relayed.originId);
+    TEST_ASSERT_EQUAL(7, relayed.stopId);
+    TEST_ASSERT_EQUAL(1, relayed.hopCount);
+    TEST_ASSERT_EQUAL(droneMessageChecksum(out), out.checksum);
+    TEST_ASSERT_FALSE(handler.pollTransmit(100 + window, out));
+
+    uint32_t sends = 1;
+    for (uint32_t t = 200; t < 5000; t += 10) {
+        if (handler.pollTransmit(t, out)) sends++;
+    }
+    TEST_ASSERT_EQUAL(EMERGENCY_STOP_REPEATS, sends);
+    TEST_ASSERT_FALSE(handler.hasPending());
+}
+
+void test_busy_neighbourhood_suppresses_repeats() {
+    EmergencyStopHandler handler(4, nullptr);
+    DroneMessage msg = stopFrame(1, 1, 9, 2);
+    handler.onFrame((uint8_t*)&msg, sizeof(msg), 0);
+
+    DroneMessage out;
+    TEST_ASSERT_TRUE(handler.pollTransmit(handler.getRelayWindowMs(), out));
+    for (int i = 0; i < EMERGENCY_SUPPRESS_COUNT; i++) {
+        handler.onFrame((uint8_t*)&msg, sizeof(msg), 100);
+    }
+    uint32_t later = 1000 + EMERGENCY_STOP_REPEAT_MS + handler.getRelayWindowMs();
+    TEST_ASSERT_FALSE(handler.pollTransmit(later, out));
+    TEST_ASSERT_EQUAL(1, handler.getStats().suppressed);
+}
+
+void test_flying_neighbour_heartbeat_reannounces_stop() {
+    MissionStateMachine mission;
+    EmergencyStopHandler handler(5, &mission);
+    DroneMessage out;
+    TEST_ASSERT_FALSE(handler.onPeerHeartbeat(7, MISSION_ACTIVE, 0));
+
+    handler.trigger(ESTOP_REASON_OPERATOR, 0);
+    for (uint32_t t = 0; t < 5000; t += 10) {
+        handler.pollTransmit(t, out);
+    }
+    TEST_ASSERT_FALSE(handler.hasPending());
+
+    // Stopped neighbours need nothing; a flying one gets exactly one more copy
+    TEST_ASSERT_FALSE(handler.onPeerHeartbeat(8, MISSION_EMERGENCY_STOP, 5000));
+    TEST_ASSERT_TRUE(handler.onPeerHeartbeat(7, MISSION_ACTIVE, 5000));
+    TEST_ASSERT_FALSE(handler.onPeerHeartbeat(7, MISSION_ACTIVE, 5001));
+    TEST_ASSERT_TRUE(handler.pollTransmit(5000 + handler.getRelayWindowMs(), out));
+    TEST_ASSERT_FALSE(handler.hasPending());
+    TEST_ASSERT_EQUAL(1, handler.getStats().reannounced);
+}
+
+void test_repeats_continue_until_neighbours_echo() {
+    DroneMessage out;
+    DroneMessage stop = stopFrame(2, 1, 5, 1);
+
+    // Neighbour 3 never echoes: repeats go past the usual count, but stop at the cap
+    EmergencyStopHandler silent(4, nullptr);
+    silent.onPeerHeartbeat(2, MISSION_ACTIVE, 0);
+    silent.onPeerHeartbeat(3, MISSION_ACTIVE, 0);
+    silent.onFrame((uint8_t*)&stop, sizeof(stop), 0);
+    uint32_t sends = 0;
+    for (uint32_t t = 0; t < 5000; t += 10) {
+        if (silent.pollTransmit(t, out)) sends++;
+    }
+    TEST_ASSERT_EQUAL(EMERGENCY_STOP_MAX_REPEATS, sends);
+
+    // Its relay is the echo: back to the usual count
+    EmergencyStopHandler echoed(4, nullptr);
+    echoed.onPeerHeartbeat(2, MISSION_ACTIVE, 0);
+    echoed.onPeerHeartbeat(3, MISSION_ACTIVE, 0);
+    echoed.onFrame((uint8_t*)&stop, sizeof(stop), 0);
+    sends = 0;
+    for (uint32_t t = 0; t < 5000; t += 10) {
+        if (echoed.pollTransmit(t, out)) {
+            sends++;
+            DroneMessage relay = stopFrame(3, 1, 5, 2);
+            echoed.onFrame((uint8_t*)&relay, sizeof(relay), t + 100);
+        }
+    }
+    TEST_ASSERT_EQUAL(EMERGENCY_STOP_REPEATS, sends);
+}
+
+void test_busy_channel_defers_by_bounded_slots() {
+    EmergencyStopHandler handler(6, nullptr);
+    handler.trigger(ESTOP_REASON_OPERATOR, 0);
+    DroneMessage out;
+    uint32_t t = 0;
+    for (int i = 0; i < EMERGENCY_RELAY_SLOTS; i++) {
+        TEST_ASSERT_FALSE(handler.pollTransmit(t, out, true));
+        TEST_ASSERT_TRUE(handler.nextTransmitIn(t) > 0);
+        t += handler.nextTransmitIn(t);
+    }
+    // Held back one slot per deferral, then sent into whatever is on air
+    TEST_ASSERT_TRUE(handler.pollTransmit(t, out, true));
+    uint32_t slot = handler.getRelayWindowMs() / (EMERGENCY_RELAY_SLOTS - 1);
+    TEST_ASSERT_EQUAL(EMERGENCY_RELAY_SLOTS * slot, t);
+    TEST_ASSERT_EQUAL(EMERGENCY_RELAY_SLOTS, handler.getStats().deferred);
+}
+
+void test_duty_cycled_second_copy_is_plain() {
+    EmergencyStopHandler handler(6, nullptr);
+    LoRaPhyConfig phy = loraDefaultPhy();
+    LoRaPhyConfig urgent = phy;
+    urgent.preambleLength = 250;
+    handler.setPhy(phy, urgent.preambleLength);
+    uint32_t wakeSlot = loraAirtimeUs(urgent, sizeof(SecureFrame)) / 1000 + EMERGENCY_SLOT_GUARD_MS;
+    uint32_t plainSlot = loraAirtimeUs(phy, sizeof(SecureFrame)) / 1000 + EMERGENCY_SLOT_GUARD_MS;
+    TEST_ASSERT_EQUAL((EMERGENCY_RELAY_SLOTS - 1) * wakeSlot, handler.getRelayWindowMs());
+
+    handler.trigger(ESTOP_REASON_OPERATOR, 0);
+    DroneMessage out;
+    bool wake = false;
+    TEST_ASSERT_TRUE(handler.pollTransmit(0, out, false, &wake));
+    TEST_ASSERT_TRUE(wake);
+
+    // Once the first is off air, in a plain-frame relay slot
+    uint32_t t = handler.nextTransmitIn(0);
+    TEST_ASSERT_TRUE(t >= wakeSlot);
+    TEST_ASSERT_TRUE(t <= wakeSlot + (EMERGENCY_RELAY_SLOTS - 1) * plainSlot);
+    TEST_ASSERT_TRUE(handler.pollTransmit(t, out, false, &wake));
+    TEST_ASSERT_FALSE(wake);
+
+    // The rest reach sleeping neighbours again
+    t += handler.nextTransmitIn(t);
+    TEST_ASSERT_TRUE(handler.pollTransmit(t, out, false, &wake));
+    TEST_ASSERT_TRUE(wake);
+}
+
+void test_corrupt_and_foreign_frames_are_rejected() {
+    MissionStateMachine mission;
+    EmergencyStopHandler handler(2, &mission);
+    DroneMessage msg = stopFrame(1, 1, 1, 0);
+    msg.data[0] ^= 0x40;
+    TEST_ASSERT_EQUAL(ESTOP_INVALID, handler.onFrame((uint8_t*)&msg, sizeof(msg), 0));
+
+    msg = stopFrame(1, 1, 1, 0);
+    msg.messageType = MSG_HEARTBEAT;
+    TEST_ASSERT_EQUAL(ESTOP_NOT_A_STOP, handler.onFrame((uint8_t*)&msg, sizeof(msg), 0));
+    TEST_ASSERT_EQUAL(ESTOP_NOT_A_STOP, handler.onFrame((uint8_t*)&msg, 10, 0));
+    TEST_ASSERT_FALSE(mission.isStopped());
+}
+
+// ===== Swarm simulation =====
+//
+// FAST:   DIO0 wakes the radio task, which handles the stop and sends the
+//         relays, aborting whatever frame is on air. A copy whose slot finds
+//         someone else's frame on air moves back a slot, and a node holds
+//         its own heartbeats while it still has copies to send.
+// LOOP:   the previous behaviour - frames are only looked at when loop()
+//         comes round (delay(100) per pass) and every send blocks in
+//         endPacket(). Relaying is still enabled so the comparison is about
+//         the dispatch path, not about flooding.
+// Frames go on air sealed, as DroneComm sends them.
+
+enum StopPath { PATH_FAST, PATH_LOOP };
+
+#define LOOP_PERIOD_US 100000ULL
+#define SIM_RANGE_M 900.0f
+
+struct SimDrone {
+    MissionStateMachine mission;
+    std::unique_ptr<EmergencyStopHandler> handler;
+    std::unique_ptr<SecureLink> link;
+    std::vector<DroneMessage> inbox;    // LOOP only
+    bool radioTaskArmed;
+};
+
+struct LatencyResult {
+    std::vector<double> latencyMs;      // Per stopped drone
+    uint8_t diameter;
+    uint32_t missed;
+    uint32_t aborted;
+};
+
+class StopSimulation {
+private:
+    RadioSim sim;
+    std::vector<SimDrone> drones;
+    StopPath path;
+    bool connected;
+
+    uint32_t nowMs() { return (uint32_t)(sim.now() / 1000); }
+
+    void send(uint8_t node, DroneMessage& msg) {
+        SecureFrame frame;
+        drones[node].link->seal(msg, frame);
+        sim.transmit(node, &frame, sizeof(frame));
+    }
+
+    // Radio task: wakes when a relay is due, aborts any frame on air
+    void armRadioTask(uint8_t node) {
+        SimDrone& d = drones[node];
+        uint32_t wait = d.handler->nextTransmitIn(nowMs());
+        if (d.radioTaskArmed || wait == UINT32_MAX) return;
+        d.radioTaskArmed = true;
+        sim.after((uint64_t)wait * 1000, [this, node]() {
+            SimDrone& d = drones[node];
+            d.radioTaskArmed = false;
+            DroneMessage out;
+            if (d.handler->pollTransmit(nowMs(), out, sim.senseChannel(node, MAC_RSSI_BUSY_DBM))) {
+                sim.abortTransmit(node);
+                send(node, out);
+            }
+            armRadioTask(node);
+        });
+    }
+
+    // loop(): blocked while its own endPacket() runs, then delay(100)
+    void loopPass(uint8_t node) {
+        if (sim.isTransmitting(node)) {
+            sim.after(1000, [this, node]() { loopPass(node); });
+            return;
+        }
+        SimDrone& d = drones[node];
+        for (DroneMessage& msg : d.inbox) {
+            if (msg.messageType == MSG_HEARTBEAT) {
+                d.handler->onPeerHeartbeat(msg.sourceId, ((HeartbeatData*)msg.data)->missionState, nowMs());
+            } else {
+                d.handler->onFrame((uint8_t*)&msg, sizeof(msg), nowMs());
+            }
+        }
+        d.inbox.clear();
+        DroneMessage out;
+        if (d.handler->pollTransmit(nowMs(), out)) {
+            send(node, out);
+        }
+        sim.after(LOOP_PERIOD_US, [this, node]() { loopPass(node); });
+    }
+
+    void heartbeat(uint8_t node) {
+        DroneMessage hb;
+        memset(&hb, 0, sizeof(hb));
+        hb.messageType = MSG_HEARTBEAT;
+        hb.sourceId = node;
+        hb.dataLength = sizeof(HeartbeatData);
+        HeartbeatData data;
+        memset(&data, 0, sizeof(data));
+        data.droneId = node;
+        data.missionState = drones[node].mission.getState();
+        memcpy(hb.data, &data, sizeof(data));
+        hb.checksum = droneMessageChecksum(hb);
+        // Heartbeats never preempt anything; on the fast path DroneComm
+        // also holds them while this node's stop copies are going out
+        bool held = path == PATH_FAST && drones[node].handler->hasPending();
+        if (!sim.isTransmitting(node) && !held) {
+            send(node, hb);
+        }
+        // loop() only notices the interval has passed on its next pass
+        std::uniform_int_distribution<uint32_t> lateness(0, LOOP_PERIOD_US);
+        sim.after(HEARTBEAT_INTERVAL_MS * 1000ULL + lateness(sim.rng()), [this, node]() { heartbeat(node); });
+    }
+
+public:
+    StopSimulation(uint8_t count, StopPath mode, uint32_t seed) : sim(count, seed), drones(count), path(mode) {
+        sim.setRange(SIM_RANGE_M);
+        // Area grows with the swarm so larger swarms are also deeper (more hops)
+        connected = sim.placeRandom(SIM_RANGE_M * 0.75f * sqrtf((float)count), 1000);
+        for (uint8_t i = 0; i < count; i++) {
+            drones[i].handler.reset(new EmergencyStopHandler(i, &drones[i].mission));
+            drones[i].handler->seed(seed * 131 + i + 1);
+            drones[i].link.reset(new SecureLink(i, networkKey));
+            drones[i].radioTaskArmed = false;
+        }
+
+        sim.onReceive([this](uint8_t node, const SimFrame& frame) {
+            if (frame.payload.size() != sizeof(SecureFrame)) return;
+            SimDrone& d = drones[node];
+            DroneMessage msg;
+            if (d.link->open(*(const SecureFrame*)frame.payload.data(), msg, nowMs()) != CRYPTO_OK) return;
+            if (path == PATH_FAST) {
+                // Radio task, woken by DIO0
+                bool armed = msg.messageType == MSG_HEARTBEAT
+                    ? d.handler->onPeerHeartbeat(msg.sourceId, ((const HeartbeatData*)msg.data)->missionState, nowMs())
+                    : d.handler->onFrame((const uint8_t*)&msg, sizeof(msg), nowMs()) == ESTOP_APPLIED;
+                if (armed) {
+                    armRadioTask(node);
+                }
+            } else {
+                d.inbox.push_back(msg);
+            }
+        });
+        sim.onTxDone([this](uint8_t node, const SimFrame&) {
+            if (path == PATH_FAST) armRadioTask(node);
+        });
+
+        std::uniform_int_distribution<uint32_t> phase(0, HEARTBEAT_INTERVAL_MS * 1000);
+        std::uniform_int_distribution<uint32_t> loopPhase(0, LOOP_PERIOD_US);
+        for (uint8_t i = 0; i < count; i++) {
+            sim.at(phase(sim.rng()), [this, i]() { heartbeat(i); });
+            if (path == PATH_LOOP) {
+                sim.at(loopPhase(sim.rng()), [this, i]() { loopPass(i); });
+            }
+        }
+    }
+
+    LatencyResult run() {
+        // Let heartbeat traffic settle, then the operator's drone stops the swarm
+        std::uniform_int_distribution<uint32_t> when(5000000, 7000000);
+        uint64_t triggerAt = when(sim.rng());
+        uint8_t origin = sim.rng()() % drones.size();
+        sim.at(triggerAt, [this, origin]() {
+            drones[origin].handler->trigger(ESTOP_REASON_OPERATOR, nowMs());
+            if (path == PATH_FAST) {
+                armRadioTask(origin);
+            }
+        });
+        sim.run(triggerAt + 60000000ULL);
+
+        LatencyResult result;
+        std::vector<uint8_t> hops;
+        result.diameter = sim.hopsFrom(origin, hops);
+        result.missed = 0;
+        result.aborted = sim.getStats().framesAborted;
+        for (SimDrone& d : drones) {
+            if (d.mission.isStopped()) {
+                result.latencyMs.push_back(d.mission.getStoppedAt() - triggerAt / 1000.0);
+            } else {
+                result.missed++;
+            }
+        }
+        return result;
+    }
+};
+
+static double percentile(std::vector<double>& values, double p) {
+    std::sort(values.begin(), values.end());
+    return values[(size_t)(p * (values.size() - 1))];
+}
+
+void test_simulated_swarm_stop_latency() {
+    uint32_t airtimeMs = loraAirtimeUs(loraDefaultPhy(), sizeof(SecureFrame)) / 1000;
+    printf("[SIM] emergency stop, %lu ms frames, %d trials per point:\n", (unsigned long)airtimeMs, 40);
+
+    for (uint8_t count : {5, 20, 50}) {
+        std::vector<double> latency[2];
+        uint32_t missed[2] = {0, 0};
+        uint8_t diameter = 0;
+        uint32_t aborted = 0;
+        for (int mode = PATH_FAST; mode <= PATH_LOOP; mode++) {
+            for (uint32_t trial = 0; trial < 40; trial++) {
+                StopSimulation simulation(count, (StopPath)mode, trial * 7919 + count);
+                LatencyResult r = simulation.run();
+                latency[mode].insert(latency[mode].end(), r.latencyMs.begin(), r.latencyMs.end());
+                missed[mode] += r.missed;
+                if (mode == PATH_FAST) {
+                    diameter = std::max(diameter, r.diameter);
+                    aborted += r.aborted;
+                }
+            }
+        }
+        double p50[2], p95[2], worst[2];
+        for (int mode = PATH_FAST; mode <= PATH_LOOP; mode++) {
+            p50[mode] = percentile(latency[mode], 0.50);
+            p95[mode] = percentile(latency[mode], 0.95);
+            worst[mode] = latency[mode].back();
+        }
+        printf("[SIM]    %2d drones (<=%2d hops): fast path p50 %4.0f / p95 %4.0f / max %5.0f ms, %lu frames preempted\n",
+               count, diameter, p50[PATH_FAST], p95[PATH_FAST], worst[PATH_FAST], (unsigned long)aborted);
+        printf("[SIM]                          main loop p50 %4.0f / p95 %4.0f / max %5.0f ms, %lu drones never stopped\n",
+               p50[PATH_LOOP], p95[PATH_LOOP], worst[PATH_LOOP], (unsigned long)missed[PATH_LOOP]);
+        TEST_ASSERT_EQUAL(0, missed[PATH_FAST]);
+
+        // Per hop: a relay slot plus one frame, and one repeat period for a
+        // lost copy. That holds for the slowest drone too: nobody waits for
+        // a heartbeat to be heard before the stop reaches it
+        EmergencyStopHandler reference(0, nullptr);
+        double hopBound = reference.getRelayWindowMs() + airtimeMs;
+        TEST_ASSERT_LESS_OR_EQUAL(diameter * hopBound + EMERGENCY_STOP_REPEAT_MS, worst[PATH_FAST]);
+        TEST_ASSERT_LESS_OR_EQUAL(worst[PATH_LOOP], worst[PATH_FAST]);
+        TEST_ASSERT_LESS_THAN(p50[PATH_LOOP], p50[PATH_FAST]);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_state_machine_latches_stop);
+    RUN_TEST(test_first_copy_applies_and_relays_once_per_repeat);
+    RUN_TEST(test_busy_neighbourhood_suppresses_repeats);
+    RUN_TEST(test_flying_neighbour_heartbeat_reannounces_stop);
+    RUN_TEST(test_repeats_continue_until_neighbours_echo);
+    RUN_TEST(test_busy_channel_defers_by_bounded_slots);
+    RUN_TEST(test_duty_cycled_second_copy_is_plain);
+    RUN_TEST(test_corrupt_and_foreign_frames_are_rejected);
+    RUN_TEST(test_simulated_swarm_stop_latency);
+    return UNITY_END();
+}
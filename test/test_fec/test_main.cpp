@@ -0,0 +1,343 @@
+// Forward error correction tests: GF(2^8) kernels, rebuilding from any k
+// frames of a group, decoder limits, codec throughput, and a simulated
+// broadcast comparing plain multi-frame updates with parity at several loss rates
+// Run with: pio test -e native -f test_fec
+
+#include <unity.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "../../include/communications/message_sender.h"
+#include "../../include/communications/message_parser.h"
+#include "../../include/simulation/radio_sim.h"
+#include "../../include/utilities/crypto_utils.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void fill(uint8_t* bytes, uint16_t length, uint32_t seed) {
+    std::mt19937 rng(seed);
+    for (uint16_t i = 0; i < length; i++) {
+        bytes[i] = (uint8_t)rng();
+    }
+}
+
+void test_field_and_vector_kernel_match_scalar() {
+    for (int a = 1; a < 256; a++) {
+        TEST_ASSERT_EQUAL(1, fecMul((uint8_t)a, fecInverse((uint8_t)a)));
+        TEST_ASSERT_EQUAL(fecMul((uint8_t)a, 0x53) ^ fecMul((uint8_t)a, 0xCA), fecMul((uint8_t)a, 0x53 ^ 0xCA));
+    }
+    for (uint8_t j = 0; j < FEC_MAX_DATA_FRAMES; j++) {
+        TEST_ASSERT_EQUAL(1, fecParityCoefficient(0, j));
+    }
+
+    std::mt19937 rng(3);
+    for (uint16_t length = 0; length < 80; length++) {
+        uint8_t src[80], a[80], b[80];
+        fill(src, sizeof(src), length);
+        fill(a, sizeof(a), length + 1000);
+        memcpy(b, a, sizeof(b));
+        uint8_t coefficient = (uint8_t)(length < 3 ? length : rng());
+        fecMulAdd(a, src, coefficient, length);
+        fecMulAddScalar(b, src, coefficient, length);
+        TEST_ASSERT_EQUAL_MEMORY(b, a, sizeof(a));
+    }
+}
+
+// Feeds `frames` in the given order; true once the group is rebuilt intact
+static bool feed(FecDecoder& decoder, const DroneMessage* frames, const std::vector<uint8_t>& order,
+                 const uint8_t* expected, uint16_t length) {
+    FecMessage out;
+    for (size_t i = 0; i < order.size(); i++) {
+        FecRxResult result = decoder.add(frames[order[i]], 100, out);
+        if (result == FEC_COMPLETE) {
+            TEST_ASSERT_EQUAL(i + 1, order.size());
+            TEST_ASSERT_EQUAL(MSG_MISSION_UPDATE, out.type);
+            TEST_ASSERT_EQUAL(length, out.length);
+            TEST_ASSERT_EQUAL_MEMORY(expected, out.data, length);
+            return true;
+        }
+        TEST_ASSERT_EQUAL(FEC_PENDING, result);
+    }
+    return false;
+}
+
+void test_any_k_frames_rebuild_the_message() {
+    MessageSender sender(1);
+    uint8_t update[120];            // 5 data frames, the last one partly padding
+    fill(update, sizeof(update), 7);
+    DroneMessage frames[8];
+    TEST_ASSERT_EQUAL(8, sender.encodeFec(0xFF, MSG_MISSION_UPDATE, update, sizeof(update), 3, 50, frames, 8));
+    for (uint8_t i = 0; i < 8; i++) {
+        FecHeader header;
+        memcpy(&header, frames[i].data, sizeof(header));
+        TEST_ASSERT_EQUAL(MSG_FEC, frames[i].messageType);
+        TEST_ASSERT_EQUAL(i, header.index);
+        TEST_ASSERT_EQUAL(5, header.dataFrames);
+        TEST_ASSERT_EQUAL(50, frames[i].timestamp);
+    }
+
+    // The first parity frame is the XOR of the data
+    uint8_t xorOfData[FEC_SYMBOL_BYTES] = {0};
+    for (uint8_t i = 0; i < 5; i++) {
+        for (uint8_t b = 0; b < FEC_SYMBOL_BYTES; b++) {
+            xorOfData[b] ^= frames[i].data[sizeof(FecHeader) + b];
+        }
+    }
+    TEST_ASSERT_EQUAL_MEMORY(xorOfData, frames[5].data + sizeof(FecHeader), FEC_SYMBOL_BYTES);
+
+    // Every 5-of-8 subset, in shuffled order
+    std::mt19937 rng(5);
+    uint32_t subsets = 0;
+    for (uint16_t mask = 0; mask < 256; mask++) {
+        if (__builtin_popcount(mask) != 5) {
+            continue;
+        }
+        std::vector<uint8_t> order;
+        for (uint8_t i = 0; i < 8; i++) {
+            if (mask & (1 << i)) order.push_back(i);
+        }
+        std::shuffle(order.begin(), order.end(), rng);
+        FecDecoder decoder;
+        TEST_ASSERT_TRUE(feed(decoder, frames, order, update, sizeof(update)));
+        TEST_ASSERT_EQUAL(5 - __builtin_popcount(mask & 0x1F), decoder.getStats().recovered);
+        subsets++;
+    }
+    TEST_ASSERT_EQUAL(56, subsets);
+
+    // Four frames are never enough
+    FecDecoder decoder;
+    TEST_ASSERT_FALSE(feed(decoder, frames, {7, 0, 5, 3}, update, sizeof(update)));
+
+    // Largest group: all 8 parity frames stand in for 8 lost data frames
+    uint8_t big[FEC_MAX_MESSAGE];
+    fill(big, sizeof(big), 9);
+    DroneMessage bigFrames[FEC_MAX_DATA_FRAMES + FEC_MAX_PARITY_FRAMES];
+    TEST_ASSERT_EQUAL(24, sender.encodeFec(0xFF, MSG_MISSION_UPDATE, big, sizeof(big), FEC_MAX_PARITY_FRAMES, 60,
+                                           bigFrames, 24));
+    FecDecoder bigDecoder;
+    TEST_ASSERT_TRUE(feed(bigDecoder, bigFrames, {23, 1, 22, 3, 21, 5, 20, 7, 19, 9, 18, 11, 17, 13, 16, 15},
+                          big, sizeof(big)));
+    TEST_ASSERT_EQUAL(8, bigDecoder.getStats().recovered);
+}
+
+void test_decoder_limits_and_groups() {
+    MessageSender sender(1);
+    uint8_t update[FEC_MAX_MESSAGE + 1];
+    fill(update, sizeof(update), 11);
+    DroneMessage frames[FEC_MAX_DATA_FRAMES + FEC_MAX_PARITY_FRAMES + 1];
+    TEST_ASSERT_EQUAL(0, sender.encodeFec(0xFF, MSG_MISSION_UPDATE, update, sizeof(update), 1, 0, frames, 25));
+    TEST_ASSERT_EQUAL(0, sender.encodeFec(0xFF, MSG_MISSION_UPDATE, update, 0, 1, 0, frames, 25));
+    TEST_ASSERT_EQUAL(0, sender.encodeFec(0xFF, MSG_MISSION_UPDATE, update, 60, FEC_MAX_PARITY_FRAMES + 1, 0, frames, 25));
+    TEST_ASSERT_EQUAL(0, sender.encodeFec(0xFF, MSG_MISSION_UPDATE, update, 60, 2, 0, frames, 4));
+    TEST_ASSERT_EQUAL(0, sender.encodeFec(0xFF, MSG_EMERGENCY_STOP, update, 60, 2, 0, frames, 5));
+    TEST_ASSERT_EQUAL(5, sender.encodeFec(0xFF, MSG_GOSSIP, update, 60, 2, 0, frames, 5));
+    TEST_ASSERT_EQUAL(1, sender.getStats().fecGroups);
+    TEST_ASSERT_EQUAL(2, sender.getStats().fecParityFrames);
+
+    FecDecoder decoder;
+    FecMessage out;
+    DroneMessage bad = frames[0];
+    bad.dataLength--;
+    TEST_ASSERT_EQUAL(FEC_IGNORED, decoder.add(bad, 0, out));
+    bad = frames[0];
+    bad.data[3] = 2;                // dataFrames no longer matches the length
+    TEST_ASSERT_EQUAL(FEC_IGNORED, decoder.add(bad, 0, out));
+    bad = frames[0];
+    bad.data[2] = 3 + FEC_MAX_PARITY_FRAMES;
+    TEST_ASSERT_EQUAL(FEC_IGNORED, decoder.add(bad, 0, out));
+    TEST_ASSERT_EQUAL(3, decoder.getStats().malformed);
+
+    TEST_ASSERT_EQUAL(FEC_PENDING, decoder.add(frames[0], 0, out));
+    TEST_ASSERT_EQUAL(FEC_REDUNDANT, decoder.add(frames[0], 0, out));
+    TEST_ASSERT_EQUAL(FEC_PENDING, decoder.add(frames[4], 0, out));
+    TEST_ASSERT_EQUAL(FEC_COMPLETE, decoder.add(frames[2], 0, out));
+    TEST_ASSERT_EQUAL_MEMORY(update, out.data, 60);
+    TEST_ASSERT_EQUAL(FEC_REDUNDANT, decoder.add(frames[3], 0, out));     // Late parity
+
+    // A rebooted sender reuses group 0; its timestamp tells the groups apart
+    MessageSender rebooted(1);
+    DroneMessage again[3];
+    TEST_ASSERT_EQUAL(3, rebooted.encodeFec(0xFF, MSG_GOSSIP, update + 1, 30, 1, 7000, again, 3));
+    TEST_ASSERT_EQUAL(FEC_PENDING, decoder.add(again[2], 7000, out));
+    TEST_ASSERT_EQUAL(FEC_COMPLETE, decoder.add(again[1], 7000, out));
+    TEST_ASSERT_EQUAL_MEMORY(update + 1, out.data, 30);
+
+    // Interleaved senders; a third group evicts the oldest finished one
+    MessageSender other(2);
+    DroneMessage second[4];
+    TEST_ASSERT_EQUAL(4, other.encodeFec(0xFF, MSG_GOSSIP, update + 2, 70, 1, 7100, second, 4));
+    TEST_ASSERT_EQUAL(FEC_PENDING, decoder.add(second[0], 7100, out));
+    TEST_ASSERT_EQUAL(FEC_REDUNDANT, decoder.add(again[0], 7150, out));   // Still remembered
+    TEST_ASSERT_EQUAL(FEC_PENDING, decoder.add(second[3], 7200, out));
+    TEST_ASSERT_EQUAL(FEC_COMPLETE, decoder.add(second[1], 7300, out));
+    TEST_ASSERT_EQUAL_MEMORY(update + 2, out.data, 70);
+
+    // An unfinished group times out
+    TEST_ASSERT_EQUAL(5, sender.encodeFec(0xFF, MSG_GOSSIP, update, 60, 2, 8000, frames, 5));
+    TEST_ASSERT_EQUAL(FEC_PENDING, decoder.add(frames[1], 8000, out));
+    decoder.expire(8000 + FEC_GROUP_TIMEOUT_MS);
+    TEST_ASSERT_EQUAL(1, decoder.getStats().expired);
+    TEST_ASSERT_EQUAL(3, decoder.getStats().completed);
+}
+
+void benchmark_codec() {
+    const int rounds = 20000;
+    uint8_t src[FEC_SYMBOL_BYTES * 16], dst[FEC_SYMBOL_BYTES * 16];
+    fill(src, sizeof(src), 1);
+    memset(dst, 0, sizeof(dst));
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) fecMulAddScalar(dst, src, (uint8_t)(i | 2), sizeof(src));
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) fecMulAdd(dst, src, (uint8_t)(i | 2), sizeof(src));
+    auto t2 = std::chrono::steady_clock::now();
+    double bytes = (double)rounds * sizeof(src);
+    double scalarMBs = bytes / std::chrono::duration<double>(t1 - t0).count() / 1e6;
+    double vectorMBs = bytes / std::chrono::duration<double>(t2 - t1).count() / 1e6;
+    printf("[BENCH] FEC, %u-byte symbols:\n", FEC_SYMBOL_BYTES);
+    printf("[BENCH]    multiply-add: scalar %.0f MB/s, vector %.0f MB/s (%.1fx)\n", scalarMBs, vectorMBs,
+           vectorMBs / scalarMBs);
+
+    // Whole groups: k = 12 data frames with 4 parity, decoding with 4 data frames lost
+    MessageSender sender(1);
+    uint8_t update[12 * FEC_SYMBOL_BYTES];
+    fill(update, sizeof(update), 2);
+    DroneMessage frames[16];
+    const int groups = 20000;
+    auto t3 = std::chrono::steady_clock::now();
+    for (int i = 0; i < groups; i++) {
+        update[0] = (uint8_t)i;
+        sender.encodeFec(0xFF, MSG_MISSION_UPDATE, update, sizeof(update), 4, (uint32_t)i, frames, 16);
+    }
+    auto t4 = std::chrono::steady_clock::now();
+    FecDecoder decoder;
+    FecMessage out;
+    uint32_t complete = 0;
+    for (int i = 0; i < groups; i++) {
+        for (uint8_t f = 0; f < 16; f++) {
+            frames[f].timestamp = (uint32_t)i;                          // A new group each time
+            if (f % 3 == 1 && f < 12) continue;                         // 4 of the 12 data frames lost
+            if (decoder.add(frames[f], (uint32_t)i, out) == FEC_COMPLETE) complete++;
+        }
+    }
+    auto t5 = std::chrono::steady_clock::now();
+    double groupBytes = (double)groups * sizeof(update);
+    double encodeMBs = groupBytes / std::chrono::duration<double>(t4 - t3).count() / 1e6;
+    double decodeMBs = groupBytes / std::chrono::duration<double>(t5 - t4).count() / 1e6;
+    printf("[BENCH]    k=12 m=4: encode %.0f MB/s (%.2f us/group), decode with 4 lost %.0f MB/s (%.2f us/group)\n",
+           encodeMBs, sizeof(update) / encodeMBs, decodeMBs, sizeof(update) / decodeMBs);
+    TEST_ASSERT_EQUAL(groups, complete);
+    TEST_ASSERT_EQUAL((uint32_t)groups * 4, decoder.getStats().recovered);
+}
+
+// Simulated broadcast: one drone sends a 12-frame update (312 bytes, e.g. a
+// waypoint list) to the rest of the cell, with per-frame, per-receiver
+// loss. Without parity any lost frame means the whole update is sent again;
+// with parity a receiver only needs any 12 of the frames. Rounds repeat
+// until every receiver has the update, as a sender re-broadcasting until
+// all acknowledge would.
+
+#define SIM_RECEIVERS 9
+#define SIM_UPDATES 200
+#define SIM_DATA_FRAMES 12
+
+struct FecResult {
+    double firstRound;          // Receivers with the update after one round
+    double framesPerUpdate;     // Until all receivers have it
+    uint32_t recovered;
+};
+
+static FecResult simulateBroadcast(float loss, uint8_t parity, uint32_t seed) {
+    RadioSim sim(SIM_RECEIVERS + 1, seed);
+    sim.setRange(1000.0f);
+    sim.setPacketReception(1.0f - loss);
+    for (uint8_t i = 0; i <= SIM_RECEIVERS; i++) {
+        sim.setPosition(i, (float)(i * 10), 0.0f);
+    }
+    std::vector<FecDecoder> decoders(SIM_RECEIVERS + 1);
+    std::vector<bool> have(SIM_RECEIVERS + 1);
+    uint32_t haveCount = 0;
+    sim.onReceive([&](uint8_t node, const SimFrame& frame) {
+        const SecureFrame* secure = (const SecureFrame*)frame.payload.data();
+        FecMessage out;
+        if (decoders[node].add(secure->msg, (uint32_t)(sim.now() / 1000), out) == FEC_COMPLETE && !have[node]) {
+            have[node] = true;
+            haveCount++;
+        }
+    });
+
+    MessageSender sender(0);
+    uint8_t update[SIM_DATA_FRAMES * FEC_SYMBOL_BYTES];
+    DroneMessage frames[SIM_DATA_FRAMES + FEC_MAX_PARITY_FRAMES];
+    uint64_t firstRound = 0, framesSent = 0;
+    for (uint32_t u = 0; u < SIM_UPDATES; u++) {
+        fill(update, sizeof(update), u);
+        std::fill(have.begin(), have.end(), false);
+        haveCount = 0;
+        for (uint32_t round = 0; haveCount < SIM_RECEIVERS; round++) {
+            // Receivers that already have it ignore the repeat's frames
+            uint8_t count = sender.encodeFec(0xFF, MSG_MISSION_UPDATE, update, sizeof(update), parity,
+                                             (uint32_t)(sim.now() / 1000), frames, sizeof(frames) / sizeof(frames[0]));
+            for (uint8_t f = 0; f < count; f++) {
+                SecureFrame frame;
+                memset(&frame, 0, sizeof(frame));
+                frame.msg = frames[f];
+                sim.transmit(0, &frame, sizeof(frame));
+                sim.run(sim.now() + loraAirtimeUs(loraDefaultPhy(), sizeof(SecureFrame)) + 1000);
+            }
+            framesSent += count;
+            if (round == 0) {
+                firstRound += haveCount;
+            }
+        }
+    }
+
+    FecResult r;
+    r.firstRound = firstRound / (double)(SIM_UPDATES * SIM_RECEIVERS);
+    r.framesPerUpdate = framesSent / (double)SIM_UPDATES;
+    r.recovered = 0;
+    for (auto& d : decoders) {
+        r.recovered += d.getStats().recovered;
+    }
+    return r;
+}
+
+void test_simulated_broadcast_delivery() {
+    static const float losses[] = {0.01f, 0.05f, 0.10f, 0.20f, 0.30f};
+    static const uint8_t parities[] = {0, 1, 2, 4, 8};
+    printf("[SIM] %d-frame broadcast update to %d receivers, %d updates per run:\n", SIM_DATA_FRAMES, SIM_RECEIVERS,
+           SIM_UPDATES);
+    printf("[SIM]   loss  parity  overhead  first-round delivery  frames until all have it  rebuilt frames\n");
+    for (float loss : losses) {
+        FecResult plain = simulateBroadcast(loss, 0, 17);
+        double bestFrames = plain.framesPerUpdate;
+        for (uint8_t parity : parities) {
+            FecResult r = parity ? simulateBroadcast(loss, parity, 17) : plain;
+            printf("[SIM]   %3.0f%%  %6u  %7.0f%%  %19.2f%%  %24.1f  %14u\n", loss * 100, parity,
+                   100.0 * parity / SIM_DATA_FRAMES, r.firstRound * 100, r.framesPerUpdate, (unsigned)r.recovered);
+            bestFrames = std::min(bestFrames, r.framesPerUpdate);
+
+            // The data frames alone deliver (1 - loss)^12; parity only adds to that
+            double plainOdds = pow(1.0 - loss, SIM_DATA_FRAMES);
+            TEST_ASSERT_TRUE(r.firstRound >= plainOdds - 0.05);
+            if (parity) {
+                TEST_ASSERT_TRUE(r.firstRound >= plain.firstRound);
+            }
+        }
+        // From 5% loss some parity beats resending whole updates
+        if (loss >= 0.05f) {
+            TEST_ASSERT_TRUE(bestFrames < plain.framesPerUpdate * 0.8);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_field_and_vector_kernel_match_scalar);
+    RUN_TEST(test_any_k_frames_rebuild_the_message);
+    RUN_TEST(test_decoder_limits_and_groups);
+    RUN_TEST(benchmark_codec);
+    RUN_TEST(test_simulated_broadcast_delivery);
+    return UNITY_END();
+}
@@ -0,0 +1,284 @@
+// Formation assignment/avoidance tests, simulation replay and tick benchmark
+// Run with: pio test -e native -f test_formation
+// Set FORMATION_TRACE=<file> to dump the simulation as CSV
+// (tick,droneId,x,y,vx,vy,slot) for plotting.
+
+#include <unity.h>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <stdlib.h>
+#include "../../include/coordination/mission_controller.h"
+
+static HungarianSolver solver;
+static HungarianSolver reference;
+
+static void randomCosts(HungarianSolver& s, uint8_t rows, uint8_t cols, std::mt19937& rng) {
+    std::uniform_real_distribution<float> value(0.0f, 1000.0f);
+    s.setSize(rows, cols);
+    for (uint8_t r = 0; r < rows; r++)
+        for (uint8_t c = 0; c < cols; c++)
+            s.setCost(r, c, value(rng));
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_hungarian_matches_brute_force() {
+    std::mt19937 rng(7);
+    for (int trial = 0; trial < 50; trial++) {
+        uint8_t rows = 2 + trial % 5;
+        uint8_t cols = rows + trial % 2;
+        randomCosts(solver, rows, cols, rng);
+        float best = solver.solve();
+
+        int perm[8];
+        for (int i = 0; i < cols; i++) perm[i] = i;
+        float brute = 1e30f;
+        do {
+            float total = 0;
+            for (int r = 0; r < rows; r++) total += solver.getCost(r, perm[r]);
+            brute = fminf(brute, total);
+        } while (std::next_permutation(perm, perm + cols));
+
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, brute, best);
+    }
+}
+
+void test_incremental_removal_matches_full_solve() {
+    std::mt19937 rng(21);
+    randomCosts(solver, 30, 30, rng);
+    solver.solve();
+
+    for (uint8_t removed = 0; removed < 12; removed++) {
+        uint8_t row;
+        do {
+            row = rng() % 30;
+        } while (solver.getColumn(row) < 0);
+        float repaired = solver.removeRow(row);
+
+        // Same costs, same missing rows, solved from scratch
+        reference.setSize(30, 30);
+        for (uint8_t r = 0; r < 30; r++)
+            for (uint8_t c = 0; c < 30; c++)
+                reference.setCost(r, c, solver.getCost(r, c));
+        for (uint8_t r = 0; r < 30; r++)
+            if (solver.getColumn(r) < 0) reference.removeRow(r);
+        TEST_ASSERT_FLOAT_WITHIN(0.05f, reference.solve(), repaired);
+    }
+    // Every repair reused the duals
+    TEST_ASSERT_EQUAL(0, solver.getFallbackCount());
+}
+
+void test_slots_respect_spacing() {
+    for (int shape = FORMATION_LINE; shape <= FORMATION_GRID; shape++) {
+        FormationController formation((FormationShape)shape, 100.0f);
+        for (uint8_t i = 0; i < 20; i++) {
+            formation.updateMember(i, Vec2(i * 10.0f, 0), Vec2(), 0);
+        }
+        VelocityCommand commands[20];
+        TEST_ASSERT_EQUAL(20, formation.tick(commands, 20));
+
+        for (uint8_t a = 0; a < 20; a++) {
+            for (uint8_t b = a + 1; b < 20; b++) {
+                Vec2 d = formation.getSlotPosition(a) - formation.getSlotPosition(b);
+                TEST_ASSERT_GREATER_OR_EQUAL(99.0f, sqrtf(d * d));
+            }
+        }
+    }
+}
+
+void test_orca_head_on_pair_passes_safely() {
+    Vec2 pos[2] = {Vec2(-100, 0.5f), Vec2(100, -0.5f)};
+    Vec2 vel[2] = {Vec2(), Vec2()};
+    Vec2 goal[2] = {Vec2(100, 0), Vec2(-100, 0)};
+    float closest = 1e9f;
+    const float dt = 0.1f;
+
+    for (int step = 0; step < 600; step++) {
+        Vec2 next[2];
+        for (int i = 0; i < 2; i++) {
+            Vec2 toGoal = goal[i] - pos[i];
+            float d = sqrtf(toGoal * toGoal);
+            Vec2 preferred = d > 0.01f ? toGoal * (fminf(10.0f, d) / d) : Vec2();
+            next[i] = orcaVelocity(pos[i], vel[i], preferred, &pos[1 - i], &vel[1 - i], 1,
+                                   DRONE_SAFETY_RADIUS_M, 10.0f, ORCA_TIME_HORIZON_S, dt);
+        }
+        for (int i = 0; i < 2; i++) {
+            vel[i] = next[i];
+            pos[i] = pos[i] + vel[i] * dt;
+        }
+        Vec2 gap = pos[0] - pos[1];
+        closest = fminf(closest, sqrtf(gap * gap));
+    }
+
+    TEST_ASSERT_GREATER_OR_EQUAL(2 * DRONE_SAFETY_RADIUS_M * 0.95f, closest);
+    Vec2 miss = pos[0] - goal[0];
+    TEST_ASSERT_LESS_THAN(1.0f, sqrtf(miss * miss));
+}
+
+void test_heartbeat_positions_and_expiry() {
+    FormationController formation;
+    HeartbeatData hb = {1, 90.0f, 28.7041f, 77.1025f, 0, 0};
+    TEST_ASSERT_TRUE(formation.updateFromHeartbeat(hb, 1000));
+    hb.droneId = 2;
+    hb.latitude += 0.001f;          // ~111 m north
+    formation.updateFromHeartbeat(hb, 1000);
+    hb.latitude += 0.0001f;         // Moves ~11 m in 2 s
+    formation.updateFromHeartbeat(hb, 3000);
+
+    const FormationMember* second = formation.getMember(2);
+    TEST_ASSERT_NOT_NULL(second);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 122.5f, second->position.y);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 2.8f, second->velocity.y);
+
+    VelocityCommand commands[2];
+    TEST_ASSERT_EQUAL(2, formation.tick(commands, 2));
+    TEST_ASSERT_EQUAL(1, formation.expireMembers(1000 + HEARTBEAT_TIMEOUT_MS + 1));
+    TEST_ASSERT_NULL(formation.getMember(1));
+    TEST_ASSERT_EQUAL(1, formation.getStats().incrementalRepairs);
+}
+
+struct SimResult {
+    float closest;
+    float finalError;
+    uint32_t avoidingTicks;
+};
+
+// Point-mass drones tracking commanded velocity with a limited acceleration
+static SimResult simulate(FormationController& formation, uint8_t drones, uint32_t ticks,
+                          uint32_t loseAtTick, FILE* trace, std::mt19937& rng) {
+    std::uniform_real_distribution<float> spread(-400.0f, 400.0f);
+    Vec2 pos[MAX_FORMATION_MEMBERS], vel[MAX_FORMATION_MEMBERS];
+    bool alive[MAX_FORMATION_MEMBERS];
+    for (uint8_t i = 0; i < drones; i++) {
+        pos[i] = Vec2(spread(rng), spread(rng));
+        alive[i] = true;
+        formation.updateMember(i, pos[i], vel[i], 0);
+    }
+
+    const float dt = FORMATION_CONTROL_INTERVAL_MS / 1000.0f;
+    const float maxAccel = 6.0f;
+    SimResult result = {1e9f, 0, 0};
+    VelocityCommand commands[MAX_FORMATION_MEMBERS];
+
+    for (uint32_t t = 0; t < ticks; t++) {
+        uint32_t now = t * FORMATION_CONTROL_INTERVAL_MS;
+        if (t == loseAtTick) {
+            alive[0] = false;
+            formation.removeMember(0);
+        }
+
+        uint8_t n = formation.tick(commands, MAX_FORMATION_MEMBERS);
+        for (uint8_t c = 0; c < n; c++) {
+            uint8_t id = commands[c].droneId;
+            Vec2 dv = commands[c].velocity - vel[id];
+            float mag = sqrtf(dv * dv);
+            if (mag > maxAccel * dt) dv = dv * (maxAccel * dt / mag);
+            vel[id] = vel[id] + dv;
+            if (commands[c].avoiding) result.avoidingTicks++;
+            if (trace) {
+                fprintf(trace, "%lu,%d,%.2f,%.2f,%.2f,%.2f,%d\n", (unsigned long)t, id, pos[id].x, pos[id].y,
+                        vel[id].x, vel[id].y, commands[c].slot);
+            }
+        }
+        for (uint8_t i = 0; i < drones; i++) {
+            if (!alive[i]) continue;
+            pos[i] = pos[i] + vel[i] * dt;
+            formation.updateMember(i, pos[i], vel[i], now);
+        }
+        for (uint8_t a = 0; a < drones; a++) {
+            for (uint8_t b = a + 1; b < drones; b++) {
+                if (!alive[a] || !alive[b]) continue;
+                Vec2 gap = pos[a] - pos[b];
+                result.closest = fminf(result.closest, sqrtf(gap * gap));
+            }
+        }
+    }
+
+    for (uint8_t i = 0; i < drones; i++) {
+        if (!alive[i]) continue;
+        Vec2 err = formation.getSlotPosition(formation.getMember(i)->slot) - pos[i];
+        result.finalError = fmaxf(result.finalError, sqrtf(err * err));
+    }
+    return result;
+}
+
+void test_simulation_replay_converges_without_collisions() {
+    const char* tracePath = getenv("FORMATION_TRACE");
+    FILE* trace = tracePath ? fopen(tracePath, "w") : nullptr;
+    if (trace) fprintf(trace, "tick,drone,x,y,vx,vy,slot\n");
+
+    std::mt19937 rng(2024);
+    FormationController formation(FORMATION_WEDGE);
+    formation.setAnchor(Vec2(0, 0), 0.5f);
+    // Five minutes of flight; drone 0 drops out after the formation settles
+    SimResult result = simulate(formation, 20, 3000, 1500, trace, rng);
+    if (trace) fclose(trace);
+
+    FormationStats stats = formation.getStats();
+    printf("[SIM] 20 drones: closest approach %.2f m, final slot error %.2f m, %lu avoiding commands\n",
+           result.closest, result.finalError, (unsigned long)result.avoidingTicks);
+    printf("[SIM]    %lu full solves, %lu incremental repairs, max tick %lu us\n",
+           (unsigned long)stats.fullSolves, (unsigned long)stats.incrementalRepairs,
+           (unsigned long)stats.maxTickUs);
+
+    TEST_ASSERT_GREATER_OR_EQUAL(2 * DRONE_SAFETY_RADIUS_M * 0.9f, result.closest);
+    TEST_ASSERT_LESS_THAN(FORMATION_SETTLE_TOLERANCE_M, result.finalError);
+    TEST_ASSERT_EQUAL(1, stats.incrementalRepairs);
+}
+
+static double microsSince(std::chrono::steady_clock::time_point start, int iterations) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+void benchmark_control_tick() {
+    printf("[BENCH] formation control (budget %d us per tick):\n", FORMATION_TICK_BUDGET_US);
+    for (uint8_t drones : {5, 20, 50}) {
+        std::mt19937 rng(drones);
+        FormationController formation(FORMATION_GRID);
+        // Measured mid-transit, while ORCA is still busy
+        simulate(formation, drones, 30, 0xFFFFFFFF, nullptr, rng);
+
+        VelocityCommand commands[MAX_FORMATION_MEMBERS];
+        const int iterations = 2000 / drones + 20;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) formation.tick(commands, MAX_FORMATION_MEMBERS);
+        double allUs = microsSince(t0, iterations);
+
+        // What one drone runs on board
+        t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations * 10; i++) formation.computeCommand(i % drones, commands[0]);
+        double oneUs = microsSince(t0, iterations * 10);
+
+        randomCosts(solver, drones, drones, rng);
+        t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < 20; i++) solver.solve();
+        double solveUs = microsSince(t0, 20);
+
+        double repairUs = 0;
+        for (int i = 0; i < 20; i++) {
+            solver.solve();
+            auto r0 = std::chrono::steady_clock::now();
+            solver.removeRow(i % drones);
+            repairUs += microsSince(r0, 1);
+        }
+        repairUs /= 20;
+
+        printf("[BENCH]    %2d drones: swarm tick %.1f us, own command %.2f us, full assignment %.1f us, "
+               "loss repair %.1f us\n", drones, allUs, oneUs, solveUs, repairUs);
+        TEST_ASSERT_LESS_THAN(FORMATION_TICK_BUDGET_US, oneUs);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_hungarian_matches_brute_force);
+    RUN_TEST(test_incremental_removal_matches_full_solve);
+    RUN_TEST(test_slots_respect_spacing);
+    RUN_TEST(test_orca_head_on_pair_passes_safely);
+    RUN_TEST(test_heartbeat_positions_and_expiry);
+    RUN_TEST(test_simulation_replay_converges_without_collisions);
+    RUN_TEST(benchmark_control_tick);
+    return UNITY_END();
+}
@@ -0,0 +1,479 @@
+// Ground station multiplexer tests: the stream decoder against any split of
+// a mixed text/tap stream, corrupt records, the shared-memory ring with a
+// lagging viewer, status telemetry decoded from a requester's tap, and 64
+// pty fake drones through epoll to a viewer with throughput and latency
+// Run with: pio test -e native -f test_ground_station
+
+#include <unity.h>
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "../../include/ground_station/serial_mux.h"
+#include "../../include/communications/status_service.h"
+#include "../../include/communications/peer_table.h"
+
+void setUp() {}
+void tearDown() {}
+
+static std::string shmName(const char* what) {
+    return std::string("/ground_test_") + what + "_" + std::to_string(getpid());
+}
+
+static DroneMessage heartbeatFrame(uint8_t source, uint16_t sequence, float latitude, float longitude) {
+    DroneMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.messageType = MSG_HEARTBEAT;
+    msg.sourceId = source;
+    msg.destinationId = 0xFF;
+    msg.sequenceNumber = sequence;
+    HeartbeatData heartbeat;
+    heartbeat.droneId = source;
+    heartbeat.batteryLevel = 87.5f;
+    heartbeat.latitude = latitude;
+    heartbeat.longitude = longitude;
+    heartbeat.status = 0;
+    heartbeat.missionState = 2;
+    memcpy(msg.data, &heartbeat, sizeof(heartbeat));
+    msg.dataLength = sizeof(heartbeat);
+    msg.checksum = droneMessageChecksum(msg);
+    return msg;
+}
+
+static void append(std::vector<uint8_t>& out, const char* text) {
+    out.insert(out.end(), text, text + strlen(text));
+}
+
+static void appendFrame(std::vector<uint8_t>& out, bool transmitted, const DroneMessage& msg, int16_t rssi = 0,
+                        float snr = 0, uint32_t deltaMs = 0) {
+    uint8_t record[SERIAL_TAP_MAX_BYTES];
+    uint32_t length = serialTapEncodeFrame(transmitted, msg, rssi, snr, deltaMs, record);
+    out.insert(out.end(), record, record + length);
+}
+
+// ===== Decoder =====
+
+struct Decoded {
+    std::vector<std::string> lines;
+    std::vector<std::vector<uint8_t>> records;      // kind, then body
+    uint32_t truncated = 0;
+};
+
+static void collectLine(const char* line, size_t length, bool truncated, void* context) {
+    Decoded* decoded = (Decoded*)context;
+    decoded->lines.push_back(std::string(line, length));
+    decoded->truncated += truncated;
+}
+
+static void collectRecord(const FlightRecordView& record, void* context) {
+    Decoded* decoded = (Decoded*)context;
+    std::vector<uint8_t> bytes(record.body, record.body + record.length);
+    bytes.insert(bytes.begin(), record.kind);
+    decoded->records.push_back(bytes);
+}
+
+static std::vector<uint8_t> mixedStream() {
+    std::vector<uint8_t> stream;
+    append(stream, "[COMM] LoRa initialized successfully\r\n");
+    append(stream, "[COMM] Node ID: 7 (config drone_7)\r\n");
+    uint8_t record[SERIAL_TAP_MAX_BYTES];
+    uint32_t length = serialTapEncodeBoot(7, 1, 1234, record);
+    stream.insert(stream.end(), record, record + length);
+    append(stream, "\n[TX] \xF0\x9F\x93\xA1 Sending heartbeat #1\n");
+    appendFrame(stream, true, heartbeatFrame(7, 1, 28.7041f, -77.1025f), 0, 0, 5);
+    append(stream, "[COMM] Message sent successfully (seq: 1)\n");
+    appendFrame(stream, false, heartbeatFrame(3, 99, 28.7f, -77.1f), -97, -7.25f, 40);
+    // A line cut by a record, a torn record, a stray sync byte
+    append(stream, "   RSSI: -97 dBm");
+    appendFrame(stream, false, heartbeatFrame(4, 5, 28.6f, -77.0f), -80, 6.0f, 1);
+    append(stream, " (good)\n");
+    std::vector<uint8_t> torn;
+    appendFrame(torn, false, heartbeatFrame(5, 6, 1, 1), -70, 0, 0);
+    torn[torn.size() - 1] ^= 0x55;
+    stream.insert(stream.end(), torn.begin(), torn.end());
+    append(stream, "\n[COMM] after the torn record\n\x1E");
+    append(stream, "[COMM] after a stray sync byte\n");
+    stream.insert(stream.end(), GROUND_LINE_MAX + 10, 'x');
+    append(stream, "\n[END]\n");
+    return stream;
+}
+
+static Decoded decodeInPieces(const std::vector<uint8_t>& stream, std::mt19937& rng, uint32_t maxPiece) {
+    StreamDecoder decoder;
+    Decoded decoded;
+    std::uniform_int_distribution<uint32_t> piece(1, maxPiece);
+    for (size_t at = 0; at < stream.size();) {
+        size_t length = std::min<size_t>(piece(rng), stream.size() - at);
+        decoder.feed(stream.data() + at, length, collectLine, collectRecord, &decoded);
+        at += length;
+    }
+    TEST_ASSERT_TRUE(decoder.getStats().bytes == stream.size());
+    TEST_ASSERT_TRUE(decoder.getStats().lines == decoded.lines.size());
+    return decoded;
+}
+
+static void test_decoder_any_split() {
+    std::vector<uint8_t> stream = mixedStream();
+    std::mt19937 rng(3);
+    Decoded whole = decodeInPieces(stream, rng, (uint32_t)stream.size());
+
+    TEST_ASSERT_EQUAL(4, whole.records.size());
+    TEST_ASSERT_EQUAL(FLIGHT_BOOT, whole.records[0][0]);
+    TEST_ASSERT_EQUAL(FLIGHT_TX, whole.records[1][0]);
+    TEST_ASSERT_EQUAL(FLIGHT_RX, whole.records[2][0]);
+    TEST_ASSERT_EQUAL_STRING("[COMM] Node ID: 7 (config drone_7)", whole.lines[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("", whole.lines[2].c_str());
+    TEST_ASSERT_EQUAL_STRING("   RSSI: -97 dBm", whole.lines[5].c_str());
+    TEST_ASSERT_EQUAL_STRING(" (good)", whole.lines[6].c_str());
+    TEST_ASSERT_TRUE(std::find(whole.lines.begin(), whole.lines.end(), "[COMM] after the torn record") !=
+                     whole.lines.end());
+    TEST_ASSERT_TRUE(std::find(whole.lines.begin(), whole.lines.end(), "[COMM] after a stray sync byte") !=
+                     whole.lines.end());
+    TEST_ASSERT_EQUAL_STRING("[END]", whole.lines.back().c_str());
+    TEST_ASSERT_EQUAL(1, whole.truncated);
+
+    for (uint32_t maxPiece : {1u, 2u, 7u, 64u}) {
+        for (uint32_t round = 0; round < 20; round++) {
+            Decoded pieces = decodeInPieces(stream, rng, maxPiece);
+            TEST_ASSERT_TRUE(pieces.lines == whole.lines);
+            TEST_ASSERT_TRUE(pieces.records == whole.records);
+        }
+    }
+}
+
+// ===== Shared memory =====
+
+static void test_shared_memory_ring() {
+    std::string name = shmName("ring");
+    SwarmStateWriter writer;
+    TEST_ASSERT_TRUE(writer.create(name.c_str(), 10));     // Rounded to 16
+
+    SwarmViewer viewer;
+    TEST_ASSERT_TRUE(viewer.attach(name.c_str()));
+    SwarmViewer late;
+
+    SwarmEvent event;
+    memset(&event, 0, sizeof(event));
+    event.kind = SWARM_EVENT_LINE;
+    for (uint32_t i = 0; i < 10; i++) {
+        event.receivedNs = i;
+        writer.publish(event);
+    }
+    const SwarmEvent* seen;
+    for (uint32_t i = 0; i < 10; i++) {
+        TEST_ASSERT_TRUE(viewer.next(seen));
+        TEST_ASSERT_TRUE(seen->receivedNs == i);
+        TEST_ASSERT_TRUE(viewer.confirm());
+    }
+    TEST_ASSERT_FALSE(viewer.next(seen));
+
+    // 40 more while the viewer looks away: it gets the newest 16
+    for (uint32_t i = 10; i < 50; i++) {
+        event.receivedNs = i;
+        writer.publish(event);
+    }
+    TEST_ASSERT_TRUE(viewer.next(seen));
+    TEST_ASSERT_TRUE(seen->receivedNs == 34);
+    TEST_ASSERT_TRUE(viewer.getLost() == 24);
+    // Overwritten while it is read
+    event.receivedNs = 50;
+    writer.publish(event);
+    TEST_ASSERT_FALSE(viewer.confirm());
+    TEST_ASSERT_TRUE(viewer.getLost() == 25);
+    TEST_ASSERT_TRUE(viewer.next(seen));
+    TEST_ASSERT_TRUE(seen->receivedNs == 35);
+
+    // A second viewer from the newest event on
+    TEST_ASSERT_TRUE(late.attach(name.c_str(), true));
+    TEST_ASSERT_FALSE(late.next(seen));
+
+    SwarmDrone drone;
+    memset(&drone, 0, sizeof(drone));
+    drone.id = 9;
+    drone.known = true;
+    drone.latitude = 28.5f;
+    uint64_t generation = viewer.generation();
+    writer.writeDrone(9, drone);
+    TEST_ASSERT_TRUE(viewer.generation() > generation);
+    SwarmDrone read;
+    TEST_ASSERT_TRUE(viewer.readDrone(9, read));
+    TEST_ASSERT_TRUE(read.known);
+    TEST_ASSERT_EQUAL_FLOAT(28.5f, read.latitude);
+    TEST_ASSERT_TRUE(viewer.readDrone(10, read));
+    TEST_ASSERT_FALSE(read.known);
+
+    writer.close();
+    SwarmViewer gone;
+    TEST_ASSERT_FALSE(gone.attach(name.c_str()));
+}
+
+// ===== Status telemetry through the tap =====
+
+static void test_status_telemetry() {
+    std::string name = shmName("status");
+    SerialMuxOptions options = serialMuxDefaults();
+    options.shmName = name.c_str();
+    options.ringSlots = 1024;
+    static SerialMux mux;
+    TEST_ASSERT_TRUE(mux.begin(options));
+    int pair[2];
+    TEST_ASSERT_EQUAL(0, pipe(pair));
+    TEST_ASSERT_EQUAL(0, mux.addDescriptor(pair[0], "drone_1"));
+
+    // Drone 2 hears drone 3; drone 1 asks drone 2 for its status over the air
+    static PeerTable peers;
+    HeartbeatData heartbeat = {3, 90.0f, 28.7f, -77.1f, 0, 1};
+    peers.update(heartbeat, -91, 5.25f, 1000);
+    static StatusService status(2, &perfMonitor, &peers);
+    DroneMessage request;
+    buildStatusRequest(1, 2, 1, 2000, STATUS_TELEMETRY_DELTA, 0, request);
+    CommStats comm;
+    memset(&comm, 0, sizeof(comm));
+    comm.uptime = 2000;
+    DroneMessage replies[STATUS_MAX_FRAMES];
+    uint8_t frames = status.handleRequest(request, comm, 2000, replies);
+    TEST_ASSERT_TRUE(frames > 0);
+
+    std::vector<uint8_t> stream;
+    uint8_t record[SERIAL_TAP_MAX_BYTES];
+    uint32_t length = serialTapEncodeBoot(1, 0, 0, record);
+    stream.insert(stream.end(), record, record + length);
+    appendFrame(stream, true, request);
+    for (uint8_t i = 0; i < frames; i++) {
+        appendFrame(stream, false, replies[i], -85, 7.5f, 30);
+    }
+    TEST_ASSERT_EQUAL((ssize_t)stream.size(), write(pair[1], stream.data(), stream.size()));
+    while (mux.poll(100) > 0 && mux.getStats().frames < 1u + frames) {
+    }
+
+    TEST_ASSERT_TRUE(mux.getStats().frames == 1u + frames);
+    TEST_ASSERT_EQUAL(0, mux.getDrone(1).stream);
+    TEST_ASSERT_EQUAL(1, mux.getDrone(2).peerCount);
+    const SwarmLink& heard = mux.getLink(1, 2);
+    TEST_ASSERT_TRUE(heard.frames == frames);
+    TEST_ASSERT_EQUAL(-85, heard.rssi);
+    TEST_ASSERT_EQUAL(30, heard.snrQuarterDb);
+    const SwarmLink& reported = mux.getLink(2, 3);
+    TEST_ASSERT_TRUE(reported.fromTelemetry);
+    TEST_ASSERT_EQUAL(-91, reported.rssi);
+    TEST_ASSERT_EQUAL(21, reported.snrQuarterDb);
+
+    // The viewer's copy agrees
+    SwarmViewer viewer;
+    TEST_ASSERT_TRUE(viewer.attach(name.c_str()));
+    SwarmLink shared;
+    TEST_ASSERT_TRUE(viewer.readLink(2, 3, shared));
+    TEST_ASSERT_EQUAL(-91, shared.rssi);
+    SwarmStream wired;
+    TEST_ASSERT_TRUE(viewer.readStream(0, wired));
+    TEST_ASSERT_EQUAL(1, wired.node);
+    TEST_ASSERT_TRUE(wired.records == 2u + frames);
+
+    close(pair[1]);
+    mux.poll(100);
+    TEST_ASSERT_EQUAL(0, mux.getStats().openStreams);
+    TEST_ASSERT_TRUE(viewer.readStream(0, wired));
+    TEST_ASSERT_FALSE(wired.open);
+    mux.end();
+}
+
+// ===== 64 fake drones on ptys =====
+
+#define PTY_DRONES 64
+#define PTY_SECONDS 3
+#define PTY_FRAMES_PER_SECOND 100       // Per drone, plus a log line each; ~11 KB/s, so 115200 baud would carry it
+
+struct FakeDrone {
+    int master;
+    uint8_t id;
+    uint16_t sequence;
+    uint32_t sent;
+};
+
+static int openPty(std::string& slave) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    TEST_ASSERT_TRUE(master >= 0);
+    TEST_ASSERT_EQUAL(0, grantpt(master));
+    TEST_ASSERT_EQUAL(0, unlockpt(master));
+    slave = ptsname(master);
+    return master;
+}
+
+static void writeAll(int fd, const std::vector<uint8_t>& bytes) {
+    size_t at = 0;
+    while (at < bytes.size()) {
+        ssize_t wrote = write(fd, bytes.data() + at, bytes.size() - at);
+        if (wrote <= 0) {
+            return;
+        }
+        at += (size_t)wrote;
+    }
+}
+
+static void test_pty_swarm() {
+    std::string name = shmName("pty");
+    SerialMuxOptions options = serialMuxDefaults();
+    options.shmName = name.c_str();
+    static SerialMux mux;
+    TEST_ASSERT_TRUE(mux.begin(options));
+
+    std::vector<FakeDrone> drones(PTY_DRONES);
+    for (uint8_t i = 0; i < PTY_DRONES; i++) {
+        std::string slave;
+        drones[i].master = openPty(slave);
+        drones[i].id = (uint8_t)(i + 1);
+        drones[i].sequence = 0;
+        drones[i].sent = 0;
+        TEST_ASSERT_EQUAL(i, mux.addDevice(slave.c_str()));
+    }
+
+    // Viewer: another thread, attached like a separate process would be
+    SwarmViewer viewer;
+    TEST_ASSERT_TRUE(viewer.attach(name.c_str()));
+    std::atomic<bool> running(true);
+    std::atomic<bool> drained(false);
+    std::vector<uint64_t> latencies;
+    uint64_t viewerFrames = 0;
+    std::thread viewing([&]() {
+        const SwarmEvent* event;
+        while (running.load() || viewer.backlog() > 0) {
+            if (!viewer.next(event)) {
+                usleep(200);
+                continue;
+            }
+            if (event->kind == SWARM_EVENT_FRAME && (event->flags & SWARM_FLAG_TX)) {
+                uint64_t sentNs;
+                memcpy(&sentNs, event->frame.data + sizeof(HeartbeatData), sizeof(sentNs));
+                uint64_t now = swarmClockNs();
+                if (viewer.confirm()) {
+                    latencies.push_back(now - sentNs);
+                    viewerFrames++;
+                }
+            } else {
+                viewer.confirm();
+            }
+        }
+    });
+
+    // Fake drones: one writer thread paces all of them; each second every
+    // drone sends heartbeats and hears its two neighbours' previous ones
+    std::thread writing([&]() {
+        uint8_t record[SERIAL_TAP_MAX_BYTES];
+        for (FakeDrone& drone : drones) {
+            std::vector<uint8_t> boot(record, record + serialTapEncodeBoot(drone.id, 1, 0, record));
+            append(boot, "[COMM] LoRa initialized successfully\n");
+            writeAll(drone.master, boot);
+        }
+        uint64_t started = swarmClockNs();
+        uint64_t tickNs = 1000000000ull / PTY_FRAMES_PER_SECOND;
+        for (uint32_t tick = 0; tick < PTY_SECONDS * PTY_FRAMES_PER_SECOND; tick++) {
+            while (swarmClockNs() < started + tick * tickNs) {
+                usleep(100);
+            }
+            for (FakeDrone& drone : drones) {
+                std::vector<uint8_t> bytes;
+                DroneMessage msg = heartbeatFrame(drone.id, ++drone.sequence, 28.0f + drone.id * 0.001f,
+                                                  -77.0f - tick * 0.0001f);
+                uint64_t now = swarmClockNs();
+                memcpy(msg.data + sizeof(HeartbeatData), &now, sizeof(now));
+                msg.dataLength = sizeof(HeartbeatData) + sizeof(now);
+                msg.checksum = droneMessageChecksum(msg);
+                append(bytes, "[COMM] Sending message type 0x01 to drone 255\n");
+                appendFrame(bytes, true, msg, 0, 0, 10);
+                uint8_t left = drone.id == 1 ? PTY_DRONES : drone.id - 1;
+                uint8_t right = drone.id == PTY_DRONES ? 1 : drone.id + 1;
+                appendFrame(bytes, false, heartbeatFrame(left, (uint16_t)tick, 28.0f + left * 0.001f, -77.0f), -90,
+                            2.5f, 1);
+                appendFrame(bytes, false, heartbeatFrame(right, (uint16_t)tick, 28.0f + right * 0.001f, -77.0f),
+                            -100, -6.0f, 1);
+                writeAll(drone.master, bytes);
+                drone.sent++;
+            }
+        }
+        // Half the drones unplugged, once the mux has read everything: a
+        // pty hangup discards what the other side has not read yet
+        while (!drained.load()) {
+            usleep(1000);
+        }
+        for (uint8_t i = 0; i < PTY_DRONES; i += 2) {
+            close(drones[i].master);
+            drones[i].master = -1;
+        }
+    });
+
+    uint64_t expected = (uint64_t)PTY_DRONES * PTY_SECONDS * PTY_FRAMES_PER_SECOND * 3;
+    uint64_t started = swarmClockNs();
+    struct timespec cpu;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+    double cpuStarted = cpu.tv_sec + cpu.tv_nsec / 1e9;
+    while (mux.getStats().frames < expected || mux.getStats().openStreams > PTY_DRONES / 2) {
+        mux.poll(50);
+        if (mux.getStats().frames >= expected) {
+            drained.store(true);
+        }
+        if (swarmClockNs() - started > (PTY_SECONDS + 20) * 1000000000ull) {
+            break;
+        }
+    }
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+    double cpuSeconds = cpu.tv_sec + cpu.tv_nsec / 1e9 - cpuStarted;
+    drained.store(true);
+    writing.join();
+    running.store(false);
+    viewing.join();
+
+    SerialMuxStats stats = mux.getStats();
+    TEST_ASSERT_TRUE(stats.frames == expected);
+    TEST_ASSERT_TRUE(stats.corrupt == 0);
+    TEST_ASSERT_EQUAL(PTY_DRONES / 2, stats.openStreams);
+    TEST_ASSERT_TRUE(viewer.getLost() == 0);
+    TEST_ASSERT_TRUE(viewerFrames == (uint64_t)PTY_DRONES * PTY_SECONDS * PTY_FRAMES_PER_SECOND);
+
+    // Tables: every drone wired to its stream, last heartbeat position,
+    // both neighbour links
+    for (uint8_t i = 0; i < PTY_DRONES; i++) {
+        const SwarmDrone& drone = mux.getDrone(drones[i].id);
+        TEST_ASSERT_EQUAL(i, drone.stream);
+        TEST_ASSERT_FLOAT_WITHIN(1e-4f, 28.0f + drones[i].id * 0.001f, drone.latitude);
+        TEST_ASSERT_TRUE(drone.framesSent == drones[i].sent);
+        uint8_t left = drones[i].id == 1 ? PTY_DRONES : drones[i].id - 1;
+        const SwarmLink& link = mux.getLink(drones[i].id, left);
+        TEST_ASSERT_TRUE(link.frames == drones[i].sent);
+        TEST_ASSERT_EQUAL(-90, link.rssi);
+        TEST_ASSERT_EQUAL(10, link.snrQuarterDb);
+    }
+    SwarmStream unplugged;
+    TEST_ASSERT_TRUE(viewer.readStream(0, unplugged));
+    TEST_ASSERT_FALSE(unplugged.open);
+
+    std::sort(latencies.begin(), latencies.end());
+    uint64_t p50 = latencies[latencies.size() / 2];
+    uint64_t p99 = latencies[latencies.size() * 99 / 100];
+    double megabytes = stats.bytes / 1e6;
+    printf("[BENCH] %u pty streams, %u s: %.2f MB, %llu frames, %llu lines, %llu reads in %llu wakeups\n",
+           PTY_DRONES, PTY_SECONDS, megabytes, (unsigned long long)stats.frames, (unsigned long long)stats.lines,
+           (unsigned long long)stats.reads, (unsigned long long)stats.wakeups);
+    printf("[BENCH]   mux CPU %.2f s (%.0f frames per CPU second); write to viewer p50 %.2f ms, p99 %.2f ms\n",
+           cpuSeconds, cpuSeconds > 0 ? stats.frames / cpuSeconds : 0.0, p50 / 1e6, p99 / 1e6);
+    TEST_ASSERT_TRUE(p99 < 500000000ull);
+
+    for (FakeDrone& drone : drones) {
+        if (drone.master >= 0) close(drone.master);
+    }
+    mux.end();
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_decoder_any_split);
+    RUN_TEST(test_shared_memory_ring);
+    RUN_TEST(test_status_telemetry);
+    RUN_TEST(test_pty_swarm);
+    return UNITY_END();
+}
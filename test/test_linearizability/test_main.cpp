@@ -0,0 +1,515 @@
+// History checker tests: textbook linearizable and non-linearizable
+// register histories, responses that never came, mutex histories, the hybrid
+// clock, a saved history read back, 1M-operation histories across keys and
+// on one key (1 and 4 threads), and the checks as post-run assertions on a
+// simulated leader-held register and lease mutex over the LoRa channel
+// Run with: pio test -e native -f test_linearizability
+
+#include <unity.h>
+#include <deque>
+#include <stdlib.h>
+#include <unistd.h>
+#include "../../include/ground_station/history_checker.h"
+#include "../../include/simulation/radio_sim.h"
+
+void setUp() {}
+void tearDown() {}
+
+static HistoryOp operation(uint16_t client, uint8_t kind, uint64_t call, uint64_t ret, int64_t input, int64_t output,
+                           uint32_t key = 0) {
+    HistoryOp op;
+    memset(&op, 0, sizeof(op));
+    op.call = hybridTime(call, 0);
+    op.ret = ret == UINT64_MAX ? HYBRID_PENDING : hybridTime(ret, 0);
+    op.key = key;
+    op.client = client;
+    op.kind = kind;
+    op.known = ret != UINT64_MAX;
+    op.input = input;
+    op.output = output;
+    return op;
+}
+
+static uint8_t verdictOf(const std::vector<HistoryOp>& history) {
+    return checkLinearizable(history).verdict;
+}
+
+static void test_register_histories() {
+    // A read overlapping a write may see either value
+    std::vector<HistoryOp> h = {
+        operation(1, HISTORY_WRITE, 0, 10, 1, 0),
+        operation(2, HISTORY_READ, 5, 15, 0, 1),
+        operation(3, HISTORY_READ, 2, 8, 0, 0),
+    };
+    TEST_ASSERT_EQUAL(HISTORY_OK, verdictOf(h));
+
+    // Once the write has returned, a later read must see it
+    h = {
+        operation(1, HISTORY_WRITE, 0, 10, 1, 0),
+        operation(2, HISTORY_READ, 11, 15, 0, 0),
+    };
+    HistoryCheck check = checkLinearizable(h);
+    TEST_ASSERT_EQUAL(HISTORY_VIOLATION, check.verdict);
+    TEST_ASSERT_EQUAL(1, check.violations);
+    TEST_ASSERT_EQUAL(1, check.failures[0].blockingOp);
+
+    // New value seen, then the old one by a read that started afterwards
+    h = {
+        operation(1, HISTORY_WRITE, 0, 100, 1, 0),
+        operation(2, HISTORY_READ, 10, 20, 0, 1),
+        operation(3, HISTORY_READ, 30, 40, 0, 0),
+    };
+    TEST_ASSERT_EQUAL(HISTORY_VIOLATION, verdictOf(h));
+
+    // Compare-and-swap: only one of two racing swaps from 0 can succeed
+    h = {
+        operation(1, HISTORY_CAS, 0, 10, 5, 1),
+        operation(2, HISTORY_CAS, 0, 10, 6, 1),
+    };
+    TEST_ASSERT_EQUAL(HISTORY_VIOLATION, verdictOf(h));
+    h[1].output = 0;
+    TEST_ASSERT_EQUAL(HISTORY_OK, verdictOf(h));
+
+    // Keys are independent objects
+    h = {
+        operation(1, HISTORY_WRITE, 0, 10, 1, 0, 7),
+        operation(2, HISTORY_READ, 20, 30, 0, 0, 8),
+    };
+    TEST_ASSERT_EQUAL(HISTORY_OK, verdictOf(h));
+    TEST_ASSERT_EQUAL(2, checkLinearizable(h).keys);
+}
+
+static void test_missing_responses() {
+    // A write whose reply was lost may have taken effect, any time after its call
+    std::vector<HistoryOp> h = {
+        operation(1, HISTORY_WRITE, 0, UINT64_MAX, 3, 0),
+        operation(2, HISTORY_READ, 50, 60, 0, 3),
+        operation(2, HISTORY_READ, 70, 80, 0, 3),
+    };
+    TEST_ASSERT_EQUAL(HISTORY_OK, verdictOf(h));
+    // ... or not at all
+    h[1].output = h[2].output = 0;
+    TEST_ASSERT_EQUAL(HISTORY_OK, verdictOf(h));
+    // But once seen it stays
+    h[1].output = 3;
+    TEST_ASSERT_EQUAL(HISTORY_VIOLATION, verdictOf(h));
+    // Not before it was invoked
+    h = {
+        operation(2, HISTORY_READ, 0, 10, 0, 3),
+        operation(1, HISTORY_WRITE, 20, UINT64_MAX, 3, 0),
+    };
+    TEST_ASSERT_EQUAL(HISTORY_VIOLATION, verdictOf(h));
+}
+
+static void test_mutex_histories() {
+    // 1 holds 10..30, 2 holds 40..60: fine
+    std::vector<HistoryOp> h = {
+        operation(1, HISTORY_ACQUIRE, 0, 10, 0, 0),
+        operation(2, HISTORY_ACQUIRE, 5, 40, 0, 0),
+        operation(1, HISTORY_RELEASE, 30, 35, 0, 0),
+        operation(2, HISTORY_RELEASE, 60, 65, 0, 0),
+    };
+    TEST_ASSERT_EQUAL(HISTORY_OK, verdictOf(h));
+    TEST_ASSERT_EQUAL(0, checkMutualExclusion(h).size());
+
+    // 2 granted while 1 still holds
+    h[1].ret = hybridTime(20, 0);
+    TEST_ASSERT_EQUAL(HISTORY_VIOLATION, verdictOf(h));
+    std::vector<MutexViolation> violations = checkMutualExclusion(h);
+    TEST_ASSERT_EQUAL(1, violations.size());
+    TEST_ASSERT_EQUAL(0, violations[0].first);
+    TEST_ASSERT_EQUAL(1, violations[0].second);
+    TEST_ASSERT_TRUE(violations[0].from == hybridTime(20, 0));
+    TEST_ASSERT_TRUE(violations[0].to == hybridTime(30, 0));
+
+    // A release that was never acknowledged still ends the hold
+    h = {
+        operation(1, HISTORY_ACQUIRE, 0, 10, 0, 0),
+        operation(1, HISTORY_RELEASE, 30, UINT64_MAX, 0, 0),
+        operation(2, HISTORY_ACQUIRE, 5, 40, 0, 0),
+    };
+    TEST_ASSERT_EQUAL(HISTORY_OK, verdictOf(h));
+    TEST_ASSERT_EQUAL(0, checkMutualExclusion(h).size());
+    // Never released: held to the end
+    h.erase(h.begin() + 1);
+    TEST_ASSERT_EQUAL(HISTORY_VIOLATION, verdictOf(h));
+    TEST_ASSERT_EQUAL(1, checkMutualExclusion(h).size());
+}
+
+static void test_hybrid_clock() {
+    HybridClock a, b;
+    HybridTime sent = a.tick(1000);
+    TEST_ASSERT_TRUE(sent == hybridTime(1000, 0));
+    // b's clock is 5 ms behind: its receipt still orders after the send
+    HybridTime received = b.receive(sent, 995);
+    TEST_ASSERT_TRUE(received > sent);
+    TEST_ASSERT_TRUE(received == hybridTime(1000, 1));
+    TEST_ASSERT_TRUE(b.tick(995) == hybridTime(1000, 2));
+    // Physical time takes over once it passes
+    TEST_ASSERT_TRUE(b.tick(1001) == hybridTime(1001, 0));
+    TEST_ASSERT_TRUE(a.tick(1000) == hybridTime(1000, 1));
+}
+
+static void test_history_file_round_trip() {
+    std::vector<HistoryOp> h = {
+        operation(1, HISTORY_WRITE, 0, 10, 1, 0, 3),
+        operation(2, HISTORY_READ, 5, UINT64_MAX, 0, 0, 3),
+        operation(3, HISTORY_CAS, 6, 12, 9, 1, 3),
+        operation(4, HISTORY_ACQUIRE, 20, 25, 0, 0, 4),
+        operation(4, HISTORY_RELEASE, 30, 31, 0, 0, 4),
+    };
+    h[2].expected = 1;
+    h[0].call = hybridTime(0, 7);
+    char path[] = "/tmp/history_XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    close(fd);
+    TEST_ASSERT_TRUE(saveHistory(path, h));
+    std::vector<HistoryOp> loaded;
+    std::string error;
+    TEST_ASSERT_TRUE(loadHistory(path, loaded, &error));
+    unlink(path);
+    TEST_ASSERT_EQUAL(h.size(), loaded.size());
+    for (size_t i = 0; i < h.size(); i++) {
+        TEST_ASSERT_TRUE(loaded[i].call == h[i].call);
+        TEST_ASSERT_TRUE(loaded[i].ret == h[i].ret);
+        TEST_ASSERT_EQUAL(h[i].client, loaded[i].client);
+        TEST_ASSERT_EQUAL(h[i].key, loaded[i].key);
+        TEST_ASSERT_EQUAL(h[i].kind, loaded[i].kind);
+        TEST_ASSERT_EQUAL(h[i].known, loaded[i].known);
+        TEST_ASSERT_TRUE(loaded[i].input == h[i].input);
+        TEST_ASSERT_TRUE(loaded[i].expected == h[i].expected);
+        TEST_ASSERT_TRUE(!h[i].known || loaded[i].output == h[i].output);
+    }
+    TEST_ASSERT_EQUAL(HISTORY_OK, verdictOf(loaded));
+}
+
+// A stale read planted in a synthetic history: a read returning the value
+// before the last write that returned before the read was called
+static uint32_t plantStaleRead(std::vector<HistoryOp>& h) {
+    for (uint32_t i = (uint32_t)h.size() / 2; i < h.size(); i++) {
+        if (h[i].kind != HISTORY_READ) continue;
+        for (uint32_t j = i; j-- > 0;) {
+            if (h[j].key == h[i].key && h[j].kind == HISTORY_WRITE && h[j].ret < h[i].call &&
+                h[j].input == h[i].output) {
+                h[i].output = -1;
+                return h[i].key;
+            }
+        }
+    }
+    return UINT32_MAX;
+}
+
+static void test_million_operations() {
+    struct Case {
+        const char* name;
+        uint16_t clients;
+        uint32_t keys;
+    } cases[] = {{"64 keys", 16, 64}, {"one key", 6, 1}};
+
+    for (const Case& c : cases) {
+        std::vector<HistoryOp> h;
+        synthesizeHistory(1000000, c.clients, c.keys, 11, h);
+        HistoryCheckerOptions options = historyCheckerDefaults();
+        options.threads = 1;
+        HistoryCheck one = checkLinearizable(h, options);
+        options.threads = 4;
+        HistoryCheck four = checkLinearizable(h, options);
+        TEST_ASSERT_EQUAL(HISTORY_OK, one.verdict);
+        TEST_ASSERT_EQUAL(HISTORY_OK, four.verdict);
+        TEST_ASSERT_EQUAL(c.keys, one.keys);
+        TEST_ASSERT_TRUE(one.steps == four.steps);
+        printf("[BENCH] 1M ops, %s, %u clients: %.2f s on 1 thread (%.1fM steps), %.2f s on 4\n", c.name,
+               c.clients, one.seconds, one.steps / 1e6, four.seconds);
+        TEST_ASSERT_TRUE(one.seconds < 30);
+
+        uint32_t key = plantStaleRead(h);
+        TEST_ASSERT_TRUE(key != UINT32_MAX);
+        HistoryCheck bad = checkLinearizable(h, options);
+        TEST_ASSERT_EQUAL(HISTORY_VIOLATION, bad.verdict);
+        TEST_ASSERT_EQUAL(1, bad.violations);
+        TEST_ASSERT_EQUAL(key, bad.failures[0].key);
+        printf("[BENCH]   stale read found on key %u in %.2f s\n", key, bad.seconds);
+    }
+}
+
+// ===== Simulated swarm =====
+
+#define SIM_CLIENTS 4
+#define SIM_SECONDS 600
+#define SIM_REPLY_TIMEOUT_US 2000000ULL
+#define SIM_KEYS 4
+
+enum SimFrameType : uint8_t { SIM_REQUEST = 1, SIM_RESPONSE, SIM_GRANT };
+
+struct SimMessage {
+    uint8_t type;
+    uint8_t client;
+    uint8_t kind;
+    uint8_t key;
+    uint32_t op;
+    int32_t input;
+    int32_t expected;
+    int32_t output;
+    uint64_t stamp;             // Sender's hybrid clock
+};
+
+// Node 0 holds registers and a lease lock for clients 1..SIM_CLIENTS; the
+// history is what the clients saw
+class LeaderSimulation {
+private:
+    RadioSim sim;
+    HybridClock clocks[SIM_CLIENTS + 1];
+    HistoryRecorder recorder;
+    int32_t registers[SIM_KEYS];
+    int32_t cache[SIM_CLIENTS + 1][SIM_KEYS];
+    bool cachedReads;           // The bug: clients answer reads themselves
+
+    // Lock
+    uint8_t holder;
+    uint64_t leaseEndsUs;
+    uint64_t leaseUs;
+    uint64_t holdUs;
+    std::deque<SimMessage> waiting;
+
+    // Client state
+    uint32_t outstanding[SIM_CLIENTS + 1];      // Op awaiting its reply, UINT32_MAX = none
+    uint32_t attempt[SIM_CLIENTS + 1];          // Bumped per op, so stale timeouts do nothing
+    bool lockClients;
+    int32_t nextValue;
+
+    uint64_t nowMs() { return sim.now() / 1000; }
+
+    // Listen before talk, then back off a random 20-100 ms
+    void send(uint8_t node, const SimMessage& msg) {
+        if (sim.isTransmitting(node) || sim.channelBusy(node) || !sim.transmit(node, &msg, sizeof(msg))) {
+            std::uniform_int_distribution<uint64_t> backoff(20000, 100000);
+            sim.after(backoff(sim.rng()), [this, node, msg]() { send(node, msg); });
+        }
+    }
+
+    void scheduleNext(uint8_t client, uint64_t minUs, uint64_t maxUs) {
+        std::uniform_int_distribution<uint64_t> wait(minUs, maxUs);
+        sim.after(wait(sim.rng()), [this, client]() { clientStep(client); });
+    }
+
+    void request(uint8_t client, uint8_t kind, uint8_t key, int32_t input, int32_t expected) {
+        SimMessage msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.type = SIM_REQUEST;
+        msg.client = client;
+        msg.kind = kind;
+        msg.key = key;
+        msg.input = input;
+        msg.expected = expected;
+        msg.stamp = clocks[client].tick(nowMs());
+        msg.op = recorder.invoke(client, lockClients ? SIM_KEYS : key, kind, input, expected, msg.stamp);
+        outstanding[client] = msg.op;
+        uint32_t mine = ++attempt[client];
+        send(client, msg);
+        // No reply: the operation stays pending and the client moves on
+        sim.after(SIM_REPLY_TIMEOUT_US, [this, client, mine]() {
+            if (attempt[client] == mine && outstanding[client] != UINT32_MAX) {
+                outstanding[client] = UINT32_MAX;
+                scheduleNext(client, 100000, 600000);
+            }
+        });
+    }
+
+    void clientStep(uint8_t client) {
+        std::mt19937& rng = sim.rng();
+        if (lockClients) {
+            request(client, HISTORY_ACQUIRE, 0, 0, 0);
+            return;
+        }
+        uint8_t key = rng() % SIM_KEYS;
+        uint32_t pick = rng() % 10;
+        if (pick < 5 && cachedReads) {
+            HybridTime at = clocks[client].tick(nowMs());
+            uint32_t op = recorder.invoke(client, key, HISTORY_READ, 0, 0, at);
+            recorder.complete(op, cache[client][key], clocks[client].tick(nowMs()));
+            scheduleNext(client, 100000, 600000);
+        } else if (pick < 5) {
+            request(client, HISTORY_READ, key, 0, 0);
+        } else if (pick < 9) {
+            request(client, HISTORY_WRITE, key, nextValue++, 0);
+        } else {
+            request(client, HISTORY_CAS, key, nextValue++, cache[client][key]);
+        }
+    }
+
+    void grant(const SimMessage& req) {
+        holder = req.client;
+        leaseEndsUs = sim.now() + leaseUs;
+        SimMessage reply = req;
+        reply.type = SIM_GRANT;
+        reply.stamp = clocks[0].tick(nowMs());
+        send(0, reply);
+        uint8_t granted = holder;
+        sim.after(leaseUs, [this, granted]() {
+            if (holder == granted && sim.now() >= leaseEndsUs) expire();
+        });
+    }
+
+    void expire() {
+        holder = 0;
+        if (!waiting.empty()) {
+            SimMessage next = waiting.front();
+            waiting.pop_front();
+            grant(next);
+        }
+    }
+
+    void leaderReceive(const SimMessage& req) {
+        clocks[0].receive(req.stamp, nowMs());
+        SimMessage reply = req;
+        reply.type = SIM_RESPONSE;
+        switch (req.kind) {
+            case HISTORY_READ:
+                reply.output = registers[req.key];
+                break;
+            case HISTORY_WRITE:
+                registers[req.key] = req.input;
+                break;
+            case HISTORY_CAS:
+                reply.output = registers[req.key] == req.expected;
+                if (reply.output) registers[req.key] = req.input;
+                break;
+            case HISTORY_ACQUIRE:
+                if (holder == req.client) {
+                    grant(req);             // Its grant was lost; the lease restarts
+                } else if (holder == 0) {
+                    grant(req);
+                } else {
+                    waiting.push_back(req);
+                }
+                return;
+            case HISTORY_RELEASE:
+                if (holder == req.client) expire();
+                break;
+        }
+        reply.stamp = clocks[0].tick(nowMs());
+        send(0, reply);
+    }
+
+    void clientReceive(uint8_t client, const SimMessage& reply) {
+        HybridTime at = clocks[client].receive(reply.stamp, nowMs());
+        if (reply.kind == HISTORY_READ || reply.kind == HISTORY_CAS) {
+            cache[client][reply.key] = reply.kind == HISTORY_READ ? reply.output : cache[client][reply.key];
+        }
+        if (reply.op != outstanding[client]) {
+            // A grant for a request already given up: hand the lock straight back
+            if (reply.type == SIM_GRANT) {
+                SimMessage release = reply;
+                release.type = SIM_REQUEST;
+                release.kind = HISTORY_RELEASE;
+                release.stamp = clocks[client].tick(nowMs());
+                release.op = recorder.invoke(client, SIM_KEYS, HISTORY_RELEASE, 0, 0, release.stamp);
+                send(client, release);
+            }
+            return;
+        }
+        outstanding[client] = UINT32_MAX;
+        attempt[client]++;
+        recorder.complete(reply.op, reply.output, at);
+        if (reply.kind == HISTORY_WRITE) {
+            cache[client][reply.key] = reply.input;
+        }
+        if (reply.type == SIM_GRANT) {
+            // Hold, then release
+            sim.after(holdUs, [this, client]() { request(client, HISTORY_RELEASE, 0, 0, 0); });
+        } else {
+            scheduleNext(client, 100000, 600000);
+        }
+    }
+
+public:
+    LeaderSimulation(uint32_t seed, bool lock, bool cached, uint64_t leaseMs, uint64_t holdMs)
+        : sim(SIM_CLIENTS + 1, seed), cachedReads(cached), holder(0), leaseEndsUs(0), leaseUs(leaseMs * 1000),
+          holdUs(holdMs * 1000), lockClients(lock), nextValue(1) {
+        memset(registers, 0, sizeof(registers));
+        memset(cache, 0, sizeof(cache));
+        for (uint8_t i = 0; i <= SIM_CLIENTS; i++) {
+            outstanding[i] = UINT32_MAX;
+            attempt[i] = 0;
+            sim.setPosition(i, (float)(i * 50), 0.0f);
+        }
+        sim.setRange(1000.0f);
+        sim.setPacketReception(0.9f);
+        sim.onReceive([this](uint8_t node, const SimFrame& frame) {
+            SimMessage msg;
+            memcpy(&msg, frame.payload.data(), sizeof(msg));
+            if (node == 0 && msg.type == SIM_REQUEST) {
+                leaderReceive(msg);
+            } else if (node == msg.client && msg.type != SIM_REQUEST) {
+                clientReceive(node, msg);
+            } else if (node != 0 && msg.type == SIM_RESPONSE && msg.kind == HISTORY_WRITE) {
+                // Overheard: what the caching clients serve reads from
+                cache[node][msg.key] = msg.input;
+            }
+        });
+        for (uint8_t c = 1; c <= SIM_CLIENTS; c++) {
+            scheduleNext(c, 0, 500000);
+        }
+    }
+
+    const std::vector<HistoryOp>& run() {
+        sim.run(SIM_SECONDS * 1000000ULL);
+        return recorder.history();
+    }
+};
+
+static uint32_t countPending(const std::vector<HistoryOp>& h) {
+    uint32_t pending = 0;
+    for (const HistoryOp& op : h) pending += op.ret == HYBRID_PENDING;
+    return pending;
+}
+
+static void test_simulated_leader_register() {
+    LeaderSimulation correct(5, false, false, 0, 0);
+    const std::vector<HistoryOp>& h = correct.run();
+    HistoryCheck check = checkLinearizable(h);
+    TEST_ASSERT_EQUAL(HISTORY_OK, check.verdict);
+    TEST_ASSERT_TRUE(h.size() > 1000);
+    TEST_ASSERT_TRUE(countPending(h) > 0);
+    printf("[SIM] leader-held registers, %u clients, %u s at 10%% loss: %u ops (%u unanswered), linearizable\n",
+           SIM_CLIENTS, SIM_SECONDS, (unsigned)h.size(), countPending(h));
+
+    LeaderSimulation cached(5, false, true, 0, 0);
+    const std::vector<HistoryOp>& stale = cached.run();
+    check = checkLinearizable(stale);
+    TEST_ASSERT_EQUAL(HISTORY_VIOLATION, check.verdict);
+    printf("[SIM]   reads served from overheard writes: %u of %u keys flagged, first at op %u\n",
+           check.violations, check.keys, check.failures[0].blockingOp);
+}
+
+static void test_simulated_lease_mutex() {
+    LeaderSimulation correct(9, true, false, 2000, 300);
+    const std::vector<HistoryOp>& h = correct.run();
+    TEST_ASSERT_EQUAL(HISTORY_OK, checkLinearizable(h).verdict);
+    TEST_ASSERT_EQUAL(0, checkMutualExclusion(h).size());
+    TEST_ASSERT_TRUE(h.size() > 500);
+    printf("[SIM] lease mutex, 2000 ms lease, 300 ms hold: %u ops (%u unanswered), exclusive\n",
+           (unsigned)h.size(), countPending(h));
+
+    // A lease shorter than a hold hands the lock over while it is still held
+    LeaderSimulation shortLease(9, true, false, 200, 400);
+    const std::vector<HistoryOp>& bad = shortLease.run();
+    std::vector<MutexViolation> violations = checkMutualExclusion(bad);
+    TEST_ASSERT_TRUE(violations.size() > 0);
+    TEST_ASSERT_EQUAL(HISTORY_VIOLATION, checkLinearizable(bad).verdict);
+    printf("[SIM]   200 ms lease, 400 ms hold: %u overlapping holds\n", (unsigned)violations.size());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_register_histories);
+    RUN_TEST(test_missing_responses);
+    RUN_TEST(test_mutex_histories);
+    RUN_TEST(test_hybrid_clock);
+    RUN_TEST(test_history_file_round_trip);
+    RUN_TEST(test_million_operations);
+    RUN_TEST(test_simulated_leader_register);
+    RUN_TEST(test_simulated_lease_mutex);
+    return UNITY_END();
+}
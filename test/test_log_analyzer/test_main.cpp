@@ -0,0 +1,282 @@
+// Log analyzer tests: capture lines parsed the same whatever the chunk
+// edges, recorder dumps, delivery and latency of synthetic swarms against
+// the generator's own counts (captures and dumps, 1 and 4 threads), and
+// parse throughput on a 128 MB capture set
+// Run with: pio test -e native -f test_log_analyzer
+
+#include <unity.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <dirent.h>
+#include "../../include/ground_station/log_analyzer.h"
+
+void setUp() {}
+void tearDown() {}
+
+static std::string makeDirectory() {
+    char path[] = "/tmp/log_analyzer_XXXXXX";
+    TEST_ASSERT_NOT_NULL(mkdtemp(path));
+    return path;
+}
+
+static void removeDirectory(const std::string& path) {
+    DIR* dir = opendir(path.c_str());
+    if (!dir) return;
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') unlink((path + "/" + entry->d_name).c_str());
+    }
+    closedir(dir);
+    rmdir(path.c_str());
+}
+
+static std::vector<std::string> filesIn(const std::string& path) {
+    std::vector<std::string> files;
+    DIR* dir = opendir(path.c_str());
+    TEST_ASSERT_NOT_NULL(dir);
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') files.push_back(path + "/" + entry->d_name);
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+static const char CAPTURE[] =
+    "12:00:01.000 > [COMM] Node ID: 3 (config drone_3)\n"
+    "12:00:01.100 > [TX] Sending heartbeat #1\n"
+    "12:00:01.100 > [TX]    Location: (28.704100, -77.102500)\n"
+    "12:00:01.101 > [COMM] Sending message type 0x01 to drone 255\n"
+    "12:00:01.102 > [MAC] Listen before talk: clear\n"
+    "12:00:01.140 > [COMM] Message sent successfully (seq: 17)\n"
+    "12:00:01.250 > [COMM] Message received from drone 2 (type: 0x01, seq: 4242)\n"
+    "12:00:01.250 > [COMM] Signal: RSSI=-97 dBm, SNR=-7.5 dB\n"
+    "12:00:01.251 > [RX]       Location: (28.705000, -77.101000)\n"
+    "12:00:02.000 > [COMM] WARNING: Rejected frame from drone 9\n"
+    "12:00:02.100 > [COMM] ERROR: Channel busy, message dropped\n"
+    "[COMM] Message received from drone 4 (type: 0x0A, seq: 7)\n";
+
+static void test_capture_lines_are_parsed() {
+    const char* end = CAPTURE + sizeof(CAPTURE) - 1;
+    std::vector<LogEvent> events;
+    TEST_ASSERT_EQUAL_UINT64(12, parseLogText(CAPTURE, end, CAPTURE, end, events));
+    TEST_ASSERT_EQUAL(8, events.size());
+
+    TEST_ASSERT_EQUAL(LOG_BOOT, events[0].kind);
+    TEST_ASSERT_EQUAL(3, events[0].node);
+    TEST_ASSERT_EQUAL_UINT32(((12 * 60 + 0) * 60 + 1) * 1000, events[0].timeMs);
+
+    TEST_ASSERT_EQUAL(LOG_POSITION, events[1].kind);
+    TEST_ASSERT_EQUAL_INT32(287041000, events[1].latE7);
+    TEST_ASSERT_EQUAL_INT32(-771025000, events[1].lonE7);
+
+    // Type and destination come from the "Sending" line, past the MAC line
+    TEST_ASSERT_EQUAL(LOG_TX, events[2].kind);
+    TEST_ASSERT_EQUAL(0x01, events[2].type);
+    TEST_ASSERT_EQUAL(255, events[2].destination);
+    TEST_ASSERT_EQUAL(17, events[2].sequence);
+
+    TEST_ASSERT_EQUAL(LOG_RX, events[3].kind);
+    TEST_ASSERT_EQUAL(2, events[3].node);
+    TEST_ASSERT_EQUAL(4242, events[3].sequence);
+    TEST_ASSERT_TRUE(events[3].flags & LOG_FLAG_SIGNAL);
+    TEST_ASSERT_EQUAL_INT16(-97, events[3].rssi);
+    TEST_ASSERT_EQUAL_INT8(-30, events[3].snrQuarterDb);
+
+    TEST_ASSERT_EQUAL(LOG_PEER_POSITION, events[4].kind);
+    TEST_ASSERT_EQUAL(LOG_REJECTED, events[5].kind);
+    TEST_ASSERT_EQUAL(LOG_DROPPED, events[6].kind);
+
+    // No time prefix: still parsed, without a time
+    TEST_ASSERT_EQUAL(LOG_RX, events[7].kind);
+    TEST_ASSERT_EQUAL(0x0A, events[7].type);
+    TEST_ASSERT_FALSE(events[7].flags & LOG_FLAG_TIME);
+
+    // One chunk per line: lookback and lookahead cross the chunk edges
+    std::vector<LogEvent> chunked;
+    uint64_t lines = 0;
+    for (const char* line = CAPTURE; line < end;) {
+        const char* next = (const char*)memchr(line, '\n', end - line) + 1;
+        lines += parseLogText(CAPTURE, end, line, next, chunked);
+        line = next;
+    }
+    TEST_ASSERT_EQUAL_UINT64(12, lines);
+    TEST_ASSERT_EQUAL(events.size(), chunked.size());
+    TEST_ASSERT_EQUAL_MEMORY(events.data(), chunked.data(), events.size() * sizeof(LogEvent));
+}
+
+static DroneMessage heartbeatFrame(uint8_t source, uint16_t sequence, uint32_t timestamp, float lat, float lon) {
+    HeartbeatData heartbeat;
+    memset(&heartbeat, 0, sizeof(heartbeat));
+    heartbeat.droneId = source;
+    heartbeat.latitude = lat;
+    heartbeat.longitude = lon;
+    DroneMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.messageType = MSG_HEARTBEAT;
+    msg.sourceId = source;
+    msg.destinationId = 0xFF;
+    msg.timestamp = timestamp;
+    msg.sequenceNumber = sequence;
+    msg.dataLength = sizeof(heartbeat);
+    memcpy(msg.data, &heartbeat, sizeof(heartbeat));
+    return msg;
+}
+
+static void test_dump_records_are_parsed() {
+    RamFlash flash(8 * FLIGHT_SECTOR_BYTES);
+    FlightRecorder recorder;
+    TEST_ASSERT_TRUE(recorder.begin(&flash, 5, 1, 1000));
+    TEST_ASSERT_TRUE(recorder.recordFrame(true, heartbeatFrame(5, 10, 2000, 28.7f, 77.1f), 0, 0, 2000));
+    TEST_ASSERT_TRUE(recorder.recordFrame(false, heartbeatFrame(6, 99, 51234, 28.71f, 77.11f), -88, 6.25f, 2130));
+    recorder.flush();
+
+    FlightLog log;
+    log.attach(flash.image(), flash.size());
+    std::vector<LogEvent> events;
+    parseLogDump(log, 0, log.sectorCount(), events);
+    TEST_ASSERT_EQUAL(5, events.size());
+    TEST_ASSERT_EQUAL(LOG_BOOT, events[0].kind);
+    TEST_ASSERT_EQUAL(5, events[0].node);
+    TEST_ASSERT_EQUAL(LOG_TX, events[1].kind);
+    TEST_ASSERT_EQUAL_UINT32(2000, events[1].timeMs);
+    TEST_ASSERT_EQUAL_UINT32(2000, events[1].frameTime);
+    TEST_ASSERT_EQUAL(LOG_POSITION, events[2].kind);
+    TEST_ASSERT_INT32_WITHIN(20, 287000000, events[2].latE7);
+    TEST_ASSERT_EQUAL(LOG_RX, events[3].kind);
+    TEST_ASSERT_EQUAL(6, events[3].node);
+    TEST_ASSERT_EQUAL(99, events[3].sequence);
+    TEST_ASSERT_EQUAL_UINT32(51234, events[3].frameTime);
+    TEST_ASSERT_EQUAL_INT16(-88, events[3].rssi);
+    TEST_ASSERT_EQUAL_INT8(25, events[3].snrQuarterDb);
+    TEST_ASSERT_EQUAL(LOG_PEER_POSITION, events[4].kind);
+
+    // Analyzed as a file of its own: one drone, one TX nobody else logged
+    LogAnalyzer analyzer;
+    analyzer.addBuffer("dump", flash.image(), flash.size());
+    LogAnalysis analysis = analyzer.run();
+    TEST_ASSERT_EQUAL(1, analysis.drones.size());
+    TEST_ASSERT_EQUAL(5, analysis.drones[0].node);
+    TEST_ASSERT_EQUAL_UINT64(1, analysis.drones[0].tx);
+    TEST_ASSERT_EQUAL_UINT64(1, analysis.drones[0].rx);
+    TEST_ASSERT_EQUAL_UINT64(1, analysis.unjoined);
+}
+
+static const LogLinkReport* findLink(const LogAnalysis& analysis, uint8_t source, uint8_t receiver) {
+    for (const LogLinkReport& link : analysis.links) {
+        if (link.source == source && link.receiver == receiver) return &link;
+    }
+    return nullptr;
+}
+
+static LogAnalysis analyze(const std::string& directory, uint8_t threads) {
+    LogAnalyzerOptions options = logAnalyzerDefaults();
+    options.threads = threads;
+    // Small chunks and waves, so files span many of each
+    options.chunkBytes = 64 * 1024;
+    options.sectorsPerChunk = 16;
+    options.chunksPerWave = 2;
+    LogAnalyzer analyzer(options);
+    for (const std::string& file : filesIn(directory)) {
+        TEST_ASSERT_TRUE(analyzer.addFile(file.c_str()));
+    }
+    return analyzer.run();
+}
+
+static void checkAgainstTruth(bool dumps) {
+    std::string directory = makeDirectory();
+    LogSynthesisOptions synthesis = {6, dumps, 6u << 20, 42};
+    LogSynthesisTruth truth;
+    TEST_ASSERT_TRUE(synthesizeLogs(directory.c_str(), synthesis, &truth));
+
+    LogAnalysis one = analyze(directory, 1);
+    LogAnalysis four = analyze(directory, 4);
+    TEST_ASSERT_EQUAL_UINT64(0, one.ambiguous);
+    TEST_ASSERT_EQUAL_UINT64(0, one.unjoined);
+    TEST_ASSERT_EQUAL_UINT64(0, one.unattributed);
+    TEST_ASSERT_EQUAL(6, one.drones.size());
+
+    uint64_t sent = 0, delivered = 0;
+    float worstP50 = 0;
+    for (uint8_t s = 1; s <= 6; s++) {
+        for (uint8_t r = 1; r <= 6; r++) {
+            if (s == r) continue;
+            const LogLinkReport* link = findLink(one, s, r);
+            const LogLinkReport* same = findLink(four, s, r);
+            TEST_ASSERT_NOT_NULL(link);
+            TEST_ASSERT_NOT_NULL(same);
+            TEST_ASSERT_EQUAL_UINT64(truth.sent[s * 256 + r], link->sent);
+            TEST_ASSERT_EQUAL_UINT64(truth.delivered[s * 256 + r], link->delivered);
+            TEST_ASSERT_EQUAL_MEMORY(link, same, sizeof(LogLinkReport));
+            sent += link->sent;
+            delivered += link->delivered;
+            if (link->latencySamples > 100) {
+                // 92-132 ms, whatever the boots' clock offsets
+                TEST_ASSERT_TRUE(link->latencyAligned);
+                TEST_ASSERT_FLOAT_WITHIN(8, 112, link->latencyP50Ms);
+                TEST_ASSERT_TRUE(link->latencyMaxMs <= 140);
+                worstP50 = std::max(worstP50, fabsf(link->latencyP50Ms - 112));
+            }
+        }
+    }
+    TEST_ASSERT_TRUE(delivered > 0);
+    TEST_ASSERT_TRUE(!one.rssiByDistance.empty());
+    for (size_t b = 1; b < one.rssiByDistance.size(); b++) {
+        // Log-distance model: weaker further out, past the shadowing
+        if (one.rssiByDistance[b].frames > 50 && one.rssiByDistance[b - 1].frames > 50 &&
+            one.rssiByDistance[b].fromM >= 200) {
+            TEST_ASSERT_TRUE(one.rssiByDistance[b].meanRssi < one.rssiByDistance[b - 1].meanRssi + 3);
+        }
+    }
+    printf("[SIM] %s, 6 drones, %u s: %.1f MB, %llu lines / %llu records, %llu/%llu frames delivered, "
+           "p50 within %.0f ms of 112\n", dumps ? "dumps" : "captures", truth.seconds, truth.bytes / 1e6,
+           (unsigned long long)one.lines, (unsigned long long)one.records, (unsigned long long)delivered,
+           (unsigned long long)sent, worstP50);
+
+    TEST_ASSERT_TRUE(LogAnalyzer::writeCsv(one, directory.c_str()));
+    struct stat info;
+    TEST_ASSERT_EQUAL(0, stat((directory + "/links.csv").c_str(), &info));
+    TEST_ASSERT_TRUE(info.st_size > 0);
+    removeDirectory(directory);
+}
+
+static void test_synthetic_captures_match_truth() {
+    checkAgainstTruth(false);
+}
+
+static void test_synthetic_dumps_match_truth() {
+    checkAgainstTruth(true);
+}
+
+static void test_throughput() {
+    std::string directory = makeDirectory();
+    LogSynthesisOptions synthesis = {20, false, 128u << 20, 7};
+    LogSynthesisTruth truth;
+    TEST_ASSERT_TRUE(synthesizeLogs(directory.c_str(), synthesis, &truth));
+
+    LogAnalyzer analyzer;
+    for (const std::string& file : filesIn(directory)) {
+        TEST_ASSERT_TRUE(analyzer.addFile(file.c_str()));
+    }
+    LogAnalysis analysis = analyzer.run();
+    TEST_ASSERT_EQUAL_UINT64(0, analysis.ambiguous);
+    double seconds = analysis.parseSeconds + analysis.joinSeconds;
+    printf("[BENCH] %u captures, %.0f MB, %u threads: parse %.2f s, join %.2f s, %.2f GB/s, %.1fM lines/s\n",
+           analysis.files, analysis.bytes / 1e6, analysis.threads, analysis.parseSeconds, analysis.joinSeconds,
+           analysis.bytes / seconds / 1e9, analysis.lines / seconds / 1e6);
+    removeDirectory(directory);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_capture_lines_are_parsed);
+    RUN_TEST(test_dump_records_are_parsed);
+    RUN_TEST(test_synthetic_captures_match_truth);
+    RUN_TEST(test_synthetic_dumps_match_truth);
+    RUN_TEST(test_throughput);
+    return UNITY_END();
+}
@@ -0,0 +1,425 @@
+// Channel access tests: slot jitter, binary exponential backoff and drops,
+// the rate and airtime budgets, utilisation, and a simulated swarm comparing
+// collision rates of plain periodic sends, jitter alone and listen before talk
+// Run with: pio test -e native -f test_mac
+
+#include <unity.h>
+#include <algorithm>
+#include <memory>
+#include "../../include/communications/lora_interface.h"
+#include "../../include/simulation/radio_sim.h"
+#include "../../include/utilities/crypto_utils.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Drives one frame through the MAC with the channel always clear; returns
+// the time it went out
+static uint32_t sendWhenClear(ChannelAccess& mac, uint32_t now, uint32_t airtimeUs) {
+    TEST_ASSERT_TRUE(mac.request(now));
+    for (;;) {
+        MacAction action = mac.poll(now);
+        if (action == MAC_SENSE) {
+            action = mac.onChannelSensed(false, now);
+        }
+        if (action == MAC_TRANSMIT) {
+            mac.onTransmitted(airtimeUs, now);
+            return now;
+        }
+        TEST_ASSERT_EQUAL(MAC_WAIT, action);
+        now += std::max<uint32_t>(1, mac.nextActionIn(now));
+    }
+}
+
+void test_jitter_and_clear_channel() {
+    ChannelAccess mac(3);
+    uint16_t slot = mac.getSlotMs();
+    TEST_ASSERT_TRUE(slot >= 2 && slot <= 4);    // Two SF7 symbols plus turnaround
+    TEST_ASSERT_FALSE(mac.pending());
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, mac.nextActionIn(0));
+    TEST_ASSERT_EQUAL(MAC_IDLE, mac.poll(0));
+
+    // Start offsets cover the jitter window in whole slots
+    bool seen[MAC_JITTER_SLOTS] = {false};
+    uint32_t now = 100000;
+    for (int i = 0; i < 400; i++) {
+        TEST_ASSERT_TRUE(mac.request(now));
+        TEST_ASSERT_FALSE(mac.request(now));    // One frame at a time
+        uint32_t wait = mac.nextActionIn(now);
+        TEST_ASSERT_EQUAL(0, wait % slot);
+        TEST_ASSERT_TRUE(wait / slot < MAC_JITTER_SLOTS);
+        seen[wait / slot] = true;
+
+        if (wait > 0) {
+            TEST_ASSERT_EQUAL(MAC_WAIT, mac.poll(now + wait - 1));
+        }
+        TEST_ASSERT_EQUAL(MAC_SENSE, mac.poll(now + wait));
+        TEST_ASSERT_EQUAL(MAC_WAIT, mac.poll(now + wait));     // Until the result is in
+        TEST_ASSERT_EQUAL(MAC_TRANSMIT, mac.onChannelSensed(false, now + wait));
+        TEST_ASSERT_EQUAL(MAC_TRANSMIT, mac.poll(now + wait));
+        mac.onTransmitted(100000, now + wait);
+        TEST_ASSERT_FALSE(mac.pending());
+        now += 1000;
+    }
+    int covered = 0;
+    for (int i = 0; i < MAC_JITTER_SLOTS; i++) {
+        covered += seen[i];
+    }
+    TEST_ASSERT_EQUAL(MAC_JITTER_SLOTS, covered);
+
+    MacStats stats = mac.getStats();
+    TEST_ASSERT_EQUAL(400, stats.requested);
+    TEST_ASSERT_EQUAL(400, stats.sent);
+    TEST_ASSERT_EQUAL(400, stats.channelChecks);
+    TEST_ASSERT_EQUAL(0, stats.channelBusy);
+    TEST_ASSERT_TRUE(stats.maxAccessDelayMs < MAC_JITTER_SLOTS * slot);
+
+    // Nodes seeded apart draw different offsets
+    ChannelAccess a(1), b(2);
+    int same = 0;
+    for (int i = 0; i < 100; i++) {
+        a.request(i * 1000);
+        b.request(i * 1000);
+        same += a.nextActionIn(i * 1000) == b.nextActionIn(i * 1000);
+        a.onTransmitted(0, i * 1000);
+        b.onTransmitted(0, i * 1000);
+    }
+    TEST_ASSERT_TRUE(same < 20);
+}
+
+void test_backoff_grows_then_drops() {
+    ChannelAccess mac(5);
+    uint16_t slot = mac.getSlotMs();
+    uint32_t longest[MAC_MAX_ATTEMPTS] = {0};
+
+    for (int frame = 0; frame < 200; frame++) {
+        uint32_t now = 1000000 + frame * 10000;
+        TEST_ASSERT_TRUE(mac.request(now));
+        for (uint8_t attempt = 1;; attempt++) {
+            now += mac.nextActionIn(now);
+            TEST_ASSERT_EQUAL(MAC_SENSE, mac.poll(now));
+            MacAction action = mac.onChannelSensed(true, now);
+            if (attempt == MAC_MAX_ATTEMPTS) {
+                TEST_ASSERT_EQUAL(MAC_IDLE, action);
+                TEST_ASSERT_FALSE(mac.pending());
+                break;
+            }
+            TEST_ASSERT_EQUAL(MAC_WAIT, action);
+            uint32_t wait = mac.nextActionIn(now);
+            uint8_t exponent = std::min(MAC_MIN_BACKOFF_EXPONENT + attempt - 1, MAC_MAX_BACKOFF_EXPONENT);
+            TEST_ASSERT_TRUE(wait >= slot);
+            TEST_ASSERT_TRUE(wait <= (1u << exponent) * slot);
+            longest[attempt] = std::max(longest[attempt], wait);
+        }
+    }
+    // The window doubles with every busy check until the cap
+    for (uint8_t attempt = 2; attempt < MAC_MAX_ATTEMPTS; attempt++) {
+        TEST_ASSERT_TRUE(longest[attempt] > longest[attempt - 1] ||
+                         MAC_MIN_BACKOFF_EXPONENT + attempt - 1 > MAC_MAX_BACKOFF_EXPONENT);
+    }
+
+    MacStats stats = mac.getStats();
+    TEST_ASSERT_EQUAL(200, stats.dropped);
+    TEST_ASSERT_EQUAL(0, stats.sent);
+    TEST_ASSERT_EQUAL(200 * MAC_MAX_ATTEMPTS, stats.channelBusy);
+
+    // A clear check after a busy one still sends
+    uint32_t now = 5000000;
+    mac.request(now);
+    now += mac.nextActionIn(now);
+    mac.poll(now);
+    TEST_ASSERT_EQUAL(MAC_WAIT, mac.onChannelSensed(true, now));
+    now += mac.nextActionIn(now);
+    TEST_ASSERT_EQUAL(MAC_SENSE, mac.poll(now));
+    TEST_ASSERT_EQUAL(MAC_TRANSMIT, mac.onChannelSensed(false, now));
+    mac.onTransmitted(50000, now);
+    TEST_ASSERT_EQUAL(1, mac.getStats().sent);
+}
+
+void test_message_rate_limit() {
+    ChannelAccess mac(7);
+    uint32_t airtime = mac.getSlotMs() * 10;   // Short frames: only the rate limit applies
+    uint32_t start = 100000, now = start;
+    uint32_t burst = 0;
+    while (now < start + 3000) {
+        now = sendWhenClear(mac, now, airtime);
+        if (now - start < 1000) burst++;
+    }
+    MacStats stats = mac.getStats();
+    // A full bucket allows one second's worth at once, then the rate holds
+    TEST_ASSERT_TRUE(burst > MAX_MESSAGE_RATE_PER_SEC);
+    TEST_ASSERT_TRUE(stats.sent <= 4 * MAX_MESSAGE_RATE_PER_SEC + 1);
+    TEST_ASSERT_TRUE(stats.sent >= 4 * MAX_MESSAGE_RATE_PER_SEC - 2);
+    TEST_ASSERT_TRUE(stats.rateDeferrals > 0);
+    TEST_ASSERT_EQUAL(0, stats.dutyDeferrals);
+    printf("[SIM] Rate limit: %u frames in 3 s, %u deferred\n", (unsigned)stats.sent,
+           (unsigned)stats.rateDeferrals);
+}
+
+void test_airtime_budget_and_utilization() {
+    // SF12 frames are ~2 s on air: the airtime budget binds long before the
+    // message rate does
+    LoRaPhyConfig phy = loraDefaultPhy();
+    phy.spreadingFactor = 12;
+    uint32_t airtime = loraAirtimeUs(phy, sizeof(SecureFrame));
+    ChannelAccess mac(9);
+    mac.setPhy(phy);
+
+    // Offered back to back, far above the budget
+    uint32_t start = 100000, now = start;
+    uint64_t onAir = 0;
+    while (now < start + 120000) {
+        now = sendWhenClear(mac, now, airtime);
+        onAir += airtime;
+    }
+    double share = onAir / ((now - start) * 1000.0) * 100;
+    MacStats stats = mac.getStats();
+    printf("[SIM] Airtime budget: %.1f%% of 120 s on air at SF12 (limit %d%%), %u deferred, own utilisation %.1f%%\n",
+           share, MAX_BANDWIDTH_USAGE_PERCENT, (unsigned)stats.dutyDeferrals, mac.getOwnUtilization());
+    TEST_ASSERT_TRUE(stats.dutyDeferrals > 0);
+    // The bucket's initial burst is one window's worth
+    TEST_ASSERT_TRUE(share <= MAX_BANDWIDTH_USAGE_PERCENT + 100.0 * MAC_DUTY_WINDOW_MS / 120000);
+    TEST_ASSERT_TRUE(share >= MAX_BANDWIDTH_USAGE_PERCENT - 10);
+    TEST_ASSERT_TRUE(mac.getOwnUtilization() > 50.0f);
+    TEST_ASSERT_TRUE(mac.getOwnUtilization() <= 100.0f);
+
+    // Heard traffic counts toward the channel but not toward our budget
+    ChannelAccess listener(10);
+    for (uint32_t t = 0; t < 3 * MAC_UTILIZATION_WINDOW_MS; t += 200) {
+        listener.onFrameHeard(50000, t);                  // 25% of the channel
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 25.0f, listener.getChannelUtilization());
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, listener.getOwnUtilization());
+    // A silent stretch decays it
+    listener.poll(10 * MAC_UTILIZATION_WINDOW_MS);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, listener.getChannelUtilization());
+}
+
+// Simulated swarm: every drone boots at the same moment and runs the main
+// loop of main_sender.cpp: a pass every SIM_LOOP_MS plus a little work, a
+// heartbeat when HEARTBEAT_INTERVAL_MS has passed since the last one, sent
+// once it has waited BATCH_MAX_DELAY_MS. sendMessage() blocks the loop until
+// the frame is on air, which shifts that drone's heartbeat phase. Modes:
+// "periodic" transmits straight away, as before this MAC; "jitter" goes
+// through ChannelAccess but always reports a clear channel; "lbt" senses the
+// channel like DroneComm (RSSI, then CAD) and backs off. Sensing and
+// turnaround take one slot, so a neighbour starting within it is missed.
+
+#define SIM_SECONDS 300
+#define SIM_LOOP_MS 100
+#define SIM_LOOP_WORK_US 5000           // Printing and the rest of the pass, uniform 0..this
+#define SIM_DRIFT_PPM 50
+#define SIM_BOOT_SPREAD_US 2000
+
+static const SimLinkBudget kBudget = {32.0f, 3.0f, 4.0f, 2.0f};
+
+enum AccessMode { ACCESS_PERIODIC, ACCESS_JITTER, ACCESS_LBT };
+
+struct MacResult {
+    double collisionRate;               // Receptions lost to overlap, or to sending at the same time
+    double deliveryRatio;               // Of heartbeats x neighbours in range
+    uint32_t dropped;                   // Channel busy MAC_MAX_ATTEMPTS times
+    double meanAccessDelayMs;
+    double channelLoad;                 // Airtime sent, % of time (overlaps count twice)
+    double measuredLoad;                // Mean of the nodes' getChannelUtilization()
+};
+
+class MacSimulation {
+private:
+    struct Node {
+        std::unique_ptr<ChannelAccess> mac;
+        double clockScale;              // Crystal tolerance
+        uint32_t lastHeartbeatMs;
+        bool queued;
+        uint32_t queuedAtMs;
+        uint8_t neighbours;
+    };
+
+    RadioSim sim;
+    AccessMode mode;
+    uint8_t count;
+    std::vector<Node> nodes;
+    uint64_t expected;
+    uint64_t airtimeSumUs;
+    uint32_t frameAirtimeUs;
+
+    uint32_t nowMs() { return (uint32_t)(sim.now() / 1000); }
+
+    void nextPass(uint8_t node) {
+        std::uniform_int_distribution<uint32_t> work(0, SIM_LOOP_WORK_US);
+        uint64_t delayUs = (uint64_t)((SIM_LOOP_MS * 1000 + work(sim.rng())) * nodes[node].clockScale);
+        sim.after(delayUs, [this, node]() { loopPass(node); });
+    }
+
+    void loopPass(uint8_t node) {
+        Node& n = nodes[node];
+        uint32_t now = nowMs();
+        if (now - n.lastHeartbeatMs >= HEARTBEAT_INTERVAL_MS) {
+            n.lastHeartbeatMs = now;
+            n.queued = true;
+            n.queuedAtMs = now;
+            expected += n.neighbours;
+        }
+        // sendDueBatches(): only while the radio is free
+        if (n.queued && now - n.queuedAtMs >= BATCH_MAX_DELAY_MS && !sim.isTransmitting(node)) {
+            n.queued = false;
+            if (mode == ACCESS_PERIODIC) {
+                send(node);
+            } else {
+                n.mac->request(now);
+                step(node);
+                return;                 // The pass resumes once the frame is out
+            }
+        }
+        nextPass(node);
+    }
+
+    void step(uint8_t node) {
+        ChannelAccess& mac = *nodes[node].mac;
+        MacAction action = mac.poll(nowMs());
+        if (action == MAC_WAIT) {
+            sim.after(std::max<uint32_t>(1, mac.nextActionIn(nowMs())) * 1000ULL, [this, node]() { step(node); });
+        } else if (action == MAC_SENSE) {
+            bool busy = mode == ACCESS_LBT && sim.senseChannel(node, MAC_RSSI_BUSY_DBM);
+            sim.after(mac.getSlotMs() * 1000ULL, [this, node, busy]() {
+                if (nodes[node].mac->onChannelSensed(busy, nowMs()) == MAC_IDLE) {
+                    nextPass(node);
+                } else {
+                    step(node);
+                }
+            });
+        } else {
+            send(node);
+            mac.onTransmitted(frameAirtimeUs, nowMs());
+            nextPass(node);
+        }
+    }
+
+    void send(uint8_t node) {
+        SecureFrame frame;
+        memset(&frame, 0, sizeof(frame));
+        frame.msg.messageType = MSG_HEARTBEAT;
+        frame.msg.sourceId = node;
+        frame.msg.dataLength = sizeof(HeartbeatData);
+        sim.transmit(node, &frame, sizeof(frame));
+    }
+
+public:
+    MacSimulation(uint8_t count, AccessMode mode, uint32_t seed)
+        : sim(count, seed), mode(mode), count(count), nodes(count), expected(0), airtimeSumUs(0) {
+        sim.setLinkBudget(kBudget);
+        frameAirtimeUs = sim.airtimeUs(sizeof(SecureFrame));
+        std::uniform_real_distribution<float> coordinate(0.0f, MISSION_AREA_SIZE_M);
+        do {
+            for (uint8_t i = 0; i < count; i++) {
+                sim.setPosition(i, coordinate(sim.rng()), coordinate(sim.rng()));
+            }
+        } while (!sim.isConnected());
+
+        std::uniform_int_distribution<int> drift(-SIM_DRIFT_PPM, SIM_DRIFT_PPM);
+        std::uniform_int_distribution<uint32_t> boot(0, SIM_BOOT_SPREAD_US);
+        for (uint8_t i = 0; i < count; i++) {
+            Node& n = nodes[i];
+            n.mac.reset(new ChannelAccess(i));
+            n.mac->seed(seed * 131 + i);
+            n.clockScale = 1.0 + drift(sim.rng()) * 1e-6;
+            n.lastHeartbeatMs = 0;
+            n.queued = false;
+            n.queuedAtMs = 0;
+            n.neighbours = 0;
+            for (uint8_t j = 0; j < count; j++) {
+                n.neighbours += j != i && sim.inRange(i, j);
+            }
+            sim.at(boot(sim.rng()), [this, i]() { loopPass(i); });
+        }
+
+        sim.onReceive([this](uint8_t node, const SimFrame&) {
+            nodes[node].mac->onFrameHeard(frameAirtimeUs, nowMs());
+        });
+        sim.onTxDone([this](uint8_t, const SimFrame& frame) {
+            airtimeSumUs += frame.endUs - frame.startUs;
+        });
+    }
+
+    MacResult run() {
+        sim.run(SIM_SECONDS * 1000000ULL);
+        RadioSimStats stats = sim.getStats();
+        MacResult r;
+        uint32_t overlapped = stats.collisions + stats.halfDuplexLosses;
+        r.collisionRate = overlapped / (double)std::max<uint32_t>(1, stats.deliveries + overlapped);
+        r.deliveryRatio = stats.deliveries / (double)expected;
+        r.dropped = 0;
+        uint32_t sent = 0;
+        uint64_t delay = 0;
+        r.measuredLoad = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            MacStats m = nodes[i].mac->getStats();
+            r.dropped += m.dropped;
+            sent += m.sent;
+            delay += m.totalAccessDelayMs;
+            r.measuredLoad += nodes[i].mac->getChannelUtilization() / count;
+        }
+        r.meanAccessDelayMs = sent ? delay / (double)sent : 0;
+        r.channelLoad = airtimeSumUs / (SIM_SECONDS * 1e6) * 100;
+        return r;
+    }
+};
+
+void test_simulated_collisions_vs_swarm_size() {
+    static const uint8_t sizes[] = {5, 10, 20, 40};
+    static const char* names[] = {"periodic", "jitter", "lbt"};
+    printf("[SIM] Heartbeat every %d ms, %d s, synchronised boot, SF7, %u ms slots, %.0f m area:\n",
+           HEARTBEAT_INTERVAL_MS, SIM_SECONDS, (unsigned)ChannelAccess(0).getSlotMs(), (double)MISSION_AREA_SIZE_M);
+    printf("[SIM]   drones  mode      collisions  delivered  dropped  access ms  load  measured\n");
+
+    for (uint8_t size : sizes) {
+        MacResult results[3];
+        for (int mode = 0; mode < 3; mode++) {
+            MacResult mean;
+            memset(&mean, 0, sizeof(mean));
+            const int seeds = 3;
+            for (int seed = 0; seed < seeds; seed++) {
+                MacResult r = MacSimulation(size, (AccessMode)mode, 1000 + seed * 17 + size).run();
+                mean.collisionRate += r.collisionRate / seeds;
+                mean.deliveryRatio += r.deliveryRatio / seeds;
+                mean.dropped += r.dropped;
+                mean.meanAccessDelayMs += r.meanAccessDelayMs / seeds;
+                mean.channelLoad += r.channelLoad / seeds;
+                mean.measuredLoad += r.measuredLoad / seeds;
+            }
+            mean.dropped /= seeds;
+            results[mode] = mean;
+            printf("[SIM]   %6d  %-8s  %9.1f%%  %8.1f%%  %7u  %9.1f  %3.0f%%  %7.0f%%\n", size, names[mode],
+                   mean.collisionRate * 100, mean.deliveryRatio * 100, (unsigned)mean.dropped,
+                   mean.meanAccessDelayMs, mean.channelLoad, mean.measuredLoad);
+        }
+
+        const MacResult& periodic = results[ACCESS_PERIODIC];
+        const MacResult& jitter = results[ACCESS_JITTER];
+        const MacResult& lbt = results[ACCESS_LBT];
+        // Synchronised timers collide on every tick
+        TEST_ASSERT_TRUE(periodic.collisionRate > 0.5);
+        TEST_ASSERT_TRUE(lbt.collisionRate < jitter.collisionRate);
+        TEST_ASSERT_TRUE(lbt.deliveryRatio > periodic.deliveryRatio);
+        TEST_ASSERT_TRUE(lbt.deliveryRatio >= jitter.deliveryRatio);
+        if (size <= 10) {
+            TEST_ASSERT_TRUE(lbt.collisionRate < 0.1);
+            TEST_ASSERT_TRUE(lbt.deliveryRatio > 0.9);
+        }
+        if (size <= 20) {
+            // Nodes only count frames they decoded, so they see a little less
+            TEST_ASSERT_TRUE(lbt.measuredLoad <= lbt.channelLoad * 1.1 + 1);
+            TEST_ASSERT_TRUE(lbt.measuredLoad >= lbt.channelLoad * 0.7);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_jitter_and_clear_channel);
+    RUN_TEST(test_backoff_grows_then_drops);
+    RUN_TEST(test_message_rate_limit);
+    RUN_TEST(test_airtime_budget_and_utilization);
+    RUN_TEST(test_simulated_collisions_vs_swarm_size);
+    return UNITY_END();
+}
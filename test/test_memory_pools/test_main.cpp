@@ -0,0 +1,298 @@
+// Memory pool tests: fixed-block pools, arena, pooled timers and deferred
+// logging, plus a steady-state stress run with malloc interposed to prove
+// message handling never reaches the heap
+// Run with: pio test -e native -f test_memory_pools
+
+#include <unity.h>
+#include <atomic>
+#include <random>
+#include <vector>
+#include "../../include/utilities/data_structures.h"
+#include "../../include/utilities/debug_utils.h"
+#include "../../include/utilities/time_utils.h"
+#include "../../include/communications/peer_table.h"
+#include "../../include/communications/status_service.h"
+#include "../../include/target_detection/target_validation.h"
+#include "../../include/coordination/mission_controller.h"
+
+// Every heap entry point in the process is counted while `countingHeap` is
+// set: glibc's malloc family is interposed, and operator new lands there too
+static std::atomic<bool> countingHeap(false);
+static std::atomic<uint32_t> heapCalls(0);
+
+#if defined(__GLIBC__)
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+extern "C" void __libc_free(void* ptr);
+
+extern "C" void* malloc(size_t size) {
+    if (countingHeap.load(std::memory_order_relaxed)) heapCalls++;
+    return __libc_malloc(size);
+}
+extern "C" void* calloc(size_t count, size_t size) {
+    if (countingHeap.load(std::memory_order_relaxed)) heapCalls++;
+    return __libc_calloc(count, size);
+}
+extern "C" void* realloc(void* ptr, size_t size) {
+    if (countingHeap.load(std::memory_order_relaxed)) heapCalls++;
+    return __libc_realloc(ptr, size);
+}
+extern "C" void free(void* ptr) {
+    if (ptr && countingHeap.load(std::memory_order_relaxed)) heapCalls++;
+    __libc_free(ptr);
+}
+#else
+void* operator new(size_t size) {
+    if (countingHeap.load(std::memory_order_relaxed)) heapCalls++;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void operator delete(void* ptr) noexcept {
+    if (ptr && countingHeap.load(std::memory_order_relaxed)) heapCalls++;
+    std::free(ptr);
+}
+#endif
+
+void setUp() {}
+void tearDown() {}
+
+struct Widget {
+    uint32_t value;
+    uint8_t padding[20];
+    Widget() : value(0xABCD) {}
+};
+
+void test_pool_allocates_to_capacity_and_tracks_high_water() {
+    ObjectPool<Widget, 8> pool("widgets");
+    Widget* held[8];
+    for (int i = 0; i < 8; i++) {
+        held[i] = pool.allocate();
+        TEST_ASSERT_NOT_NULL(held[i]);
+        TEST_ASSERT_EQUAL(0xABCD, held[i]->value);     // Constructed
+        TEST_ASSERT_EQUAL(0, (uintptr_t)held[i] % alignof(Widget));
+    }
+    TEST_ASSERT_NULL(pool.allocate());
+
+    for (int i = 0; i < 5; i++) TEST_ASSERT_TRUE(pool.release(held[i]));
+    PoolStats s = pool.getStats();
+    TEST_ASSERT_EQUAL(3, s.inUse);
+    TEST_ASSERT_EQUAL(8, s.highWater);
+    TEST_ASSERT_EQUAL(8, s.allocations);
+    TEST_ASSERT_EQUAL(1, s.failures);
+    TEST_ASSERT_EQUAL(sizeof(Widget), s.blockSize);
+
+    // Freed blocks come back, live ones are visible by slot
+    Widget* again = pool.allocate();
+    TEST_ASSERT_TRUE(pool.indexOf(again) >= 0 && pool.indexOf(again) < 5);
+    uint8_t live = 0;
+    for (uint16_t i = 0; i < pool.capacity(); i++) {
+        if (pool.at(i)) live++;
+    }
+    TEST_ASSERT_EQUAL(4, live);
+
+    pool.resetHighWater();
+    TEST_ASSERT_EQUAL(4, pool.getStats().highWater);
+}
+
+void test_pool_rejects_foreign_and_double_release() {
+    ObjectPool<Widget, 4> pool("widgets");
+    Widget outside;
+    Widget* w = pool.allocate();
+    TEST_ASSERT_FALSE(pool.release(&outside));
+    TEST_ASSERT_FALSE(pool.release((Widget*)((uint8_t*)w + 1)));
+    TEST_ASSERT_TRUE(pool.release(w));
+    TEST_ASSERT_FALSE(pool.release(w));
+    TEST_ASSERT_EQUAL(0, pool.size());
+    TEST_ASSERT_EQUAL(3, pool.getStats().failures);
+}
+
+void test_registry_lists_every_pool() {
+    bool sawFrames = false, sawLog = false, sawLocal = false;
+    {
+        ObjectPool<Widget, 2> local("local");
+        for (MemoryPoolBase* p = MemoryPoolBase::first(); p; p = p->next()) {
+            const char* name = p->getStats().name;
+            sawFrames |= strcmp(name, "frames") == 0;
+            sawLog |= strcmp(name, "log") == 0;
+            sawLocal |= strcmp(name, "local") == 0;
+        }
+    }
+    TEST_ASSERT_TRUE(sawFrames && sawLog && sawLocal);
+
+    // Destroyed pools unlink themselves
+    for (MemoryPoolBase* p = MemoryPoolBase::first(); p; p = p->next()) {
+        TEST_ASSERT_TRUE(strcmp(p->getStats().name, "local") != 0);
+    }
+}
+
+void test_arena_aligns_formats_and_resets() {
+    Arena<64> arena("test");
+    uint8_t* a = (uint8_t*)arena.allocate(3);
+    uint8_t* b = (uint8_t*)arena.allocate(8);
+    TEST_ASSERT_EQUAL(0, (uintptr_t)b % 8);
+    TEST_ASSERT_TRUE(b >= a + 3);
+
+    const char* text = arena.format("%dh %dm", 3, 25);
+    TEST_ASSERT_EQUAL_STRING("3h 25m", text);
+    TEST_ASSERT_NULL(arena.allocate(64));
+    TEST_ASSERT_EQUAL_STRING("", arena.format("%s", "this line is far too long for what is left of the arena"));
+
+    uint16_t peak = arena.getStats().highWater;
+    arena.reset();
+    TEST_ASSERT_EQUAL(0, arena.used());
+    TEST_ASSERT_EQUAL(peak, arena.getStats().highWater);
+    TEST_ASSERT_NOT_NULL(arena.allocate(64));
+}
+
+void test_timeout_manager_reuses_slots_with_fresh_ids() {
+    TimeoutManager timers;
+    int ids[TIMEOUT_POOL_SIZE];
+    for (int i = 0; i < TIMEOUT_POOL_SIZE; i++) {
+        ids[i] = timers.addTimeout(i == 0 ? 0 : 60000, "mission");
+        TEST_ASSERT_TRUE(ids[i] > 0);
+    }
+    TEST_ASSERT_EQUAL(-1, timers.addTimeout(1000));
+
+    int expired[4];
+    TEST_ASSERT_EQUAL(1, timers.checkAllTimeouts(expired, 4));
+    TEST_ASSERT_EQUAL(ids[0], expired[0]);
+    TEST_ASSERT_EQUAL(0, timers.checkAllTimeouts(expired, 4));     // Latched inactive
+
+    timers.removeTimeout(ids[0]);
+    int reused = timers.addTimeout(5000);
+    TEST_ASSERT_EQUAL(ids[0] & 0xFF, reused & 0xFF);               // Same slot...
+    TEST_ASSERT_TRUE(reused != ids[0]);                             // ...new id
+    TEST_ASSERT_EQUAL(0, timers.getRemainingTime(ids[0]));
+    TEST_ASSERT_TRUE(timers.getRemainingTime(reused) > 4000);
+    TEST_ASSERT_FALSE(timers.isTimeoutExpired(ids[0]));
+    debugLogFlush();
+}
+
+void test_deferred_log_drops_instead_of_allocating() {
+    debugLogFlush();
+    uint32_t droppedBefore = debugLogDropped();
+    for (int i = 0; i < LOG_POOL_SIZE + 3; i++) {
+        debugLog(LOG_INFO, "line %d", i);
+    }
+    TEST_ASSERT_EQUAL(droppedBefore + 3, debugLogDropped());
+    TEST_ASSERT_EQUAL(LOG_POOL_SIZE, logPool.getStats().inUse);
+    TEST_ASSERT_EQUAL(LOG_POOL_SIZE, debugLogFlush());
+    TEST_ASSERT_EQUAL(0, logPool.getStats().inUse);
+}
+
+// A busy drone's receive path: heartbeats feed the peer table and the
+// formation, target reports feed fusion, status requests are answered,
+// timers churn and every pass logs and formats text. After a warm-up,
+// none of it may touch the heap.
+void test_steady_state_message_handling_is_heap_free() {
+    static PeerTable peers;
+    static StatusService status(1, &perfMonitor, &peers);
+    static TargetTrackStore tracks;
+    static FormationController formation;
+    static TimeoutManager timers;
+    static DroneMessage replies[STATUS_MAX_FRAMES];
+    VelocityCommand commands[MAX_FORMATION_MEMBERS];
+    CommStats comm;
+    memset(&comm, 0, sizeof(comm));
+    std::mt19937 rng(33);
+
+    int timerIds[4] = {-1, -1, -1, -1};
+    uint32_t totalPasses = 0;
+    uint32_t logFailuresBefore = logPool.getStats().failures;
+
+    auto pass = [&](uint32_t i, uint32_t now) {
+        scratchArena.reset();
+        DroneMessage* msg = framePool.allocate();
+        TEST_ASSERT_NOT_NULL(msg);
+        uint8_t kind = i % 4;
+        if (kind < 2) {
+            HeartbeatData hb;
+            memset(&hb, 0, sizeof(hb));
+            hb.droneId = 2 + (i / 4) % (MAX_DRONES - 1);
+            hb.latitude = 28.7041f + (rng() % 100) * 1e-5f;
+            hb.longitude = 77.1025f + (rng() % 100) * 1e-5f;
+            hb.missionState = 2;
+            msg->messageType = MSG_HEARTBEAT;
+            memcpy(msg->data, &hb, sizeof(hb));
+            msg->dataLength = sizeof(hb);
+            peers.update(hb, -70 - (int)(rng() % 20), 6.0f, now);
+            formation.updateFromHeartbeat(hb, now);
+            {
+                PERF_SCOPE(PERF_HANDLER_FORMATION);
+                formation.tick(commands, MAX_FORMATION_MEMBERS);
+            }
+        } else if (kind == 2) {
+            TargetReportData report;
+            memset(&report, 0, sizeof(report));
+            report.reporterId = 2 + (i % 3);
+            report.targetId = i % 7;
+            report.latitude = 28.7041f + (i % 7) * 1e-3f;
+            report.longitude = 77.1025f;
+            report.confidence = 200;
+            report.sensorQuality = 180;
+            tracks.ingest(report, -75, 5.0f, now);
+        } else {
+            buildStatusRequest(0, 1, i, now, STATUS_TELEMETRY_DELTA, 0, *msg);
+            status.handleRequest(*msg, comm, now, replies);
+        }
+        comm.messagesReceived++;
+
+        uint8_t slot = i % 4;
+        if (timerIds[slot] > 0) timers.removeTimeout(timerIds[slot]);
+        timerIds[slot] = timers.addTimeout(1000 + slot, "ack");
+        int expired[4];
+        timers.checkAllTimeouts(expired, 4);
+
+        const char* line = scratchArena.format("rx %lu from %d", (unsigned long)i, msg->sourceId);
+        debugLog(LOG_DEBUG, "%s", line);
+        debugLogFlush();
+        framePool.release(msg);
+        totalPasses++;
+    };
+
+    // Warm-up: first sightings, first printf buffers, lazily built state
+    uint32_t now = 1000;
+    for (uint32_t i = 0; i < 2000; i++, now += 10) pass(i, now);
+    debugLogFlush();
+
+    // The counter itself must see heap traffic
+    heapCalls = 0;
+    countingHeap = true;
+    {
+        std::vector<int> probe(64);
+        volatile int* sink = probe.data();
+        sink[0] = 1;
+    }
+    countingHeap = false;
+    TEST_ASSERT_EQUAL(2, heapCalls);
+
+    heapCalls = 0;
+    countingHeap = true;
+    const uint32_t steady = 200000;
+    for (uint32_t i = 2000; i < 2000 + steady; i++, now += 10) pass(i, now);
+    countingHeap = false;
+    uint32_t calls = heapCalls;
+    debugLogFlush();
+
+    printf("[BENCH] %lu steady-state messages, %lu heap calls\n", (unsigned long)steady, (unsigned long)calls);
+    printMemoryPools();
+    TEST_ASSERT_EQUAL(0, calls);
+    TEST_ASSERT_EQUAL(2000 + steady, totalPasses);
+    TEST_ASSERT_EQUAL(0, framePool.getStats().inUse);
+    TEST_ASSERT_EQUAL(0, framePool.getStats().failures);
+    TEST_ASSERT_EQUAL(logFailuresBefore, logPool.getStats().failures);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_pool_allocates_to_capacity_and_tracks_high_water);
+    RUN_TEST(test_pool_rejects_foreign_and_double_release);
+    RUN_TEST(test_registry_lists_every_pool);
+    RUN_TEST(test_arena_aligns_formats_and_resets);
+    RUN_TEST(test_timeout_manager_reuses_slots_with_fresh_ids);
+    RUN_TEST(test_deferred_log_drops_instead_of_allocating);
+    RUN_TEST(test_steady_state_message_handling_is_heap_free);
+    return UNITY_END();
+}
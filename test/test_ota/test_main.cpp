@@ -0,0 +1,486 @@
+// Over-the-air update tests: the delta format against several kinds of
+// edit, refusing a wrong base or a corrupted delta, pulling only missing
+// chunks, Trickle back-off, parameter updates, and a simulated swarm update
+// of 5, 20 and 50 drones over the shared LoRa channel
+// Run with: pio test -e native -f test_ota
+
+#include <unity.h>
+#include <cstddef>
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+#include "../../include/communications/ota_service.h"
+#include "../../include/utilities/config_override.h"
+#include "../../include/simulation/radio_sim.h"
+
+void setUp() {}
+void tearDown() {}
+
+#define IMAGE_BYTES (96 * 1024)
+#define FLASH_BYTES (128 * 1024)
+#define STEP_MS 20
+
+typedef std::vector<uint8_t> Bytes;
+
+// Incompressible, like machine code
+static Bytes randomBytes(uint32_t length, std::mt19937& rng) {
+    Bytes bytes(length);
+    for (uint8_t& b : bytes) b = (uint8_t)rng();
+    return bytes;
+}
+
+// A rebuild after a small source change: new code inserted in a few places,
+// constants and call targets patched, one function removed
+static Bytes editImage(const Bytes& base, uint32_t seed) {
+    std::mt19937 rng(seed);
+    Bytes image = base;
+    for (int i = 0; i < 12; i++) {
+        Bytes code = randomBytes(40 + rng() % 160, rng);
+        image.insert(image.begin() + rng() % image.size(), code.begin(), code.end());
+    }
+    for (int i = 0; i < 30; i++) {
+        uint32_t at = rng() % (image.size() - 4);
+        for (int j = 0; j < 4; j++) image[at + j] = (uint8_t)rng();
+    }
+    uint32_t cut = rng() % (image.size() - 500);
+    image.erase(image.begin() + cut, image.begin() + cut + 500);
+    return image;
+}
+
+static void load(RamFlash& flash, const Bytes& bytes) {
+    for (uint32_t offset = 0; offset < flash.size(); offset += FLIGHT_SECTOR_BYTES) {
+        flash.erase(offset);
+    }
+    TEST_ASSERT_TRUE(flash.write(0, bytes.data(), (uint32_t)bytes.size()));
+}
+
+// One drone's flash: the delta staging area, the running image, the other slot
+struct Storage {
+    RamFlash staging;
+    RamFlash base;
+    RamFlash target;
+    explicit Storage(const Bytes& running)
+        : staging(FLASH_BYTES), base(FLASH_BYTES), target(FLASH_BYTES) {
+        load(base, running);
+    }
+};
+
+// Loss-free broadcast between services; `drop` may discard a frame for one
+// receiver. Runs until `done` or `limitMs` have passed.
+static uint32_t exchange(std::vector<OtaService*>& nodes, uint32_t& now, uint32_t limitMs,
+                         std::function<bool()> done,
+                         std::function<bool(const DroneMessage&, size_t to)> drop = nullptr) {
+    uint32_t frames = 0;
+    for (uint32_t end = now + limitMs; now < end && !done(); now += STEP_MS) {
+        for (size_t i = 0; i < nodes.size(); i++) {
+            nodes[i]->service();
+            DroneMessage out[4];
+            uint8_t count = nodes[i]->poll(now, out, 4);
+            for (uint8_t f = 0; f < count; f++, frames++) {
+                for (size_t j = 0; j < nodes.size(); j++) {
+                    if (j != i && !(drop && drop(out[f], j))) nodes[j]->onFrame(out[f], now);
+                }
+            }
+        }
+    }
+    return frames;
+}
+
+static bool finished(OtaService& node) {
+    return node.getState() == OTA_READY || node.getState() == OTA_FAILED;
+}
+
+void test_delta_rebuilds_the_image() {
+    std::mt19937 rng(1);
+    Bytes running = randomBytes(IMAGE_BYTES, rng);
+    Bytes shifted = running;
+    shifted.insert(shifted.begin(), 3, 0x00);       // Everything moves by three bytes
+    const Bytes targets[] = {running, editImage(running, 2), shifted, randomBytes(IMAGE_BYTES / 2, rng),
+                             Bytes(running.begin(), running.begin() + 1000)};
+    const uint32_t maxDelta[] = {200, 6000, 200, IMAGE_BYTES / 2 + 200, 200};
+
+    printf("[SIM] delta sizes for a %u-byte image:\n", IMAGE_BYTES);
+    for (uint8_t t = 0; t < 5; t++) {
+        Bytes delta;
+        otaEncodeDelta(OTA_KIND_FIRMWARE, 7, running.data(), (uint32_t)running.size(), targets[t].data(),
+                       (uint32_t)targets[t].size(), delta);
+        printf("[SIM]   case %u: %6u-byte image -> %5u-byte delta\n", t, (unsigned)targets[t].size(),
+               (unsigned)delta.size());
+        TEST_ASSERT_TRUE(delta.size() <= maxDelta[t]);
+
+        Storage ground(running), drone(running);
+        load(ground.staging, delta);
+        OtaService g(1), d(2);
+        g.begin(&ground.staging, &ground.base, &ground.target, 0);
+        d.begin(&drone.staging, &drone.base, &drone.target, 0);
+        TEST_ASSERT_TRUE(g.publish(0));
+        TEST_ASSERT_EQUAL(OTA_INSTALLED, g.getState());
+
+        std::vector<OtaService*> nodes = {&g, &d};
+        uint32_t now = 0;
+        exchange(nodes, now, 600000, [&]() { return finished(d); });
+        TEST_ASSERT_EQUAL_STRING("Ready", OtaService::getStateName(d.getState()));
+        TEST_ASSERT_EQUAL(7, d.getVersion());
+        TEST_ASSERT_EQUAL(OTA_KIND_FIRMWARE, d.getKind());
+        TEST_ASSERT_EQUAL_MEMORY(targets[t].data(), drone.target.image(), targets[t].size());
+        TEST_ASSERT_EQUAL_MEMORY(delta.data(), drone.staging.image(), delta.size());
+        d.markInstalled();
+        TEST_ASSERT_EQUAL(OTA_INSTALLED, d.getState());
+    }
+}
+
+void test_wrong_base_and_corrupt_delta_are_refused() {
+    std::mt19937 rng(3);
+    Bytes running = randomBytes(IMAGE_BYTES, rng);
+    Bytes next = editImage(running, 4);
+    Bytes delta;
+    otaEncodeDelta(OTA_KIND_FIRMWARE, 9, running.data(), IMAGE_BYTES, next.data(), (uint32_t)next.size(), delta);
+
+    // One drone still runs an older build; one has no OTA slot and only relays
+    Bytes older = running;
+    older[IMAGE_BYTES / 2] ^= 1;
+    Storage ground(running), stale(older), relay(running), drone(running);
+    load(ground.staging, delta);
+    OtaService g(1), s(2), r(3), d(4);
+    g.begin(&ground.staging, &ground.base, &ground.target, 0);
+    s.begin(&stale.staging, &stale.base, &stale.target, 0);
+    r.begin(&relay.staging, nullptr, nullptr, 0);
+    d.begin(&drone.staging, &drone.base, &drone.target, 0);
+    TEST_ASSERT_TRUE(g.publish(0));
+
+    // The ground only reaches the relay, which reaches the others
+    std::vector<OtaService*> nodes = {&g, &s, &r, &d};
+    auto line = [](const DroneMessage& msg, size_t to) {
+        return msg.sourceId == 1 && to != 2;
+    };
+    uint32_t now = 0;
+    exchange(nodes, now, 900000, [&]() { return finished(s) && finished(d); }, line);
+    TEST_ASSERT_EQUAL(OTA_FAILED, r.getState());
+    TEST_ASSERT_EQUAL_STRING("Flash error", OtaService::getFailureName(r.getFailure()));
+    TEST_ASSERT_EQUAL(OTA_FAILED, s.getState());
+    TEST_ASSERT_EQUAL(OTA_FAIL_BASE, s.getFailure());
+    TEST_ASSERT_EQUAL(OTA_READY, d.getState());
+    TEST_ASSERT_EQUAL_MEMORY(next.data(), drone.target.image(), next.size());
+
+    // A delta that rebuilds something other than what its manifest promises
+    // (damaged before it reached the ground) is caught by the image hash
+    Bytes bad = delta;
+    bad[offsetof(OtaManifest, targetDigest)] ^= 0x40;
+    bad[offsetof(OtaManifest, version)] = 10;
+    load(ground.staging, bad);
+    TEST_ASSERT_TRUE(g.publish(now));
+    exchange(nodes, now, 900000, [&]() { return d.getVersion() == 10 && finished(d); }, line);
+    TEST_ASSERT_EQUAL(OTA_FAIL_DIGEST, d.getFailure());
+
+    // A staged file of another version is not served as complete
+    TEST_ASSERT_FALSE(d.publish(now, 9));
+    TEST_ASSERT_TRUE(d.publish(now, 10));
+    TEST_ASSERT_EQUAL(d.getPageCount(), d.getPagesComplete());
+}
+
+void test_only_missing_chunks_are_pulled() {
+    std::mt19937 rng(5);
+    Bytes running = randomBytes(IMAGE_BYTES, rng);
+    Bytes next = editImage(running, 6);
+    Bytes delta;
+    otaEncodeDelta(OTA_KIND_FIRMWARE, 3, running.data(), IMAGE_BYTES, next.data(), (uint32_t)next.size(), delta);
+    Storage ground(running), drone(running);
+    load(ground.staging, delta);
+    OtaService g(1), d(2);
+    g.begin(&ground.staging, &ground.base, &ground.target, 0);
+    d.begin(&drone.staging, &drone.base, &drone.target, 0);
+    TEST_ASSERT_TRUE(g.publish(0));
+
+    // Chunks 3 and 17 of every page are lost the first time they are sent
+    std::vector<uint16_t> seen;
+    std::vector<uint32_t> requested;
+    auto lossy = [&](const DroneMessage& msg, size_t) {
+        if (msg.data[0] == OTA_REQUEST) {
+            OtaRequest request;
+            memcpy(&request, msg.data, sizeof(request));
+            TEST_ASSERT_EQUAL(1, msg.destinationId);
+            requested.push_back(request.missing);
+        }
+        if (msg.data[0] != OTA_DATA) return false;
+        OtaDataHeader header;
+        memcpy(&header, msg.data, sizeof(header));
+        bool first = std::find(seen.begin(), seen.end(), header.chunk) == seen.end();
+        seen.push_back(header.chunk);
+        uint8_t index = header.chunk % OTA_PAGE_CHUNKS;
+        return first && (index == 3 || index == 17);
+    };
+    std::vector<OtaService*> nodes = {&g, &d};
+    uint32_t now = 0;
+    exchange(nodes, now, 600000, [&]() { return finished(d); }, lossy);
+    TEST_ASSERT_EQUAL(OTA_READY, d.getState());
+
+    // Per page: a request for all of it, then one for just the two lost
+    uint32_t chunks = (uint32_t)(delta.size() + OTA_CHUNK_BYTES - 1) / OTA_CHUNK_BYTES;
+    uint32_t lost = 0;
+    for (uint32_t page = 0; page * OTA_PAGE_CHUNKS < chunks; page++) {
+        uint32_t inPage = std::min<uint32_t>(OTA_PAGE_CHUNKS, chunks - page * OTA_PAGE_CHUNKS);
+        lost += (inPage > 3) + (inPage > 17);
+    }
+    uint32_t retries = 0;
+    for (uint32_t missing : requested) {
+        if (missing == ((1u << 3) | (1u << 17)) || missing == (1u << 3)) retries++;
+    }
+    TEST_ASSERT_EQUAL(chunks + lost, g.getStats().dataSent);
+    TEST_ASSERT_EQUAL(chunks, d.getStats().chunksReceived);
+    TEST_ASSERT_EQUAL(d.getPageCount(), retries);
+    TEST_ASSERT_EQUAL(2 * d.getPageCount(), d.getStats().requests);
+}
+
+void test_trickle_backs_off_and_resets() {
+    std::mt19937 rng(7);
+    Bytes running = randomBytes(IMAGE_BYTES, rng);
+    Bytes delta;
+    otaEncodeDelta(OTA_KIND_FIRMWARE, 4, running.data(), IMAGE_BYTES, running.data(), IMAGE_BYTES, delta);
+
+    // Three drones that all hold version 4
+    std::vector<std::unique_ptr<Storage>> flash;
+    std::vector<std::unique_ptr<OtaService>> services;
+    std::vector<OtaService*> nodes;
+    for (uint8_t i = 0; i < 3; i++) {
+        flash.emplace_back(new Storage(running));
+        load(flash[i]->staging, delta);
+        services.emplace_back(new OtaService(i + 1));
+        services[i]->begin(&flash[i]->staging, &flash[i]->base, &flash[i]->target, 0);
+        TEST_ASSERT_TRUE(services[i]->publish(0, 4));
+        nodes.push_back(services[i].get());
+    }
+
+    // Ten quiet minutes: intervals double up to the maximum and each one
+    // carries about one advert for the three, not three
+    uint32_t now = 0;
+    uint32_t frames = exchange(nodes, now, 600000, []() { return false; });
+    uint32_t adverts = 0, suppressed = 0;
+    for (OtaService* n : nodes) {
+        TEST_ASSERT_EQUAL(OTA_TRICKLE_MAX_MS, n->getTrickleIntervalMs());
+        adverts += n->getStats().adverts;
+        suppressed += n->getStats().advertsSuppressed;
+    }
+    uint32_t intervals = 0;
+    for (uint32_t i = OTA_TRICKLE_MIN_MS, t = 0; t < 600000; t += i, i = std::min<uint32_t>(2 * i, OTA_TRICKLE_MAX_MS)) {
+        intervals++;
+    }
+    printf("[SIM] Trickle, 3 drones in agreement for 10 min: %u adverts, %u suppressed, %u intervals each\n",
+           (unsigned)adverts, (unsigned)suppressed, (unsigned)intervals);
+    TEST_ASSERT_EQUAL(adverts, frames);
+    TEST_ASSERT_TRUE(adverts <= intervals + 3);
+    TEST_ASSERT_TRUE(suppressed >= intervals);
+
+    // A drone that was off during the update, back with nothing: the next
+    // advert it hears pulls it in, and its own resets the others
+    Storage late(running);
+    OtaService l(9);
+    l.begin(&late.staging, &late.base, &late.target, now);
+    nodes.push_back(&l);
+    uint32_t joined = now;
+    exchange(nodes, now, 600000, [&]() { return finished(l); });
+    TEST_ASSERT_EQUAL(OTA_READY, l.getState());
+    TEST_ASSERT_TRUE(now - joined < 60000);
+    // Its first advert, fewer pages than theirs, made them start over
+    TEST_ASSERT_TRUE(services[0]->getTrickleIntervalMs() < OTA_TRICKLE_MAX_MS);
+}
+
+void test_parameter_update() {
+    const ConfigFieldValue values[] = {{CONFIG_FIELD_HEARTBEAT_INTERVAL_MS, 4000}};
+    uint8_t blob[CONFIG_OVERRIDE_MAX_BYTES];
+    size_t length = encodeConfigOverride(0, SWARM_CONFIG_HASH, values, 1, blob, sizeof(blob));
+    Bytes delta;
+    otaEncodeDelta(OTA_KIND_CONFIG, 12, nullptr, 0, blob, (uint32_t)length, delta);
+    TEST_ASSERT_TRUE(delta.size() < sizeof(OtaManifest) + length + 4);
+
+    std::mt19937 rng(8);
+    Bytes running = randomBytes(IMAGE_BYTES, rng);
+    Storage ground(running), drone(running);
+    load(ground.staging, delta);
+    load(drone.target, running);
+    OtaService g(1), d(2);
+    g.begin(&ground.staging, &ground.base, &ground.target, 0);
+    d.begin(&drone.staging, &drone.base, &drone.target, 0);
+    TEST_ASSERT_TRUE(g.publish(0));
+    std::vector<OtaService*> nodes = {&g, &d};
+    uint32_t now = 0;
+    exchange(nodes, now, 60000, [&]() { return finished(d); });
+
+    TEST_ASSERT_EQUAL(OTA_READY, d.getState());
+    TEST_ASSERT_EQUAL(OTA_KIND_CONFIG, d.getKind());
+    TEST_ASSERT_EQUAL(length, d.getParametersLength());
+    TunableConfig tuning = tunableDefaults();
+    TEST_ASSERT_EQUAL(CONFIG_OVERRIDE_OK, applyConfigOverride(d.getParameters(), d.getParametersLength(), 2, tuning));
+    TEST_ASSERT_EQUAL(4000, tuning.heartbeatIntervalMs);
+    // The other OTA slot is left alone
+    TEST_ASSERT_EQUAL_MEMORY(running.data(), drone.target.image(), IMAGE_BYTES);
+}
+
+// Simulated swarm update: the ground node (node 0) holds the delta, drones
+// are scattered so most are several hops from it, and every node runs the
+// service from a 50 ms main loop with carrier sense and random backoff.
+// Frames are lost to collisions and 5% at random. Reported: the time until
+// the last drone has verified the new image, against sending the whole
+// image the same way.
+
+#define SIM_LOOP_US 50000
+#define SIM_RANGE_M 300.0f
+#define SIM_LIMIT_S 7200
+
+struct OtaSimResult {
+    uint8_t hops;
+    double lastReadyS;
+    double medianReadyS;
+    uint32_t frames;
+    uint32_t dataFrames;
+    uint32_t adverts;
+    uint32_t requests;
+    uint32_t ready;
+};
+
+class OtaSimulation {
+private:
+    RadioSim sim;
+    uint8_t drones;
+    std::vector<std::unique_ptr<Storage>> flash;
+    std::vector<std::unique_ptr<OtaService>> services;
+    std::vector<std::deque<DroneMessage>> txQueues;
+    std::vector<double> readyAtS;
+    uint32_t frames;
+
+    uint32_t nowMs() { return (uint32_t)(sim.now() / 1000); }
+
+    void tryTransmit(uint8_t node) {
+        if (txQueues[node].empty() || sim.isTransmitting(node)) return;
+        if (sim.channelBusy(node)) {
+            std::uniform_int_distribution<uint32_t> backoff(1000, 100000);
+            sim.after(backoff(sim.rng()), [this, node]() { tryTransmit(node); });
+            return;
+        }
+        SecureFrame frame;
+        memset(&frame, 0, sizeof(frame));
+        frame.msg = txQueues[node].front();
+        txQueues[node].pop_front();
+        sim.transmit(node, &frame, sizeof(frame));
+        frames++;
+    }
+
+    void loopPass(uint8_t node) {
+        OtaService& ota = *services[node];
+        ota.service();
+        if (ota.getState() == OTA_READY) {
+            readyAtS[node] = sim.now() / 1e6;
+            ota.markInstalled();
+        }
+        // As sendDueReliable(): only what the radio can take now
+        if (txQueues[node].empty() && !sim.isTransmitting(node)) {
+            DroneMessage out[2];
+            uint8_t count = ota.poll(nowMs(), out, 2);
+            txQueues[node].insert(txQueues[node].end(), out, out + count);
+            tryTransmit(node);
+        }
+        sim.after(SIM_LOOP_US, [this, node]() { loopPass(node); });
+    }
+
+public:
+    OtaSimulation(uint8_t drones, const Bytes& running, const Bytes& delta, uint32_t seed)
+        : sim(drones + 1, seed), drones(drones), txQueues(drones + 1), readyAtS(drones + 1, -1), frames(0) {
+        sim.setRange(SIM_RANGE_M);
+        sim.setPacketReception(0.95f);
+        TEST_ASSERT_TRUE(sim.placeRandom(SIM_RANGE_M * 0.6f * sqrtf((float)(drones + 1)), 1000));
+        for (uint8_t i = 0; i <= drones; i++) {
+            flash.emplace_back(new Storage(running));
+            services.emplace_back(new OtaService(i));
+            services[i]->seed(seed * 31 + i);
+            services[i]->begin(&flash[i]->staging, &flash[i]->base, &flash[i]->target, 0);
+        }
+        load(flash[0]->staging, delta);
+        TEST_ASSERT_TRUE(services[0]->publish(0));
+
+        sim.onReceive([this](uint8_t node, const SimFrame& frame) {
+            const SecureFrame* secure = (const SecureFrame*)frame.payload.data();
+            services[node]->onFrame(secure->msg, nowMs());
+        });
+        sim.onTxDone([this](uint8_t node, const SimFrame&) { tryTransmit(node); });
+        std::uniform_int_distribution<uint32_t> phase(0, SIM_LOOP_US);
+        for (uint8_t i = 0; i <= drones; i++) {
+            sim.at(phase(sim.rng()), [this, i]() { loopPass(i); });
+        }
+    }
+
+    OtaSimResult run(const Bytes& expected) {
+        OtaSimResult r;
+        std::vector<uint8_t> hops;
+        r.hops = sim.hopsFrom(0, hops);
+        for (uint32_t s = 10; s <= SIM_LIMIT_S; s += 10) {
+            sim.run(s * 1000000ULL);
+            if (std::count_if(readyAtS.begin() + 1, readyAtS.end(), [](double t) { return t >= 0; }) == drones) {
+                break;
+            }
+        }
+        std::vector<double> times;
+        r.frames = frames;
+        r.dataFrames = r.adverts = r.requests = 0;
+        for (uint8_t i = 0; i <= drones; i++) {
+            OtaStats s = services[i]->getStats();
+            r.dataFrames += s.dataSent;
+            r.adverts += s.adverts;
+            r.requests += s.requests;
+            if (i > 0 && readyAtS[i] >= 0) {
+                times.push_back(readyAtS[i]);
+                TEST_ASSERT_EQUAL_MEMORY(expected.data(), flash[i]->target.image(), expected.size());
+            }
+        }
+        std::sort(times.begin(), times.end());
+        r.ready = (uint32_t)times.size();
+        r.lastReadyS = times.empty() ? 0 : times.back();
+        r.medianReadyS = times.empty() ? 0 : times[times.size() / 2];
+        return r;
+    }
+};
+
+void test_simulated_swarm_update() {
+    std::mt19937 rng(11);
+    Bytes running = randomBytes(IMAGE_BYTES, rng);
+    Bytes next = editImage(running, 12);
+    Bytes delta, full;
+    otaEncodeDelta(OTA_KIND_FIRMWARE, 21, running.data(), IMAGE_BYTES, next.data(), (uint32_t)next.size(), delta);
+    // No base: the whole image as literals, what a plain image push would send
+    otaEncodeDelta(OTA_KIND_FIRMWARE, 21, nullptr, 0, next.data(), (uint32_t)next.size(), full);
+    TEST_ASSERT_TRUE(full.size() > next.size());
+
+    uint32_t frameMs = loraAirtimeUs(loraDefaultPhy(), sizeof(SecureFrame)) / 1000;
+    printf("[SIM] swarm update over LoRa SF7/125 kHz (%u ms frames), %u-byte image, %u-byte delta "
+           "(%u pages), 5%% random loss, %.0f m range:\n", (unsigned)frameMs, (unsigned)next.size(),
+           (unsigned)delta.size(), (unsigned)((delta.size() + OTA_PAGE_BYTES - 1) / OTA_PAGE_BYTES), SIM_RANGE_M);
+    printf("[SIM]   drones  hops  payload  all ready s  median s  frames  data  adverts  requests\n");
+    static const uint8_t sizes[] = {5, 20, 50};
+    for (uint8_t drones : sizes) {
+        const Bytes* payloads[] = {&delta, &full};
+        double lastReady[2];
+        for (int p = 0; p < 2; p++) {
+            OtaSimulation sim(drones, running, *payloads[p], 100 + drones);
+            OtaSimResult r = sim.run(next);
+            printf("[SIM]   %6u  %4u  %-7s  %11.0f  %8.0f  %6u  %4u  %7u  %8u\n", drones, r.hops,
+                   p ? "image" : "delta", r.lastReadyS, r.medianReadyS, (unsigned)r.frames,
+                   (unsigned)r.dataFrames, (unsigned)r.adverts, (unsigned)r.requests);
+            TEST_ASSERT_EQUAL(drones, r.ready);
+            lastReady[p] = r.lastReadyS;
+        }
+        // The delta is a few percent of the image and so is its airtime
+        TEST_ASSERT_TRUE(lastReady[0] * 4 < lastReady[1]);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_delta_rebuilds_the_image);
+    RUN_TEST(test_wrong_base_and_corrupt_delta_are_refused);
+    RUN_TEST(test_only_missing_chunks_are_pulled);
+    RUN_TEST(test_trickle_backs_off_and_resets);
+    RUN_TEST(test_parameter_update);
+    RUN_TEST(test_simulated_swarm_update);
+    return UNITY_END();
+}
@@ -0,0 +1,146 @@
+// Performance monitor tests: histogram accuracy, concurrent recording,
+// status payload encoding and scope overhead
+// Run with: pio test -e native -f test_performance_monitor
+
+#include <unity.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "../../include/utilities/performance_monitor.h"
+
+static PerfMonitor monitor;
+
+void setUp() {
+    monitor.reset();
+}
+
+void tearDown() {}
+
+void test_bucket_bounds_are_monotonic_and_tight() {
+    uint8_t last = 0;
+    for (uint64_t v = 1; v <= 0xFFFFFFFFull; v += v / 7 + 1) {
+        uint8_t index = perfBucketIndex((uint32_t)v, PERF_HISTOGRAM_SUB_BITS);
+        TEST_ASSERT_TRUE(index >= last);
+        TEST_ASSERT_TRUE(index < PERF_BUCKETS);
+        last = index;
+
+        // The bucket's lower bound is within one sub-bucket of the value
+        uint32_t low = perfBucketLow(index, PERF_HISTOGRAM_SUB_BITS);
+        TEST_ASSERT_TRUE(low <= v);
+        TEST_ASSERT_TRUE(v - low <= low / PERF_SUB_BUCKETS + 1);
+    }
+    TEST_ASSERT_EQUAL(PERF_BUCKETS - 1, perfBucketIndex(0xFFFFFFFFu, PERF_HISTOGRAM_SUB_BITS));
+
+    // Wire encoding covers the full range in one byte
+    TEST_ASSERT_EQUAL(0, perfDecodeNs(perfEncodeNs(0)));
+    TEST_ASSERT_EQUAL(7, perfDecodeNs(perfEncodeNs(7)));
+    uint32_t big = 3000000000u;
+    TEST_ASSERT_TRUE(big - perfDecodeNs(perfEncodeNs(big)) <= big / 8);
+}
+
+void test_quantiles_follow_recorded_distribution() {
+    for (int i = 0; i < 900; i++) monitor.record(PERF_SEND, 1000);
+    for (int i = 0; i < 100; i++) monitor.record(PERF_SEND, 100000);
+    monitor.record(PERF_SEND, 5000000);
+
+    PerfSummary s = monitor.summarize(PERF_SEND);
+    TEST_ASSERT_EQUAL(1001, s.count);
+    TEST_ASSERT_UINT32_WITHIN(250, 1000, s.p50Ns);
+    TEST_ASSERT_UINT32_WITHIN(25000, 100000, s.p99Ns);
+    TEST_ASSERT_EQUAL(5000000, s.maxNs);
+    TEST_ASSERT_EQUAL(0, monitor.summarize(PERF_RECEIVE).count);
+}
+
+void test_concurrent_recording_loses_nothing() {
+    const int threads = 4, perThread = 200000;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([t]() {
+            for (int i = 0; i < perThread; i++) {
+                monitor.record(PERF_DISPATCH, 100 + (i & 1023) * (t + 1));
+            }
+        });
+    }
+    for (std::thread& w : workers) w.join();
+
+    PerfSummary s = monitor.summarize(PERF_DISPATCH);
+    TEST_ASSERT_EQUAL(threads * perThread, s.count);
+    TEST_ASSERT_EQUAL(100 + 1023 * threads, s.maxNs);
+}
+
+void test_status_payload_round_trips_across_frames() {
+    uint32_t expected[PERF_PROBE_COUNT] = {0};
+    for (uint8_t p = 0; p < PERF_PROBE_COUNT; p += 2) {
+        expected[p] = 10 + p;
+        for (uint32_t i = 0; i < expected[p]; i++) {
+            monitor.record((PerfProbe)p, 2000 * (p + 1));
+        }
+    }
+
+    uint8_t cursor = 0, frames = 0;
+    uint32_t decoded[PERF_PROBE_COUNT] = {0};
+    DroneMessage msg;
+    while (monitor.buildStatusResponse(3, 0, frames, cursor, msg)) {
+        frames++;
+        TEST_ASSERT_EQUAL(MSG_STATUS_RESPONSE, msg.messageType);
+        TEST_ASSERT_EQUAL(droneMessageChecksum(msg), msg.checksum);
+        TEST_ASSERT_TRUE(msg.dataLength <= sizeof(msg.data));
+
+        PerfStatusHeader header;
+        memcpy(&header, msg.data, sizeof(header));
+        TEST_ASSERT_EQUAL(STATUS_PERF_HISTOGRAMS, header.kind);
+        TEST_ASSERT_EQUAL(sizeof(header) + header.recordCount * sizeof(PerfStatusRecord), msg.dataLength);
+        for (uint8_t r = 0; r < header.recordCount; r++) {
+            PerfStatusRecord record;
+            memcpy(&record, msg.data + sizeof(header) + r * sizeof(record), sizeof(record));
+            decoded[record.probe] = record.count;
+            uint32_t ns = 2000 * (record.probe + 1);
+            TEST_ASSERT_TRUE(perfDecodeNs(record.p50) <= ns);
+            TEST_ASSERT_TRUE(perfDecodeNs(record.p50) >= ns * 5 / 8);
+        }
+    }
+
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(expected, decoded, PERF_PROBE_COUNT);
+    printf("[BENCH] %d active probes exported in %u frame(s) of %u bytes max\n",
+           (PERF_PROBE_COUNT + 1) / 2, frames, (unsigned)sizeof(msg.data));
+}
+
+static volatile uint32_t sink;
+
+void test_scope_overhead_is_small() {
+    perfMonitor.begin();
+    perfMonitor.reset();
+    const int iterations = 2000000;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        sink = sink + i;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        PERF_SCOPE(PERF_CHECKSUM);
+        sink = sink + i;
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    double bare = std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+    double scoped = std::chrono::duration<double, std::nano>(t2 - t1).count() / iterations;
+    PerfSummary s = perfMonitor.summarize(PERF_CHECKSUM);
+    printf("[BENCH] PERF_SCOPE overhead %.1f ns per scope (loop body %.1f ns), recorded p50 %lu ns\n",
+           scoped - bare, bare, (unsigned long)s.p50Ns);
+
+#if PERF_MONITOR_ENABLED
+    TEST_ASSERT_EQUAL(iterations, s.count);
+#endif
+    TEST_ASSERT_TRUE(scoped - bare < 200.0);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bucket_bounds_are_monotonic_and_tight);
+    RUN_TEST(test_quantiles_follow_recorded_distribution);
+    RUN_TEST(test_concurrent_recording_loses_nothing);
+    RUN_TEST(test_status_payload_round_trips_across_frames);
+    RUN_TEST(test_scope_overhead_is_small);
+    return UNITY_END();
+}
@@ -0,0 +1,366 @@
+// Message registry tests: the compile-time type table, typed payload views
+// over unaligned buffers, dispatch checks, and dispatch throughput against
+// the switch-and-cast decoding the main loops used before
+// Run with: pio test -e native -f test_protocols
+
+#include <unity.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <DroneProtocols.h>
+
+void setUp() {}
+void tearDown() {}
+
+struct Sink {
+    uint32_t heartbeats;
+    uint32_t targets;
+    uint32_t stops;
+    uint32_t requests;
+    uint32_t raw;
+    uint32_t rejected;
+    double sum;                 // Keeps the field reads live
+};
+
+static DroneMessage makeMessage(uint8_t type, const void* payload, uint8_t length) {
+    DroneMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.messageType = type;
+    msg.sourceId = 3;
+    msg.destinationId = 0xFF;
+    msg.dataLength = length;
+    if (payload) {
+        memcpy(msg.data, payload, length);
+    }
+    msg.checksum = droneMessageChecksum(msg);
+    return msg;
+}
+
+static HeartbeatData makeHeartbeat(uint8_t id) {
+    HeartbeatData hb;
+    hb.droneId = id;
+    hb.batteryLevel = 87.5f;
+    hb.latitude = 37.4219f;
+    hb.longitude = -122.084f;
+    hb.status = 1;
+    hb.missionState = 4;
+    return hb;
+}
+
+// The name switch both main files carried, plus types added since
+static const char* legacyTypeName(uint8_t type) {
+    switch (type) {
+        case MSG_HEARTBEAT: return "HEARTBEAT";
+        case MSG_GOSSIP: return "GOSSIP";
+        case MSG_MUTEX_REQUEST: return "MUTEX_REQUEST";
+        case MSG_MUTEX_RESPONSE: return "MUTEX_RESPONSE";
+        case MSG_RAFT_VOTE_REQUEST: return "RAFT_VOTE_REQUEST";
+        case MSG_RAFT_VOTE_RESPONSE: return "RAFT_VOTE_RESPONSE";
+        case MSG_MISSION_UPDATE: return "MISSION_UPDATE";
+        case MSG_TARGET_FOUND: return "TARGET_FOUND";
+        case MSG_EMERGENCY_STOP: return "EMERGENCY_STOP";
+        case MSG_STATUS_REQUEST: return "STATUS_REQUEST";
+        case MSG_STATUS_RESPONSE: return "STATUS_RESPONSE";
+        case MSG_BATCH: return "BATCH";
+        case MSG_LINK_STATE: return "LINK_STATE";
+        case MSG_RELIABLE: return "RELIABLE";
+        case MSG_FEC: return "FEC";
+        case MSG_OTA: return "OTA";
+        default: return "UNKNOWN";
+    }
+}
+
+void test_type_table_matches_enum() {
+    for (int type = 0; type < 256; type++) {
+        TEST_ASSERT_EQUAL_STRING(legacyTypeName((uint8_t)type), messageTypeName((uint8_t)type));
+    }
+    TEST_ASSERT_FALSE(messageInfo(0).known);
+    TEST_ASSERT_FALSE(messageInfo(0x11).known);
+    TEST_ASSERT_FALSE(messageInfo(0xFF).known);
+    TEST_ASSERT_EQUAL(sizeof(HeartbeatData), messageInfo(MSG_HEARTBEAT).minLength);
+    TEST_ASSERT_EQUAL(sizeof(HeartbeatData) + LINK_ROW_MAX_BYTES, messageInfo(MSG_HEARTBEAT).maxLength);
+    TEST_ASSERT_EQUAL(1, messageInfo(MSG_STATUS_REQUEST).minLength);
+    TEST_ASSERT_EQUAL(DP_MAX_PAYLOAD, messageInfo(MSG_GOSSIP).maxLength);
+    TEST_ASSERT_EQUAL(sizeof(EmergencyStopData), MessageTraits<MSG_EMERGENCY_STOP>::maxLength);
+}
+
+void test_view_reads_unaligned_little_endian() {
+    // Wire bytes spelled out, so the check holds whatever the host order
+    uint8_t buffer[1 + sizeof(TargetReportData)];
+    uint8_t* wire = buffer + 1;                 // Deliberately misaligned
+    wire[0] = 9;                                // reporterId
+    wire[1] = 0x34; wire[2] = 0x12;             // targetId 0x1234
+    wireStore<float>(wire + 3, 12.5f);
+    wireStore<float>(wire + 7, -3.25f);
+    wire[11] = 200; wire[12] = 100; wire[13] = 2;
+
+    PayloadView<TargetReportData> view(wire, sizeof(TargetReportData));
+    TEST_ASSERT_EQUAL(9, view.get(&TargetReportData::reporterId));
+    TEST_ASSERT_EQUAL_HEX16(0x1234, view.get(&TargetReportData::targetId));
+    TEST_ASSERT_EQUAL_FLOAT(12.5f, view.get(&TargetReportData::latitude));
+    TEST_ASSERT_EQUAL_FLOAT(-3.25f, view.get(&TargetReportData::longitude));
+    TEST_ASSERT_EQUAL(200, view.get(&TargetReportData::confidence));
+    TEST_ASSERT_EQUAL(2, view.get(&TargetReportData::targetClass));
+    TEST_ASSERT_EQUAL_HEX8(0x34, wire[1]);      // wireStore/get never wrote through the view
+
+    TargetReportData copy = view.load();
+    TEST_ASSERT_EQUAL(0x1234, copy.targetId);
+    TEST_ASSERT_EQUAL_FLOAT(-3.25f, copy.longitude);
+
+    // Variable-length payload: fields past dataLength read as zero
+    uint8_t shortRequest[3] = {STATUS_TELEMETRY_DELTA, 0xAA, 0xBB};
+    PayloadView<StatusRequestData> perfOnly(shortRequest, 1);
+    TEST_ASSERT_EQUAL(STATUS_TELEMETRY_DELTA, perfOnly.get(&StatusRequestData::kind));
+    TEST_ASSERT_EQUAL(0, perfOnly.get(&StatusRequestData::baseSnapshot));
+    TEST_ASSERT_EQUAL(0, perfOnly.load().baseSnapshot);
+    PayloadView<StatusRequestData> full(shortRequest, 3);
+    TEST_ASSERT_EQUAL_HEX16(0xBBAA, full.get(&StatusRequestData::baseSnapshot));
+    TEST_ASSERT_EQUAL_HEX16(0xBBAA, full.read<uint16_t>(1));
+    TEST_ASSERT_EQUAL(0, full.read<uint32_t>(0));
+}
+
+static void countHeartbeat(const DroneMessage& msg, PayloadView<HeartbeatData> hb, void* context) {
+    Sink* sink = (Sink*)context;
+    sink->heartbeats++;
+    sink->sum += hb.get(&HeartbeatData::batteryLevel) + hb.get(&HeartbeatData::droneId);
+}
+
+static void countRequest(const DroneMessage& msg, PayloadView<StatusRequestData> request, void* context) {
+    Sink* sink = (Sink*)context;
+    sink->requests++;
+    sink->sum += request.get(&StatusRequestData::kind) + request.get(&StatusRequestData::baseSnapshot);
+}
+
+void test_registry_checks_before_dispatch() {
+    MessageRegistry registry;
+    Sink sink;
+    memset(&sink, 0, sizeof(sink));
+    registry.on<MSG_HEARTBEAT, countHeartbeat>(&sink);
+    registry.on<MSG_STATUS_REQUEST, countRequest>(&sink);
+
+    HeartbeatData hb = makeHeartbeat(7);
+    TEST_ASSERT_EQUAL(DISPATCH_OK, registry.dispatch(makeMessage(MSG_HEARTBEAT, &hb, sizeof(hb))));
+    TEST_ASSERT_EQUAL(1, sink.heartbeats);
+    TEST_ASSERT_EQUAL_FLOAT(87.5f + 7, (float)sink.sum);
+
+    TEST_ASSERT_EQUAL(DISPATCH_BAD_LENGTH, registry.dispatch(makeMessage(MSG_HEARTBEAT, &hb, sizeof(hb) - 1)));
+    TEST_ASSERT_EQUAL(DISPATCH_BAD_LENGTH, registry.dispatch(makeMessage(MSG_STATUS_REQUEST, nullptr, 0)));
+    TEST_ASSERT_EQUAL(DISPATCH_UNKNOWN_TYPE, registry.dispatch(makeMessage(0x11, nullptr, 0)));
+    TEST_ASSERT_EQUAL(DISPATCH_UNKNOWN_TYPE, registry.dispatch(makeMessage(0xEE, nullptr, 0)));
+    TEST_ASSERT_EQUAL(DISPATCH_UNHANDLED, registry.dispatch(makeMessage(MSG_GOSSIP, nullptr, 4)));
+    TEST_ASSERT_EQUAL(1, sink.heartbeats);
+
+    uint8_t perf = 1;
+    TEST_ASSERT_EQUAL(DISPATCH_OK, registry.dispatch(makeMessage(MSG_STATUS_REQUEST, &perf, 1)));
+    TEST_ASSERT_EQUAL(1, sink.requests);
+
+    registry.remove(MSG_HEARTBEAT);
+    TEST_ASSERT_FALSE(registry.handles(MSG_HEARTBEAT));
+    TEST_ASSERT_EQUAL(DISPATCH_UNHANDLED, registry.dispatch(makeMessage(MSG_HEARTBEAT, &hb, sizeof(hb))));
+
+    DispatchStats stats = registry.getStats();
+    TEST_ASSERT_EQUAL(2, stats.dispatched);
+    TEST_ASSERT_EQUAL(2, stats.badLength);
+    TEST_ASSERT_EQUAL(2, stats.unknownType);
+    TEST_ASSERT_EQUAL(2, stats.unhandled);
+
+    PayloadView<HeartbeatData> view;
+    TEST_ASSERT_TRUE(payloadView<MSG_HEARTBEAT>(makeMessage(MSG_HEARTBEAT, &hb, sizeof(hb)), view));
+    TEST_ASSERT_EQUAL(7, view.get(&HeartbeatData::droneId));
+    TEST_ASSERT_FALSE(payloadView<MSG_HEARTBEAT>(makeMessage(MSG_TARGET_FOUND, &hb, sizeof(hb)), view));
+}
+
+// ---------------------------------------------------------------------------
+// Throughput: the same handlers behind the registry and behind the
+// switch-and-cast decoding from the main loops
+
+static void benchHeartbeat(const DroneMessage& msg, PayloadView<HeartbeatData> hb, void* context) {
+    Sink* sink = (Sink*)context;
+    sink->heartbeats++;
+    sink->sum += hb.get(&HeartbeatData::batteryLevel) + hb.get(&HeartbeatData::latitude) +
+                 hb.get(&HeartbeatData::status);
+}
+
+static void benchTarget(const DroneMessage& msg, PayloadView<TargetReportData> report, void* context) {
+    Sink* sink = (Sink*)context;
+    sink->targets++;
+    sink->sum += report.get(&TargetReportData::targetId) + report.get(&TargetReportData::longitude);
+}
+
+static void benchStop(const DroneMessage& msg, PayloadView<EmergencyStopData> stop, void* context) {
+    Sink* sink = (Sink*)context;
+    sink->stops++;
+    sink->sum += stop.get(&EmergencyStopData::stopId) + stop.get(&EmergencyStopData::hopCount);
+}
+
+static void benchRequest(const DroneMessage& msg, PayloadView<StatusRequestData> request, void* context) {
+    Sink* sink = (Sink*)context;
+    sink->requests++;
+    sink->sum += request.get(&StatusRequestData::kind);
+}
+
+static void benchGossip(const DroneMessage& msg, PayloadView<RawPayload> raw, void* context) {
+    Sink* sink = (Sink*)context;
+    sink->raw++;
+    sink->sum += raw.at(0);
+}
+
+static void switchAndCast(const DroneMessage& msg, Sink* sink) {
+    switch (msg.messageType) {
+        case MSG_HEARTBEAT:
+            if (msg.dataLength == sizeof(HeartbeatData)) {
+                HeartbeatData* hb = (HeartbeatData*)msg.data;
+                sink->heartbeats++;
+                sink->sum += hb->batteryLevel + hb->latitude + hb->status;
+                return;
+            }
+            break;
+        case MSG_TARGET_FOUND:
+            if (msg.dataLength == sizeof(TargetReportData)) {
+                TargetReportData* report = (TargetReportData*)msg.data;
+                sink->targets++;
+                sink->sum += report->targetId + report->longitude;
+                return;
+            }
+            break;
+        case MSG_EMERGENCY_STOP:
+            if (msg.dataLength == sizeof(EmergencyStopData)) {
+                EmergencyStopData* stop = (EmergencyStopData*)msg.data;
+                sink->stops++;
+                sink->sum += stop->stopId + stop->hopCount;
+                return;
+            }
+            break;
+        case MSG_STATUS_REQUEST:
+            if (msg.dataLength >= 1) {
+                sink->requests++;
+                sink->sum += ((StatusRequestData*)msg.data)->kind;
+                return;
+            }
+            break;
+        case MSG_GOSSIP:
+            sink->raw++;
+            sink->sum += msg.dataLength ? msg.data[0] : 0;
+            return;
+        default:
+            break;
+    }
+    sink->rejected++;
+}
+
+static std::vector<DroneMessage> mixedStream(size_t count) {
+    std::vector<DroneMessage> stream;
+    uint32_t seed = 0x2545F491;
+    HeartbeatData hb = makeHeartbeat(2);
+    TargetReportData report = {4, 0x0102, 37.0f, -122.0f, 200, 180, 1};
+    EmergencyStopData stop = {1, 9, 2, 0};
+    StatusRequestData request = {STATUS_TELEMETRY_DELTA, 3};
+    uint8_t gossip[12] = {5};
+    for (size_t i = 0; i < count; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        uint32_t pick = (seed >> 24) % 20;
+        if (pick < 8) stream.push_back(makeMessage(MSG_HEARTBEAT, &hb, sizeof(hb)));
+        else if (pick < 11) stream.push_back(makeMessage(MSG_TARGET_FOUND, &report, sizeof(report)));
+        else if (pick < 13) stream.push_back(makeMessage(MSG_EMERGENCY_STOP, &stop, sizeof(stop)));
+        else if (pick < 15) stream.push_back(makeMessage(MSG_STATUS_REQUEST, &request, sizeof(request)));
+        else if (pick < 18) stream.push_back(makeMessage(MSG_GOSSIP, gossip, sizeof(gossip)));
+        else if (pick < 19) stream.push_back(makeMessage(0x11, nullptr, 0));
+        else stream.push_back(makeMessage(MSG_HEARTBEAT, &hb, sizeof(hb) - 2));
+    }
+    return stream;
+}
+
+void test_dispatch_throughput_vs_switch() {
+    const size_t streamLength = 4096;
+    const int passes = 500;
+    std::vector<DroneMessage> stream = mixedStream(streamLength);
+
+    Sink viaRegistry, viaBatch, viaSwitch;
+    memset(&viaRegistry, 0, sizeof(viaRegistry));
+    memset(&viaBatch, 0, sizeof(viaBatch));
+    memset(&viaSwitch, 0, sizeof(viaSwitch));
+
+    // One registry per sink so each side's counters stand alone
+    MessageRegistry registry, batched;
+    registry.on<MSG_HEARTBEAT, benchHeartbeat>(&viaRegistry);
+    registry.on<MSG_TARGET_FOUND, benchTarget>(&viaRegistry);
+    registry.on<MSG_EMERGENCY_STOP, benchStop>(&viaRegistry);
+    registry.on<MSG_STATUS_REQUEST, benchRequest>(&viaRegistry);
+    registry.on<MSG_GOSSIP, benchGossip>(&viaRegistry);
+    batched.on<MSG_HEARTBEAT, benchHeartbeat>(&viaBatch);
+    batched.on<MSG_TARGET_FOUND, benchTarget>(&viaBatch);
+    batched.on<MSG_EMERGENCY_STOP, benchStop>(&viaBatch);
+    batched.on<MSG_STATUS_REQUEST, benchRequest>(&viaBatch);
+    batched.on<MSG_GOSSIP, benchGossip>(&viaBatch);
+
+    // Real handlers update state other code can see. Without this the
+    // compiler keeps the switch's counters in registers for the whole loop,
+    // which no main-loop handler would get
+    Sink* switchSink = &viaSwitch;
+    asm volatile("" : "+r"(switchSink) : : "memory");
+
+    // Interleaved rounds, best of each, so a slow patch on a shared host
+    // does not land on one side only
+    const int rounds = 5;
+    double singleSeconds = 1e9, batchSeconds = 1e9, switchSeconds = 1e9;
+    for (int round = 0; round < rounds; round++) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < passes; pass++) {
+            for (size_t i = 0; i < streamLength; i++) {
+                registry.dispatch(stream[i]);
+            }
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < passes; pass++) {
+            batched.dispatch(stream.data(), streamLength);
+        }
+        auto t2 = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < passes; pass++) {
+            for (size_t i = 0; i < streamLength; i++) {
+                switchAndCast(stream[i], switchSink);
+            }
+        }
+        auto t3 = std::chrono::steady_clock::now();
+        singleSeconds = std::min(singleSeconds, std::chrono::duration<double>(t1 - t0).count());
+        batchSeconds = std::min(batchSeconds, std::chrono::duration<double>(t2 - t1).count());
+        switchSeconds = std::min(switchSeconds, std::chrono::duration<double>(t3 - t2).count());
+    }
+
+    // Same decisions and the same decoded values every way
+    const Sink* registrySinks[2] = {&viaRegistry, &viaBatch};
+    const MessageRegistry* registries[2] = {&registry, &batched};
+    for (int side = 0; side < 2; side++) {
+        const Sink& sink = *registrySinks[side];
+        TEST_ASSERT_EQUAL(viaSwitch.heartbeats, sink.heartbeats);
+        TEST_ASSERT_EQUAL(viaSwitch.targets, sink.targets);
+        TEST_ASSERT_EQUAL(viaSwitch.stops, sink.stops);
+        TEST_ASSERT_EQUAL(viaSwitch.requests, sink.requests);
+        TEST_ASSERT_EQUAL(viaSwitch.raw, sink.raw);
+        // The registry counts its own rejections
+        DispatchStats stats = registries[side]->getStats();
+        TEST_ASSERT_EQUAL(viaSwitch.rejected, stats.unknownType + stats.badLength + stats.unhandled);
+        TEST_ASSERT_EQUAL_FLOAT((float)viaSwitch.sum, (float)sink.sum);
+    }
+    TEST_ASSERT_TRUE(viaSwitch.rejected > 0);
+
+    double total = (double)streamLength * passes;
+    double singleRate = total / singleSeconds;
+    double batchRate = total / batchSeconds;
+    double switchRate = total / switchSeconds;
+    printf("[BENCH] registry, per frame:  %.1f M msgs/s (%.1f ns/msg)\n", singleRate / 1e6, 1e9 / singleRate);
+    printf("[BENCH] registry, batched:    %.1f M msgs/s (%.1f ns/msg)\n", batchRate / 1e6, 1e9 / batchRate);
+    printf("[BENCH] switch-and-cast:      %.1f M msgs/s (%.1f ns/msg)\n", switchRate / 1e6, 1e9 / switchRate);
+    printf("[BENCH] mix: 40%% heartbeat, 15%% target, 10%% stop, 10%% status, 15%% gossip, 10%% invalid\n");
+    // A run of frames is where the table pays off: the next call target is
+    // known before the current handler finishes
+    TEST_ASSERT_TRUE(batchRate > switchRate);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_type_table_matches_enum);
+    RUN_TEST(test_view_reads_unaligned_little_endian);
+    RUN_TEST(test_registry_checks_before_dispatch);
+    RUN_TEST(test_dispatch_throughput_vs_switch);
+    return UNITY_END();
+}
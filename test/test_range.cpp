@@ -3,8 +3,9 @@
 // Use with one ESP32 as sender, another as receiver
 
 #include <Arduino.h>
-#include "../include/communication.h"
+#include "../include/communications.h"
 #include "../include/config.h"
+#include "../include/utilities/crypto_utils.h"
 
 // Test Configuration
 #define TEST_NODE_ID 99
@@ -22,7 +23,9 @@ struct RangeTestData {
     uint8_t expectedRSSI;   // Expected RSSI for this distance
 } __attribute__((packed));
 
-DroneComm comm(TEST_NODE_ID);
+static const uint8_t networkKey[CRYPTO_KEY_BYTES] = SWARM_NETWORK_KEY;
+SecureLink secureLink(TEST_NODE_ID, networkKey);
+DroneComm comm(TEST_NODE_ID, &secureLink);
 uint32_t testNumber = 0;
 uint32_t successfulTests = 0;
 
@@ -55,7 +58,7 @@ void setup() {
     Serial.println("[TEST]    • Test at each distance: " + String(TESTS_PER_DISTANCE) + " times");
     Serial.println("[TEST]    • Test interval: " + String(TEST_INTERVAL/1000) + " seconds");
     Serial.println("[TEST]    • Max TX power: 20 dBm");
-    Serial.println("[TEST]    • Frequency: " + String(LORA_DEFAULT_FREQUENCY/1E6) + " MHz");
+    Serial.println("[TEST]    • Frequency: " + String(LORA_FREQUENCY/1E6) + " MHz");
     
     Serial.println("\n[TEST] 📏 Test Distances (meters):");
     for (int i = 0; i < sizeof(testDistances)/sizeof(float); i++) {
@@ -0,0 +1,244 @@
+// Sensor pipeline tests and host replay benchmark
+// Run with: pio test -e native -f test_sensor_integration
+// Set SENSOR_REPLAY_LOG=<file> to replay a recorded NMEA/BMP log instead of
+// the synthetic one.
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include "../../include/target_detection/sensor_integration.h"
+
+static void nmeaSentence(char* out, size_t size, const char* body) {
+    uint8_t checksum = 0;
+    for (const char* p = body; *p; p++) {
+        checksum ^= (uint8_t)*p;
+    }
+    snprintf(out, size, "$%s*%02X\r\n", body, checksum);
+}
+
+static bool feedAll(NmeaParser& parser, const char* text) {
+    bool any = false;
+    while (*text) {
+        any |= parser.feed(*text++);
+    }
+    return any;
+}
+
+// Degrees to NMEA ddmm.mmmmm
+static void formatCoordinate(char* out, size_t size, double degrees, int degreeDigits) {
+    double a = fabs(degrees);
+    int d = (int)a;
+    double minutes = (a - d) * 60.0;
+    snprintf(out, size, "%0*d%08.5f", degreeDigits, d, minutes);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_parse_fixed_point_fields() {
+    TEST_ASSERT_EQUAL(12345, NmeaParser::parseDecimal("123.45", 2));
+    TEST_ASSERT_EQUAL(12340, NmeaParser::parseDecimal("123.4", 2));
+    TEST_ASSERT_EQUAL(-5000, NmeaParser::parseDecimal("-5", 3));
+    TEST_ASSERT_EQUAL(481173000, NmeaParser::parseCoordinateE7("4807.038"));
+    TEST_ASSERT_EQUAL(115166667, NmeaParser::parseCoordinateE7("01131.000"));
+}
+
+void test_gga_sentence_updates_fix() {
+    NmeaParser parser;
+    char sentence[96];
+    nmeaSentence(sentence, sizeof(sentence), "GPGGA,123519.25,4807.038,N,01131.000,W,1,08,0.9,545.4,M,46.9,M,,");
+
+    TEST_ASSERT_TRUE(feedAll(parser, sentence));
+    const GpsFix& fix = parser.getFix();
+    TEST_ASSERT_TRUE(fix.valid);
+    TEST_ASSERT_EQUAL(481173000, fix.latitudeE7);
+    TEST_ASSERT_EQUAL(-115166667, fix.longitudeE7);
+    TEST_ASSERT_EQUAL(54540, fix.altitudeCm);
+    TEST_ASSERT_EQUAL(8, fix.satellites);
+    TEST_ASSERT_EQUAL(90, fix.hdopX100);
+    TEST_ASSERT_EQUAL(12 * 3600000UL + 35 * 60000UL + 19250, fix.timeOfDayMs);
+}
+
+void test_rmc_keeps_altitude_and_adds_speed() {
+    NmeaParser parser;
+    char sentence[96];
+    nmeaSentence(sentence, sizeof(sentence), "GNGGA,000001.00,2842.246,N,07706.150,E,1,10,0.8,215.0,M,,M,,");
+    feedAll(parser, sentence);
+    nmeaSentence(sentence, sizeof(sentence), "GNRMC,000002.00,A,2842.250,N,07706.155,E,10.0,84.4,230394,,");
+    TEST_ASSERT_TRUE(feedAll(parser, sentence));
+
+    const GpsFix& fix = parser.getFix();
+    TEST_ASSERT_TRUE(fix.valid);
+    TEST_ASSERT_EQUAL(21500, fix.altitudeCm);
+    TEST_ASSERT_EQUAL(514, fix.speedCmS);
+}
+
+void test_bad_checksum_and_garbage_are_rejected() {
+    NmeaParser parser;
+    TEST_ASSERT_FALSE(feedAll(parser, "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,,M,,*00\r\n"));
+    TEST_ASSERT_EQUAL(1, parser.getChecksumErrors());
+    TEST_ASSERT_FALSE(feedAll(parser, "noise$GPGSV,3,1,11*ZZ\r\n$GPGGA,truncated\r\n"));
+    TEST_ASSERT_FALSE(parser.getFix().valid);
+
+    char sentence[96];
+    nmeaSentence(sentence, sizeof(sentence), "GPGSV,3,1,11,03,03,111,00");
+    TEST_ASSERT_FALSE(feedAll(parser, sentence));
+    TEST_ASSERT_GREATER_OR_EQUAL(1, parser.getIgnoredCount());
+}
+
+void test_pressure_table_matches_barometric_formula() {
+    for (int32_t p = 80000; p <= 105000; p += 777) {
+        float expected = 4433000.0f * (1.0f - powf((float)p / SEA_LEVEL_PRESSURE_PA, 0.1903f));
+        TEST_ASSERT_FLOAT_WITHIN(30.0f, expected, AltitudeFilter::pressureToAltitudeCm(p));
+    }
+}
+
+void test_altitude_filter_removes_baro_offset() {
+    AltitudeFilter filter;
+    int32_t pressure = 100000;
+    int32_t baroAltitude = AltitudeFilter::pressureToAltitudeCm(pressure);
+
+    // GPS says we are 5 m higher than the baro thinks
+    for (int i = 0; i < 400; i++) {
+        filter.addBaro(pressure);
+        if (i % 5 == 0) filter.addGps(baroAltitude + 500);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(20.0f, baroAltitude + 500, filter.getAltitudeCm());
+}
+
+void test_alpha_beta_tracks_constant_velocity() {
+    AlphaBetaFilter filter(32768, 6554);
+    // 1000 units/s with +-200 alternating noise
+    for (int i = 0; i <= 50; i++) {
+        int32_t noise = (i % 2) ? 200 : -200;
+        filter.update(i * 100 + noise, i * 100);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(300.0f, 5000.0f, filter.getValue());
+    TEST_ASSERT_FLOAT_WITHIN(200.0f, 1000.0f, filter.getVelocity());
+}
+
+void test_ring_counts_drops_when_full() {
+    SpscRing<uint8_t, 8> ring;
+    for (int i = 0; i < 10; i++) ring.push((uint8_t)i);
+    TEST_ASSERT_EQUAL(8, ring.size());
+    TEST_ASSERT_EQUAL(2, ring.getDropped());
+    uint8_t v;
+    TEST_ASSERT_TRUE(ring.pop(v));
+    TEST_ASSERT_EQUAL(0, v);
+}
+
+void test_publisher_never_returns_torn_state() {
+    FusedStatePublisher publisher;
+    FusedSensorState out;
+    TEST_ASSERT_FALSE(publisher.read(out));
+
+    std::atomic<bool> done(false);
+    std::thread writer([&]() {
+        FusedSensorState s;
+        memset(&s, 0, sizeof(s));
+        for (int32_t i = 1; i < 200000; i++) {
+            s.latitudeE7 = i;
+            s.longitudeE7 = -i;
+            s.altitudeCm = i * 2;
+            publisher.publish(s);
+        }
+        done = true;
+    });
+
+    uint32_t reads = 0, torn = 0;
+    while (!done) {
+        if (publisher.read(out)) {
+            reads++;
+            if (out.longitudeE7 != -out.latitudeE7 || out.altitudeCm != out.latitudeE7 * 2) torn++;
+        }
+    }
+    writer.join();
+    TEST_ASSERT_EQUAL(0, torn);
+    TEST_ASSERT_TRUE(publisher.read(out));
+}
+
+static const char* writeSyntheticLog() {
+    static char path[] = "/tmp/sensor_replay_XXXXXX";
+    int fd = mkstemp(path);
+    FILE* f = fdopen(fd, "w");
+
+    // 10 minutes: GGA+RMC at 5 Hz, BMP280 at 25 Hz, drone flying north-east
+    char body[160], lat[32], lon[32], sentence[176];
+    for (uint32_t ms = 0; ms < 600000; ms += 40) {
+        double pressure = 99000.0 - ms / 6000.0;
+        fprintf(f, "BMP,%lu,%ld,24.5\n", (unsigned long)ms, (long)pressure);
+
+        if (ms % 200 == 0) {
+            double latitude = 28.7041 + ms * 1e-9;
+            double longitude = 77.1025 + ms * 1e-9;
+            formatCoordinate(lat, sizeof(lat), latitude, 2);
+            formatCoordinate(lon, sizeof(lon), longitude, 3);
+            uint32_t t = ms % 86400000;
+            char hhmmss[16];
+            snprintf(hhmmss, sizeof(hhmmss), "%02lu%02lu%02lu.%02lu", (unsigned long)(t / 3600000),
+                     (unsigned long)(t / 60000 % 60), (unsigned long)(t / 1000 % 60), (unsigned long)(t % 1000 / 10));
+
+            snprintf(body, sizeof(body), "GPGGA,%s,%s,N,%s,E,1,09,0.9,%.1f,M,,M,,", hhmmss, lat, lon, 180.0 + ms / 10000.0);
+            nmeaSentence(sentence, sizeof(sentence), body);
+            fputs(sentence, f);
+            snprintf(body, sizeof(body), "GPRMC,%s,A,%s,N,%s,E,12.5,45.0,010126,,", hhmmss, lat, lon);
+            nmeaSentence(sentence, sizeof(sentence), body);
+            fputs(sentence, f);
+        }
+    }
+    fclose(f);
+    return path;
+}
+
+void benchmark_replay_log() {
+    const char* path = getenv("SENSOR_REPLAY_LOG");
+    bool synthetic = (path == nullptr);
+    if (synthetic) {
+        path = writeSyntheticLog();
+    }
+
+    SensorPipeline pipeline;
+    SensorReplayReport report;
+    TEST_ASSERT_TRUE(replaySensorLog(pipeline, path, report));
+
+    SensorPipelineStats stats = pipeline.getStats();
+    printf("[BENCH] sensor replay (%s): %lu lines, %lu samples in %.3f s\n",
+           synthetic ? "synthetic" : path, (unsigned long)report.lines,
+           (unsigned long)report.samples, report.seconds);
+    printf("[BENCH]    throughput: %.0f samples/sec\n", report.samplesPerSec);
+    printf("[BENCH]    parse latency: mean %.0f ns, max %.0f ns per sample\n",
+           report.meanParseNs, report.maxParseNs);
+    printf("[BENCH]    %lu sentences, %lu checksum errors, %lu fixes, %lu baro samples\n",
+           (unsigned long)stats.nmeaSentences, (unsigned long)stats.nmeaChecksumErrors,
+           (unsigned long)stats.gpsFixes, (unsigned long)stats.baroSamples);
+
+    if (synthetic) {
+        TEST_ASSERT_EQUAL(0, stats.nmeaChecksumErrors);
+        TEST_ASSERT_EQUAL(0, stats.nmeaDropped);
+        TEST_ASSERT_EQUAL(6000, stats.gpsFixes);
+        TEST_ASSERT_EQUAL(15000, stats.baroSamples);
+
+        FusedSensorState state;
+        TEST_ASSERT_TRUE(pipeline.getLatest(state));
+        TEST_ASSERT_TRUE(state.hasFix);
+        TEST_ASSERT_FLOAT_WITHIN(200.0f, (28.7041 + 599800 * 1e-9) * 1e7, state.latitudeE7);
+        TEST_ASSERT_FLOAT_WITHIN(300.0f, 180.0f * 100 + 5998.0f, state.altitudeCm);
+        remove(path);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_fixed_point_fields);
+    RUN_TEST(test_gga_sentence_updates_fix);
+    RUN_TEST(test_rmc_keeps_altitude_and_adds_speed);
+    RUN_TEST(test_bad_checksum_and_garbage_are_rejected);
+    RUN_TEST(test_pressure_table_matches_barometric_formula);
+    RUN_TEST(test_altitude_filter_removes_baro_offset);
+    RUN_TEST(test_alpha_beta_tracks_constant_velocity);
+    RUN_TEST(test_ring_counts_drops_when_full);
+    RUN_TEST(test_publisher_never_returns_torn_state);
+    RUN_TEST(benchmark_replay_log);
+    return UNITY_END();
+}
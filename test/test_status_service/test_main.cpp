@@ -0,0 +1,298 @@
+// Status telemetry tests: varint coding, delta round trips, fragment loss,
+// truncation and the airtime the service costs a polled swarm
+// Run with: pio test -e native -f test_status_service
+
+#include <unity.h>
+#include <memory>
+#include <random>
+#include <vector>
+#include "../../include/communications/status_service.h"
+#include "../../include/communications/lora_interface.h"
+#include "../../include/ground_station/telemetry_collector.h"
+#include "../../include/utilities/varint.h"
+#include "../../include/utilities/crypto_utils.h"
+
+#define GROUND_ID 0
+
+// One simulated drone: the state the status service reads from
+struct DroneFixture {
+    uint8_t id;
+    PerfMonitor perf;
+    PeerTable peers;
+    CommStats comm;
+    StatusService service;
+
+    explicit DroneFixture(uint8_t id) : id(id), service(id, &perf, &peers) {
+        memset(&comm, 0, sizeof(comm));
+    }
+
+    void hearPeer(uint8_t peerId, uint8_t missionState, int rssi, uint32_t now) {
+        HeartbeatData hb;
+        memset(&hb, 0, sizeof(hb));
+        hb.droneId = peerId;
+        hb.missionState = missionState;
+        peers.update(hb, rssi, 7.5f, now);
+        comm.messagesReceived++;
+        comm.lastRSSI = rssi;
+        comm.lastSNR = 7.5f;
+    }
+};
+
+static DroneMessage frames[STATUS_MAX_FRAMES];
+
+// Request/response exchange; `drop` names a fragment to lose, -1 for none
+static uint8_t poll(TelemetryCollector& ground, DroneFixture& drone, uint32_t now, int drop = -1) {
+    DroneMessage request;
+    ground.buildRequest(drone.id, now, request);
+    uint8_t count = drone.service.handleRequest(request, drone.comm, now, frames);
+    for (uint8_t f = 0; f < count; f++) {
+        TEST_ASSERT_EQUAL(droneMessageChecksum(frames[f]), frames[f].checksum);
+        if (f != drop) ground.onFrame(frames[f], now + 100);
+    }
+    return count;
+}
+
+static void assertMatchesDrone(TelemetryCollector& ground, DroneFixture& drone, uint32_t now) {
+    const TelemetrySnapshot* state = ground.getState(drone.id);
+    TEST_ASSERT_NOT_NULL(state);
+    TEST_ASSERT_EQUAL(now, state->counters[TEL_UPTIME_MS]);
+    TEST_ASSERT_EQUAL(drone.comm.messagesSent, state->counters[TEL_MESSAGES_SENT]);
+    TEST_ASSERT_EQUAL(drone.comm.messagesReceived, state->counters[TEL_MESSAGES_RECEIVED]);
+    TEST_ASSERT_EQUAL(drone.comm.lastRSSI, (int32_t)state->counters[TEL_LAST_RSSI]);
+
+    TEST_ASSERT_EQUAL(drone.peers.size(), state->peerCount);
+    for (uint8_t i = 0; i < PEER_TABLE_SIZE; i++) {
+        const PeerEntry* e = drone.peers.at(i);
+        if (!e) continue;
+        const TelemetryPeer* peer = telemetryFindPeer(*state, e->id);
+        TEST_ASSERT_NOT_NULL(peer);
+        TEST_ASSERT_EQUAL(e->heartbeats, peer->heartbeats);
+        TEST_ASSERT_EQUAL(e->lastSeen, peer->lastSeen);
+        TEST_ASSERT_EQUAL(e->lastRssi, peer->rssi);
+        TEST_ASSERT_EQUAL(e->missionState, peer->state >> 4);
+    }
+
+    for (uint8_t p = 0; p < PERF_PROBE_COUNT; p++) {
+        uint32_t total = 0;
+        for (uint16_t b = 0; b < TELEMETRY_BUCKETS; b++) total += state->buckets[p][b];
+        TEST_ASSERT_EQUAL(drone.perf.summarize((PerfProbe)p).count, total);
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_varint_and_zigzag_round_trip() {
+    const uint32_t values[] = {0, 1, 127, 128, 16383, 16384, 0x0FFFFFFF, 0xFFFFFFFF};
+    uint8_t buffer[5];
+    for (uint32_t v : values) {
+        size_t n = varintWrite(buffer, sizeof(buffer), v);
+        TEST_ASSERT_EQUAL(varintSize(v), n);
+        uint32_t back;
+        TEST_ASSERT_EQUAL(n, varintRead(buffer, n, back));
+        TEST_ASSERT_EQUAL(v, back);
+        TEST_ASSERT_EQUAL(0, varintRead(buffer, n - 1, back));   // Truncated
+    }
+    TEST_ASSERT_EQUAL(0, varintWrite(buffer, 1, 300));
+
+    const int32_t deltas[] = {0, -1, 1, -64, 63, -2147483647 - 1, 2147483647};
+    for (int32_t d : deltas) {
+        TEST_ASSERT_EQUAL(d, zigzagDecode(zigzagEncode(d)));
+    }
+    TEST_ASSERT_EQUAL(1, varintSize(zigzagEncode(-64)));
+}
+
+void test_deltas_track_drone_state() {
+    std::unique_ptr<DroneFixture> drone(new DroneFixture(3));
+    TelemetryCollector ground(GROUND_ID);
+
+    uint32_t now = 1000;
+    for (uint8_t peer = 1; peer <= 4; peer++) drone->hearPeer(peer, 2, -70 - peer, now);
+    for (int i = 0; i < 500; i++) drone->perf.record(PERF_DISPATCH, 2000 + i * 7);
+    drone->comm.messagesSent = 42;
+
+    poll(ground, *drone, now);
+    assertMatchesDrone(ground, *drone, now);
+    StatusServiceStats s = drone->service.getStats();
+    TEST_ASSERT_EQUAL(1, s.resyncs);
+    size_t fullBytes = s.bytesSent;
+
+    // Quiet interval: only the clock moved
+    now += 5000;
+    TEST_ASSERT_EQUAL(1, poll(ground, *drone, now));
+    assertMatchesDrone(ground, *drone, now);
+    s = drone->service.getStats();
+    TEST_ASSERT_TRUE(s.bytesSent - fullBytes <= 5);
+
+    // One peer drops out, another changes state, counters move
+    drone->peers.expire(now + HEARTBEAT_TIMEOUT_MS);
+    now += HEARTBEAT_TIMEOUT_MS + 1;
+    drone->hearPeer(2, 3, -60, now);
+    drone->hearPeer(9, 1, -90, now);
+    drone->comm.messagesSent += 3;
+    for (int i = 0; i < 50; i++) drone->perf.record(PERF_SEND, 90000);
+    poll(ground, *drone, now);
+    assertMatchesDrone(ground, *drone, now);
+
+    s = drone->service.getStats();
+    TEST_ASSERT_EQUAL(1, s.resyncs);
+    TEST_ASSERT_EQUAL(2, s.deltas);
+    const std::vector<TelemetryPoint>* series = ground.getSeries(3);
+    TEST_ASSERT_EQUAL(3, series->size());
+    TEST_ASSERT_EQUAL(50, series->back().probes[PERF_SEND].count);
+    TEST_ASSERT_EQUAL(0, series->back().probes[PERF_DISPATCH].count);   // Interval, not cumulative
+    TEST_ASSERT_UINT32_WITHIN(45000, 90000, series->back().probes[PERF_SEND].p50Ns);
+}
+
+void test_lost_fragment_recovers_without_resync() {
+    std::unique_ptr<DroneFixture> drone(new DroneFixture(4));
+    TelemetryCollector ground(GROUND_ID);
+
+    uint32_t now = 1000;
+    for (uint8_t peer = 10; peer < 16; peer++) drone->hearPeer(peer, 2, -80, now);
+    poll(ground, *drone, now);
+
+    // A busy interval needs several frames; lose one of them
+    now += 10000;
+    for (uint8_t peer = 10; peer < 16; peer++) drone->hearPeer(peer, 2, -75, now);
+    for (int i = 0; i < 2000; i++) drone->perf.record((PerfProbe)(i % 3), 1000 + (i % 200) * 50);
+    uint8_t count = poll(ground, *drone, now, 1);
+    TEST_ASSERT_TRUE(count > 1);
+    TEST_ASSERT_EQUAL(1, ground.getSeries(4)->size());
+
+    // The next request still names the first snapshot; no resync needed
+    now += 10000;
+    drone->comm.messagesLost++;
+    poll(ground, *drone, now);
+    assertMatchesDrone(ground, *drone, now);
+    TEST_ASSERT_EQUAL(1, drone->service.getStats().resyncs);
+    TEST_ASSERT_EQUAL(1, ground.getStats().resyncs);
+    TEST_ASSERT_EQUAL(2, ground.getSeries(4)->size());
+
+    // A collector that lost its state entirely gets absolute values
+    TelemetryCollector restarted(GROUND_ID);
+    poll(restarted, *drone, now + 1);
+    assertMatchesDrone(restarted, *drone, now + 1);
+    TEST_ASSERT_EQUAL(2, drone->service.getStats().resyncs);
+}
+
+void test_oversized_change_catches_up_over_polls() {
+    std::unique_ptr<DroneFixture> drone(new DroneFixture(5));
+    TelemetryCollector ground(GROUND_ID);
+
+    std::mt19937 rng(7);
+    std::lognormal_distribution<double> latency(9.0, 2.0);
+    uint32_t now = 1000;
+    for (uint8_t peer = 1; peer <= PEER_TABLE_SIZE; peer++) drone->hearPeer(peer, 2, -60 - peer, now);
+    for (int i = 0; i < 20000; i++) {
+        drone->perf.record((PerfProbe)(i % PERF_PROBE_COUNT), (uint32_t)latency(rng) + 1);
+    }
+
+    uint8_t polls = 0;
+    do {
+        TEST_ASSERT_TRUE(poll(ground, *drone, now) <= STATUS_MAX_FRAMES);
+        polls++;
+    } while (drone->service.getStats().truncated == polls && polls < 10);
+
+    assertMatchesDrone(ground, *drone, now);
+    TEST_ASSERT_TRUE(polls > 1);
+    printf("[BENCH] full state (%d peers, %d probes) took %u polls of <= %d frames\n", PEER_TABLE_SIZE,
+           PERF_PROBE_COUNT, polls, STATUS_MAX_FRAMES);
+}
+
+// Ground station polls every drone once per STATUS_POLL_INTERVAL_MS. Each
+// drone hears every other drone's heartbeat and records hot-path latencies
+// at a realistic rate. Airtime covers requests and every response frame.
+struct OverheadResult {
+    double deltaPercent;
+    double fullPercent;
+    double framesPerPoll;
+};
+
+static OverheadResult simulateOverhead(uint8_t droneCount, uint32_t pollIntervalMs, uint32_t durationMs) {
+    std::vector<std::unique_ptr<DroneFixture>> drones;
+    for (uint8_t i = 0; i < droneCount; i++) {
+        drones.emplace_back(new DroneFixture(i + 1));
+    }
+    std::unique_ptr<TelemetrySnapshot> zero(new TelemetrySnapshot());
+    std::vector<uint8_t> fullStream(4096);
+    TelemetryCollector ground(GROUND_ID);
+    std::mt19937 rng(droneCount);
+    std::lognormal_distribution<double> latency(10.0, 0.8);
+    std::uniform_int_distribution<int> rssi(-95, -60);
+
+    uint32_t frameUs = loraAirtimeUs(loraDefaultPhy(), sizeof(SecureFrame));
+    uint64_t deltaUs = 0, fullUs = 0;
+    uint32_t polls = 0, deltaFrames = 0;
+    uint32_t pollGapMs = pollIntervalMs / droneCount;
+    uint32_t nextPoll = pollIntervalMs, nextDrone = 0;
+
+    for (uint32_t now = 0; now < durationMs; now += HEARTBEAT_INTERVAL_MS) {
+        for (uint8_t i = 0; i < droneCount; i++) {
+            DroneFixture& d = *drones[i];
+            d.comm.messagesSent++;
+            for (uint8_t j = 0; j < droneCount; j++) {
+                if (j != i) d.hearPeer(j + 1, 2, rssi(rng), now + j);
+            }
+            d.peers.expire(now);
+            for (uint8_t k = 0; k < droneCount; k++) {
+                d.perf.record(PERF_RECEIVE, (uint32_t)latency(rng));
+                d.perf.record(PERF_CHECKSUM, (uint32_t)latency(rng) / 8);
+                d.perf.record(PERF_DISPATCH, (uint32_t)latency(rng) * 4);
+                d.perf.record(PERF_HANDLER_HEARTBEAT, (uint32_t)latency(rng));
+            }
+            d.perf.record(PERF_SEND, (uint32_t)latency(rng) * 20);
+        }
+
+        while (nextPoll <= now) {
+            DroneFixture& d = *drones[nextDrone];
+            uint8_t count = poll(ground, d, nextPoll);
+            deltaFrames += count;
+            deltaUs += (uint64_t)(count + 1) * frameUs;
+
+            // The same state sent as absolute values, without the frame cap
+            size_t fullBytes = telemetryEncode(*zero, *ground.getState(d.id), fullStream.data(), fullStream.size());
+            fullUs += (uint64_t)((fullBytes + TELEMETRY_FRAGMENT_BYTES - 1) / TELEMETRY_FRAGMENT_BYTES + 1) * frameUs;
+
+            polls++;
+            nextDrone = (nextDrone + 1) % droneCount;
+            nextPoll += pollGapMs;
+        }
+    }
+
+    for (uint8_t i = 0; i < droneCount; i++) {
+        TEST_ASSERT_NOT_NULL(ground.getState(i + 1));
+    }
+    TEST_ASSERT_EQUAL(droneCount, ground.getStats().resyncs);   // Only the first poll of each drone
+
+    OverheadResult result;
+    result.deltaPercent = 100.0 * deltaUs / (durationMs * 1000.0);
+    result.fullPercent = 100.0 * fullUs / (durationMs * 1000.0);
+    result.framesPerPoll = (double)deltaFrames / polls;
+    return result;
+}
+
+void test_telemetry_airtime_overhead() {
+    const uint8_t sizes[] = {MAX_DRONES, 10, PEER_TABLE_SIZE + 1};
+    const uint32_t durationMs = 30 * 60 * 1000;
+    OverheadResult atDefault = {0, 0, 0};
+    for (uint8_t n : sizes) {
+        OverheadResult r = simulateOverhead(n, STATUS_POLL_INTERVAL_MS, durationMs);
+        printf("[SIM] %2u drones, each polled every %lu s: %.2f frames/poll, telemetry uses %.2f%% of channel "
+               "airtime (full snapshots: %.2f%%)\n", n, (unsigned long)(STATUS_POLL_INTERVAL_MS / 1000),
+               r.framesPerPoll, r.deltaPercent, r.fullPercent);
+        TEST_ASSERT_TRUE(r.deltaPercent < r.fullPercent);
+        if (n == MAX_DRONES) atDefault = r;
+    }
+    TEST_ASSERT_TRUE(atDefault.deltaPercent < 5.0);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_varint_and_zigzag_round_trip);
+    RUN_TEST(test_deltas_track_drone_state);
+    RUN_TEST(test_lost_fragment_recovers_without_resync);
+    RUN_TEST(test_oversized_change_catches_up_over_polls);
+    RUN_TEST(test_telemetry_airtime_overhead);
+    return UNITY_END();
+}
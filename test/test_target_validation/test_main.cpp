@@ -0,0 +1,219 @@
+// Target fusion tests and host benchmark
+// Run with: pio test -e native -f test_target_validation
+
+#include <unity.h>
+#include <chrono>
+#include <random>
+#include "../../include/target_detection/target_validation.h"
+
+#define BASE_LAT 28.7041f
+#define BASE_LON 77.1025f
+#define DEG_PER_METER (1.0f / 111320.0f)
+
+static TargetReportData makeReport(uint8_t reporter, float northM, float eastM, uint8_t confidence) {
+    TargetReportData r;
+    r.reporterId = reporter;
+    r.targetId = 1;
+    r.latitude = BASE_LAT + northM * DEG_PER_METER;
+    r.longitude = BASE_LON + eastM * DEG_PER_METER / cosf(BASE_LAT * (float)M_PI / 180.0f);
+    r.confidence = confidence;
+    r.sensorQuality = 200;
+    r.targetClass = 1;
+    return r;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_duplicate_reports_fuse_into_one_track() {
+    TargetTrackStore store;
+    store.setOrigin(BASE_LAT, BASE_LON);
+
+    int16_t a = store.ingest(makeReport(1, 100, 100, 180), -70, 8.0f, 1000);
+    int16_t b = store.ingest(makeReport(2, 103, 98, 180), -80, 5.0f, 1010);
+    int16_t c = store.ingest(makeReport(3, 99, 102, 180), -90, 2.0f, 1020);
+
+    TEST_ASSERT_EQUAL(a, b);
+    TEST_ASSERT_EQUAL(a, c);
+    TEST_ASSERT_EQUAL(1, store.getActiveCount());
+
+    // Three independent sightings are worth more than any one of them
+    const TargetTrack* t = store.getTrack(a);
+    TEST_ASSERT_NOT_NULL(t);
+    TEST_ASSERT_EQUAL(3, t->reporterCount);
+    TEST_ASSERT_GREATER_THAN(180.0f / 255.0f, t->confidence);
+}
+
+void test_repeated_report_from_same_drone_is_not_double_counted() {
+    TargetTrackStore store;
+    store.setOrigin(BASE_LAT, BASE_LON);
+
+    int16_t idx = store.ingest(makeReport(1, 0, 0, 200), -60, 9.0f, 0);
+    float once = store.getTrack(idx)->confidence;
+    for (int i = 1; i < 10; i++) {
+        store.ingest(makeReport(1, 0, 0, 200), -60, 9.0f, i * 100);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, once, store.getTrack(idx)->confidence);
+}
+
+void test_position_is_weighted_by_link_quality() {
+    TargetTrackStore store;
+    store.setOrigin(BASE_LAT, BASE_LON);
+
+    store.ingest(makeReport(1, 0, 0, 200), -50, 10.0f, 0);    // Strong link
+    int16_t idx = store.ingest(makeReport(2, 10, 0, 200), -125, -18.0f, 0); // Weak link
+
+    const TargetTrack* t = store.getTrack(idx);
+    TEST_ASSERT_NOT_NULL(t);
+    TEST_ASSERT_LESS_THAN(3.0f, t->y);
+}
+
+void test_distant_reports_create_separate_tracks() {
+    TargetTrackStore store;
+    store.setOrigin(BASE_LAT, BASE_LON);
+
+    int16_t a = store.ingest(makeReport(1, 0, 0, 200), -70, 5.0f, 0);
+    int16_t b = store.ingest(makeReport(1, 0, TARGET_ASSOCIATION_RADIUS_M * 3, 200), -70, 5.0f, 0);
+    TEST_ASSERT_TRUE(a != b);
+    TEST_ASSERT_EQUAL(2, store.getActiveCount());
+}
+
+void test_moving_report_splits_track() {
+    TargetTrackStore store;
+    store.setOrigin(BASE_LAT, BASE_LON);
+
+    // More drones see the target further east, dragging the centroid
+    // until drone 1's original sighting falls outside the gate
+    store.ingest(makeReport(1, 0, 0, 200), -70, 5.0f, 0);
+    store.ingest(makeReport(2, 0, 14, 200), -70, 5.0f, 0);
+    store.ingest(makeReport(3, 0, 20, 200), -70, 5.0f, 0);
+    store.ingest(makeReport(4, 0, 25, 200), -70, 5.0f, 0);
+    TEST_ASSERT_EQUAL(1, store.getActiveCount());
+    store.ingest(makeReport(5, 0, 28, 200), -70, 5.0f, 0);
+    TEST_ASSERT_EQUAL(2, store.getActiveCount());
+    TEST_ASSERT_GREATER_OR_EQUAL(1, store.getStats().tracksSplit);
+}
+
+void test_converging_tracks_merge() {
+    TargetTrackStore store;
+    store.setOrigin(BASE_LAT, BASE_LON);
+
+    int16_t a = store.ingest(makeReport(1, 0, 0, 200), -70, 5.0f, 0);
+    store.ingest(makeReport(2, 0, TARGET_ASSOCIATION_RADIUS_M * 1.5f, 200), -70, 5.0f, 10);
+    TEST_ASSERT_EQUAL(2, store.getActiveCount());
+
+    // Drone 2 refines its estimate onto drone 1's target
+    store.ingest(makeReport(2, 0, TARGET_ASSOCIATION_RADIUS_M * 0.9f, 200), -70, 5.0f, 20);
+    store.ingest(makeReport(2, 0, 2, 200), -70, 5.0f, 30);
+    TEST_ASSERT_EQUAL(1, store.getActiveCount());
+    TEST_ASSERT_NOT_NULL(store.getTrack(a)); // Older track survives
+}
+
+void test_only_changed_tracks_are_collected() {
+    TargetTrackStore store;
+    store.setOrigin(BASE_LAT, BASE_LON);
+    TargetReportData out[8];
+
+    store.ingest(makeReport(1, 0, 0, 200), -70, 5.0f, 0);
+    store.ingest(makeReport(1, 500, 500, 200), -70, 5.0f, 0);
+    TEST_ASSERT_EQUAL(2, store.collectChangedTracks(out, 8, 9));
+    TEST_ASSERT_EQUAL(9, out[0].reporterId);
+
+    // Same report again: no confidence change, nothing to send
+    store.ingest(makeReport(1, 0, 0, 200), -70, 5.0f, 50);
+    TEST_ASSERT_EQUAL(0, store.collectChangedTracks(out, 8, 9));
+
+    // A second drone confirms the first target
+    store.ingest(makeReport(2, 1, 1, 220), -60, 9.0f, 60);
+    TEST_ASSERT_EQUAL(1, store.collectChangedTracks(out, 8, 9));
+}
+
+void test_tracks_expire() {
+    TargetTrackStore store;
+    store.setOrigin(BASE_LAT, BASE_LON);
+
+    store.ingest(makeReport(1, 0, 0, 200), -70, 5.0f, 0);
+    store.ingest(makeReport(1, 300, 0, 200), -70, 5.0f, TARGET_TRACK_TIMEOUT_MS / 2);
+    TEST_ASSERT_EQUAL(1, store.expireTracks(TARGET_TRACK_TIMEOUT_MS));
+    TEST_ASSERT_EQUAL(1, store.getActiveCount());
+}
+
+void test_handle_message_rejects_bad_length() {
+    TargetTrackStore store;
+    DroneMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.messageType = MSG_TARGET_FOUND;
+    msg.dataLength = sizeof(TargetReportData) - 1;
+    TEST_ASSERT_FALSE(store.handleMessage(msg, -70, 5.0f, 0));
+
+    TargetReportData report = makeReport(1, 0, 0, 200);
+    msg.dataLength = sizeof(report);
+    memcpy(msg.data, &report, sizeof(report));
+    TEST_ASSERT_TRUE(store.handleMessage(msg, -70, 5.0f, 0));
+}
+
+void benchmark_10k_synthetic_detections() {
+    const int detections = 10000;
+    const int targets = 2000;
+    TargetTrackStore store(4096);
+    store.setOrigin(BASE_LAT, BASE_LON);
+
+    // Targets scattered over the mission area, each seen by several drones
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> area(0, MISSION_AREA_SIZE_M * 4.0f);
+    std::normal_distribution<float> noise(0, 2.0f);
+    std::uniform_int_distribution<int> pick(0, targets - 1);
+
+    float tx[targets], ty[targets];
+    for (int i = 0; i < targets; i++) {
+        tx[i] = area(rng);
+        ty[i] = area(rng);
+    }
+
+    TargetReportData* reports = new TargetReportData[detections];
+    for (int i = 0; i < detections; i++) {
+        int t = pick(rng);
+        reports[i] = makeReport(1 + i % MAX_DRONES, ty[t] + noise(rng), tx[t] + noise(rng), 150 + i % 100);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < detections; i++) {
+        store.ingest(reports[i], -60 - i % 50, 10.0f - i % 25, i);
+    }
+    auto mid = std::chrono::steady_clock::now();
+
+    int hits = 0;
+    for (int i = 0; i < detections; i++) {
+        if (store.findNearest(reports[i].latitude, reports[i].longitude) >= 0) hits++;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double insertSec = std::chrono::duration<double>(mid - start).count();
+    double querySec = std::chrono::duration<double>(end - mid).count();
+    printf("[BENCH] target fusion: %d detections -> %u tracks\n", detections, store.getActiveCount());
+    printf("[BENCH]    insert: %.0f reports/sec (%.2f us each)\n",
+           detections / insertSec, 1e6 * insertSec / detections);
+    printf("[BENCH]    query:  %.0f lookups/sec (%.2f us each)\n",
+           detections / querySec, 1e6 * querySec / detections);
+
+    // Tracks that later merged or drifted may leave an old sighting outside the gate
+    printf("[BENCH]    %.1f%% of sightings still resolve to a track\n", 100.0 * hits / detections);
+    TEST_ASSERT_GREATER_OR_EQUAL(detections * 95 / 100, hits);
+    TEST_ASSERT_LESS_OR_EQUAL(targets, store.getActiveCount());
+    delete[] reports;
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_duplicate_reports_fuse_into_one_track);
+    RUN_TEST(test_repeated_report_from_same_drone_is_not_double_counted);
+    RUN_TEST(test_position_is_weighted_by_link_quality);
+    RUN_TEST(test_distant_reports_create_separate_tracks);
+    RUN_TEST(test_moving_report_splits_track);
+    RUN_TEST(test_converging_tracks_merge);
+    RUN_TEST(test_only_changed_tracks_are_collected);
+    RUN_TEST(test_tracks_expire);
+    RUN_TEST(test_handle_message_rejects_bad_length);
+    RUN_TEST(benchmark_10k_synthetic_detections);
+    return UNITY_END();
+}
@@ -0,0 +1,626 @@
+// Warm restart tests: the RTC block round trip, its fallbacks to flash and
+// to a cold start, the sequence lease, stop ids across a reset, and a
+// simulated swarm timing how fast a reset drone is useful again when cold,
+// from flash and from RTC memory
+// Run with: pio test -e native -f test_warm_restart
+
+#include <unity.h>
+#include <algorithm>
+#include <memory>
+#include <set>
+#include "../../include/utilities/warm_state.h"
+#include "../../include/coordination/state_machine.h"
+#include "../../include/communications/emergency_stop.h"
+#include "../../include/communications/lora_interface.h"
+#include "../../include/simulation/radio_sim.h"
+
+static const uint8_t networkKey[CRYPTO_KEY_BYTES] = SWARM_NETWORK_KEY;
+
+void setUp() {}
+void tearDown() {}
+
+// Everything WarmStart looks after on one drone
+struct Drone {
+    SecureLink link;
+    MissionStateMachine mission;
+    EmergencyStopHandler emergency;
+    AdrController adr;
+    PeerTable peers;
+    WarmStart warm;
+
+    Drone(uint8_t id, WarmStateBlock* rtc, WarmBackup* backup)
+        : link(id, networkKey), emergency(id, &mission), adr(id),
+          warm(rtc, backup, {&link, &mission, &emergency, &adr, &peers}) {}
+};
+
+// What DroneComm::begin() does with the NVS epoch
+static void beginLink(SecureLink& link, uint16_t& storedEpoch) {
+    uint16_t epoch = link.getEpoch();
+    if (epoch == 0 || epoch != storedEpoch) {
+        storedEpoch++;
+        link.setEpoch(storedEpoch);
+    }
+}
+
+static HeartbeatData heartbeatOf(uint8_t id) {
+    HeartbeatData heartbeat = {id, 80.0f, 52.52f, 13.40f, 0, MISSION_ACTIVE};
+    return heartbeat;
+}
+
+static SecureFrame sealed(SecureLink& link, uint8_t type = MSG_HEARTBEAT) {
+    DroneMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.messageType = type;
+    msg.destinationId = 0xFF;
+    msg.dataLength = 4;
+    SecureFrame frame;
+    link.seal(msg, frame);
+    return frame;
+}
+
+void test_rtc_round_trip() {
+    WarmStateBlock rtc;
+    memset(&rtc, 0xA5, sizeof(rtc));        // Power-on contents
+    RamWarmBackup backup;
+    uint16_t storedEpoch = 6;
+
+    Drone a(1, &rtc, &backup);
+    TEST_ASSERT_EQUAL(WARM_COLD, a.warm.restore(0, 5000000));
+    beginLink(a.link, storedEpoch);
+    TEST_ASSERT_EQUAL(7, a.link.getEpoch());
+    for (int i = 0; i < 40; i++) {
+        sealed(a.link);
+    }
+    a.mission.transition(MISSION_RETURNING);
+    a.emergency.setNextStopId(5);
+    a.adr.resume(9, 3, 0);
+    a.peers.update(heartbeatOf(2), -90, 5.0f, 10000);
+    a.peers.update(heartbeatOf(3), -95, 2.5f, 12000);
+    a.peers.update(heartbeatOf(4), -80, 9.0f, 19000);
+    SecureLink two(2, networkKey);
+    two.setEpoch(4);
+    SecureFrame old[5];
+    DroneMessage out;
+    for (int i = 0; i < 5; i++) {
+        old[i] = sealed(two);
+        TEST_ASSERT_EQUAL(CRYPTO_OK, a.link.open(old[i], out, 18000));
+    }
+    a.warm.capture(20000, 25000000);
+
+    // Reset: 1.2 s later by the RTC clock, 150 ms into the new boot
+    Drone b(1, &rtc, &backup);
+    TEST_ASSERT_EQUAL(WARM_FROM_RTC, b.warm.restore(150, 26200000));
+    TEST_ASSERT_EQUAL(1200, b.warm.getDowntimeMs());
+    TEST_ASSERT_EQUAL(1, b.warm.getWarmBoots());
+    beginLink(b.link, storedEpoch);
+    TEST_ASSERT_EQUAL(7, b.link.getEpoch());
+    TEST_ASSERT_EQUAL(7, storedEpoch);              // No new epoch written
+    TEST_ASSERT_EQUAL(40 + WARM_SEQUENCE_LEASE, b.link.getSequence());
+    TEST_ASSERT_EQUAL(MISSION_RETURNING, b.mission.getState());
+    TEST_ASSERT_EQUAL(5, b.emergency.getNextStopId());
+    TEST_ASSERT_EQUAL(9, b.adr.getSpreadingFactor());
+    TEST_ASSERT_EQUAL(3, b.adr.getPlanEpoch());
+
+    // Peer ages carry over: seen 1 s before the capture, 1.2 s down
+    TEST_ASSERT_EQUAL(3, b.peers.size());
+    TEST_ASSERT_EQUAL(2200, 150 - b.peers.find(4)->lastSeen);
+    TEST_ASSERT_EQUAL(1, b.peers.find(2)->heartbeats);
+    TEST_ASSERT_EQUAL(9 * 4, b.peers.find(4)->lastSnrQ2);
+
+    // The replay windows came back: old frames stay rejected, new ones pass
+    TEST_ASSERT_EQUAL(CRYPTO_REPLAY, b.link.open(old[3], out, 200));
+    TEST_ASSERT_EQUAL(CRYPTO_OK, b.link.open(sealed(two), out, 200));
+    SecureLink cold(1, networkKey);
+    TEST_ASSERT_EQUAL(CRYPTO_OK, cold.open(old[3], out, 200));      // What a cold boot lets through
+}
+
+void test_fallbacks_to_flash_and_cold() {
+    WarmStateBlock rtc;
+    memset(&rtc, 0, sizeof(rtc));
+    RamWarmBackup backup;
+
+    Drone a(1, &rtc, &backup);
+    a.warm.restore(0, 0);
+    a.link.setEpoch(2);
+    a.adr.resume(8, 5, 0);
+    a.peers.update(heartbeatOf(2), -90, 5.0f, 100);
+    a.emergency.trigger(ESTOP_REASON_GEOFENCE, 200);
+    TEST_ASSERT_TRUE(a.mission.isStopped());
+    a.warm.service(300, 300000);
+    TEST_ASSERT_EQUAL(2, a.emergency.getNextStopId());
+
+    // A torn or stale RTC block: the durable part comes from flash
+    WarmStateBlock saved = rtc;
+    ((uint8_t*)&rtc)[offsetof(WarmStateBlock, peers) + 3] ^= 0x10;
+    TEST_ASSERT_FALSE(WarmStart::isValid(rtc));
+    Drone b(1, &rtc, &backup);
+    TEST_ASSERT_EQUAL(WARM_FROM_FLASH, b.warm.restore(50, 400000));
+    TEST_ASSERT_TRUE(b.mission.isStopped());
+    TEST_ASSERT_EQUAL(ESTOP_REASON_GEOFENCE, b.mission.getStopReason());
+    TEST_ASSERT_EQUAL(2 + WARM_STOP_ID_SKIP, b.emergency.getNextStopId());
+    TEST_ASSERT_EQUAL(8, b.adr.getSpreadingFactor());
+    TEST_ASSERT_EQUAL(0, b.link.getEpoch());        // DroneComm::begin() starts a new one
+    TEST_ASSERT_EQUAL(0, b.peers.size());
+
+    // Another layout is another format, whatever the CRC says
+    rtc = saved;
+    rtc.version++;
+    TEST_ASSERT_FALSE(WarmStart::isValid(rtc));
+    rtc = saved;
+    TEST_ASSERT_TRUE(WarmStart::isValid(rtc));
+
+    // Down longer than WARM_MAX_DOWNTIME_MS, or the RTC clock started over
+    Drone c(1, &rtc, &backup);
+    TEST_ASSERT_EQUAL(WARM_FROM_FLASH, c.warm.restore(50, 300000 + (WARM_MAX_DOWNTIME_MS + 1) * 1000ULL));
+    rtc = saved;
+    Drone d(1, &rtc, &backup);
+    TEST_ASSERT_EQUAL(WARM_FROM_FLASH, d.warm.restore(50, 1000));
+
+    // Nothing anywhere
+    memset(&rtc, 0, sizeof(rtc));
+    backup.wipe();
+    Drone e(1, &rtc, &backup);
+    TEST_ASSERT_EQUAL(WARM_COLD, e.warm.restore(50, 1000));
+    TEST_ASSERT_FALSE(e.mission.isStopped());
+    TEST_ASSERT_EQUAL(1, e.emergency.getNextStopId());
+    TEST_ASSERT_EQUAL(LORA_SPREADING_FACTOR, e.adr.getSpreadingFactor());
+}
+
+void test_quick_reset_loop_falls_back() {
+    WarmStateBlock rtc;
+    memset(&rtc, 0, sizeof(rtc));
+    RamWarmBackup backup;
+    uint64_t clock = 1000000;
+    {
+        Drone first(1, &rtc, &backup);
+        first.warm.restore(0, clock);
+        first.mission.transition(MISSION_ACTIVE);
+        first.warm.capture(500, clock += 500000);
+    }
+
+    // Resets within seconds of each other: the snapshot may be the cause
+    for (int boot = 1; boot <= WARM_MAX_WARM_BOOTS + 1; boot++) {
+        Drone next(1, &rtc, &backup);
+        WarmSource source = next.warm.restore(100, clock += 200000);
+        if (boot <= WARM_MAX_WARM_BOOTS) {
+            TEST_ASSERT_EQUAL(WARM_FROM_RTC, source);
+            TEST_ASSERT_EQUAL(boot, next.warm.getWarmBoots());
+            TEST_ASSERT_EQUAL(MISSION_ACTIVE, next.mission.getState());
+        } else {
+            TEST_ASSERT_EQUAL(WARM_FROM_FLASH, source);
+            TEST_ASSERT_EQUAL(MISSION_IDLE, next.mission.getState());
+        }
+        next.warm.capture(600, clock += 500000);
+    }
+
+    // Running WARM_STABLE_MS ends the run
+    Drone stable(1, &rtc, &backup);
+    stable.warm.restore(100, clock += 200000);
+    stable.warm.capture(100 + WARM_STABLE_MS, clock += WARM_STABLE_MS * 1000ULL);
+    TEST_ASSERT_EQUAL(0, rtc.warmBoots);
+    Drone after(1, &rtc, &backup);
+    TEST_ASSERT_EQUAL(WARM_FROM_RTC, after.warm.restore(100, clock += 200000));
+}
+
+void test_sequence_lease_never_reuses_a_nonce() {
+    WarmStateBlock rtc;
+    memset(&rtc, 0, sizeof(rtc));
+    uint16_t storedEpoch = 0;
+    SecureLink peer(9, networkKey);
+    DroneMessage out;
+    uint32_t now = 0;
+    uint64_t clock = 0;
+    uint16_t highestUsed = 0;
+
+    // Frames in bursts of up to 100 per main loop pass, resets in between
+    for (int boot = 0; boot < 6; boot++) {
+        Drone d(1, &rtc, nullptr);
+        d.warm.restore(now, clock);
+        beginLink(d.link, storedEpoch);
+        TEST_ASSERT_EQUAL(1, storedEpoch);
+        TEST_ASSERT_TRUE(d.link.getSequence() >= highestUsed);
+        for (int pass = 0; pass < 5 + boot * 3; pass++) {
+            for (int i = 0; i < 100; i++) {
+                SecureFrame frame = sealed(d.link);
+                highestUsed = frame.msg.sequenceNumber;
+                // Still the same epoch and always ahead: the peer never sees a replay
+                TEST_ASSERT_EQUAL(CRYPTO_OK, peer.open(frame, out, now));
+            }
+            d.warm.service(now += 10, clock += 10000);
+            TEST_ASSERT_TRUE(rtc.sequenceLease > highestUsed);
+        }
+        // Up long enough that the boot loop guard stays out of it
+        d.warm.service(now += WARM_STABLE_MS, clock += WARM_STABLE_MS * 1000ULL);
+        clock += 500000;
+    }
+
+    // A lease at the end of the sequence space: the next boot takes a new epoch
+    Drone wrap(1, &rtc, nullptr);
+    wrap.warm.restore(now, clock);
+    wrap.link.resume(1, 0xFFFF - WARM_SEQUENCE_LEASE / 2);
+    wrap.warm.service(now, clock);
+    TEST_ASSERT_EQUAL(0xFFFF, rtc.sequenceLease);
+    Drone next(1, &rtc, nullptr);
+    next.warm.restore(now, clock + 1000);
+    beginLink(next.link, storedEpoch);
+    TEST_ASSERT_EQUAL(2, next.link.getEpoch());
+    TEST_ASSERT_EQUAL(CRYPTO_OK, peer.open(sealed(next.link), out, now));
+}
+
+void test_stop_ids_keep_rising_across_a_reset() {
+    // A stop from drone 1, latched and then cleared on drone 2
+    MissionStateMachine mission;
+    EmergencyStopHandler neighbour(2, &mission);
+    WarmStateBlock rtc;
+    memset(&rtc, 0, sizeof(rtc));
+    RamWarmBackup backup;
+    DroneMessage frame;
+    {
+        Drone d(1, &rtc, &backup);
+        d.warm.restore(0, 0);
+        d.emergency.trigger(ESTOP_REASON_OPERATOR, 100);
+        TEST_ASSERT_TRUE(d.emergency.pollTransmit(100, frame));
+        TEST_ASSERT_EQUAL(ESTOP_APPLIED, neighbour.onFrame((uint8_t*)&frame, sizeof(frame), 100));
+        d.mission.clearEmergency();
+        d.warm.service(200, 200000);
+    }
+    TEST_ASSERT_TRUE(mission.clearEmergency());
+
+    // Cold: the first stop after the reset reuses id 1 and is dropped
+    Drone cold(1, nullptr, nullptr);
+    WarmStateBlock blank;
+    memset(&blank, 0, sizeof(blank));
+    WarmStart coldStart(&blank, nullptr, {&cold.link, &cold.mission, &cold.emergency, &cold.adr, &cold.peers});
+    coldStart.restore(0, 0);
+    cold.emergency.trigger(ESTOP_REASON_OPERATOR, 50);
+    TEST_ASSERT_TRUE(cold.emergency.pollTransmit(50, frame));
+    TEST_ASSERT_EQUAL(ESTOP_DUPLICATE, neighbour.onFrame((uint8_t*)&frame, sizeof(frame), 1000));
+    TEST_ASSERT_FALSE(mission.isStopped());
+
+    // Warm, and from flash after a power cut: a new id, the stop applies
+    for (int fromFlash = 0; fromFlash < 2; fromFlash++) {
+        WarmStateBlock copy = rtc;
+        if (fromFlash) {
+            memset(&copy, 0, sizeof(copy));
+        }
+        Drone warm(1, &copy, &backup);
+        warm.warm.restore(0, 300000);
+        warm.emergency.trigger(ESTOP_REASON_OPERATOR, 50);
+        TEST_ASSERT_TRUE(warm.emergency.pollTransmit(50, frame));
+        TEST_ASSERT_EQUAL(ESTOP_APPLIED, neighbour.onFrame((uint8_t*)&frame, sizeof(frame), 1000 + fromFlash));
+        TEST_ASSERT_TRUE(mission.isStopped());
+        mission.clearEmergency();
+    }
+}
+
+void test_flash_written_only_when_durable_state_changes() {
+    WarmStateBlock rtc;
+    memset(&rtc, 0, sizeof(rtc));
+    RamWarmBackup backup;
+    Drone d(1, &rtc, &backup);
+    d.warm.restore(0, 0);
+    TEST_ASSERT_EQUAL(1, backup.writes);
+
+    // An hour of main loop passes with peers coming and going
+    uint32_t now = 0;
+    for (; now < 3600000; now += 100) {
+        if (now % 2000 == 0) {
+            d.peers.update(heartbeatOf((uint8_t)(2 + now / 2000 % 5)), -90, 4.0f, now);
+            d.peers.expire(now);
+            sealed(d.link);
+        }
+        d.warm.service(now, now * 1000ULL);
+    }
+    TEST_ASSERT_EQUAL(1, backup.writes);
+    TEST_ASSERT_TRUE(d.warm.getStats().captures >= 3600 && d.warm.getStats().captures <= 3602);
+
+    // Stop latch, stop id, SF
+    d.emergency.trigger(ESTOP_REASON_LOW_BATTERY, now);
+    d.warm.service(now, now * 1000ULL);
+    TEST_ASSERT_EQUAL(2, backup.writes);
+    d.mission.clearEmergency();
+    now += 100;
+    d.warm.service(now, now * 1000ULL);
+    TEST_ASSERT_EQUAL(3, backup.writes);
+    d.adr.resume(8, 1, now);
+    now += 100;
+    d.warm.service(now, now * 1000ULL);
+    TEST_ASSERT_EQUAL(4, backup.writes);
+    now += 100;
+    d.warm.service(now, now * 1000ULL);
+    TEST_ASSERT_EQUAL(4, backup.writes);
+}
+
+// ---------------------------------------------------------------------------
+// Swarm simulation, as in test_adr: log-distance path loss with shadowing
+// and fading, a sealed heartbeat plus link state every
+// HEARTBEAT_INTERVAL_MS with carrier sense, ADR and the warm restart
+// snapshot serviced every main loop pass. The swarm spreads out over the
+// first minutes, so ADR moves it to slower SFs, then one drone resets and
+// is down for SIM_BOOT_MS before its radio is up again.
+//   first frame: reset until a neighbour accepts a frame from it
+//   rejoin:      reset until every neighbour that listed it before the reset
+//                has accepted a frame from it again, and it lists every
+//                neighbour it listed before
+// Each drone keeps its own millis(), restarting at the reset.
+
+#define SIM_DRONES 6
+#define SIM_UPDATE_US 100000ULL
+#define SIM_MOVE_US 1000000ULL
+#define SIM_BOOT_MS 400                 // Reset to radio up, ROM boot included
+#define SIM_SPREAD_S 300
+#define SIM_RESET_S 420
+#define SIM_HORIZON_S 120               // After the reset
+
+static const SimLinkBudget kBudget = {32.0f, 3.0f, 4.0f, 2.0f};
+
+enum ResetMode { RESET_COLD, RESET_FLASH, RESET_WARM };
+static const char* const kModeNames[] = {"cold", "flash", "warm"};
+
+struct WarmResult {
+    bool useful;
+    bool rejoined;
+    double firstFrameMs;
+    double rejoinMs;
+    uint8_t swarmSf;
+    uint32_t rejected;                  // Frames of the reset drone neighbours refused
+};
+
+class WarmSimulation {
+private:
+    struct Node {
+        std::unique_ptr<Drone> drone;
+        WarmStateBlock rtc;
+        RamWarmBackup backup;
+        uint16_t storedEpoch;
+        uint64_t bootUs;
+        uint32_t incarnation;
+        bool up;
+    };
+
+    RadioSim sim;
+    float endAreaM;
+    ResetMode mode;
+    uint8_t resetNode;
+    std::vector<Node> nodes;
+    std::vector<float> baseX, baseY;
+    uint64_t resetUs;
+    std::set<uint8_t> listedBy;         // Had resetNode in their tables
+    std::set<uint8_t> listed;           // In resetNode's table
+    std::set<uint8_t> heardBy;
+    uint64_t firstFrameUs;
+    uint64_t rejoinUs;
+    uint32_t rejected;
+
+    uint32_t nodeMs(uint8_t i) { return (uint32_t)((sim.now() - nodes[i].bootUs) / 1000); }
+
+    void boot(uint8_t i) {
+        Node& n = nodes[i];
+        n.drone.reset(new Drone(i, &n.rtc, &n.backup));
+        n.bootUs = sim.now() - SIM_BOOT_MS * 1000ULL;
+        n.drone->warm.restore(nodeMs(i), sim.now());
+        beginLink(n.drone->link, n.storedEpoch);
+        n.drone->mission.transition(MISSION_ACTIVE);
+        sim.setSpreadingFactor(i, n.drone->adr.getSpreadingFactor());
+        sim.setTxPower(i, n.drone->adr.getTxPowerDbm());
+        n.up = true;
+        uint32_t incarnation = ++n.incarnation;
+        std::uniform_int_distribution<uint32_t> jitter(0, 200000);
+        sim.after(jitter(sim.rng()), [this, i, incarnation]() { heartbeat(i, incarnation); });
+        sim.after(jitter(sim.rng()) % SIM_UPDATE_US, [this, i, incarnation]() { loopPass(i, incarnation); });
+    }
+
+    void reset() {
+        Node& n = nodes[resetNode];
+        resetUs = sim.now();
+        for (uint8_t j = 0; j < SIM_DRONES; j++) {
+            if (j != resetNode && nodes[j].drone->peers.find(resetNode)) listedBy.insert(j);
+            if (j != resetNode && n.drone->peers.find(j)) listed.insert(j);
+        }
+        n.up = false;
+        n.incarnation++;
+        sim.abortTransmit(resetNode);
+        if (mode != RESET_WARM) {
+            memset(&n.rtc, 0, sizeof(n.rtc));          // Power-on reset
+        }
+        if (mode == RESET_COLD) {
+            n.backup.wipe();
+        }
+        sim.after(SIM_BOOT_MS * 1000ULL, [this]() { boot(resetNode); });
+    }
+
+    void heartbeat(uint8_t i, uint32_t incarnation) {
+        Node& n = nodes[i];
+        if (!n.up || n.incarnation != incarnation) return;
+        if (sim.isTransmitting(i) || sim.channelBusy(i)) {
+            std::uniform_int_distribution<uint32_t> backoff(5000, 60000);
+            sim.after(backoff(sim.rng()), [this, i, incarnation]() { heartbeat(i, incarnation); });
+            return;
+        }
+        DroneMessage msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.messageType = MSG_HEARTBEAT;
+        msg.destinationId = 0xFF;
+        msg.timestamp = nodeMs(i);
+        msg.dataLength = sizeof(HeartbeatData) + sizeof(LinkStateData);
+        HeartbeatData data = heartbeatOf(i);
+        data.missionState = n.drone->mission.getState();
+        LinkStateData state;
+        n.drone->adr.fillLinkState(state, nodeMs(i));
+        memcpy(msg.data, &data, sizeof(data));
+        memcpy(msg.data + sizeof(data), &state, sizeof(state));
+        SecureFrame frame;
+        n.drone->link.seal(msg, frame);
+        sim.transmit(i, &frame, sizeof(frame));
+        n.drone->peers.expire(nodeMs(i));
+
+        std::uniform_int_distribution<uint32_t> jitter(0, 200000);
+        sim.after(HEARTBEAT_INTERVAL_MS * 1000ULL + jitter(sim.rng()),
+                  [this, i, incarnation]() { heartbeat(i, incarnation); });
+    }
+
+    void loopPass(uint8_t i, uint32_t incarnation) {
+        Node& n = nodes[i];
+        if (!n.up || n.incarnation != incarnation) return;
+        n.drone->adr.update(nodeMs(i));
+        if (!sim.isTransmitting(i)) {
+            sim.setSpreadingFactor(i, n.drone->adr.getSpreadingFactor());
+        }
+        sim.setTxPower(i, n.drone->adr.getTxPowerDbm());
+        n.drone->warm.service(nodeMs(i), sim.now());
+        checkRejoined();
+        sim.after(SIM_UPDATE_US, [this, i, incarnation]() { loopPass(i, incarnation); });
+    }
+
+    void receive(uint8_t i, const SimFrame& frame) {
+        Node& n = nodes[i];
+        if (!n.up) return;
+        DroneMessage msg;
+        CryptoResult result = n.drone->link.open(*(const SecureFrame*)frame.payload.data(), msg, nodeMs(i));
+        bool fromReset = resetUs && msg.sourceId == resetNode && frame.startUs > resetUs;
+        if (result != CRYPTO_OK) {
+            if (fromReset) rejected++;
+            return;
+        }
+        HeartbeatData heartbeat;
+        LinkStateData state;
+        memcpy(&heartbeat, msg.data, sizeof(heartbeat));
+        memcpy(&state, msg.data + sizeof(heartbeat), sizeof(state));
+        n.drone->peers.update(heartbeat, frame.rssi, frame.snr, nodeMs(i));
+        n.drone->adr.onLinkState(msg.sourceId, state, frame.rssi, frame.snr, nodeMs(i));
+        if (fromReset) {
+            if (!firstFrameUs) firstFrameUs = sim.now();
+            heardBy.insert(i);
+        }
+        checkRejoined();
+    }
+
+    void checkRejoined() {
+        if (!resetUs || rejoinUs || !nodes[resetNode].up) return;
+        for (uint8_t j : listedBy) {
+            if (!heardBy.count(j)) return;
+        }
+        for (uint8_t j : listed) {
+            if (!nodes[resetNode].drone->peers.find(j)) return;
+        }
+        rejoinUs = sim.now();
+    }
+
+    void move() {
+        double t = sim.now() / 1e6 / SIM_SPREAD_S;
+        float area = MISSION_AREA_SIZE_M + (float)(t < 1 ? t : 1) * (endAreaM - MISSION_AREA_SIZE_M);
+        float scale = area / MISSION_AREA_SIZE_M;
+        float centre = MISSION_AREA_SIZE_M / 2.0f;
+        for (uint8_t i = 0; i < SIM_DRONES; i++) {
+            sim.setPosition(i, centre + (baseX[i] - centre) * scale, centre + (baseY[i] - centre) * scale);
+        }
+        if (t < 1) {
+            sim.after(SIM_MOVE_US, [this]() { move(); });
+        }
+    }
+
+public:
+    WarmSimulation(float endAreaM, ResetMode mode, uint32_t seed)
+        : sim(SIM_DRONES, seed), endAreaM(endAreaM), mode(mode), nodes(SIM_DRONES), baseX(SIM_DRONES),
+          baseY(SIM_DRONES), resetUs(0), firstFrameUs(0), rejoinUs(0), rejected(0) {
+        sim.setLinkBudget(kBudget);
+        // Same seed, same layout, same drone reset in every mode
+        std::uniform_real_distribution<float> coordinate(0.0f, MISSION_AREA_SIZE_M);
+        do {
+            for (uint8_t i = 0; i < SIM_DRONES; i++) {
+                baseX[i] = coordinate(sim.rng());
+                baseY[i] = coordinate(sim.rng());
+                sim.setPosition(i, baseX[i], baseY[i]);
+            }
+        } while (!sim.isConnected());
+        resetNode = (uint8_t)(seed % SIM_DRONES);
+
+        sim.onReceive([this](uint8_t node, const SimFrame& frame) { receive(node, frame); });
+        for (uint8_t i = 0; i < SIM_DRONES; i++) {
+            Node& n = nodes[i];
+            memset(&n.rtc, 0, sizeof(n.rtc));
+            n.storedEpoch = (uint16_t)(i * 10);
+            n.incarnation = 0;
+            n.up = false;
+            std::uniform_int_distribution<uint32_t> phase(SIM_BOOT_MS * 1000, 2 * SIM_BOOT_MS * 1000);
+            sim.at(phase(sim.rng()), [this, i]() { boot(i); });
+        }
+        sim.at(0, [this]() { move(); });
+        sim.at(SIM_RESET_S * 1000000ULL, [this]() { reset(); });
+    }
+
+    WarmResult run() {
+        sim.run((SIM_RESET_S + SIM_HORIZON_S) * 1000000ULL);
+        WarmResult r;
+        r.useful = firstFrameUs != 0;
+        r.rejoined = rejoinUs != 0;
+        r.firstFrameMs = r.useful ? (firstFrameUs - resetUs) / 1000.0 : SIM_HORIZON_S * 1000.0;
+        r.rejoinMs = r.rejoined ? (rejoinUs - resetUs) / 1000.0 : SIM_HORIZON_S * 1000.0;
+        r.swarmSf = nodes[(resetNode + 1) % SIM_DRONES].drone->adr.getSpreadingFactor();
+        r.rejected = rejected;
+        return r;
+    }
+};
+
+void test_simulated_rejoin_after_reset() {
+    static const struct {
+        const char* name;
+        float endAreaM;
+    } scenarios[] = {
+        {"compact", MISSION_AREA_SIZE_M},
+        {"spread", 5.0f * MISSION_AREA_SIZE_M},
+    };
+    const int seeds = 4;
+    printf("[SIM] Reset of one drone out of %d, down %d ms, heartbeat every %d ms, %d seeds; "
+           "first frame and rejoin in ms after the reset (%d s = never):\n",
+           SIM_DRONES, SIM_BOOT_MS, HEARTBEAT_INTERVAL_MS, seeds, SIM_HORIZON_S);
+    printf("[SIM]   scenario  mode   swarm SF  first frame  rejoin  rejoined  rejected\n");
+    for (const auto& scenario : scenarios) {
+        double first[3] = {0, 0, 0}, rejoin[3] = {0, 0, 0}, coldRejoin[seeds], worstWarm = 0;
+        int rejoined[3] = {0, 0, 0};
+        uint32_t rejectedTotal[3] = {0, 0, 0};
+        for (int mode = RESET_COLD; mode <= RESET_WARM; mode++) {
+            int sfSum = 0;
+            for (int seed = 0; seed < seeds; seed++) {
+                WarmResult r = WarmSimulation(scenario.endAreaM, (ResetMode)mode, 60 + seed).run();
+                first[mode] += r.firstFrameMs / seeds;
+                rejoin[mode] += r.rejoinMs / seeds;
+                rejoined[mode] += r.rejoined;
+                rejectedTotal[mode] += r.rejected;
+                sfSum += r.swarmSf;
+                if (mode == RESET_COLD) coldRejoin[seed] = r.rejoinMs;
+                if (mode == RESET_WARM && r.rejoinMs < coldRejoin[seed]) {
+                    worstWarm = std::max(worstWarm, r.rejoinMs);
+                } else if (mode == RESET_WARM) {
+                    // A marginal SF7 link can need several heartbeats however
+                    // the drone came back: the link's time, not the restart's
+                    TEST_ASSERT_TRUE(r.rejoinMs <= coldRejoin[seed]);
+                }
+            }
+            printf("[SIM]   %-8s  %-5s  %8.1f  %11.0f  %6.0f  %5d/%d  %8u\n", scenario.name, kModeNames[mode],
+                   sfSum / (double)seeds, first[mode], rejoin[mode], rejoined[mode], seeds,
+                   (unsigned)rejectedTotal[mode]);
+        }
+
+        // From RTC: back on the swarm's SF and link state at once, so
+        // rejoining takes one heartbeat exchange whatever the SF
+        TEST_ASSERT_EQUAL(seeds, rejoined[RESET_WARM]);
+        TEST_ASSERT_EQUAL(0, rejectedTotal[RESET_WARM]);
+        TEST_ASSERT_TRUE(worstWarm < SIM_BOOT_MS + 3 * HEARTBEAT_INTERVAL_MS);
+        TEST_ASSERT_TRUE(rejoin[RESET_WARM] <= rejoin[RESET_FLASH]);
+        TEST_ASSERT_TRUE(rejoin[RESET_WARM] < rejoin[RESET_COLD]);
+        TEST_ASSERT_TRUE(first[RESET_WARM] <= first[RESET_COLD]);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_rtc_round_trip);
+    RUN_TEST(test_fallbacks_to_flash_and_cold);
+    RUN_TEST(test_quick_reset_loop_falls_back);
+    RUN_TEST(test_sequence_lease_never_reuses_a_nonce);
+    RUN_TEST(test_stop_ids_keep_rising_across_a_reset);
+    RUN_TEST(test_flash_written_only_when_durable_state_changes);
+    RUN_TEST(test_simulated_rejoin_after_reset);
+    return UNITY_END();
+}
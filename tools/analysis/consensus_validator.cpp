@@ -0,0 +1,137 @@
+// Linearizability and mutual exclusion checks over recorded histories.
+//
+//   pio run -e consensus_validator
+//   .pio/build/consensus_validator/program [options] HISTORY ...
+//
+// HISTORY is a text history (see history_checker.h for the format), as
+// written by saveHistory() from a simulation or converted from flight logs.
+// Each file is checked on its own; the exit status is 1 if any is not
+// linearizable or has overlapping lock holds, 3 if a search ran out.
+//
+//   --threads N        partitions checked in parallel (default: one per core)
+//   --max-steps N      search budget per key (default 200000000)
+//   --initial V        initial value of every register (default 0)
+//   --synthesize N     check a synthetic N-operation history instead
+//   --clients N        its client count (default 16)
+//   --keys N           its key count (default 64)
+
+#include "../../include/ground_station/history_checker.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+static void usage() {
+    fprintf(stderr,
+            "usage: consensus_validator [--threads N] [--max-steps N] [--initial V] HISTORY ...\n"
+            "       consensus_validator --synthesize N [--clients N] [--keys N] [--threads N]\n");
+}
+
+static const char* verdictName(uint8_t verdict) {
+    switch (verdict) {
+        case HISTORY_OK:
+            return "linearizable";
+        case HISTORY_VIOLATION:
+            return "NOT linearizable";
+        default:
+            return "undecided";
+    }
+}
+
+static void printTime(HybridTime time) {
+    if (time == HYBRID_PENDING) {
+        printf("end");
+    } else {
+        printf("%llu.%u", (unsigned long long)(time >> 16), (unsigned)(time & 0xFFFF));
+    }
+}
+
+// Returns the worst verdict, counting lock overlaps as violations
+static uint8_t report(const char* name, const std::vector<HistoryOp>& history, const HistoryCheckerOptions& options) {
+    HistoryCheck check = checkLinearizable(history, options);
+    printf("%s: %u ops on %u keys, %s (%.1fM steps, %u threads, %.2f s)\n", name, check.operations, check.keys,
+           verdictName(check.verdict), check.steps / 1e6, check.threads, check.seconds);
+    for (const HistoryKeyResult& key : check.failures) {
+        printf("  key %u: %s, %u ops, %u linearized", key.key, verdictName(key.verdict), key.operations,
+               key.linearized);
+        if (key.verdict == HISTORY_VIOLATION && key.blockingOp < history.size()) {
+            const HistoryOp& op = history[key.blockingOp];
+            printf(", stuck at op %u (client %u, called ", key.blockingOp, op.client);
+            printTime(op.call);
+            printf(")");
+        }
+        printf("\n");
+    }
+
+    std::vector<MutexViolation> overlaps = checkMutualExclusion(history);
+    for (const MutexViolation& overlap : overlaps) {
+        printf("  lock %u: clients %u and %u both held it from ", overlap.key, history[overlap.first].client,
+               history[overlap.second].client);
+        printTime(overlap.from);
+        printf(" to ");
+        printTime(overlap.to);
+        printf(" (ops %u, %u)\n", overlap.first, overlap.second);
+    }
+    if (!overlaps.empty()) {
+        printf("  %u overlapping holds\n", (unsigned)overlaps.size());
+        return HISTORY_VIOLATION;
+    }
+    return check.verdict;
+}
+
+int main(int argc, char** argv) {
+    HistoryCheckerOptions options = historyCheckerDefaults();
+    uint32_t synthesize = 0;
+    uint16_t clients = 16;
+    uint32_t keys = 64;
+    std::vector<const char*> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--threads") == 0 && hasValue) {
+            options.threads = (uint8_t)std::min(255, std::max(0, atoi(argv[++i])));
+        } else if (strcmp(arg, "--max-steps") == 0 && hasValue) {
+            options.maxStepsPerKey = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--initial") == 0 && hasValue) {
+            options.initialValue = strtoll(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--synthesize") == 0 && hasValue) {
+            synthesize = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--clients") == 0 && hasValue) {
+            clients = (uint16_t)std::min(65535, std::max(1, atoi(argv[++i])));
+        } else if (strcmp(arg, "--keys") == 0 && hasValue) {
+            keys = (uint32_t)std::max(1, atoi(argv[++i]));
+        } else if (arg[0] == '-') {
+            usage();
+            return 2;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (!synthesize && inputs.empty()) {
+        usage();
+        return 2;
+    }
+
+    bool violated = false;
+    bool undecided = false;
+    if (synthesize) {
+        std::vector<HistoryOp> history;
+        synthesizeHistory(synthesize, clients, keys, 1, history);
+        uint8_t verdict = report("synthetic", history, options);
+        violated |= verdict == HISTORY_VIOLATION;
+        undecided |= verdict == HISTORY_UNDECIDED;
+    }
+    for (const char* input : inputs) {
+        std::vector<HistoryOp> history;
+        std::string error;
+        if (!loadHistory(input, history, &error)) {
+            fprintf(stderr, "consensus_validator: %s: %s\n", input, error.c_str());
+            return 2;
+        }
+        uint8_t verdict = report(input, history, options);
+        violated |= verdict == HISTORY_VIOLATION;
+        undecided |= verdict == HISTORY_UNDECIDED;
+    }
+    return violated ? 1 : undecided ? 3 : 0;
+}
@@ -0,0 +1,142 @@
+// Post-flight log analysis over a whole swarm's logs.
+//
+//   pio run -e log_analyzer
+//   .pio/build/log_analyzer/program [options] FILE[@NODE] ...
+//
+// FILE is a serial capture (pio device monitor, best with --filter time) or
+// a flight recorder dump (esptool read_flash of the flightlog partition);
+// @NODE names the drone of a capture that has lost its "Node ID" line.
+//
+//   --out DIR          write drones.csv, links.csv, latency.csv and
+//                      rssi_distance.csv into DIR (default: .)
+//   --threads N        parser and join threads (default: one per core)
+//   --synthesize DIR   write a synthetic log set into DIR and analyze it
+//   --gigabytes G      its size (default 1)
+//   --drones N         its drone count (default 20)
+//   --dumps            recorder dumps rather than captures
+
+#include "../../include/ground_station/log_analyzer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <chrono>
+#include <algorithm>
+
+static void usage() {
+    fprintf(stderr,
+            "usage: log_analyzer [--out DIR] [--threads N] FILE[@NODE] ...\n"
+            "       log_analyzer --synthesize DIR [--gigabytes G] [--drones N] [--dumps] [--out DIR]\n");
+}
+
+static bool addSynthesized(LogAnalyzer& analyzer, const char* directory) {
+    DIR* dir = opendir(directory);
+    if (!dir) {
+        return false;
+    }
+    std::vector<std::string> files;
+    while (struct dirent* entry = readdir(dir)) {
+        if (strncmp(entry->d_name, "drone_", 6) == 0) {
+            files.push_back(std::string(directory) + "/" + entry->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+    for (const std::string& file : files) {
+        if (!analyzer.addFile(file.c_str())) {
+            return false;
+        }
+    }
+    return !files.empty();
+}
+
+int main(int argc, char** argv) {
+    LogAnalyzerOptions options = logAnalyzerDefaults();
+    const char* out = ".";
+    const char* synthesize = nullptr;
+    LogSynthesisOptions synthesis = {20, false, 1ull << 30, 1};
+    std::vector<const char*> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--out") == 0 && hasValue) {
+            out = argv[++i];
+        } else if (strcmp(arg, "--threads") == 0 && hasValue) {
+            options.threads = (uint8_t)std::min(255, std::max(0, atoi(argv[++i])));
+        } else if (strcmp(arg, "--synthesize") == 0 && hasValue) {
+            synthesize = argv[++i];
+        } else if (strcmp(arg, "--gigabytes") == 0 && hasValue) {
+            synthesis.totalBytes = (uint64_t)(atof(argv[++i]) * (1ull << 30));
+        } else if (strcmp(arg, "--drones") == 0 && hasValue) {
+            synthesis.drones = (uint8_t)std::min(250, std::max(2, atoi(argv[++i])));
+        } else if (strcmp(arg, "--dumps") == 0) {
+            synthesis.dumps = true;
+        } else if (arg[0] == '-') {
+            usage();
+            return 2;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (!synthesize && inputs.empty()) {
+        usage();
+        return 2;
+    }
+
+    LogAnalyzer analyzer(options);
+    if (synthesize) {
+        auto started = std::chrono::steady_clock::now();
+        LogSynthesisTruth truth;
+        if (!synthesizeLogs(synthesize, synthesis, &truth)) {
+            fprintf(stderr, "log_analyzer: cannot write the synthetic set to %s\n", synthesize);
+            return 1;
+        }
+        printf("Synthesized %u %s, %.2f GB, %u s of flight in %.1f s\n", synthesis.drones,
+               synthesis.dumps ? "dumps" : "captures", truth.bytes / 1e9, truth.seconds,
+               std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+        if (!addSynthesized(analyzer, synthesize)) {
+            fprintf(stderr, "log_analyzer: cannot map the synthetic set in %s\n", synthesize);
+            return 1;
+        }
+    }
+    for (const char* input : inputs) {
+        std::string path = input;
+        uint8_t node = LOG_NO_NODE;
+        size_t at = path.rfind('@');
+        if (at != std::string::npos && at + 1 < path.size()) {
+            node = (uint8_t)atoi(path.c_str() + at + 1);
+            path.resize(at);
+        }
+        if (!analyzer.addFile(path.c_str(), node)) {
+            fprintf(stderr, "log_analyzer: cannot map %s\n", path.c_str());
+            return 1;
+        }
+    }
+
+    LogAnalysis analysis = analyzer.run();
+    double seconds = analysis.parseSeconds + analysis.joinSeconds;
+    printf("%u files, %.2f GB: %llu lines, %llu records, %llu TX, %llu RX\n", analysis.files,
+           analysis.bytes / 1e9, (unsigned long long)analysis.lines, (unsigned long long)analysis.records,
+           (unsigned long long)analysis.txFrames, (unsigned long long)analysis.rxFrames);
+    printf("Joined %llu, no TX %llu, ambiguous %llu, no node %llu\n", (unsigned long long)analysis.joined,
+           (unsigned long long)analysis.unjoined, (unsigned long long)analysis.ambiguous,
+           (unsigned long long)analysis.unattributed);
+    printf("%u threads: parse %.2f s, join %.2f s, %.2f GB/s\n", analysis.threads, analysis.parseSeconds,
+           analysis.joinSeconds, seconds > 0 ? analysis.bytes / seconds / 1e9 : 0);
+
+    printf("\n  link     sent    delivered  ratio   p50 ms  p90 ms  p99 ms  RSSI\n");
+    for (const LogLinkReport& link : analysis.links) {
+        printf("  %3u->%-3u %8llu %8llu  %6.3f  %6.0f  %6.0f  %6.0f  %5.1f%s\n", link.source, link.receiver,
+               (unsigned long long)link.sent, (unsigned long long)link.delivered, link.deliveryRatio,
+               link.latencyP50Ms, link.latencyP90Ms, link.latencyP99Ms, link.meanRssi,
+               link.latencySamples && !link.latencyAligned ? "  (latency relative)" : "");
+    }
+
+    if (!LogAnalyzer::writeCsv(analysis, out)) {
+        fprintf(stderr, "log_analyzer: cannot write CSV files to %s\n", out);
+        return 1;
+    }
+    printf("\nCSV written to %s\n", out);
+    return 0;
+}
@@ -0,0 +1,418 @@
+#!/usr/bin/env python3
+"""Compile the deployment JSON in data/ into constexpr C++ tables.
+
+    config_generator.py                 validate, rewrite include/generated/swarm_config.h if it changed
+    config_generator.py --check         validate, fail if the header is out of date
+    config_generator.py override --drone 3 max_tx_power_dbm=14 [--out tune.bin]
+                                        a field override blob for NVS, printed as hex
+                                        for the 'T' console command
+
+Inputs:
+    data/network_config.json        swarm-wide radio, timing and size
+    data/hardware_pins.json         pin maps by board name
+    data/algorithm_parameters.json  mission geometry and traffic limits
+    data/drone_configs/drone_<id>_config.json
+                                    id, name, board, optional radio overrides
+
+Every key is checked against SCHEMA below: unknown keys, missing keys and
+out-of-range values are errors, so a typo fails the build instead of
+silently taking a default. The flight image never parses JSON.
+"""
+
+import argparse
+import binascii
+import glob
+import json
+import os
+import re
+import struct
+import sys
+
+PROJECT_DIR = os.path.abspath(os.path.join(os.path.dirname(__file__), "..", ".."))
+HEADER_PATH = os.path.join("include", "generated", "swarm_config.h")
+
+
+class ConfigError(Exception):
+    pass
+
+
+class Field:
+    def __init__(self, key, member, ctype, low, high, comment="", hex_ok=False):
+        self.key = key
+        self.member = member
+        self.ctype = ctype
+        self.low = low
+        self.high = high
+        self.comment = comment
+        self.hex_ok = hex_ok
+
+    def parse(self, value, where):
+        if self.hex_ok and isinstance(value, str) and re.fullmatch(r"0x[0-9A-Fa-f]+", value):
+            value = int(value, 16)
+        if isinstance(value, bool) or not isinstance(value, int):
+            raise ConfigError("%s.%s: expected an integer, got %r" % (where, self.key, value))
+        if not self.low <= value <= self.high:
+            raise ConfigError("%s.%s: %d outside %d..%d" % (where, self.key, value, self.low, self.high))
+        return value
+
+    def literal(self, value):
+        return "0x%02X" % value if self.hex_ok else str(value)
+
+
+# Struct name -> fields, in declaration order
+SCHEMA = {
+    "RadioConfig": [
+        Field("frequency_hz", "frequencyHz", "uint32_t", 137000000, 1020000000, "SX127x tuning range"),
+        Field("bandwidth_hz", "bandwidthHz", "uint32_t", 7800, 500000),
+        Field("spreading_factor", "spreadingFactor", "uint8_t", 7, 9, "Starting SF; ADR_MIN_SF..ADR_MAX_SF"),
+        Field("coding_rate", "codingRate", "uint8_t", 5, 8, "4/x"),
+        Field("preamble_length", "preambleLength", "uint16_t", 6, 65535),
+        Field("tx_power_dbm", "txPowerDbm", "int8_t", 2, 20, "PA_BOOST range"),
+        Field("sync_word", "syncWord", "uint8_t", 0, 255, "Swarm-wide: nodes on another word hear nothing",
+              hex_ok=True),
+    ],
+    "TimingConfig": [
+        Field("heartbeat_interval_ms", "heartbeatIntervalMs", "uint32_t", 500, 60000),
+        Field("heartbeat_timeout_ms", "heartbeatTimeoutMs", "uint32_t", 1000, 300000),
+        Field("message_timeout_ms", "messageTimeoutMs", "uint32_t", 100, 60000),
+        Field("stats_interval_ms", "statsIntervalMs", "uint32_t", 1000, 3600000),
+    ],
+    "MissionConfig": [
+        Field("area_size_m", "areaSizeM", "uint16_t", 10, 50000, "Square side"),
+        Field("target_detection_range_m", "targetDetectionRangeM", "uint16_t", 1, 1000),
+        Field("formation_spacing_m", "formationSpacingM", "uint16_t", 5, 5000),
+    ],
+    "LimitConfig": [
+        Field("max_message_rate_per_sec", "maxMessageRatePerSec", "uint8_t", 1, 100),
+        Field("max_bandwidth_usage_percent", "maxBandwidthUsagePercent", "uint8_t", 1, 100),
+        Field("min_battery_level_percent", "minBatteryLevelPercent", "uint8_t", 0, 100),
+    ],
+    "PinConfig": [
+        Field("lora_ss", "loraSs", "int8_t", -1, 39),
+        Field("lora_rst", "loraRst", "int8_t", -1, 39),
+        Field("lora_dio0", "loraDio0", "int8_t", -1, 39),
+        Field("gps_rx", "gpsRx", "int8_t", -1, 39),
+        Field("gps_tx", "gpsTx", "int8_t", -1, 39),
+        Field("status_led", "statusLed", "int8_t", -1, 39, "-1: none"),
+    ],
+}
+
+# Radio fields a single drone may change without cutting itself off
+DRONE_RADIO_OVERRIDES = ("tx_power_dbm",)
+
+# Fields an override blob may set at run time: (id, field); the ids are on
+# the wire, so never reuse one
+TUNABLES = [
+    (1, Field("max_tx_power_dbm", "MAX_TX_POWER_DBM", "int8_t", 2, 20, "ADR power cap, e.g. a lower EIRP limit")),
+    (2, Field("heartbeat_interval_ms", "HEARTBEAT_INTERVAL_MS", "uint32_t", 500, 60000)),
+]
+
+OVERRIDE_MAGIC = b"CF"
+OVERRIDE_VERSION = 1
+OVERRIDE_MAX_BYTES = 48       # CONFIG_OVERRIDE_MAX_BYTES in include/config.h
+
+
+def load_json(path):
+    try:
+        with open(path) as f:
+            return json.load(f)
+    except (OSError, ValueError) as e:
+        raise ConfigError("%s: %s" % (os.path.relpath(path, PROJECT_DIR), e))
+
+
+def parse_section(data, struct_name, where, partial=False):
+    if not isinstance(data, dict):
+        raise ConfigError("%s: expected an object" % where)
+    fields = SCHEMA[struct_name]
+    known = {f.key for f in fields}
+    unknown = sorted(set(data) - known)
+    if unknown:
+        raise ConfigError("%s: unknown key(s) %s" % (where, ", ".join(unknown)))
+    values = {}
+    for field in fields:
+        if field.key in data:
+            values[field.key] = field.parse(data[field.key], where)
+        elif not partial:
+            raise ConfigError("%s: missing %s" % (where, field.key))
+    return values
+
+
+def expect_keys(data, keys, where):
+    if not isinstance(data, dict):
+        raise ConfigError("%s: expected an object" % where)
+    extra = sorted(set(data) - set(keys))
+    missing = sorted(set(keys) - set(data))
+    if extra:
+        raise ConfigError("%s: unknown key(s) %s" % (where, ", ".join(extra)))
+    if missing:
+        raise ConfigError("%s: missing %s" % (where, ", ".join(missing)))
+
+
+def load_config(project_dir):
+    data_dir = os.path.join(project_dir, "data")
+    network = load_json(os.path.join(data_dir, "network_config.json"))
+    pins = load_json(os.path.join(data_dir, "hardware_pins.json"))
+    algorithm = load_json(os.path.join(data_dir, "algorithm_parameters.json"))
+
+    expect_keys(network, ("swarm", "radio", "timing"), "network_config")
+    expect_keys(network["swarm"], ("max_drones",), "network_config.swarm")
+    max_drones = Field("max_drones", "maxDrones", "uint8_t", 1, 254).parse(
+        network["swarm"]["max_drones"], "network_config.swarm")
+    radio = parse_section(network["radio"], "RadioConfig", "network_config.radio")
+    timing = parse_section(network["timing"], "TimingConfig", "network_config.timing")
+    if radio["bandwidth_hz"] not in (7800, 10400, 15600, 20800, 31250, 41700, 62500, 125000, 250000, 500000):
+        raise ConfigError("network_config.radio.bandwidth_hz: %d is not an SX127x bandwidth" % radio["bandwidth_hz"])
+    if timing["heartbeat_timeout_ms"] < 2 * timing["heartbeat_interval_ms"]:
+        raise ConfigError("network_config.timing: heartbeat_timeout_ms must cover two heartbeat intervals")
+
+    expect_keys(algorithm, ("mission", "limits"), "algorithm_parameters")
+    mission = parse_section(algorithm["mission"], "MissionConfig", "algorithm_parameters.mission")
+    limits = parse_section(algorithm["limits"], "LimitConfig", "algorithm_parameters.limits")
+
+    if not isinstance(pins, dict) or not pins:
+        raise ConfigError("hardware_pins: expected one object per board")
+    boards = {}
+    for board, pin_map in sorted(pins.items()):
+        if not re.fullmatch(r"[A-Za-z_][A-Za-z0-9_]*", board):
+            raise ConfigError("hardware_pins: board name %r is not an identifier" % board)
+        boards[board] = parse_section(pin_map, "PinConfig", "hardware_pins." + board)
+
+    drones = []
+    paths = sorted(glob.glob(os.path.join(data_dir, "drone_configs", "drone_*_config.json")))
+    if not paths:
+        raise ConfigError("data/drone_configs: no drone_<id>_config.json files")
+    for path in paths:
+        where = os.path.basename(path)
+        drone = load_json(path)
+        if not isinstance(drone, dict):
+            raise ConfigError("%s: expected an object" % where)
+        extra = sorted(set(drone) - {"id", "name", "hardware", "radio"})
+        if extra:
+            raise ConfigError("%s: unknown key(s) %s" % (where, ", ".join(extra)))
+        for key in ("id", "name", "hardware"):
+            if key not in drone:
+                raise ConfigError("%s: missing %s" % (where, key))
+        drone_id = Field("id", "id", "uint8_t", 1, max_drones).parse(drone["id"], where)
+        if where != "drone_%d_config.json" % drone_id:
+            raise ConfigError("%s: id %d does not match the file name" % (where, drone_id))
+        name = drone["name"]
+        if not isinstance(name, str) or not re.fullmatch(r"[\x20-\x7E]{1,23}", name) or '"' in name or "\\" in name:
+            raise ConfigError("%s.name: 1-23 printable characters, no quotes or backslashes" % where)
+        if drone["hardware"] not in boards:
+            raise ConfigError("%s.hardware: no board %r in hardware_pins.json" % (where, drone["hardware"]))
+        own_radio = parse_section(drone.get("radio", {}), "RadioConfig", where + ".radio", partial=True)
+        swarm_wide = sorted(set(own_radio) - set(DRONE_RADIO_OVERRIDES))
+        if swarm_wide:
+            raise ConfigError("%s.radio: %s is swarm-wide; set it in network_config.json"
+                              % (where, ", ".join(swarm_wide)))
+        merged = dict(radio)
+        merged.update(own_radio)
+        drones.append({"id": drone_id, "name": name, "hardware": drone["hardware"], "radio": merged})
+    drones.sort(key=lambda d: d["id"])
+    if len({d["name"] for d in drones}) != len(drones):
+        raise ConfigError("data/drone_configs: drone names must be unique")
+
+    config = {
+        "max_drones": max_drones,
+        "radio": radio,
+        "timing": timing,
+        "mission": mission,
+        "limits": limits,
+        "boards": boards,
+        "drones": drones,
+    }
+    # Ties override blobs to the inputs they were made against
+    config["hash"] = binascii.crc32(json.dumps(config, sort_keys=True).encode()) & 0xFFFFFFFF
+    return config
+
+
+def struct_initializer(struct_name, values):
+    return "{" + ", ".join(f.literal(values[f.key]) for f in SCHEMA[struct_name]) + "}"
+
+
+def render_header(config):
+    out = []
+    emit = out.append
+    emit("// Generated by tools/deployment/config_generator.py from data/network_config.json,")
+    emit("// data/hardware_pins.json, data/algorithm_parameters.json and data/drone_configs/.")
+    emit("// Do not edit: pre_build.py rewrites it whenever the JSON changes.")
+    emit("")
+    emit("#ifndef SWARM_CONFIG_H")
+    emit("#define SWARM_CONFIG_H")
+    emit("")
+    emit("#include <stdint.h>")
+    emit("")
+    for struct_name, fields in SCHEMA.items():
+        emit("struct %s {" % struct_name)
+        for field in fields:
+            line = "    %s %s;" % (field.ctype, field.member)
+            if field.comment:
+                line = line.ljust(36) + "// " + field.comment
+            emit(line)
+        emit("};")
+        emit("")
+    emit("struct SwarmConfig {")
+    emit("    uint8_t maxDrones;")
+    emit("    RadioConfig radio;")
+    emit("    TimingConfig timing;")
+    emit("    MissionConfig mission;")
+    emit("    LimitConfig limits;")
+    emit("};")
+    emit("")
+    emit("struct DroneConfig {")
+    emit("    uint8_t id;")
+    emit("    const char* name;")
+    emit("    RadioConfig radio;                  // The swarm's, with this drone's overrides")
+    emit("    PinConfig pins;")
+    emit("};")
+    emit("")
+    emit("// Run-time override fields; the ids are on the wire")
+    emit("enum ConfigField : uint8_t {")
+    for field_id, field in TUNABLES:
+        emit("    CONFIG_FIELD_%s = %d," % (field.member, field_id))
+    emit("};")
+    emit("")
+    emit("struct ConfigFieldLimits {")
+    emit("    uint8_t field;")
+    emit("    int32_t min;")
+    emit("    int32_t max;")
+    emit("};")
+    emit("")
+    emit("constexpr uint32_t SWARM_CONFIG_HASH = 0x%08Xu;" % config["hash"])
+    emit("")
+    emit("constexpr SwarmConfig SWARM_CONFIG = {")
+    emit("    %d," % config["max_drones"])
+    emit("    %s," % struct_initializer("RadioConfig", config["radio"]))
+    emit("    %s," % struct_initializer("TimingConfig", config["timing"]))
+    emit("    %s," % struct_initializer("MissionConfig", config["mission"]))
+    emit("    %s" % struct_initializer("LimitConfig", config["limits"]))
+    emit("};")
+    emit("")
+    emit("#define SWARM_CONFIG_DRONES %d" % len(config["drones"]))
+    emit("constexpr DroneConfig DRONE_CONFIGS[SWARM_CONFIG_DRONES] = {")
+    for drone in config["drones"]:
+        emit("    {%d, \"%s\", %s," % (drone["id"], drone["name"], struct_initializer("RadioConfig", drone["radio"])))
+        emit("     %s},   // %s" % (struct_initializer("PinConfig", config["boards"][drone["hardware"]]),
+                                    drone["hardware"]))
+    emit("};")
+    emit("")
+    emit("#define CONFIG_FIELD_COUNT %d" % len(TUNABLES))
+    emit("constexpr ConfigFieldLimits CONFIG_FIELD_LIMITS[CONFIG_FIELD_COUNT] = {")
+    for field_id, field in TUNABLES:
+        line = "    {CONFIG_FIELD_%s, %d, %d}," % (field.member, field.low, field.high)
+        if field.comment:
+            line = line.ljust(52) + "// " + field.comment
+        emit(line)
+    emit("};")
+    emit("")
+    emit("// DRONE_ID (-D per env) picks the row; without one, the lowest id")
+    emit("#if !defined(DRONE_ID)")
+    emit("#define DRONE_CONFIG_INDEX 0")
+    for index, drone in enumerate(config["drones"]):
+        emit("#elif DRONE_ID == %d" % drone["id"])
+        emit("#define DRONE_CONFIG_INDEX %d" % index)
+    emit("#else")
+    emit("#error \"DRONE_ID has no data/drone_configs/drone_<id>_config.json\"")
+    emit("#endif")
+    emit("")
+    emit("#endif // SWARM_CONFIG_H")
+    return "\n".join(out) + "\n"
+
+
+def generate(project_dir=PROJECT_DIR, check=False):
+    """Returns True when the header was (or, with check, would be) rewritten."""
+    header = render_header(load_config(project_dir))
+    path = os.path.join(project_dir, HEADER_PATH)
+    try:
+        with open(path) as f:
+            current = f.read()
+    except OSError:
+        current = None
+    if current == header:
+        return False
+    if not check:
+        # Only on a change, so an unchanged config does not rebuild everything
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+        with open(path, "w") as f:
+            f.write(header)
+    return True
+
+
+def crc16(data, crc=0xFFFF):
+    """flightCrc16() in include/utilities/flight_recorder.h."""
+    for byte in data:
+        crc = ((crc >> 8) | (crc << 8)) & 0xFFFF
+        crc ^= byte
+        crc ^= (crc & 0xFF) >> 4
+        crc ^= (crc << 12) & 0xFFFF
+        crc ^= ((crc & 0xFF) << 5) & 0xFFFF
+    return crc
+
+
+def varint(value):
+    out = bytearray()
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+    return bytes(out)
+
+
+def encode_override(config, drone_id, settings):
+    """'C' 'F' | version | drone id | hash | (field id, zigzag varint)... | CRC-16, as config_override.h."""
+    if drone_id and drone_id not in {d["id"] for d in config["drones"]}:
+        raise ConfigError("override: no drone %d in data/drone_configs" % drone_id)
+    by_key = {field.key: (field_id, field) for field_id, field in TUNABLES}
+    blob = bytearray(OVERRIDE_MAGIC) + struct.pack("<BBI", OVERRIDE_VERSION, drone_id, config["hash"])
+    for setting in settings:
+        key, _, text = setting.partition("=")
+        if key not in by_key or not text:
+            raise ConfigError("override: expected one of %s as key=value, got %r"
+                              % (", ".join(sorted(by_key)), setting))
+        field_id, field = by_key[key]
+        try:
+            value = field.parse(int(text, 0), "override")
+        except ValueError:
+            raise ConfigError("override.%s: %r is not an integer" % (key, text))
+        blob.append(field_id)
+        blob += varint(((value << 1) ^ (value >> 31)) & 0xFFFFFFFF)
+    blob += struct.pack("<H", crc16(blob))
+    if len(blob) > OVERRIDE_MAX_BYTES:
+        raise ConfigError("override: %d bytes, more than %d" % (len(blob), OVERRIDE_MAX_BYTES))
+    return bytes(blob)
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--project", default=PROJECT_DIR, help="project root (default: this checkout)")
+    parser.add_argument("--check", action="store_true", help="fail if the generated header is out of date")
+    sub = parser.add_subparsers(dest="command")
+    override = sub.add_parser("override", help="encode a run-time field override blob")
+    override.add_argument("--drone", type=int, default=0, help="drone id; 0 applies to any drone")
+    override.add_argument("--out", help="also write the blob to this file")
+    override.add_argument("settings", nargs="+", metavar="key=value")
+    args = parser.parse_args(argv)
+
+    try:
+        if args.command == "override":
+            blob = encode_override(load_config(args.project), args.drone, args.settings)
+            if args.out:
+                with open(args.out, "wb") as f:
+                    f.write(blob)
+            print(blob.hex().upper())
+            return 0
+        changed = generate(args.project, check=args.check)
+    except ConfigError as e:
+        print("config_generator: %s" % e, file=sys.stderr)
+        return 1
+    if args.check and changed:
+        print("config_generator: %s is out of date; run tools/deployment/config_generator.py" % HEADER_PATH,
+              file=sys.stderr)
+        return 1
+    if changed:
+        print("config_generator: wrote %s" % HEADER_PATH)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
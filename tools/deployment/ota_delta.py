@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+"""Build over-the-air update files for the swarm (MSG_OTA).
+
+    ota_delta.py firmware OLD.bin NEW.bin --version 7 [-o update.bin]
+                                        a delta that rebuilds NEW from OLD, the
+                                        image every drone is running now
+    ota_delta.py config HEX|FILE --version 8 [-o update.bin]
+                                        a parameter update carrying a config
+                                        override blob (config_generator.py override)
+
+The file is written to the ground node's staging partition with the esptool
+command printed at the end; after a restart (or 'U' on the console) the node
+serves it and the swarm passes it on. Each drone checks the SHA-256 of its
+running image against the manifest before applying a firmware delta and the
+SHA-256 of the result before installing it.
+
+Format, as include/communications/ota_service.h: an 84-byte OtaManifest,
+then ops encoded as LEB128 varints:
+    COPY    (length << 1) | 1, zigzag(base offset - base cursor)
+    INSERT  length << 1, then the literal bytes
+The encoder is the one in src/communications/ota_service.cpp, so both
+produce the same file.
+"""
+
+import argparse
+import binascii
+import hashlib
+import os
+import struct
+import sys
+
+OTA_MAGIC = 0x3144544F
+OTA_KIND_FIRMWARE = 1
+OTA_KIND_CONFIG = 2
+MANIFEST = struct.Struct("<IBBHIII32s32s")
+
+MIN_MATCH = 12                  # A COPY op costs 2-6 bytes
+INDEX_STRIDE = 4                # Base blocks indexed; matches are extended backwards
+
+# partitions.csv
+STAGING_LABEL = "otadelta"
+STAGING_OFFSET = 0x390000
+STAGING_SIZE = 0x40000
+CONFIG_OVERRIDE_MAX_BYTES = 48  # include/config.h
+
+
+def varint(value):
+    out = bytearray()
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+    return bytes(out)
+
+
+def zigzag(value):
+    return value << 1 if value >= 0 else (-value << 1) - 1
+
+
+def match_length(base, target, start, at):
+    # Compare in slices first; byte by byte only for the tail
+    n = 0
+    step = 256
+    limit = min(len(base) - start, len(target) - at)
+    while n + step <= limit and base[start + n:start + n + step] == target[at + n:at + n + step]:
+        n += step
+    while n < limit and base[start + n] == target[at + n]:
+        n += 1
+    return n
+
+
+def encode_delta(kind, version, base, target):
+    out = bytearray(MANIFEST.size)
+    index = {}
+    for p in range(0, len(base) - 7, INDEX_STRIDE):
+        index.setdefault(base[p:p + 8], p)
+
+    def put_insert(start, end):
+        if end > start:
+            out.extend(varint((end - start) << 1))
+            out.extend(target[start:end])
+
+    cursor = at = literal_start = 0
+    while at < len(target):
+        # Same place in the base, as if the literal bytes replaced as many
+        best_from = cursor + (at - literal_start)
+        best_length = match_length(base, target, best_from, at) if best_from < len(base) else 0
+        if best_length < MIN_MATCH and at + 8 <= len(target):
+            found = index.get(target[at:at + 8])
+            if found is not None:
+                n = match_length(base, target, found, at)
+                if n > best_length:
+                    best_from, best_length = found, n
+        if best_length < MIN_MATCH:
+            at += 1
+            continue
+        while at > literal_start and best_from > 0 and base[best_from - 1] == target[at - 1]:
+            at -= 1
+            best_from -= 1
+            best_length += 1
+        put_insert(literal_start, at)
+        out.extend(varint(best_length << 1 | 1))
+        out.extend(varint(zigzag(best_from - cursor)))
+        cursor = best_from + best_length
+        at += best_length
+        literal_start = at
+    put_insert(literal_start, len(target))
+
+    out[:MANIFEST.size] = MANIFEST.pack(OTA_MAGIC, kind, 0, version, len(out), len(base), len(target),
+                                        hashlib.sha256(base).digest(), hashlib.sha256(target).digest())
+    return bytes(out)
+
+
+def read_blob(value):
+    if os.path.isfile(value):
+        with open(value, "rb") as f:
+            return f.read()
+    try:
+        return binascii.unhexlify(value.replace(" ", ""))
+    except (binascii.Error, ValueError):
+        raise SystemExit("ota_delta: %r is neither a file nor hex" % value)
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    sub = parser.add_subparsers(dest="command", required=True)
+    firmware = sub.add_parser("firmware", help="delta between two application images")
+    firmware.add_argument("old", help="image the drones are running (.pio/build/<env>/firmware.bin)")
+    firmware.add_argument("new", help="image to install")
+    config = sub.add_parser("config", help="parameter update from a config override blob")
+    config.add_argument("blob", help="hex as config_generator.py override prints it, or a file")
+    for p in (firmware, config):
+        p.add_argument("--version", type=int, required=True, help="1-65535; drones take the newer one")
+        p.add_argument("-o", "--out", default="ota_update.bin")
+    args = parser.parse_args(argv)
+
+    if not 1 <= args.version <= 0xFFFF:
+        print("ota_delta: --version must be 1-65535", file=sys.stderr)
+        return 1
+    if args.command == "firmware":
+        with open(args.old, "rb") as f:
+            base = f.read()
+        with open(args.new, "rb") as f:
+            target = f.read()
+        delta = encode_delta(OTA_KIND_FIRMWARE, args.version, base, target)
+    else:
+        target = read_blob(args.blob)
+        if len(target) > CONFIG_OVERRIDE_MAX_BYTES:
+            print("ota_delta: override blob longer than %d bytes" % CONFIG_OVERRIDE_MAX_BYTES, file=sys.stderr)
+            return 1
+        delta = encode_delta(OTA_KIND_CONFIG, args.version, b"", target)
+    if len(delta) > STAGING_SIZE:
+        print("ota_delta: %d-byte delta does not fit the %d-byte %s partition"
+              % (len(delta), STAGING_SIZE, STAGING_LABEL), file=sys.stderr)
+        return 1
+
+    with open(args.out, "wb") as f:
+        f.write(delta)
+    print("ota_delta: %s, version %d: %d-byte image, %d-byte delta (%.1f%%)"
+          % (args.out, args.version, len(target), len(delta), 100.0 * len(delta) / max(len(target), 1)))
+    print("Load it on the ground node with:")
+    print("    esptool.py --chip esp32 write_flash 0x%X %s" % (STAGING_OFFSET, args.out))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,19 @@
+# PlatformIO pre-build script: compiles data/*.json into
+# include/generated/swarm_config.h before anything else is built, and stops
+# the build on an invalid config.
+
+Import("env")  # noqa: F821 - provided by PlatformIO
+
+import os
+import sys
+
+sys.path.insert(0, os.path.join(env.subst("$PROJECT_DIR"), "tools", "deployment"))  # noqa: F821
+
+import config_generator  # noqa: E402
+
+try:
+    if config_generator.generate(env.subst("$PROJECT_DIR")):  # noqa: F821
+        print("config_generator: wrote %s" % config_generator.HEADER_PATH)
+except config_generator.ConfigError as e:
+    sys.stderr.write("config_generator: %s\n" % e)
+    env.Exit(1)  # noqa: F821
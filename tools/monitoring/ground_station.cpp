@@ -0,0 +1,169 @@
+// Ground station daemon and viewer.
+//
+//   pio run -e ground_station
+//   .pio/build/ground_station/program [options] DEVICE ...
+//   .pio/build/ground_station/program --view [--lines]
+//
+// The daemon reads every DEVICE (/dev/ttyUSB*, /dev/ttyACM*, ptys) on one
+// epoll loop and publishes the swarm state to shared memory until SIGINT or
+// SIGTERM; drones need -DSERIAL_TAP_ENABLED=1 for frames to show up, text
+// alone gives log lines. Any number of viewers attach to the same segment.
+//
+//   --shm NAME         shared-memory segment (default GROUND_SHM_NAME)
+//   --baud N           serial speed (default GROUND_SERIAL_BAUD)
+//   --view             attach and print the drone table and links once a second
+//   --lines            with --view, print every log line as it arrives
+
+#include "../../include/ground_station/serial_mux.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <vector>
+
+static volatile sig_atomic_t stopping = 0;
+
+static void onSignal(int) {
+    stopping = 1;
+}
+
+static void usage() {
+    fprintf(stderr,
+            "usage: ground_station [--shm NAME] [--baud N] DEVICE ...\n"
+            "       ground_station --view [--shm NAME] [--lines]\n");
+}
+
+static int runDaemon(const SerialMuxOptions& options, const std::vector<const char*>& devices) {
+    SerialMux mux;
+    if (!mux.begin(options)) {
+        fprintf(stderr, "ground_station: cannot create shared memory %s\n", options.shmName);
+        return 1;
+    }
+    for (const char* device : devices) {
+        if (mux.addDevice(device) < 0) {
+            fprintf(stderr, "ground_station: cannot open %s\n", device);
+        }
+    }
+    if (mux.getStats().openStreams == 0) {
+        return 1;
+    }
+    printf("Publishing %u streams to %s\n", mux.getStats().openStreams, options.shmName);
+
+    uint64_t lastReport = swarmClockNs();
+    SerialMuxStats last = mux.getStats();
+    while (!stopping && mux.getStats().openStreams > 0) {
+        mux.poll(500);
+        uint64_t now = swarmClockNs();
+        if (now - lastReport >= 5000000000ull) {
+            SerialMuxStats stats = mux.getStats();
+            double seconds = (now - lastReport) / 1e9;
+            printf("%u/%u streams open: %.1f kB/s, %.0f frames/s, %.0f lines/s, %llu corrupt\n", stats.openStreams,
+                   stats.streams, (stats.bytes - last.bytes) / seconds / 1000, (stats.frames - last.frames) / seconds,
+                   (stats.lines - last.lines) / seconds, (unsigned long long)stats.corrupt);
+            fflush(stdout);
+            last = stats;
+            lastReport = now;
+        }
+    }
+    mux.end();
+    return 0;
+}
+
+static void printTable(const SwarmViewer& viewer) {
+    uint64_t now = swarmClockNs();
+    printf("\n drone stream  battery  latitude   longitude   state  heard  sent    peers  links (source:RSSI)\n");
+    for (uint16_t id = 1; id < SWARM_NODES; id++) {
+        SwarmDrone drone;
+        if (!viewer.readDrone((uint8_t)id, drone) || !drone.known) {
+            continue;
+        }
+        char stream[8] = "-";
+        if (drone.stream != SWARM_NO_STREAM) {
+            snprintf(stream, sizeof(stream), "%u", drone.stream);
+        }
+        printf(" %5u %6s  %6.1f%%  %10.6f %11.6f  %u/%u  %5.1fs  %6u  %5u ", id, stream, drone.battery,
+               drone.latitude, drone.longitude, drone.missionState, drone.status,
+               drone.lastHeardNs ? (now - drone.lastHeardNs) / 1e9 : 0.0, drone.framesSent, drone.peerCount);
+        for (uint16_t source = 1; source < SWARM_NODES; source++) {
+            SwarmLink link;
+            if (viewer.readLink((uint8_t)id, (uint8_t)source, link) && link.lastNs != 0) {
+                printf(" %u:%d%s", source, link.rssi, link.fromTelemetry ? "*" : "");
+            }
+        }
+        printf("\n");
+    }
+}
+
+static int runViewer(const char* shmName, bool lines) {
+    SwarmViewer viewer;
+    if (!viewer.attach(shmName, true)) {
+        fprintf(stderr, "ground_station: no swarm state at %s; is the daemon running?\n", shmName);
+        return 1;
+    }
+    uint64_t lastTable = 0;
+    uint64_t lastGeneration = 0;
+    while (!stopping) {
+        const SwarmEvent* event;
+        while (viewer.next(event)) {
+            if (lines && event->kind == SWARM_EVENT_LINE) {
+                char text[SWARM_LINE_BYTES + 1];
+                memcpy(text, event->line, event->lineLength);
+                text[event->lineLength] = '\0';
+                uint8_t node = event->node;
+                bool truncated = event->flags & SWARM_FLAG_TRUNCATED;
+                if (viewer.confirm()) {
+                    printf("%3u> %s%s\n", node, text, truncated ? "..." : "");
+                }
+            } else {
+                viewer.confirm();
+            }
+        }
+        uint64_t now = swarmClockNs();
+        if (!lines && now - lastTable >= 1000000000ull && viewer.generation() != lastGeneration) {
+            lastGeneration = viewer.generation();
+            lastTable = now;
+            printTable(viewer);
+            if (viewer.getLost()) {
+                printf(" (%llu events overrun)\n", (unsigned long long)viewer.getLost());
+            }
+        }
+        fflush(stdout);
+        usleep(20000);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    SerialMuxOptions options = serialMuxDefaults();
+    bool view = false;
+    bool lines = false;
+    std::vector<const char*> devices;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--shm") == 0 && hasValue) {
+            options.shmName = argv[++i];
+        } else if (strcmp(arg, "--baud") == 0 && hasValue) {
+            options.baud = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(arg, "--view") == 0) {
+            view = true;
+        } else if (strcmp(arg, "--lines") == 0) {
+            lines = true;
+        } else if (arg[0] == '-') {
+            usage();
+            return 2;
+        } else {
+            devices.push_back(arg);
+        }
+    }
+    if (view == !devices.empty()) {
+        usage();
+        return 2;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    return view ? runViewer(options.shmName, lines) : runDaemon(options, devices);
+}